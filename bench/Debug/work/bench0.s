@@ -0,0 +1,27 @@
+* Generated by bench.  Each part is assembled at $4000 and saved on its own.
+         put   macros
+         org   $4000
+         put   part0
+         sav   part0
+         org   $4000
+         put   part1
+         sav   part1
+         org   $4000
+         put   part2
+         sav   part2
+         org   $4000
+         put   part3
+         sav   part3
+         org   $4000
+         put   part4
+         sav   part4
+         org   $4000
+         put   part5
+         sav   part5
+         org   $4000
+         put   part6
+         sav   part6
+         org   $4000
+         put   part7
+         sav   part7
+* End of generated source.
@@ -0,0 +1,21 @@
+* Generated by bench.  Each part is assembled at $4000 and saved on its own.
+         put   macros
+         org   $4000
+         put   part8
+         sav   part8
+         org   $4000
+         put   part9
+         sav   part9
+         org   $4000
+         put   part10
+         sav   part10
+         org   $4000
+         put   part11
+         sav   part11
+         org   $4000
+         put   part12
+         sav   part12
+         org   $4000
+         put   part13
+         sav   part13
+* End of generated source.
@@ -0,0 +1,958 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "Assembler.h"
+#include "DebugMap.h"
+#include "NibbleDiskImage.h"
+#include "BlockDiskImage.h"
+#include "util.h"
+
+
+#define DEFAULT_LINES               20000
+#define DEFAULT_ITERATIONS          5
+#define DEFAULT_THRESHOLD_PERCENT   10
+#define DEFAULT_WORK_DIRECTORY      "bench.work"
+#define DEFAULT_OUTPUT_FILENAME     "bench.json"
+#define MAX_PATH_LENGTH             1024
+#define UNITS_PER_PART              64
+#define PARTS_PER_SOURCE            8
+#define TABLE_ROWS_PER_PART         16
+#define BYTES_PER_TABLE_ROW         16
+#define RANDOM_SEED                 0x5eed1234
+#define RWTS16_TRACK_COUNT          17
+#define RW18_LINES_PER_TRACK        3
+#define BLOCKS_PER_OBJECT           16
+#define HDV_BLOCK_COUNT             1600
+#define MAP_LOOKUP_COUNT            100000
+/* Phases which run faster than this are mostly timer and scheduling noise so they aren't failed against a baseline. */
+#define MIN_COMPARED_SECONDS        0.005
+
+
+typedef struct BenchCommandLine
+{
+    const char*  pWorkDirectory;
+    const char*  pOutputFilename;
+    const char*  pBaselineFilename;
+    unsigned int lines;
+    unsigned int iterations;
+    unsigned int thresholdPercent;
+} BenchCommandLine;
+
+typedef enum BenchPhaseId
+{
+    PHASE_ASSEMBLE,
+    PHASE_NIB_SCRIPT,
+    PHASE_NIB_WRITE,
+    PHASE_HDV_SCRIPT,
+    PHASE_HDV_WRITE,
+    PHASE_MAP_ADDRESS,
+    PHASE_MAP_SYMBOL,
+    PHASE_SYMBOL_IMPORT,
+    PHASE_COUNT
+} BenchPhaseId;
+
+typedef struct BenchPhase
+{
+    const char*  pName;
+    /* The fastest of the iterations since it is the least disturbed by the rest of the system. */
+    double       seconds;
+    unsigned int lines;
+    unsigned int bytes;
+} BenchPhase;
+
+typedef struct SourceGenerator
+{
+    FILE*        pFile;
+    unsigned int lineCount;
+    unsigned int random;
+} SourceGenerator;
+
+typedef struct MapLookups
+{
+    char*          pData;
+    DebugMapView   view;
+    unsigned short addresses[MAP_LOOKUP_COUNT];
+    const char*    pNames[MAP_LOOKUP_COUNT];
+} MapLookups;
+
+
+static BenchPhase g_phases[PHASE_COUNT] =
+{
+    {"assemble",   0.0, 0, 0},
+    {"nib.script", 0.0, 0, 0},
+    {"nib.write",  0.0, 0, 0},
+    {"hdv.script", 0.0, 0, 0},
+    {"hdv.write",  0.0, 0, 0},
+    {"map.address", 0.0, 0, 0},
+    {"map.symbol", 0.0, 0, 0},
+    {"sym.import", 0.0, 0, 0}
+};
+static unsigned int g_sourceCount;
+
+
+static void parseCommandLine(BenchCommandLine* pThis, int argc, const char** argv);
+static void createWorkDirectory(const char* pWorkDirectory);
+static void generateSources(const BenchCommandLine* pCommandLine);
+static void generateImageScripts(const BenchCommandLine* pCommandLine);
+static void runIterations(const BenchCommandLine* pCommandLine);
+static void printSummary(void);
+static void writeReport(const BenchCommandLine* pCommandLine);
+static int compareToBaseline(const BenchCommandLine* pCommandLine);
+int main(int argc, const char** argv)
+{
+    int              returnValue = 0;
+    BenchCommandLine commandLine;
+
+    __try
+    {
+        parseCommandLine(&commandLine, argc-1, argv+1);
+        createWorkDirectory(commandLine.pWorkDirectory);
+        generateSources(&commandLine);
+        generateImageScripts(&commandLine);
+        runIterations(&commandLine);
+        printSummary();
+        writeReport(&commandLine);
+        if (commandLine.pBaselineFilename)
+            returnValue = compareToBaseline(&commandLine);
+    }
+    __catch
+    {
+        printf("Benchmark failed." LINE_ENDING);
+        returnValue = 1;
+    }
+    
+    return returnValue;
+}
+
+
+static void displayUsage(void);
+static unsigned int parseUnsigned(const char* pOption, const char* pValue, unsigned int min, unsigned int max);
+static void parseCommandLine(BenchCommandLine* pThis, int argc, const char** argv)
+{
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->pWorkDirectory = DEFAULT_WORK_DIRECTORY;
+    pThis->pOutputFilename = DEFAULT_OUTPUT_FILENAME;
+    pThis->lines = DEFAULT_LINES;
+    pThis->iterations = DEFAULT_ITERATIONS;
+    pThis->thresholdPercent = DEFAULT_THRESHOLD_PERCENT;
+    
+    while (argc > 0)
+    {
+        const char* pOption = argv[0];
+        
+        if (argc < 2)
+        {
+            if (0 != strcmp(pOption, "--help"))
+                fprintf(stderr, "error: %s is missing its value." LINE_ENDING, pOption);
+            displayUsage();
+            __throw(invalidArgumentException);
+        }
+        if (0 == strcmp(pOption, "--lines"))
+            pThis->lines = parseUnsigned(pOption, argv[1], 100, 10000000);
+        else if (0 == strcmp(pOption, "--iterations"))
+            pThis->iterations = parseUnsigned(pOption, argv[1], 1, 1000);
+        else if (0 == strcmp(pOption, "--threshold"))
+            pThis->thresholdPercent = parseUnsigned(pOption, argv[1], 0, 1000);
+        else if (0 == strcmp(pOption, "--workdir"))
+            pThis->pWorkDirectory = argv[1];
+        else if (0 == strcmp(pOption, "--output"))
+            pThis->pOutputFilename = argv[1];
+        else if (0 == strcmp(pOption, "--baseline"))
+            pThis->pBaselineFilename = argv[1];
+        else
+        {
+            fprintf(stderr, "error: %s is an unrecognized option." LINE_ENDING, pOption);
+            displayUsage();
+            __throw(invalidArgumentException);
+        }
+        argc -= 2;
+        argv += 2;
+    }
+}
+
+static void displayUsage(void)
+{
+    printf("Usage: bench [--lines count] [--iterations count] [--workdir directory]" LINE_ENDING
+           "             [--output jsonFilename] [--baseline jsonFilename] [--threshold percent]" LINE_ENDING
+           "Where" LINE_ENDING
+           "  --lines is the number of source lines to generate for the assembler.  Defaults to %u." LINE_ENDING
+           "  --iterations is how many times each phase is run.  The fastest run is reported." LINE_ENDING
+           "    Defaults to %u." LINE_ENDING
+           "  --workdir is the directory which receives the generated sources, scripts, object" LINE_ENDING
+           "    files and images.  Defaults to %s." LINE_ENDING
+           "  --output is the file to which the JSON results are written.  Defaults to %s." LINE_ENDING
+           "  --baseline is the JSON results of an earlier run to be compared against.  The" LINE_ENDING
+           "    benchmark fails if any phase is more than the threshold slower than in the" LINE_ENDING
+           "    baseline." LINE_ENDING
+           "  --threshold is the percentage by which a phase may be slower than its baseline." LINE_ENDING
+           "    Defaults to %u." LINE_ENDING,
+           DEFAULT_LINES, DEFAULT_ITERATIONS, DEFAULT_WORK_DIRECTORY, DEFAULT_OUTPUT_FILENAME, 
+           DEFAULT_THRESHOLD_PERCENT);
+}
+
+static unsigned int parseUnsigned(const char* pOption, const char* pValue, unsigned int min, unsigned int max)
+{
+    char*         pEnd = NULL;
+    unsigned long value;
+    
+    errno = 0;
+    value = strtoul(pValue, &pEnd, 0);
+    if (errno || *pEnd != '\0' || pValue[0] == '-' || value < min || value > max)
+    {
+        fprintf(stderr, "error: %s value of %s isn't in the range %u - %u." LINE_ENDING, pOption, pValue, min, max);
+        __throw(invalidArgumentException);
+    }
+    return (unsigned int)value;
+}
+
+
+static void createWorkDirectory(const char* pWorkDirectory)
+{
+    if (mkdir(pWorkDirectory, 0755) && errno != EEXIST)
+    {
+        fprintf(stderr, "error: Failed to create %s directory." LINE_ENDING, pWorkDirectory);
+        __throw(fileException);
+    }
+}
+
+
+static void buildPath(char* pPath, const char* pDirectory, const char* pFormat, ...);
+static FILE* createFile(const char* pPath);
+static void closeFile(FILE* pFile, const char* pPath);
+static unsigned int nextRandom(unsigned int* pRandom);
+static void emitLine(SourceGenerator* pThis, const char* pFormat, ...);
+static void generateMacros(SourceGenerator* pThis, const char* pWorkDirectory);
+static void generatePart(SourceGenerator* pThis, const char* pWorkDirectory, unsigned int part, unsigned int firstUnit);
+static void generateMainSource(SourceGenerator* pThis, const char* pWorkDirectory, unsigned int source, 
+                               unsigned int firstPart, unsigned int partCount);
+static void generateSources(const BenchCommandLine* pCommandLine)
+{
+    SourceGenerator generator;
+    unsigned int    part = 0;
+    unsigned int    i;
+    
+    /* Every file counts towards the requested number of lines, so the parts are generated first to know how many 
+       of them the main sources need to PUT. */
+    memset(&generator, 0, sizeof(generator));
+    generator.random = RANDOM_SEED;
+    generateMacros(&generator, pCommandLine->pWorkDirectory);
+    while (generator.lineCount < pCommandLine->lines)
+    {
+        generatePart(&generator, pCommandLine->pWorkDirectory, part, part * UNITS_PER_PART);
+        part++;
+    }
+    
+    /* The object code of a whole assembly has to fit in the assembler's 64k object buffer so the parts are split
+       across several main sources, much as a game is split into several assemblies. */
+    for (i = 0 ; i * PARTS_PER_SOURCE < part ; i++)
+    {
+        unsigned int firstPart = i * PARTS_PER_SOURCE;
+        unsigned int partCount = part - firstPart < PARTS_PER_SOURCE ? part - firstPart : PARTS_PER_SOURCE;
+        
+        generateMainSource(&generator, pCommandLine->pWorkDirectory, i, firstPart, partCount);
+    }
+    g_sourceCount = i;
+    
+    g_phases[PHASE_ASSEMBLE].lines = generator.lineCount;
+}
+
+static void generateMainSource(SourceGenerator* pThis, const char* pWorkDirectory, unsigned int source, 
+                               unsigned int firstPart, unsigned int partCount)
+{
+    char         path[MAX_PATH_LENGTH];
+    unsigned int part;
+    
+    buildPath(path, pWorkDirectory, "bench%u.s", source);
+    pThis->pFile = createFile(path);
+    emitLine(pThis, "* Generated by bench.  Each part is assembled at $4000 and saved on its own.");
+    emitLine(pThis, "         put   macros");
+    for (part = firstPart ; part < firstPart + partCount ; part++)
+    {
+        emitLine(pThis, "         org   $4000");
+        emitLine(pThis, "         put   part%u", part);
+        emitLine(pThis, "         sav   part%u", part);
+    }
+    emitLine(pThis, "* End of generated source.");
+    closeFile(pThis->pFile, path);
+}
+
+static void buildPath(char* pPath, const char* pDirectory, const char* pFormat, ...)
+{
+    va_list valist;
+    int     length;
+    
+    length = snprintf(pPath, MAX_PATH_LENGTH, "%s/", pDirectory);
+    va_start(valist, pFormat);
+    vsnprintf(pPath + length, MAX_PATH_LENGTH - length, pFormat, valist);
+    va_end(valist);
+}
+
+static FILE* createFile(const char* pPath)
+{
+    FILE* pFile = fopen(pPath, "w");
+    
+    if (!pFile)
+    {
+        fprintf(stderr, "error: Failed to create %s." LINE_ENDING, pPath);
+        __throw(fileOpenException);
+    }
+    return pFile;
+}
+
+static void closeFile(FILE* pFile, const char* pPath)
+{
+    int writeFailed = ferror(pFile);
+    
+    if (fclose(pFile) || writeFailed)
+    {
+        fprintf(stderr, "error: Failed to write %s." LINE_ENDING, pPath);
+        __throw(fileException);
+    }
+}
+
+static unsigned int nextRandom(unsigned int* pRandom)
+{
+    /* A fixed LCG, rather than rand(), so that the generated files are the same on every platform. */
+    *pRandom = *pRandom * 1103515245 + 12345;
+    return (*pRandom >> 16) & 0x7fff;
+}
+
+static void emitLine(SourceGenerator* pThis, const char* pFormat, ...)
+{
+    va_list valist;
+    
+    va_start(valist, pFormat);
+    vfprintf(pThis->pFile, pFormat, valist);
+    va_end(valist);
+    fputc('\n', pThis->pFile);
+    pThis->lineCount++;
+}
+
+static void generateMacros(SourceGenerator* pThis, const char* pWorkDirectory)
+{
+    char path[MAX_PATH_LENGTH];
+    
+    buildPath(path, pWorkDirectory, "macros.S");
+    pThis->pFile = createFile(path);
+    emitLine(pThis, "* Macros used by every generated unit.");
+    emitLine(pThis, "ADDB     mac");
+    emitLine(pThis, "         clc");
+    emitLine(pThis, "         lda   ]2");
+    emitLine(pThis, "         adc   #]1");
+    emitLine(pThis, "         sta   ]2");
+    emitLine(pThis, "         <<<");
+    closeFile(pThis->pFile, path);
+}
+
+static void generateUnit(SourceGenerator* pThis, unsigned int unit, unsigned int part);
+static void generateTables(SourceGenerator* pThis, const char* pWorkDirectory, unsigned int part);
+static void generatePart(SourceGenerator* pThis, const char* pWorkDirectory, unsigned int part, unsigned int firstUnit)
+{
+    char         path[MAX_PATH_LENGTH];
+    unsigned int i;
+    
+    buildPath(path, pWorkDirectory, "part%u.S", part);
+    pThis->pFile = createFile(path);
+    for (i = 0 ; i < UNITS_PER_PART / 2 ; i++)
+        generateUnit(pThis, firstUnit + i, part);
+    /* The nested PUT is kept away from the end of the part so that the lines which follow it must still be read. */
+    emitLine(pThis, "         put   tables%u", part);
+    for ( ; i < UNITS_PER_PART ; i++)
+        generateUnit(pThis, firstUnit + i, part);
+    closeFile(pThis->pFile, path);
+    
+    generateTables(pThis, pWorkDirectory, part);
+}
+
+static void formatRandomHex(char* pBuffer, size_t byteCount, unsigned int* pRandom);
+static void generateUnit(SourceGenerator* pThis, unsigned int unit, unsigned int part)
+{
+    unsigned int* pRandom = &pThis->random;
+    unsigned int  index = nextRandom(pRandom) & 0x0f;
+    unsigned int  address = 0x2000 + (nextRandom(pRandom) & 0x0fff);
+    unsigned int  immediate = nextRandom(pRandom) & 0xff;
+    unsigned int  zeroPage = nextRandom(pRandom) & 0xff;
+    unsigned int  row = nextRandom(pRandom) % TABLE_ROWS_PER_PART;
+    unsigned int  count = nextRandom(pRandom) & 0xff;
+    unsigned int  destination = nextRandom(pRandom) & 0xf0;
+    unsigned int  bytes[4];
+    char          table[2 * 16 + 1];
+    size_t        i;
+    
+    /* The random values are all drawn up front since the order in which function arguments are evaluated isn't
+       defined and the generated source must be the same from every build. */
+    formatRandomHex(table, 16, pRandom);
+    for (i = 0 ; i < ARRAYSIZE(bytes) ; i++)
+        bytes[i] = nextRandom(pRandom) & 0xff;
+    
+    /* Most references to a unit's labels come before their definitions so that the assembler has to resolve them
+       on its second pass. */
+    emitLine(pThis, "U%u       ldx   #$%02X", unit, index);
+    emitLine(pThis, ":loop    lda   U%u_TAB,x", unit);
+    emitLine(pThis, "         sta   $%04X,x", address);
+    emitLine(pThis, "         dex");
+    emitLine(pThis, "         bpl   :loop");
+    emitLine(pThis, "         jsr   U%u_SUB", unit);
+    emitLine(pThis, "         ADDB  $%02X;$%02X", immediate, zeroPage);
+    emitLine(pThis, "         lda   T%u_%u", part, row);
+    emitLine(pThis, "         beq   U%u_END", unit);
+    emitLine(pThis, "         jmp   U%u_END", unit);
+    emitLine(pThis, "U%u_SUB   ldy   #$%02X", unit, count);
+    emitLine(pThis, "]v       =     0");
+    emitLine(pThis, "         lup   4");
+    emitLine(pThis, "         lda   U%u_TAB+]v", unit);
+    emitLine(pThis, "         sta   $%02X+]v", destination);
+    emitLine(pThis, "]v       =     ]v+1");
+    emitLine(pThis, "         --^");
+    emitLine(pThis, "         rts");
+    emitLine(pThis, "U%u_TAB   hex   %s", unit, table);
+    emitLine(pThis, "         db    $%02X,$%02X,$%02X,$%02X", bytes[0], bytes[1], bytes[2], bytes[3]);
+    emitLine(pThis, "         da    U%u,U%u_SUB", unit, unit);
+    emitLine(pThis, "         asc   \"UNIT%u\"", unit);
+    emitLine(pThis, "U%u_END   rts", unit);
+}
+
+static void generateTables(SourceGenerator* pThis, const char* pWorkDirectory, unsigned int part)
+{
+    char         path[MAX_PATH_LENGTH];
+    char         table[2 * BYTES_PER_TABLE_ROW + 1];
+    unsigned int row;
+    
+    buildPath(path, pWorkDirectory, "tables%u.S", part);
+    pThis->pFile = createFile(path);
+    emitLine(pThis, "* Lookup tables for part %u.", part);
+    for (row = 0 ; row < TABLE_ROWS_PER_PART ; row++)
+    {
+        formatRandomHex(table, BYTES_PER_TABLE_ROW, &pThis->random);
+        emitLine(pThis, "T%u_%u     hex   %s", part, row, table);
+    }
+    closeFile(pThis->pFile, path);
+}
+
+static void formatRandomHex(char* pBuffer, size_t byteCount, unsigned int* pRandom)
+{
+    size_t i;
+    
+    for (i = 0 ; i < byteCount ; i++)
+        sprintf(pBuffer + 2 * i, "%02X", nextRandom(pRandom) & 0xff);
+}
+
+
+static void writeObjectFile(const char* pWorkDirectory, const char* pFilename, size_t size, unsigned int* pRandom);
+static void generateImageScripts(const BenchCommandLine* pCommandLine)
+{
+    const char*  pWorkDirectory = pCommandLine->pWorkDirectory;
+    unsigned int random = RANDOM_SEED;
+    char         path[MAX_PATH_LENGTH];
+    char         objectFilename[64];
+    FILE*        pScript;
+    unsigned int track;
+    unsigned int block;
+    unsigned int i;
+    
+    /* Fill every track of the nibble image, the first tracks with RWTS16 sectors and the rest with RW18 tracks. */
+    buildPath(path, pWorkDirectory, "nib.script");
+    pScript = createFile(path);
+    for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+    {
+        int isRWTS16Track = track < RWTS16_TRACK_COUNT;
+        size_t trackSize = isRWTS16Track ? 16 * DISK_IMAGE_BYTES_PER_SECTOR : DISK_IMAGE_RW18_BYTES_PER_TRACK;
+        
+        snprintf(objectFilename, sizeof(objectFilename), "track%02u.bin", track);
+        writeObjectFile(pWorkDirectory, objectFilename, trackSize, &random);
+        if (isRWTS16Track)
+        {
+            for (i = 0 ; i < 16 ; i++)
+            {
+                fprintf(pScript, "RWTS16,%s/%s,%u,%u,%u,%u\n", pWorkDirectory, objectFilename, 
+                        i * DISK_IMAGE_BYTES_PER_SECTOR, DISK_IMAGE_BYTES_PER_SECTOR, track, i);
+                g_phases[PHASE_NIB_SCRIPT].lines++;
+            }
+        }
+        else
+        {
+            unsigned int chunkSize = DISK_IMAGE_RW18_BYTES_PER_TRACK / RW18_LINES_PER_TRACK;
+            
+            for (i = 0 ; i < RW18_LINES_PER_TRACK ; i++)
+            {
+                fprintf(pScript, "RW18,%s/%s,%u,%u,0x%02x,%u,%u\n", pWorkDirectory, objectFilename, 
+                        i * chunkSize, chunkSize, DISK_IMAGE_RW18_SIDE_0, track, i * chunkSize);
+                g_phases[PHASE_NIB_SCRIPT].lines++;
+            }
+        }
+        g_phases[PHASE_NIB_SCRIPT].bytes += trackSize;
+    }
+    closeFile(pScript, path);
+    
+    /* Fill every block of the 3.5" image, reading each object file for several lines as real scripts do. */
+    buildPath(path, pWorkDirectory, "hdv.script");
+    pScript = createFile(path);
+    for (block = 0 ; block < HDV_BLOCK_COUNT ; block++)
+    {
+        snprintf(objectFilename, sizeof(objectFilename), "blocks%03u.bin", block / BLOCKS_PER_OBJECT);
+        if (block % BLOCKS_PER_OBJECT == 0)
+            writeObjectFile(pWorkDirectory, objectFilename, BLOCKS_PER_OBJECT * DISK_IMAGE_BLOCK_SIZE, &random);
+        fprintf(pScript, "BLOCK,%s/%s,%u,%u,%u\n", pWorkDirectory, objectFilename, 
+                (block % BLOCKS_PER_OBJECT) * DISK_IMAGE_BLOCK_SIZE, DISK_IMAGE_BLOCK_SIZE, block);
+        g_phases[PHASE_HDV_SCRIPT].lines++;
+        g_phases[PHASE_HDV_SCRIPT].bytes += DISK_IMAGE_BLOCK_SIZE;
+    }
+    closeFile(pScript, path);
+}
+
+static void writeObjectFile(const char* pWorkDirectory, const char* pFilename, size_t size, unsigned int* pRandom)
+{
+    char   path[MAX_PATH_LENGTH];
+    FILE*  pFile;
+    size_t i;
+    
+    buildPath(path, pWorkDirectory, "%s", pFilename);
+    pFile = createFile(path);
+    for (i = 0 ; i < size ; i++)
+        fputc(nextRandom(pRandom) & 0xff, pFile);
+    closeFile(pFile, path);
+}
+
+
+static double runAssembler(const BenchCommandLine* pCommandLine, unsigned int source);
+static void recordTime(BenchPhaseId phase, double seconds);
+static void buildImage(const BenchCommandLine* pCommandLine, DiskImage* pDiskImage, const char* pName, 
+                       BenchPhaseId scriptPhase, BenchPhaseId writePhase);
+static MapLookups* createMapLookups(const BenchCommandLine* pCommandLine);
+static void freeMapLookups(MapLookups* pThis);
+static void lookupAddresses(const MapLookups* pThis);
+static void lookupSymbols(const MapLookups* pThis);
+static void importSymbols(const BenchCommandLine* pCommandLine);
+static void runIterations(const BenchCommandLine* pCommandLine)
+{
+    MapLookups*  pMapLookups = createMapLookups(pCommandLine);
+    unsigned int i;
+    unsigned int source;
+    
+    for (i = 0 ; i < pCommandLine->iterations ; i++)
+    {
+        double assemblySeconds = 0.0;
+        
+        g_phases[PHASE_ASSEMBLE].bytes = 0;
+        for (source = 0 ; source < g_sourceCount ; source++)
+            assemblySeconds += runAssembler(pCommandLine, source);
+        recordTime(PHASE_ASSEMBLE, assemblySeconds);
+        buildImage(pCommandLine, (DiskImage*)NibbleDiskImage_Create(), "nib", PHASE_NIB_SCRIPT, PHASE_NIB_WRITE);
+        buildImage(pCommandLine, (DiskImage*)BlockDiskImage_Create(HDV_BLOCK_COUNT), "hdv", 
+                   PHASE_HDV_SCRIPT, PHASE_HDV_WRITE);
+        lookupAddresses(pMapLookups);
+        lookupSymbols(pMapLookups);
+        importSymbols(pCommandLine);
+    }
+    freeMapLookups(pMapLookups);
+}
+
+static double elapsedSeconds(const struct timeval* pStartTime);
+static double runAssembler(const BenchCommandLine* pCommandLine, unsigned int source)
+{
+    Assembler*          pAssembler = NULL;
+    AssemblerInitParams params;
+    BinaryBufferFile    file;
+    struct timeval      startTime;
+    char                path[MAX_PATH_LENGTH];
+    double              seconds = 0.0;
+    
+    /* The output is kept in memory, as crackle --assemble does, so that the time is spent in the assembler rather 
+       than in writing object files. */
+    memset(&params, 0, sizeof(params));
+    params.pPutDirectories = pCommandLine->pWorkDirectory;
+    params.keepOutputInMemory = 1;
+    buildPath(path, pCommandLine->pWorkDirectory, "bench%u.s", source);
+    __try
+    {
+        gettimeofday(&startTime, NULL);
+        pAssembler = Assembler_CreateFromFile(path, &params);
+        Assembler_Run(pAssembler);
+        seconds = elapsedSeconds(&startTime);
+        if (Assembler_GetErrorCount(pAssembler))
+        {
+            fprintf(stderr, "error: Encountered %u error(s) during assembly of %s." LINE_ENDING, 
+                    Assembler_GetErrorCount(pAssembler), path);
+            __throw(invalidArgumentException);
+        }
+        Assembler_OutputFileEnumStart(pAssembler);
+        while (Assembler_OutputFileEnumNext(pAssembler, &file))
+            g_phases[PHASE_ASSEMBLE].bytes += file.contentLength;
+    }
+    __catch
+    {
+        Assembler_Free(pAssembler);
+        __rethrow;
+    }
+    Assembler_Free(pAssembler);
+    
+    return seconds;
+}
+
+static double elapsedSeconds(const struct timeval* pStartTime)
+{
+    struct timeval endTime;
+    
+    gettimeofday(&endTime, NULL);
+    return (double)(endTime.tv_sec - pStartTime->tv_sec) + (double)(endTime.tv_usec - pStartTime->tv_usec) / 1e6;
+}
+
+static void recordTime(BenchPhaseId phase, double seconds)
+{
+    if (g_phases[phase].seconds == 0.0 || seconds < g_phases[phase].seconds)
+        g_phases[phase].seconds = seconds;
+}
+
+static void buildImage(const BenchCommandLine* pCommandLine, DiskImage* pDiskImage, const char* pName, 
+                       BenchPhaseId scriptPhase, BenchPhaseId writePhase)
+{
+    struct timeval startTime;
+    char           scriptPath[MAX_PATH_LENGTH];
+    char           imagePath[MAX_PATH_LENGTH];
+    
+    buildPath(scriptPath, pCommandLine->pWorkDirectory, "%s.script", pName);
+    buildPath(imagePath, pCommandLine->pWorkDirectory, "bench.%s", pName);
+    __try
+    {
+        gettimeofday(&startTime, NULL);
+        DiskImage_ProcessScriptFile(pDiskImage, scriptPath);
+        recordTime(scriptPhase, elapsedSeconds(&startTime));
+        if (DiskImage_GetScriptErrorCount(pDiskImage))
+            __throw(invalidArgumentException);
+        
+        gettimeofday(&startTime, NULL);
+        DiskImage_WriteImage(pDiskImage, imagePath);
+        recordTime(writePhase, elapsedSeconds(&startTime));
+        g_phases[writePhase].bytes = DiskImage_GetImageSize(pDiskImage);
+    }
+    __catch
+    {
+        DiskImage_Free(pDiskImage);
+        __rethrow;
+    }
+    DiskImage_Free(pDiskImage);
+}
+
+static void writeDebugMapAndSymbolFile(const BenchCommandLine* pCommandLine, const char* pMapPath);
+static char* readFile(const char* pFilename, size_t* pSize);
+static void pickLookups(MapLookups* pThis);
+static unsigned int randomIndex(unsigned int* pRandom, unsigned int count);
+static MapLookups* createMapLookups(const BenchCommandLine* pCommandLine)
+{
+    MapLookups* pThis = NULL;
+    char        mapPath[MAX_PATH_LENGTH];
+    size_t      mapSize;
+    
+    /* The map of the first source covers a whole assembly, as an emulator would load for a game.  It is read into
+       memory up front so that the lookups are timed without any file I/O.  The symbol file written alongside it is
+       imported by the symbols.import phase. */
+    buildPath(mapPath, pCommandLine->pWorkDirectory, "bench0.map");
+    __try
+    {
+        writeDebugMapAndSymbolFile(pCommandLine, mapPath);
+        pThis = allocateAndZero(sizeof(*pThis));
+        pThis->pData = readFile(mapPath, &mapSize);
+        DebugMapView_Init(&pThis->view, pThis->pData, mapSize);
+        pickLookups(pThis);
+    }
+    __catch
+    {
+        fprintf(stderr, "error: Failed to load %s." LINE_ENDING, mapPath);
+        freeMapLookups(pThis);
+        __rethrow;
+    }
+    
+    return pThis;
+}
+
+static void writeDebugMapAndSymbolFile(const BenchCommandLine* pCommandLine, const char* pMapPath)
+{
+    Assembler*          pAssembler = NULL;
+    AssemblerInitParams params;
+    char                path[MAX_PATH_LENGTH];
+    char                symbolPath[MAX_PATH_LENGTH];
+    
+    buildPath(symbolPath, pCommandLine->pWorkDirectory, "bench0.sym");
+    memset(&params, 0, sizeof(params));
+    params.pPutDirectories = pCommandLine->pWorkDirectory;
+    params.pDebugMapFilename = pMapPath;
+    params.pExportSymbolFilename = symbolPath;
+    params.keepOutputInMemory = 1;
+    buildPath(path, pCommandLine->pWorkDirectory, "bench0.s");
+    __try
+    {
+        pAssembler = Assembler_CreateFromFile(path, &params);
+        Assembler_Run(pAssembler);
+        if (Assembler_GetErrorCount(pAssembler))
+            __throw(invalidArgumentException);
+    }
+    __catch
+    {
+        Assembler_Free(pAssembler);
+        __rethrow;
+    }
+    Assembler_Free(pAssembler);
+}
+
+static void pickLookups(MapLookups* pThis)
+{
+    const DebugMapHeader* pHeader = pThis->view.pHeader;
+    unsigned int          random = RANDOM_SEED;
+    size_t                i;
+    
+    if (pHeader->lineCount == 0 || pHeader->symbolCount == 0)
+        __throw(invalidArgumentException);
+    
+    /* Addresses are picked from within the lines of the map, rather than from all of memory, so that the lookups
+       exercise the search rather than a quick miss. */
+    for (i = 0 ; i < MAP_LOOKUP_COUNT ; i++)
+    {
+        const DebugMapLine* pLine = &pThis->view.pLines[randomIndex(&random, pHeader->lineCount)];
+        
+        pThis->addresses[i] = (unsigned short)(pLine->address + nextRandom(&random) % pLine->size);
+    }
+    for (i = 0 ; i < MAP_LOOKUP_COUNT ; i++)
+    {
+        const DebugMapSymbol* pSymbol = &pThis->view.pSymbols[randomIndex(&random, pHeader->symbolCount)];
+        
+        pThis->pNames[i] = DebugMapView_GetSymbolName(&pThis->view, pSymbol);
+    }
+    g_phases[PHASE_MAP_ADDRESS].lines = MAP_LOOKUP_COUNT;
+    g_phases[PHASE_MAP_SYMBOL].lines = MAP_LOOKUP_COUNT;
+}
+
+static unsigned int randomIndex(unsigned int* pRandom, unsigned int count)
+{
+    /* nextRandom() only returns 15 bits which isn't enough to reach every line of a large map. */
+    unsigned int high = nextRandom(pRandom);
+    unsigned int low = nextRandom(pRandom);
+    
+    return ((high << 15) | low) % count;
+}
+
+static void freeMapLookups(MapLookups* pThis)
+{
+    if (!pThis)
+        return;
+    free(pThis->pData);
+    free(pThis);
+}
+
+static void lookupAddresses(const MapLookups* pThis)
+{
+    struct timeval startTime;
+    unsigned int   found = 0;
+    size_t         i;
+    
+    gettimeofday(&startTime, NULL);
+    for (i = 0 ; i < MAP_LOOKUP_COUNT ; i++)
+        found += DebugMapView_FindAddress(&pThis->view, pThis->addresses[i]) != NULL;
+    recordTime(PHASE_MAP_ADDRESS, elapsedSeconds(&startTime));
+    
+    /* Lines which ORG has placed under later ones can't be found so only a total miss indicates a broken map. */
+    if (found == 0)
+    {
+        fprintf(stderr, "error: No addresses were found in the debug map." LINE_ENDING);
+        __throw(invalidArgumentException);
+    }
+}
+
+static void lookupSymbols(const MapLookups* pThis)
+{
+    struct timeval startTime;
+    unsigned int   found = 0;
+    size_t         i;
+    
+    gettimeofday(&startTime, NULL);
+    for (i = 0 ; i < MAP_LOOKUP_COUNT ; i++)
+        found += DebugMapView_FindSymbol(&pThis->view, pThis->pNames[i]) != NULL;
+    recordTime(PHASE_MAP_SYMBOL, elapsedSeconds(&startTime));
+    
+    if (found != MAP_LOOKUP_COUNT)
+    {
+        fprintf(stderr, "error: Only %u of %u symbols were found in the debug map." LINE_ENDING, 
+                found, MAP_LOOKUP_COUNT);
+        __throw(invalidArgumentException);
+    }
+}
+
+static void importSymbols(const BenchCommandLine* pCommandLine)
+{
+    Assembler*          pAssembler = NULL;
+    AssemblerInitParams params;
+    AssemblerStats      stats;
+    struct timeval      startTime;
+    char                symbolPath[MAX_PATH_LENGTH];
+    
+    /* A module which only imports the labels of a whole assembly so that the time is that of reading the symbol
+       file and adding its symbols. */
+    buildPath(symbolPath, pCommandLine->pWorkDirectory, "bench0.sym");
+    memset(&params, 0, sizeof(params));
+    params.pImportSymbolFilenames = symbolPath;
+    params.keepOutputInMemory = 1;
+    __try
+    {
+        gettimeofday(&startTime, NULL);
+        pAssembler = Assembler_CreateFromString(" nop" LINE_ENDING, &params);
+        Assembler_Run(pAssembler);
+        recordTime(PHASE_SYMBOL_IMPORT, elapsedSeconds(&startTime));
+        if (Assembler_GetErrorCount(pAssembler))
+            __throw(invalidArgumentException);
+        Assembler_GetStats(pAssembler, &stats);
+        g_phases[PHASE_SYMBOL_IMPORT].lines = stats.symbolsImported;
+    }
+    __catch
+    {
+        Assembler_Free(pAssembler);
+        __rethrow;
+    }
+    Assembler_Free(pAssembler);
+}
+
+
+static double perSecond(unsigned int count, double seconds);
+static void printSummary(void)
+{
+    size_t i;
+    
+    for (i = 0 ; i < PHASE_COUNT ; i++)
+    {
+        const BenchPhase* pPhase = &g_phases[i];
+        
+        printf("%-12s %10.3f ms %12.0f lines/sec %14.0f bytes/sec" LINE_ENDING, pPhase->pName, 
+               pPhase->seconds * 1000.0, perSecond(pPhase->lines, pPhase->seconds), 
+               perSecond(pPhase->bytes, pPhase->seconds));
+    }
+}
+
+static double perSecond(unsigned int count, double seconds)
+{
+    /* Clock granularity can make a tiny phase take no measurable time. */
+    if (seconds <= 0.0)
+        return 0.0;
+    return count / seconds;
+}
+
+static void writeReport(const BenchCommandLine* pCommandLine)
+{
+    FILE*  pFile;
+    size_t i;
+    
+    pFile = createFile(pCommandLine->pOutputFilename);
+    fprintf(pFile, "{\n");
+    fprintf(pFile, "    \"lines\": %u,\n", pCommandLine->lines);
+    fprintf(pFile, "    \"iterations\": %u,\n", pCommandLine->iterations);
+    fprintf(pFile, "    \"phases\": [\n");
+    for (i = 0 ; i < PHASE_COUNT ; i++)
+    {
+        const BenchPhase* pPhase = &g_phases[i];
+        
+        fprintf(pFile, "        {\"name\": \"%s\", \"seconds\": %.6f, \"lines\": %u, \"linesPerSecond\": %.0f, "
+                       "\"bytes\": %u, \"bytesPerSecond\": %.0f}%s\n",
+                pPhase->pName, pPhase->seconds, pPhase->lines, perSecond(pPhase->lines, pPhase->seconds),
+                pPhase->bytes, perSecond(pPhase->bytes, pPhase->seconds), i + 1 < PHASE_COUNT ? "," : "");
+    }
+    fprintf(pFile, "    ]\n");
+    fprintf(pFile, "}\n");
+    closeFile(pFile, pCommandLine->pOutputFilename);
+}
+
+
+static int findBaselineSeconds(const char* pBaseline, const char* pPhaseName, double* pSeconds);
+static int compareToBaseline(const BenchCommandLine* pCommandLine)
+{
+    char*  pBaseline = readFile(pCommandLine->pBaselineFilename, NULL);
+    int    returnValue = 0;
+    size_t i;
+    
+    for (i = 0 ; i < PHASE_COUNT ; i++)
+    {
+        const BenchPhase* pPhase = &g_phases[i];
+        double            baselineSeconds;
+        double            percentChange;
+        
+        if (!findBaselineSeconds(pBaseline, pPhase->pName, &baselineSeconds) || baselineSeconds <= 0.0)
+        {
+            printf("%-12s isn't in %s." LINE_ENDING, pPhase->pName, pCommandLine->pBaselineFilename);
+            continue;
+        }
+        percentChange = (pPhase->seconds - baselineSeconds) * 100.0 / baselineSeconds;
+        printf("%-12s %+7.1f%% compared to baseline of %.3f ms." LINE_ENDING, 
+               pPhase->pName, percentChange, baselineSeconds * 1000.0);
+        if (baselineSeconds >= MIN_COMPARED_SECONDS && percentChange > pCommandLine->thresholdPercent)
+        {
+            printf("%-12s is more than %u%% slower than the baseline." LINE_ENDING, 
+                   pPhase->pName, pCommandLine->thresholdPercent);
+            returnValue = 1;
+        }
+    }
+    free(pBaseline);
+    
+    return returnValue;
+}
+
+static char* readFile(const char* pFilename, size_t* pSize)
+{
+    FILE*  pFile = fopen(pFilename, "rb");
+    char*  pText = NULL;
+    long   length;
+    
+    if (!pFile)
+    {
+        fprintf(stderr, "error: Failed to open %s." LINE_ENDING, pFilename);
+        __throw(fileOpenException);
+    }
+    fseek(pFile, 0, SEEK_END);
+    length = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    if (length >= 0)
+        pText = malloc(length + 1);
+    if (!pText || fread(pText, 1, length, pFile) != (size_t)length)
+    {
+        free(pText);
+        fclose(pFile);
+        fprintf(stderr, "error: Failed to read %s." LINE_ENDING, pFilename);
+        __throw(fileException);
+    }
+    pText[length] = '\0';
+    fclose(pFile);
+    if (pSize)
+        *pSize = (size_t)length;
+    
+    return pText;
+}
+
+static int findBaselineSeconds(const char* pBaseline, const char* pPhaseName, double* pSeconds)
+{
+    char        nameField[64];
+    const char* pName;
+    const char* pSecondsField;
+    
+    /* Only the files written by writeReport() need to be understood so the fields are found by name rather than
+       with a full JSON parser. */
+    snprintf(nameField, sizeof(nameField), "\"name\": \"%s\"", pPhaseName);
+    pName = strstr(pBaseline, nameField);
+    if (!pName)
+        return 0;
+    pSecondsField = strstr(pName, "\"seconds\":");
+    if (!pSecondsField)
+        return 0;
+    *pSeconds = strtod(pSecondsField + strlen("\"seconds\":"), NULL);
+    return 1;
+}
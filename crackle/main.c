@@ -15,22 +15,109 @@
 #include "CrackleCommandLine.h"
 #include "NibbleDiskImage.h"
 #include "BlockDiskImage.h"
+#include "SectorDiskImage.h"
+#include "WozDiskImage.h"
+#include "NibbleLoadSimulator.h"
+#include "NibbleImageVerifier.h"
+#include "NibbleImageExtractor.h"
+#include "DiskImageHashes.h"
+#include "Assembler.h"
+#include "TraceLog.h"
+#include "AllocStats.h"
+#include "PerfCounters.h"
+#include "util.h"
 
 
-static DiskImage* allocateDiskImageObject(CrackleCommandLine* pCommandLine);
+/* --diff exits with the same statuses as diff(1). */
+#define DIFF_SAME      0
+#define DIFF_DIFFERENT 1
+#define DIFF_TROUBLE   2
+
+
+static DiskImage* allocateDiskImageObject(CrackleImageFormat imageFormat, CrackleCommandLine* pCommandLine);
+static void setRWTS16Interleave(DiskImage* pDiskImage, CrackleImageFormat imageFormat, CrackleCommandLine* pCommandLine);
+static int isNibbleFormat(CrackleImageFormat imageFormat);
+static DiskImage* findNibbleImage(DiskImage* pDiskImage, DiskImage** ppExtraImages, CrackleCommandLine* pCommandLine);
+static unsigned int simulateLoading(DiskImage* pDiskImage, CrackleCommandLine* pCommandLine);
+static int verifyImage(CrackleCommandLine* pCommandLine);
+static int extractImage(CrackleCommandLine* pCommandLine);
+static void writeHashes(DiskImage* pDiskImage, DiskImage** ppExtraImages, CrackleCommandLine* pCommandLine);
+static int diffImages(CrackleCommandLine* pCommandLine);
+static void assembleSources(DiskImage* pDiskImage, Assembler** ppAssemblers, CrackleCommandLine* pCommandLine);
+static int writeTrace(const char* pTraceFilename);
 int main(int argc, const char** argv)
 {
     int                returnValue = 0;
     DiskImage*         pDiskImage = NULL;
+    DiskImage*         extraImages[CRACKLE_MAX_EXTRA_OUTPUTS];
+    Assembler*         assemblers[CRACKLE_MAX_ASSEMBLY_SOURCES];
     CrackleCommandLine commandLine;
+    unsigned int       i;
 
     memset(&commandLine, 0, sizeof(commandLine));
+    memset(extraImages, 0, sizeof(extraImages));
+    memset(assemblers, 0, sizeof(assemblers));
     __try
     {
         commandLine = CrackleCommandLine_Init(argc-1, argv+1);
-        pDiskImage = allocateDiskImageObject(&commandLine);
-        DiskImage_ProcessScriptFile(pDiskImage, commandLine.pScriptFilename);
-        DiskImage_WriteImage(pDiskImage, commandLine.pOutputImageFilename);
+        if (commandLine.collectAllocStats)
+            AllocStats_Start();
+        if (commandLine.pTraceFilename)
+            TraceLog_Start();
+        if (commandLine.collectPerfCounters && !PerfCounters_Start())
+            fprintf(stderr, "Hardware performance counters are not available so --perf-counters is ignored." LINE_ENDING);
+        if (commandLine.pVerifyImageFilename)
+        {
+            returnValue = verifyImage(&commandLine);
+        }
+        else if (commandLine.pExtractImageFilename)
+        {
+            returnValue = extractImage(&commandLine);
+        }
+        else if (commandLine.pDiffOldFilename)
+        {
+            returnValue = diffImages(&commandLine);
+        }
+        else
+        {
+            pDiskImage = allocateDiskImageObject(commandLine.imageFormat, &commandLine);
+            setRWTS16Interleave(pDiskImage, commandLine.imageFormat, &commandLine);
+            if (commandLine.disablePlanCache)
+                DiskImage_DisablePlanCache(pDiskImage);
+            for (i = 0 ; i < commandLine.extraOutputCount ; i++)
+            {
+                CrackleImageFormat imageFormat = commandLine.extraOutputs[i].imageFormat;
+                
+                extraImages[i] = allocateDiskImageObject(imageFormat, &commandLine);
+                setRWTS16Interleave(extraImages[i], imageFormat, &commandLine);
+                DiskImage_AddMirror(pDiskImage, extraImages[i]);
+            }
+            assembleSources(pDiskImage, assemblers, &commandLine);
+            if (commandLine.updateExistingImage)
+            {
+                DiskImage_UpdateImage(pDiskImage, commandLine.pScriptFilename, commandLine.pOutputImageFilename);
+            }
+            else
+            {
+                DiskImage_ProcessScriptFile(pDiskImage, commandLine.pScriptFilename);
+                DiskImage_WriteImage(pDiskImage, commandLine.pOutputImageFilename);
+                for (i = 0 ; i < commandLine.extraOutputCount ; i++)
+                    DiskImage_WriteImage(extraImages[i], commandLine.extraOutputs[i].pImageFilename);
+            }
+            /* The image is still written so that the errors can be investigated but tools like snapbuild need to
+               know that it isn't complete. */
+            if (DiskImage_GetScriptErrorCount(pDiskImage) > 0)
+                returnValue = 1;
+            if (commandLine.writeHashes)
+                writeHashes(pDiskImage, extraImages, &commandLine);
+            if (commandLine.printLayoutMap)
+                DiskImage_PrintLayoutMap(pDiskImage);
+            if ((commandLine.printRevolutions || commandLine.pLoadSequenceFilename) &&
+                simulateLoading(findNibbleImage(pDiskImage, extraImages, &commandLine), &commandLine) > 0)
+            {
+                returnValue = 1;
+            }
+        }
     }
     __catch
     {
@@ -38,17 +125,256 @@ int main(int argc, const char** argv)
         returnValue = 1;
     }
     
+    if (commandLine.pTraceFilename && !writeTrace(commandLine.pTraceFilename))
+        returnValue = commandLine.pDiffOldFilename ? DIFF_TROUBLE : 1;
+    TraceLog_Free();
+    PerfCounters_Print();
+    PerfCounters_Free();
     DiskImage_Free(pDiskImage);
+    for (i = 0 ; i < CRACKLE_MAX_EXTRA_OUTPUTS ; i++)
+        DiskImage_Free(extraImages[i]);
+    for (i = 0 ; i < CRACKLE_MAX_ASSEMBLY_SOURCES ; i++)
+        Assembler_Free(assemblers[i]);
+    if (AllocStats_IsEnabled())
+    {
+        AllocStats_Stop();
+        AllocStats_Print();
+    }
     
     return returnValue;
 }
 
-static DiskImage* allocateDiskImageObject(CrackleCommandLine* pCommandLine)
+static void assembleSources(DiskImage* pDiskImage, Assembler** ppAssemblers, CrackleCommandLine* pCommandLine)
+{
+    unsigned int i;
+    
+    /* The assemblers own the buffers of their SAV and USR outputs so they are kept until the image has been written. */
+    for (i = 0 ; i < pCommandLine->assemblySourceCount ; i++)
+    {
+        const char*      pSourceFilename = pCommandLine->assemblySources[i];
+        BinaryBufferFile file;
+        unsigned int     errorCount;
+        
+        __try
+        {
+            ppAssemblers[i] = Assembler_CreateFromFile(pSourceFilename, &pCommandLine->assemblerInitParams);
+        }
+        __catch
+        {
+            if (fileOpenException == getExceptionCode())
+                printf("Failed to open %s\n", pSourceFilename);
+            __rethrow;
+        }
+        Assembler_Run(ppAssemblers[i]);
+        errorCount = Assembler_GetErrorCount(ppAssemblers[i]);
+        if (errorCount)
+        {
+            printf("Encountered %u %s during assembly of %s.\n", 
+                   errorCount, errorCount != 1 ? "errors" : "error", pSourceFilename);
+            __throw(invalidArgumentException);
+        }
+        
+        Assembler_OutputFileEnumStart(ppAssemblers[i]);
+        while (Assembler_OutputFileEnumNext(ppAssemblers[i], &file))
+            DiskImage_AddInMemoryObjectFile(pDiskImage, &file);
+    }
+}
+
+static int writeTrace(const char* pTraceFilename)
+{
+    __try
+    {
+        TraceLog_WriteToFile(pTraceFilename);
+    }
+    __catch
+    {
+        printf("Failed to write trace to %s\n", pTraceFilename);
+        __nothrow_and_return(0);
+    }
+    return 1;
+}
+
+static DiskImage* allocateDiskImageObject(CrackleImageFormat imageFormat, CrackleCommandLine* pCommandLine)
 {
-    if (pCommandLine->imageFormat == FORMAT_NIB_5_25)
+    if (imageFormat == FORMAT_NIB_5_25)
         return (DiskImage*) NibbleDiskImage_Create();
-    else if (pCommandLine->imageFormat == FORMAT_HDV_3_5)
+    else if (imageFormat == FORMAT_HDV_3_5)
         return (DiskImage*) BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    else if (imageFormat == FORMAT_HDV)
+        return (DiskImage*) BlockDiskImage_Create(pCommandLine->blockCount);
+    else if (imageFormat == FORMAT_DSK_5_25)
+        return (DiskImage*) SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    else if (imageFormat == FORMAT_PO_5_25)
+        return (DiskImage*) SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    else if (imageFormat == FORMAT_WOZ_5_25)
+        return (DiskImage*) WozDiskImage_Create();
     else
         return NULL;
 }
+
+static void setRWTS16Interleave(DiskImage* pDiskImage, CrackleImageFormat imageFormat, CrackleCommandLine* pCommandLine)
+{
+    if (pCommandLine->hasRWTS16Interleave && isNibbleFormat(imageFormat))
+        NibbleDiskImage_SetRWTS16Interleave((NibbleDiskImage*)pDiskImage, pCommandLine->rwts16Interleave);
+}
+
+static int isNibbleFormat(CrackleImageFormat imageFormat)
+{
+    return imageFormat == FORMAT_NIB_5_25 || imageFormat == FORMAT_WOZ_5_25;
+}
+
+static DiskImage* findNibbleImage(DiskImage* pDiskImage, DiskImage** ppExtraImages, CrackleCommandLine* pCommandLine)
+{
+    unsigned int i;
+    
+    if (isNibbleFormat(pCommandLine->imageFormat))
+        return pDiskImage;
+    for (i = 0 ; i < pCommandLine->extraOutputCount ; i++)
+    {
+        if (isNibbleFormat(pCommandLine->extraOutputs[i].imageFormat))
+            return ppExtraImages[i];
+    }
+    return NULL;
+}
+
+static unsigned int simulateLoading(DiskImage* pDiskImage, CrackleCommandLine* pCommandLine)
+{
+    NibbleLoadSimulator* pSimulator = NULL;
+    NibbleLoadTiming     timing;
+    unsigned int         errorCount = 0;
+    
+    timing.stepMicroseconds = NIBBLE_LOAD_SIMULATOR_DEFAULT_STEP_MICROSECONDS;
+    timing.settleMicroseconds = NIBBLE_LOAD_SIMULATOR_DEFAULT_SETTLE_MICROSECONDS;
+    timing.sectorProcessingMicroseconds = pCommandLine->sectorProcessingTime;
+    __try
+    {
+        pSimulator = NibbleLoadSimulator_Create(DiskImage_GetImagePointer(pDiskImage), &timing);
+        if (pCommandLine->printRevolutions)
+            NibbleLoadSimulator_PrintRWTS16Revolutions(pSimulator);
+        if (pCommandLine->pLoadSequenceFilename)
+        {
+            NibbleLoadSimulator_ProcessSequenceFile(pSimulator, pCommandLine->pLoadSequenceFilename);
+            errorCount = NibbleLoadSimulator_GetErrorCount(pSimulator);
+        }
+    }
+    __catch
+    {
+        NibbleLoadSimulator_Free(pSimulator);
+        __rethrow;
+    }
+    NibbleLoadSimulator_Free(pSimulator);
+    
+    return errorCount;
+}
+
+static int verifyImage(CrackleCommandLine* pCommandLine)
+{
+    NibbleImageVerifier* pVerifier = NULL;
+    unsigned int         errorCount = 0;
+    
+    __try
+    {
+        pVerifier = NibbleImageVerifier_Create(pCommandLine->pVerifyImageFilename);
+        if (pCommandLine->disablePlanCache)
+            NibbleImageVerifier_DisablePlanCache(pVerifier);
+        if (pCommandLine->pScriptFilename)
+            NibbleImageVerifier_ProcessScriptFile(pVerifier, pCommandLine->pScriptFilename);
+        errorCount = NibbleImageVerifier_Verify(pVerifier);
+    }
+    __catch
+    {
+        printf("%s image verification failed.\n", pCommandLine->pVerifyImageFilename);
+        NibbleImageVerifier_Free(pVerifier);
+        __nothrow_and_return(1);
+    }
+    NibbleImageVerifier_Free(pVerifier);
+    
+    return errorCount ? 1 : 0;
+}
+
+static int extractImage(CrackleCommandLine* pCommandLine)
+{
+    NibbleImageExtractor* pExtractor = NULL;
+    unsigned int          errorCount = 0;
+    
+    __try
+    {
+        pExtractor = NibbleImageExtractor_Create(pCommandLine->pExtractImageFilename);
+        if (pCommandLine->imageFormat == FORMAT_DSK_5_25)
+            errorCount = NibbleImageExtractor_WriteSectorImage(pExtractor, SECTOR_DISK_IMAGE_DOS_ORDER, 
+                                                               pCommandLine->pOutputImageFilename);
+        else if (pCommandLine->imageFormat == FORMAT_PO_5_25)
+            errorCount = NibbleImageExtractor_WriteSectorImage(pExtractor, SECTOR_DISK_IMAGE_PRODOS_ORDER, 
+                                                               pCommandLine->pOutputImageFilename);
+        else
+            errorCount = NibbleImageExtractor_WriteTrackFiles(pExtractor, pCommandLine->pOutputImageFilename);
+    }
+    __catch
+    {
+        printf("%s image extraction failed.\n", pCommandLine->pExtractImageFilename);
+        NibbleImageExtractor_Free(pExtractor);
+        __nothrow_and_return(1);
+    }
+    NibbleImageExtractor_Free(pExtractor);
+    
+    return errorCount ? 1 : 0;
+}
+
+static void writeHashes(DiskImage* pDiskImage, DiskImage** ppExtraImages, CrackleCommandLine* pCommandLine)
+{
+    unsigned int i;
+    
+    DiskImage_WriteHashes(pDiskImage, pCommandLine->pOutputImageFilename);
+    for (i = 0 ; i < pCommandLine->extraOutputCount ; i++)
+        DiskImage_WriteHashes(ppExtraImages[i], pCommandLine->extraOutputs[i].pImageFilename);
+}
+
+static DiskImageHashes* readHashes(const char* pFilename, DiskImage* pDiskImage);
+static int hasSuffix(const char* pFilename, const char* pSuffix);
+static int diffImages(CrackleCommandLine* pCommandLine)
+{
+    DiskImage*       pDiskImage = NULL;
+    DiskImageHashes* pOldHashes = NULL;
+    DiskImageHashes* pNewHashes = NULL;
+    size_t           changedCount = 0;
+    
+    __try
+    {
+        pDiskImage = allocateDiskImageObject(pCommandLine->imageFormat, pCommandLine);
+        if (pCommandLine->disablePlanCache)
+            DiskImage_DisablePlanCache(pDiskImage);
+        if (pCommandLine->pScriptFilename)
+            DiskImage_ProcessScriptFile(pDiskImage, pCommandLine->pScriptFilename);
+        pOldHashes = readHashes(pCommandLine->pDiffOldFilename, pDiskImage);
+        pNewHashes = readHashes(pCommandLine->pDiffNewFilename, pDiskImage);
+        changedCount = DiskImageHashes_PrintDiff(pOldHashes, pNewHashes, pCommandLine->pScriptFilename ? pDiskImage : NULL);
+    }
+    __catch
+    {
+        printf("%s and %s image diff failed.\n", pCommandLine->pDiffOldFilename, pCommandLine->pDiffNewFilename);
+        DiskImageHashes_Free(pNewHashes);
+        DiskImageHashes_Free(pOldHashes);
+        DiskImage_Free(pDiskImage);
+        __nothrow_and_return(DIFF_TROUBLE);
+    }
+    DiskImageHashes_Free(pNewHashes);
+    DiskImageHashes_Free(pOldHashes);
+    DiskImage_Free(pDiskImage);
+    
+    return changedCount ? DIFF_DIFFERENT : DIFF_SAME;
+}
+
+static DiskImageHashes* readHashes(const char* pFilename, DiskImage* pDiskImage)
+{
+    if (hasSuffix(pFilename, DISK_IMAGE_HASHES_SUFFIX))
+        return DiskImageHashes_CreateFromFile(pFilename);
+    return DiskImageHashes_CreateFromImageFile(pFilename, DiskImage_GetHashRegionSize(pDiskImage));
+}
+
+static int hasSuffix(const char* pFilename, const char* pSuffix)
+{
+    size_t filenameLength = strlen(pFilename);
+    size_t suffixLength = strlen(pSuffix);
+    
+    return filenameLength >= suffixLength && 0 == strcasecmp(pFilename + filenameLength - suffixLength, pSuffix);
+}
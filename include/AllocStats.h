@@ -0,0 +1,69 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Counts the allocations, bytes, and live peak for each kind of allocation by chaining onto the malloc hooks which
+   are declared in MallocFailureInject.h.  Allocation sites of interest call AllocStats_SetTag() just before they
+   allocate so that the block can be attributed to them.  This is only a store to a global so it is cheap enough to
+   leave in place when the statistics aren't being collected. */
+#ifndef _ALLOC_STATS_H_
+#define _ALLOC_STATS_H_
+
+#include <stddef.h>
+
+
+typedef enum AllocStatsTag
+{
+    ALLOC_STATS_TAG_OTHER,
+    ALLOC_STATS_TAG_LINE_INFO,
+    ALLOC_STATS_TAG_SYMBOL,
+    ALLOC_STATS_TAG_SYMBOL_LINE_REFERENCE,
+    ALLOC_STATS_TAG_TEXT_FILE,
+    ALLOC_STATS_TAG_MACRO_ARRAYS,
+    ALLOC_STATS_TAG_PARSE_CSV_FIELDS,
+    ALLOC_STATS_TAG_BYTE_BUFFER,
+    ALLOC_STATS_TAG_COUNT
+} AllocStatsTag;
+
+typedef struct AllocStatsEntry
+{
+    const char*        pName;
+    unsigned int       allocations;
+    unsigned long long bytesAllocated;
+    size_t             liveBytes;
+    size_t             peakLiveBytes;
+} AllocStatsEntry;
+
+
+extern AllocStatsTag g_allocStatsNextTag;
+
+/* The tag only applies to the next malloc, calloc, or realloc call.  A realloc without a tag keeps the tag that the
+   block already had. */
+static inline void AllocStats_SetTag(AllocStatsTag tag)
+{
+    g_allocStatsNextTag = tag;
+}
+
+/* Start must be called before anything is allocated and Stop only once everything allocated since has been freed
+   since each tracked block carries a header which the original hooks don't know about. */
+void                   AllocStats_Start(void);
+void                   AllocStats_Stop(void);
+int                    AllocStats_IsEnabled(void);
+
+/* The statistics from the last run remain valid after AllocStats_Stop().  GetEntries returns ALLOC_STATS_TAG_COUNT
+   entries indexed by tag and GetTotals returns a single entry covering all of them. */
+const AllocStatsEntry* AllocStats_GetEntries(void);
+const AllocStatsEntry* AllocStats_GetTotals(void);
+
+/* Prints a table of the tags which saw any allocations followed by the totals. */
+void                   AllocStats_Print(void);
+
+#endif /* _ALLOC_STATS_H_ */
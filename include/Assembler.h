@@ -14,6 +14,7 @@
 #define _ASSEMBLER_H_
 
 #include "try_catch.h"
+#include "BinaryBuffer.h"
 
 
 typedef struct AssemblerInitParams
@@ -21,8 +22,60 @@ typedef struct AssemblerInitParams
     const char* pListFilename;
     const char* pPutDirectories;
     const char* pOutputDirectory;
+    /* Set by tools which run the assembler in process.  SAV and USR output is left in memory for
+       Assembler_OutputFileEnumNext() rather than written to disk and the listing is only produced when pListFilename
+       is set. */
+    int         keepOutputInMemory;
+    /* Set to have Assembler_Run() time each of its phases for Assembler_GetStats().  The counters are always kept 
+       since they are only increments. */
+    int         collectStats;
+    /* Set to have every directive and instruction timed by mnemonic and by addressing mode for
+       Assembler_GetOpcodeProfile() and Assembler_GetAddressingModeProfile(). */
+    int         collectProfile;
+    /* Set to write a debug map of the lines which emitted bytes and of the symbols to this file.  See DebugMap.h for
+       its layout. */
+    const char* pDebugMapFilename;
+    /* Set to skip producing the listing altogether.  pListFilename is ignored. */
+    int         skipListing;
+    /* Set to have each line written to the listing and freed during the first pass as soon as it and all of the lines
+       before it no longer have forward references to be resolved.  The listing is unchanged but only the lines still
+       waiting on a forward reference are kept in memory. */
+    int         streamListing;
+    /* Set to have the symbols of these symbol files (semi-colon separated) defined before the first line is
+       assembled.  See SymbolFile.h for their layout. */
+    const char* pImportSymbolFilenames;
+    /* Set to write the global labels of a successful assembly to this symbol file for other assemblies to import. */
+    const char* pExportSymbolFilename;
 } AssemblerInitParams;
 
+typedef struct AssemblerStats
+{
+    /* Wall time spent in each phase of Assembler_Run().  Left at 0 unless collectStats was set. */
+    unsigned int symbolImportMicroseconds;
+    unsigned int firstPassMicroseconds;
+    unsigned int undefinedSymbolCheckMicroseconds;
+    unsigned int openConditionalCheckMicroseconds;
+    unsigned int secondPassMicroseconds;
+    /* Includes the lines expanded from macros and LUPs. */
+    unsigned int linesParsed;
+    unsigned int linesSkipped;
+    unsigned int macroExpansions;
+    unsigned int lupIterations;
+    unsigned int forwardReferenceFixups;
+    unsigned int symbolsImported;
+    unsigned int symbolCount;
+    unsigned int maxSymbolChainLength;
+    unsigned int bytesEmitted;
+    unsigned int filesOpened;
+} AssemblerStats;
+
+typedef struct AssemblerProfileEntry
+{
+    const char*        pName;
+    unsigned int       calls;
+    unsigned long long nanoseconds;
+} AssemblerProfileEntry;
+
 typedef struct Assembler Assembler;
 
 
@@ -33,6 +86,16 @@ __throws Assembler* Assembler_CreateFromFile(const char* pSourceFilename, const
          void       Assembler_Run(Assembler* pThis);
          unsigned int Assembler_GetErrorCount(Assembler* pThis);
          unsigned int Assembler_GetWarningCount(Assembler* pThis);
+         void       Assembler_GetStats(Assembler* pThis, AssemblerStats* pStats);
+
+/* Only the entries which were called are returned, sorted so that the one which took the most time is first.  The
+   returned array remains valid until the next call or Assembler_Free(). */
+__throws const AssemblerProfileEntry* Assembler_GetOpcodeProfile(Assembler* pThis, size_t* pEntryCount);
+         const AssemblerProfileEntry* Assembler_GetAddressingModeProfile(Assembler* pThis, size_t* pEntryCount);
+
+/* The content of enumerated files points into the assembler's object buffer and remains valid until Assembler_Free(). */
+         void       Assembler_OutputFileEnumStart(Assembler* pThis);
+         int        Assembler_OutputFileEnumNext(Assembler* pThis, BinaryBufferFile* pFile);
 
 
 #endif /* _ASSEMBLER_H_ */
@@ -38,6 +38,17 @@ typedef struct RW18SavFileHeader
 } RW18SavFileHeader;
 
 
+/* A queued SAV or USR write.  Only the header matching the type of write is set, the other is NULL. */
+typedef struct BinaryBufferFile
+{
+    const char*              pFilename;
+    const unsigned char*     pContent;
+    size_t                   contentLength;
+    const SavFileHeader*     pSavHeader;
+    const RW18SavFileHeader* pRW18Header;
+} BinaryBufferFile;
+
+
 typedef struct BinaryBuffer BinaryBuffer;
 
 
@@ -47,6 +58,7 @@ __throws BinaryBuffer* BinaryBuffer_Create(size_t bufferSize);
 __throws unsigned char* BinaryBuffer_Alloc(BinaryBuffer* pThis, size_t bytesToAllocate);
 __throws unsigned char* BinaryBuffer_Realloc(BinaryBuffer* pThis, unsigned char* pToRealloc, size_t bytesToAllocate);
          void           BinaryBuffer_FailAllocation(BinaryBuffer* pThis, size_t allocationToFail);
+         size_t         BinaryBuffer_GetAllocatedSize(BinaryBuffer* pThis);
          
          void           BinaryBuffer_SetOrigin(BinaryBuffer* pThis, unsigned short origin);
          unsigned short BinaryBuffer_GetOrigin(BinaryBuffer* pThis);
@@ -62,5 +74,7 @@ __throws void           BinaryBuffer_QueueRW18WriteToFile(BinaryBuffer*  pThis,
                                                           unsigned short track,
                                                           unsigned short offset);
 __throws void           BinaryBuffer_ProcessWriteFileQueue(BinaryBuffer* pThis);
+         void           BinaryBuffer_WriteFileQueueEnumStart(BinaryBuffer* pThis);
+         int            BinaryBuffer_WriteFileQueueEnumNext(BinaryBuffer* pThis, BinaryBufferFile* pFile);
 
 #endif /* _BINARY_BUFFER_H_ */
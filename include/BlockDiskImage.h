@@ -19,6 +19,7 @@
 
 #define BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT    1600
 #define BLOCK_DISK_IMAGE_3_5_DISK_SIZE      (DISK_IMAGE_BLOCK_SIZE * BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT)
+#define BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT    65535
 
 
 typedef struct BlockDiskImage BlockDiskImage;
@@ -36,6 +37,8 @@ __throws void            BlockDiskImage_InsertData(BlockDiskImage*      pThis,
                                                    DiskImageInsert*     pInsert);
                                                    
 __throws void            BlockDiskImage_WriteImage(BlockDiskImage* pThis, const char* pImageFilename);
+__throws void            BlockDiskImage_UpdateImage(BlockDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename);
+         void            BlockDiskImage_PrintLayoutMap(BlockDiskImage* pThis);
          
          const unsigned char* BlockDiskImage_GetImagePointer(BlockDiskImage* pThis);
          size_t               BlockDiskImage_GetImageSize(BlockDiskImage* pThis);
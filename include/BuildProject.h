@@ -0,0 +1,85 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Dependency graph of the snap assemblies and crackle images listed in a snapbuild project file. */
+#ifndef _BUILD_PROJECT_H_
+#define _BUILD_PROJECT_H_
+
+#include <stddef.h>
+#include "try_catch.h"
+
+
+#define BUILD_PROJECT_STATE_SUFFIX ".state"
+
+
+typedef enum BuildNodeType
+{
+    BUILD_NODE_ASSEMBLE,
+    BUILD_NODE_IMAGE
+} BuildNodeType;
+
+typedef enum BuildNodeStatus
+{
+    BUILD_NODE_PENDING = 0,
+    BUILD_NODE_RUNNING,
+    BUILD_NODE_BUILT,
+    BUILD_NODE_UP_TO_DATE,
+    BUILD_NODE_FAILED,
+    BUILD_NODE_BLOCKED
+} BuildNodeStatus;
+
+typedef struct BuildNode
+{
+    BuildNodeType   type;
+    /* Source filename of an assembly or image filename of an image. */
+    const char*     pName;
+    /* Only set for images. */
+    const char*     pImageFormat;
+    const char*     pScriptFilename;
+    /* The source or script is always the first input.  Image inputs also include each object file its script names. */
+    const char**    ppInputs;
+    size_t          inputCount;
+    const char**    ppOutputs;
+    size_t          outputCount;
+    BuildNodeStatus status;
+    unsigned int    milliseconds;
+} BuildNode;
+
+/* Runs the nodes which are out of date.  startNode() shouldn't wait for the node to finish and waitForNode() returns
+   the next of the started nodes to finish. */
+typedef struct BuildRunner
+{
+    void       (*startNode)(void* pContext, BuildNode* pNode);
+    BuildNode* (*waitForNode)(void* pContext, int* pSucceeded, unsigned int* pMilliseconds);
+    void*      pContext;
+} BuildRunner;
+
+
+typedef struct BuildProject BuildProject;
+
+
+__throws BuildProject* BuildProject_CreateFromFile(const char* pProjectFilename);
+__throws BuildProject* BuildProject_CreateFromString(const char* pProjectText);
+         void          BuildProject_Free(BuildProject* pThis);
+
+         size_t        BuildProject_GetNodeCount(BuildProject* pThis);
+         BuildNode*    BuildProject_GetNode(BuildProject* pThis, size_t index);
+
+/* Returns the number of nodes which failed.  pStateFilename records the hashes used to skip up to date nodes on the
+   next run and can be NULL to always run every node. */
+__throws unsigned int  BuildProject_Run(BuildProject* pThis, 
+                                        BuildRunner*  pRunner, 
+                                        unsigned int  maxJobs, 
+                                        const char*   pStateFilename);
+         void          BuildProject_PrintCriticalPath(BuildProject* pThis);
+
+#endif /* _BUILD_PROJECT_H_ */
@@ -14,21 +14,60 @@
 #define _CRACKLE_COMMANDLINE_H_
 
 #include "try_catch.h"
+#include "NibbleDiskImage.h"
+#include "BlockDiskImage.h"
+#include "Assembler.h"
 
 
 typedef enum CrackleImageFormat
 {
     FORMAT_UNKNOWN = 0,
     FORMAT_NIB_5_25,
-    FORMAT_HDV_3_5
+    FORMAT_HDV_3_5,
+    FORMAT_DSK_5_25,
+    FORMAT_PO_5_25,
+    FORMAT_WOZ_5_25,
+    FORMAT_HDV
 } CrackleImageFormat;
 
 
+#define CRACKLE_MAX_EXTRA_OUTPUTS 4
+#define CRACKLE_MAX_ASSEMBLY_SOURCES 16
+
+typedef struct CrackleOutputImage
+{
+    const char*        pImageFilename;
+    CrackleImageFormat imageFormat;
+} CrackleOutputImage;
+
+
 typedef struct CrackleCommandLine
 {
     const char*        pScriptFilename;
     const char*        pOutputImageFilename;
+    const char*        pVerifyImageFilename;
+    const char*        pExtractImageFilename;
+    const char*        pDiffOldFilename;
+    const char*        pDiffNewFilename;
     CrackleImageFormat imageFormat;
+    int                updateExistingImage;
+    int                disablePlanCache;
+    int                printLayoutMap;
+    int                writeHashes;
+    const char*        pLoadSequenceFilename;
+    const char*        pTraceFilename;
+    int                collectAllocStats;
+    int                collectPerfCounters;
+    unsigned char      rwts16Interleave[NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK];
+    int                hasRWTS16Interleave;
+    int                printRevolutions;
+    unsigned int       sectorProcessingTime;
+    unsigned int       blockCount;
+    CrackleOutputImage extraOutputs[CRACKLE_MAX_EXTRA_OUTPUTS];
+    unsigned int       extraOutputCount;
+    const char*        assemblySources[CRACKLE_MAX_ASSEMBLY_SOURCES];
+    unsigned int       assemblySourceCount;
+    AssemblerInitParams assemblerInitParams;
 } CrackleCommandLine;
 
 
@@ -0,0 +1,24 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Standard CRC-32 (IEEE 802.3 polynomial, as used by zip and WOZ disk images) computed 8 bytes at a time. */
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/* Pass 0 as crc for the first buffer and the previous result to continue a CRC across several buffers. */
+uint32_t Crc32_Buffer(const void* pBuffer, size_t bufferSize, uint32_t crc);
+
+#endif /* _CRC32_H_ */
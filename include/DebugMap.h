@@ -0,0 +1,113 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* A debug map lets an emulator or other tool go from an address to the source line which produced it, and from a
+   symbol name to its value, without parsing the listing.  The file is laid out so that it can be mapped straight
+   into memory and searched in place:
+
+       DebugMapHeader
+       DebugMapLine[lineCount]        lines which emitted bytes, sorted by address
+       DebugMapSymbol[symbolCount]    sorted by name with strcmp()
+       uint32_t[fileCount]            string table offsets of the source filenames
+       char[stringTableSize]          '\0' terminated filenames and symbol names
+
+   Fields are in the byte order of the machine which wrote the map, little endian on x86 and ARM, and every offset
+   in the header is from the start of the file. */
+#ifndef _DEBUG_MAP_H_
+#define _DEBUG_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Symbol.h"
+#include "try_catch.h"
+
+
+#define DEBUG_MAP_SIGNATURE     "SNAPDMAP"
+#define DEBUG_MAP_VERSION       1
+#define DEBUG_MAP_PAGE_COUNT    256
+#define DEBUG_MAP_NO_SYMBOL     0xFFFFFFFF
+
+
+typedef struct DebugMapHeader
+{
+    char     signature[8];
+    uint32_t version;
+    uint32_t lineCount;
+    uint32_t lineTableOffset;
+    uint32_t symbolCount;
+    uint32_t symbolTableOffset;
+    uint32_t fileCount;
+    uint32_t fileTableOffset;
+    uint32_t stringTableSize;
+    uint32_t stringTableOffset;
+    /* Index of the first line whose address is in or after each 256 byte page.  The extra entry is lineCount. */
+    uint32_t pageIndex[DEBUG_MAP_PAGE_COUNT + 1];
+} DebugMapHeader;
+
+typedef struct DebugMapLine
+{
+    uint16_t address;
+    uint16_t size;
+    uint16_t fileIndex;
+    uint16_t reserved;
+    uint32_t lineNumber;
+    /* Index into the symbol table of the label on this line or DEBUG_MAP_NO_SYMBOL. */
+    uint32_t symbolIndex;
+} DebugMapLine;
+
+typedef struct DebugMapSymbol
+{
+    uint32_t nameOffset;
+    uint32_t value;
+} DebugMapSymbol;
+
+/* Fields point into the memory given to DebugMapView_Init() so it must outlive the view. */
+typedef struct DebugMapView
+{
+    const DebugMapHeader* pHeader;
+    const DebugMapLine*   pLines;
+    const DebugMapSymbol* pSymbols;
+    const uint32_t*       pFileTable;
+    const char*           pStrings;
+} DebugMapView;
+
+typedef struct DebugMap DebugMap;
+
+
+/* Collects lines and symbols as the assembler finishes with them and sorts them into the file layout on write. */
+__throws DebugMap*             DebugMap_Create(void);
+         void                  DebugMap_Free(DebugMap* pThis);
+
+/* pSymbol is the label defined on the line or NULL.  It is only kept in the map if it is also passed to
+   DebugMap_AddSymbol(). */
+__throws void                  DebugMap_AddLine(DebugMap* pThis, unsigned short address, size_t size,
+                                                const char* pFilename, unsigned int lineNumber, const Symbol* pSymbol);
+__throws void                  DebugMap_AddSymbol(DebugMap* pThis, const Symbol* pSymbol);
+__throws void                  DebugMap_WriteToFile(DebugMap* pThis, const char* pFilename);
+
+/* Validates the header and that every table fits within dataSize.  Offsets within the tables are only checked as
+   they are used so that opening a large map costs nothing more than the header. */
+__throws void                  DebugMapView_Init(DebugMapView* pThis, const void* pData, size_t dataSize);
+/* Returns the line whose bytes contain address or NULL.  Where ORG has placed lines over each other, only the last
+   line to start at or below address is checked. */
+         const DebugMapLine*   DebugMapView_FindAddress(const DebugMapView* pThis, unsigned short address);
+         const DebugMapSymbol* DebugMapView_FindSymbol(const DebugMapView* pThis, const char* pName);
+         const char*           DebugMapView_GetFilename(const DebugMapView* pThis, const DebugMapLine* pLine);
+/* Returns NULL when the line has no label. */
+         const DebugMapSymbol* DebugMapView_GetLineSymbol(const DebugMapView* pThis, const DebugMapLine* pLine);
+         const char*           DebugMapView_GetSymbolName(const DebugMapView* pThis, const DebugMapSymbol* pSymbol);
+/* Prints one line for each query, an address such as $0803 or 0x803 or else a symbol name, and returns how many of
+   them weren't found. */
+         unsigned int          DebugMapView_PrintQueries(const DebugMapView* pThis, const char** ppQueries, 
+                                                         size_t queryCount);
+
+#endif /* _DEBUG_MAP_H_ */
@@ -14,6 +14,7 @@
 #define _DISK_IMAGE_H_
 
 #include "try_catch.h"
+#include "BinaryBuffer.h"
 
 
 #define DISK_IMAGE_BYTES_PER_SECTOR       256
@@ -69,16 +70,47 @@ typedef struct DiskImageInsert
 
          void      DiskImage_Free(DiskImage* pThis);
 
+/* Mirror images are handed every insertion made into this image, encoded in their own format, so that several image
+   formats can be built from a single pass over the script and its object files.  The caller still owns and frees the
+   mirror images. */
+         void      DiskImage_AddMirror(DiskImage* pThis, DiskImage* pMirror);
+/* Script lines whose object filename matches pFile->pFilename insert its content, such as the output of an in process
+   assembly, instead of reading the object file from disk.  The filename and content aren't copied so they must remain
+   valid until the image is freed. */
+__throws void      DiskImage_AddInMemoryObjectFile(DiskImage* pThis, const BinaryBufferFile* pFile);
+
+/* Stops DiskImage_ProcessScriptFile() from loading or saving the compiled plan that is otherwise cached in a .plan
+   file beside the script. */
+         void      DiskImage_DisablePlanCache(DiskImage* pThis);
 __throws void      DiskImage_ProcessScriptFile(DiskImage* pThis, const char*  pScriptFilename);
 __throws void      DiskImage_ProcessScript(DiskImage* pThis, char* pScriptText);
+/* Number of errors reported against the lines of the last script processed. */
+         unsigned int DiskImage_GetScriptErrorCount(DiskImage* pThis);
 
 __throws void      DiskImage_ReadObjectFile(DiskImage* pThis, const char* pFilename);
 __throws void      DiskImage_UpdateImageTableFile(DiskImage* pThis, unsigned short newImageTableAddress);
+/* Replaces the object data selected by pInsert with its LzCompressor encoding and updates pInsert to select all of
+   the compressed data instead. */
+__throws void      DiskImage_CompressObjectFile(DiskImage* pThis, DiskImageInsert* pInsert);
 __throws void      DiskImage_InsertObjectFile(DiskImage* pThis, DiskImageInsert* pInsert);
 
 __throws void      DiskImage_WriteImage(DiskImage* pThis, const char* pImageFilename);
+__throws void      DiskImage_ReadImage(DiskImage* pThis, const char* pImageFilename);
+__throws void      DiskImage_UpdateImage(DiskImage* pThis, const char* pScriptFilename, const char* pImageFilename);
+         void      DiskImage_PrintLayoutMap(DiskImage* pThis);
 
          unsigned char* DiskImage_GetImagePointer(DiskImage* pThis);
          size_t         DiskImage_GetImageSize(DiskImage* pThis);
 
+/* Images are hashed in regions which match how they are written to a drive or emulator: one region per track for 5
+   1/4" images and one per block for the rest. */
+         unsigned int   DiskImage_GetHashRegionSize(DiskImage* pThis);
+__throws void           DiskImage_WriteHashes(DiskImage* pThis, const char* pImageFilename);
+/* Returns the number of script lines whose insertions wrote into the given hash region and fills in the lowest
+   maxLineNumbers of them in ascending order. */
+         size_t         DiskImage_GetRegionLineNumbers(DiskImage*    pThis, 
+                                                       size_t        region, 
+                                                       unsigned int* pLineNumbers, 
+                                                       size_t        maxLineNumbers);
+
 #endif /* _DISK_IMAGE_H_ */
@@ -0,0 +1,44 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Per-region hashes of a disk image, used to find the tracks or blocks which changed between two builds. */
+#ifndef _DISK_IMAGE_HASHES_H_
+#define _DISK_IMAGE_HASHES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "try_catch.h"
+#include "DiskImage.h"
+
+
+#define DISK_IMAGE_HASHES_SUFFIX ".hashes"
+
+
+typedef struct DiskImageHashes DiskImageHashes;
+
+
+__throws DiskImageHashes* DiskImageHashes_Create(const unsigned char* pImage, size_t imageSize, unsigned int regionSize);
+__throws DiskImageHashes* DiskImageHashes_CreateFromImageFile(const char* pImageFilename, unsigned int regionSize);
+__throws DiskImageHashes* DiskImageHashes_CreateFromFile(const char* pFilename);
+         void             DiskImageHashes_Free(DiskImageHashes* pThis);
+
+         unsigned int     DiskImageHashes_GetRegionSize(DiskImageHashes* pThis);
+         size_t           DiskImageHashes_GetRegionCount(DiskImageHashes* pThis);
+         uint64_t         DiskImageHashes_GetHash(DiskImageHashes* pThis, size_t region);
+
+__throws void             DiskImageHashes_WriteToFile(DiskImageHashes* pThis, const char* pFilename);
+
+/* Prints each region whose hash differs between pOld and pNew, along with the lines of the script last processed by
+   pScriptImage which wrote into it.  pScriptImage can be NULL.  Returns the number of changed regions. */
+__throws size_t           DiskImageHashes_PrintDiff(DiskImageHashes* pOld, DiskImageHashes* pNew, DiskImage* pScriptImage);
+
+#endif /* _DISK_IMAGE_HASHES_H_ */
@@ -0,0 +1,58 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Index of the destination ranges written into a disk image, used to find overlapping writes and free space. */
+#ifndef _DISK_IMAGE_LAYOUT_H_
+#define _DISK_IMAGE_LAYOUT_H_
+
+#include <stddef.h>
+#include "try_catch.h"
+
+
+/* Destination range [start, end) within an address space (domain) of the image.  Each image type decides what its
+   domains are.  Block images use a single domain of image byte offsets for example.  Overlapping extents which share
+   a non-zero group are parts of one claim made by several insertions and aren't reported as overlaps. */
+typedef struct DiskImageExtent
+{
+    unsigned int domain;
+    unsigned int start;
+    unsigned int end;
+    unsigned int lineNumber;
+    unsigned int group;
+} DiskImageExtent;
+
+typedef void (*DiskImageLayoutOverlapCallback)(void*                  pContext, 
+                                               const DiskImageExtent* pEarlier, 
+                                               const DiskImageExtent* pLater);
+
+typedef struct DiskImageLayout DiskImageLayout;
+
+
+__throws DiskImageLayout*       DiskImageLayout_Create(void);
+         void                   DiskImageLayout_Free(DiskImageLayout* pThis);
+
+__throws void                   DiskImageLayout_Add(DiskImageLayout* pThis, const DiskImageExtent* pExtent);
+         void                   DiskImageLayout_Clear(DiskImageLayout* pThis);
+         size_t                 DiskImageLayout_GetExtentCount(DiskImageLayout* pThis);
+
+/* Sorts the extents by domain and start offset.  DiskImageLayout_GetExtent() returns them in this order afterwards. */
+         void                   DiskImageLayout_Sort(DiskImageLayout* pThis);
+         const DiskImageExtent* DiskImageLayout_GetExtent(DiskImageLayout* pThis, size_t index);
+
+/* Calls pCallback once for each pair of overlapping extents.  The time taken is O(n log n) plus the number of
+   overlapping pairs.  pEarlier is the extent of the pair with the lower line number.  Returns the number of pairs
+   found. */
+         size_t                 DiskImageLayout_FindOverlaps(DiskImageLayout*               pThis, 
+                                                             DiskImageLayoutOverlapCallback pCallback, 
+                                                             void*                          pContext);
+
+#endif /* _DISK_IMAGE_LAYOUT_H_ */
@@ -0,0 +1,43 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Sidecar file which records a hash of the inputs for each insertion made into a disk image by a crackle script. */
+#ifndef _DISK_IMAGE_MANIFEST_H_
+#define _DISK_IMAGE_MANIFEST_H_
+
+#include <stdint.h>
+#include "try_catch.h"
+
+
+#define DISK_IMAGE_MANIFEST_SUFFIX ".manifest"
+
+
+typedef struct DiskImageManifestEntry
+{
+    uint64_t destinationHash;
+    uint64_t contentHash;
+} DiskImageManifestEntry;
+
+typedef struct DiskImageManifest DiskImageManifest;
+
+
+__throws DiskImageManifest* DiskImageManifest_Create(void);
+__throws DiskImageManifest* DiskImageManifest_CreateFromFile(const char* pFilename);
+         void               DiskImageManifest_Free(DiskImageManifest* pThis);
+
+__throws void               DiskImageManifest_Append(DiskImageManifest* pThis, const DiskImageManifestEntry* pEntry);
+         size_t             DiskImageManifest_GetEntryCount(DiskImageManifest* pThis);
+         const DiskImageManifestEntry* DiskImageManifest_GetEntry(DiskImageManifest* pThis, size_t index);
+
+__throws void               DiskImageManifest_WriteToFile(DiskImageManifest* pThis, const char* pFilename);
+
+#endif /* _DISK_IMAGE_MANIFEST_H_ */
@@ -0,0 +1,63 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Validated list of insertions compiled from a crackle script which can be executed without reparsing the text. */
+#ifndef _DISK_IMAGE_PLAN_H_
+#define _DISK_IMAGE_PLAN_H_
+
+#include <stdint.h>
+#include "try_catch.h"
+#include "DiskImage.h"
+#include "SizedString.h"
+
+
+#define DISK_IMAGE_PLAN_SUFFIX ".plan"
+
+#define DISK_IMAGE_PLAN_NO_OBJECT           0xFFFFFFFF
+
+/* Bits for DiskImagePlanEntry::flags which indicate the script used '*' for a field so that its value must be
+   resolved from the object file or previous insertion when the plan is executed. */
+#define DISK_IMAGE_PLAN_DEFAULT_LENGTH      (1 << 0)
+#define DISK_IMAGE_PLAN_DEFAULT_BLOCK       (1 << 1)
+#define DISK_IMAGE_PLAN_DEFAULT_SIDE        (1 << 2)
+#define DISK_IMAGE_PLAN_DEFAULT_TRACK       (1 << 3)
+#define DISK_IMAGE_PLAN_DEFAULT_OFFSET      (1 << 4)
+#define DISK_IMAGE_PLAN_HAS_IMAGE_TABLE     (1 << 5)
+/* The script ended the line with LZ so the object data is compressed before it is inserted. */
+#define DISK_IMAGE_PLAN_COMPRESS            (1 << 6)
+
+
+typedef struct DiskImagePlanEntry
+{
+    DiskImageInsert insert;
+    unsigned int    lineNumber;
+    unsigned int    objectFilenameOffset;
+    unsigned int    imageTableAddress;
+    unsigned int    flags;
+} DiskImagePlanEntry;
+
+typedef struct DiskImagePlan DiskImagePlan;
+
+
+__throws DiskImagePlan*   DiskImagePlan_Create(void);
+__throws DiskImagePlan*   DiskImagePlan_CreateFromFile(const char* pFilename, uint64_t scriptHash);
+         void             DiskImagePlan_Free(DiskImagePlan* pThis);
+
+__throws unsigned int     DiskImagePlan_AddObjectFilename(DiskImagePlan* pThis, const SizedString* pFilename);
+__throws void             DiskImagePlan_Append(DiskImagePlan* pThis, const DiskImagePlanEntry* pEntry);
+         size_t           DiskImagePlan_GetEntryCount(DiskImagePlan* pThis);
+         const DiskImagePlanEntry* DiskImagePlan_GetEntry(DiskImagePlan* pThis, size_t index);
+         const char*      DiskImagePlan_GetObjectFilename(DiskImagePlan* pThis, const DiskImagePlanEntry* pEntry);
+
+__throws void             DiskImagePlan_WriteToFile(DiskImagePlan* pThis, const char* pFilename, uint64_t scriptHash);
+
+#endif /* _DISK_IMAGE_PLAN_H_ */
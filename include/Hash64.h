@@ -0,0 +1,23 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Fast non-cryptographic 64-bit hash (XXH64 algorithm) used for detecting content changes. */
+#ifndef _HASH64_H_
+#define _HASH64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+uint64_t Hash64_Buffer(const void* pBuffer, size_t bufferSize, uint64_t seed);
+
+#endif /* _HASH64_H_ */
@@ -49,6 +49,8 @@ struct LineInfo
     int                     indentation;
     unsigned int            lineNumber;
     unsigned int            flags;
+    /* Number of symbols which still have this line in their list of lines to update once they are defined. */
+    unsigned int            forwardReferenceCount;
     unsigned short          address;
     uint32_t                equValue;
 };
@@ -25,5 +25,7 @@ __throws ListFile* ListFile_Create(FILE* pOutputFile);
          void      ListFile_Free(ListFile* pThis);
          
          void      ListFile_OutputLine(ListFile* pThis, LineInfo* pLineInfo);
+/* Pushes the buffered listing out so that it isn't reordered with any errors which are reported after it. */
+         void      ListFile_Flush(ListFile* pThis);
 
 #endif /* _LIST_FILE_H_ */
@@ -0,0 +1,46 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* LZ compression of object data for fast decompression on the 6502 by snap's put/lzdecomp.s.
+
+   The compressed stream is a list of commands, each starting with a command byte:
+     0x00        - End of stream.
+     0x01 - 0x7f - Literal run.  The command byte is followed by that many bytes which are copied to the output.
+     0x80 - 0xff - Match.  (command & 0x7f) + 3 bytes are copied from earlier in the output.  The command byte is
+                   followed by the 16-bit little endian distance back from the current output position to copy from.
+                   The distance can be smaller than the length to repeat a pattern. */
+#ifndef _LZ_COMPRESSOR_H_
+#define _LZ_COMPRESSOR_H_
+
+#include <stddef.h>
+#include "try_catch.h"
+
+
+#define LZ_COMPRESSOR_MAX_LITERALS  127
+#define LZ_COMPRESSOR_MIN_MATCH     3
+#define LZ_COMPRESSOR_MAX_MATCH     (127 + LZ_COMPRESSOR_MIN_MATCH)
+#define LZ_COMPRESSOR_MAX_DISTANCE  0xFFFF
+
+/* Largest compressed size possible for SIZE bytes of input, which is reached when it contains no matches at all. */
+#define LZ_COMPRESSOR_BOUND(SIZE)   ((SIZE) + ((SIZE) + LZ_COMPRESSOR_MAX_LITERALS - 1) / LZ_COMPRESSOR_MAX_LITERALS + 1)
+
+
+__throws size_t LzCompressor_Compress(unsigned char*       pDest, 
+                                      size_t               destSize, 
+                                      const unsigned char* pSrc, 
+                                      size_t               srcSize);
+__throws size_t LzCompressor_Decompress(unsigned char*       pDest, 
+                                        size_t               destSize, 
+                                        const unsigned char* pSrc, 
+                                        size_t               srcSize);
+
+#endif /* _LZ_COMPRESSOR_H_ */
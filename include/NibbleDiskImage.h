@@ -30,6 +30,10 @@ typedef struct NibbleDiskImage NibbleDiskImage;
 
 __throws NibbleDiskImage* NibbleDiskImage_Create(void);
 
+__throws void             NibbleDiskImage_SetRWTS16Interleave(NibbleDiskImage* pThis, const unsigned char* pPhysicalSectors);
+__throws void             NibbleDiskImage_ValidateRWTS16Interleave(const unsigned char* pPhysicalSectors);
+__throws void             NibbleDiskImage_CalculateRWTS16Skew(unsigned char* pPhysicalSectors, unsigned int skew);
+
 __throws void             NibbleDiskImage_ProcessScriptFile(NibbleDiskImage* pThis, const char* pScriptFilename);
 __throws void             NibbleDiskImage_ProcessScript(NibbleDiskImage* pThis, char* pScriptText);
 __throws void             NibbleDiskImage_ReadObjectFile(NibbleDiskImage* pThis, const char* pFilename);
@@ -39,14 +43,25 @@ __throws void             NibbleDiskImage_InsertData(NibbleDiskImage*     pThis,
                                                      DiskImageInsert*     pInsert);
                                                    
 __throws void             NibbleDiskImage_WriteImage(NibbleDiskImage* pThis, const char* pImageFilename);
+__throws void             NibbleDiskImage_UpdateImage(NibbleDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename);
+         void             NibbleDiskImage_PrintLayoutMap(NibbleDiskImage* pThis);
          
          const unsigned char* NibbleDiskImage_GetImagePointer(NibbleDiskImage* pThis);
          size_t               NibbleDiskImage_GetImageSize(NibbleDiskImage* pThis);
+         int                  NibbleDiskImage_IsSyncNibble(NibbleDiskImage* pThis, unsigned int imageOffset);
 
 __throws void             NibbleDiskImage_ReadRW18Track(NibbleDiskImage* pThis,
                                                         unsigned int track,
                                                         unsigned int side,
                                                         unsigned char* pTrackData,
                                                         size_t trackDataSize);
+/* Returns non-zero and sets *pSide if the track starts with the RW18 track header. */
+         int              NibbleDiskImage_FindRW18Track(NibbleDiskImage* pThis, unsigned int track, unsigned int* pSide);
+/* Returns non-zero if the sector holds the RWTS16CP copy protection nibbles instead of 6&2 encoded data. */
+__throws int              NibbleDiskImage_ReadRWTS16Sector(NibbleDiskImage* pThis,
+                                                           unsigned int track,
+                                                           unsigned int sector,
+                                                           unsigned char* pSectorData,
+                                                           size_t sectorDataSize);
 
 #endif /* _NIBBLE_DISK_IMAGE_H_ */
@@ -0,0 +1,44 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Decodes the RWTS16 sectors and RW18 tracks of a .nib image back into the bytes they hold so that they can be
+   written out as a 140k sector image or as one raw file per track. */
+#ifndef _NIBBLE_IMAGE_EXTRACTOR_H_
+#define _NIBBLE_IMAGE_EXTRACTOR_H_
+
+#include "try_catch.h"
+#include "SectorDiskImage.h"
+
+
+#define NIBBLE_IMAGE_EXTRACTOR_RWTS16_SUFFIX    ".rwts16"
+#define NIBBLE_IMAGE_EXTRACTOR_RW18_SUFFIX      ".rw18"
+
+
+typedef struct NibbleImageExtractor NibbleImageExtractor;
+
+
+__throws NibbleImageExtractor* NibbleImageExtractor_Create(const char* pImageFilename);
+         void                  NibbleImageExtractor_Free(NibbleImageExtractor* pThis);
+
+/* Both return the number of sectors and tracks which couldn't be decoded and so were left out of the output. */
+__throws unsigned int          NibbleImageExtractor_WriteSectorImage(NibbleImageExtractor* pThis, 
+                                                                     SectorDiskImageOrder  order, 
+                                                                     const char*           pImageFilename);
+/* Writes each RWTS16 track as filenamePrefix.tTT.rwts16 with its 16 sectors in sector number order and each RW18
+   track as filenamePrefix.tTT.SS.rw18 where TT is the decimal track number and SS the hexadecimal side. */
+__throws unsigned int          NibbleImageExtractor_WriteTrackFiles(NibbleImageExtractor* pThis, 
+                                                                    const char*           pFilenamePrefix);
+
+         unsigned int          NibbleImageExtractor_GetRWTS16SectorCount(NibbleImageExtractor* pThis);
+         unsigned int          NibbleImageExtractor_GetRW18TrackCount(NibbleImageExtractor* pThis);
+
+#endif /* _NIBBLE_IMAGE_EXTRACTOR_H_ */
@@ -0,0 +1,35 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Decodes every RWTS16 sector and RW18 track found in a .nib image to check its address fields, data fields,
+   epilogs and checksums, optionally comparing the decoded data against what a crackle script would write. */
+#ifndef _NIBBLE_IMAGE_VERIFIER_H_
+#define _NIBBLE_IMAGE_VERIFIER_H_
+
+#include "try_catch.h"
+
+
+typedef struct NibbleImageVerifier NibbleImageVerifier;
+
+
+__throws NibbleImageVerifier* NibbleImageVerifier_Create(const char* pImageFilename);
+         void                 NibbleImageVerifier_Free(NibbleImageVerifier* pThis);
+
+         void                 NibbleImageVerifier_DisablePlanCache(NibbleImageVerifier* pThis);
+__throws void                 NibbleImageVerifier_ProcessScriptFile(NibbleImageVerifier* pThis, 
+                                                                    const char*          pScriptFilename);
+         unsigned int         NibbleImageVerifier_Verify(NibbleImageVerifier* pThis);
+
+         unsigned int         NibbleImageVerifier_GetRWTS16SectorCount(NibbleImageVerifier* pThis);
+         unsigned int         NibbleImageVerifier_GetRW18TrackCount(NibbleImageVerifier* pThis);
+
+#endif /* _NIBBLE_IMAGE_VERIFIER_H_ */
@@ -0,0 +1,72 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Estimates how long a Disk II drive takes to read a sequence of RWTS16 sectors and RW18 tracks by locating the
+   address and data fields in the encoded nibble stream of an image and modelling head stepping and rotation. */
+#ifndef _NIBBLE_LOAD_SIMULATOR_H_
+#define _NIBBLE_LOAD_SIMULATOR_H_
+
+#include "try_catch.h"
+#include "DiskImage.h"
+
+
+/* A Disk II bit cell is 4 microseconds long so each 8-bit nibble takes 32 microseconds to pass under the head. */
+#define NIBBLE_LOAD_SIMULATOR_MICROSECONDS_PER_NIBBLE       32
+
+/* Default timings roughly match the DOS 3.3 RWTS seek delays and the time it takes to post-nibblize a sector. */
+#define NIBBLE_LOAD_SIMULATOR_DEFAULT_STEP_MICROSECONDS     6000
+#define NIBBLE_LOAD_SIMULATOR_DEFAULT_SETTLE_MICROSECONDS   10000
+#define NIBBLE_LOAD_SIMULATOR_DEFAULT_SECTOR_MICROSECONDS   6000
+
+
+typedef struct NibbleLoadTiming
+{
+    unsigned int stepMicroseconds;
+    unsigned int settleMicroseconds;
+    unsigned int sectorProcessingMicroseconds;
+} NibbleLoadTiming;
+
+typedef struct NibbleLoadTrackTime
+{
+    unsigned int stepping;
+    unsigned int latency;
+    unsigned int reading;
+    unsigned int processing;
+} NibbleLoadTrackTime;
+
+typedef struct NibbleLoadSimulator NibbleLoadSimulator;
+
+
+__throws NibbleLoadSimulator*       NibbleLoadSimulator_Create(const unsigned char*    pImage, 
+                                                               const NibbleLoadTiming* pTiming);
+         void                       NibbleLoadSimulator_Free(NibbleLoadSimulator* pThis);
+
+__throws unsigned int               NibbleLoadSimulator_ReadRWTS16Sector(NibbleLoadSimulator* pThis, 
+                                                                         unsigned int         track, 
+                                                                         unsigned int         sector);
+__throws unsigned int               NibbleLoadSimulator_ReadRW18Track(NibbleLoadSimulator* pThis, 
+                                                                      unsigned int         side, 
+                                                                      unsigned int         track);
+__throws void                       NibbleLoadSimulator_ProcessSequenceFile(NibbleLoadSimulator* pThis, 
+                                                                            const char*          pSequenceFilename);
+         void                       NibbleLoadSimulator_PrintTrackBreakdown(NibbleLoadSimulator* pThis);
+
+         unsigned int               NibbleLoadSimulator_CalculateRWTS16TrackTime(NibbleLoadSimulator* pThis, 
+                                                                                 unsigned int         track, 
+                                                                                 unsigned int*        pSectorCount);
+         void                       NibbleLoadSimulator_PrintRWTS16Revolutions(NibbleLoadSimulator* pThis);
+
+         unsigned int               NibbleLoadSimulator_GetElapsedTime(NibbleLoadSimulator* pThis);
+         unsigned int               NibbleLoadSimulator_GetErrorCount(NibbleLoadSimulator* pThis);
+         const NibbleLoadTrackTime* NibbleLoadSimulator_GetTrackTime(NibbleLoadSimulator* pThis, unsigned int track);
+
+#endif /* _NIBBLE_LOAD_SIMULATOR_H_ */
@@ -0,0 +1,34 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Reads the CPU's cycle, instruction, cache miss, and branch miss counters around regions of interest and totals them
+   per region name.  Uses perf_event_open() on Linux.  On other platforms, or when the kernel doesn't allow the
+   counters to be opened, PerfCounters_Start() fails and each Begin and End only tests a flag. */
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+
+/* Returns 1 if at least the cycle counter could be opened.  Counters which the CPU doesn't support are reported as
+   unavailable rather than failing the whole start. */
+int  PerfCounters_Start(void);
+void PerfCounters_Free(void);
+int  PerfCounters_IsEnabled(void);
+
+/* Regions nest with each End closing the most recent Begin.  Every region with the same name is added to the same
+   totals and only the pointer to pRegionName is kept so it should be a string literal. */
+void PerfCounters_Begin(const char* pRegionName);
+void PerfCounters_End(void);
+
+/* Prints the calls, IPC, and misses per call for each region in the order that they were first seen. */
+void PerfCounters_Print(void);
+
+#endif /* _PERF_COUNTERS_H_ */
@@ -0,0 +1,57 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* 140k 5 1/4" disk images stored as 256 byte sectors in either DOS 3.3 (.dsk/.do) or ProDOS (.po) logical order. */
+#ifndef _SECTOR_DISK_IMAGE_H_
+#define _SECTOR_DISK_IMAGE_H_
+
+#include "try_catch.h"
+#include "DiskImage.h"
+
+
+#define SECTOR_DISK_IMAGE_SECTORS_PER_TRACK 16
+#define SECTOR_DISK_IMAGE_BLOCKS_PER_TRACK  (SECTOR_DISK_IMAGE_SECTORS_PER_TRACK / DISK_IMAGE_SECTORS_PER_BLOCK)
+#define SECTOR_DISK_IMAGE_BLOCK_COUNT       (DISK_IMAGE_TRACKS_PER_SIDE * SECTOR_DISK_IMAGE_BLOCKS_PER_TRACK)
+#define SECTOR_DISK_IMAGE_SIZE              (DISK_IMAGE_TRACKS_PER_SIDE * SECTOR_DISK_IMAGE_SECTORS_PER_TRACK * \
+                                             DISK_IMAGE_BYTES_PER_SECTOR)
+
+
+typedef enum SectorDiskImageOrder
+{
+    SECTOR_DISK_IMAGE_DOS_ORDER,
+    SECTOR_DISK_IMAGE_PRODOS_ORDER
+} SectorDiskImageOrder;
+
+typedef struct SectorDiskImage SectorDiskImage;
+
+
+__throws SectorDiskImage* SectorDiskImage_Create(SectorDiskImageOrder order);
+
+__throws void             SectorDiskImage_ProcessScriptFile(SectorDiskImage* pThis, const char* pScriptFilename);
+__throws void             SectorDiskImage_ProcessScript(SectorDiskImage* pThis, char* pScriptText);
+__throws void             SectorDiskImage_ReadObjectFile(SectorDiskImage* pThis, const char* pFilename);
+__throws void             SectorDiskImage_InsertObjectFile(SectorDiskImage* pThis, DiskImageInsert* pInsert);
+__throws void             SectorDiskImage_InsertData(SectorDiskImage*     pThis, 
+                                                     const unsigned char* pData, 
+                                                     DiskImageInsert*     pInsert);
+                                                   
+__throws void             SectorDiskImage_WriteImage(SectorDiskImage* pThis, const char* pImageFilename);
+__throws void             SectorDiskImage_UpdateImage(SectorDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename);
+         void             SectorDiskImage_PrintLayoutMap(SectorDiskImage* pThis);
+         
+         const unsigned char* SectorDiskImage_GetImagePointer(SectorDiskImage* pThis);
+         size_t               SectorDiskImage_GetImageSize(SectorDiskImage* pThis);
+         unsigned int         SectorDiskImage_GetImageOffset(SectorDiskImage* pThis, 
+                                                             unsigned int     track, 
+                                                             unsigned int     physicalSector);
+
+#endif /* _SECTOR_DISK_IMAGE_H_ */
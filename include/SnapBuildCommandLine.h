@@ -0,0 +1,31 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#ifndef _SNAP_BUILD_COMMANDLINE_H_
+#define _SNAP_BUILD_COMMANDLINE_H_
+
+#include "try_catch.h"
+
+
+typedef struct SnapBuildCommandLine
+{
+    const char*  pProjectFilename;
+    const char*  pSnapPath;
+    const char*  pCracklePath;
+    /* 0 when --jobs isn't given so that the tool can pick a default. */
+    unsigned int maxJobs;
+} SnapBuildCommandLine;
+
+
+__throws void SnapBuildCommandLine_Init(SnapBuildCommandLine* pThis, int argc, const char** argv);
+
+#endif /* _SNAP_BUILD_COMMANDLINE_H_ */
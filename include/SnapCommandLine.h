@@ -20,6 +20,9 @@
 typedef struct SnapCommandLine
 {
     const char*         pSourceFilename;
+    const char*         pTraceFilename;
+    int                 collectAllocStats;
+    int                 collectPerfCounters;
     AssemblerInitParams assemblerInitParams;
 } SnapCommandLine;
 
@@ -22,6 +22,10 @@ typedef struct LineInfo LineInfo;
 typedef struct SymbolLineReference SymbolLineReference;
 
 
+/* Bits in the Symbol::flags field. */
+#define SYMBOL_FLAG_IMPORTED 1
+
+
 struct Symbol
 {
     SymbolLineReference* pLineReferences;
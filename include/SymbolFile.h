@@ -0,0 +1,73 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* A symbol file carries the global labels of one assembly into another so that modules can share addresses without
+   each of them PUTting, and parsing, a file of EQUs.  The file is read into memory in a single block and its names
+   are used in place as the keys of the imported symbols:
+
+       SymbolFileHeader
+       SymbolFileSymbol[symbolCount]
+       char[stringTableSize]          '\0' terminated symbol names
+
+   Fields are in the byte order of the machine which wrote the file and every offset in the header is from the start
+   of the file. */
+#ifndef _SYMBOL_FILE_H_
+#define _SYMBOL_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SymbolTable.h"
+#include "try_catch.h"
+
+
+#define SYMBOL_FILE_SIGNATURE   "SNAPSYMS"
+#define SYMBOL_FILE_VERSION     1
+
+
+typedef struct SymbolFileHeader
+{
+    char     signature[8];
+    uint32_t version;
+    uint32_t symbolCount;
+    uint32_t symbolTableOffset;
+    uint32_t stringTableSize;
+    uint32_t stringTableOffset;
+} SymbolFileHeader;
+
+typedef struct SymbolFileSymbol
+{
+    uint32_t nameOffset;
+    uint32_t value;
+    /* The length of the name without its '\0' terminator. */
+    uint16_t nameLength;
+    /* An ExpressionType so that zero page equates still select zero page addressing modes once imported. */
+    uint8_t  type;
+    uint8_t  reserved;
+} SymbolFileSymbol;
+
+typedef struct SymbolFile SymbolFile;
+
+
+/* Writes the global labels of pSymbolTable which were defined by the assembly.  Local labels, ]variables, and the
+   symbols which were themselves imported are left out. */
+__throws void        SymbolFile_Write(SymbolTable* pSymbolTable, const char* pFilename);
+
+/* Reads the whole file and validates the header and every symbol so that they can be used without further checks. */
+__throws SymbolFile* SymbolFile_CreateFromFile(const char* pFilename);
+         void        SymbolFile_Free(SymbolFile* pThis);
+
+         size_t      SymbolFile_GetSymbolCount(SymbolFile* pThis);
+/* The name points into the file's buffer and remains valid until SymbolFile_Free(). */
+         SizedString SymbolFile_GetSymbolName(SymbolFile* pThis, size_t index);
+         Expression  SymbolFile_GetSymbolExpression(SymbolFile* pThis, size_t index);
+
+#endif /* _SYMBOL_FILE_H_ */
@@ -24,6 +24,7 @@ __throws SymbolTable* SymbolTable_Create(size_t bucketCount);
          void         SymbolTable_Free(SymbolTable* pThis);
          
          size_t       SymbolTable_GetSymbolCount(SymbolTable* pThis);
+         size_t       SymbolTable_GetMaxChainLength(SymbolTable* pThis);
 __throws Symbol*      SymbolTable_Add(SymbolTable* pThis, SizedString* pGlobalKey, SizedString* pLocalKey);
          Symbol*      SymbolTable_Find(SymbolTable* pThis, SizedString* pGlobalKey, SizedString* pLocalKey);
          
@@ -0,0 +1,33 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Buffers Chrome trace events in memory and writes them out as a JSON file, viewable in chrome://tracing or Perfetto,
+   once the run is complete.  Until TraceLog_Start() is called, each Begin and End only tests a flag. */
+#ifndef _TRACE_LOG_H_
+#define _TRACE_LOG_H_
+
+#include "try_catch.h"
+
+
+         void TraceLog_Start(void);
+         void TraceLog_Free(void);
+         int  TraceLog_IsEnabled(void);
+
+/* Spans nest with each End closing the most recent Begin.  Only the pointer to pCategory is kept so it should be a
+   string literal.  If memory runs out then recording stops and the trace is truncated at that point. */
+         void TraceLog_Begin(const char* pCategory, const char* pNameFormat, ...);
+         void TraceLog_End(void);
+
+/* Spans which are still open are closed at the time of the last recorded event. */
+__throws void TraceLog_WriteToFile(const char* pFilename);
+
+#endif /* _TRACE_LOG_H_ */
@@ -0,0 +1,54 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* WOZ 2.0 bitstream images for 5 1/4" disks, built from the same nibbles as NibbleDiskImage but with real 10-bit sync
+   bytes. */
+#ifndef _WOZ_DISK_IMAGE_H_
+#define _WOZ_DISK_IMAGE_H_
+
+#include "try_catch.h"
+#include "DiskImage.h"
+
+
+#define WOZ_DISK_IMAGE_HEADER_SIZE      12
+#define WOZ_DISK_IMAGE_INFO_OFFSET      12
+#define WOZ_DISK_IMAGE_TMAP_OFFSET      80
+#define WOZ_DISK_IMAGE_TRKS_OFFSET      248
+#define WOZ_DISK_IMAGE_CHUNK_HEADER     8
+#define WOZ_DISK_IMAGE_QUARTER_TRACKS   160
+#define WOZ_DISK_IMAGE_TRK_ENTRY_SIZE   8
+#define WOZ_DISK_IMAGE_BITS_OFFSET      1536
+#define WOZ_DISK_IMAGE_BLOCK_SIZE       512
+#define WOZ_DISK_IMAGE_NO_TRACK         0xFF
+
+
+typedef struct WozDiskImage WozDiskImage;
+
+
+__throws WozDiskImage* WozDiskImage_Create(void);
+
+__throws void          WozDiskImage_ProcessScriptFile(WozDiskImage* pThis, const char* pScriptFilename);
+__throws void          WozDiskImage_ProcessScript(WozDiskImage* pThis, char* pScriptText);
+__throws void          WozDiskImage_ReadObjectFile(WozDiskImage* pThis, const char* pFilename);
+__throws void          WozDiskImage_InsertObjectFile(WozDiskImage* pThis, DiskImageInsert* pInsert);
+__throws void          WozDiskImage_InsertData(WozDiskImage*        pThis, 
+                                               const unsigned char* pData, 
+                                               DiskImageInsert*     pInsert);
+                                                   
+__throws void          WozDiskImage_WriteImage(WozDiskImage* pThis, const char* pImageFilename);
+__throws void          WozDiskImage_UpdateImage(WozDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename);
+         void          WozDiskImage_PrintLayoutMap(WozDiskImage* pThis);
+         
+         const unsigned char* WozDiskImage_GetNibblePointer(WozDiskImage* pThis);
+         size_t               WozDiskImage_GetNibbleSize(WozDiskImage* pThis);
+
+#endif /* _WOZ_DISK_IMAGE_H_ */
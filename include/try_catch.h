@@ -38,6 +38,7 @@
 #define invalidArgumentCountException       19
 #define encounteredCommentException         20
 #define badTrackException                   21
+#define sectorNotFoundException             22
 
 
 #ifndef __debugbreak
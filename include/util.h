@@ -41,10 +41,10 @@
 
 static inline void* allocateAndZero(size_t size)
 {
-    void* pAlloc = malloc(size);
+    /* calloc() lets the C library hand back large allocations as untouched zero pages rather than writing to them. */
+    void* pAlloc = calloc(1, size);
     if (!pAlloc)
         __throw(outOfMemoryException);
-    memset(pAlloc, 0, size);
     
     return pAlloc;
 }
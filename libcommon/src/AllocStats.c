@@ -0,0 +1,256 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+#include "AllocStats.h"
+#include "AllocStatsTest.h"
+#include "MallocFailureInject.h"
+#include "util.h"
+
+
+/* Each tracked block is prefixed with its size and tag so that free() knows what to subtract.  The union keeps the
+   data which follows aligned for any type. */
+typedef union AllocHeader
+{
+    struct
+    {
+        size_t        size;
+        AllocStatsTag tag;
+    } info;
+    long double alignLongDouble;
+    long long   alignLongLong;
+    void*       alignPointer;
+} AllocHeader;
+
+typedef struct AllocStats
+{
+    void*           (*nextMalloc)(size_t size);
+    void*           (*nextRealloc)(void* ptr, size_t size);
+    void*           (*nextCalloc)(size_t count, size_t size);
+    void            (*nextFree)(void* ptr);
+    AllocStatsEntry entries[ALLOC_STATS_TAG_COUNT];
+    AllocStatsEntry totals;
+    int             isEnabled;
+} AllocStats;
+
+
+AllocStatsTag     g_allocStatsNextTag;
+static AllocStats g_allocStats;
+
+
+static void  initEntryNames(void);
+static void* statsMalloc(size_t size);
+static void* statsRealloc(void* ptr, size_t size);
+static void* statsCalloc(size_t count, size_t size);
+static void  statsFree(void* ptr);
+void AllocStats_Start(void)
+{
+    if (g_allocStats.isEnabled)
+        return;
+    
+    memset(&g_allocStats, 0, sizeof(g_allocStats));
+    initEntryNames();
+    g_allocStats.nextMalloc = hook_malloc;
+    g_allocStats.nextRealloc = hook_realloc;
+    g_allocStats.nextCalloc = hook_calloc;
+    g_allocStats.nextFree = hook_free;
+    hook_malloc = statsMalloc;
+    hook_realloc = statsRealloc;
+    hook_calloc = statsCalloc;
+    hook_free = statsFree;
+    g_allocStatsNextTag = ALLOC_STATS_TAG_OTHER;
+    g_allocStats.isEnabled = 1;
+}
+
+static void initEntryNames(void)
+{
+    static const char* const tagNames[ALLOC_STATS_TAG_COUNT] =
+    {
+        "other",
+        "LineInfo",
+        "Symbol",
+        "SymbolLineReference",
+        "TextFile",
+        "macro arrays",
+        "ParseCSV fields",
+        "ByteBuffer"
+    };
+    size_t i;
+    
+    for (i = 0 ; i < ALLOC_STATS_TAG_COUNT ; i++)
+        g_allocStats.entries[i].pName = tagNames[i];
+    g_allocStats.totals.pName = "total";
+}
+
+static AllocStatsTag takeNextTag(AllocStatsTag defaultTag);
+static void*         recordAllocation(AllocHeader* pHeader, size_t size, AllocStatsTag tag);
+static void* statsMalloc(size_t size)
+{
+    AllocStatsTag tag = takeNextTag(ALLOC_STATS_TAG_OTHER);
+    
+    if (size > (size_t)-1 - sizeof(AllocHeader))
+        return NULL;
+    return recordAllocation(g_allocStats.nextMalloc(sizeof(AllocHeader) + size), size, tag);
+}
+
+static AllocStatsTag takeNextTag(AllocStatsTag defaultTag)
+{
+    AllocStatsTag tag = g_allocStatsNextTag;
+    
+    g_allocStatsNextTag = ALLOC_STATS_TAG_OTHER;
+    return tag != ALLOC_STATS_TAG_OTHER ? tag : defaultTag;
+}
+
+static void addToEntry(AllocStatsEntry* pEntry, size_t size);
+static void* recordAllocation(AllocHeader* pHeader, size_t size, AllocStatsTag tag)
+{
+    if (!pHeader)
+        return NULL;
+    
+    pHeader->info.size = size;
+    pHeader->info.tag = tag;
+    addToEntry(&g_allocStats.entries[tag], size);
+    addToEntry(&g_allocStats.totals, size);
+    
+    return pHeader + 1;
+}
+
+static void addToEntry(AllocStatsEntry* pEntry, size_t size)
+{
+    pEntry->allocations++;
+    pEntry->bytesAllocated += size;
+    pEntry->liveBytes += size;
+    if (pEntry->liveBytes > pEntry->peakLiveBytes)
+        pEntry->peakLiveBytes = pEntry->liveBytes;
+}
+
+static AllocHeader* headerFromPointer(void* ptr);
+static void         recordFree(AllocHeader* pHeader);
+static void* statsRealloc(void* ptr, size_t size)
+{
+    AllocHeader*  pHeader;
+    AllocHeader*  pRealloc;
+    AllocStatsTag tag;
+    
+    if (!ptr)
+        return statsMalloc(size);
+    
+    pHeader = headerFromPointer(ptr);
+    tag = takeNextTag(pHeader->info.tag);
+    if (size > (size_t)-1 - sizeof(AllocHeader))
+        return NULL;
+    pRealloc = g_allocStats.nextRealloc(pHeader, sizeof(AllocHeader) + size);
+    if (!pRealloc)
+        return NULL;
+    
+    /* Only the header's size and tag are read by recordFree() so it is safe to use after the block has moved. */
+    recordFree(pRealloc);
+    return recordAllocation(pRealloc, size, tag);
+}
+
+static AllocHeader* headerFromPointer(void* ptr)
+{
+    return (AllocHeader*)ptr - 1;
+}
+
+static void removeFromEntry(AllocStatsEntry* pEntry, size_t size);
+static void recordFree(AllocHeader* pHeader)
+{
+    removeFromEntry(&g_allocStats.entries[pHeader->info.tag], pHeader->info.size);
+    removeFromEntry(&g_allocStats.totals, pHeader->info.size);
+}
+
+static void removeFromEntry(AllocStatsEntry* pEntry, size_t size)
+{
+    pEntry->liveBytes -= size;
+}
+
+static void* statsCalloc(size_t count, size_t size)
+{
+    AllocStatsTag tag = takeNextTag(ALLOC_STATS_TAG_OTHER);
+    size_t        totalSize = count * size;
+    
+    if (size && totalSize / size != count)
+        return NULL;
+    if (totalSize > (size_t)-1 - sizeof(AllocHeader))
+        return NULL;
+    return recordAllocation(g_allocStats.nextCalloc(1, sizeof(AllocHeader) + totalSize), totalSize, tag);
+}
+
+static void statsFree(void* ptr)
+{
+    AllocHeader* pHeader;
+    
+    if (!ptr)
+        return;
+    pHeader = headerFromPointer(ptr);
+    recordFree(pHeader);
+    g_allocStats.nextFree(pHeader);
+}
+
+
+void AllocStats_Stop(void)
+{
+    if (!g_allocStats.isEnabled)
+        return;
+    
+    hook_malloc = g_allocStats.nextMalloc;
+    hook_realloc = g_allocStats.nextRealloc;
+    hook_calloc = g_allocStats.nextCalloc;
+    hook_free = g_allocStats.nextFree;
+    g_allocStats.isEnabled = 0;
+}
+
+
+int AllocStats_IsEnabled(void)
+{
+    return g_allocStats.isEnabled;
+}
+
+
+const AllocStatsEntry* AllocStats_GetEntries(void)
+{
+    return g_allocStats.entries;
+}
+
+
+const AllocStatsEntry* AllocStats_GetTotals(void)
+{
+    return &g_allocStats.totals;
+}
+
+
+static void printEntry(const AllocStatsEntry* pEntry);
+void AllocStats_Print(void)
+{
+    size_t i;
+    
+    printf("Allocation statistics:" LINE_ENDING
+           "  %-20s %11s %14s %14s %14s" LINE_ENDING,
+           "tag", "allocations", "bytes", "peak bytes", "live bytes");
+    for (i = 0 ; i < ALLOC_STATS_TAG_COUNT ; i++)
+    {
+        if (g_allocStats.entries[i].allocations)
+            printEntry(&g_allocStats.entries[i]);
+    }
+    printEntry(&g_allocStats.totals);
+}
+
+static void printEntry(const AllocStatsEntry* pEntry)
+{
+    printf("  %-20s %11u %14llu %14lu %14lu" LINE_ENDING,
+           pEntry->pName,
+           pEntry->allocations,
+           pEntry->bytesAllocated,
+           (unsigned long)pEntry->peakLiveBytes,
+           (unsigned long)pEntry->liveBytes);
+}
@@ -0,0 +1,79 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include "Crc32.h"
+
+
+#define CRC32_POLYNOMIAL 0xEDB88320
+
+
+/* Slicing-by-8 tables: g_table[0] is the classic byte at a time table and g_table[n] advances a byte's contribution
+   through n more bytes of zeroes so that 8 input bytes can be folded into the CRC with 8 independent lookups. */
+static uint32_t g_table[8][256];
+static int      g_isTableInitialized;
+
+
+static void initTables(void);
+static uint32_t read32(const unsigned char* p);
+uint32_t Crc32_Buffer(const void* pBuffer, size_t bufferSize, uint32_t crc)
+{
+    const unsigned char* pCurr = (const unsigned char*)pBuffer;
+
+    if (!g_isTableInitialized)
+        initTables();
+
+    crc = ~crc;
+    while (bufferSize >= 8)
+    {
+        uint32_t low = read32(pCurr) ^ crc;
+        uint32_t high = read32(pCurr + 4);
+
+        crc = g_table[7][low & 0xFF] ^ g_table[6][(low >> 8) & 0xFF] ^
+              g_table[5][(low >> 16) & 0xFF] ^ g_table[4][low >> 24] ^
+              g_table[3][high & 0xFF] ^ g_table[2][(high >> 8) & 0xFF] ^
+              g_table[1][(high >> 16) & 0xFF] ^ g_table[0][high >> 24];
+        pCurr += 8;
+        bufferSize -= 8;
+    }
+    while (bufferSize-- > 0)
+        crc = (crc >> 8) ^ g_table[0][(crc ^ *pCurr++) & 0xFF];
+
+    return ~crc;
+}
+
+static void initTables(void)
+{
+    uint32_t i;
+    int      slice;
+
+    for (i = 0 ; i < 256 ; i++)
+    {
+        uint32_t crc = i;
+        int      bit;
+
+        for (bit = 0 ; bit < 8 ; bit++)
+            crc = (crc >> 1) ^ (CRC32_POLYNOMIAL & (0 - (crc & 1)));
+        g_table[0][i] = crc;
+    }
+    for (slice = 1 ; slice < 8 ; slice++)
+    {
+        for (i = 0 ; i < 256 ; i++)
+            g_table[slice][i] = (g_table[slice - 1][i] >> 8) ^ g_table[0][g_table[slice - 1][i] & 0xFF];
+    }
+    g_isTableInitialized = 1;
+}
+
+static uint32_t read32(const unsigned char* p)
+{
+    /* CRC-32 is bit reflected so the bytes are always combined in little endian order, whatever the host. */
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
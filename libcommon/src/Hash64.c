@@ -0,0 +1,140 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+#include "Hash64.h"
+
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+
+static uint64_t rotateLeft(uint64_t value, int bits);
+static uint64_t read64(const unsigned char* p);
+static uint32_t read32(const unsigned char* p);
+static uint64_t round64(uint64_t accumulator, uint64_t input);
+static uint64_t mergeRound(uint64_t hash, uint64_t accumulator);
+static uint64_t hashStripes(const unsigned char** ppCurr, const unsigned char* pLimit, uint64_t seed);
+static uint64_t hashTail(uint64_t hash, const unsigned char* pCurr, const unsigned char* pEnd);
+static uint64_t avalanche(uint64_t hash);
+uint64_t Hash64_Buffer(const void* pBuffer, size_t bufferSize, uint64_t seed)
+{
+    const unsigned char* pCurr = (const unsigned char*)pBuffer;
+    const unsigned char* pEnd = pCurr + bufferSize;
+    uint64_t             hash;
+
+    if (bufferSize >= 32)
+        hash = hashStripes(&pCurr, pEnd - 32, seed);
+    else
+        hash = seed + PRIME64_5;
+    hash += (uint64_t)bufferSize;
+
+    return avalanche(hashTail(hash, pCurr, pEnd));
+}
+
+static uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t read64(const unsigned char* p)
+{
+    /* Image and object data is processed on little endian hosts so this matches the canonical XXH64 byte order. */
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t read32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t round64(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * PRIME64_2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+static uint64_t mergeRound(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= round64(0, accumulator);
+    return hash * PRIME64_1 + PRIME64_4;
+}
+
+static uint64_t hashStripes(const unsigned char** ppCurr, const unsigned char* pLimit, uint64_t seed)
+{
+    const unsigned char* pCurr = *ppCurr;
+    uint64_t             v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t             v2 = seed + PRIME64_2;
+    uint64_t             v3 = seed;
+    uint64_t             v4 = seed - PRIME64_1;
+    uint64_t             hash;
+
+    do
+    {
+        v1 = round64(v1, read64(pCurr));
+        v2 = round64(v2, read64(pCurr + 8));
+        v3 = round64(v3, read64(pCurr + 16));
+        v4 = round64(v4, read64(pCurr + 24));
+        pCurr += 32;
+    } while (pCurr <= pLimit);
+    *ppCurr = pCurr;
+
+    hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+    hash = mergeRound(hash, v1);
+    hash = mergeRound(hash, v2);
+    hash = mergeRound(hash, v3);
+    hash = mergeRound(hash, v4);
+
+    return hash;
+}
+
+static uint64_t hashTail(uint64_t hash, const unsigned char* pCurr, const unsigned char* pEnd)
+{
+    while (pCurr + 8 <= pEnd)
+    {
+        hash ^= round64(0, read64(pCurr));
+        hash = rotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+        pCurr += 8;
+    }
+    if (pCurr + 4 <= pEnd)
+    {
+        hash ^= (uint64_t)read32(pCurr) * PRIME64_1;
+        hash = rotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+        pCurr += 4;
+    }
+    while (pCurr < pEnd)
+    {
+        hash ^= (uint64_t)*pCurr++ * PRIME64_5;
+        hash = rotateLeft(hash, 11) * PRIME64_1;
+    }
+
+    return hash;
+}
+
+static uint64_t avalanche(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
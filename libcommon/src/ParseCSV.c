@@ -11,6 +11,7 @@
     GNU General Public License for more details.
 */
 #include "ParseCSV.h"
+#include "AllocStats.h"
 #include "ParseCSVTest.h"
 #include "util.h"
 
@@ -95,7 +96,10 @@ static void growFieldArrayIfNecessary(ParseCSV* pThis, size_t fieldCount)
     size_t requiredArraySize = fieldArraySizeForFieldsAndNullTerminator(fieldCount);
     if (requiredArraySize > pThis->allocatedFieldCount)
     {
-        SizedString* pRealloc = realloc(pThis->pFields, requiredArraySize * sizeof(*pRealloc));
+        SizedString* pRealloc;
+        
+        AllocStats_SetTag(ALLOC_STATS_TAG_PARSE_CSV_FIELDS);
+        pRealloc = realloc(pThis->pFields, requiredArraySize * sizeof(*pRealloc));
         if (!pRealloc)
             __throw(outOfMemoryException);
         pThis->pFields = pRealloc;
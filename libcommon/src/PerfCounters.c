@@ -0,0 +1,268 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif /* __linux__ */
+#include "PerfCounters.h"
+#include "PerfCountersTest.h"
+#include "util.h"
+
+
+#define MAX_REGIONS     32
+#define MAX_DEPTH       16
+
+
+typedef enum PerfCounterType
+{
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_CACHE_MISSES,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+} PerfCounterType;
+
+typedef struct PerfRegion
+{
+    const char*        pName;
+    unsigned int       calls;
+    unsigned long long counts[PERF_COUNTER_COUNT];
+} PerfRegion;
+
+typedef struct PerfSample
+{
+    PerfRegion*        pRegion;
+    unsigned long long counts[PERF_COUNTER_COUNT];
+} PerfSample;
+
+typedef struct PerfCounters
+{
+    PerfRegion   regions[MAX_REGIONS];
+    PerfSample   openSamples[MAX_DEPTH];
+    int          fds[PERF_COUNTER_COUNT];
+    unsigned int regionCount;
+    unsigned int depth;
+    int          isEnabled;
+} PerfCounters;
+
+
+static PerfCounters g_perfCounters;
+
+
+static void closeCounters(void);
+static int  openCounter(PerfCounterType type);
+int PerfCounters_Start(void)
+{
+    size_t i;
+    
+    PerfCounters_Free();
+    for (i = 0 ; i < PERF_COUNTER_COUNT ; i++)
+        g_perfCounters.fds[i] = openCounter((PerfCounterType)i);
+    if (g_perfCounters.fds[PERF_COUNTER_CYCLES] < 0)
+    {
+        closeCounters();
+        return 0;
+    }
+    g_perfCounters.isEnabled = 1;
+    
+    return 1;
+}
+
+#ifdef __linux__
+static int openCounter(PerfCounterType type)
+{
+    static const unsigned long long configs[PERF_COUNTER_COUNT] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    struct perf_event_attr attr;
+    
+    /* Only user mode is counted so that this works with the default perf_event_paranoid setting. */
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = configs[type];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long long readCounter(int fd)
+{
+    unsigned long long value = 0;
+    
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+
+static void closeCounter(int fd)
+{
+    if (fd >= 0)
+        close(fd);
+}
+#else
+static int openCounter(PerfCounterType type)
+{
+    return -1;
+}
+
+static unsigned long long readCounter(int fd)
+{
+    return 0;
+}
+
+static void closeCounter(int fd)
+{
+}
+#endif /* __linux__ */
+
+static void closeCounters(void)
+{
+    size_t i;
+    
+    for (i = 0 ; i < PERF_COUNTER_COUNT ; i++)
+    {
+        closeCounter(g_perfCounters.fds[i]);
+        g_perfCounters.fds[i] = -1;
+    }
+}
+
+
+void PerfCounters_Free(void)
+{
+    if (g_perfCounters.isEnabled)
+        closeCounters();
+    memset(&g_perfCounters, 0, sizeof(g_perfCounters));
+}
+
+
+int PerfCounters_IsEnabled(void)
+{
+    return g_perfCounters.isEnabled;
+}
+
+
+static PerfRegion* findOrAddRegion(const char* pRegionName);
+static void        readCounters(unsigned long long* pCounts);
+void PerfCounters_Begin(const char* pRegionName)
+{
+    PerfSample* pSample;
+    
+    if (!g_perfCounters.isEnabled)
+        return;
+    
+    /* Regions nested too deeply are still counted in depth so that their End matches up but aren't measured. */
+    if (g_perfCounters.depth++ >= MAX_DEPTH)
+        return;
+    pSample = &g_perfCounters.openSamples[g_perfCounters.depth - 1];
+    pSample->pRegion = findOrAddRegion(pRegionName);
+    readCounters(pSample->counts);
+}
+
+static PerfRegion* findOrAddRegion(const char* pRegionName)
+{
+    PerfRegion* pRegion;
+    size_t      i;
+    
+    for (i = 0 ; i < g_perfCounters.regionCount ; i++)
+    {
+        pRegion = &g_perfCounters.regions[i];
+        if (pRegion->pName == pRegionName || 0 == strcmp(pRegion->pName, pRegionName))
+            return pRegion;
+    }
+    if (g_perfCounters.regionCount >= MAX_REGIONS)
+        return NULL;
+    pRegion = &g_perfCounters.regions[g_perfCounters.regionCount++];
+    pRegion->pName = pRegionName;
+    
+    return pRegion;
+}
+
+static void readCounters(unsigned long long* pCounts)
+{
+    size_t i;
+    
+    for (i = 0 ; i < PERF_COUNTER_COUNT ; i++)
+        pCounts[i] = readCounter(g_perfCounters.fds[i]);
+}
+
+
+void PerfCounters_End(void)
+{
+    unsigned long long counts[PERF_COUNTER_COUNT];
+    PerfSample*        pSample;
+    size_t             i;
+    
+    if (!g_perfCounters.isEnabled || g_perfCounters.depth == 0)
+        return;
+    if (g_perfCounters.depth-- > MAX_DEPTH)
+        return;
+    pSample = &g_perfCounters.openSamples[g_perfCounters.depth];
+    if (!pSample->pRegion)
+        return;
+    
+    readCounters(counts);
+    pSample->pRegion->calls++;
+    for (i = 0 ; i < PERF_COUNTER_COUNT ; i++)
+        pSample->pRegion->counts[i] += counts[i] - pSample->counts[i];
+}
+
+
+static void printRegion(const PerfRegion* pRegion);
+void PerfCounters_Print(void)
+{
+    size_t i;
+    
+    if (!g_perfCounters.isEnabled)
+        return;
+    
+    printf("Performance counters:" LINE_ENDING
+           "  %-24s %8s %14s %6s %14s %14s" LINE_ENDING,
+           "region", "calls", "cycles", "IPC", "cache misses", "branch misses");
+    for (i = 0 ; i < g_perfCounters.regionCount ; i++)
+        printRegion(&g_perfCounters.regions[i]);
+}
+
+static void formatMissesPerCall(char* pBuffer, size_t bufferSize, const PerfRegion* pRegion, PerfCounterType type);
+static void printRegion(const PerfRegion* pRegion)
+{
+    const unsigned long long* pCounts = pRegion->counts;
+    char                      ipc[16];
+    char                      cacheMisses[24];
+    char                      branchMisses[24];
+    
+    if (g_perfCounters.fds[PERF_COUNTER_INSTRUCTIONS] >= 0 && pCounts[PERF_COUNTER_CYCLES])
+        snprintf(ipc, sizeof(ipc), "%.2f", (double)pCounts[PERF_COUNTER_INSTRUCTIONS] / pCounts[PERF_COUNTER_CYCLES]);
+    else
+        strcpy(ipc, "n/a");
+    formatMissesPerCall(cacheMisses, sizeof(cacheMisses), pRegion, PERF_COUNTER_CACHE_MISSES);
+    formatMissesPerCall(branchMisses, sizeof(branchMisses), pRegion, PERF_COUNTER_BRANCH_MISSES);
+    printf("  %-24s %8u %14llu %6s %14s %14s" LINE_ENDING,
+           pRegion->pName, pRegion->calls, pCounts[PERF_COUNTER_CYCLES], ipc, cacheMisses, branchMisses);
+}
+
+static void formatMissesPerCall(char* pBuffer, size_t bufferSize, const PerfRegion* pRegion, PerfCounterType type)
+{
+    /* Misses are shown per call so that regions like script lines which run many times can be compared. */
+    if (g_perfCounters.fds[type] < 0 || pRegion->calls == 0)
+        snprintf(pBuffer, bufferSize, "n/a");
+    else
+        snprintf(pBuffer, bufferSize, "%.1f/call", (double)pRegion->counts[type] / pRegion->calls);
+}
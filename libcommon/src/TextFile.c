@@ -13,6 +13,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "TextFile.h"
+#include "AllocStats.h"
 #include "TextFileTest.h"
 #include "util.h"
 
@@ -42,6 +43,7 @@ __throws TextFile* TextFile_CreateFromString(const char* pText)
     
     __try
     {
+        AllocStats_SetTag(ALLOC_STATS_TAG_TEXT_FILE);
         pThis = allocateAndZero(sizeof(*pThis));
         initObject(pThis, pText);
         pThis->pEnd = (char*)~0UL;
@@ -102,6 +104,7 @@ __throws TextFile* TextFile_CreateFromFile(const SizedString* pDirectory,
     
     __try
     {
+        AllocStats_SetTag(ALLOC_STATS_TAG_TEXT_FILE);
         pThis = allocateAndZero(sizeof(*pThis));
         pThis->pFilename = allocateStringAndCopyMergedFilename(pDirectory, pFilename, pFilenameSuffix);
         pFile = openFile(pThis->pFilename);
@@ -157,6 +160,7 @@ static char* allocateTextBuffer(long textLength)
 {
     char* pTextBuffer;
     
+    AllocStats_SetTag(ALLOC_STATS_TAG_TEXT_FILE);
     pTextBuffer = malloc(textLength);
     if (!pTextBuffer)
         __throw(outOfMemoryException);
@@ -176,7 +180,10 @@ static void readFileContentIntoTextBuffer(char* pTextBuffer, long fileSize, FILE
 
 __throws TextFile* TextFile_CreateFromTextFile(const TextFile* pTextFile)
 {
-    TextFile* pThis = allocateAndZero(sizeof(*pThis));
+    TextFile* pThis;
+    
+    AllocStats_SetTag(ALLOC_STATS_TAG_TEXT_FILE);
+    pThis = allocateAndZero(sizeof(*pThis));
     *pThis = *pTextFile;
     pThis->pText = pTextFile->pCurr;
     pThis->startLineNumber = pTextFile->lineNumber;
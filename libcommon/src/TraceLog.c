@@ -0,0 +1,284 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "TraceLog.h"
+#include "TraceLogTest.h"
+#include "util.h"
+
+
+#define INITIAL_EVENT_COUNT     1024
+#define INITIAL_NAMES_SIZE      (16 * 1024)
+#define MAX_NAME_LENGTH         255
+
+
+typedef struct TraceEvent
+{
+    const char*        pCategory;
+    size_t             nameOffset;
+    unsigned long long timestamp;
+    char               phase;
+} TraceEvent;
+
+typedef struct TraceLog
+{
+    TraceEvent*    pEvents;
+    char*          pNames;
+    size_t         eventCount;
+    size_t         allocatedEventCount;
+    size_t         namesSize;
+    size_t         allocatedNamesSize;
+    size_t         openSpanCount;
+    struct timeval startTime;
+    int            isEnabled;
+} TraceLog;
+
+
+static TraceLog g_traceLog;
+
+
+void TraceLog_Start(void)
+{
+    TraceLog_Free();
+    gettimeofday(&g_traceLog.startTime, NULL);
+    g_traceLog.isEnabled = 1;
+}
+
+
+void TraceLog_Free(void)
+{
+    free(g_traceLog.pEvents);
+    free(g_traceLog.pNames);
+    memset(&g_traceLog, 0, sizeof(g_traceLog));
+}
+
+
+int TraceLog_IsEnabled(void)
+{
+    return g_traceLog.isEnabled;
+}
+
+
+static size_t formatName(char* pName, const char* pNameFormat, va_list valist);
+static int growEventsIfNecessary(void);
+static int growNamesIfNecessary(size_t nameSize);
+static int growArray(void** ppArray, size_t* pAllocatedCount, size_t usedCount, size_t neededCount, size_t elementSize,
+                     size_t initialCount);
+static TraceEvent* addEvent(char phase, const char* pCategory, size_t nameOffset);
+void TraceLog_Begin(const char* pCategory, const char* pNameFormat, ...)
+{
+    va_list valist;
+    char    name[MAX_NAME_LENGTH + 1];
+    size_t  nameLength;
+    
+    if (!g_traceLog.isEnabled)
+        return;
+    
+    va_start(valist, pNameFormat);
+    nameLength = formatName(name, pNameFormat, valist);
+    va_end(valist);
+    if (!growEventsIfNecessary() || !growNamesIfNecessary(nameLength + 1))
+        return;
+    
+    addEvent('B', pCategory, g_traceLog.namesSize);
+    memcpy(g_traceLog.pNames + g_traceLog.namesSize, name, nameLength + 1);
+    g_traceLog.namesSize += nameLength + 1;
+    g_traceLog.openSpanCount++;
+}
+
+static size_t formatName(char* pName, const char* pNameFormat, va_list valist)
+{
+    int length = vsnprintf(pName, MAX_NAME_LENGTH + 1, pNameFormat, valist);
+    
+    if (length < 0)
+    {
+        pName[0] = '\0';
+        return 0;
+    }
+    if (length > MAX_NAME_LENGTH)
+        return MAX_NAME_LENGTH;
+    return (size_t)length;
+}
+
+static int growEventsIfNecessary(void)
+{
+    return growArray((void**)&g_traceLog.pEvents, &g_traceLog.allocatedEventCount, g_traceLog.eventCount, 1,
+                     sizeof(*g_traceLog.pEvents), INITIAL_EVENT_COUNT);
+}
+
+static int growNamesIfNecessary(size_t nameSize)
+{
+    return growArray((void**)&g_traceLog.pNames, &g_traceLog.allocatedNamesSize, g_traceLog.namesSize, nameSize,
+                     1, INITIAL_NAMES_SIZE);
+}
+
+static int growArray(void** ppArray, size_t* pAllocatedCount, size_t usedCount, size_t neededCount, size_t elementSize,
+                     size_t initialCount)
+{
+    size_t newCount = *pAllocatedCount ? *pAllocatedCount : initialCount;
+    void*  pRealloc;
+    
+    if (usedCount + neededCount <= *pAllocatedCount)
+        return 1;
+    while (usedCount + neededCount > newCount)
+        newCount *= 2;
+    pRealloc = realloc(*ppArray, newCount * elementSize);
+    if (!pRealloc)
+    {
+        /* Stop recording rather than failing the assembly or image build that is being traced. */
+        g_traceLog.isEnabled = 0;
+        return 0;
+    }
+    *ppArray = pRealloc;
+    *pAllocatedCount = newCount;
+    
+    return 1;
+}
+
+static unsigned long long microsecondsSinceStart(void);
+static TraceEvent* addEvent(char phase, const char* pCategory, size_t nameOffset)
+{
+    TraceEvent* pEvent = &g_traceLog.pEvents[g_traceLog.eventCount++];
+    
+    pEvent->pCategory = pCategory;
+    pEvent->nameOffset = nameOffset;
+    pEvent->timestamp = microsecondsSinceStart();
+    pEvent->phase = phase;
+    
+    return pEvent;
+}
+
+static unsigned long long microsecondsSinceStart(void)
+{
+    struct timeval now;
+    
+    gettimeofday(&now, NULL);
+    return (unsigned long long)(now.tv_sec - g_traceLog.startTime.tv_sec) * 1000000ULL + 
+           (unsigned long long)(now.tv_usec - g_traceLog.startTime.tv_usec);
+}
+
+
+void TraceLog_End(void)
+{
+    if (!g_traceLog.isEnabled || g_traceLog.openSpanCount == 0)
+        return;
+    if (!growEventsIfNecessary())
+        return;
+    
+    addEvent('E', NULL, 0);
+    g_traceLog.openSpanCount--;
+}
+
+
+static void writeEvent(FILE* pFile, const TraceEvent* pEvent);
+static void writeEndEvent(FILE* pFile, unsigned long long timestamp);
+static void writeEscapedString(FILE* pFile, const char* pString);
+static void writeString(FILE* pFile, const char* pString);
+__throws void TraceLog_WriteToFile(const char* pFilename)
+{
+    FILE*              pFile = NULL;
+    unsigned long long lastTimestamp = 0;
+    size_t             i;
+    
+    __try
+    {
+        pFile = fopen(pFilename, "w");
+        if (!pFile)
+            __throw(fileOpenException);
+        
+        writeString(pFile, "{\"traceEvents\":[");
+        for (i = 0 ; i < g_traceLog.eventCount ; i++)
+        {
+            writeString(pFile, i == 0 ? "\n" : ",\n");
+            writeEvent(pFile, &g_traceLog.pEvents[i]);
+            lastTimestamp = g_traceLog.pEvents[i].timestamp;
+        }
+        for (i = 0 ; i < g_traceLog.openSpanCount ; i++)
+        {
+            writeString(pFile, ",\n");
+            writeEndEvent(pFile, lastTimestamp);
+        }
+        writeString(pFile, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+    
+    fclose(pFile);
+}
+
+static void writeEvent(FILE* pFile, const TraceEvent* pEvent)
+{
+    char prefix[64];
+    
+    if (pEvent->phase == 'E')
+    {
+        writeEndEvent(pFile, pEvent->timestamp);
+        return;
+    }
+    snprintf(prefix, sizeof(prefix), "{\"ph\":\"B\",\"ts\":%llu,\"pid\":1,\"tid\":1,\"cat\":\"", pEvent->timestamp);
+    writeString(pFile, prefix);
+    writeEscapedString(pFile, pEvent->pCategory);
+    writeString(pFile, "\",\"name\":\"");
+    writeEscapedString(pFile, g_traceLog.pNames + pEvent->nameOffset);
+    writeString(pFile, "\"}");
+}
+
+static void writeEndEvent(FILE* pFile, unsigned long long timestamp)
+{
+    char event[64];
+    
+    snprintf(event, sizeof(event), "{\"ph\":\"E\",\"ts\":%llu,\"pid\":1,\"tid\":1}", timestamp);
+    writeString(pFile, event);
+}
+
+static void writeEscapedString(FILE* pFile, const char* pString)
+{
+    /* Every character could need the 6 character \u00XX form. */
+    char  escaped[MAX_NAME_LENGTH * 6 + 1];
+    char* pDest = escaped;
+    
+    for ( ; *pString && pDest < escaped + sizeof(escaped) - 7 ; pString++)
+    {
+        unsigned char c = (unsigned char)*pString;
+        
+        if (c == '"' || c == '\\')
+        {
+            *pDest++ = '\\';
+            *pDest++ = (char)c;
+        }
+        else if (c < 0x20)
+        {
+            pDest += sprintf(pDest, "\\u%04x", c);
+        }
+        else
+        {
+            *pDest++ = (char)c;
+        }
+    }
+    *pDest = '\0';
+    writeString(pFile, escaped);
+}
+
+static void writeString(FILE* pFile, const char* pString)
+{
+    size_t length = strlen(pString);
+    
+    if (length != fwrite(pString, 1, length, pFile))
+        __throw(fileException);
+}
@@ -0,0 +1,232 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "AllocStats.h"
+    #include "MallocFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+TEST_GROUP(AllocStats)
+{
+    void* (*m_pOriginalMalloc)(size_t size);
+    
+    void setup()
+    {
+        m_pOriginalMalloc = hook_malloc;
+    }
+
+    void teardown()
+    {
+        AllocStats_Stop();
+        MallocFailureInject_Restore();
+        printfSpy_Unhook();
+        POINTERS_EQUAL((void*)m_pOriginalMalloc, (void*)hook_malloc);
+    }
+    
+    const AllocStatsEntry* entry(AllocStatsTag tag)
+    {
+        return &AllocStats_GetEntries()[tag];
+    }
+    
+    void validateEntry(const AllocStatsEntry* pEntry, unsigned int allocations, unsigned long long bytesAllocated,
+                       size_t liveBytes, size_t peakLiveBytes)
+    {
+        LONGS_EQUAL(allocations, pEntry->allocations);
+        CHECK(bytesAllocated == pEntry->bytesAllocated);
+        LONGS_EQUAL(liveBytes, pEntry->liveBytes);
+        LONGS_EQUAL(peakLiveBytes, pEntry->peakLiveBytes);
+    }
+};
+
+
+TEST(AllocStats, NotEnabledUntilStarted)
+{
+    CHECK_FALSE(AllocStats_IsEnabled());
+    AllocStats_Start();
+    CHECK_TRUE(AllocStats_IsEnabled());
+    CHECK(hook_malloc != m_pOriginalMalloc);
+    AllocStats_Stop();
+    CHECK_FALSE(AllocStats_IsEnabled());
+}
+
+TEST(AllocStats, StartTwiceKeepsOriginalHooksForStop)
+{
+    AllocStats_Start();
+    AllocStats_Start();
+    AllocStats_Stop();
+    POINTERS_EQUAL((void*)m_pOriginalMalloc, (void*)hook_malloc);
+}
+
+TEST(AllocStats, EntryNames)
+{
+    AllocStats_Start();
+    STRCMP_EQUAL("other", entry(ALLOC_STATS_TAG_OTHER)->pName);
+    STRCMP_EQUAL("LineInfo", entry(ALLOC_STATS_TAG_LINE_INFO)->pName);
+    STRCMP_EQUAL("ByteBuffer", entry(ALLOC_STATS_TAG_BYTE_BUFFER)->pName);
+    STRCMP_EQUAL("total", AllocStats_GetTotals()->pName);
+}
+
+TEST(AllocStats, UntaggedMallocAndFreeCountedAsOther)
+{
+    AllocStats_Start();
+    void* p = hook_malloc(10);
+    validateEntry(entry(ALLOC_STATS_TAG_OTHER), 1, 10, 10, 10);
+    hook_free(p);
+    validateEntry(entry(ALLOC_STATS_TAG_OTHER), 1, 10, 0, 10);
+    validateEntry(AllocStats_GetTotals(), 1, 10, 0, 10);
+}
+
+TEST(AllocStats, TagOnlyAppliesToNextAllocation)
+{
+    AllocStats_Start();
+    AllocStats_SetTag(ALLOC_STATS_TAG_SYMBOL);
+    void* p1 = hook_malloc(16);
+    void* p2 = hook_malloc(8);
+    validateEntry(entry(ALLOC_STATS_TAG_SYMBOL), 1, 16, 16, 16);
+    validateEntry(entry(ALLOC_STATS_TAG_OTHER), 1, 8, 8, 8);
+    validateEntry(AllocStats_GetTotals(), 2, 24, 24, 24);
+    hook_free(p1);
+    hook_free(p2);
+    validateEntry(entry(ALLOC_STATS_TAG_SYMBOL), 1, 16, 0, 16);
+    validateEntry(AllocStats_GetTotals(), 2, 24, 0, 24);
+}
+
+TEST(AllocStats, PeakTracksHighestLiveBytes)
+{
+    AllocStats_Start();
+    AllocStats_SetTag(ALLOC_STATS_TAG_LINE_INFO);
+    void* p1 = hook_malloc(100);
+    hook_free(p1);
+    AllocStats_SetTag(ALLOC_STATS_TAG_LINE_INFO);
+    void* p2 = hook_malloc(40);
+    AllocStats_SetTag(ALLOC_STATS_TAG_LINE_INFO);
+    void* p3 = hook_malloc(40);
+    validateEntry(entry(ALLOC_STATS_TAG_LINE_INFO), 3, 180, 80, 100);
+    hook_free(p2);
+    hook_free(p3);
+}
+
+TEST(AllocStats, CallocIsZeroedAndCountsAllElements)
+{
+    static const char zeroes[32] = { 0 };
+    
+    AllocStats_Start();
+    AllocStats_SetTag(ALLOC_STATS_TAG_TEXT_FILE);
+    void* p = hook_calloc(4, 8);
+    validateEntry(entry(ALLOC_STATS_TAG_TEXT_FILE), 1, 32, 32, 32);
+    CHECK(0 == memcmp(p, zeroes, sizeof(zeroes)));
+    hook_free(p);
+}
+
+TEST(AllocStats, CallocOverflowFails)
+{
+    AllocStats_Start();
+    POINTERS_EQUAL(NULL, hook_calloc((size_t)-1, 2));
+    validateEntry(AllocStats_GetTotals(), 0, 0, 0, 0);
+}
+
+TEST(AllocStats, ReallocKeepsTagAndContents)
+{
+    AllocStats_Start();
+    AllocStats_SetTag(ALLOC_STATS_TAG_PARSE_CSV_FIELDS);
+    char* p = (char*)hook_malloc(4);
+    memcpy(p, "abc", 4);
+    p = (char*)hook_realloc(p, 64);
+    STRCMP_EQUAL("abc", p);
+    validateEntry(entry(ALLOC_STATS_TAG_PARSE_CSV_FIELDS), 2, 68, 64, 64);
+    validateEntry(entry(ALLOC_STATS_TAG_OTHER), 0, 0, 0, 0);
+    hook_free(p);
+}
+
+TEST(AllocStats, ReallocWithNewTagMovesLiveBytes)
+{
+    AllocStats_Start();
+    void* p = hook_malloc(8);
+    AllocStats_SetTag(ALLOC_STATS_TAG_MACRO_ARRAYS);
+    p = hook_realloc(p, 16);
+    validateEntry(entry(ALLOC_STATS_TAG_OTHER), 1, 8, 0, 8);
+    validateEntry(entry(ALLOC_STATS_TAG_MACRO_ARRAYS), 1, 16, 16, 16);
+    validateEntry(AllocStats_GetTotals(), 2, 24, 16, 16);
+    hook_free(p);
+}
+
+TEST(AllocStats, ReallocOfNullActsAsMalloc)
+{
+    AllocStats_Start();
+    AllocStats_SetTag(ALLOC_STATS_TAG_BYTE_BUFFER);
+    void* p = hook_realloc(NULL, 12);
+    validateEntry(entry(ALLOC_STATS_TAG_BYTE_BUFFER), 1, 12, 12, 12);
+    hook_free(p);
+}
+
+TEST(AllocStats, FailedMallocIsNotCounted)
+{
+    MallocFailureInject_FailAllocation(1);
+    AllocStats_Start();
+    POINTERS_EQUAL(NULL, hook_malloc(8));
+    validateEntry(AllocStats_GetTotals(), 0, 0, 0, 0);
+}
+
+TEST(AllocStats, FailedReallocLeavesOriginalBlockCounted)
+{
+    MallocFailureInject_FailAllocation(2);
+    AllocStats_Start();
+    void* p = hook_malloc(8);
+    POINTERS_EQUAL(NULL, hook_realloc(p, 16));
+    validateEntry(AllocStats_GetTotals(), 1, 8, 8, 8);
+    hook_free(p);
+}
+
+TEST(AllocStats, FreeOfNullIsIgnored)
+{
+    AllocStats_Start();
+    hook_free(NULL);
+    validateEntry(AllocStats_GetTotals(), 0, 0, 0, 0);
+}
+
+TEST(AllocStats, PrintOnlyShowsTagsWithAllocationsAndTotal)
+{
+    AllocStats_Start();
+    AllocStats_SetTag(ALLOC_STATS_TAG_SYMBOL);
+    void* p = hook_malloc(24);
+    hook_free(hook_malloc(8));
+    
+    printfSpy_Hook(1024);
+    AllocStats_Print();
+    LONGS_EQUAL(4, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  total                          2             32             32             24" LINE_ENDING,
+                 printfSpy_GetLastOutput());
+    STRCMP_EQUAL("  Symbol                         1             24             24             24" LINE_ENDING,
+                 printfSpy_GetPreviousOutput());
+    printfSpy_Unhook();
+    hook_free(p);
+}
+
+TEST(AllocStats, StatsRemainAfterStopAndResetOnStart)
+{
+    AllocStats_Start();
+    hook_free(hook_malloc(8));
+    AllocStats_Stop();
+    validateEntry(AllocStats_GetTotals(), 1, 8, 0, 8);
+    AllocStats_Start();
+    validateEntry(AllocStats_GetTotals(), 0, 0, 0, 0);
+}
@@ -0,0 +1,96 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "Crc32.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+TEST_GROUP(Crc32)
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+
+    uint32_t crcString(const char* pString)
+    {
+        return Crc32_Buffer(pString, strlen(pString), 0);
+    }
+
+    uint32_t bitAtATimeCrc(const unsigned char* pBuffer, size_t bufferSize)
+    {
+        uint32_t crc = 0xFFFFFFFF;
+
+        for (size_t i = 0 ; i < bufferSize ; i++)
+        {
+            crc ^= pBuffer[i];
+            for (int bit = 0 ; bit < 8 ; bit++)
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+        return ~crc;
+    }
+};
+
+
+TEST(Crc32, EmptyBuffer)
+{
+    LONGS_EQUAL(0x00000000, crcString(""));
+}
+
+TEST(Crc32, SingleByte)
+{
+    LONGS_EQUAL(0xE8B7BE43, crcString("a"));
+}
+
+TEST(Crc32, StandardCheckValue)
+{
+    LONGS_EQUAL(0xCBF43926, crcString("123456789"));
+}
+
+TEST(Crc32, MoreThanOneSlice)
+{
+    LONGS_EQUAL(0x414FA339, crcString("The quick brown fox jumps over the lazy dog"));
+}
+
+TEST(Crc32, ContinueAcrossSeveralBuffers)
+{
+    const char* pText = "The quick brown fox jumps over the lazy dog";
+    uint32_t    crc = Crc32_Buffer(pText, 5, 0);
+
+    crc = Crc32_Buffer(pText + 5, 17, crc);
+    crc = Crc32_Buffer(pText + 22, strlen(pText) - 22, crc);
+    LONGS_EQUAL(0x414FA339, crc);
+}
+
+TEST(Crc32, MatchBitAtATimeCalculationForEveryLengthAndAlignment)
+{
+    unsigned char buffer[67];
+
+    for (size_t i = 0 ; i < sizeof(buffer) ; i++)
+        buffer[i] = (unsigned char)(i * 37 + 11);
+    for (size_t start = 0 ; start < 8 ; start++)
+    {
+        for (size_t length = 0 ; length <= sizeof(buffer) - start ; length++)
+            LONGS_EQUAL(bitAtATimeCrc(buffer + start, length), Crc32_Buffer(buffer + start, length, 0));
+    }
+}
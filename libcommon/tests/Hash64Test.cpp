@@ -0,0 +1,75 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "Hash64.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+TEST_GROUP(Hash64)
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+
+    uint64_t hashString(const char* pString)
+    {
+        return Hash64_Buffer(pString, strlen(pString), 0);
+    }
+};
+
+
+TEST(Hash64, EmptyBuffer)
+{
+    CHECK_TRUE(0xEF46DB3751D8E999ULL == hashString(""));
+}
+
+TEST(Hash64, SingleByte)
+{
+    CHECK_TRUE(0xD24EC4F1A98C6E5BULL == hashString("a"));
+}
+
+TEST(Hash64, ThreeBytes)
+{
+    CHECK_TRUE(0x44BC2CF5AD770999ULL == hashString("abc"));
+}
+
+TEST(Hash64, MoreThanOneStripe)
+{
+    CHECK_TRUE(0xFBCEA83C8A378BF1ULL == hashString("Nobody inspects the spammish repetition"));
+}
+
+TEST(Hash64, SeedChangesHash)
+{
+    CHECK_TRUE(Hash64_Buffer("abc", 3, 0) != Hash64_Buffer("abc", 3, 1));
+}
+
+TEST(Hash64, SingleBitChangeInLargeBufferChangesHash)
+{
+    unsigned char buffer[4096];
+
+    memset(buffer, 0x5a, sizeof(buffer));
+    uint64_t original = Hash64_Buffer(buffer, sizeof(buffer), 0);
+    buffer[2049] ^= 0x10;
+    CHECK_TRUE(original != Hash64_Buffer(buffer, sizeof(buffer), 0));
+}
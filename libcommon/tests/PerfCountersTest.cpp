@@ -0,0 +1,116 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "PerfCounters.h"
+    #include "printfSpy.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+/* Whether the counters can be opened depends on the CPU and kernel settings of the machine running the tests so the
+   tests which need them only check the results when PerfCounters_Start() succeeds. */
+TEST_GROUP(PerfCounters)
+{
+    void setup()
+    {
+        printfSpy_Hook(512);
+    }
+
+    void teardown()
+    {
+        printfSpy_Unhook();
+        PerfCounters_Free();
+    }
+};
+
+
+TEST(PerfCounters, NotEnabledUntilStarted)
+{
+    CHECK_FALSE(PerfCounters_IsEnabled());
+}
+
+TEST(PerfCounters, BeginEndAndPrintDoNothingWhenNotEnabled)
+{
+    PerfCounters_Begin("region");
+    PerfCounters_End();
+    PerfCounters_Print();
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+}
+
+TEST(PerfCounters, StartReportsWhetherEnabled)
+{
+    int result = PerfCounters_Start();
+    LONGS_EQUAL(result, PerfCounters_IsEnabled());
+    PerfCounters_Free();
+    CHECK_FALSE(PerfCounters_IsEnabled());
+}
+
+TEST(PerfCounters, EndWithoutBeginIsIgnored)
+{
+    if (!PerfCounters_Start())
+        return;
+    PerfCounters_End();
+    PerfCounters_Print();
+    LONGS_EQUAL(1, printfSpy_GetCallCount());
+}
+
+TEST(PerfCounters, RegionsWithSameNameAreCombined)
+{
+    int i;
+    
+    if (!PerfCounters_Start())
+        return;
+    for (i = 0 ; i < 3 ; i++)
+    {
+        PerfCounters_Begin("line");
+        PerfCounters_End();
+    }
+    PerfCounters_Print();
+    LONGS_EQUAL(2, printfSpy_GetCallCount());
+    STRCMP_CONTAINS("  line                            3 ", printfSpy_GetLastOutput());
+}
+
+TEST(PerfCounters, NestedRegionsAreEachCounted)
+{
+    if (!PerfCounters_Start())
+        return;
+    PerfCounters_Begin("outer");
+    PerfCounters_Begin("inner");
+    PerfCounters_End();
+    PerfCounters_End();
+    PerfCounters_Print();
+    LONGS_EQUAL(3, printfSpy_GetCallCount());
+    STRCMP_CONTAINS("  outer                           1 ", printfSpy_GetPreviousOutput());
+    STRCMP_CONTAINS("  inner                           1 ", printfSpy_GetLastOutput());
+}
+
+TEST(PerfCounters, RegionsNestedTooDeeplyAreSkipped)
+{
+    int i;
+    
+    if (!PerfCounters_Start())
+        return;
+    for (i = 0 ; i < 17 ; i++)
+        PerfCounters_Begin(i < 16 ? "shallow" : "deep");
+    for (i = 0 ; i < 17 ; i++)
+        PerfCounters_End();
+    PerfCounters_Print();
+    LONGS_EQUAL(2, printfSpy_GetCallCount());
+    STRCMP_CONTAINS("  shallow                        16 ", printfSpy_GetLastOutput());
+}
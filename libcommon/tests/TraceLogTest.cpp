@@ -0,0 +1,238 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+#include <stdio.h>
+#include <string>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "TraceLog.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_traceFilename = "TraceLogTest.json";
+
+TEST_GROUP(TraceLog)
+{
+    void setup()
+    {
+        clearExceptionCode();
+    }
+
+    void teardown()
+    {
+        MallocFailureInject_Restore();
+        fopenRestore();
+        fwriteRestore();
+        TraceLog_Free();
+        LONGS_EQUAL(noException, getExceptionCode());
+        remove(g_traceFilename);
+    }
+    
+    std::string writeAndReadTraceWithoutTimestamps()
+    {
+        std::string trace;
+        char        buffer[256];
+        size_t      bytesRead;
+        size_t      i;
+        
+        TraceLog_WriteToFile(g_traceFilename);
+        FILE* pFile = fopen(g_traceFilename, "r");
+        CHECK(pFile != NULL);
+        while ((bytesRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+            trace.append(buffer, bytesRead);
+        fclose(pFile);
+        
+        // Timestamps differ from run to run so replace them with 0.
+        for (i = trace.find("\"ts\":") ; i != std::string::npos ; i = trace.find("\"ts\":", i + 1))
+        {
+            size_t start = i + 5;
+            size_t end = trace.find_first_not_of("0123456789", start);
+            trace.replace(start, end - start, "0");
+        }
+        return trace;
+    }
+    
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(TraceLog, DisabledByDefault)
+{
+    CHECK_FALSE(TraceLog_IsEnabled());
+}
+
+TEST(TraceLog, EnabledAfterStart)
+{
+    TraceLog_Start();
+    CHECK_TRUE(TraceLog_IsEnabled());
+}
+
+TEST(TraceLog, DisabledAfterFree)
+{
+    TraceLog_Start();
+    TraceLog_Free();
+    CHECK_FALSE(TraceLog_IsEnabled());
+}
+
+TEST(TraceLog, NothingRecordedBeforeStart)
+{
+    TraceLog_Begin("test", "span");
+    TraceLog_End();
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, OneSpan)
+{
+    TraceLog_Start();
+    TraceLog_Begin("test", "span");
+    TraceLog_End();
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "{\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1,\"cat\":\"test\",\"name\":\"span\"},\n"
+                 "{\"ph\":\"E\",\"ts\":0,\"pid\":1,\"tid\":1}\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, NestedSpansWithFormattedNames)
+{
+    TraceLog_Start();
+    TraceLog_Begin("outer", "PUT %s", "file.S");
+    TraceLog_Begin("inner", "LUP %u", 3);
+    TraceLog_End();
+    TraceLog_End();
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "{\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1,\"cat\":\"outer\",\"name\":\"PUT file.S\"},\n"
+                 "{\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1,\"cat\":\"inner\",\"name\":\"LUP 3\"},\n"
+                 "{\"ph\":\"E\",\"ts\":0,\"pid\":1,\"tid\":1},\n"
+                 "{\"ph\":\"E\",\"ts\":0,\"pid\":1,\"tid\":1}\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, EscapeQuotesBackslashesAndControlCharactersInNames)
+{
+    TraceLog_Start();
+    TraceLog_Begin("test", "\"dir\\file\"\t");
+    TraceLog_End();
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "{\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1,\"cat\":\"test\",\"name\":\"\\\"dir\\\\file\\\"\\u0009\"},\n"
+                 "{\"ph\":\"E\",\"ts\":0,\"pid\":1,\"tid\":1}\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, TruncateLongNames)
+{
+    char longName[301];
+    
+    memset(longName, 'a', sizeof(longName) - 1);
+    longName[sizeof(longName) - 1] = '\0';
+    TraceLog_Start();
+    TraceLog_Begin("test", "%s", longName);
+    TraceLog_End();
+    std::string trace = writeAndReadTraceWithoutTimestamps();
+    CHECK_TRUE(std::string::npos != trace.find(std::string(255, 'a') + "\""));
+    CHECK_TRUE(std::string::npos == trace.find(std::string(256, 'a')));
+}
+
+TEST(TraceLog, ExtraEndIsIgnored)
+{
+    TraceLog_Start();
+    TraceLog_End();
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, OpenSpansAreClosedWhenWritten)
+{
+    TraceLog_Start();
+    TraceLog_Begin("test", "outer");
+    TraceLog_Begin("test", "inner");
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "{\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1,\"cat\":\"test\",\"name\":\"outer\"},\n"
+                 "{\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1,\"cat\":\"test\",\"name\":\"inner\"},\n"
+                 "{\"ph\":\"E\",\"ts\":0,\"pid\":1,\"tid\":1},\n"
+                 "{\"ph\":\"E\",\"ts\":0,\"pid\":1,\"tid\":1}\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, GrowBeyondInitialEventAndNameAllocations)
+{
+    int i;
+    
+    TraceLog_Start();
+    for (i = 0 ; i < 2000 ; i++)
+    {
+        TraceLog_Begin("test", "span %d with a name long enough to fill the initial name buffer", i);
+        TraceLog_End();
+    }
+    std::string trace = writeAndReadTraceWithoutTimestamps();
+    CHECK_TRUE(std::string::npos != trace.find("\"name\":\"span 0 with"));
+    CHECK_TRUE(std::string::npos != trace.find("\"name\":\"span 1999 with"));
+}
+
+TEST(TraceLog, StopRecordingWhenEventAllocationFails)
+{
+    TraceLog_Start();
+    MallocFailureInject_FailAllocation(1);
+    TraceLog_Begin("test", "span");
+    TraceLog_End();
+    CHECK_FALSE(TraceLog_IsEnabled());
+    MallocFailureInject_Restore();
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, StopRecordingWhenNameAllocationFails)
+{
+    TraceLog_Start();
+    MallocFailureInject_FailAllocation(2);
+    TraceLog_Begin("test", "span");
+    TraceLog_End();
+    CHECK_FALSE(TraceLog_IsEnabled());
+    MallocFailureInject_Restore();
+    STRCMP_EQUAL("{\"traceEvents\":[\n"
+                 "],\"displayTimeUnit\":\"ms\"}\n",
+                 writeAndReadTraceWithoutTimestamps().c_str());
+}
+
+TEST(TraceLog, FailOpenInWriteToFile)
+{
+    TraceLog_Start();
+    fopenFail(NULL);
+    __try_and_catch( TraceLog_WriteToFile(g_traceFilename) );
+    validateExceptionThrown(fileOpenException);
+}
+
+TEST(TraceLog, FailWriteInWriteToFile)
+{
+    TraceLog_Start();
+    fwriteFail(0);
+    __try_and_catch( TraceLog_WriteToFile(g_traceFilename) );
+    validateExceptionThrown(fileException);
+}
@@ -28,10 +28,17 @@ struct BlockDiskImage
 
 static void freeObject(void* pThis);
 static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+static void validateInsert(void* pThis, DiskImageInsert* pInsert);
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents);
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize);
 struct DiskImageVTable BlockDiskImageVTable = 
 { 
     freeObject,
-    insertData 
+    insertData,
+    validateInsert,
+    calculateExtents,
+    describeDomain,
+    NULL
 };
 
 
@@ -95,14 +102,48 @@ static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert*
 }
 
 
-static void insertRW18Data(BlockDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
 static void validateRW18InsertionProperties(DiskImageInsert* pInsert);
 static DiskImageInsert convertRW18SideTrackSectorToBlockAndOffset(DiskImageInsert* pInsert);
-static unsigned int startBlockForSide(unsigned short side);
-static void insertBlockData(BlockDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
 static void validateOffsetTypeIsBlock(DiskImageInsert* pInsert);
 static void validateImageOffsets(BlockDiskImage* pThis, DiskImageInsert* pInsert);
+static void validateInsert(void* pThis, DiskImageInsert* pInsert)
+{
+    DiskImageInsert insert = *pInsert;
+    
+    if (pInsert->type == DISK_IMAGE_INSERTION_RW18)
+    {
+        validateRW18InsertionProperties(pInsert);
+        insert = convertRW18SideTrackSectorToBlockAndOffset(pInsert);
+    }
+    validateOffsetTypeIsBlock(&insert);
+    validateImageOffsets((BlockDiskImage*)pThis, &insert);
+}
+
+
 static unsigned int calculateSourceOffset(DiskImageInsert* pInsert);
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents)
+{
+    DiskImageInsert insert = *pInsert;
+    
+    if (insert.type == DISK_IMAGE_INSERTION_RW18)
+        insert = convertRW18SideTrackSectorToBlockAndOffset(&insert);
+    pExtents[0].domain = 0;
+    pExtents[0].start = calculateSourceOffset(&insert);
+    pExtents[0].end = pExtents[0].start + insert.length;
+    return 1;
+}
+
+
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize)
+{
+    *pDomainSize = DiskImage_GetImageSize(&((BlockDiskImage*)pThis)->super);
+    return "Block image bytes";
+}
+
+
+static void insertRW18Data(BlockDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+static unsigned int startBlockForSide(unsigned short side);
+static void insertBlockData(BlockDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
 __throws void BlockDiskImage_InsertData(BlockDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
 {
     if (pInsert->type == DISK_IMAGE_INSERTION_RW18)
@@ -198,6 +239,18 @@ __throws void BlockDiskImage_WriteImage(BlockDiskImage* pThis, const char* pImag
 }
 
 
+__throws void BlockDiskImage_UpdateImage(BlockDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename)
+{
+    DiskImage_UpdateImage(&pThis->super, pScriptFilename, pImageFilename);
+}
+
+
+void BlockDiskImage_PrintLayoutMap(BlockDiskImage* pThis)
+{
+    DiskImage_PrintLayoutMap(&pThis->super);
+}
+
+
 const unsigned char* BlockDiskImage_GetImagePointer(BlockDiskImage* pThis)
 {
     return DiskImage_GetImagePointer(&pThis->super);
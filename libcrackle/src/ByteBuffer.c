@@ -12,6 +12,7 @@
 */
 #include <string.h>
 #include "ByteBuffer.h"
+#include "AllocStats.h"
 #include "ByteBufferTest.h"
 #include "util.h"
 
@@ -21,6 +22,7 @@ __throws void ByteBuffer_Allocate(ByteBuffer* pThis, unsigned int bufferSize)
     __try
     {
         ByteBuffer_Free(pThis);
+        AllocStats_SetTag(ALLOC_STATS_TAG_BYTE_BUFFER);
         pThis->pBuffer = allocateAndZero(bufferSize);
         pThis->bufferSize = bufferSize;
     }
@@ -12,7 +12,9 @@
 */
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "CrackleCommandLine.h"
+#include "NibbleLoadSimulator.h"
 #include "CrackleCommandLineTest.h"
 #include "version.h"
 
@@ -25,19 +27,101 @@ static void displayCopyrightNotice(void)
 
 static void displayUsage(void)
 {
-    printf("Usage: crackle --format image_format scriptFilename outputImageFilename\n\n"
+    printf("Usage: crackle --format image_format [options] scriptFilename outputImageFilename\n"
+           "       crackle --format image_format [options] --update existingImageFilename scriptFilename\n"
+           "       crackle --verify nibImageFilename [scriptFilename]\n"
+           "       crackle [--format dsk_5.25|po_5.25] --extract nibImageFilename output\n"
+           "       crackle --format image_format --diff oldImage newImage [scriptFilename]\n\n"
            "Where: --format image_format indicates the type outputImage is to be\n"
            "         created.  image_format can be one of:\n"
            "           nib_5.25 - creates a .nib nibble image for a 5 1/4\" disk.\n"
+           "           woz_5.25 - creates a .woz 2.0 bitstream image for a 5 1/4\"\n"
+           "             disk.\n"
            "           hdv_3.5 - creates a .HDV block image for a 3 1/2\" disk.\n"
+           "           hdv - creates a .HDV block image for a ProDOS hard disk.\n"
+           "             The size is set with --blocks.\n"
+           "           dsk_5.25 or do_5.25 - creates a .dsk sector image for a\n"
+           "             5 1/4\" disk in DOS 3.3 sector order.\n"
+           "           po_5.25 - creates a .po sector image for a 5 1/4\" disk in\n"
+           "             ProDOS block order.\n"
            "       scriptFilename is the name of the input script to be used\n"
            "         for placing data in the image file.  Each line should meet\n"
            "         one of these formats:\n"
-           "           BLOCK,objectFilename,startOffset,length,block[,intraBlockOffset]\n"
-           "           RWTS16,objectFilename,startOffset,length,track,sector\n"
-           "           RW18,objectFilename,startOffset,length,side,track,intraTrackOffset[,imageTableAddress]\n"
+           "           BLOCK,objectFilename,startOffset,length,block[,intraBlockOffset][,LZ]\n"
+           "           RWTS16,objectFilename,startOffset,length,track,sector[,LZ]\n"
+           "           RW18,objectFilename,startOffset,length,side,track,intraTrackOffset[,imageTableAddress][,LZ]\n"
+           "         A trailing LZ field compresses the data before it is placed.\n"
+           "         The compiled script is cached in scriptFilename.plan beside\n"
+           "         the script so that it isn't parsed again until it changes.\n"
            "       outputImageFilename is the name of the image to be created by\n"
-           "           this tool.\n\n");
+           "           this tool.\n"
+           "       --output image_format imageFilename also writes the image in\n"
+           "           another format.  The script and its object files are only\n"
+           "           read once for all of the outputs.  Can be repeated up to\n"
+           "           4 times but can't be used with --update.\n"
+           "       --assemble sourceFilename runs the snap assembler on\n"
+           "           sourceFilename before the script is processed.  Script\n"
+           "           lines which name one of its SAV or USR outputs read it from\n"
+           "           memory instead of from disk.  Can be repeated up to 16\n"
+           "           times.\n"
+           "       --putdirs includeDir1;includeDir2... sets the directories in\n"
+           "           which --assemble looks for PUT files.\n"
+           "       --outdir outputDirectory sets the directory prefix of the\n"
+           "           --assemble outputs.  Script lines must name the outputs\n"
+           "           with this prefix.\n"
+           "       --blocks count sets the number of 512 byte blocks in an hdv\n"
+           "           image.  Can be 1 - 65535.  Defaults to 65535 (32MB).\n"
+           "       --update existingImageFilename updates the specified image in\n"
+           "           place.  Only the parts of the image whose script inputs have\n"
+           "           changed since the last update, as recorded in the\n"
+           "           existingImageFilename.manifest file, are rewritten.\n"
+           "       --no-plan-cache neither reads nor writes scriptFilename.plan\n"
+           "           so the script is always parsed from scratch.\n"
+           "       --verify nibImageFilename decodes every RWTS16 sector and RW18\n"
+           "           track in an existing nib_5.25 image and reports any bad\n"
+           "           address fields, data fields, epilogs or checksums.  When\n"
+           "           scriptFilename is also given, the decoded data is compared\n"
+           "           against what the script would write.\n"
+           "       --extract nibImageFilename decodes the RWTS16 sectors and RW18\n"
+           "           tracks of an existing nib_5.25 image.  With a dsk_5.25 or\n"
+           "           po_5.25 --format the RWTS16 sectors are written to the\n"
+           "           sector image named output.  Otherwise each track is written\n"
+           "           to its own output.tTT.rwts16 or output.tTT.SS.rw18 file.\n"
+           "       --hashes also writes a 64-bit hash of each track, or of each\n"
+           "           block for hdv images, to outputImageFilename.hashes.\n"
+           "       --diff oldImage newImage lists the tracks, or blocks for hdv\n"
+           "           images, which differ between two images of image_format.\n"
+           "           Either image can instead be a .hashes file written by\n"
+           "           --hashes.  When scriptFilename is also given, the script\n"
+           "           lines which write into each changed track or block are\n"
+           "           listed as well.  Not supported for woz_5.25 images but\n"
+           "           their .hashes files can be compared with nib_5.25.\n"
+           "       --map lists which parts of the image were written by each\n"
+           "           script line and which parts are still free.\n"
+           "       --load-sim loadSequenceFilename estimates how long a Disk II\n"
+           "           drive takes to read the sectors and tracks listed in\n"
+           "           loadSequenceFilename from a nib_5.25 or woz_5.25 image.\n"
+           "           Each line should meet one of these formats:\n"
+           "           RWTS16,name,track,sector[,sectorCount]\n"
+           "           RW18,name,side,track[,trackCount]\n"
+           "       --interleave skew|sectorList places the sectors of each\n"
+           "           RWTS16 track so that consecutive sector numbers are skew\n"
+           "           physical sectors apart.  A list of 16 physical sector\n"
+           "           numbers, one per sector number, can be given instead.\n"
+           "           Only supported for nib_5.25 and woz_5.25 images.\n"
+           "       --revolutions reports how many disk revolutions it takes to\n"
+           "           read each RWTS16 track in sector number order.\n"
+           "       --sector-time microseconds sets how long the loader spends\n"
+           "           processing each RWTS16 sector for --load-sim and\n"
+           "           --revolutions.  Defaults to 6000.\n"
+           "       --trace traceFilename writes a Chrome trace event file which\n"
+           "           shows the time spent assembling each --assemble source,\n"
+           "           processing each script line, and encoding each track.\n"
+           "       --alloc-stats prints the number of allocations, bytes, and\n"
+           "           peak live bytes for each kind of object allocated.\n"
+           "       --perf-counters prints the CPU cycles, instructions per\n"
+           "           cycle, cache misses, and branch misses of each script line\n"
+           "           and track encode.\n\n");
 }
 
 
@@ -45,14 +129,71 @@ static int parseArgument(CrackleCommandLine* pThis, int argc, const char** ppArg
 static int hasDoubleDashPrefix(const char* pArgument);
 static int parseFlagArgument(CrackleCommandLine* pThis, int argc, const char** ppArgs);
 static void parseFormat(CrackleCommandLine* pThis, int argc, const char* pFormat);
+static CrackleImageFormat parseImageFormat(const char* pFormat);
+static void parseOutput(CrackleCommandLine* pThis, int argc, const char** ppArgs);
+static void parseUpdate(CrackleCommandLine* pThis, int argc, const char* pImageFilename);
+static void parseVerify(CrackleCommandLine* pThis, int argc, const char* pImageFilename);
+static void parseExtract(CrackleCommandLine* pThis, int argc, const char* pImageFilename);
+static void parseDiff(CrackleCommandLine* pThis, int argc, const char** ppArgs);
+static void parseAssemble(CrackleCommandLine* pThis, int argc, const char* pSourceFilename);
+static void parsePath(const char** ppPath, int argc, const char* pPath);
+static void parseVerify(CrackleCommandLine* pThis, int argc, const char* pImageFilename)
+{
+    if (argc < 1 || pThis->pVerifyImageFilename)
+        __throw(invalidArgumentException);
+    pThis->pVerifyImageFilename = pImageFilename;
+}
+
+static void parseExtract(CrackleCommandLine* pThis, int argc, const char* pImageFilename)
+{
+    if (argc < 1 || pThis->pExtractImageFilename)
+        __throw(invalidArgumentException);
+    pThis->pExtractImageFilename = pImageFilename;
+}
+
+static void parseDiff(CrackleCommandLine* pThis, int argc, const char** ppArgs)
+{
+    if (argc < 2 || pThis->pDiffOldFilename)
+        __throw(invalidArgumentException);
+    pThis->pDiffOldFilename = ppArgs[0];
+    pThis->pDiffNewFilename = ppArgs[1];
+}
+
+static void parseAssemble(CrackleCommandLine* pThis, int argc, const char* pSourceFilename)
+{
+    if (argc < 1 || pThis->assemblySourceCount >= CRACKLE_MAX_ASSEMBLY_SOURCES)
+        __throw(invalidArgumentException);
+    pThis->assemblySources[pThis->assemblySourceCount++] = pSourceFilename;
+}
+
+static void parsePath(const char** ppPath, int argc, const char* pPath)
+{
+    if (argc < 1 || *ppPath)
+        __throw(invalidArgumentException);
+    *ppPath = pPath;
+}
+
+static void parseLoadSequence(CrackleCommandLine* pThis, int argc, const char* pLoadSequenceFilename);
+static void parseInterleave(CrackleCommandLine* pThis, int argc, const char* pInterleave);
+static unsigned int parseUnsignedInteger(const char* pString, const char** ppEnd);
+static void parseSectorTime(CrackleCommandLine* pThis, int argc, const char* pSectorTime);
+static void parseBlockCount(CrackleCommandLine* pThis, int argc, const char* pBlockCount);
 static int parseFilenameArgument(CrackleCommandLine* pThis, int argc, const char* pArgument);
 static void throwIfRequiredArgumentNotSpecified(CrackleCommandLine* pThis);
+static void throwIfInvalidVerifyArguments(CrackleCommandLine* pThis);
+static void throwIfInvalidExtractArguments(CrackleCommandLine* pThis);
+static void throwIfInvalidDiffArguments(CrackleCommandLine* pThis);
+static int hasBuildOnlyArguments(CrackleCommandLine* pThis);
+static int hasNibbleOutput(CrackleCommandLine* pThis);
+static int isNibbleFormat(CrackleImageFormat imageFormat);
+static int hasOutputOfFormat(CrackleCommandLine* pThis, CrackleImageFormat imageFormat);
 
 
 __throws CrackleCommandLine CrackleCommandLine_Init(int argc, const char** argv)
 {
     CrackleCommandLine commandLine;
     memset(&commandLine, 0, sizeof(commandLine));
+    commandLine.sectorProcessingTime = NIBBLE_LOAD_SIMULATOR_DEFAULT_SECTOR_MICROSECONDS;
     
     __try
     {
@@ -95,6 +236,101 @@ static int parseFlagArgument(CrackleCommandLine* pThis, int argc, const char** p
         parseFormat(pThis, argc - 1, ppArgs[1]);
         return 2;
     }
+    else if (0 == strcasecmp(*ppArgs, "--output"))
+    {
+        parseOutput(pThis, argc - 1, ppArgs + 1);
+        return 3;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--update"))
+    {
+        parseUpdate(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--verify"))
+    {
+        parseVerify(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--extract"))
+    {
+        parseExtract(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--diff"))
+    {
+        parseDiff(pThis, argc - 1, ppArgs + 1);
+        return 3;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--hashes"))
+    {
+        pThis->writeHashes = 1;
+        return 1;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--no-plan-cache"))
+    {
+        pThis->disablePlanCache = 1;
+        return 1;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--map"))
+    {
+        pThis->printLayoutMap = 1;
+        return 1;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--load-sim"))
+    {
+        parseLoadSequence(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--interleave"))
+    {
+        parseInterleave(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--revolutions"))
+    {
+        pThis->printRevolutions = 1;
+        return 1;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--alloc-stats"))
+    {
+        pThis->collectAllocStats = 1;
+        return 1;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--perf-counters"))
+    {
+        pThis->collectPerfCounters = 1;
+        return 1;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--sector-time"))
+    {
+        parseSectorTime(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--assemble"))
+    {
+        parseAssemble(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--putdirs"))
+    {
+        parsePath(&pThis->assemblerInitParams.pPutDirectories, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--outdir"))
+    {
+        parsePath(&pThis->assemblerInitParams.pOutputDirectory, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--blocks"))
+    {
+        parseBlockCount(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    else if (0 == strcasecmp(*ppArgs, "--trace"))
+    {
+        parsePath(&pThis->pTraceFilename, argc - 1, ppArgs[1]);
+        return 2;
+    }
     else
     {
         __throw(invalidArgumentException);
@@ -105,14 +341,118 @@ static void parseFormat(CrackleCommandLine* pThis, int argc, const char* pFormat
 {
     if (argc < 1)
         __throw(invalidArgumentException);
+    pThis->imageFormat = parseImageFormat(pFormat);
+}
+
+static CrackleImageFormat parseImageFormat(const char* pFormat)
+{
     if (0 == strcasecmp(pFormat, "nib_5.25"))
-        pThis->imageFormat = FORMAT_NIB_5_25;
+        return FORMAT_NIB_5_25;
+    else if (0 == strcasecmp(pFormat, "woz_5.25"))
+        return FORMAT_WOZ_5_25;
     else if (0 == strcasecmp(pFormat, "hdv_3.5"))
-        pThis->imageFormat = FORMAT_HDV_3_5;
+        return FORMAT_HDV_3_5;
+    else if (0 == strcasecmp(pFormat, "hdv"))
+        return FORMAT_HDV;
+    else if (0 == strcasecmp(pFormat, "dsk_5.25") || 0 == strcasecmp(pFormat, "do_5.25"))
+        return FORMAT_DSK_5_25;
+    else if (0 == strcasecmp(pFormat, "po_5.25"))
+        return FORMAT_PO_5_25;
     else
         __throw(invalidArgumentException);
 }
 
+static void parseOutput(CrackleCommandLine* pThis, int argc, const char** ppArgs)
+{
+    CrackleOutputImage* pOutput;
+    
+    if (argc < 2 || pThis->extraOutputCount >= CRACKLE_MAX_EXTRA_OUTPUTS)
+        __throw(invalidArgumentException);
+    pOutput = &pThis->extraOutputs[pThis->extraOutputCount];
+    pOutput->imageFormat = parseImageFormat(ppArgs[0]);
+    pOutput->pImageFilename = ppArgs[1];
+    pThis->extraOutputCount++;
+}
+
+static void parseUpdate(CrackleCommandLine* pThis, int argc, const char* pImageFilename)
+{
+    if (argc < 1 || pThis->pOutputImageFilename)
+        __throw(invalidArgumentException);
+    pThis->pOutputImageFilename = pImageFilename;
+    pThis->updateExistingImage = 1;
+}
+
+static void parseLoadSequence(CrackleCommandLine* pThis, int argc, const char* pLoadSequenceFilename)
+{
+    if (argc < 1)
+        __throw(invalidArgumentException);
+    pThis->pLoadSequenceFilename = pLoadSequenceFilename;
+}
+
+static void parseInterleave(CrackleCommandLine* pThis, int argc, const char* pInterleave)
+{
+    const char*  pCurr = pInterleave;
+    unsigned int i;
+    
+    if (argc < 1)
+        __throw(invalidArgumentException);
+    if (!strchr(pInterleave, ','))
+    {
+        unsigned int skew = parseUnsignedInteger(pInterleave, &pCurr);
+
+        if (*pCurr != '\0')
+            __throw(invalidArgumentException);
+        NibbleDiskImage_CalculateRWTS16Skew(pThis->rwts16Interleave, skew);
+        pThis->hasRWTS16Interleave = 1;
+        return;
+    }
+    
+    for (i = 0 ; i < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; i++)
+    {
+        unsigned int physicalSector = parseUnsignedInteger(pCurr, &pCurr);
+        
+        if (*pCurr != (i == NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK - 1 ? '\0' : ','))
+            __throw(invalidArgumentException);
+        pCurr++;
+        pThis->rwts16Interleave[i] = physicalSector > 0xFF ? 0xFF : physicalSector;
+    }
+    NibbleDiskImage_ValidateRWTS16Interleave(pThis->rwts16Interleave);
+    pThis->hasRWTS16Interleave = 1;
+}
+
+static unsigned int parseUnsignedInteger(const char* pString, const char** ppEnd)
+{
+    char*         pEnd = NULL;
+    unsigned long value = strtoul(pString, &pEnd, 0);
+    
+    if (pEnd == pString || *pString == '-')
+        __throw(invalidArgumentException);
+    *ppEnd = pEnd;
+    return (unsigned int)value;
+}
+
+static void parseSectorTime(CrackleCommandLine* pThis, int argc, const char* pSectorTime)
+{
+    const char* pEnd;
+    
+    if (argc < 1)
+        __throw(invalidArgumentException);
+    pThis->sectorProcessingTime = parseUnsignedInteger(pSectorTime, &pEnd);
+    if (*pEnd != '\0')
+        __throw(invalidArgumentException);
+}
+
+static void parseBlockCount(CrackleCommandLine* pThis, int argc, const char* pBlockCount)
+{
+    const char* pEnd;
+    
+    if (argc < 1)
+        __throw(invalidArgumentException);
+    pThis->blockCount = parseUnsignedInteger(pBlockCount, &pEnd);
+    if (*pEnd != '\0' || pThis->blockCount == 0 || pThis->blockCount > BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT)
+        __throw(invalidArgumentException);
+}
+
 static int parseFilenameArgument(CrackleCommandLine* pThis, int argc, const char* pArgument)
 {
     if (!pThis->pScriptFilename)
@@ -133,6 +473,119 @@ static int parseFilenameArgument(CrackleCommandLine* pThis, int argc, const char
 
 static void throwIfRequiredArgumentNotSpecified(CrackleCommandLine* pThis)
 {
+    if ((pThis->pVerifyImageFilename != NULL) + (pThis->pExtractImageFilename != NULL) + 
+        (pThis->pDiffOldFilename != NULL) > 1)
+    {
+        __throw(invalidArgumentException);
+    }
+    if ((pThis->assemblerInitParams.pPutDirectories || pThis->assemblerInitParams.pOutputDirectory) && 
+        pThis->assemblySourceCount == 0)
+    {
+        __throw(invalidArgumentException);
+    }
+    if (pThis->pVerifyImageFilename)
+    {
+        throwIfInvalidVerifyArguments(pThis);
+        return;
+    }
+    if (pThis->pExtractImageFilename)
+    {
+        throwIfInvalidExtractArguments(pThis);
+        return;
+    }
+    if (pThis->pDiffOldFilename)
+    {
+        throwIfInvalidDiffArguments(pThis);
+        return;
+    }
     if (!pThis->pScriptFilename || !pThis->pOutputImageFilename || pThis->imageFormat == FORMAT_UNKNOWN)
         __throw(invalidArgumentException);
+    if ((pThis->pLoadSequenceFilename || pThis->hasRWTS16Interleave || pThis->printRevolutions) && 
+        !hasNibbleOutput(pThis))
+    {
+        __throw(invalidArgumentException);
+    }
+    if (pThis->updateExistingImage && pThis->extraOutputCount > 0)
+        __throw(invalidArgumentException);
+    if (pThis->blockCount && !hasOutputOfFormat(pThis, FORMAT_HDV))
+        __throw(invalidArgumentException);
+    if (!pThis->blockCount)
+        pThis->blockCount = BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT;
+    pThis->assemblerInitParams.keepOutputInMemory = 1;
+}
+
+static void throwIfInvalidVerifyArguments(CrackleCommandLine* pThis)
+{
+    /* The script is optional when verifying and nothing is written so none of the output options apply. */
+    if (pThis->pOutputImageFilename || hasBuildOnlyArguments(pThis) || pThis->blockCount)
+        __throw(invalidArgumentException);
+    if (pThis->imageFormat != FORMAT_UNKNOWN && pThis->imageFormat != FORMAT_NIB_5_25)
+        __throw(invalidArgumentException);
+}
+
+static void throwIfInvalidExtractArguments(CrackleCommandLine* pThis)
+{
+    /* No script is read when extracting so the only filename argument names the output. */
+    if (!pThis->pScriptFilename || pThis->pOutputImageFilename || hasBuildOnlyArguments(pThis) || pThis->blockCount)
+        __throw(invalidArgumentException);
+    if (pThis->imageFormat != FORMAT_UNKNOWN && 
+        pThis->imageFormat != FORMAT_DSK_5_25 && 
+        pThis->imageFormat != FORMAT_PO_5_25)
+    {
+        __throw(invalidArgumentException);
+    }
+    pThis->pOutputImageFilename = pThis->pScriptFilename;
+    pThis->pScriptFilename = NULL;
+}
+
+static void throwIfInvalidDiffArguments(CrackleCommandLine* pThis)
+{
+    /* The format determines how the images are split into tracks or blocks.  The raw bytes of a woz file don't line up
+       with its tracks so it isn't supported. */
+    if (pThis->imageFormat == FORMAT_UNKNOWN || pThis->imageFormat == FORMAT_WOZ_5_25 || pThis->pOutputImageFilename)
+        __throw(invalidArgumentException);
+    if (hasBuildOnlyArguments(pThis) || (pThis->blockCount && pThis->imageFormat != FORMAT_HDV))
+        __throw(invalidArgumentException);
+    if (!pThis->blockCount)
+        pThis->blockCount = BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT;
+}
+
+static int hasBuildOnlyArguments(CrackleCommandLine* pThis)
+{
+    return pThis->updateExistingImage || pThis->extraOutputCount > 0 || pThis->printLayoutMap || 
+           pThis->writeHashes || pThis->pLoadSequenceFilename || pThis->hasRWTS16Interleave || 
+           pThis->printRevolutions || pThis->assemblySourceCount > 0;
+}
+
+static int hasNibbleOutput(CrackleCommandLine* pThis)
+{
+    unsigned int i;
+    
+    if (isNibbleFormat(pThis->imageFormat))
+        return 1;
+    for (i = 0 ; i < pThis->extraOutputCount ; i++)
+    {
+        if (isNibbleFormat(pThis->extraOutputs[i].imageFormat))
+            return 1;
+    }
+    return 0;
+}
+
+static int isNibbleFormat(CrackleImageFormat imageFormat)
+{
+    return imageFormat == FORMAT_NIB_5_25 || imageFormat == FORMAT_WOZ_5_25;
+}
+
+static int hasOutputOfFormat(CrackleCommandLine* pThis, CrackleImageFormat imageFormat)
+{
+    unsigned int i;
+    
+    if (pThis->imageFormat == imageFormat)
+        return 1;
+    for (i = 0 ; i < pThis->extraOutputCount ; i++)
+    {
+        if (pThis->extraOutputs[i].imageFormat == imageFormat)
+            return 1;
+    }
+    return 0;
 }
@@ -14,7 +14,12 @@
 #include <string.h>
 #include "DiskImagePriv.h"
 #include "DiskImageTest.h"
+#include "DiskImageHashes.h"
+#include "LzCompressor.h"
 #include "BinaryBuffer.h"
+#include "Hash64.h"
+#include "TraceLog.h"
+#include "PerfCounters.h"
 #include "util.h"
 
 
@@ -25,6 +30,7 @@ __throws void DiskImage_Init(DiskImage* pThis, DiskImageVTable* pVTable, unsigne
 {
     memset(pThis, 0, sizeof(*pThis));
     pThis->pVTable = pVTable;
+    pThis->hashRegionSize = DISK_IMAGE_BLOCK_SIZE;
     ByteBuffer_Allocate(&pThis->image, imageSize);
     DiskImageScriptEngine_Init(&pThis->script);
 }
@@ -47,11 +53,51 @@ void DiskImage_Free(DiskImage* pThis)
     ByteBuffer_Free(&pThis->object);
     ByteBuffer_Free(&pThis->image);
     DiskImageScriptEngine_Free(&pThis->script);
+    DiskImageManifest_Free(pThis->pPreviousManifest);
+    DiskImageManifest_Free(pThis->pManifest);
+    free(pThis->pInMemoryObjects);
     free(pThis);
 }
 
+void DiskImage_AddMirror(DiskImage* pThis, DiskImage* pMirror)
+{
+    while (pThis->pNextMirror)
+        pThis = pThis->pNextMirror;
+    pThis->pNextMirror = pMirror;
+}
+
+void DiskImage_DisablePlanCache(DiskImage* pThis)
+{
+    pThis->script.isPlanCacheDisabled = 1;
+}
+
+static void growInMemoryObjectArrayIfNecessary(DiskImage* pThis);
+__throws void DiskImage_AddInMemoryObjectFile(DiskImage* pThis, const BinaryBufferFile* pFile)
+{
+    growInMemoryObjectArrayIfNecessary(pThis);
+    pThis->pInMemoryObjects[pThis->inMemoryObjectCount++] = *pFile;
+}
+
+static void growInMemoryObjectArrayIfNecessary(DiskImage* pThis)
+{
+    size_t            newCount;
+    BinaryBufferFile* pRealloc;
+
+    if (pThis->inMemoryObjectCount < pThis->allocatedInMemoryObjectCount)
+        return;
+
+    newCount = pThis->allocatedInMemoryObjectCount ? pThis->allocatedInMemoryObjectCount * 2 : 16;
+    pRealloc = realloc(pThis->pInMemoryObjects, newCount * sizeof(*pRealloc));
+    if (!pRealloc)
+        __throw(outOfMemoryException);
+    pThis->pInMemoryObjects = pRealloc;
+    pThis->allocatedInMemoryObjectCount = newCount;
+}
+
 static void DiskImageScriptEngine_Free(DiskImageScriptEngine* pThis)
 {
+    DiskImagePlan_Free(pThis->pPlan);
+    DiskImageLayout_Free(pThis->pLayout);
     ParseCSV_Free(pThis->pParser);
     closeTextFile(pThis);
 }
@@ -63,39 +109,67 @@ static void closeTextFile(DiskImageScriptEngine* pThis)
 }
 
 
-#define LOG_ERROR(pTHIS, FORMAT, ...) fprintf(stderr, \
+#define LOG_ERROR(pTHIS, FORMAT, ...) (pTHIS->errorCount++, \
+                                       fprintf(stderr, \
                                        "%s:%d: error: " FORMAT LINE_ENDING, \
                                        pTHIS->pScriptFilename, \
                                        pTHIS->lineNumber, \
-                                       __VA_ARGS__)
+                                       __VA_ARGS__))
 
 static void DiskImageScriptEngine_ProcessScriptFile(DiskImageScriptEngine* pThis, 
                                                     DiskImage*              pDiskImage, 
                                                     const char*             pScriptFilename);
+static void processScriptFromTextFileUsingPlanCache(DiskImageScriptEngine* pThis);
+static char* allocateFilenameWithSuffix(const char* pFilename, const char* pSuffix);
+static uint64_t hashScriptText(DiskImageScriptEngine* pThis);
+static void compileScriptUsingPlanCache(DiskImageScriptEngine* pThis, const char* pPlanFilename, uint64_t scriptHash);
+static int loadCachedPlan(DiskImageScriptEngine* pThis, const char* pPlanFilename, uint64_t scriptHash);
+static void saveCachedPlan(DiskImageScriptEngine* pThis, const char* pPlanFilename, uint64_t scriptHash);
 static void processScriptFromTextFile(DiskImageScriptEngine* pThis);
+static void compileScriptFromTextFile(DiskImageScriptEngine* pThis);
 static int isLineAComment(const SizedString* pLine);
-static void processNextScriptLine(DiskImageScriptEngine* pThis, const SizedString* pScriptLine);
-static void processBlockScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields);
-static void readObjectFile(DiskImage* pDiskImage, const SizedString* pFilenameString);
-static unsigned int parseLengthField(DiskImageScriptEngine* pThis, const SizedString* pLengthField);
-static unsigned int parseFieldWhichSupportsAsteriskForDefaulValue(DiskImageScriptEngine* pThis, 
-                                                                  const SizedString*     pField, 
-                                                                  unsigned int           defaultValue);
-static void parseBlockRelatedFieldsAndSetInsertFields(DiskImageScriptEngine* pThis, 
-                                                      size_t fieldCount, 
-                                                      const SizedString* pFields);
+static void compileNextScriptLine(DiskImageScriptEngine* pThis, const SizedString* pScriptLine);
+static void compileBlockScriptLine(DiskImageScriptEngine* pThis, 
+                                   DiskImagePlanEntry*    pEntry, 
+                                   size_t                 fieldCount, 
+                                   const SizedString*     pFields);
+static unsigned int parseFieldWhichSupportsAsteriskForDefaultValue(DiskImagePlanEntry* pEntry, 
+                                                                   const SizedString*  pField, 
+                                                                   unsigned int        defaultFlag);
 static int isAsterisk(const SizedString* pString);
+static size_t parseCompressionField(DiskImagePlanEntry* pEntry, size_t fieldCount, const SizedString* pFields);
+static void compileRWTS16ScriptLine(DiskImageScriptEngine* pThis, 
+                                    DiskImagePlanEntry*    pEntry, 
+                                    size_t                 fieldCount, 
+                                    const SizedString*     pFields);
+static void compileRWTS16CPScriptLine(DiskImageScriptEngine* pThis, 
+                                      DiskImagePlanEntry*    pEntry, 
+                                      size_t                 fieldCount, 
+                                      const SizedString*     pFields);
+static void compileRW18ScriptLine(DiskImageScriptEngine* pThis, 
+                                  DiskImagePlanEntry*    pEntry, 
+                                  size_t                 fieldCount, 
+                                  const SizedString*     pFields);
+static void validateInsertDestination(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry);
+static void executePlan(DiskImageScriptEngine* pThis);
+static void executePlanEntry(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry);
+static void insertIntoMirrors(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry, const char* pObjectFilename);
+static void recordInsertExtent(DiskImageScriptEngine* pThis);
+static void reportOverlappingInserts(DiskImageScriptEngine* pThis);
+static void reportOverlap(void* pContext, const DiskImageExtent* pEarlier, const DiskImageExtent* pLater);
+static void resolveDefaultFields(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry);
 static void setBlockInsertFieldsBasedOnLastInsertion(DiskImageScriptEngine* pThis);
-static void setBlockInsertFieldsBaseOnScriptFields(DiskImageScriptEngine* pThis, 
-                                                   size_t fieldCount, 
-                                                   const SizedString* pFields);
 static void rememberLastInsertionInformation(DiskImageScriptEngine* pThis);
-static void processRWTS16ScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields);
-static void processRWTS16CPScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields);
-static void processRW18ScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields);
+static void compressObjectFile(DiskImageScriptEngine* pThis);
 static void processImageTableUpdates(DiskImageScriptEngine* pThis, unsigned short newImageTableAddress);
 static unsigned short getImageTableObjectSize(DiskImage* pDiskImage, unsigned short startImageTableAddress);
-static void reportScriptLineException(DiskImageScriptEngine* pThis);
+static void reportPlanEntryException(DiskImageScriptEngine* pThis, 
+                                     const DiskImagePlanEntry* pEntry, 
+                                     const char* pObjectFilename);
+static const char* insertionTypeName(DiskImageInsertionType type);
+static void reportScriptLineException(DiskImageScriptEngine* pThis, 
+                                      const SizedString*     pTypeName, 
+                                      const SizedString*     pObjectFilename);
 __throws void DiskImage_ProcessScriptFile(DiskImage* pThis, const char* pScriptFilename)
 {
     DiskImageScriptEngine_ProcessScriptFile(&pThis->script, pThis, pScriptFilename);
@@ -118,20 +192,137 @@ static void DiskImageScriptEngine_ProcessScriptFile(DiskImageScriptEngine* pThis
         __rethrow;
     }
     
-    processScriptFromTextFile(pThis);
+    if (pThis->isPlanCacheDisabled)
+        processScriptFromTextFile(pThis);
+    else
+        processScriptFromTextFileUsingPlanCache(pThis);
+}
+
+static void processScriptFromTextFileUsingPlanCache(DiskImageScriptEngine* pThis)
+{
+    char*    pPlanFilename = NULL;
+    uint64_t scriptHash;
+    
+    __try
+    {
+        pPlanFilename = allocateFilenameWithSuffix(pThis->pScriptFilename, DISK_IMAGE_PLAN_SUFFIX);
+        scriptHash = hashScriptText(pThis);
+        compileScriptUsingPlanCache(pThis, pPlanFilename, scriptHash);
+        closeTextFile(pThis);
+        executePlan(pThis);
+    }
+    __catch
+    {
+        free(pPlanFilename);
+        __rethrow;
+    }
+    free(pPlanFilename);
+}
+
+static void compileScriptUsingPlanCache(DiskImageScriptEngine* pThis, const char* pPlanFilename, uint64_t scriptHash)
+{
+    TraceLog_Begin("crackle", "compile %s", pThis->pScriptFilename);
+    __try
+    {
+        if (!loadCachedPlan(pThis, pPlanFilename, scriptHash))
+        {
+            compileScriptFromTextFile(pThis);
+            if (pThis->errorCount == 0)
+                saveCachedPlan(pThis, pPlanFilename, scriptHash);
+        }
+    }
+    __catch
+    {
+        TraceLog_End();
+        __rethrow;
+    }
+    TraceLog_End();
+}
+
+static char* allocateFilenameWithSuffix(const char* pFilename, const char* pSuffix)
+{
+    size_t filenameLength = strlen(pFilename);
+    size_t suffixLength = strlen(pSuffix);
+    char*  pFilenameWithSuffix = allocateAndZero(filenameLength + suffixLength + 1);
+    
+    memcpy(pFilenameWithSuffix, pFilename, filenameLength);
+    memcpy(pFilenameWithSuffix + filenameLength, pSuffix, suffixLength + 1);
+    
+    return pFilenameWithSuffix;
+}
+
+static uint64_t hashScriptText(DiskImageScriptEngine* pThis)
+{
+    /* Plans are validated against the output image so its size is folded into the hash as well. */
+    uint64_t hash = pThis->pDiskImage->image.bufferSize;
+    
+    while (!TextFile_IsEndOfFile(pThis->pTextFile))
+    {
+        SizedString line = TextFile_GetNextLine(pThis->pTextFile);
+        hash = Hash64_Buffer(line.pString, line.stringLength, hash + 1);
+    }
+    TextFile_Reset(pThis->pTextFile);
+    
+    return hash;
+}
+
+static int loadCachedPlan(DiskImageScriptEngine* pThis, const char* pPlanFilename, uint64_t scriptHash)
+{
+    DiskImagePlan* pPlan = NULL;
+    
+    __try
+    {
+        pPlan = DiskImagePlan_CreateFromFile(pPlanFilename, scriptHash);
+    }
+    __catch
+    {
+        __nothrow_and_return(0);
+    }
+    
+    /* Plans are only cached once they compile without errors so the count starts again from zero, just as it does
+       when compiling, rather than keeping the errors from an earlier pass such as the one before an update rebuild. */
+    DiskImagePlan_Free(pThis->pPlan);
+    pThis->pPlan = pPlan;
+    pThis->errorCount = 0;
+    return 1;
+}
+
+static void saveCachedPlan(DiskImageScriptEngine* pThis, const char* pPlanFilename, uint64_t scriptHash)
+{
+    /* The plan is only a cache so failing to write it shouldn't fail the image build. */
+    __try
+    {
+        DiskImagePlan_WriteToFile(pThis->pPlan, pPlanFilename, scriptHash);
+    }
+    __catch
+    {
+        remove(pPlanFilename);
+        __nothrow;
+    }
 }
 
 static void processScriptFromTextFile(DiskImageScriptEngine* pThis)
 {
+    compileScriptFromTextFile(pThis);
+    closeTextFile(pThis);
+    executePlan(pThis);
+}
+
+static void compileScriptFromTextFile(DiskImageScriptEngine* pThis)
+{
+    DiskImagePlan_Free(pThis->pPlan);
+    pThis->pPlan = NULL;
+    pThis->pPlan = DiskImagePlan_Create();
+    pThis->errorCount = 0;
+    
     pThis->lineNumber = 1;
     while (!TextFile_IsEndOfFile(pThis->pTextFile))
     {
         SizedString nextLine = TextFile_GetNextLine(pThis->pTextFile);
         if (!isLineAComment(&nextLine))
-            processNextScriptLine(pThis, &nextLine);
+            compileNextScriptLine(pThis, &nextLine);
         pThis->lineNumber++;
     }
-    closeTextFile(pThis);
 }
 
 static int isLineAComment(const SizedString* pLine)
@@ -139,10 +330,11 @@ static int isLineAComment(const SizedString* pLine)
     return pLine->pString[0] == '#';
 }
 
-static void processNextScriptLine(DiskImageScriptEngine* pThis, const SizedString* pScriptLine)
+static void compileNextScriptLine(DiskImageScriptEngine* pThis, const SizedString* pScriptLine)
 {
     size_t             fieldCount;
     const SizedString* pFields;
+    DiskImagePlanEntry entry;
     
     ParseCSV_Parse(pThis->pParser, pScriptLine);
     fieldCount = ParseCSV_FieldCount(pThis->pParser);
@@ -153,76 +345,73 @@ static void processNextScriptLine(DiskImageScriptEngine* pThis, const SizedStrin
         return;
     }
     
+    memset(&entry, 0, sizeof(entry));
+    entry.lineNumber = pThis->lineNumber;
+    entry.objectFilenameOffset = DISK_IMAGE_PLAN_NO_OBJECT;
     __try
     {
         if (0 == SizedString_strcasecmp(&pFields[0], "block"))
-            processBlockScriptLine(pThis, fieldCount, pFields);
+            compileBlockScriptLine(pThis, &entry, fieldCount, pFields);
         else if (0 == SizedString_strcasecmp(&pFields[0], "rwts16"))
-            processRWTS16ScriptLine(pThis, fieldCount, pFields);
+            compileRWTS16ScriptLine(pThis, &entry, fieldCount, pFields);
         else if (0 == SizedString_strcasecmp(&pFields[0], "rwts16cp"))
-            processRWTS16CPScriptLine(pThis, fieldCount, pFields);
+            compileRWTS16CPScriptLine(pThis, &entry, fieldCount, pFields);
         else if (0 == SizedString_strcasecmp(&pFields[0], "rw18"))
-            processRW18ScriptLine(pThis, fieldCount, pFields);
+            compileRW18ScriptLine(pThis, &entry, fieldCount, pFields);
         else
+        {
             LOG_ERROR(pThis, "%.*s isn't a recognized image insertion type of BLOCK or RWTS16.", 
                       pFields[0].stringLength, pFields[0].pString);
+            __throw(invalidArgumentException);
+        }
+        validateInsertDestination(pThis, &entry);
+        DiskImagePlan_Append(pThis->pPlan, &entry);
     }
     __catch
     {
-        reportScriptLineException(pThis);
+        reportScriptLineException(pThis, &pFields[0], &pFields[1]);
         __nothrow;
     }
 }
 
-static void processBlockScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields)
+static void compileBlockScriptLine(DiskImageScriptEngine* pThis, 
+                                   DiskImagePlanEntry*    pEntry, 
+                                   size_t                 fieldCount, 
+                                   const SizedString*     pFields)
 {
+    fieldCount = parseCompressionField(pEntry, fieldCount, pFields);
     if (fieldCount < 5 || fieldCount > 6)
     {
         LOG_ERROR(pThis, 
-                  "%s doesn't contain correct fields: BLOCK,objectFilename,objectStartOffset,insertionLength,block[,intraBlockOffset]",
+                  "%s doesn't contain correct fields: BLOCK,objectFilename,objectStartOffset,insertionLength,block[,intraBlockOffset][,LZ]",
                   "Line");
         __throw(invalidArgumentException);
     }
     
-    readObjectFile(pThis->pDiskImage, &pFields[1]);
-    pThis->insert.sourceOffset = SizedString_strtoul(&pFields[2], NULL, 0);
-    pThis->insert.length = parseLengthField(pThis, &pFields[3]);
-    pThis->insert.type = DISK_IMAGE_INSERTION_BLOCK;
-    parseBlockRelatedFieldsAndSetInsertFields(pThis, fieldCount, pFields);
-    rememberLastInsertionInformation(pThis);
-    DiskImage_InsertObjectFile(pThis->pDiskImage, &pThis->insert);
-}
-
-static void readObjectFile(DiskImage* pDiskImage, const SizedString* pFilenameString)
-{
-    char* pFilename = NULL;
-    
-    __try
+    pEntry->objectFilenameOffset = DiskImagePlan_AddObjectFilename(pThis->pPlan, &pFields[1]);
+    pEntry->insert.type = DISK_IMAGE_INSERTION_BLOCK;
+    pEntry->insert.sourceOffset = SizedString_strtoul(&pFields[2], NULL, 0);
+    pEntry->insert.length = parseFieldWhichSupportsAsteriskForDefaultValue(pEntry, &pFields[3], 
+                                                                           DISK_IMAGE_PLAN_DEFAULT_LENGTH);
+    if (isAsterisk(&pFields[4]))
     {
-        pFilename = SizedString_strdup(pFilenameString);
-        DiskImage_ReadObjectFile(pDiskImage, pFilename);
-    }
-    __catch
-    {
-        free(pFilename);
-        __rethrow;
+        pEntry->flags |= DISK_IMAGE_PLAN_DEFAULT_BLOCK;
+        return;
     }
-    free(pFilename);
-}
-
-static unsigned int parseLengthField(DiskImageScriptEngine* pThis, const SizedString* pLengthField)
-{
-    return parseFieldWhichSupportsAsteriskForDefaulValue(pThis, pLengthField, pThis->pDiskImage->objectFileLength);
+    pEntry->insert.block = SizedString_strtoul(&pFields[4], NULL, 0);
+    if (fieldCount > 5)
+        pEntry->insert.intraBlockOffset = SizedString_strtoul(&pFields[5], NULL, 0);
 }
 
-static unsigned int parseFieldWhichSupportsAsteriskForDefaulValue(DiskImageScriptEngine* pThis, 
-                                                                  const SizedString*     pField, 
-                                                                  unsigned int           defaultValue)
+static unsigned int parseFieldWhichSupportsAsteriskForDefaultValue(DiskImagePlanEntry* pEntry, 
+                                                                   const SizedString*  pField, 
+                                                                   unsigned int        defaultFlag)
 {
-    if (isAsterisk(pField))
-        return defaultValue;
-    else
+    if (!isAsterisk(pField))
         return SizedString_strtoul(pField, NULL, 0);
+
+    pEntry->flags |= defaultFlag;
+    return 0;
 }
 
 static int isAsterisk(const SizedString* pString)
@@ -230,62 +419,42 @@ static int isAsterisk(const SizedString* pString)
     return 0 == SizedString_strcmp(pString, "*");
 }
 
-static void parseBlockRelatedFieldsAndSetInsertFields(DiskImageScriptEngine* pThis, 
-                                                      size_t fieldCount, 
-                                                      const SizedString* pFields)
-{
-    const SizedString* pBlockField = &pFields[4];
-
-    if (isAsterisk(pBlockField))
-        setBlockInsertFieldsBasedOnLastInsertion(pThis);
-    else
-        setBlockInsertFieldsBaseOnScriptFields(pThis, fieldCount, pFields);
-}
-
-static void setBlockInsertFieldsBasedOnLastInsertion(DiskImageScriptEngine* pThis)
-{
-    unsigned int lastOffset = pThis->lastBlock * DISK_IMAGE_BLOCK_SIZE + pThis->lastLength;
-    pThis->insert.block = lastOffset / DISK_IMAGE_BLOCK_SIZE;
-    pThis->insert.intraBlockOffset = lastOffset % DISK_IMAGE_BLOCK_SIZE;
-}
-
-static void setBlockInsertFieldsBaseOnScriptFields(DiskImageScriptEngine* pThis, 
-                                                   size_t fieldCount, 
-                                                   const SizedString* pFields)
+static size_t parseCompressionField(DiskImagePlanEntry* pEntry, size_t fieldCount, const SizedString* pFields)
 {
-    pThis->insert.block = SizedString_strtoul(&pFields[4], NULL, 0);
-    if (fieldCount > 5)
-        pThis->insert.intraBlockOffset = SizedString_strtoul(&pFields[5], NULL, 0);
-    else
-        pThis->insert.intraBlockOffset = 0;
-}
+    if (fieldCount < 2 || 0 != SizedString_strcasecmp(&pFields[fieldCount - 1], "lz"))
+        return fieldCount;
 
-static void rememberLastInsertionInformation(DiskImageScriptEngine* pThis)
-{
-    pThis->lastBlock = pThis->insert.block;
-    pThis->lastLength = pThis->insert.length;
+    pEntry->flags |= DISK_IMAGE_PLAN_COMPRESS;
+    return fieldCount - 1;
 }
 
-static void processRWTS16ScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields)
+static void compileRWTS16ScriptLine(DiskImageScriptEngine* pThis, 
+                                    DiskImagePlanEntry*    pEntry, 
+                                    size_t                 fieldCount, 
+                                    const SizedString*     pFields)
 {
+    fieldCount = parseCompressionField(pEntry, fieldCount, pFields);
     if (fieldCount != 6)
     {
         LOG_ERROR(pThis, 
-                  "%s doesn't contain correct fields: RWTS16,objectFilename,objectStartOffset,insertionLength,track,sector",
+                  "%s doesn't contain correct fields: RWTS16,objectFilename,objectStartOffset,insertionLength,track,sector[,LZ]",
                   "Line");
         __throw(invalidArgumentException);
     }
     
-    readObjectFile(pThis->pDiskImage, &pFields[1]);
-    pThis->insert.sourceOffset = SizedString_strtoul(&pFields[2], NULL, 0);
-    pThis->insert.length = parseLengthField(pThis, &pFields[3]);
-    pThis->insert.type = DISK_IMAGE_INSERTION_RWTS16;
-    pThis->insert.track = SizedString_strtoul(&pFields[4], NULL, 0);
-    pThis->insert.sector = SizedString_strtoul(&pFields[5], NULL, 0);
-    DiskImage_InsertObjectFile(pThis->pDiskImage, &pThis->insert);
+    pEntry->objectFilenameOffset = DiskImagePlan_AddObjectFilename(pThis->pPlan, &pFields[1]);
+    pEntry->insert.type = DISK_IMAGE_INSERTION_RWTS16;
+    pEntry->insert.sourceOffset = SizedString_strtoul(&pFields[2], NULL, 0);
+    pEntry->insert.length = parseFieldWhichSupportsAsteriskForDefaultValue(pEntry, &pFields[3], 
+                                                                           DISK_IMAGE_PLAN_DEFAULT_LENGTH);
+    pEntry->insert.track = SizedString_strtoul(&pFields[4], NULL, 0);
+    pEntry->insert.sector = SizedString_strtoul(&pFields[5], NULL, 0);
 }
 
-static void processRWTS16CPScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields)
+static void compileRWTS16CPScriptLine(DiskImageScriptEngine* pThis, 
+                                      DiskImagePlanEntry*    pEntry, 
+                                      size_t                 fieldCount, 
+                                      const SizedString*     pFields)
 {
     if (fieldCount != 3)
     {
@@ -295,40 +464,209 @@ static void processRWTS16CPScriptLine(DiskImageScriptEngine* pThis, size_t field
         __throw(invalidArgumentException);
     }
 
-    pThis->pDiskImage->objectFileLength = 0;
-    pThis->insert.sourceOffset = 0;
-    pThis->insert.length = 0;
-    pThis->insert.type = DISK_IMAGE_INSERTION_RWTS16CP;
-    pThis->insert.track = SizedString_strtoul(&pFields[1], NULL, 0);
-    pThis->insert.sector = SizedString_strtoul(&pFields[2], NULL, 0);
-    DiskImage_InsertObjectFile(pThis->pDiskImage, &pThis->insert);
+    pEntry->insert.type = DISK_IMAGE_INSERTION_RWTS16CP;
+    pEntry->insert.track = SizedString_strtoul(&pFields[1], NULL, 0);
+    pEntry->insert.sector = SizedString_strtoul(&pFields[2], NULL, 0);
 }
 
-static void processRW18ScriptLine(DiskImageScriptEngine* pThis, size_t fieldCount, const SizedString* pFields)
+static void compileRW18ScriptLine(DiskImageScriptEngine* pThis, 
+                                  DiskImagePlanEntry*    pEntry, 
+                                  size_t                 fieldCount, 
+                                  const SizedString*     pFields)
 {
+    fieldCount = parseCompressionField(pEntry, fieldCount, pFields);
     if (fieldCount < 7 || fieldCount > 8)
     {
         LOG_ERROR(pThis, 
                   "%s doesn't contain correct fields: "
-                    "RW18,objectFilename,objectStartOffset,insertionLength,side,track,offset[,imageTableAddress]",
+                    "RW18,objectFilename,objectStartOffset,insertionLength,side,track,offset[,imageTableAddress][,LZ]",
                   "Line");
         __throw(invalidArgumentException);
     }
     
-    readObjectFile(pThis->pDiskImage, &pFields[1]);
-    pThis->insert.type = DISK_IMAGE_INSERTION_RW18;
-    pThis->insert.sourceOffset = SizedString_strtoul(&pFields[2], NULL, 0);
-    pThis->insert.length = parseLengthField(pThis, &pFields[3]);
-    pThis->insert.side = parseFieldWhichSupportsAsteriskForDefaulValue(pThis, &pFields[4], 
-                                                                       pThis->pDiskImage->insert.side);
-    pThis->insert.track = parseFieldWhichSupportsAsteriskForDefaulValue(pThis, &pFields[5], 
-                                                                        pThis->pDiskImage->insert.track);
-    pThis->insert.intraTrackOffset = parseFieldWhichSupportsAsteriskForDefaulValue(pThis, &pFields[6], 
-                                                                                   pThis->pDiskImage->insert.intraTrackOffset);
+    pEntry->objectFilenameOffset = DiskImagePlan_AddObjectFilename(pThis->pPlan, &pFields[1]);
+    pEntry->insert.type = DISK_IMAGE_INSERTION_RW18;
+    pEntry->insert.sourceOffset = SizedString_strtoul(&pFields[2], NULL, 0);
+    pEntry->insert.length = parseFieldWhichSupportsAsteriskForDefaultValue(pEntry, &pFields[3], 
+                                                                           DISK_IMAGE_PLAN_DEFAULT_LENGTH);
+    pEntry->insert.side = parseFieldWhichSupportsAsteriskForDefaultValue(pEntry, &pFields[4], 
+                                                                         DISK_IMAGE_PLAN_DEFAULT_SIDE);
+    pEntry->insert.track = parseFieldWhichSupportsAsteriskForDefaultValue(pEntry, &pFields[5], 
+                                                                          DISK_IMAGE_PLAN_DEFAULT_TRACK);
+    pEntry->insert.intraTrackOffset = parseFieldWhichSupportsAsteriskForDefaultValue(pEntry, &pFields[6], 
+                                                                                     DISK_IMAGE_PLAN_DEFAULT_OFFSET);
     if (fieldCount > 7)
-        processImageTableUpdates(pThis, SizedString_strtoul(&pFields[7], NULL, 0));
+    {
+        pEntry->flags |= DISK_IMAGE_PLAN_HAS_IMAGE_TABLE;
+        pEntry->imageTableAddress = SizedString_strtoul(&pFields[7], NULL, 0);
+    }
+}
+
+static void validateInsertDestination(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry)
+{
+    /* Fields which won't be known until the plan is executed are replaced with values that always pass validation
+       so that the rest of the line can still be checked before anything is written to the image. */
+    DiskImage* pDiskImage = pThis->pDiskImage;
+    
+    pThis->insert = pEntry->insert;
+    if (pEntry->flags & (DISK_IMAGE_PLAN_DEFAULT_LENGTH | DISK_IMAGE_PLAN_HAS_IMAGE_TABLE))
+        pThis->insert.length = 0;
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_BLOCK)
+    {
+        pThis->insert.block = 0;
+        pThis->insert.intraBlockOffset = 0;
+    }
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_SIDE)
+        pThis->insert.side = DISK_IMAGE_RW18_SIDE_0;
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_TRACK)
+        pThis->insert.track = 0;
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_OFFSET)
+        pThis->insert.intraTrackOffset = 0;
+
+    if (pDiskImage->pVTable->validateInsert)
+        pDiskImage->pVTable->validateInsert(pDiskImage, &pThis->insert);
+}
+
+static void executePlan(DiskImageScriptEngine* pThis)
+{
+    size_t entryCount = DiskImagePlan_GetEntryCount(pThis->pPlan);
+    size_t i;
+    
+    if (!pThis->pLayout)
+        pThis->pLayout = DiskImageLayout_Create();
+    DiskImageLayout_Clear(pThis->pLayout);
+    
+    TraceLog_Begin("crackle", "execute %s", pThis->pScriptFilename ? pThis->pScriptFilename : "script");
+    for (i = 0 ; i < entryCount ; i++)
+        executePlanEntry(pThis, DiskImagePlan_GetEntry(pThis->pPlan, i));
+    reportOverlappingInserts(pThis);
+    TraceLog_End();
+}
+
+static void executePlanEntry(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry)
+{
+    const char* pObjectFilename = DiskImagePlan_GetObjectFilename(pThis->pPlan, pEntry);
+    
+    pThis->lineNumber = pEntry->lineNumber;
+    pThis->insert = pEntry->insert;
+    TraceLog_Begin("script", "line %u %s", pEntry->lineNumber, pObjectFilename ? pObjectFilename : "");
+    PerfCounters_Begin("script line");
+    __try
+    {
+        if (pObjectFilename)
+            DiskImage_ReadObjectFile(pThis->pDiskImage, pObjectFilename);
+        else
+            pThis->pDiskImage->objectFileLength = 0;
+        resolveDefaultFields(pThis, pEntry);
+        if (pEntry->flags & DISK_IMAGE_PLAN_HAS_IMAGE_TABLE)
+            processImageTableUpdates(pThis, pEntry->imageTableAddress);
+        if (pEntry->flags & DISK_IMAGE_PLAN_COMPRESS)
+            compressObjectFile(pThis);
+        if (pThis->insert.type == DISK_IMAGE_INSERTION_BLOCK)
+            rememberLastInsertionInformation(pThis);
+        DiskImage_InsertObjectFile(pThis->pDiskImage, &pThis->insert);
+        recordInsertExtent(pThis);
+    }
+    __catch
+    {
+        reportPlanEntryException(pThis, pEntry, pObjectFilename);
+        __nothrow;
+    }
+    insertIntoMirrors(pThis, pEntry, pObjectFilename);
+    PerfCounters_End();
+    TraceLog_End();
+}
 
-    DiskImage_InsertObjectFile(pThis->pDiskImage, &pThis->insert);
+static void insertIntoMirrors(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry, const char* pObjectFilename)
+{
+    /* The object file, image table updates, and defaulted fields have already been resolved for the primary image so
+       the mirrors just encode the same insertion from its object buffer. */
+    DiskImage* pDiskImage = pThis->pDiskImage;
+    DiskImage* pMirror;
+    
+    for (pMirror = pDiskImage->pNextMirror ; pMirror ; pMirror = pMirror->pNextMirror)
+    {
+        __try
+        {
+            if (pMirror->pVTable->validateInsert)
+                pMirror->pVTable->validateInsert(pMirror, &pThis->insert);
+            pMirror->pVTable->insertData(pMirror, pDiskImage->object.pBuffer, &pThis->insert);
+        }
+        __catch
+        {
+            reportPlanEntryException(pThis, pEntry, pObjectFilename);
+            clearExceptionCode();
+        }
+    }
+}
+
+static void recordInsertExtent(DiskImageScriptEngine* pThis)
+{
+    DiskImage*      pDiskImage = pThis->pDiskImage;
+    DiskImageExtent extents[DISK_IMAGE_MAX_EXTENTS_PER_INSERT];
+    size_t          extentCount;
+    size_t          i;
+    
+    memset(extents, 0, sizeof(extents));
+    extentCount = pDiskImage->pVTable->calculateExtents(pDiskImage, &pThis->insert, extents);
+    for (i = 0 ; i < extentCount ; i++)
+    {
+        extents[i].lineNumber = pThis->lineNumber;
+        if (extents[i].end > extents[i].start)
+            DiskImageLayout_Add(pThis->pLayout, &extents[i]);
+    }
+}
+
+static void reportOverlappingInserts(DiskImageScriptEngine* pThis)
+{
+    DiskImageLayout_FindOverlaps(pThis->pLayout, reportOverlap, pThis);
+}
+
+static void reportOverlap(void* pContext, const DiskImageExtent* pEarlier, const DiskImageExtent* pLater)
+{
+    DiskImageScriptEngine* pThis = (DiskImageScriptEngine*)pContext;
+    
+    pThis->lineNumber = pLater->lineNumber;
+    LOG_ERROR(pThis, "Write overlaps data already inserted by line %u.", pEarlier->lineNumber);
+}
+
+static void resolveDefaultFields(DiskImageScriptEngine* pThis, const DiskImagePlanEntry* pEntry)
+{
+    DiskImage* pDiskImage = pThis->pDiskImage;
+    
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_LENGTH)
+        pThis->insert.length = pDiskImage->objectFileLength;
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_BLOCK)
+        setBlockInsertFieldsBasedOnLastInsertion(pThis);
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_SIDE)
+        pThis->insert.side = pDiskImage->insert.side;
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_TRACK)
+        pThis->insert.track = pDiskImage->insert.track;
+    if (pEntry->flags & DISK_IMAGE_PLAN_DEFAULT_OFFSET)
+        pThis->insert.intraTrackOffset = pDiskImage->insert.intraTrackOffset;
+}
+
+static void setBlockInsertFieldsBasedOnLastInsertion(DiskImageScriptEngine* pThis)
+{
+    unsigned int lastOffset = pThis->lastBlock * DISK_IMAGE_BLOCK_SIZE + pThis->lastLength;
+    pThis->insert.block = lastOffset / DISK_IMAGE_BLOCK_SIZE;
+    pThis->insert.intraBlockOffset = lastOffset % DISK_IMAGE_BLOCK_SIZE;
+}
+
+static void rememberLastInsertionInformation(DiskImageScriptEngine* pThis)
+{
+    pThis->lastBlock = pThis->insert.block;
+    pThis->lastLength = pThis->insert.length;
+}
+
+static void compressObjectFile(DiskImageScriptEngine* pThis)
+{
+    unsigned int uncompressedLength = pThis->insert.length;
+    
+    DiskImage_CompressObjectFile(pThis->pDiskImage, &pThis->insert);
+    printf("%s:%u: compressed %u bytes to %u bytes (%u%%)." LINE_ENDING, 
+           pThis->pScriptFilename, pThis->lineNumber, uncompressedLength, pThis->insert.length, 
+           uncompressedLength ? (unsigned int)((uint64_t)pThis->insert.length * 100 / uncompressedLength) : 100);
 }
 
 static void processImageTableUpdates(DiskImageScriptEngine* pThis, unsigned short newImageTableAddress)
@@ -355,13 +693,42 @@ static unsigned short getImageTableObjectSize(DiskImage* pDiskImage, unsigned sh
     return (lastImageTableAddress - startImageTableAddress);
 }
 
-static void reportScriptLineException(DiskImageScriptEngine* pThis)
+static void reportPlanEntryException(DiskImageScriptEngine*    pThis, 
+                                     const DiskImagePlanEntry* pEntry, 
+                                     const char*               pObjectFilename)
 {
-    const SizedString* pFields = ParseCSV_FieldPointers(pThis->pParser);
-    int                exceptionCode = getExceptionCode();
+    SizedString typeName = SizedString_InitFromString(insertionTypeName(pEntry->insert.type));
+    SizedString objectFilename = SizedString_InitFromString(pObjectFilename ? pObjectFilename : "");
+    
+    reportScriptLineException(pThis, &typeName, &objectFilename);
+}
+
+static const char* insertionTypeName(DiskImageInsertionType type)
+{
+    switch (type)
+    {
+    case DISK_IMAGE_INSERTION_RWTS16:
+        return "RWTS16";
+    case DISK_IMAGE_INSERTION_RW18:
+        return "RW18";
+    case DISK_IMAGE_INSERTION_BLOCK:
+        return "BLOCK";
+    case DISK_IMAGE_INSERTION_RWTS16CP:
+        return "RWTS16CP";
+    default:
+        return "";
+    }
+}
+
+static void reportScriptLineException(DiskImageScriptEngine* pThis, 
+                                      const SizedString*     pTypeName, 
+                                      const SizedString*     pObjectFilename)
+{
+    int exceptionCode = getExceptionCode();
     
     assert ( exceptionCode == fileOpenException ||
              exceptionCode == fileException || 
+             exceptionCode == outOfMemoryException ||
              exceptionCode == invalidArgumentException ||
              exceptionCode == blockExceedsImageBoundsException ||
              exceptionCode == invalidInsertionTypeException ||
@@ -376,16 +743,18 @@ static void reportScriptLineException(DiskImageScriptEngine* pThis)
     /* Note: invalidArgumentException prints error text before throwing. */
     if (exceptionCode == fileOpenException)
         LOG_ERROR(pThis, "Failed to open '%.*s' object file.", 
-                  pFields[1].stringLength, pFields[1].pString);
+                  pObjectFilename->stringLength, pObjectFilename->pString);
     else if (exceptionCode == fileException)
         LOG_ERROR(pThis, "Failed to process '%.*s' object file.", 
-                  pFields[1].stringLength, pFields[1].pString);
+                  pObjectFilename->stringLength, pObjectFilename->pString);
+    else if (exceptionCode == outOfMemoryException)
+        LOG_ERROR(pThis, "%s", "Ran out of memory.");
     else if (exceptionCode == blockExceedsImageBoundsException)
         LOG_ERROR(pThis, "Write starting at block %u offset %u won't fit in output image file.", 
                   pThis->insert.block, pThis->insert.intraBlockOffset);
     else if (exceptionCode == invalidInsertionTypeException)
         LOG_ERROR(pThis, "%.*s insertion type isn't supported for this output image type.", 
-                  pFields[0].stringLength, pFields[0].pString);
+                  pTypeName->stringLength, pTypeName->pString);
     else if (exceptionCode == invalidSideException)
         LOG_ERROR(pThis, "0x%x specifies an invalid side.  Must be 0xa9, 0xad, 0x79.", pThis->insert.side);
     else if (exceptionCode == invalidSectorException)
@@ -434,14 +803,23 @@ static void determineObjectSizeFromFileHeader(DiskImage* pThis, FILE* pFile);
 static int wasSAVedFromAssembler(const char* pSignature);
 static int wasRW18SAVedFromAssembler(const char* pSignature);
 static void readInRW18SavHeaderToSetDefaultInsertOptions(DiskImage* pThis, FILE* pFile, void* pvPartialHeader);
+static void setDefaultInsertOptionsFromRW18Header(DiskImage* pThis, const RW18SavFileHeader* pHeader);
 static RW18SavFileHeader readInRestOfRW18FileHeader(DiskImage* pThis, FILE* pFile, void* pPartialHeader);
 static long getFileSize(FILE* pFile);
 static unsigned int roundUpLengthToBlockSize(unsigned int length);
+static const BinaryBufferFile* findInMemoryObjectFile(DiskImage* pThis, const char* pFilename);
+static void readInMemoryObjectFile(DiskImage* pThis, const BinaryBufferFile* pObjectFile);
 __throws void DiskImage_ReadObjectFile(DiskImage* pThis, const char* pFilename)
 {
-    FILE*         pFile = NULL;
-    unsigned int  roundedObjectSize;
+    const BinaryBufferFile* pInMemoryObjectFile = findInMemoryObjectFile(pThis, pFilename);
+    FILE*                   pFile = NULL;
+    unsigned int            roundedObjectSize;
     
+    if (pInMemoryObjectFile)
+    {
+        readInMemoryObjectFile(pThis, pInMemoryObjectFile);
+        return;
+    }
     __try
     {
         pFile = openFile(pFilename, "rb");
@@ -461,6 +839,29 @@ __throws void DiskImage_ReadObjectFile(DiskImage* pThis, const char* pFilename)
     fclose(pFile);    
 }
 
+static const BinaryBufferFile* findInMemoryObjectFile(DiskImage* pThis, const char* pFilename)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pThis->inMemoryObjectCount ; i++)
+    {
+        if (0 == strcmp(pThis->pInMemoryObjects[i].pFilename, pFilename))
+            return &pThis->pInMemoryObjects[i];
+    }
+    return NULL;
+}
+
+static void readInMemoryObjectFile(DiskImage* pThis, const BinaryBufferFile* pObjectFile)
+{
+    /* The assembler already split out the header fields so they are used as is rather than parsed from a file. */
+    memset(&pThis->insert, 0, sizeof(pThis->insert));
+    pThis->objectFileLength = pObjectFile->contentLength;
+    if (pObjectFile->pRW18Header)
+        setDefaultInsertOptionsFromRW18Header(pThis, pObjectFile->pRW18Header);
+    ByteBuffer_Allocate(&pThis->object, roundUpLengthToBlockSize(pThis->objectFileLength));
+    memcpy(pThis->object.pBuffer, pObjectFile->pContent, pThis->objectFileLength);
+}
+
 static FILE* openFile(const char* pFilename, const char* pMode)
 {
     FILE* pFile = fopen(pFilename, pMode);
@@ -504,12 +905,17 @@ static void readInRW18SavHeaderToSetDefaultInsertOptions(DiskImage* pThis, FILE*
 {
     RW18SavFileHeader rw18Header = readInRestOfRW18FileHeader(pThis, pFile, pPartialHeader);
 
-    pThis->objectFileLength = rw18Header.length;
+    setDefaultInsertOptionsFromRW18Header(pThis, &rw18Header);
+}
+
+static void setDefaultInsertOptionsFromRW18Header(DiskImage* pThis, const RW18SavFileHeader* pHeader)
+{
+    pThis->objectFileLength = pHeader->length;
     pThis->insert.type = DISK_IMAGE_INSERTION_RW18;
-    pThis->insert.length = rw18Header.length;
-    pThis->insert.side = rw18Header.side;
-    pThis->insert.track = rw18Header.track;
-    pThis->insert.intraTrackOffset = rw18Header.offset;
+    pThis->insert.length = pHeader->length;
+    pThis->insert.side = pHeader->side;
+    pThis->insert.track = pHeader->track;
+    pThis->insert.intraTrackOffset = pHeader->offset;
 }
 
 static RW18SavFileHeader readInRestOfRW18FileHeader(DiskImage* pThis, FILE* pFile, void* pPartialHeader)
@@ -598,10 +1004,43 @@ static void updateImageTableAddresses(DiskImage* pThis, unsigned short newImageT
 
 
 static void validateSourceObjectParameters(DiskImage* pThis, DiskImageInsert* pInsert);
+__throws void DiskImage_CompressObjectFile(DiskImage* pThis, DiskImageInsert* pInsert)
+{
+    ByteBuffer compressed = { NULL, 0 };
+    size_t     compressedLength;
+    
+    validateSourceObjectParameters(pThis, pInsert);
+    __try
+    {
+        ByteBuffer_Allocate(&compressed, roundUpLengthToBlockSize(LZ_COMPRESSOR_BOUND(pInsert->length)));
+        compressedLength = LzCompressor_Compress(compressed.pBuffer, compressed.bufferSize, 
+                                                 pThis->object.pBuffer + pInsert->sourceOffset, pInsert->length);
+    }
+    __catch
+    {
+        ByteBuffer_Free(&compressed);
+        __rethrow;
+    }
+    
+    ByteBuffer_Free(&pThis->object);
+    pThis->object = compressed;
+    pThis->objectFileLength = compressedLength;
+    pInsert->sourceOffset = 0;
+    pInsert->length = compressedLength;
+}
+
+static void insertDataIfChangedAndRecordInManifest(DiskImage* pThis, DiskImageInsert* pInsert);
+static DiskImageManifestEntry calculateManifestEntry(DiskImage* pThis, DiskImageInsert* pInsert);
+static uint64_t hashDestinationFields(DiskImage* pThis, DiskImageInsert* pInsert);
+static unsigned int calculateHashedObjectLength(DiskImage* pThis, DiskImageInsert* pInsert);
+static int hasInsertChangedSincePreviousBuild(DiskImage* pThis, const DiskImageManifestEntry* pEntry);
 __throws void DiskImage_InsertObjectFile(DiskImage* pThis, DiskImageInsert* pInsert)
 {
     validateSourceObjectParameters(pThis, pInsert);
-    pThis->pVTable->insertData(pThis, pThis->object.pBuffer, pInsert);
+    if (pThis->pManifest)
+        insertDataIfChangedAndRecordInManifest(pThis, pInsert);
+    else
+        pThis->pVTable->insertData(pThis, pThis->object.pBuffer, pInsert);
 }
 
 static void validateSourceObjectParameters(DiskImage* pThis, DiskImageInsert* pInsert)
@@ -614,24 +1053,327 @@ static void validateSourceObjectParameters(DiskImage* pThis, DiskImageInsert* pI
         __throw(invalidLengthException);
 }
 
+static void insertDataIfChangedAndRecordInManifest(DiskImage* pThis, DiskImageInsert* pInsert)
+{
+    /* Entries are only recorded for successful insertions so that a failed line is retried on the next update. */
+    DiskImageManifestEntry entry = calculateManifestEntry(pThis, pInsert);
+    
+    if (hasInsertChangedSincePreviousBuild(pThis, &entry))
+        pThis->pVTable->insertData(pThis, pThis->object.pBuffer, pInsert);
+    DiskImageManifest_Append(pThis->pManifest, &entry);
+}
+
+static DiskImageManifestEntry calculateManifestEntry(DiskImage* pThis, DiskImageInsert* pInsert)
+{
+    DiskImageManifestEntry entry;
+    
+    entry.destinationHash = hashDestinationFields(pThis, pInsert);
+    entry.contentHash = Hash64_Buffer(pThis->object.pBuffer + pInsert->sourceOffset,
+                                      calculateHashedObjectLength(pThis, pInsert),
+                                      entry.destinationHash);
+    return entry;
+}
+
+static uint64_t hashDestinationFields(DiskImage* pThis, DiskImageInsert* pInsert)
+{
+    unsigned int fields[6];
+    
+    memset(fields, 0, sizeof(fields));
+    fields[0] = pInsert->type;
+    fields[1] = pInsert->sourceOffset;
+    fields[2] = pInsert->length;
+    if (pInsert->type == DISK_IMAGE_INSERTION_BLOCK)
+    {
+        fields[3] = pInsert->block;
+        fields[4] = pInsert->intraBlockOffset;
+    }
+    else
+    {
+        fields[3] = pInsert->side;
+        fields[4] = pInsert->track;
+        fields[5] = pInsert->sector;
+    }
+    
+    return Hash64_Buffer(fields, sizeof(fields), pThis->layoutHash);
+}
+
+static unsigned int calculateHashedObjectLength(DiskImage* pThis, DiskImageInsert* pInsert)
+{
+    /* Sector based insertions encode whole pages so include the rest of the last page in the hash as well. */
+    unsigned int end = pInsert->sourceOffset + pInsert->length;
+    
+    end = (end + (DISK_IMAGE_PAGE_SIZE - 1)) & ~(DISK_IMAGE_PAGE_SIZE - 1);
+    if (end > pThis->object.bufferSize)
+        end = pThis->object.bufferSize;
+    
+    return end > pInsert->sourceOffset ? end - pInsert->sourceOffset : 0;
+}
+
+static int hasInsertChangedSincePreviousBuild(DiskImage* pThis, const DiskImageManifestEntry* pEntry)
+{
+    const DiskImageManifestEntry* pPreviousEntry = NULL;
+    
+    if (pThis->pPreviousManifest)
+    {
+        size_t index = DiskImageManifest_GetEntryCount(pThis->pManifest);
+        pPreviousEntry = DiskImageManifest_GetEntry(pThis->pPreviousManifest, index);
+    }
+
+    if (pThis->isRebuildRequired)
+        return 0;
+    if (pPreviousEntry && pPreviousEntry->destinationHash != pEntry->destinationHash)
+    {
+        pThis->isRebuildRequired = 1;
+        return 0;
+    }
+    /* Once an insertion has been re-applied, the ones which follow it must also be re-applied since they may overlap
+       it and would have overwritten some of its data in the original build. */
+    if (pPreviousEntry && pPreviousEntry->contentHash == pEntry->contentHash && pThis->changedInsertCount == 0)
+        return 0;
+
+    pThis->changedInsertCount++;
+    return 1;
+}
+
 
+static void writeSparseImage(DiskImage* pThis, FILE* pFile);
+static size_t findNextZeroChunk(DiskImage* pThis, size_t offset, int isZero);
+static void writeImageRange(DiskImage* pThis, FILE* pFile, size_t start, size_t end);
 __throws void DiskImage_WriteImage(DiskImage* pThis, const char* pImageFilename)
 {
     FILE* pFile = NULL;
 
+    TraceLog_Begin("crackle", "write %s", pImageFilename);
     __try
     {
         pFile = openFile(pImageFilename, "wb");
-        ByteBuffer_WriteToFile(&pThis->image, pFile);
+        if (pThis->pVTable->writeImage)
+            pThis->pVTable->writeImage(pThis, pFile);
+        else
+            writeSparseImage(pThis, pFile);
     }
     __catch
     {
         if (pFile)
             fclose(pFile);
+        TraceLog_End();
         __rethrow;
     }
     
     fclose(pFile);
+    TraceLog_End();
+}
+
+static void writeSparseImage(DiskImage* pThis, FILE* pFile)
+{
+    /* Runs of empty blocks are skipped over with fseek() so that large, mostly empty images such as hard disks don't
+       have to be written out in full and can be left as holes in the image file. */
+    size_t imageSize = pThis->image.bufferSize;
+    size_t start = 0;
+    size_t end = 0;
+    
+    while (start < imageSize)
+    {
+        start = findNextZeroChunk(pThis, start, 0);
+        if (start >= imageSize)
+            break;
+        end = findNextZeroChunk(pThis, start, 1);
+        writeImageRange(pThis, pFile, start, end);
+        start = end;
+    }
+    if (end < imageSize)
+        writeImageRange(pThis, pFile, imageSize - 1, imageSize);
+}
+
+static size_t findNextZeroChunk(DiskImage* pThis, size_t offset, int isZero)
+{
+    static const unsigned char zeroes[DISK_IMAGE_BLOCK_SIZE];
+    
+    while (offset < pThis->image.bufferSize)
+    {
+        size_t chunkSize = pThis->image.bufferSize - offset;
+        
+        if (chunkSize > DISK_IMAGE_BLOCK_SIZE)
+            chunkSize = DISK_IMAGE_BLOCK_SIZE;
+        if (isZero == (0 == memcmp(pThis->image.pBuffer + offset, zeroes, chunkSize)))
+            return offset;
+        offset += chunkSize;
+    }
+    
+    return pThis->image.bufferSize;
+}
+
+
+__throws void DiskImage_ReadImage(DiskImage* pThis, const char* pImageFilename)
+{
+    FILE* pFile = NULL;
+
+    __try
+    {
+        pFile = openFile(pImageFilename, "rb");
+        if ((size_t)getFileSize(pFile) != pThis->image.bufferSize)
+            __throw(fileException);
+        ByteBuffer_ReadFromFile(&pThis->image, pFile);
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+    
+    fclose(pFile);
+}
+
+
+static int loadPreviousBuild(DiskImage* pThis, const char* pImageFilename, const char* pManifestFilename);
+static void snapshotImage(DiskImage* pThis, ByteBuffer* pSnapshot);
+static int isRebuildRequired(DiskImage* pThis);
+static void rebuildImage(DiskImage* pThis, const char* pScriptFilename);
+static void writeChangedImageRanges(DiskImage* pThis, ByteBuffer* pSnapshot, const char* pImageFilename);
+__throws void DiskImage_UpdateImage(DiskImage* pThis, const char* pScriptFilename, const char* pImageFilename)
+{
+    ByteBuffer snapshot = {NULL, 0};
+    char*      pManifestFilename = NULL;
+    int        isIncrementalUpdate;
+    
+    __try
+    {
+        pManifestFilename = allocateFilenameWithSuffix(pImageFilename, DISK_IMAGE_MANIFEST_SUFFIX);
+        isIncrementalUpdate = loadPreviousBuild(pThis, pImageFilename, pManifestFilename);
+        snapshotImage(pThis, &snapshot);
+        pThis->pManifest = DiskImageManifest_Create();
+        DiskImage_ProcessScriptFile(pThis, pScriptFilename);
+        if (isIncrementalUpdate && isRebuildRequired(pThis))
+        {
+            rebuildImage(pThis, pScriptFilename);
+            isIncrementalUpdate = 0;
+        }
+        if (isIncrementalUpdate)
+            writeChangedImageRanges(pThis, &snapshot, pImageFilename);
+        else
+            DiskImage_WriteImage(pThis, pImageFilename);
+        DiskImageManifest_WriteToFile(pThis->pManifest, pManifestFilename);
+    }
+    __catch
+    {
+        ByteBuffer_Free(&snapshot);
+        free(pManifestFilename);
+        __rethrow;
+    }
+    
+    ByteBuffer_Free(&snapshot);
+    free(pManifestFilename);
+}
+
+static int loadPreviousBuild(DiskImage* pThis, const char* pImageFilename, const char* pManifestFilename)
+{
+    /* A missing or unreadable image/manifest pair isn't an error, it just means that a full build is required.  Images
+       written in a container format, rather than as a copy of the image buffer, can't be patched in place either. */
+    if (pThis->pVTable->writeImage)
+        return 0;
+    __try
+    {
+        DiskImage_ReadImage(pThis, pImageFilename);
+        pThis->pPreviousManifest = DiskImageManifest_CreateFromFile(pManifestFilename);
+    }
+    __catch
+    {
+        memset(pThis->image.pBuffer, 0, pThis->image.bufferSize);
+        __nothrow_and_return(0);
+    }
+    
+    return 1;
+}
+
+static void snapshotImage(DiskImage* pThis, ByteBuffer* pSnapshot)
+{
+    ByteBuffer_Allocate(pSnapshot, pThis->image.bufferSize);
+    memcpy(pSnapshot->pBuffer, pThis->image.pBuffer, pThis->image.bufferSize);
+}
+
+static int isRebuildRequired(DiskImage* pThis)
+{
+    if (DiskImageManifest_GetEntryCount(pThis->pManifest) < DiskImageManifest_GetEntryCount(pThis->pPreviousManifest))
+        pThis->isRebuildRequired = 1;
+    return pThis->isRebuildRequired;
+}
+
+static void rebuildImage(DiskImage* pThis, const char* pScriptFilename)
+{
+    DiskImageManifest_Free(pThis->pPreviousManifest);
+    pThis->pPreviousManifest = NULL;
+    DiskImageManifest_Free(pThis->pManifest);
+    pThis->pManifest = NULL;
+    pThis->pManifest = DiskImageManifest_Create();
+    pThis->changedInsertCount = 0;
+    pThis->isRebuildRequired = 0;
+
+    memset(pThis->image.pBuffer, 0, pThis->image.bufferSize);
+    memset(&pThis->script.insert, 0, sizeof(pThis->script.insert));
+    pThis->script.lastBlock = 0;
+    pThis->script.lastLength = 0;
+    DiskImage_ProcessScriptFile(pThis, pScriptFilename);
+}
+
+static size_t findNextChangedChunk(DiskImage* pThis, ByteBuffer* pSnapshot, size_t offset, int isChanged);
+static void writeChangedImageRanges(DiskImage* pThis, ByteBuffer* pSnapshot, const char* pImageFilename)
+{
+    FILE*  pFile = NULL;
+    size_t start = 0;
+    
+    __try
+    {
+        pFile = openFile(pImageFilename, "r+b");
+        while (start < pThis->image.bufferSize)
+        {
+            size_t end;
+            
+            start = findNextChangedChunk(pThis, pSnapshot, start, 1);
+            end = findNextChangedChunk(pThis, pSnapshot, start, 0);
+            if (start < end)
+                writeImageRange(pThis, pFile, start, end);
+            start = end;
+        }
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+    
+    fclose(pFile);
+}
+
+static size_t findNextChangedChunk(DiskImage* pThis, ByteBuffer* pSnapshot, size_t offset, int isChanged)
+{
+    while (offset < pThis->image.bufferSize)
+    {
+        size_t chunkSize = pThis->image.bufferSize - offset;
+        
+        if (chunkSize > DISK_IMAGE_BLOCK_SIZE)
+            chunkSize = DISK_IMAGE_BLOCK_SIZE;
+        if (isChanged == (0 != memcmp(pThis->image.pBuffer + offset, pSnapshot->pBuffer + offset, chunkSize)))
+            return offset;
+        offset += chunkSize;
+    }
+    
+    return pThis->image.bufferSize;
+}
+
+static void writeImageRange(DiskImage* pThis, FILE* pFile, size_t start, size_t end)
+{
+    if (0 != fseek(pFile, (long)start, SEEK_SET))
+        __throw(fileException);
+    if (end - start != fwrite(pThis->image.pBuffer + start, 1, end - start, pFile))
+        __throw(fileException);
+}
+
+
+unsigned int DiskImage_GetScriptErrorCount(DiskImage* pThis)
+{
+    return pThis->script.errorCount;
 }
 
 
@@ -645,3 +1387,150 @@ size_t DiskImage_GetImageSize(DiskImage* pThis)
 {
     return pThis->image.bufferSize;
 }
+
+
+unsigned int DiskImage_GetHashRegionSize(DiskImage* pThis)
+{
+    return pThis->hashRegionSize;
+}
+
+
+__throws void DiskImage_WriteHashes(DiskImage* pThis, const char* pImageFilename)
+{
+    DiskImageHashes* pHashes = NULL;
+    char*            pHashesFilename = NULL;
+    
+    __try
+    {
+        pHashesFilename = allocateFilenameWithSuffix(pImageFilename, DISK_IMAGE_HASHES_SUFFIX);
+        pHashes = DiskImageHashes_Create(pThis->image.pBuffer, pThis->image.bufferSize, pThis->hashRegionSize);
+        DiskImageHashes_WriteToFile(pHashes, pHashesFilename);
+    }
+    __catch
+    {
+        DiskImageHashes_Free(pHashes);
+        free(pHashesFilename);
+        __rethrow;
+    }
+    DiskImageHashes_Free(pHashes);
+    free(pHashesFilename);
+}
+
+
+static int doesExtentOverlapRegion(DiskImage* pThis, const DiskImageExtent* pExtent, size_t region);
+static int insertLineNumber(unsigned int* pLineNumbers, size_t count, size_t maxLineNumbers, unsigned int lineNumber);
+size_t DiskImage_GetRegionLineNumbers(DiskImage*    pThis, 
+                                      size_t        region, 
+                                      unsigned int* pLineNumbers, 
+                                      size_t        maxLineNumbers)
+{
+    DiskImageLayout* pLayout = pThis->script.pLayout;
+    size_t           extentCount = pLayout ? DiskImageLayout_GetExtentCount(pLayout) : 0;
+    size_t           lineCount = 0;
+    size_t           i;
+    
+    for (i = 0 ; i < extentCount ; i++)
+    {
+        const DiskImageExtent* pExtent = DiskImageLayout_GetExtent(pLayout, i);
+        
+        if (doesExtentOverlapRegion(pThis, pExtent, region))
+            lineCount += insertLineNumber(pLineNumbers, lineCount, maxLineNumbers, pExtent->lineNumber);
+    }
+    
+    return lineCount;
+}
+
+static int doesExtentOverlapRegion(DiskImage* pThis, const DiskImageExtent* pExtent, size_t region)
+{
+    /* Every domain spans the whole image so a region covers the same fraction of each domain as it does of the image.
+       A nibble image track holds 16 RWTS16 sectors in one domain and 4608 RW18 bytes in another for example. */
+    uint64_t     regionCount = (pThis->image.bufferSize + pThis->hashRegionSize - 1) / pThis->hashRegionSize;
+    unsigned int domainSize = 0;
+    uint64_t     regionStart;
+    uint64_t     regionEnd;
+    
+    pThis->pVTable->describeDomain(pThis, pExtent->domain, &domainSize);
+    regionStart = (uint64_t)region * domainSize / regionCount;
+    regionEnd = ((uint64_t)region + 1) * domainSize / regionCount;
+    
+    return pExtent->start < regionEnd && pExtent->end > regionStart;
+}
+
+static int insertLineNumber(unsigned int* pLineNumbers, size_t count, size_t maxLineNumbers, unsigned int lineNumber)
+{
+    /* Keeps the lowest maxLineNumbers line numbers in ascending order.  A line can record more than one extent so it
+       is only added once.  Returns 1 if lineNumber was new. */
+    size_t i = count < maxLineNumbers ? count : maxLineNumbers;
+    size_t j;
+    
+    for (j = 0 ; j < i ; j++)
+    {
+        if (pLineNumbers[j] == lineNumber)
+            return 0;
+    }
+    while (i > 0 && pLineNumbers[i - 1] > lineNumber)
+    {
+        if (i < maxLineNumbers)
+            pLineNumbers[i] = pLineNumbers[i - 1];
+        i--;
+    }
+    if (i < maxLineNumbers)
+        pLineNumbers[i] = lineNumber;
+    return 1;
+}
+
+
+static size_t printDomainMap(DiskImage* pThis, DiskImageLayout* pLayout, size_t index, unsigned int domain);
+static void printFreeMapLine(unsigned int start, unsigned int end);
+static void printUsedMapLine(const DiskImageExtent* pExtent);
+void DiskImage_PrintLayoutMap(DiskImage* pThis)
+{
+    DiskImageLayout* pLayout = pThis->script.pLayout;
+    size_t           extentCount = 0;
+    size_t           i = 0;
+    
+    if (pLayout)
+    {
+        DiskImageLayout_Sort(pLayout);
+        extentCount = DiskImageLayout_GetExtentCount(pLayout);
+    }
+    if (extentCount == 0 || DiskImageLayout_GetExtent(pLayout, 0)->domain != 0)
+        printDomainMap(pThis, pLayout, 0, 0);
+    while (i < extentCount)
+        i = printDomainMap(pThis, pLayout, i, DiskImageLayout_GetExtent(pLayout, i)->domain);
+}
+
+static size_t printDomainMap(DiskImage* pThis, DiskImageLayout* pLayout, size_t index, unsigned int domain)
+{
+    unsigned int           domainSize = 0;
+    const char*            pDomainName = pThis->pVTable->describeDomain(pThis, domain, &domainSize);
+    const DiskImageExtent* pExtent;
+    unsigned int           freeStart = 0;
+    
+    printf("%s:\n", pDomainName);
+    while (pLayout && 
+           (pExtent = DiskImageLayout_GetExtent(pLayout, index)) != NULL && 
+           pExtent->domain == domain)
+    {
+        if (pExtent->start > freeStart)
+            printFreeMapLine(freeStart, pExtent->start);
+        printUsedMapLine(pExtent);
+        if (pExtent->end > freeStart)
+            freeStart = pExtent->end;
+        index++;
+    }
+    if (domainSize > freeStart)
+        printFreeMapLine(freeStart, domainSize);
+    
+    return index;
+}
+
+static void printFreeMapLine(unsigned int start, unsigned int end)
+{
+    printf("  0x%06x - 0x%06x free\n", start, end - 1);
+}
+
+static void printUsedMapLine(const DiskImageExtent* pExtent)
+{
+    printf("  0x%06x - 0x%06x used by line %u\n", pExtent->start, pExtent->end - 1, pExtent->lineNumber);
+}
@@ -0,0 +1,377 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "DiskImageHashes.h"
+#include "DiskImageTest.h"
+#include "TextFile.h"
+#include "ParseCSV.h"
+#include "Hash64.h"
+#include "util.h"
+
+
+#define HASHES_HEADER               "# crackle hashes v1"
+#define MAX_PRINTED_LINE_NUMBERS    8
+
+
+struct DiskImageHashes
+{
+    uint64_t*    pHashes;
+    size_t       regionCount;
+    size_t       allocatedRegionCount;
+    unsigned int regionSize;
+};
+
+
+static DiskImageHashes* allocateHashes(size_t regionCount, unsigned int regionSize);
+__throws DiskImageHashes* DiskImageHashes_Create(const unsigned char* pImage, size_t imageSize, unsigned int regionSize)
+{
+    DiskImageHashes* pThis = NULL;
+    size_t           i;
+    
+    if (regionSize == 0)
+        __throw(invalidArgumentException);
+    pThis = allocateHashes((imageSize + regionSize - 1) / regionSize, regionSize);
+    for (i = 0 ; i < pThis->regionCount ; i++)
+    {
+        size_t offset = i * regionSize;
+        size_t size = imageSize - offset < regionSize ? imageSize - offset : regionSize;
+        
+        pThis->pHashes[i] = Hash64_Buffer(pImage + offset, size, 0);
+    }
+    
+    return pThis;
+}
+
+static DiskImageHashes* allocateHashes(size_t regionCount, unsigned int regionSize)
+{
+    DiskImageHashes* pThis = NULL;
+    
+    __try
+    {
+        pThis = allocateAndZero(sizeof(*pThis));
+        pThis->pHashes = allocateAndZero(regionCount * sizeof(*pThis->pHashes) + 1);
+        pThis->regionCount = regionCount;
+        pThis->allocatedRegionCount = regionCount;
+        pThis->regionSize = regionSize;
+    }
+    __catch
+    {
+        DiskImageHashes_Free(pThis);
+        __rethrow;
+    }
+    
+    return pThis;
+}
+
+
+static long getFileSize(FILE* pFile);
+__throws DiskImageHashes* DiskImageHashes_CreateFromImageFile(const char* pImageFilename, unsigned int regionSize)
+{
+    DiskImageHashes* pThis = NULL;
+    FILE*            pFile = NULL;
+    unsigned char*   pImage = NULL;
+    
+    __try
+    {
+        long imageSize;
+        
+        pFile = fopen(pImageFilename, "rb");
+        if (!pFile)
+            __throw(fileOpenException);
+        imageSize = getFileSize(pFile);
+        if (imageSize < 0)
+            __throw(fileException);
+        pImage = allocateAndZero(imageSize + 1);
+        if ((size_t)imageSize != fread(pImage, 1, imageSize, pFile))
+            __throw(fileException);
+        pThis = DiskImageHashes_Create(pImage, imageSize, regionSize);
+    }
+    __catch
+    {
+        free(pImage);
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+    free(pImage);
+    fclose(pFile);
+    
+    return pThis;
+}
+
+static long getFileSize(FILE* pFile)
+{
+    long size;
+    
+    fseek(pFile, 0, SEEK_END);
+    size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    return size;
+}
+
+
+static void parseHashesText(DiskImageHashes** ppThis, TextFile* pTextFile, ParseCSV* pParser);
+static void appendHash(DiskImageHashes* pThis, uint64_t hash);
+static SizedString parseSingleField(ParseCSV* pParser, const SizedString* pLine);
+static unsigned int parseDecimal(const SizedString* pField);
+static uint64_t parseHex64(const SizedString* pField);
+__throws DiskImageHashes* DiskImageHashes_CreateFromFile(const char* pFilename)
+{
+    SizedString      filename = SizedString_InitFromString(pFilename);
+    DiskImageHashes* pThis = NULL;
+    TextFile*        pTextFile = NULL;
+    ParseCSV*        pParser = NULL;
+    
+    __try
+    {
+        pTextFile = TextFile_CreateFromFile(NULL, &filename, NULL);
+        pParser = ParseCSV_Create();
+        parseHashesText(&pThis, pTextFile, pParser);
+    }
+    __catch
+    {
+        ParseCSV_Free(pParser);
+        TextFile_Free(pTextFile);
+        DiskImageHashes_Free(pThis);
+        __rethrow;
+    }
+    ParseCSV_Free(pParser);
+    TextFile_Free(pTextFile);
+    
+    return pThis;
+}
+
+static void parseHashesText(DiskImageHashes** ppThis, TextFile* pTextFile, ParseCSV* pParser)
+{
+    /* The header is followed by the region size in decimal and then one hash per line in region order. */
+    SizedString header = TextFile_GetNextLine(pTextFile);
+    SizedString line;
+    SizedString field;
+    
+    if (0 != SizedString_strcmp(&header, HASHES_HEADER) || TextFile_IsEndOfFile(pTextFile))
+        __throw(fileException);
+    line = TextFile_GetNextLine(pTextFile);
+    field = parseSingleField(pParser, &line);
+    *ppThis = allocateHashes(0, parseDecimal(&field));
+    while (!TextFile_IsEndOfFile(pTextFile))
+    {
+        line = TextFile_GetNextLine(pTextFile);
+        field = parseSingleField(pParser, &line);
+        appendHash(*ppThis, parseHex64(&field));
+    }
+}
+
+static void appendHash(DiskImageHashes* pThis, uint64_t hash)
+{
+    size_t    newCount;
+    uint64_t* pRealloc;
+    
+    if (pThis->regionCount >= pThis->allocatedRegionCount)
+    {
+        newCount = pThis->allocatedRegionCount ? pThis->allocatedRegionCount * 2 : 64;
+        pRealloc = realloc(pThis->pHashes, newCount * sizeof(*pRealloc));
+        if (!pRealloc)
+            __throw(outOfMemoryException);
+        pThis->pHashes = pRealloc;
+        pThis->allocatedRegionCount = newCount;
+    }
+    pThis->pHashes[pThis->regionCount++] = hash;
+}
+
+static SizedString parseSingleField(ParseCSV* pParser, const SizedString* pLine)
+{
+    ParseCSV_Parse(pParser, pLine);
+    if (ParseCSV_FieldCount(pParser) != 1)
+        __throw(fileException);
+    return ParseCSV_FieldPointers(pParser)[0];
+}
+
+static unsigned int parseDecimal(const SizedString* pField)
+{
+    const char*  pCurr;
+    unsigned int value = 0;
+    
+    if (SizedString_strlen(pField) == 0 || SizedString_strlen(pField) > 9)
+        __throw(fileException);
+    
+    SizedString_EnumStart(pField, &pCurr);
+    while (SizedString_EnumRemaining(pField, pCurr))
+    {
+        char digit = SizedString_EnumNext(pField, &pCurr);
+        
+        if (digit < '0' || digit > '9')
+            __throw(fileException);
+        value = value * 10 + (digit - '0');
+    }
+    if (value == 0)
+        __throw(fileException);
+    
+    return value;
+}
+
+static uint64_t parseHex64(const SizedString* pField)
+{
+    const char* pCurr;
+    uint64_t    value = 0;
+    
+    if (SizedString_strlen(pField) != 16)
+        __throw(fileException);
+    
+    SizedString_EnumStart(pField, &pCurr);
+    while (SizedString_EnumRemaining(pField, pCurr))
+    {
+        char digit = SizedString_EnumNext(pField, &pCurr);
+        
+        value <<= 4;
+        if (digit >= '0' && digit <= '9')
+            value |= digit - '0';
+        else if (digit >= 'a' && digit <= 'f')
+            value |= digit - 'a' + 10;
+        else if (digit >= 'A' && digit <= 'F')
+            value |= digit - 'A' + 10;
+        else
+            __throw(fileException);
+    }
+    
+    return value;
+}
+
+
+void DiskImageHashes_Free(DiskImageHashes* pThis)
+{
+    if (!pThis)
+        return;
+    
+    free(pThis->pHashes);
+    free(pThis);
+}
+
+
+unsigned int DiskImageHashes_GetRegionSize(DiskImageHashes* pThis)
+{
+    return pThis->regionSize;
+}
+
+
+size_t DiskImageHashes_GetRegionCount(DiskImageHashes* pThis)
+{
+    return pThis->regionCount;
+}
+
+
+uint64_t DiskImageHashes_GetHash(DiskImageHashes* pThis, size_t region)
+{
+    if (region >= pThis->regionCount)
+        return 0;
+    return pThis->pHashes[region];
+}
+
+
+static void writeLine(FILE* pFile, const char* pLine);
+__throws void DiskImageHashes_WriteToFile(DiskImageHashes* pThis, const char* pFilename)
+{
+    FILE*  pFile = NULL;
+    size_t i;
+    
+    __try
+    {
+        char line[16 + 1 + 1];
+        
+        pFile = fopen(pFilename, "w");
+        if (!pFile)
+            __throw(fileOpenException);
+        
+        writeLine(pFile, HASHES_HEADER "\n");
+        snprintf(line, sizeof(line), "%u\n", pThis->regionSize);
+        writeLine(pFile, line);
+        for (i = 0 ; i < pThis->regionCount ; i++)
+        {
+            snprintf(line, sizeof(line), "%016llx\n", (unsigned long long)pThis->pHashes[i]);
+            writeLine(pFile, line);
+        }
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+    
+    fclose(pFile);
+}
+
+static void writeLine(FILE* pFile, const char* pLine)
+{
+    size_t length = strlen(pLine);
+    
+    if (length != fwrite(pLine, 1, length, pFile))
+        __throw(fileException);
+}
+
+
+static int hasRegionChanged(DiskImageHashes* pOld, DiskImageHashes* pNew, size_t region);
+static void printChangedRegion(const char* pRegionName, size_t region, DiskImage* pScriptImage);
+__throws size_t DiskImageHashes_PrintDiff(DiskImageHashes* pOld, DiskImageHashes* pNew, DiskImage* pScriptImage)
+{
+    size_t      regionCount;
+    size_t      changedCount = 0;
+    const char* pRegionName;
+    size_t      i;
+    
+    if (pOld->regionSize != pNew->regionSize)
+        __throw(invalidArgumentException);
+    
+    pRegionName = pOld->regionSize == DISK_IMAGE_BLOCK_SIZE ? "block" : "track";
+    regionCount = pOld->regionCount > pNew->regionCount ? pOld->regionCount : pNew->regionCount;
+    for (i = 0 ; i < regionCount ; i++)
+    {
+        if (!hasRegionChanged(pOld, pNew, i))
+            continue;
+        printChangedRegion(pRegionName, i, pScriptImage);
+        changedCount++;
+    }
+    printf("%u of %u %ss changed.\n", (unsigned int)changedCount, (unsigned int)regionCount, pRegionName);
+    
+    return changedCount;
+}
+
+static int hasRegionChanged(DiskImageHashes* pOld, DiskImageHashes* pNew, size_t region)
+{
+    /* Regions past the end of the smaller image, when hard disk images of different sizes are compared, count as
+       changed. */
+    if (region >= pOld->regionCount || region >= pNew->regionCount)
+        return 1;
+    return pOld->pHashes[region] != pNew->pHashes[region];
+}
+
+static void printChangedRegion(const char* pRegionName, size_t region, DiskImage* pScriptImage)
+{
+    unsigned int lineNumbers[MAX_PRINTED_LINE_NUMBERS];
+    char         lineList[MAX_PRINTED_LINE_NUMBERS * 12 + 32] = "";
+    size_t       lineCount = 0;
+    size_t       length = 0;
+    size_t       i;
+    
+    if (pScriptImage)
+        lineCount = DiskImage_GetRegionLineNumbers(pScriptImage, region, lineNumbers, MAX_PRINTED_LINE_NUMBERS);
+    for (i = 0 ; i < lineCount && i < MAX_PRINTED_LINE_NUMBERS ; i++)
+    {
+        length += snprintf(lineList + length, sizeof(lineList) - length, 
+                           "%s%u", i == 0 ? " by script lines " : ", ", lineNumbers[i]);
+    }
+    if (lineCount > MAX_PRINTED_LINE_NUMBERS)
+        snprintf(lineList + length, sizeof(lineList) - length, ", ...");
+    
+    printf("%s %u changed%s\n", pRegionName, (unsigned int)region, lineList);
+}
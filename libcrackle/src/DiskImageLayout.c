@@ -0,0 +1,155 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdlib.h>
+#include "DiskImageLayout.h"
+#include "DiskImageTest.h"
+#include "util.h"
+
+
+struct DiskImageLayout
+{
+    DiskImageExtent*        pExtents;
+    /* Extents which are still open at the current point of the DiskImageLayout_FindOverlaps() sweep.  It is grown
+       along with pExtents so that the sweep itself never has to allocate. */
+    const DiskImageExtent** ppActive;
+    size_t                  extentCount;
+    size_t                  allocatedExtentCount;
+};
+
+
+__throws DiskImageLayout* DiskImageLayout_Create(void)
+{
+    return allocateAndZero(sizeof(DiskImageLayout));
+}
+
+
+void DiskImageLayout_Free(DiskImageLayout* pThis)
+{
+    if (!pThis)
+        return;
+
+    free(pThis->ppActive);
+    free(pThis->pExtents);
+    free(pThis);
+}
+
+
+static void growExtentArrayIfNecessary(DiskImageLayout* pThis);
+__throws void DiskImageLayout_Add(DiskImageLayout* pThis, const DiskImageExtent* pExtent)
+{
+    growExtentArrayIfNecessary(pThis);
+    pThis->pExtents[pThis->extentCount++] = *pExtent;
+}
+
+static void growExtentArrayIfNecessary(DiskImageLayout* pThis)
+{
+    size_t                  newCount;
+    DiskImageExtent*        pRealloc;
+    const DiskImageExtent** ppActiveRealloc;
+
+    if (pThis->extentCount < pThis->allocatedExtentCount)
+        return;
+
+    newCount = pThis->allocatedExtentCount ? pThis->allocatedExtentCount * 2 : 64;
+    ppActiveRealloc = realloc(pThis->ppActive, newCount * sizeof(*ppActiveRealloc));
+    if (!ppActiveRealloc)
+        __throw(outOfMemoryException);
+    pThis->ppActive = ppActiveRealloc;
+    pRealloc = realloc(pThis->pExtents, newCount * sizeof(*pRealloc));
+    if (!pRealloc)
+        __throw(outOfMemoryException);
+    pThis->pExtents = pRealloc;
+    pThis->allocatedExtentCount = newCount;
+}
+
+
+void DiskImageLayout_Clear(DiskImageLayout* pThis)
+{
+    pThis->extentCount = 0;
+}
+
+
+size_t DiskImageLayout_GetExtentCount(DiskImageLayout* pThis)
+{
+    return pThis->extentCount;
+}
+
+
+static int compareExtents(const void* pv1, const void* pv2);
+void DiskImageLayout_Sort(DiskImageLayout* pThis)
+{
+    qsort(pThis->pExtents, pThis->extentCount, sizeof(*pThis->pExtents), compareExtents);
+}
+
+static int compareExtents(const void* pv1, const void* pv2)
+{
+    const DiskImageExtent* p1 = (const DiskImageExtent*)pv1;
+    const DiskImageExtent* p2 = (const DiskImageExtent*)pv2;
+
+    if (p1->domain != p2->domain)
+        return p1->domain < p2->domain ? -1 : 1;
+    if (p1->start != p2->start)
+        return p1->start < p2->start ? -1 : 1;
+    if (p1->lineNumber != p2->lineNumber)
+        return p1->lineNumber < p2->lineNumber ? -1 : 1;
+    return 0;
+}
+
+
+const DiskImageExtent* DiskImageLayout_GetExtent(DiskImageLayout* pThis, size_t index)
+{
+    if (index >= pThis->extentCount)
+        return NULL;
+    return &pThis->pExtents[index];
+}
+
+
+size_t DiskImageLayout_FindOverlaps(DiskImageLayout*               pThis, 
+                                    DiskImageLayoutOverlapCallback pCallback, 
+                                    void*                          pContext)
+{
+    /* After sorting, an extent can only overlap earlier extents in the same domain which haven't ended yet.  All of
+       them are kept in the active list since a short extent nested within a long one can end before the next extent
+       starts while the long one still overlaps it. */
+    size_t activeCount = 0;
+    size_t overlapCount = 0;
+    size_t i;
+
+    DiskImageLayout_Sort(pThis);
+    for (i = 0 ; i < pThis->extentCount ; i++)
+    {
+        const DiskImageExtent* pCurr = &pThis->pExtents[i];
+        size_t                 kept = 0;
+        size_t                 j;
+
+        for (j = 0 ; j < activeCount ; j++)
+        {
+            const DiskImageExtent* pActive = pThis->ppActive[j];
+
+            if (pActive->domain != pCurr->domain || pActive->end <= pCurr->start)
+                continue;
+            pThis->ppActive[kept++] = pActive;
+            if (pActive->group != 0 && pActive->group == pCurr->group)
+                continue;
+            if (pActive->lineNumber <= pCurr->lineNumber)
+                pCallback(pContext, pActive, pCurr);
+            else
+                pCallback(pContext, pCurr, pActive);
+            overlapCount++;
+        }
+        pThis->ppActive[kept++] = pCurr;
+        activeCount = kept;
+    }
+
+    return overlapCount;
+}
@@ -0,0 +1,210 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include "DiskImageManifest.h"
+#include "DiskImageTest.h"
+#include "TextFile.h"
+#include "ParseCSV.h"
+#include "util.h"
+
+
+#define MANIFEST_HEADER "# crackle manifest v1"
+
+
+struct DiskImageManifest
+{
+    DiskImageManifestEntry* pEntries;
+    size_t                  entryCount;
+    size_t                  allocatedEntryCount;
+};
+
+
+__throws DiskImageManifest* DiskImageManifest_Create(void)
+{
+    return allocateAndZero(sizeof(DiskImageManifest));
+}
+
+
+static void parseManifestText(DiskImageManifest* pThis, TextFile* pTextFile, ParseCSV* pParser);
+static void parseManifestLine(DiskImageManifest* pThis, ParseCSV* pParser, const SizedString* pLine);
+static uint64_t parseHex64(const SizedString* pField);
+__throws DiskImageManifest* DiskImageManifest_CreateFromFile(const char* pFilename)
+{
+    SizedString        filename = SizedString_InitFromString(pFilename);
+    DiskImageManifest* pThis = NULL;
+    TextFile*          pTextFile = NULL;
+    ParseCSV*          pParser = NULL;
+
+    __try
+    {
+        pThis = DiskImageManifest_Create();
+        pTextFile = TextFile_CreateFromFile(NULL, &filename, NULL);
+        pParser = ParseCSV_Create();
+        parseManifestText(pThis, pTextFile, pParser);
+    }
+    __catch
+    {
+        ParseCSV_Free(pParser);
+        TextFile_Free(pTextFile);
+        DiskImageManifest_Free(pThis);
+        __rethrow;
+    }
+    ParseCSV_Free(pParser);
+    TextFile_Free(pTextFile);
+
+    return pThis;
+}
+
+static void parseManifestText(DiskImageManifest* pThis, TextFile* pTextFile, ParseCSV* pParser)
+{
+    SizedString header = TextFile_GetNextLine(pTextFile);
+
+    if (0 != SizedString_strcmp(&header, MANIFEST_HEADER))
+        __throw(fileException);
+    while (!TextFile_IsEndOfFile(pTextFile))
+    {
+        SizedString line = TextFile_GetNextLine(pTextFile);
+        parseManifestLine(pThis, pParser, &line);
+    }
+}
+
+static void parseManifestLine(DiskImageManifest* pThis, ParseCSV* pParser, const SizedString* pLine)
+{
+    DiskImageManifestEntry entry;
+    const SizedString*     pFields;
+
+    ParseCSV_Parse(pParser, pLine);
+    if (ParseCSV_FieldCount(pParser) != 2)
+        __throw(fileException);
+    pFields = ParseCSV_FieldPointers(pParser);
+    entry.destinationHash = parseHex64(&pFields[0]);
+    entry.contentHash = parseHex64(&pFields[1]);
+    DiskImageManifest_Append(pThis, &entry);
+}
+
+static uint64_t parseHex64(const SizedString* pField)
+{
+    const char* pCurr;
+    uint64_t    value = 0;
+
+    if (SizedString_strlen(pField) != 16)
+        __throw(fileException);
+
+    SizedString_EnumStart(pField, &pCurr);
+    while (SizedString_EnumRemaining(pField, pCurr))
+    {
+        char digit = SizedString_EnumNext(pField, &pCurr);
+
+        value <<= 4;
+        if (digit >= '0' && digit <= '9')
+            value |= digit - '0';
+        else if (digit >= 'a' && digit <= 'f')
+            value |= digit - 'a' + 10;
+        else if (digit >= 'A' && digit <= 'F')
+            value |= digit - 'A' + 10;
+        else
+            __throw(fileException);
+    }
+
+    return value;
+}
+
+
+void DiskImageManifest_Free(DiskImageManifest* pThis)
+{
+    if (!pThis)
+        return;
+
+    free(pThis->pEntries);
+    free(pThis);
+}
+
+
+static void growEntryArrayIfNecessary(DiskImageManifest* pThis);
+__throws void DiskImageManifest_Append(DiskImageManifest* pThis, const DiskImageManifestEntry* pEntry)
+{
+    growEntryArrayIfNecessary(pThis);
+    pThis->pEntries[pThis->entryCount++] = *pEntry;
+}
+
+static void growEntryArrayIfNecessary(DiskImageManifest* pThis)
+{
+    size_t                  newCount;
+    DiskImageManifestEntry* pRealloc;
+
+    if (pThis->entryCount < pThis->allocatedEntryCount)
+        return;
+
+    newCount = pThis->allocatedEntryCount ? pThis->allocatedEntryCount * 2 : 64;
+    pRealloc = realloc(pThis->pEntries, newCount * sizeof(*pRealloc));
+    if (!pRealloc)
+        __throw(outOfMemoryException);
+    pThis->pEntries = pRealloc;
+    pThis->allocatedEntryCount = newCount;
+}
+
+
+size_t DiskImageManifest_GetEntryCount(DiskImageManifest* pThis)
+{
+    return pThis->entryCount;
+}
+
+
+const DiskImageManifestEntry* DiskImageManifest_GetEntry(DiskImageManifest* pThis, size_t index)
+{
+    if (index >= pThis->entryCount)
+        return NULL;
+    return &pThis->pEntries[index];
+}
+
+
+static void writeLine(FILE* pFile, const char* pLine);
+__throws void DiskImageManifest_WriteToFile(DiskImageManifest* pThis, const char* pFilename)
+{
+    FILE*  pFile = NULL;
+    size_t i;
+
+    __try
+    {
+        pFile = fopen(pFilename, "w");
+        if (!pFile)
+            __throw(fileOpenException);
+
+        writeLine(pFile, MANIFEST_HEADER "\n");
+        for (i = 0 ; i < pThis->entryCount ; i++)
+        {
+            char line[16 + 1 + 16 + 1 + 1];
+
+            snprintf(line, sizeof(line), "%016llx,%016llx\n",
+                     (unsigned long long)pThis->pEntries[i].destinationHash,
+                     (unsigned long long)pThis->pEntries[i].contentHash);
+            writeLine(pFile, line);
+        }
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+
+    fclose(pFile);
+}
+
+static void writeLine(FILE* pFile, const char* pLine)
+{
+    size_t length = strlen(pLine);
+
+    if (length != fwrite(pLine, 1, length, pFile))
+        __throw(fileException);
+}
@@ -0,0 +1,308 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "DiskImagePlan.h"
+#include "DiskImageTest.h"
+#include "util.h"
+
+
+#define PLAN_FILE_SIGNATURE "CRKP"
+#define PLAN_FILE_VERSION   1
+
+
+typedef struct PlanFileHeader
+{
+    char     signature[4];
+    uint32_t version;
+    uint64_t scriptHash;
+    uint32_t entryCount;
+    uint32_t stringTableSize;
+} PlanFileHeader;
+
+
+struct DiskImagePlan
+{
+    DiskImagePlanEntry* pEntries;
+    char*               pStrings;
+    size_t              entryCount;
+    size_t              allocatedEntryCount;
+    size_t              stringTableSize;
+    size_t              allocatedStringTableSize;
+};
+
+
+__throws DiskImagePlan* DiskImagePlan_Create(void)
+{
+    return allocateAndZero(sizeof(DiskImagePlan));
+}
+
+
+static FILE* openFile(const char* pFilename, const char* pMode);
+static PlanFileHeader readAndValidateHeader(FILE* pFile, uint64_t scriptHash);
+static void readExactly(void* pBuffer, size_t bufferSize, FILE* pFile);
+static void validatePlanFileSize(FILE* pFile, const PlanFileHeader* pHeader);
+static long getFileSize(FILE* pFile);
+static void allocateForPlanFile(DiskImagePlan* pThis, const PlanFileHeader* pHeader);
+static void validateEntriesAndStringTable(DiskImagePlan* pThis);
+__throws DiskImagePlan* DiskImagePlan_CreateFromFile(const char* pFilename, uint64_t scriptHash)
+{
+    FILE*          pFile = NULL;
+    DiskImagePlan* pThis = NULL;
+
+    __try
+    {
+        PlanFileHeader header;
+
+        pFile = openFile(pFilename, "rb");
+        header = readAndValidateHeader(pFile, scriptHash);
+        validatePlanFileSize(pFile, &header);
+        pThis = DiskImagePlan_Create();
+        allocateForPlanFile(pThis, &header);
+        readExactly(pThis->pEntries, pThis->entryCount * sizeof(*pThis->pEntries), pFile);
+        readExactly(pThis->pStrings, pThis->stringTableSize, pFile);
+        validateEntriesAndStringTable(pThis);
+    }
+    __catch
+    {
+        DiskImagePlan_Free(pThis);
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+    fclose(pFile);
+
+    return pThis;
+}
+
+static FILE* openFile(const char* pFilename, const char* pMode)
+{
+    FILE* pFile = fopen(pFilename, pMode);
+    if (!pFile)
+        __throw(fileOpenException);
+    return pFile;
+}
+
+static PlanFileHeader readAndValidateHeader(FILE* pFile, uint64_t scriptHash)
+{
+    PlanFileHeader header;
+
+    readExactly(&header, sizeof(header), pFile);
+    if (0 != memcmp(header.signature, PLAN_FILE_SIGNATURE, sizeof(header.signature)) ||
+        header.version != PLAN_FILE_VERSION ||
+        header.scriptHash != scriptHash)
+    {
+        __throw(fileException);
+    }
+
+    return header;
+}
+
+static void readExactly(void* pBuffer, size_t bufferSize, FILE* pFile)
+{
+    if (bufferSize != fread(pBuffer, 1, bufferSize, pFile))
+        __throw(fileException);
+}
+
+static void validatePlanFileSize(FILE* pFile, const PlanFileHeader* pHeader)
+{
+    uint64_t expectedSize = (uint64_t)sizeof(*pHeader) + 
+                            (uint64_t)pHeader->entryCount * sizeof(DiskImagePlanEntry) +
+                            pHeader->stringTableSize;
+
+    if (expectedSize != (uint64_t)getFileSize(pFile))
+        __throw(fileException);
+}
+
+static long getFileSize(FILE* pFile)
+{
+    long currentPosition = ftell(pFile);
+    long size;
+
+    fseek(pFile, 0, SEEK_END);
+    size = ftell(pFile);
+    fseek(pFile, currentPosition, SEEK_SET);
+    return size;
+}
+
+static void allocateForPlanFile(DiskImagePlan* pThis, const PlanFileHeader* pHeader)
+{
+    pThis->pEntries = allocateAndZero(pHeader->entryCount * sizeof(*pThis->pEntries) + 1);
+    pThis->entryCount = pHeader->entryCount;
+    pThis->allocatedEntryCount = pHeader->entryCount;
+    pThis->pStrings = allocateAndZero(pHeader->stringTableSize + 1);
+    pThis->stringTableSize = pHeader->stringTableSize;
+    pThis->allocatedStringTableSize = pHeader->stringTableSize;
+}
+
+static void validateEntriesAndStringTable(DiskImagePlan* pThis)
+{
+    size_t i;
+
+    if (pThis->stringTableSize > 0 && pThis->pStrings[pThis->stringTableSize - 1] != '\0')
+        __throw(fileException);
+    for (i = 0 ; i < pThis->entryCount ; i++)
+    {
+        unsigned int offset = pThis->pEntries[i].objectFilenameOffset;
+
+        if (offset != DISK_IMAGE_PLAN_NO_OBJECT && offset >= pThis->stringTableSize)
+            __throw(fileException);
+    }
+}
+
+
+void DiskImagePlan_Free(DiskImagePlan* pThis)
+{
+    if (!pThis)
+        return;
+
+    free(pThis->pEntries);
+    free(pThis->pStrings);
+    free(pThis);
+}
+
+
+static unsigned int findObjectFilename(DiskImagePlan* pThis, const SizedString* pFilename);
+static void growStringTableIfNecessary(DiskImagePlan* pThis, size_t bytesToAdd);
+__throws unsigned int DiskImagePlan_AddObjectFilename(DiskImagePlan* pThis, const SizedString* pFilename)
+{
+    size_t       filenameLength = SizedString_strlen(pFilename);
+    unsigned int offset = findObjectFilename(pThis, pFilename);
+
+    if (offset != DISK_IMAGE_PLAN_NO_OBJECT)
+        return offset;
+
+    growStringTableIfNecessary(pThis, filenameLength + 1);
+    offset = pThis->stringTableSize;
+    memcpy(pThis->pStrings + offset, pFilename->pString, filenameLength);
+    pThis->pStrings[offset + filenameLength] = '\0';
+    pThis->stringTableSize += filenameLength + 1;
+
+    return offset;
+}
+
+static unsigned int findObjectFilename(DiskImagePlan* pThis, const SizedString* pFilename)
+{
+    size_t offset = 0;
+
+    while (offset < pThis->stringTableSize)
+    {
+        const char* pCurr = pThis->pStrings + offset;
+
+        if (0 == SizedString_strcmp(pFilename, pCurr))
+            return offset;
+        offset += strlen(pCurr) + 1;
+    }
+
+    return DISK_IMAGE_PLAN_NO_OBJECT;
+}
+
+static void growStringTableIfNecessary(DiskImagePlan* pThis, size_t bytesToAdd)
+{
+    size_t newSize;
+    char*  pRealloc;
+
+    if (pThis->stringTableSize + bytesToAdd <= pThis->allocatedStringTableSize)
+        return;
+
+    newSize = pThis->allocatedStringTableSize ? pThis->allocatedStringTableSize * 2 : 256;
+    while (newSize < pThis->stringTableSize + bytesToAdd)
+        newSize *= 2;
+    pRealloc = realloc(pThis->pStrings, newSize);
+    if (!pRealloc)
+        __throw(outOfMemoryException);
+    pThis->pStrings = pRealloc;
+    pThis->allocatedStringTableSize = newSize;
+}
+
+
+static void growEntryArrayIfNecessary(DiskImagePlan* pThis);
+__throws void DiskImagePlan_Append(DiskImagePlan* pThis, const DiskImagePlanEntry* pEntry)
+{
+    growEntryArrayIfNecessary(pThis);
+    pThis->pEntries[pThis->entryCount++] = *pEntry;
+}
+
+static void growEntryArrayIfNecessary(DiskImagePlan* pThis)
+{
+    size_t              newCount;
+    DiskImagePlanEntry* pRealloc;
+
+    if (pThis->entryCount < pThis->allocatedEntryCount)
+        return;
+
+    newCount = pThis->allocatedEntryCount ? pThis->allocatedEntryCount * 2 : 64;
+    pRealloc = realloc(pThis->pEntries, newCount * sizeof(*pRealloc));
+    if (!pRealloc)
+        __throw(outOfMemoryException);
+    pThis->pEntries = pRealloc;
+    pThis->allocatedEntryCount = newCount;
+}
+
+
+size_t DiskImagePlan_GetEntryCount(DiskImagePlan* pThis)
+{
+    return pThis->entryCount;
+}
+
+
+const DiskImagePlanEntry* DiskImagePlan_GetEntry(DiskImagePlan* pThis, size_t index)
+{
+    if (index >= pThis->entryCount)
+        return NULL;
+    return &pThis->pEntries[index];
+}
+
+
+const char* DiskImagePlan_GetObjectFilename(DiskImagePlan* pThis, const DiskImagePlanEntry* pEntry)
+{
+    if (pEntry->objectFilenameOffset == DISK_IMAGE_PLAN_NO_OBJECT)
+        return NULL;
+    return pThis->pStrings + pEntry->objectFilenameOffset;
+}
+
+
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile);
+__throws void DiskImagePlan_WriteToFile(DiskImagePlan* pThis, const char* pFilename, uint64_t scriptHash)
+{
+    FILE*          pFile = NULL;
+    PlanFileHeader header;
+
+    memcpy(header.signature, PLAN_FILE_SIGNATURE, sizeof(header.signature));
+    header.version = PLAN_FILE_VERSION;
+    header.scriptHash = scriptHash;
+    header.entryCount = pThis->entryCount;
+    header.stringTableSize = pThis->stringTableSize;
+
+    __try
+    {
+        pFile = openFile(pFilename, "wb");
+        writeExactly(&header, sizeof(header), pFile);
+        writeExactly(pThis->pEntries, pThis->entryCount * sizeof(*pThis->pEntries), pFile);
+        writeExactly(pThis->pStrings, pThis->stringTableSize, pFile);
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        __rethrow;
+    }
+
+    fclose(pFile);
+}
+
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile)
+{
+    if (bufferSize != fwrite(pBuffer, 1, bufferSize, pFile))
+        __throw(fileException);
+}
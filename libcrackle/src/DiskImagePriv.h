@@ -13,16 +13,28 @@
 #ifndef _DISK_IMAGE_PRIV_H_
 #define _DISK_IMAGE_PRIV_H_
 
+#include <stdio.h>
 #include "DiskImage.h"
 #include "TextFile.h"
 #include "ParseCSV.h"
 #include "ByteBuffer.h"
+#include "DiskImageManifest.h"
+#include "DiskImagePlan.h"
+#include "DiskImageLayout.h"
 
 
+#define DISK_IMAGE_MAX_EXTENTS_PER_INSERT 2
+
 typedef struct DiskImageVTable
 {
     void (*freeObject)(void *pThis);
     void (*insertData)(void* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+    void (*validateInsert)(void* pThis, DiskImageInsert* pInsert);
+    /* Fills in up to DISK_IMAGE_MAX_EXTENTS_PER_INSERT extents for pInsert and returns how many were used. */
+    size_t (*calculateExtents)(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents);
+    const char* (*describeDomain)(void* pThis, unsigned int domain, unsigned int* pDomainSize);
+    /* Optional.  NULL writes the image buffer to the file as is. */
+    void (*writeImage)(void* pThis, FILE* pFile);
 
 } DiskImageVTable;
 
@@ -32,11 +44,15 @@ typedef struct DiskImageScriptEngine
     DiskImage*      pDiskImage;
     TextFile*       pTextFile;
     ParseCSV*       pParser;
+    DiskImagePlan*  pPlan;
+    DiskImageLayout* pLayout;
     const char*     pScriptFilename;
     DiskImageInsert insert;
     unsigned int    lineNumber;
+    unsigned int    errorCount;
     unsigned int    lastBlock;
     unsigned int    lastLength;
+    int             isPlanCacheDisabled;
 } DiskImageScriptEngine;
 
 
@@ -47,7 +63,17 @@ struct DiskImage
     ByteBuffer            object;
     DiskImageScriptEngine script;
     DiskImageInsert       insert;
+    DiskImageManifest*    pPreviousManifest;
+    DiskImageManifest*    pManifest;
+    DiskImage*            pNextMirror;
+    BinaryBufferFile*     pInMemoryObjects;
+    size_t                inMemoryObjectCount;
+    size_t                allocatedInMemoryObjectCount;
     unsigned int          objectFileLength;
+    unsigned int          hashRegionSize;
+    unsigned int          changedInsertCount;
+    int                   isRebuildRequired;
+    uint64_t              layoutHash;
 };
 
 
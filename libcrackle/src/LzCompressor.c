@@ -0,0 +1,285 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdint.h>
+#include <string.h>
+#include "LzCompressor.h"
+#include "DiskImageTest.h"
+#include "util.h"
+
+
+#define HASH_BITS           12
+#define HASH_SIZE           (1 << HASH_BITS)
+#define MAX_CHAIN_LENGTH    256
+#define NO_POSITION         0xFFFFFFFF
+#define MATCH_FLAG          0x80
+#define END_OF_STREAM       0x00
+
+
+typedef struct LzCompressor
+{
+    const unsigned char* pSrc;
+    size_t               srcSize;
+    unsigned char*       pDest;
+    size_t               destSize;
+    size_t               destOffset;
+    unsigned int*        pHead;
+    unsigned int*        pPrev;
+} LzCompressor;
+
+
+static void initCompressor(LzCompressor* pThis, 
+                           unsigned char* pDest, size_t destSize, const unsigned char* pSrc, size_t srcSize);
+static void freeCompressor(LzCompressor* pThis);
+static void compressMatchesAndLiterals(LzCompressor* pThis);
+__throws size_t LzCompressor_Compress(unsigned char*       pDest, 
+                                      size_t               destSize, 
+                                      const unsigned char* pSrc, 
+                                      size_t               srcSize)
+{
+    LzCompressor compressor;
+    
+    __try
+    {
+        initCompressor(&compressor, pDest, destSize, pSrc, srcSize);
+        compressMatchesAndLiterals(&compressor);
+    }
+    __catch
+    {
+        freeCompressor(&compressor);
+        __rethrow;
+    }
+    freeCompressor(&compressor);
+    
+    return compressor.destOffset;
+}
+
+static void initCompressor(LzCompressor* pThis, 
+                           unsigned char* pDest, size_t destSize, const unsigned char* pSrc, size_t srcSize)
+{
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->pSrc = pSrc;
+    pThis->srcSize = srcSize;
+    pThis->pDest = pDest;
+    pThis->destSize = destSize;
+    pThis->pHead = allocateAndZero(HASH_SIZE * sizeof(*pThis->pHead));
+    pThis->pPrev = allocateAndZero(srcSize * sizeof(*pThis->pPrev) + 1);
+    memset(pThis->pHead, 0xFF, HASH_SIZE * sizeof(*pThis->pHead));
+}
+
+static void freeCompressor(LzCompressor* pThis)
+{
+    free(pThis->pHead);
+    free(pThis->pPrev);
+    pThis->pHead = NULL;
+    pThis->pPrev = NULL;
+}
+
+static size_t findLongestMatch(LzCompressor* pThis, size_t position, size_t* pDistance);
+static void insertPosition(LzCompressor* pThis, size_t position);
+static void emitLiterals(LzCompressor* pThis, size_t start, size_t end);
+static void emitMatch(LzCompressor* pThis, size_t length, size_t distance);
+static void emitByte(LzCompressor* pThis, unsigned char byte);
+static void compressMatchesAndLiterals(LzCompressor* pThis)
+{
+    size_t position = 0;
+    size_t literalStart = 0;
+    
+    while (position < pThis->srcSize)
+    {
+        size_t distance = 0;
+        size_t length = findLongestMatch(pThis, position, &distance);
+        size_t i;
+        
+        insertPosition(pThis, position);
+        /* Lazy matching: emit this byte as a literal when the match starting at the next byte is longer. */
+        if (length >= LZ_COMPRESSOR_MIN_MATCH && length < LZ_COMPRESSOR_MAX_MATCH)
+        {
+            size_t nextDistance;
+            
+            if (findLongestMatch(pThis, position + 1, &nextDistance) > length)
+                length = 0;
+        }
+        /* A minimum length match splitting a literal run costs an extra command byte and would grow the output. */
+        if (length == LZ_COMPRESSOR_MIN_MATCH && position != literalStart)
+            length = 0;
+        if (length < LZ_COMPRESSOR_MIN_MATCH)
+        {
+            position++;
+            continue;
+        }
+        
+        emitLiterals(pThis, literalStart, position);
+        emitMatch(pThis, length, distance);
+        for (i = 1 ; i < length ; i++)
+            insertPosition(pThis, position + i);
+        position += length;
+        literalStart = position;
+    }
+    emitLiterals(pThis, literalStart, pThis->srcSize);
+    emitByte(pThis, END_OF_STREAM);
+}
+
+static unsigned int hashPosition(LzCompressor* pThis, size_t position);
+static size_t matchLength(LzCompressor* pThis, size_t candidate, size_t position, size_t maxLength);
+static size_t findLongestMatch(LzCompressor* pThis, size_t position, size_t* pDistance)
+{
+    size_t       maxLength = pThis->srcSize - position;
+    size_t       bestLength = 0;
+    unsigned int chainLength = MAX_CHAIN_LENGTH;
+    unsigned int candidate;
+    
+    if (position + LZ_COMPRESSOR_MIN_MATCH > pThis->srcSize)
+        return 0;
+    if (maxLength > LZ_COMPRESSOR_MAX_MATCH)
+        maxLength = LZ_COMPRESSOR_MAX_MATCH;
+    
+    candidate = pThis->pHead[hashPosition(pThis, position)];
+    while (candidate != NO_POSITION && chainLength-- > 0 && position - candidate <= LZ_COMPRESSOR_MAX_DISTANCE)
+    {
+        /* Checking the byte just past the current best first rejects most candidates which can't beat it. */
+        if (pThis->pSrc[candidate + bestLength] == pThis->pSrc[position + bestLength])
+        {
+            size_t length = matchLength(pThis, candidate, position, maxLength);
+            
+            if (length > bestLength)
+            {
+                bestLength = length;
+                *pDistance = position - candidate;
+                if (length == maxLength)
+                    break;
+            }
+        }
+        candidate = pThis->pPrev[candidate];
+    }
+    
+    return bestLength;
+}
+
+static unsigned int hashPosition(LzCompressor* pThis, size_t position)
+{
+    const unsigned char* p = pThis->pSrc + position;
+    uint32_t             key = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    
+    return (key * 2654435761U) >> (32 - HASH_BITS);
+}
+
+static size_t matchLength(LzCompressor* pThis, size_t candidate, size_t position, size_t maxLength)
+{
+    const unsigned char* pCandidate = pThis->pSrc + candidate;
+    const unsigned char* pCurr = pThis->pSrc + position;
+    size_t               length = 0;
+    
+    while (length < maxLength && pCandidate[length] == pCurr[length])
+        length++;
+    
+    return length;
+}
+
+static void insertPosition(LzCompressor* pThis, size_t position)
+{
+    unsigned int hash;
+    
+    if (position + LZ_COMPRESSOR_MIN_MATCH > pThis->srcSize)
+        return;
+    hash = hashPosition(pThis, position);
+    pThis->pPrev[position] = pThis->pHead[hash];
+    pThis->pHead[hash] = position;
+}
+
+static void emitLiterals(LzCompressor* pThis, size_t start, size_t end)
+{
+    while (start < end)
+    {
+        size_t count = end - start;
+        
+        if (count > LZ_COMPRESSOR_MAX_LITERALS)
+            count = LZ_COMPRESSOR_MAX_LITERALS;
+        emitByte(pThis, (unsigned char)count);
+        if (count > pThis->destSize - pThis->destOffset)
+            __throw(bufferOverrunException);
+        memcpy(pThis->pDest + pThis->destOffset, pThis->pSrc + start, count);
+        pThis->destOffset += count;
+        start += count;
+    }
+}
+
+static void emitMatch(LzCompressor* pThis, size_t length, size_t distance)
+{
+    emitByte(pThis, (unsigned char)(MATCH_FLAG | (length - LZ_COMPRESSOR_MIN_MATCH)));
+    emitByte(pThis, (unsigned char)LO_BYTE(distance));
+    emitByte(pThis, (unsigned char)HI_BYTE(distance));
+}
+
+static void emitByte(LzCompressor* pThis, unsigned char byte)
+{
+    if (pThis->destOffset >= pThis->destSize)
+        __throw(bufferOverrunException);
+    pThis->pDest[pThis->destOffset++] = byte;
+}
+
+
+static unsigned char readByte(const unsigned char* pSrc, size_t srcSize, size_t* pOffset);
+__throws size_t LzCompressor_Decompress(unsigned char*       pDest, 
+                                        size_t               destSize, 
+                                        const unsigned char* pSrc, 
+                                        size_t               srcSize)
+{
+    size_t srcOffset = 0;
+    size_t destOffset = 0;
+    
+    for (;;)
+    {
+        unsigned char command = readByte(pSrc, srcSize, &srcOffset);
+        size_t        length;
+        
+        if (command == END_OF_STREAM)
+            break;
+        if (command & MATCH_FLAG)
+        {
+            size_t distance = readByte(pSrc, srcSize, &srcOffset);
+            
+            distance |= (size_t)readByte(pSrc, srcSize, &srcOffset) << 8;
+            length = (command & ~MATCH_FLAG) + LZ_COMPRESSOR_MIN_MATCH;
+            if (distance == 0 || distance > destOffset)
+                __throw(invalidArgumentException);
+            if (length > destSize - destOffset)
+                __throw(bufferOverrunException);
+            /* Copied a byte at a time since the source can overlap the bytes being written. */
+            while (length--)
+            {
+                pDest[destOffset] = pDest[destOffset - distance];
+                destOffset++;
+            }
+        }
+        else
+        {
+            length = command;
+            if (length > srcSize - srcOffset)
+                __throw(invalidArgumentException);
+            if (length > destSize - destOffset)
+                __throw(bufferOverrunException);
+            memcpy(pDest + destOffset, pSrc + srcOffset, length);
+            srcOffset += length;
+            destOffset += length;
+        }
+    }
+    
+    return destOffset;
+}
+
+static unsigned char readByte(const unsigned char* pSrc, size_t srcSize, size_t* pOffset)
+{
+    if (*pOffset >= srcSize)
+        __throw(invalidArgumentException);
+    return pSrc[(*pOffset)++];
+}
@@ -11,44 +11,35 @@
     GNU General Public License for more details.
 */
 #include <assert.h>
-#include "NibbleDiskImage.h"
-#include "DiskImagePriv.h"
+#include "NibbleDiskImagePriv.h"
 #include "DiskImageTest.h"
 #include "BinaryBuffer.h"
 #include "TextFile.h"
 #include "ParseCSV.h"
+#include "Hash64.h"
+#include "TraceLog.h"
+#include "PerfCounters.h"
 #include "util.h"
 
 
-struct NibbleDiskImage
-{
-    DiskImage            super;
-    unsigned char*       pWrite;
-    const unsigned char* pRead;
-    const unsigned char* pData;
-    unsigned char*       pCurrentTrack;
-    unsigned int         side;
-    unsigned int         track;
-    unsigned int         sector;
-    unsigned int         intraTrackOffset;
-    unsigned int         bytesLeft;
-    unsigned char        checksum;
-    unsigned char        lastByte;
-    unsigned char        aux[86];
-    unsigned char        decode8to6[256];
-};
-
-
 static void freeObject(void* pThis);
 static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+static void validateInsert(void* pThis, DiskImageInsert* pInsert);
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents);
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize);
 struct DiskImageVTable NibbleDiskImageVTable = 
 { 
     freeObject,
-    insertData 
+    insertData,
+    validateInsert,
+    calculateExtents,
+    describeDomain,
+    NULL
 };
 
 
 static void initializeDecode8to6Table(NibbleDiskImage* pThis);
+static void initializePhysicalOrderInterleave(NibbleDiskImage* pThis);
 static unsigned char encode6to8(unsigned char byte);
 __throws NibbleDiskImage* NibbleDiskImage_Create(void)
 {
@@ -57,8 +48,7 @@ __throws NibbleDiskImage* NibbleDiskImage_Create(void)
     __try
     {
         pThis = allocateAndZero(sizeof(*pThis));
-        DiskImage_Init(&pThis->super, &NibbleDiskImageVTable, NIBBLE_DISK_IMAGE_SIZE);
-        initializeDecode8to6Table(pThis);
+        NibbleDiskImage_Init(pThis, &NibbleDiskImageVTable);
     }
     __catch
     {
@@ -69,6 +59,14 @@ __throws NibbleDiskImage* NibbleDiskImage_Create(void)
     return pThis;
 }
 
+__throws void NibbleDiskImage_Init(NibbleDiskImage* pThis, DiskImageVTable* pVTable)
+{
+    DiskImage_Init(&pThis->super, pVTable, NIBBLE_DISK_IMAGE_SIZE);
+    pThis->super.hashRegionSize = NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK;
+    initializeDecode8to6Table(pThis);
+    initializePhysicalOrderInterleave(pThis);
+}
+
 static void initializeDecode8to6Table(NibbleDiskImage* pThis)
 {
     unsigned char i = 0;
@@ -77,6 +75,13 @@ static void initializeDecode8to6Table(NibbleDiskImage* pThis)
         pThis->decode8to6[encode6to8(i)] = i;
 }
 
+static void initializePhysicalOrderInterleave(NibbleDiskImage* pThis)
+{
+    unsigned char i;
+    for (i = 0 ; i < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; i++)
+        pThis->rwts16PhysicalSectors[i] = i;
+}
+
 static unsigned char encode6to8(unsigned char byte)
 {
     static const unsigned char nibbleArray[64] =
@@ -101,6 +106,70 @@ static void freeObject(void* pThis)
 }
 
 
+static int isPhysicalOrder(const unsigned char* pPhysicalSectors);
+__throws void NibbleDiskImage_SetRWTS16Interleave(NibbleDiskImage* pThis, const unsigned char* pPhysicalSectors)
+{
+    NibbleDiskImage_ValidateRWTS16Interleave(pPhysicalSectors);
+    memcpy(pThis->rwts16PhysicalSectors, pPhysicalSectors, sizeof(pThis->rwts16PhysicalSectors));
+
+    /* Sectors land in different places once the interleave changes so --update must rebuild the whole image. */
+    if (isPhysicalOrder(pPhysicalSectors))
+        pThis->super.layoutHash = 0;
+    else
+        pThis->super.layoutHash = Hash64_Buffer(pPhysicalSectors, sizeof(pThis->rwts16PhysicalSectors), 0);
+}
+
+static int isPhysicalOrder(const unsigned char* pPhysicalSectors)
+{
+    unsigned int i;
+    
+    for (i = 0 ; i < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; i++)
+    {
+        if (pPhysicalSectors[i] != i)
+            return 0;
+    }
+    return 1;
+}
+
+
+__throws void NibbleDiskImage_ValidateRWTS16Interleave(const unsigned char* pPhysicalSectors)
+{
+    unsigned int used = 0;
+    unsigned int i;
+    
+    for (i = 0 ; i < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; i++)
+    {
+        unsigned int physicalSector = pPhysicalSectors[i];
+        
+        if (physicalSector >= NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK || (used & (1 << physicalSector)))
+            __throw(invalidArgumentException);
+        used |= 1 << physicalSector;
+    }
+}
+
+
+__throws void NibbleDiskImage_CalculateRWTS16Skew(unsigned char* pPhysicalSectors, unsigned int skew)
+{
+    unsigned int used = 0;
+    unsigned int physicalSector = 0;
+    unsigned int i;
+    
+    if (skew < 1 || skew >= NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK)
+        __throw(invalidArgumentException);
+
+    /* Each sector is placed skew slots after the previous one, moving on to the next free slot when the pattern wraps
+       around onto a slot which is already in use. */
+    for (i = 0 ; i < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; i++)
+    {
+        while (used & (1 << physicalSector))
+            physicalSector = (physicalSector + 1) % NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK;
+        pPhysicalSectors[i] = physicalSector;
+        used |= 1 << physicalSector;
+        physicalSector = (physicalSector + skew) % NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK;
+    }
+}
+
+
 __throws void NibbleDiskImage_ProcessScriptFile(NibbleDiskImage* pThis, const char* pScriptFilename)
 {
     DiskImage_ProcessScriptFile(&pThis->super, pScriptFilename);
@@ -130,13 +199,134 @@ static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert*
     NibbleDiskImage_InsertData((NibbleDiskImage*)pThis, pData, pInsert);
 }
 
+static void validateRWTS16Insert(NibbleDiskImage* pThis, DiskImageInsert* pInsert);
+static void validateRWTS16TrackAndSector(NibbleDiskImage* pThis, int isCopyProtectionSector);
+static void validateRW18TrackAndOffset(NibbleDiskImage* pThis);
+static void validateInsert(void* pThis, DiskImageInsert* pInsert)
+{
+    NibbleDiskImage* pNibbleThis = (NibbleDiskImage*)pThis;
+    
+    switch (pInsert->type)
+    {
+    case DISK_IMAGE_INSERTION_RWTS16:
+        validateRWTS16Insert(pNibbleThis, pInsert);
+        break;
+    case DISK_IMAGE_INSERTION_RWTS16CP:
+        pNibbleThis->track = pInsert->track;
+        pNibbleThis->sector = pInsert->sector;
+        validateRWTS16TrackAndSector(pNibbleThis, 1);
+        break;
+    case DISK_IMAGE_INSERTION_RW18:
+        pNibbleThis->track = pInsert->track;
+        pNibbleThis->intraTrackOffset = pInsert->intraTrackOffset;
+        validateRW18TrackAndOffset(pNibbleThis);
+        break;
+    case DISK_IMAGE_INSERTION_BLOCK:
+    default:
+        __throw(invalidInsertionTypeException);
+    }
+}
+
+static void validateRWTS16Insert(NibbleDiskImage* pThis, DiskImageInsert* pInsert)
+{
+    /* Checking the first and last sectors is enough since every sector in between is written sequentially.
+       A length of 0 means that it won't be known until the object file is read. */
+    unsigned int lastSectorIndex;
+    
+    pThis->track = pInsert->track;
+    pThis->sector = pInsert->sector;
+    pThis->bytesLeft = DISK_IMAGE_BYTES_PER_SECTOR;
+    validateRWTS16TrackAndSector(pThis, 0);
+    if (pInsert->length == 0)
+        return;
+    
+    lastSectorIndex = pThis->track * NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK + 
+                      pThis->sector + 
+                      (pInsert->length - 1) / DISK_IMAGE_BYTES_PER_SECTOR;
+    pThis->track = lastSectorIndex / NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK;
+    pThis->sector = lastSectorIndex % NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK;
+    pThis->bytesLeft = pInsert->length - (pInsert->length - 1) / DISK_IMAGE_BYTES_PER_SECTOR * DISK_IMAGE_BYTES_PER_SECTOR;
+    validateRWTS16TrackAndSector(pThis, 0);
+}
+
+
+#define RW18_DOMAIN_FLAG  0x100
+
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents)
+{
+    /* Domain 0 holds the physical tracks with RWTS16 sectors mapped to offsets as though the disk was stored in DOS 3.3
+       track/sector order.  Each RW18 side gets a domain of its own for the bytes written to it but an RW18 write also
+       rewrites every track it touches, zero filling them if they were last written as another side.  It therefore
+       claims those whole tracks in domain 0 too, grouped by side so that further writes to the same side don't
+       conflict with the claim but RWTS16 sectors and other sides on those tracks do. */
+    DiskImageExtent* pExtent = &pExtents[0];
+    unsigned int     lastTrack;
+    
+    switch (pInsert->type)
+    {
+    case DISK_IMAGE_INSERTION_RWTS16:
+    case DISK_IMAGE_INSERTION_RWTS16CP:
+        pExtent->domain = 0;
+        pExtent->start = (pInsert->track * NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK + pInsert->sector) * 
+                         DISK_IMAGE_BYTES_PER_SECTOR;
+        pExtent->end = pExtent->start + 
+                       (pInsert->type == DISK_IMAGE_INSERTION_RWTS16CP ? DISK_IMAGE_BYTES_PER_SECTOR : pInsert->length);
+        break;
+    case DISK_IMAGE_INSERTION_RW18:
+        pExtent->domain = RW18_DOMAIN_FLAG | pInsert->side;
+        pExtent->start = pInsert->track * DISK_IMAGE_RW18_BYTES_PER_TRACK + pInsert->intraTrackOffset;
+        pExtent->end = pExtent->start + pInsert->length;
+        if (pInsert->length == 0)
+            break;
+        lastTrack = (pExtent->end - 1) / DISK_IMAGE_RW18_BYTES_PER_TRACK;
+        pExtents[1].domain = 0;
+        pExtents[1].start = pInsert->track * NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK * DISK_IMAGE_BYTES_PER_SECTOR;
+        pExtents[1].end = (lastTrack + 1) * NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK * DISK_IMAGE_BYTES_PER_SECTOR;
+        pExtents[1].group = RW18_DOMAIN_FLAG | pInsert->side;
+        return 2;
+    case DISK_IMAGE_INSERTION_BLOCK:
+    default:
+        pExtent->domain = 0;
+        pExtent->start = 0;
+        pExtent->end = 0;
+        break;
+    }
+    return 1;
+}
+
+
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize)
+{
+    if (domain == 0)
+    {
+        *pDomainSize = DISK_IMAGE_TRACKS_PER_SIDE * NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK * DISK_IMAGE_BYTES_PER_SECTOR;
+        return "Physical tracks as RWTS16 track/sector bytes";
+    }
+    
+    *pDomainSize = DISK_IMAGE_TRACKS_PER_SIDE * DISK_IMAGE_RW18_BYTES_PER_TRACK;
+    switch (domain & ~RW18_DOMAIN_FLAG)
+    {
+    case DISK_IMAGE_RW18_SIDE_0:
+        return "RW18 side 0xa9 track bytes";
+    case DISK_IMAGE_RW18_SIDE_1:
+        return "RW18 side 0xad track bytes";
+    case DISK_IMAGE_RW18_SIDE_2:
+        return "RW18 side 0x79 track bytes";
+    default:
+        return "RW18 invalid side track bytes";
+    }
+}
+
+
 static void insertRWTS16Data(NibbleDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
 static void prepareForFirstRWTS16Sector(NibbleDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+static void writeRWTS16SectorsOnCurrentTrack(NibbleDiskImage* pThis);
 static void advanceToNextSector(NibbleDiskImage* pThis);
 static void writeRWTS16Sector(NibbleDiskImage* pThis, int);
-static void validateRWTS16TrackAndSector(NibbleDiskImage* pThis, int isCopyProtectionSector);
 static void writeSectorLeadInSyncBytes(NibbleDiskImage* pThis);
 static void writeSyncBytes(NibbleDiskImage* pThis, size_t syncByteCount);
+static void markSyncNibbles(NibbleDiskImage* pThis, const unsigned char* pStart, size_t nibbleCount, int isSync);
+static void setSyncNibbleBit(NibbleDiskImage* pThis, size_t index, int isSync);
 static void writeRWTS16AddressField(NibbleDiskImage* pThis, unsigned char volume, unsigned char track, unsigned char sector);
 static void writeRWTS16AddressFieldProlog(NibbleDiskImage* pThis);
 static void initChecksum(NibbleDiskImage* pThis);
@@ -164,7 +354,6 @@ static void writeRWTS16CPDataField(NibbleDiskImage* pThis);
 static void insertRW18Data(NibbleDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
 static void prepareForFirstRW18Track(NibbleDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
 static void writeRW18Track(NibbleDiskImage* pThis);
-static void validateRW18TrackAndOffset(NibbleDiskImage* pThis);
 static unsigned int initTrackData(NibbleDiskImage* pThis, unsigned char* pTrackData, size_t trackDataSize);
 static void readCurrentTrackContentsOrZeroFill(NibbleDiskImage* pThis, unsigned char* pTrackData, size_t trackDataSize);
 static void writeEncodedBytes(NibbleDiskImage* pThis, const char* pBytes, size_t byteCount);
@@ -200,10 +389,7 @@ static void insertRWTS16Data(NibbleDiskImage* pThis, const unsigned char* pData,
 {
     prepareForFirstRWTS16Sector(pThis, pData, pInsert);
     while (pThis->bytesLeft > 0)
-    {
-        writeRWTS16Sector(pThis, 0);
-        advanceToNextSector(pThis);
-    }
+        writeRWTS16SectorsOnCurrentTrack(pThis);
 }
 
 static void prepareForFirstRWTS16Sector(NibbleDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
@@ -214,6 +400,30 @@ static void prepareForFirstRWTS16Sector(NibbleDiskImage* pThis, const unsigned c
     pThis->pData = pData + pInsert->sourceOffset;
 }
 
+static void writeRWTS16SectorsOnCurrentTrack(NibbleDiskImage* pThis)
+{
+    unsigned int track = pThis->track;
+    
+    TraceLog_Begin("track", "RWTS16 track %u", track);
+    PerfCounters_Begin("RWTS16 track encode");
+    __try
+    {
+        while (pThis->bytesLeft > 0 && pThis->track == track)
+        {
+            writeRWTS16Sector(pThis, 0);
+            advanceToNextSector(pThis);
+        }
+    }
+    __catch
+    {
+        PerfCounters_End();
+        TraceLog_End();
+        __rethrow;
+    }
+    PerfCounters_End();
+    TraceLog_End();
+}
+
 static void advanceToNextSector(NibbleDiskImage* pThis)
 {
     pThis->bytesLeft -= DISK_IMAGE_BYTES_PER_SECTOR;
@@ -229,16 +439,18 @@ static void advanceToNextSector(NibbleDiskImage* pThis)
 static void writeRWTS16Sector(NibbleDiskImage* pThis, int isCopyProtectionSector)
 {
     static const unsigned char   volume = 0;
-    unsigned int                 imageOffset = NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * pThis->track + 
-                                               NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES +
-                                               NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR * pThis->sector;
+    unsigned int                 imageOffset;
     const unsigned char*         pStart;
     ptrdiff_t leeway;
     
     validateRWTS16TrackAndSector(pThis, isCopyProtectionSector);
-        
+    
+    imageOffset = NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * pThis->track + 
+                  NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES +
+                  NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR * pThis->rwts16PhysicalSectors[pThis->sector];
     pThis->pWrite = DiskImage_GetImagePointer(&pThis->super) + imageOffset;
     pStart = pThis->pWrite;
+    markSyncNibbles(pThis, pStart, NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR - NIBBLE_DISK_IMAGE_RWTS16_GAP3_SYNC_BYTES, 0);
     
     writeSectorLeadInSyncBytes(pThis);
     writeRWTS16AddressField(pThis, volume, pThis->track, pThis->sector);
@@ -251,7 +463,7 @@ static void writeRWTS16Sector(NibbleDiskImage* pThis, int isCopyProtectionSector
     leeway = (NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR - NIBBLE_DISK_IMAGE_RWTS16_GAP3_SYNC_BYTES) - (pThis->pWrite - pStart);
     assert(leeway >= 0);
     if (leeway > 0)
-        memset(pThis->pWrite, 0xff, (size_t)leeway);
+        writeSyncBytes(pThis, (size_t)leeway);
 }
 
 static void validateRWTS16TrackAndSector(NibbleDiskImage* pThis, int isCopyProtectionSector)
@@ -268,7 +480,7 @@ static void writeSectorLeadInSyncBytes(NibbleDiskImage* pThis)
 {
     size_t leadInSyncByteCount;
     
-    if (pThis->sector == 0)
+    if (pThis->rwts16PhysicalSectors[pThis->sector] == 0)
         leadInSyncByteCount = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES;
     else
         leadInSyncByteCount = NIBBLE_DISK_IMAGE_RWTS16_GAP3_SYNC_BYTES;
@@ -279,10 +491,36 @@ static void writeSectorLeadInSyncBytes(NibbleDiskImage* pThis)
 
 static void writeSyncBytes(NibbleDiskImage* pThis, size_t syncByteCount)
 {
+    markSyncNibbles(pThis, pThis->pWrite, syncByteCount, 1);
     memset(pThis->pWrite, 0xff, syncByteCount);
     pThis->pWrite += syncByteCount;
 }
 
+static void markSyncNibbles(NibbleDiskImage* pThis, const unsigned char* pStart, size_t nibbleCount, int isSync)
+{
+    size_t index = pStart - DiskImage_GetImagePointer(&pThis->super);
+    size_t end = index + nibbleCount;
+    size_t byteCount;
+    
+    while (index < end && (index & 7) != 0)
+        setSyncNibbleBit(pThis, index++, isSync);
+    byteCount = (end - index) / 8;
+    memset(&pThis->syncNibbles[index / 8], isSync ? 0xFF : 0x00, byteCount);
+    index += byteCount * 8;
+    while (index < end)
+        setSyncNibbleBit(pThis, index++, isSync);
+}
+
+static void setSyncNibbleBit(NibbleDiskImage* pThis, size_t index, int isSync)
+{
+    unsigned char mask = 0x80 >> (index & 7);
+    
+    if (isSync)
+        pThis->syncNibbles[index / 8] |= mask;
+    else
+        pThis->syncNibbles[index / 8] &= ~mask;
+}
+
 static void writeRWTS16AddressField(NibbleDiskImage* pThis, unsigned char volume, unsigned char track, unsigned char sector)
 {
     writeRWTS16AddressFieldProlog(pThis);
@@ -453,21 +691,22 @@ static void insertRWTS16CPData(NibbleDiskImage* pThis, const unsigned char* pDat
     writeRWTS16Sector(pThis, 1);
 }
 
+/* If Michael Kelsey's description (textfiles.com/apple/CRACKING/asstcracks1.txt) is anything to go by, this is
+   a "bit insertion" copy protection technique.  The precise technique is likely hard to replicate in a nibble
+   disk image in a way which is faithful to the original _and_ also works with emulators.  I follow Kelsey's
+   solution here: use a nibble sequence which has no hidden timing bits, but still satisfies what the protection
+   check routines want.
+
+   -- tkchia 20131015
+*/
+static const char g_rwts16CPMagicNibbles[] = "\xe7\xe7\xe7\xe7\xe7\xe7\xaf\xf3\xfc\xee\xe7\xfc\xee\xe7\xfc\xee\xee\xfc";
+
 static void writeRWTS16CPDataField(NibbleDiskImage* pThis)
 {
-    /* If Michael Kelsey's description (textfiles.com/apple/CRACKING/asstcracks1.txt) is anything to go by, this is
-       a "bit insertion" copy protection technique.  The precise technique is likely hard to replicate in a nibble
-       disk image in a way which is faithful to the original _and_ also works with emulators.  I follow Kelsey's
-       solution here: use a nibble sequence which has no hidden timing bits, but still satisfies what the protection
-       check routines want.
-
-       -- tkchia 20131015
-    */
-    static const char magicNibbles[] = "\xe7\xe7\xe7\xe7\xe7\xe7\xaf\xf3\xfc\xee\xe7\xfc\xee\xe7\xfc\xee\xee\xfc";
     size_t i;
     writeRWTS16DataFieldProlog(pThis);
-    writeEncodedBytes(pThis, magicNibbles, sizeof magicNibbles - 1);
-    for (i = sizeof magicNibbles - 1; i < 343; ++i)
+    writeEncodedBytes(pThis, g_rwts16CPMagicNibbles, sizeof g_rwts16CPMagicNibbles - 1);
+    for (i = sizeof g_rwts16CPMagicNibbles - 1; i < 343; ++i)
         writeEncodedBytes(pThis, "\xff", 1);
     writeRWTS16FieldEpilog(pThis);
 }
@@ -497,11 +736,14 @@ static void writeRW18Track(NibbleDiskImage* pThis)
     const unsigned char* pStart;
     
     validateRW18TrackAndOffset(pThis);
+    TraceLog_Begin("track", "RW18 side %02x track %u", pThis->side, pThis->track);
+    PerfCounters_Begin("RW18 track encode");
 
     bytesUsed = initTrackData(pThis, trackData, sizeof(trackData));
     pThis->pWrite = DiskImage_GetImagePointer(&pThis->super) + destOffset;
     pThis->pCurrentTrack = trackData;
     pStart = pThis->pWrite;
+    markSyncNibbles(pThis, pStart, NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK, 0);
     
     writeSyncBytes(pThis, 403);
     writeEncodedBytes(pThis, "\xa5\x96\xbf\xff\xfe\xaa\xbb\xaa\xaa\xff\xef\x9a", 12);
@@ -516,6 +758,8 @@ static void writeRW18Track(NibbleDiskImage* pThis)
     assert ( pThis->pWrite - pStart == NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK );
     
     advanceToNextRW18Track(pThis, bytesUsed);
+    PerfCounters_End();
+    TraceLog_End();
 }
 
 static void validateRW18TrackAndOffset(NibbleDiskImage* pThis)
@@ -650,6 +894,18 @@ __throws void NibbleDiskImage_WriteImage(NibbleDiskImage* pThis, const char* pIm
 }
 
 
+__throws void NibbleDiskImage_UpdateImage(NibbleDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename)
+{
+    DiskImage_UpdateImage(&pThis->super, pScriptFilename, pImageFilename);
+}
+
+
+void NibbleDiskImage_PrintLayoutMap(NibbleDiskImage* pThis)
+{
+    DiskImage_PrintLayoutMap(&pThis->super);
+}
+
+
 const unsigned char* NibbleDiskImage_GetImagePointer(NibbleDiskImage* pThis)
 {
     return DiskImage_GetImagePointer(&pThis->super);
@@ -662,6 +918,33 @@ size_t NibbleDiskImage_GetImageSize(NibbleDiskImage* pThis)
 }
 
 
+int NibbleDiskImage_IsSyncNibble(NibbleDiskImage* pThis, unsigned int imageOffset)
+{
+    return imageOffset < NIBBLE_DISK_IMAGE_SIZE && (pThis->syncNibbles[imageOffset / 8] & (0x80 >> (imageOffset & 7)));
+}
+
+
+#define RW18_TRACK_SYNC_BYTES   403
+#define RW18_TRACK_HEADER       "\xa5\x96\xbf\xff\xfe\xaa\xbb\xaa\xaa\xff\xef\x9a"
+#define RW18_SIDE_OFFSET        (RW18_TRACK_SYNC_BYTES + sizeof(RW18_TRACK_HEADER) - 1 + 2 + 3 + 1 + 2)
+
+int NibbleDiskImage_FindRW18Track(NibbleDiskImage* pThis, unsigned int track, unsigned int* pSide)
+{
+    const unsigned char* pTrack;
+    
+    if (track >= DISK_IMAGE_TRACKS_PER_SIDE)
+        return 0;
+    pTrack = DiskImage_GetImagePointer(&pThis->super) + NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * track;
+    if (pTrack[0] != 0xFF ||
+        0 != memcmp(pTrack + RW18_TRACK_SYNC_BYTES, RW18_TRACK_HEADER, sizeof(RW18_TRACK_HEADER) - 1))
+    {
+        return 0;
+    }
+    *pSide = pTrack[RW18_SIDE_OFFSET];
+    return 1;
+}
+
+
 static void validateReadRWTrackArguments(unsigned int track, size_t trackDataSize);
 static void validateSyncBytes(NibbleDiskImage* pThis, unsigned int expectedSyncBytes);
 static void validateByte(NibbleDiskImage* pThis, unsigned char expectedByte);
@@ -683,8 +966,8 @@ __throws void NibbleDiskImage_ReadRW18Track(NibbleDiskImage* pThis,
     pThis->track = track;
     pThis->side = side;
 
-    validateSyncBytes(pThis, 403);
-    validateBytes(pThis, "\xa5\x96\xbf\xff\xfe\xaa\xbb\xaa\xaa\xff\xef\x9a", 12);
+    validateSyncBytes(pThis, RW18_TRACK_SYNC_BYTES);
+    validateBytes(pThis, RW18_TRACK_HEADER, sizeof(RW18_TRACK_HEADER) - 1);
     extractRW18Sector(pThis, sector);
     
     do
@@ -768,3 +1051,157 @@ static void validateDecodedByte(NibbleDiskImage* pThis, unsigned char expectedBy
     if (decodedByte != expectedByte)
         __throw(badTrackException);
 }
+
+
+#define RWTS16_ADDRESS_FIELD_NIBBLES    14
+#define RWTS16_DATA_FIELD_NIBBLES       349
+#define RWTS16_6AND2_NIBBLES            343
+#define RWTS16_SECTOR_FIELD_NIBBLES     (RWTS16_ADDRESS_FIELD_NIBBLES + NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES + \
+                                         RWTS16_DATA_FIELD_NIBBLES)
+
+static void validateReadRWTS16SectorArguments(unsigned int track, unsigned int sector, size_t sectorDataSize);
+static const unsigned char* findRWTS16AddressField(const unsigned char* pTrack, unsigned int track, unsigned int sector);
+static unsigned char decode4and4Data(const unsigned char* pEncoded);
+static unsigned char read4and4Data(NibbleDiskImage* pThis);
+static int isRWTS16CPDataField(NibbleDiskImage* pThis);
+static void extract6and2Data(NibbleDiskImage* pThis, unsigned char* pSectorData);
+static unsigned char read6and2Byte(NibbleDiskImage* pThis, unsigned char lastByte);
+static unsigned char decodeAuxBits(NibbleDiskImage* pThis, size_t i);
+__throws int NibbleDiskImage_ReadRWTS16Sector(NibbleDiskImage* pThis,
+                                              unsigned int track,
+                                              unsigned int sector,
+                                              unsigned char* pSectorData,
+                                              size_t sectorDataSize)
+{
+    const unsigned char* pTrack;
+    unsigned char        volume;
+    
+    validateReadRWTS16SectorArguments(track, sector, sectorDataSize);
+    
+    pTrack = DiskImage_GetImagePointer(&pThis->super) + NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * track;
+    pThis->pRead = findRWTS16AddressField(pTrack, track, sector);
+    if (!pThis->pRead)
+        __throw(sectorNotFoundException);
+    
+    validateBytes(pThis, "\xD5\xAA\x96", 3);
+    volume = read4and4Data(pThis);
+    read4and4Data(pThis);
+    read4and4Data(pThis);
+    if (read4and4Data(pThis) != (volume ^ track ^ sector))
+        __throw(badTrackException);
+    validateBytes(pThis, "\xDE\xAA\xEB", 3);
+    validateSyncBytes(pThis, NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES);
+    validateBytes(pThis, "\xD5\xAA\xAD", 3);
+    
+    if (isRWTS16CPDataField(pThis))
+    {
+        memset(pSectorData, 0, sectorDataSize);
+        return 1;
+    }
+    extract6and2Data(pThis, pSectorData);
+    validateBytes(pThis, "\xDE\xAA\xEB", 3);
+    
+    return 0;
+}
+
+static void validateReadRWTS16SectorArguments(unsigned int track, unsigned int sector, size_t sectorDataSize)
+{
+    if (track >= DISK_IMAGE_TRACKS_PER_SIDE)
+        __throw(invalidTrackException);
+    if (sector >= NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK)
+        __throw(invalidSectorException);
+    if (sectorDataSize != DISK_IMAGE_BYTES_PER_SECTOR)
+        __throw(invalidArgumentException);
+}
+
+static const unsigned char* findRWTS16AddressField(const unsigned char* pTrack, unsigned int track, unsigned int sector)
+{
+    const unsigned char* pCurr = pTrack;
+    const unsigned char* pLast = pTrack + NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK - RWTS16_SECTOR_FIELD_NIBBLES;
+    
+    /* The address field is located by the track and sector it claims to hold so that the decode doesn't depend on
+       the interleave used when the image was built.  memchr() skips over the long runs of sync and data nibbles
+       between prologs much faster than a byte at a time loop. */
+    while (NULL != (pCurr = memchr(pCurr, 0xD5, pLast - pCurr + 1)))
+    {
+        if (pCurr[1] == 0xAA && pCurr[2] == 0x96 &&
+            decode4and4Data(&pCurr[5]) == track && decode4and4Data(&pCurr[7]) == sector)
+        {
+            return pCurr;
+        }
+        if (pCurr++ == pLast)
+            break;
+    }
+    
+    return NULL;
+}
+
+static unsigned char decode4and4Data(const unsigned char* pEncoded)
+{
+    return ((pEncoded[0] << 1) | 0x01) & pEncoded[1];
+}
+
+static unsigned char read4and4Data(NibbleDiskImage* pThis)
+{
+    unsigned char byte = decode4and4Data(pThis->pRead);
+    
+    pThis->pRead += 2;
+    return byte;
+}
+
+static int isRWTS16CPDataField(NibbleDiskImage* pThis)
+{
+    size_t i;
+    
+    if (0 != memcmp(pThis->pRead, g_rwts16CPMagicNibbles, sizeof(g_rwts16CPMagicNibbles) - 1))
+        return 0;
+    for (i = sizeof(g_rwts16CPMagicNibbles) - 1 ; i < RWTS16_6AND2_NIBBLES ; i++)
+    {
+        if (pThis->pRead[i] != 0xFF)
+            return 0;
+    }
+    pThis->pRead += RWTS16_6AND2_NIBBLES;
+    validateBytes(pThis, "\xDE\xAA\xEB", 3);
+    
+    return 1;
+}
+
+static void extract6and2Data(NibbleDiskImage* pThis, unsigned char* pSectorData)
+{
+    unsigned char lastByte = 0;
+    size_t        i;
+    
+    for (i = 0 ; i < sizeof(pThis->aux) ; i++)
+        pThis->aux[sizeof(pThis->aux) - 1 - i] = lastByte = read6and2Byte(pThis, lastByte);
+    for (i = 0 ; i < DISK_IMAGE_BYTES_PER_SECTOR ; i++)
+        pSectorData[i] = (lastByte = read6and2Byte(pThis, lastByte)) << 2;
+    if (read6and2Byte(pThis, lastByte) != 0x00)
+        __throw(badTrackException);
+    
+    for (i = 0 ; i < DISK_IMAGE_BYTES_PER_SECTOR ; i++)
+        pSectorData[i] |= decodeAuxBits(pThis, i);
+}
+
+static unsigned char read6and2Byte(NibbleDiskImage* pThis, unsigned char lastByte)
+{
+    unsigned char decodedByte = pThis->decode8to6[*pThis->pRead++];
+    
+    if (decodedByte == 0xFF)
+        __throw(badTrackException);
+    return decodedByte ^ lastByte;
+}
+
+static unsigned char decodeAuxBits(NibbleDiskImage* pThis, size_t i)
+{
+    /* Inverse of encodeAuxByte(): find which aux byte and bit pair holds the low 2 bits of data byte i. */
+    unsigned char auxByte;
+    
+    if (i <= lowBitOffset(0))
+        auxByte = pThis->aux[lowBitOffset(i)];
+    else if (i <= midBitOffset(0))
+        auxByte = pThis->aux[midBitOffset(i)] >> 2;
+    else
+        auxByte = pThis->aux[highBitOffset(i)] >> 4;
+    
+    return ((auxByte & 1) << 1) | ((auxByte & 2) >> 1);
+}
@@ -0,0 +1,47 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#ifndef _NIBBLE_DISK_IMAGE_PRIV_H_
+#define _NIBBLE_DISK_IMAGE_PRIV_H_
+
+#include "NibbleDiskImage.h"
+#include "DiskImagePriv.h"
+
+
+struct NibbleDiskImage
+{
+    DiskImage            super;
+    unsigned char*       pWrite;
+    const unsigned char* pRead;
+    const unsigned char* pData;
+    unsigned char*       pCurrentTrack;
+    unsigned int         side;
+    unsigned int         track;
+    unsigned int         sector;
+    unsigned int         intraTrackOffset;
+    unsigned int         bytesLeft;
+    unsigned char        checksum;
+    unsigned char        lastByte;
+    unsigned char        aux[86];
+    unsigned char        decode8to6[256];
+    unsigned char        rwts16PhysicalSectors[NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK];
+    /* Bit n is set when nibble n of the image is a sync byte which a real drive would write with 2 trailing zero
+       bits.  The .nib format has no room for those bits but bitstream based formats need them. */
+    unsigned char        syncNibbles[NIBBLE_DISK_IMAGE_SIZE / 8];
+};
+
+
+extern DiskImageVTable NibbleDiskImageVTable;
+
+__throws void NibbleDiskImage_Init(NibbleDiskImage* pThis, DiskImageVTable* pVTable);
+
+#endif /* _NIBBLE_DISK_IMAGE_PRIV_H_ */
@@ -0,0 +1,310 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "NibbleImageExtractor.h"
+#include "NibbleDiskImage.h"
+#include "DiskImageTest.h"
+#include "util.h"
+
+
+#define RWTS16_BYTES_PER_TRACK  (NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK * DISK_IMAGE_BYTES_PER_SECTOR)
+
+
+typedef enum TrackType
+{
+    TRACK_EMPTY,
+    TRACK_RWTS16,
+    TRACK_RW18
+} TrackType;
+
+
+struct NibbleImageExtractor
+{
+    NibbleDiskImage* pImage;
+    const char*      pImageFilename;
+    TrackType        trackType;
+    unsigned int     side;
+    unsigned int     sectorMask;
+    unsigned int     errorCount;
+    unsigned int     rwts16SectorCount;
+    unsigned int     rw18TrackCount;
+    unsigned char    trackData[DISK_IMAGE_RW18_BYTES_PER_TRACK];
+};
+
+
+__throws NibbleImageExtractor* NibbleImageExtractor_Create(const char* pImageFilename)
+{
+    NibbleImageExtractor* pThis = NULL;
+
+    __try
+    {
+        pThis = allocateAndZero(sizeof(*pThis));
+        pThis->pImage = NibbleDiskImage_Create();
+        DiskImage_ReadImage((DiskImage*)pThis->pImage, pImageFilename);
+    }
+    __catch
+    {
+        NibbleImageExtractor_Free(pThis);
+        __rethrow;
+    }
+    pThis->pImageFilename = pImageFilename;
+
+    return pThis;
+}
+
+
+void NibbleImageExtractor_Free(NibbleImageExtractor* pThis)
+{
+    if (!pThis)
+        return;
+
+    DiskImage_Free((DiskImage*)pThis->pImage);
+    free(pThis);
+}
+
+
+#define LOG_ERROR(pTHIS, FORMAT, ...) (pTHIS->errorCount++, \
+                                       fprintf(stderr, \
+                                       "%s: error: " FORMAT LINE_ENDING, \
+                                       pTHIS->pImageFilename, \
+                                       __VA_ARGS__))
+
+static void resetCounts(NibbleImageExtractor* pThis);
+static void decodeTrack(NibbleImageExtractor* pThis, unsigned int track);
+static int decodeRW18Track(NibbleImageExtractor* pThis, unsigned int track);
+static void decodeRWTS16Sector(NibbleImageExtractor* pThis, unsigned int track, unsigned int sector);
+static void insertRWTS16Sectors(NibbleImageExtractor* pThis, SectorDiskImage* pSectorImage, unsigned int track);
+static void printSummary(NibbleImageExtractor* pThis, const char* pOutputName);
+__throws unsigned int NibbleImageExtractor_WriteSectorImage(NibbleImageExtractor* pThis, 
+                                                            SectorDiskImageOrder  order, 
+                                                            const char*           pImageFilename)
+{
+    SectorDiskImage* pSectorImage = NULL;
+    unsigned int     track;
+
+    __try
+    {
+        pSectorImage = SectorDiskImage_Create(order);
+        resetCounts(pThis);
+        for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+        {
+            decodeTrack(pThis, track);
+            if (pThis->trackType == TRACK_RW18)
+                printf("%s: RW18 track %u skipped.  Only track files can hold RW18 data.\n", pThis->pImageFilename, track);
+            else if (pThis->trackType == TRACK_RWTS16)
+                insertRWTS16Sectors(pThis, pSectorImage, track);
+        }
+        SectorDiskImage_WriteImage(pSectorImage, pImageFilename);
+    }
+    __catch
+    {
+        DiskImage_Free((DiskImage*)pSectorImage);
+        __rethrow;
+    }
+    DiskImage_Free((DiskImage*)pSectorImage);
+    printSummary(pThis, pImageFilename);
+
+    return pThis->errorCount;
+}
+
+static void resetCounts(NibbleImageExtractor* pThis)
+{
+    pThis->errorCount = 0;
+    pThis->rwts16SectorCount = 0;
+    pThis->rw18TrackCount = 0;
+}
+
+static void decodeTrack(NibbleImageExtractor* pThis, unsigned int track)
+{
+    unsigned int sector;
+
+    memset(pThis->trackData, 0, sizeof(pThis->trackData));
+    pThis->sectorMask = 0;
+    if (NibbleDiskImage_FindRW18Track(pThis->pImage, track, &pThis->side))
+    {
+        pThis->trackType = decodeRW18Track(pThis, track) ? TRACK_RW18 : TRACK_EMPTY;
+        return;
+    }
+
+    for (sector = 0 ; sector < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; sector++)
+        decodeRWTS16Sector(pThis, track, sector);
+    pThis->trackType = pThis->sectorMask ? TRACK_RWTS16 : TRACK_EMPTY;
+}
+
+static int decodeRW18Track(NibbleImageExtractor* pThis, unsigned int track)
+{
+    __try
+    {
+        NibbleDiskImage_ReadRW18Track(pThis->pImage, pThis->side, track, pThis->trackData, sizeof(pThis->trackData));
+    }
+    __catch
+    {
+        LOG_ERROR(pThis, "Track %u doesn't contain valid RW18 sectors for side 0x%x.", track, pThis->side);
+        __nothrow_and_return(0);
+    }
+
+    return 1;
+}
+
+static void decodeRWTS16Sector(NibbleImageExtractor* pThis, unsigned int track, unsigned int sector)
+{
+    unsigned char* pSectorData = pThis->trackData + sector * DISK_IMAGE_BYTES_PER_SECTOR;
+    int            isCopyProtectionSector = 0;
+
+    __try
+    {
+        isCopyProtectionSector = NibbleDiskImage_ReadRWTS16Sector(pThis->pImage, track, sector, 
+                                                                  pSectorData, DISK_IMAGE_BYTES_PER_SECTOR);
+    }
+    __catch
+    {
+        if (getExceptionCode() != sectorNotFoundException)
+            LOG_ERROR(pThis, "Track %u sector %u has a corrupt address or data field.", track, sector);
+        memset(pSectorData, 0, DISK_IMAGE_BYTES_PER_SECTOR);
+        __nothrow;
+    }
+
+    /* RWTS16CP sectors hold protection nibbles rather than data so there is nothing to extract from them. */
+    if (!isCopyProtectionSector)
+        pThis->sectorMask |= 1 << sector;
+}
+
+static void insertRWTS16Sectors(NibbleImageExtractor* pThis, SectorDiskImage* pSectorImage, unsigned int track)
+{
+    DiskImageInsert insert;
+    unsigned int    sector;
+
+    memset(&insert, 0, sizeof(insert));
+    insert.type = DISK_IMAGE_INSERTION_RWTS16;
+    insert.length = DISK_IMAGE_BYTES_PER_SECTOR;
+    insert.track = track;
+    for (sector = 0 ; sector < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; sector++)
+    {
+        if ((pThis->sectorMask & (1 << sector)) == 0)
+            continue;
+        insert.sector = sector;
+        SectorDiskImage_InsertData(pSectorImage, pThis->trackData + sector * DISK_IMAGE_BYTES_PER_SECTOR, &insert);
+        pThis->rwts16SectorCount++;
+    }
+}
+
+static void printSummary(NibbleImageExtractor* pThis, const char* pOutputName)
+{
+    printf("%s: %u RWTS16 sectors and %u RW18 tracks extracted to %s with %u error%s.\n",
+           pThis->pImageFilename,
+           pThis->rwts16SectorCount,
+           pThis->rw18TrackCount,
+           pOutputName,
+           pThis->errorCount,
+           pThis->errorCount == 1 ? "" : "s");
+}
+
+
+static unsigned int countSectors(unsigned int sectorMask);
+static void writeTrackFile(NibbleImageExtractor* pThis, const char* pFilenamePrefix, unsigned int track);
+static char* allocateTrackFilename(NibbleImageExtractor* pThis, const char* pFilenamePrefix, unsigned int track);
+static FILE* openFile(const char* pFilename, const char* pMode);
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile);
+__throws unsigned int NibbleImageExtractor_WriteTrackFiles(NibbleImageExtractor* pThis, const char* pFilenamePrefix)
+{
+    unsigned int track;
+
+    resetCounts(pThis);
+    for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+    {
+        decodeTrack(pThis, track);
+        if (pThis->trackType == TRACK_EMPTY)
+            continue;
+        writeTrackFile(pThis, pFilenamePrefix, track);
+        if (pThis->trackType == TRACK_RW18)
+            pThis->rw18TrackCount++;
+        else
+            pThis->rwts16SectorCount += countSectors(pThis->sectorMask);
+    }
+    printSummary(pThis, pFilenamePrefix);
+
+    return pThis->errorCount;
+}
+
+static unsigned int countSectors(unsigned int sectorMask)
+{
+    unsigned int count = 0;
+
+    for ( ; sectorMask ; sectorMask &= sectorMask - 1)
+        count++;
+    return count;
+}
+
+static void writeTrackFile(NibbleImageExtractor* pThis, const char* pFilenamePrefix, unsigned int track)
+{
+    char*  pFilename = NULL;
+    FILE*  pFile = NULL;
+    size_t size = pThis->trackType == TRACK_RW18 ? DISK_IMAGE_RW18_BYTES_PER_TRACK : RWTS16_BYTES_PER_TRACK;
+
+    __try
+    {
+        pFilename = allocateTrackFilename(pThis, pFilenamePrefix, track);
+        pFile = openFile(pFilename, "wb");
+        writeExactly(pThis->trackData, size, pFile);
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        free(pFilename);
+        __rethrow;
+    }
+
+    fclose(pFile);
+    free(pFilename);
+}
+
+static char* allocateTrackFilename(NibbleImageExtractor* pThis, const char* pFilenamePrefix, unsigned int track)
+{
+    /* Room for the ".tTT.SS" track and side fields and the longest suffix. */
+    char* pFilename = allocateAndZero(strlen(pFilenamePrefix) + 8 + sizeof(NIBBLE_IMAGE_EXTRACTOR_RWTS16_SUFFIX));
+
+    if (pThis->trackType == TRACK_RW18)
+        sprintf(pFilename, "%s.t%02u.%02x" NIBBLE_IMAGE_EXTRACTOR_RW18_SUFFIX, pFilenamePrefix, track, pThis->side);
+    else
+        sprintf(pFilename, "%s.t%02u" NIBBLE_IMAGE_EXTRACTOR_RWTS16_SUFFIX, pFilenamePrefix, track);
+
+    return pFilename;
+}
+
+static FILE* openFile(const char* pFilename, const char* pMode)
+{
+    FILE* pFile = fopen(pFilename, pMode);
+    if (!pFile)
+        __throw(fileOpenException);
+    return pFile;
+}
+
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile)
+{
+    if (bufferSize != fwrite(pBuffer, 1, bufferSize, pFile))
+        __throw(fileException);
+}
+
+
+unsigned int NibbleImageExtractor_GetRWTS16SectorCount(NibbleImageExtractor* pThis)
+{
+    return pThis->rwts16SectorCount;
+}
+
+
+unsigned int NibbleImageExtractor_GetRW18TrackCount(NibbleImageExtractor* pThis)
+{
+    return pThis->rw18TrackCount;
+}
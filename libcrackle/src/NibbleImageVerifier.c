@@ -0,0 +1,241 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "NibbleImageVerifier.h"
+#include "NibbleDiskImage.h"
+#include "DiskImageTest.h"
+#include "util.h"
+
+
+typedef enum SectorStatus
+{
+    SECTOR_MISSING,
+    SECTOR_CORRUPT,
+    SECTOR_DATA,
+    SECTOR_COPY_PROTECTION
+} SectorStatus;
+
+
+struct NibbleImageVerifier
+{
+    NibbleDiskImage* pImage;
+    NibbleDiskImage* pExpected;
+    const char*      pImageFilename;
+    unsigned int     errorCount;
+    int              isPlanCacheDisabled;
+    unsigned int     rwts16SectorCount;
+    unsigned int     rw18TrackCount;
+    unsigned char    actualData[DISK_IMAGE_RW18_BYTES_PER_TRACK];
+    unsigned char    expectedData[DISK_IMAGE_RW18_BYTES_PER_TRACK];
+};
+
+
+__throws NibbleImageVerifier* NibbleImageVerifier_Create(const char* pImageFilename)
+{
+    NibbleImageVerifier* pThis = NULL;
+
+    __try
+    {
+        pThis = allocateAndZero(sizeof(*pThis));
+        pThis->pImage = NibbleDiskImage_Create();
+        DiskImage_ReadImage((DiskImage*)pThis->pImage, pImageFilename);
+    }
+    __catch
+    {
+        NibbleImageVerifier_Free(pThis);
+        __rethrow;
+    }
+    pThis->pImageFilename = pImageFilename;
+
+    return pThis;
+}
+
+
+void NibbleImageVerifier_Free(NibbleImageVerifier* pThis)
+{
+    if (!pThis)
+        return;
+
+    DiskImage_Free((DiskImage*)pThis->pImage);
+    DiskImage_Free((DiskImage*)pThis->pExpected);
+    free(pThis);
+}
+
+
+void NibbleImageVerifier_DisablePlanCache(NibbleImageVerifier* pThis)
+{
+    pThis->isPlanCacheDisabled = 1;
+}
+
+
+__throws void NibbleImageVerifier_ProcessScriptFile(NibbleImageVerifier* pThis, const char* pScriptFilename)
+{
+    NibbleDiskImage* pExpected = NibbleDiskImage_Create();
+
+    __try
+    {
+        if (pThis->isPlanCacheDisabled)
+            DiskImage_DisablePlanCache((DiskImage*)pExpected);
+        NibbleDiskImage_ProcessScriptFile(pExpected, pScriptFilename);
+    }
+    __catch
+    {
+        DiskImage_Free((DiskImage*)pExpected);
+        __rethrow;
+    }
+    DiskImage_Free((DiskImage*)pThis->pExpected);
+    pThis->pExpected = pExpected;
+}
+
+
+#define LOG_ERROR(pTHIS, FORMAT, ...) (pTHIS->errorCount++, \
+                                       fprintf(stderr, \
+                                       "%s: error: " FORMAT LINE_ENDING, \
+                                       pTHIS->pImageFilename, \
+                                       __VA_ARGS__))
+
+static void verifyRW18Track(NibbleImageVerifier* pThis, unsigned int track, unsigned int side);
+static int readRW18Track(NibbleDiskImage* pImage, unsigned int side, unsigned int track, unsigned char* pTrackData);
+static void verifyRWTS16Sector(NibbleImageVerifier* pThis, unsigned int track, unsigned int sector);
+static SectorStatus readRWTS16Sector(NibbleDiskImage* pImage, 
+                                     unsigned int     track, 
+                                     unsigned int     sector, 
+                                     unsigned char*   pSectorData);
+static int hasSectorContents(SectorStatus status);
+unsigned int NibbleImageVerifier_Verify(NibbleImageVerifier* pThis)
+{
+    unsigned int track;
+    unsigned int sector;
+    unsigned int side;
+    
+    pThis->errorCount = 0;
+    pThis->rwts16SectorCount = 0;
+    pThis->rw18TrackCount = 0;
+    for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+    {
+        if (NibbleDiskImage_FindRW18Track(pThis->pImage, track, &side) || 
+            (pThis->pExpected && NibbleDiskImage_FindRW18Track(pThis->pExpected, track, &side)))
+        {
+            verifyRW18Track(pThis, track, side);
+            continue;
+        }
+        for (sector = 0 ; sector < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; sector++)
+            verifyRWTS16Sector(pThis, track, sector);
+    }
+    printf("%s: %u RWTS16 sectors and %u RW18 tracks verified with %u error%s.\n",
+           pThis->pImageFilename,
+           pThis->rwts16SectorCount,
+           pThis->rw18TrackCount,
+           pThis->errorCount,
+           pThis->errorCount == 1 ? "" : "s");
+    
+    return pThis->errorCount;
+}
+
+static void verifyRW18Track(NibbleImageVerifier* pThis, unsigned int track, unsigned int side)
+{
+    if (!readRW18Track(pThis->pImage, side, track, pThis->actualData))
+    {
+        LOG_ERROR(pThis, "Track %u doesn't contain valid RW18 sectors for side 0x%x.", track, side);
+        return;
+    }
+    pThis->rw18TrackCount++;
+    
+    if (pThis->pExpected && 
+        readRW18Track(pThis->pExpected, side, track, pThis->expectedData) &&
+        0 != memcmp(pThis->actualData, pThis->expectedData, DISK_IMAGE_RW18_BYTES_PER_TRACK))
+    {
+        LOG_ERROR(pThis, "Track %u RW18 data doesn't match the script.", track);
+    }
+}
+
+static int readRW18Track(NibbleDiskImage* pImage, unsigned int side, unsigned int track, unsigned char* pTrackData)
+{
+    __try
+    {
+        NibbleDiskImage_ReadRW18Track(pImage, side, track, pTrackData, DISK_IMAGE_RW18_BYTES_PER_TRACK);
+    }
+    __catch
+    {
+        __nothrow_and_return(0);
+    }
+    
+    return 1;
+}
+
+static void verifyRWTS16Sector(NibbleImageVerifier* pThis, unsigned int track, unsigned int sector)
+{
+    SectorStatus actual = readRWTS16Sector(pThis->pImage, track, sector, pThis->actualData);
+    SectorStatus expected = SECTOR_MISSING;
+    
+    if (pThis->pExpected)
+        expected = readRWTS16Sector(pThis->pExpected, track, sector, pThis->expectedData);
+    
+    if (actual == SECTOR_CORRUPT)
+    {
+        LOG_ERROR(pThis, "Track %u sector %u has a corrupt address or data field.", track, sector);
+        return;
+    }
+    if (actual == SECTOR_MISSING)
+    {
+        if (expected != SECTOR_MISSING)
+            LOG_ERROR(pThis, "Track %u sector %u is missing.", track, sector);
+        return;
+    }
+    pThis->rwts16SectorCount++;
+    
+    if (hasSectorContents(expected) && 
+        (actual != expected || 0 != memcmp(pThis->actualData, pThis->expectedData, DISK_IMAGE_BYTES_PER_SECTOR)))
+    {
+        LOG_ERROR(pThis, "Track %u sector %u doesn't match the script.", track, sector);
+    }
+}
+
+static SectorStatus readRWTS16Sector(NibbleDiskImage* pImage, 
+                                     unsigned int     track, 
+                                     unsigned int     sector, 
+                                     unsigned char*   pSectorData)
+{
+    int isCopyProtectionSector = 0;
+    
+    __try
+    {
+        isCopyProtectionSector = NibbleDiskImage_ReadRWTS16Sector(pImage, track, sector, 
+                                                                  pSectorData, DISK_IMAGE_BYTES_PER_SECTOR);
+    }
+    __catch
+    {
+        SectorStatus status = getExceptionCode() == sectorNotFoundException ? SECTOR_MISSING : SECTOR_CORRUPT;
+        __nothrow_and_return(status);
+    }
+    
+    return isCopyProtectionSector ? SECTOR_COPY_PROTECTION : SECTOR_DATA;
+}
+
+static int hasSectorContents(SectorStatus status)
+{
+    return status == SECTOR_DATA || status == SECTOR_COPY_PROTECTION;
+}
+
+
+unsigned int NibbleImageVerifier_GetRWTS16SectorCount(NibbleImageVerifier* pThis)
+{
+    return pThis->rwts16SectorCount;
+}
+
+
+unsigned int NibbleImageVerifier_GetRW18TrackCount(NibbleImageVerifier* pThis)
+{
+    return pThis->rw18TrackCount;
+}
@@ -0,0 +1,543 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "NibbleLoadSimulator.h"
+#include "NibbleDiskImage.h"
+#include "DiskImageTest.h"
+#include "TextFile.h"
+#include "ParseCSV.h"
+#include "util.h"
+
+
+#define TRACK_LENGTH                    NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK
+#define RWTS16_ADDRESS_FIELD_LENGTH     14
+#define RWTS16_DATA_FIELD_LENGTH        (3 + 343 + 3)
+#define RWTS16_DATA_FIELD_SEARCH_LIMIT  64
+#define RW18_SECTORS_PER_TRACK          6
+#define RW18_BUNDLE_ID_OFFSET           8
+#define RW18_SECTOR_LENGTH              (RW18_BUNDLE_ID_OFFSET + 1 + 1024 + 1 + 1)
+
+
+struct NibbleLoadSimulator
+{
+    const unsigned char* pImage;
+    TextFile*            pTextFile;
+    ParseCSV*            pParser;
+    const char*          pSequenceFilename;
+    NibbleLoadTiming     timing;
+    NibbleLoadTrackTime  trackTimes[DISK_IMAGE_TRACKS_PER_SIDE];
+    unsigned int         currentTrack;
+    unsigned int         elapsed;
+    unsigned int         lineNumber;
+    unsigned int         errorCount;
+    unsigned int         side;
+    unsigned int         track;
+    unsigned int         sector;
+};
+
+
+__throws NibbleLoadSimulator* NibbleLoadSimulator_Create(const unsigned char* pImage, const NibbleLoadTiming* pTiming)
+{
+    static const NibbleLoadTiming defaultTiming = { NIBBLE_LOAD_SIMULATOR_DEFAULT_STEP_MICROSECONDS,
+                                                    NIBBLE_LOAD_SIMULATOR_DEFAULT_SETTLE_MICROSECONDS,
+                                                    NIBBLE_LOAD_SIMULATOR_DEFAULT_SECTOR_MICROSECONDS };
+    NibbleLoadSimulator*          pThis = NULL;
+
+    __try
+    {
+        pThis = allocateAndZero(sizeof(*pThis));
+        pThis->pParser = ParseCSV_Create();
+    }
+    __catch
+    {
+        NibbleLoadSimulator_Free(pThis);
+        __rethrow;
+    }
+    pThis->pImage = pImage;
+    pThis->timing = pTiming ? *pTiming : defaultTiming;
+
+    return pThis;
+}
+
+
+void NibbleLoadSimulator_Free(NibbleLoadSimulator* pThis)
+{
+    if (!pThis)
+        return;
+
+    ParseCSV_Free(pThis->pParser);
+    TextFile_Free(pThis->pTextFile);
+    free(pThis);
+}
+
+
+static void validateTrack(unsigned int track);
+static void seekToTrack(NibbleLoadSimulator* pThis, unsigned int track);
+static int findRWTS16Sector(NibbleLoadSimulator* pThis,
+                            unsigned int         track,
+                            unsigned int         sector,
+                            unsigned int*        pAddressOffset,
+                            unsigned int*        pReadNibbles);
+static int isRWTS16AddressField(const unsigned char* pTrack, unsigned int offset, unsigned int track, unsigned int sector);
+static unsigned char trackByte(const unsigned char* pTrack, unsigned int offset);
+static unsigned char decode4and4(const unsigned char* pTrack, unsigned int offset);
+static unsigned int findRWTS16DataFieldEnd(const unsigned char* pTrack, unsigned int addressOffset);
+static unsigned int rotationalDelay(unsigned int time, unsigned int offset);
+static unsigned int nibblesToMicroseconds(unsigned int nibbles);
+static void advanceTime(NibbleLoadSimulator* pThis, unsigned int* pTrackTime, unsigned int microseconds);
+__throws unsigned int NibbleLoadSimulator_ReadRWTS16Sector(NibbleLoadSimulator* pThis,
+                                                           unsigned int         track,
+                                                           unsigned int         sector)
+{
+    NibbleLoadTrackTime* pTrackTime;
+    unsigned int         startTime = pThis->elapsed;
+    unsigned int         addressOffset;
+    unsigned int         readNibbles;
+
+    validateTrack(track);
+    if (sector >= NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK)
+        __throw(invalidSectorException);
+    if (!findRWTS16Sector(pThis, track, sector, &addressOffset, &readNibbles))
+        __throw(invalidSectorException);
+
+    pTrackTime = &pThis->trackTimes[track];
+    seekToTrack(pThis, track);
+    advanceTime(pThis, &pTrackTime->latency, rotationalDelay(pThis->elapsed, addressOffset));
+    advanceTime(pThis, &pTrackTime->reading, nibblesToMicroseconds(readNibbles));
+    advanceTime(pThis, &pTrackTime->processing, pThis->timing.sectorProcessingMicroseconds);
+
+    return pThis->elapsed - startTime;
+}
+
+static void validateTrack(unsigned int track)
+{
+    if (track >= DISK_IMAGE_TRACKS_PER_SIDE)
+        __throw(invalidTrackException);
+}
+
+static void seekToTrack(NibbleLoadSimulator* pThis, unsigned int track)
+{
+    unsigned int trackCount;
+
+    if (track == pThis->currentTrack)
+        return;
+
+    trackCount = track > pThis->currentTrack ? track - pThis->currentTrack : pThis->currentTrack - track;
+    advanceTime(pThis,
+                &pThis->trackTimes[track].stepping,
+                trackCount * pThis->timing.stepMicroseconds + pThis->timing.settleMicroseconds);
+    pThis->currentTrack = track;
+}
+
+static int findRWTS16Sector(NibbleLoadSimulator* pThis,
+                            unsigned int         track,
+                            unsigned int         sector,
+                            unsigned int*        pAddressOffset,
+                            unsigned int*        pReadNibbles)
+{
+    const unsigned char* pTrack = pThis->pImage + track * TRACK_LENGTH;
+    unsigned int         offset;
+
+    for (offset = 0 ; offset < TRACK_LENGTH ; offset++)
+    {
+        unsigned int dataFieldEnd;
+
+        if (!isRWTS16AddressField(pTrack, offset, track, sector))
+            continue;
+        dataFieldEnd = findRWTS16DataFieldEnd(pTrack, offset);
+        if (dataFieldEnd == 0)
+            return 0;
+        *pAddressOffset = offset;
+        *pReadNibbles = dataFieldEnd - offset;
+        return 1;
+    }
+    return 0;
+}
+
+static int isRWTS16AddressField(const unsigned char* pTrack, unsigned int offset, unsigned int track, unsigned int sector)
+{
+    return trackByte(pTrack, offset) == 0xD5 &&
+           trackByte(pTrack, offset + 1) == 0xAA &&
+           trackByte(pTrack, offset + 2) == 0x96 &&
+           decode4and4(pTrack, offset + 5) == track &&
+           decode4and4(pTrack, offset + 7) == sector;
+}
+
+static unsigned char trackByte(const unsigned char* pTrack, unsigned int offset)
+{
+    /* The track is a loop so reads past its end wrap back around to the index. */
+    return pTrack[offset % TRACK_LENGTH];
+}
+
+static unsigned char decode4and4(const unsigned char* pTrack, unsigned int offset)
+{
+    return ((trackByte(pTrack, offset) << 1) | 1) & trackByte(pTrack, offset + 1);
+}
+
+static unsigned int findRWTS16DataFieldEnd(const unsigned char* pTrack, unsigned int addressOffset)
+{
+    unsigned int offset = addressOffset + RWTS16_ADDRESS_FIELD_LENGTH;
+    unsigned int searchEnd = offset + RWTS16_DATA_FIELD_SEARCH_LIMIT;
+
+    for ( ; offset < searchEnd ; offset++)
+    {
+        if (trackByte(pTrack, offset) == 0xD5 &&
+            trackByte(pTrack, offset + 1) == 0xAA &&
+            trackByte(pTrack, offset + 2) == 0xAD)
+        {
+            return offset + RWTS16_DATA_FIELD_LENGTH;
+        }
+    }
+    return 0;
+}
+
+static unsigned int rotationalDelay(unsigned int time, unsigned int offset)
+{
+    unsigned int headOffset = (time / NIBBLE_LOAD_SIMULATOR_MICROSECONDS_PER_NIBBLE) % TRACK_LENGTH;
+
+    return nibblesToMicroseconds((offset + TRACK_LENGTH - headOffset) % TRACK_LENGTH);
+}
+
+static unsigned int nibblesToMicroseconds(unsigned int nibbles)
+{
+    return nibbles * NIBBLE_LOAD_SIMULATOR_MICROSECONDS_PER_NIBBLE;
+}
+
+static void advanceTime(NibbleLoadSimulator* pThis, unsigned int* pTrackTime, unsigned int microseconds)
+{
+    *pTrackTime += microseconds;
+    pThis->elapsed += microseconds;
+}
+
+
+static void findRW18Sectors(NibbleLoadSimulator* pThis,
+                            unsigned int         side,
+                            unsigned int         track,
+                            unsigned int*        pSectorOffsets);
+__throws unsigned int NibbleLoadSimulator_ReadRW18Track(NibbleLoadSimulator* pThis,
+                                                        unsigned int         side,
+                                                        unsigned int         track)
+{
+    NibbleLoadTrackTime* pTrackTime;
+    unsigned int         sectorOffsets[RW18_SECTORS_PER_TRACK];
+    unsigned int         startTime = pThis->elapsed;
+    unsigned int         latency = ~0U;
+    unsigned int         finish = 0;
+    unsigned int         i;
+
+    validateTrack(track);
+    findRW18Sectors(pThis, side, track, sectorOffsets);
+
+    pTrackTime = &pThis->trackTimes[track];
+    seekToTrack(pThis, track);
+
+    /* RW18 reads sectors in whatever order they arrive under the head so the read completes once the last data field
+       to pass the head has been read. */
+    for (i = 0 ; i < RW18_SECTORS_PER_TRACK ; i++)
+    {
+        unsigned int delay = rotationalDelay(pThis->elapsed, sectorOffsets[i]);
+        unsigned int sectorFinish = delay + nibblesToMicroseconds(RW18_SECTOR_LENGTH);
+
+        if (delay < latency)
+            latency = delay;
+        if (sectorFinish > finish)
+            finish = sectorFinish;
+    }
+    advanceTime(pThis, &pTrackTime->latency, latency);
+    advanceTime(pThis, &pTrackTime->reading, finish - latency);
+
+    return pThis->elapsed - startTime;
+}
+
+static void findRW18Sectors(NibbleLoadSimulator* pThis,
+                            unsigned int         side,
+                            unsigned int         track,
+                            unsigned int*        pSectorOffsets)
+{
+    const unsigned char* pTrack = pThis->pImage + track * TRACK_LENGTH;
+    unsigned int         sectorCount = 0;
+    unsigned int         offset;
+
+    /* 0xD5 is a reserved nibble so it only appears in field prologs. */
+    for (offset = 0 ; offset < TRACK_LENGTH && sectorCount < RW18_SECTORS_PER_TRACK ; offset++)
+    {
+        if (pTrack[offset] != 0xD5 || trackByte(pTrack, offset + 1) != 0x9D)
+            continue;
+        if (trackByte(pTrack, offset + RW18_BUNDLE_ID_OFFSET) != side)
+            __throw(invalidSideException);
+        pSectorOffsets[sectorCount++] = offset;
+    }
+    if (sectorCount != RW18_SECTORS_PER_TRACK)
+        __throw(invalidTrackException);
+}
+
+
+#define LOG_ERROR(pTHIS, FORMAT, ...) (pTHIS->errorCount++, \
+                                       fprintf(stderr, \
+                                       "%s:%d: error: " FORMAT LINE_ENDING, \
+                                       pTHIS->pSequenceFilename, \
+                                       pTHIS->lineNumber, \
+                                       __VA_ARGS__))
+
+static void openSequenceFile(NibbleLoadSimulator* pThis, const char* pSequenceFilename);
+static void closeSequenceFile(NibbleLoadSimulator* pThis);
+static void processSequenceLine(NibbleLoadSimulator* pThis, const SizedString* pLine);
+static unsigned int readRWTS16Sectors(NibbleLoadSimulator* pThis, size_t fieldCount, const SizedString* pFields);
+static unsigned int readRW18Tracks(NibbleLoadSimulator* pThis, size_t fieldCount, const SizedString* pFields);
+static void reportSequenceLineException(NibbleLoadSimulator* pThis);
+static void printTime(const char* pPrefix, int nameLength, const char* pName, unsigned int microseconds);
+__throws void NibbleLoadSimulator_ProcessSequenceFile(NibbleLoadSimulator* pThis, const char* pSequenceFilename)
+{
+    openSequenceFile(pThis, pSequenceFilename);
+
+    printf("Simulated load times:\n");
+    pThis->errorCount = 0;
+    pThis->lineNumber = 1;
+    while (!TextFile_IsEndOfFile(pThis->pTextFile))
+    {
+        SizedString nextLine = TextFile_GetNextLine(pThis->pTextFile);
+        if (nextLine.pString[0] != '#')
+            processSequenceLine(pThis, &nextLine);
+        pThis->lineNumber++;
+    }
+    printTime("  ", 5, "Total", pThis->elapsed);
+    NibbleLoadSimulator_PrintTrackBreakdown(pThis);
+
+    closeSequenceFile(pThis);
+}
+
+static void openSequenceFile(NibbleLoadSimulator* pThis, const char* pSequenceFilename)
+{
+    __try
+    {
+        SizedString sequenceFilename = SizedString_InitFromString(pSequenceFilename);
+        pThis->pSequenceFilename = pSequenceFilename;
+        pThis->lineNumber = 0;
+        pThis->pTextFile = TextFile_CreateFromFile(NULL, &sequenceFilename, NULL);
+    }
+    __catch
+    {
+        LOG_ERROR(pThis, "Failed to open %s for parsing.", pSequenceFilename);
+        __rethrow;
+    }
+}
+
+static void closeSequenceFile(NibbleLoadSimulator* pThis)
+{
+    TextFile_Free(pThis->pTextFile);
+    pThis->pTextFile = NULL;
+}
+
+static void processSequenceLine(NibbleLoadSimulator* pThis, const SizedString* pLine)
+{
+    size_t             fieldCount;
+    const SizedString* pFields;
+    unsigned int       loadTime = 0;
+
+    ParseCSV_Parse(pThis->pParser, pLine);
+    fieldCount = ParseCSV_FieldCount(pThis->pParser);
+    pFields = ParseCSV_FieldPointers(pThis->pParser);
+    if (fieldCount < 1 || SizedString_strlen(&pFields[0]) == 0)
+    {
+        LOG_ERROR(pThis, "%s cannot be blank.", "Load sequence line");
+        return;
+    }
+
+    __try
+    {
+        if (0 == SizedString_strcasecmp(&pFields[0], "rwts16"))
+            loadTime = readRWTS16Sectors(pThis, fieldCount, pFields);
+        else if (0 == SizedString_strcasecmp(&pFields[0], "rw18"))
+            loadTime = readRW18Tracks(pThis, fieldCount, pFields);
+        else
+        {
+            LOG_ERROR(pThis, "%.*s isn't a recognized read type of RWTS16 or RW18.",
+                      pFields[0].stringLength, pFields[0].pString);
+            __throw(invalidArgumentException);
+        }
+        printTime("  ", pFields[1].stringLength, pFields[1].pString, loadTime);
+    }
+    __catch
+    {
+        reportSequenceLineException(pThis);
+        __nothrow;
+    }
+}
+
+static unsigned int readRWTS16Sectors(NibbleLoadSimulator* pThis, size_t fieldCount, const SizedString* pFields)
+{
+    unsigned int loadTime = 0;
+    unsigned int sectorCount = 1;
+
+    if (fieldCount < 4 || fieldCount > 5)
+    {
+        LOG_ERROR(pThis,
+                  "%u is incorrect field count for RWTS16 read.  Expected 4 or 5.",
+                  (unsigned int)fieldCount);
+        __throw(invalidArgumentException);
+    }
+    pThis->track = SizedString_strtoul(&pFields[2], NULL, 0);
+    pThis->sector = SizedString_strtoul(&pFields[3], NULL, 0);
+    if (fieldCount > 4)
+        sectorCount = SizedString_strtoul(&pFields[4], NULL, 0);
+
+    while (sectorCount--)
+    {
+        loadTime += NibbleLoadSimulator_ReadRWTS16Sector(pThis, pThis->track, pThis->sector);
+        if (++pThis->sector >= NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK)
+        {
+            pThis->sector = 0;
+            pThis->track++;
+        }
+    }
+
+    return loadTime;
+}
+
+static unsigned int readRW18Tracks(NibbleLoadSimulator* pThis, size_t fieldCount, const SizedString* pFields)
+{
+    unsigned int loadTime = 0;
+    unsigned int trackCount = 1;
+
+    if (fieldCount < 4 || fieldCount > 5)
+    {
+        LOG_ERROR(pThis,
+                  "%u is incorrect field count for RW18 read.  Expected 4 or 5.",
+                  (unsigned int)fieldCount);
+        __throw(invalidArgumentException);
+    }
+    pThis->side = SizedString_strtoul(&pFields[2], NULL, 0);
+    pThis->track = SizedString_strtoul(&pFields[3], NULL, 0);
+    if (fieldCount > 4)
+        trackCount = SizedString_strtoul(&pFields[4], NULL, 0);
+
+    while (trackCount--)
+    {
+        loadTime += NibbleLoadSimulator_ReadRW18Track(pThis, pThis->side, pThis->track);
+        pThis->track++;
+    }
+
+    return loadTime;
+}
+
+static void reportSequenceLineException(NibbleLoadSimulator* pThis)
+{
+    int exceptionCode = getExceptionCode();
+
+    /* Note: invalidArgumentException prints error text before throwing. */
+    if (exceptionCode == invalidTrackException && pThis->track >= DISK_IMAGE_TRACKS_PER_SIDE)
+        LOG_ERROR(pThis, "%u specifies an invalid track.  Must be 0 - 34.", pThis->track);
+    else if (exceptionCode == invalidTrackException)
+        LOG_ERROR(pThis, "Track %u doesn't contain RW18 sectors.", pThis->track);
+    else if (exceptionCode == invalidSideException)
+        LOG_ERROR(pThis, "Track %u doesn't contain RW18 data for side 0x%x.", pThis->track, pThis->side);
+    else if (exceptionCode == invalidSectorException)
+        LOG_ERROR(pThis, "Track %u sector %u wasn't found in the image.", pThis->track, pThis->sector);
+}
+
+static void printTime(const char* pPrefix, int nameLength, const char* pName, unsigned int microseconds)
+{
+    printf("%s%.*s: %u.%03u seconds\n",
+           pPrefix, nameLength, pName, microseconds / 1000000, (microseconds / 1000) % 1000);
+}
+
+
+void NibbleLoadSimulator_PrintTrackBreakdown(NibbleLoadSimulator* pThis)
+{
+    unsigned int track;
+
+    printf("Per track breakdown:\n");
+    for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+    {
+        const NibbleLoadTrackTime* pTrackTime = &pThis->trackTimes[track];
+
+        if (pTrackTime->stepping + pTrackTime->latency + pTrackTime->reading + pTrackTime->processing == 0)
+            continue;
+        printf("  track %2u: stepping %u.%03u ms, rotation %u.%03u ms, reading %u.%03u ms, processing %u.%03u ms\n",
+               track,
+               pTrackTime->stepping / 1000, pTrackTime->stepping % 1000,
+               pTrackTime->latency / 1000, pTrackTime->latency % 1000,
+               pTrackTime->reading / 1000, pTrackTime->reading % 1000,
+               pTrackTime->processing / 1000, pTrackTime->processing % 1000);
+    }
+}
+
+
+unsigned int NibbleLoadSimulator_CalculateRWTS16TrackTime(NibbleLoadSimulator* pThis,
+                                                         unsigned int         track,
+                                                         unsigned int*        pSectorCount)
+{
+    unsigned int sectorCount = 0;
+    unsigned int startTime = 0;
+    unsigned int time = 0;
+    unsigned int sector;
+
+    /* Time from the first sector's address field passing under the head until the last sector has been read when
+       every RWTS16 sector on the track is read in ascending sector order. */
+    for (sector = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE && sector < NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK ; sector++)
+    {
+        unsigned int addressOffset;
+        unsigned int readNibbles;
+
+        if (!findRWTS16Sector(pThis, track, sector, &addressOffset, &readNibbles))
+            continue;
+        if (sectorCount++ == 0)
+            time = startTime = nibblesToMicroseconds(addressOffset);
+        else
+            time += pThis->timing.sectorProcessingMicroseconds;
+        time += rotationalDelay(time, addressOffset) + nibblesToMicroseconds(readNibbles);
+    }
+    *pSectorCount = sectorCount;
+
+    return time - startTime;
+}
+
+
+void NibbleLoadSimulator_PrintRWTS16Revolutions(NibbleLoadSimulator* pThis)
+{
+    unsigned int revolutionTime = nibblesToMicroseconds(TRACK_LENGTH);
+    unsigned int track;
+
+    printf("RWTS16 revolutions per track:\n");
+    for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+    {
+        unsigned int sectorCount;
+        unsigned int time = NibbleLoadSimulator_CalculateRWTS16TrackTime(pThis, track, &sectorCount);
+        unsigned int hundredths = (unsigned int)(((unsigned long long)time * 100 + revolutionTime / 2) / revolutionTime);
+
+        if (sectorCount == 0)
+            continue;
+        printf("  track %2u: %u sectors read in %u.%02u revolutions\n", 
+               track, sectorCount, hundredths / 100, hundredths % 100);
+    }
+}
+
+
+unsigned int NibbleLoadSimulator_GetElapsedTime(NibbleLoadSimulator* pThis)
+{
+    return pThis->elapsed;
+}
+
+unsigned int NibbleLoadSimulator_GetErrorCount(NibbleLoadSimulator* pThis)
+{
+    return pThis->errorCount;
+}
+
+
+const NibbleLoadTrackTime* NibbleLoadSimulator_GetTrackTime(NibbleLoadSimulator* pThis, unsigned int track)
+{
+    if (track >= DISK_IMAGE_TRACKS_PER_SIDE)
+        return NULL;
+    return &pThis->trackTimes[track];
+}
@@ -0,0 +1,345 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+#include "SectorDiskImage.h"
+#include "DiskImagePriv.h"
+#include "DiskImageTest.h"
+#include "util.h"
+
+
+#define BLOCK_DOMAIN 1
+
+
+struct SectorDiskImage
+{
+    DiskImage       super;
+    unsigned char   physicalToFileSector[SECTOR_DISK_IMAGE_SECTORS_PER_TRACK];
+    unsigned char   blockPageToFileSector[SECTOR_DISK_IMAGE_SECTORS_PER_TRACK];
+};
+
+
+/* Sector numbers in RWTS16 script lines are the physical sector numbers found in the address fields on the disk.
+   These tables map them to the sector slot used for them within each track of the image file. */
+static const unsigned char g_dosPhysicalToFileSector[SECTOR_DISK_IMAGE_SECTORS_PER_TRACK] =
+{
+    0x0, 0x7, 0xE, 0x6, 0xD, 0x5, 0xC, 0x4, 0xB, 0x3, 0xA, 0x2, 0x9, 0x1, 0x8, 0xF
+};
+static const unsigned char g_prodosPhysicalToFileSector[SECTOR_DISK_IMAGE_SECTORS_PER_TRACK] =
+{
+    0x0, 0x8, 0x1, 0x9, 0x2, 0xA, 0x3, 0xB, 0x4, 0xC, 0x5, 0xD, 0x6, 0xE, 0x7, 0xF
+};
+/* ProDOS places the two pages of each block in these physical sectors. */
+static const unsigned char g_prodosLogicalToPhysicalSector[SECTOR_DISK_IMAGE_SECTORS_PER_TRACK] =
+{
+    0x0, 0x2, 0x4, 0x6, 0x8, 0xA, 0xC, 0xE, 0x1, 0x3, 0x5, 0x7, 0x9, 0xB, 0xD, 0xF
+};
+
+
+static void freeObject(void* pThis);
+static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+static void validateInsert(void* pThis, DiskImageInsert* pInsert);
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents);
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize);
+struct DiskImageVTable SectorDiskImageVTable = 
+{ 
+    freeObject,
+    insertData,
+    validateInsert,
+    calculateExtents,
+    describeDomain,
+    NULL
+};
+
+
+static void initSectorTables(SectorDiskImage* pThis, SectorDiskImageOrder order);
+__throws SectorDiskImage* SectorDiskImage_Create(SectorDiskImageOrder order)
+{
+    SectorDiskImage* pThis = NULL;
+    
+    __try
+    {
+        pThis = allocateAndZero(sizeof(*pThis));
+        DiskImage_Init(&pThis->super, &SectorDiskImageVTable, SECTOR_DISK_IMAGE_SIZE);
+        pThis->super.hashRegionSize = SECTOR_DISK_IMAGE_SECTORS_PER_TRACK * DISK_IMAGE_BYTES_PER_SECTOR;
+        initSectorTables(pThis, order);
+    }
+    __catch
+    {
+        DiskImage_Free(&pThis->super);
+        __rethrow;
+    }
+        
+    return pThis;
+}
+
+static void initSectorTables(SectorDiskImage* pThis, SectorDiskImageOrder order)
+{
+    size_t i;
+    
+    if (order == SECTOR_DISK_IMAGE_PRODOS_ORDER)
+        memcpy(pThis->physicalToFileSector, g_prodosPhysicalToFileSector, sizeof(pThis->physicalToFileSector));
+    else
+        memcpy(pThis->physicalToFileSector, g_dosPhysicalToFileSector, sizeof(pThis->physicalToFileSector));
+    
+    for (i = 0 ; i < SECTOR_DISK_IMAGE_SECTORS_PER_TRACK ; i++)
+        pThis->blockPageToFileSector[i] = pThis->physicalToFileSector[g_prodosLogicalToPhysicalSector[i]];
+}
+
+
+static void freeObject(void* pThis)
+{
+}
+
+
+__throws void SectorDiskImage_ProcessScriptFile(SectorDiskImage* pThis, const char* pScriptFilename)
+{
+    DiskImage_ProcessScriptFile(&pThis->super, pScriptFilename);
+}
+
+
+__throws void SectorDiskImage_ProcessScript(SectorDiskImage* pThis, char* pScriptText)
+{
+    DiskImage_ProcessScript(&pThis->super, pScriptText);
+}
+
+
+__throws void SectorDiskImage_ReadObjectFile(SectorDiskImage* pThis, const char* pFilename)
+{
+    DiskImage_ReadObjectFile(&pThis->super, pFilename);
+}
+
+
+__throws void SectorDiskImage_InsertObjectFile(SectorDiskImage* pThis, DiskImageInsert* pInsert)
+{
+    DiskImage_InsertObjectFile(&pThis->super, pInsert);
+}
+
+
+static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
+{
+    SectorDiskImage_InsertData((SectorDiskImage*)pThis, pData, pInsert);
+}
+
+
+static void validateRWTS16Insert(DiskImageInsert* pInsert);
+static void validateTrackAndSector(unsigned int track, unsigned int sector, unsigned int bytesLeft);
+static void validateBlockInsert(DiskImageInsert* pInsert);
+static void validateInsert(void* pThis, DiskImageInsert* pInsert)
+{
+    switch (pInsert->type)
+    {
+    case DISK_IMAGE_INSERTION_RWTS16:
+        validateRWTS16Insert(pInsert);
+        break;
+    case DISK_IMAGE_INSERTION_BLOCK:
+        validateBlockInsert(pInsert);
+        break;
+    case DISK_IMAGE_INSERTION_RW18:
+    case DISK_IMAGE_INSERTION_RWTS16CP:
+    default:
+        __throw(invalidInsertionTypeException);
+    }
+}
+
+static void validateRWTS16Insert(DiskImageInsert* pInsert)
+{
+    /* Checking the first and last sectors is enough since every sector in between is written sequentially.
+       A length of 0 means that it won't be known until the object file is read. */
+    unsigned int lastSectorIndex;
+    
+    validateTrackAndSector(pInsert->track, pInsert->sector, DISK_IMAGE_BYTES_PER_SECTOR);
+    if (pInsert->length == 0)
+        return;
+    
+    lastSectorIndex = pInsert->track * SECTOR_DISK_IMAGE_SECTORS_PER_TRACK + 
+                      pInsert->sector + 
+                      (pInsert->length - 1) / DISK_IMAGE_BYTES_PER_SECTOR;
+    validateTrackAndSector(lastSectorIndex / SECTOR_DISK_IMAGE_SECTORS_PER_TRACK,
+                           lastSectorIndex % SECTOR_DISK_IMAGE_SECTORS_PER_TRACK,
+                           pInsert->length - (pInsert->length - 1) / DISK_IMAGE_BYTES_PER_SECTOR * DISK_IMAGE_BYTES_PER_SECTOR);
+}
+
+static void validateTrackAndSector(unsigned int track, unsigned int sector, unsigned int bytesLeft)
+{
+    if (sector >= SECTOR_DISK_IMAGE_SECTORS_PER_TRACK)
+        __throw(invalidSectorException);
+    if (track >= DISK_IMAGE_TRACKS_PER_SIDE)
+        __throw(invalidTrackException);
+    if (bytesLeft < DISK_IMAGE_BYTES_PER_SECTOR)
+        __throw(invalidLengthException);
+}
+
+static unsigned int calculateBlockOffset(const DiskImageInsert* pInsert);
+static void validateBlockInsert(DiskImageInsert* pInsert)
+{
+    unsigned int startOffset = calculateBlockOffset(pInsert);
+    unsigned int endOffset = startOffset + pInsert->length;
+    
+    if (pInsert->intraBlockOffset >= DISK_IMAGE_BLOCK_SIZE)
+        __throw(invalidIntraBlockOffsetException);
+    if (startOffset >= SECTOR_DISK_IMAGE_SIZE || endOffset > SECTOR_DISK_IMAGE_SIZE)
+        __throw(blockExceedsImageBoundsException);
+}
+
+static unsigned int calculateBlockOffset(const DiskImageInsert* pInsert)
+{
+    return pInsert->block * DISK_IMAGE_BLOCK_SIZE + pInsert->intraBlockOffset;
+}
+
+
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents)
+{
+    DiskImageExtent* pExtent = &pExtents[0];
+    
+    /* RWTS16 and BLOCK insertions are tracked in separate domains since neither maps to a contiguous range of the
+       other's address space once sector interleaving has been applied. */
+    switch (pInsert->type)
+    {
+    case DISK_IMAGE_INSERTION_RWTS16:
+        pExtent->domain = 0;
+        pExtent->start = (pInsert->track * SECTOR_DISK_IMAGE_SECTORS_PER_TRACK + pInsert->sector) * 
+                         DISK_IMAGE_BYTES_PER_SECTOR;
+        pExtent->end = pExtent->start + pInsert->length;
+        break;
+    case DISK_IMAGE_INSERTION_BLOCK:
+        pExtent->domain = BLOCK_DOMAIN;
+        pExtent->start = calculateBlockOffset(pInsert);
+        pExtent->end = pExtent->start + pInsert->length;
+        break;
+    case DISK_IMAGE_INSERTION_RW18:
+    case DISK_IMAGE_INSERTION_RWTS16CP:
+    default:
+        pExtent->domain = 0;
+        pExtent->start = 0;
+        pExtent->end = 0;
+        break;
+    }
+    return 1;
+}
+
+
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize)
+{
+    *pDomainSize = SECTOR_DISK_IMAGE_SIZE;
+    if (domain == BLOCK_DOMAIN)
+        return "ProDOS block bytes";
+    return "RWTS16 track/sector bytes";
+}
+
+
+static void insertRWTS16Data(SectorDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+static void insertBlockData(SectorDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+__throws void SectorDiskImage_InsertData(SectorDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
+{
+    switch (pInsert->type)
+    {
+    case DISK_IMAGE_INSERTION_RWTS16:
+        insertRWTS16Data(pThis, pData, pInsert);
+        break;
+    case DISK_IMAGE_INSERTION_BLOCK:
+        insertBlockData(pThis, pData, pInsert);
+        break;
+    case DISK_IMAGE_INSERTION_RW18:
+    case DISK_IMAGE_INSERTION_RWTS16CP:
+    default:
+        __throw(invalidInsertionTypeException);
+    }
+}
+
+static void insertRWTS16Data(SectorDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
+{
+    unsigned char*       pImage = DiskImage_GetImagePointer(&pThis->super);
+    const unsigned char* pSource = pData + pInsert->sourceOffset;
+    unsigned int         track = pInsert->track;
+    unsigned int         sector = pInsert->sector;
+    unsigned int         bytesLeft = pInsert->length;
+    
+    validateRWTS16Insert(pInsert);
+    while (bytesLeft > 0)
+    {
+        memcpy(pImage + SectorDiskImage_GetImageOffset(pThis, track, sector), pSource, DISK_IMAGE_BYTES_PER_SECTOR);
+        pSource += DISK_IMAGE_BYTES_PER_SECTOR;
+        bytesLeft -= DISK_IMAGE_BYTES_PER_SECTOR;
+        if (++sector >= SECTOR_DISK_IMAGE_SECTORS_PER_TRACK)
+        {
+            sector = 0;
+            track++;
+        }
+    }
+}
+
+static void insertBlockData(SectorDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
+{
+    /* Blocks are copied a page at a time since consecutive ProDOS pages aren't adjacent in DOS ordered images. */
+    unsigned char*       pImage = DiskImage_GetImagePointer(&pThis->super);
+    const unsigned char* pSource = pData + pInsert->sourceOffset;
+    unsigned int         offset = calculateBlockOffset(pInsert);
+    unsigned int         bytesLeft = pInsert->length;
+    
+    validateBlockInsert(pInsert);
+    while (bytesLeft > 0)
+    {
+        unsigned int page = offset / DISK_IMAGE_PAGE_SIZE;
+        unsigned int intraPageOffset = offset % DISK_IMAGE_PAGE_SIZE;
+        unsigned int bytesToCopy = DISK_IMAGE_PAGE_SIZE - intraPageOffset;
+        unsigned int fileSector = pThis->blockPageToFileSector[page % SECTOR_DISK_IMAGE_SECTORS_PER_TRACK];
+        unsigned int track = page / SECTOR_DISK_IMAGE_SECTORS_PER_TRACK;
+        
+        if (bytesToCopy > bytesLeft)
+            bytesToCopy = bytesLeft;
+        memcpy(pImage + (track * SECTOR_DISK_IMAGE_SECTORS_PER_TRACK + fileSector) * DISK_IMAGE_BYTES_PER_SECTOR + 
+                        intraPageOffset, 
+               pSource, 
+               bytesToCopy);
+        pSource += bytesToCopy;
+        offset += bytesToCopy;
+        bytesLeft -= bytesToCopy;
+    }
+}
+
+
+__throws void SectorDiskImage_WriteImage(SectorDiskImage* pThis, const char* pImageFilename)
+{
+    DiskImage_WriteImage(&pThis->super, pImageFilename);
+}
+
+
+__throws void SectorDiskImage_UpdateImage(SectorDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename)
+{
+    DiskImage_UpdateImage(&pThis->super, pScriptFilename, pImageFilename);
+}
+
+
+void SectorDiskImage_PrintLayoutMap(SectorDiskImage* pThis)
+{
+    DiskImage_PrintLayoutMap(&pThis->super);
+}
+
+
+const unsigned char* SectorDiskImage_GetImagePointer(SectorDiskImage* pThis)
+{
+    return DiskImage_GetImagePointer(&pThis->super);
+}
+
+
+size_t SectorDiskImage_GetImageSize(SectorDiskImage* pThis)
+{
+    return DiskImage_GetImageSize(&pThis->super);
+}
+
+
+unsigned int SectorDiskImage_GetImageOffset(SectorDiskImage* pThis, unsigned int track, unsigned int physicalSector)
+{
+    return (track * SECTOR_DISK_IMAGE_SECTORS_PER_TRACK + pThis->physicalToFileSector[physicalSector]) * 
+           DISK_IMAGE_BYTES_PER_SECTOR;
+}
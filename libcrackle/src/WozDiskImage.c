@@ -0,0 +1,397 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+#include "WozDiskImage.h"
+#include "NibbleDiskImagePriv.h"
+#include "DiskImageTest.h"
+#include "Crc32.h"
+#include "TraceLog.h"
+#include "PerfCounters.h"
+#include "version.h"
+#include "util.h"
+
+
+#define WOZ_VERSION                 2
+#define WOZ_DISK_TYPE_5_25          1
+#define WOZ_OPTIMAL_BIT_TIMING      32
+#define WOZ_INFO_SIZE               60
+#define WOZ_CREATOR_SIZE            32
+#define WOZ_CREATOR                 "crackle " VERSION_STRING
+#define SYNC_BITS                   10
+#define NIBBLE_BITS                 8
+#define MAX_BITS_PER_TRACK          (NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * SYNC_BITS)
+#define MAX_BLOCKS_PER_TRACK        ((MAX_BITS_PER_TRACK / 8 + WOZ_DISK_IMAGE_BLOCK_SIZE - 1) / WOZ_DISK_IMAGE_BLOCK_SIZE)
+#define MAX_WOZ_SIZE                (WOZ_DISK_IMAGE_BITS_OFFSET + \
+                                     DISK_IMAGE_TRACKS_PER_SIDE * MAX_BLOCKS_PER_TRACK * WOZ_DISK_IMAGE_BLOCK_SIZE)
+
+
+struct WozDiskImage
+{
+    NibbleDiskImage super;
+    ByteBuffer      woz;
+};
+
+
+/* Bits are shifted into a 64-bit accumulator and written out a 32-bit word at a time, most significant bit first. */
+typedef struct BitWriter
+{
+    unsigned char* pWrite;
+    uint64_t       bits;
+    unsigned int   bitCount;
+    unsigned int   totalBitCount;
+} BitWriter;
+
+
+static void freeObject(void* pThis);
+static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert* pInsert);
+static void validateInsert(void* pThis, DiskImageInsert* pInsert);
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents);
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize);
+static void writeImage(void* pThis, FILE* pFile);
+struct DiskImageVTable WozDiskImageVTable = 
+{ 
+    freeObject,
+    insertData,
+    validateInsert,
+    calculateExtents,
+    describeDomain,
+    writeImage
+};
+
+
+__throws WozDiskImage* WozDiskImage_Create(void)
+{
+    WozDiskImage* pThis = NULL;
+    
+    __try
+    {
+        pThis = allocateAndZero(sizeof(*pThis));
+        NibbleDiskImage_Init(&pThis->super, &WozDiskImageVTable);
+        ByteBuffer_Allocate(&pThis->woz, MAX_WOZ_SIZE);
+    }
+    __catch
+    {
+        DiskImage_Free(&pThis->super.super);
+        __rethrow;
+    }
+        
+    return pThis;
+}
+
+
+static void freeObject(void* pThis)
+{
+    WozDiskImage* pWozThis = (WozDiskImage*)pThis;
+    
+    ByteBuffer_Free(&pWozThis->woz);
+}
+
+
+__throws void WozDiskImage_ProcessScriptFile(WozDiskImage* pThis, const char* pScriptFilename)
+{
+    DiskImage_ProcessScriptFile(&pThis->super.super, pScriptFilename);
+}
+
+
+__throws void WozDiskImage_ProcessScript(WozDiskImage* pThis, char* pScriptText)
+{
+    DiskImage_ProcessScript(&pThis->super.super, pScriptText);
+}
+
+
+__throws void WozDiskImage_ReadObjectFile(WozDiskImage* pThis, const char* pFilename)
+{
+    DiskImage_ReadObjectFile(&pThis->super.super, pFilename);
+}
+
+
+__throws void WozDiskImage_InsertObjectFile(WozDiskImage* pThis, DiskImageInsert* pInsert)
+{
+    DiskImage_InsertObjectFile(&pThis->super.super, pInsert);
+}
+
+
+__throws void WozDiskImage_InsertData(WozDiskImage* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
+{
+    NibbleDiskImage_InsertData(&pThis->super, pData, pInsert);
+}
+
+
+/* The nibbles are laid out exactly as they are for a .nib image so everything except the final write is handled by
+   the NibbleDiskImage implementation. */
+static void insertData(void* pThis, const unsigned char* pData, DiskImageInsert* pInsert)
+{
+    NibbleDiskImageVTable.insertData(pThis, pData, pInsert);
+}
+
+
+static void validateInsert(void* pThis, DiskImageInsert* pInsert)
+{
+    NibbleDiskImageVTable.validateInsert(pThis, pInsert);
+}
+
+
+static size_t calculateExtents(void* pThis, const DiskImageInsert* pInsert, DiskImageExtent* pExtents)
+{
+    return NibbleDiskImageVTable.calculateExtents(pThis, pInsert, pExtents);
+}
+
+
+static const char* describeDomain(void* pThis, unsigned int domain, unsigned int* pDomainSize)
+{
+    return NibbleDiskImageVTable.describeDomain(pThis, domain, pDomainSize);
+}
+
+
+static size_t buildWozImage(WozDiskImage* pThis);
+static void writeImage(void* pThis, FILE* pFile)
+{
+    WozDiskImage* pWozThis = (WozDiskImage*)pThis;
+    size_t        wozSize = buildWozImage(pWozThis);
+    
+    if (wozSize != fwrite(pWozThis->woz.pBuffer, 1, wozSize, pFile))
+        __throw(fileException);
+}
+
+static void writeHeader(unsigned char* pWoz);
+static void writeInfoChunk(unsigned char* pWoz, unsigned int largestTrackBlocks);
+static void writeChunkHeader(unsigned char* pChunk, const char* pId, uint32_t size);
+static void writeTrackMapChunk(unsigned char* pWoz, const int* pIsTrackPresent);
+static int isTrackPresent(WozDiskImage* pThis, unsigned int track);
+static unsigned int writeTrackBits(WozDiskImage* pThis, unsigned int track, unsigned char* pBits);
+static void write16(unsigned char* p, uint16_t value);
+static void write32(unsigned char* p, uint32_t value);
+static size_t buildWozImage(WozDiskImage* pThis)
+{
+    unsigned char* pWoz = pThis->woz.pBuffer;
+    unsigned int   nextBlock = WOZ_DISK_IMAGE_BITS_OFFSET / WOZ_DISK_IMAGE_BLOCK_SIZE;
+    unsigned int   largestTrackBlocks = 0;
+    int            isPresent[DISK_IMAGE_TRACKS_PER_SIDE];
+    unsigned int   track;
+    size_t         wozSize;
+    
+    memset(pWoz, 0, pThis->woz.bufferSize);
+    for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+    {
+        unsigned char* pTrackEntry = pWoz + WOZ_DISK_IMAGE_TRKS_OFFSET + WOZ_DISK_IMAGE_CHUNK_HEADER + 
+                                     track * WOZ_DISK_IMAGE_TRK_ENTRY_SIZE;
+        unsigned int   bitCount;
+        unsigned int   blockCount;
+        
+        isPresent[track] = isTrackPresent(pThis, track);
+        if (!isPresent[track])
+            continue;
+        TraceLog_Begin("track", "WOZ track %u", track);
+        PerfCounters_Begin("WOZ track encode");
+        bitCount = writeTrackBits(pThis, track, pWoz + nextBlock * WOZ_DISK_IMAGE_BLOCK_SIZE);
+        PerfCounters_End();
+        TraceLog_End();
+        blockCount = ((bitCount + 7) / 8 + WOZ_DISK_IMAGE_BLOCK_SIZE - 1) / WOZ_DISK_IMAGE_BLOCK_SIZE;
+        write16(pTrackEntry, nextBlock);
+        write16(pTrackEntry + 2, blockCount);
+        write32(pTrackEntry + 4, bitCount);
+        nextBlock += blockCount;
+        if (blockCount > largestTrackBlocks)
+            largestTrackBlocks = blockCount;
+    }
+    wozSize = nextBlock * WOZ_DISK_IMAGE_BLOCK_SIZE;
+    
+    writeInfoChunk(pWoz, largestTrackBlocks);
+    writeTrackMapChunk(pWoz, isPresent);
+    writeChunkHeader(pWoz + WOZ_DISK_IMAGE_TRKS_OFFSET, "TRKS", wozSize - WOZ_DISK_IMAGE_TRKS_OFFSET - WOZ_DISK_IMAGE_CHUNK_HEADER);
+    writeHeader(pWoz);
+    write32(pWoz + 8, Crc32_Buffer(pWoz + WOZ_DISK_IMAGE_HEADER_SIZE, wozSize - WOZ_DISK_IMAGE_HEADER_SIZE, 0));
+    
+    return wozSize;
+}
+
+static void writeHeader(unsigned char* pWoz)
+{
+    memcpy(pWoz, "WOZ2\xFF\n\r\n", 8);
+}
+
+static void writeInfoChunk(unsigned char* pWoz, unsigned int largestTrackBlocks)
+{
+    unsigned char* pInfo = pWoz + WOZ_DISK_IMAGE_INFO_OFFSET + WOZ_DISK_IMAGE_CHUNK_HEADER;
+    
+    writeChunkHeader(pWoz + WOZ_DISK_IMAGE_INFO_OFFSET, "INFO", WOZ_INFO_SIZE);
+    pInfo[0] = WOZ_VERSION;
+    pInfo[1] = WOZ_DISK_TYPE_5_25;
+    /* Write protected, synchronized, and cleaned.  The bitstreams are generated so they never contain the fake bits
+       which a real MC3470 would have added. */
+    pInfo[2] = 0;
+    pInfo[3] = 0;
+    pInfo[4] = 1;
+    memset(pInfo + 5, ' ', WOZ_CREATOR_SIZE);
+    memcpy(pInfo + 5, WOZ_CREATOR, sizeof(WOZ_CREATOR) - 1);
+    pInfo[37] = 1;
+    pInfo[38] = 0;
+    pInfo[39] = WOZ_OPTIMAL_BIT_TIMING;
+    write16(pInfo + 40, 0);
+    write16(pInfo + 42, 0);
+    write16(pInfo + 44, largestTrackBlocks);
+}
+
+static void writeChunkHeader(unsigned char* pChunk, const char* pId, uint32_t size)
+{
+    memcpy(pChunk, pId, 4);
+    write32(pChunk + 4, size);
+}
+
+static void writeTrackMapChunk(unsigned char* pWoz, const int* pIsTrackPresent)
+{
+    /* Each track is also mapped to the quarter tracks on either side of it, as a real head would still read it there. */
+    unsigned char* pMap = pWoz + WOZ_DISK_IMAGE_TMAP_OFFSET + WOZ_DISK_IMAGE_CHUNK_HEADER;
+    unsigned int   track;
+    
+    writeChunkHeader(pWoz + WOZ_DISK_IMAGE_TMAP_OFFSET, "TMAP", WOZ_DISK_IMAGE_QUARTER_TRACKS);
+    memset(pMap, WOZ_DISK_IMAGE_NO_TRACK, WOZ_DISK_IMAGE_QUARTER_TRACKS);
+    for (track = 0 ; track < DISK_IMAGE_TRACKS_PER_SIDE ; track++)
+    {
+        if (!pIsTrackPresent[track])
+            continue;
+        if (track > 0)
+            pMap[track * 4 - 1] = track;
+        pMap[track * 4] = track;
+        pMap[track * 4 + 1] = track;
+    }
+}
+
+static int isTrackPresent(WozDiskImage* pThis, unsigned int track)
+{
+    const unsigned char* pCurr = DiskImage_GetImagePointer(&pThis->super.super) + 
+                                 track * NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK;
+    const unsigned char* pEnd = pCurr + NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK;
+    
+    while (pCurr < pEnd)
+    {
+        if (*pCurr++)
+            return 1;
+    }
+    return 0;
+}
+
+static void writeBits(BitWriter* pWriter, uint32_t value, unsigned int bitCount);
+static void flushBits(BitWriter* pWriter);
+static unsigned int writeTrackBits(WozDiskImage* pThis, unsigned int track, unsigned char* pBits)
+{
+    /* Nibbles are processed 8 at a time so that the common case of 8 data nibbles in a row, which have no sync bits to
+       insert, can be written as two 32-bit words. */
+    unsigned int         firstNibble = track * NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK;
+    const unsigned char* pNibbles = DiskImage_GetImagePointer(&pThis->super.super) + firstNibble;
+    const unsigned char* pSyncFlags = pThis->super.syncNibbles + firstNibble / 8;
+    BitWriter            writer;
+    unsigned int         i;
+    
+    memset(&writer, 0, sizeof(writer));
+    writer.pWrite = pBits;
+    for (i = 0 ; i < NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK / 8 ; i++, pNibbles += 8)
+    {
+        unsigned char syncFlags = *pSyncFlags++;
+        unsigned int  j;
+        
+        if (syncFlags == 0)
+        {
+            writeBits(&writer, ((uint32_t)pNibbles[0] << 24) | ((uint32_t)pNibbles[1] << 16) | 
+                               ((uint32_t)pNibbles[2] << 8) | pNibbles[3], 32);
+            writeBits(&writer, ((uint32_t)pNibbles[4] << 24) | ((uint32_t)pNibbles[5] << 16) | 
+                               ((uint32_t)pNibbles[6] << 8) | pNibbles[7], 32);
+            continue;
+        }
+        for (j = 0 ; j < 8 ; j++)
+        {
+            if (syncFlags & (0x80 >> j))
+                writeBits(&writer, (uint32_t)pNibbles[j] << (SYNC_BITS - NIBBLE_BITS), SYNC_BITS);
+            else
+                writeBits(&writer, pNibbles[j], NIBBLE_BITS);
+        }
+    }
+    flushBits(&writer);
+    
+    return writer.totalBitCount;
+}
+
+static void writeBits(BitWriter* pWriter, uint32_t value, unsigned int bitCount)
+{
+    pWriter->bits = (pWriter->bits << bitCount) | value;
+    pWriter->bitCount += bitCount;
+    pWriter->totalBitCount += bitCount;
+    if (pWriter->bitCount >= 32)
+    {
+        uint32_t word;
+        
+        pWriter->bitCount -= 32;
+        word = (uint32_t)(pWriter->bits >> pWriter->bitCount);
+        pWriter->pWrite[0] = word >> 24;
+        pWriter->pWrite[1] = word >> 16;
+        pWriter->pWrite[2] = word >> 8;
+        pWriter->pWrite[3] = word;
+        pWriter->pWrite += 4;
+    }
+}
+
+static void flushBits(BitWriter* pWriter)
+{
+    uint32_t word = (uint32_t)(pWriter->bits << (32 - pWriter->bitCount));
+    
+    while (pWriter->bitCount > 0)
+    {
+        *pWriter->pWrite++ = word >> 24;
+        word <<= 8;
+        pWriter->bitCount = pWriter->bitCount > 8 ? pWriter->bitCount - 8 : 0;
+    }
+}
+
+static void write16(unsigned char* p, uint16_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void write32(unsigned char* p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+
+__throws void WozDiskImage_WriteImage(WozDiskImage* pThis, const char* pImageFilename)
+{
+    DiskImage_WriteImage(&pThis->super.super, pImageFilename);
+}
+
+
+__throws void WozDiskImage_UpdateImage(WozDiskImage* pThis, const char* pScriptFilename, const char* pImageFilename)
+{
+    DiskImage_UpdateImage(&pThis->super.super, pScriptFilename, pImageFilename);
+}
+
+
+void WozDiskImage_PrintLayoutMap(WozDiskImage* pThis)
+{
+    DiskImage_PrintLayoutMap(&pThis->super.super);
+}
+
+
+const unsigned char* WozDiskImage_GetNibblePointer(WozDiskImage* pThis)
+{
+    return DiskImage_GetImagePointer(&pThis->super.super);
+}
+
+
+size_t WozDiskImage_GetNibbleSize(WozDiskImage* pThis)
+{
+    return DiskImage_GetImageSize(&pThis->super.super);
+}
@@ -19,6 +19,9 @@ extern "C"
 {
     #include "BlockDiskImage.h"
     #include "BinaryBuffer.h"
+    #include "DiskImageManifest.h"
+    #include "DiskImagePlan.h"
+    #include "LzCompressor.h"
     #include "MallocFailureInject.h"
     #include "FileFailureInject.h"
     #include "printfSpy.h"
@@ -34,6 +37,8 @@ static const char* g_savFilenameAllOnes = "BlockDiskImageTestOnes.sav";
 static const char* g_usrFilenameAllOnes = "BlockDiskImageTestOnes.usr";
 static const char* g_imgTableFilename = "BlockDiskImageTest.img";
 static const char* g_scriptFilename = "BlockDiskImageTest.script";
+static const char* g_planFilename = "BlockDiskImageTest.script.plan";
+static const char* g_manifestFilename = "BlockDiskImageTest.hdv.manifest";
 
 
 TEST_GROUP(BlockDiskImage)
@@ -67,6 +72,8 @@ TEST_GROUP(BlockDiskImage)
         remove(g_usrFilenameAllOnes);
         remove(g_imgTableFilename);
         remove(g_scriptFilename);
+        remove(g_planFilename);
+        remove(g_manifestFilename);
     }
     
     char* copy(const char* pStringToCopy)
@@ -232,15 +239,15 @@ TEST_GROUP(BlockDiskImage)
         free(pBlockData);
     }
     
-    const unsigned char* readDiskImageIntoMemory(void)
+    const unsigned char* readDiskImageIntoMemory(long imageSize = BLOCK_DISK_IMAGE_3_5_DISK_SIZE)
     {
         m_pFile = fopen(g_imageFilename, "rb");
         CHECK(m_pFile != NULL);
-        LONGS_EQUAL(BLOCK_DISK_IMAGE_3_5_DISK_SIZE, getFileSize(m_pFile));
+        LONGS_EQUAL(imageSize, getFileSize(m_pFile));
         
-        m_pImageOnDisk = (unsigned char*)malloc(BLOCK_DISK_IMAGE_3_5_DISK_SIZE);
+        m_pImageOnDisk = (unsigned char*)malloc(imageSize);
         CHECK(m_pImageOnDisk != NULL);
-        LONGS_EQUAL(BLOCK_DISK_IMAGE_3_5_DISK_SIZE, fread(m_pImageOnDisk, 1, BLOCK_DISK_IMAGE_3_5_DISK_SIZE, m_pFile));
+        LONGS_EQUAL(imageSize, fread(m_pImageOnDisk, 1, imageSize, m_pFile));
 
         fclose(m_pFile);
         m_pFile = NULL;
@@ -305,6 +312,55 @@ TEST_GROUP(BlockDiskImage)
         fclose(pFile);
     }
     
+    void createFilledBlockObjectFile(const char* pFilename, unsigned char fillByte)
+    {
+        unsigned char blockData[DISK_IMAGE_BLOCK_SIZE];
+        memset(blockData, fillByte, sizeof(blockData));
+        createBlockObjectFile(pFilename, blockData, sizeof(blockData));
+    }
+
+    void overwriteBlockInImageFile(unsigned int block, unsigned char fillByte)
+    {
+        unsigned char blockData[DISK_IMAGE_BLOCK_SIZE];
+        memset(blockData, fillByte, sizeof(blockData));
+
+        FILE* pFile = fopen(g_imageFilename, "r+b");
+        CHECK(pFile != NULL);
+        fseek(pFile, block * DISK_IMAGE_BLOCK_SIZE, SEEK_SET);
+        LONGS_EQUAL(sizeof(blockData), fwrite(blockData, 1, sizeof(blockData), pFile));
+        fclose(pFile);
+    }
+
+    void redirectBlockInPlanFile(unsigned int newBlock)
+    {
+        static const char objectFilename[] = "BlockDiskImageTestOnes.sav";
+        DiskImagePlanEntry entry;
+
+        FILE* pFile = fopen(g_planFilename, "r+b");
+        CHECK(pFile != NULL);
+        fseek(pFile, -(long)(sizeof(entry) + sizeof(objectFilename)), SEEK_END);
+        LONGS_EQUAL(sizeof(entry), fread(&entry, 1, sizeof(entry), pFile));
+        entry.insert.block = newBlock;
+        fseek(pFile, -(long)(sizeof(entry) + sizeof(objectFilename)), SEEK_END);
+        LONGS_EQUAL(sizeof(entry), fwrite(&entry, 1, sizeof(entry), pFile));
+        fclose(pFile);
+    }
+
+    void recreateDiskImageAndUpdate()
+    {
+        DiskImage_Free((DiskImage*)m_pDiskImage);
+        m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+        BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    }
+
+    size_t getManifestEntryCount()
+    {
+        DiskImageManifest* pManifest = DiskImageManifest_CreateFromFile(g_manifestFilename);
+        size_t             entryCount = DiskImageManifest_GetEntryCount(pManifest);
+        DiskImageManifest_Free(pManifest);
+        return entryCount;
+    }
+    
     void createOnesSectorUSRObjectFile(unsigned short side, 
                                        unsigned short track, 
                                        unsigned short sector, 
@@ -574,6 +630,52 @@ TEST(BlockDiskImage, FailFWriteInWriteImage)
     validateFileExceptionThrown();
 }
 
+TEST(BlockDiskImage, WriteMostlyEmptyHardDiskImage)
+{
+    static const long imageSize = (long)BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT * DISK_IMAGE_BLOCK_SIZE;
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT);
+    writeOnesBlocks(0, 1);
+    writeOnesBlocks(1000, 2);
+    BlockDiskImage_WriteImage(m_pDiskImage, g_imageFilename);
+    
+    const unsigned char* pImage = readDiskImageIntoMemory(imageSize);
+    validateBlocksAreOnes(pImage, 0, 0);
+    validateBlocksAreZeroes(pImage, 1, 999);
+    validateBlocksAreOnes(pImage, 1000, 1001);
+    validateBlocksAreZeroes(pImage, 1002, BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT - 1);
+}
+
+TEST(BlockDiskImage, WriteHardDiskImageWithOnlyLastBlockUsed)
+{
+    static const long imageSize = (long)BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT * DISK_IMAGE_BLOCK_SIZE;
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT);
+    writeOnesBlocks(BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT - 1, 1);
+    BlockDiskImage_WriteImage(m_pDiskImage, g_imageFilename);
+    
+    const unsigned char* pImage = readDiskImageIntoMemory(imageSize);
+    validateBlocksAreZeroes(pImage, 0, BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT - 2);
+    validateBlocksAreOnes(pImage, BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT - 1, BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT - 1);
+}
+
+TEST(BlockDiskImage, WriteEmptyImageAtFullSize)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    BlockDiskImage_WriteImage(m_pDiskImage, g_imageFilename);
+    
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateAllZeroes(pImage, BLOCK_DISK_IMAGE_3_5_DISK_SIZE);
+}
+
+TEST(BlockDiskImage, FailFSeekInSparseWriteImage)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    writeOnesBlocks(1, 1);
+    fseekSetFailureCode(-1);
+        __try_and_catch( BlockDiskImage_WriteImage(m_pDiskImage, g_imageFilename) );
+    fseekRestore();
+    validateFileExceptionThrown();
+}
+
 TEST(BlockDiskImage, ReadSAVObjectFile)
 {
     m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
@@ -963,6 +1065,150 @@ TEST(BlockDiskImage, ProcessTwoLineTextScriptUsingAsteriskToStartFromLastInserti
     validateBlocksAreOnes(pImage, 0, 0);
 }
 
+TEST(BlockDiskImage, ProcessTextScriptWithLZCompressesDataBeforeInserting)
+{
+    static const unsigned char expectedCompressed[] = { 0x01, 0xff, 
+                                                        0xff, 0x01, 0x00, 0xff, 0x01, 0x00, 0xff, 0x01, 0x00,
+                                                        0x80 | (121 - 3), 0x01, 0x00, 
+                                                        0x00 };
+    unsigned char        decompressed[DISK_IMAGE_BLOCK_SIZE];
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,*,1,lz" LINE_ENDING));
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    CHECK_TRUE(0 == memcmp(pImage + DISK_IMAGE_BLOCK_SIZE, expectedCompressed, sizeof(expectedCompressed)));
+    validateAllZeroes(pImage + DISK_IMAGE_BLOCK_SIZE + sizeof(expectedCompressed), 
+                      BlockDiskImage_GetImageSize(m_pDiskImage) - DISK_IMAGE_BLOCK_SIZE - sizeof(expectedCompressed));
+    LONGS_EQUAL(sizeof(decompressed), LzCompressor_Decompress(decompressed, sizeof(decompressed), 
+                                                              pImage + DISK_IMAGE_BLOCK_SIZE, sizeof(expectedCompressed)));
+    validateAllOnes(decompressed, sizeof(decompressed));
+    STRCMP_EQUAL("<null>:1: compressed 512 bytes to 15 bytes (2%)." LINE_ENDING, printfSpy_GetLastOutput());
+    STRCMP_EQUAL("", printfSpy_GetLastErrorOutput());
+}
+
+TEST(BlockDiskImage, ProcessTwoLineTextScriptWithLZUsingAsteriskToStartAfterCompressedData)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,*,*,LZ" LINE_ENDING
+                                                    "BLOCK,BlockDiskImageTestOnes.sav,0,1,*" LINE_ENDING));
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    LONGS_EQUAL(0x00, pImage[14]);
+    LONGS_EQUAL(0xff, pImage[15]);
+    validateAllZeroes(pImage + 16, BlockDiskImage_GetImageSize(m_pDiskImage) - 16);
+    STRCMP_EQUAL("", printfSpy_GetLastErrorOutput());
+}
+
+TEST(BlockDiskImage, ProcessOneRW18LineTextScriptWithLZ)
+{
+    unsigned char decompressed[DISK_IMAGE_BYTES_PER_SECTOR];
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesSectorUSRObjectFile(DISK_IMAGE_RW18_SIDE_2, DISK_IMAGE_TRACKS_PER_SIDE - 1, 17, 0);
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("RW18,BlockDiskImageTestOnes.usr,0,*,0xa9,0,0,Lz" LINE_ENDING));
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    const unsigned char* pTrack = pImage + startOffsetForSide(0);
+    LONGS_EQUAL(sizeof(decompressed), LzCompressor_Decompress(decompressed, sizeof(decompressed), 
+                                                              pTrack, DISK_IMAGE_BYTES_PER_SECTOR));
+    validateAllOnes(decompressed, sizeof(decompressed));
+    STRCMP_EQUAL("<null>:1: compressed 256 bytes to 9 bytes (3%)." LINE_ENDING, printfSpy_GetLastOutput());
+}
+
+TEST(BlockDiskImage, ProcessTextScriptUsingInMemoryObjectFile)
+{
+    unsigned char    blockData[DISK_IMAGE_BLOCK_SIZE];
+    SavFileHeader    header = { {'S', 'A', 'V', 0x1a}, 0x800, DISK_IMAGE_BLOCK_SIZE };
+    BinaryBufferFile file = { "InMemory.sav", blockData, sizeof(blockData), &header, NULL };
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    memset(blockData, 0xff, sizeof(blockData));
+
+    DiskImage_AddInMemoryObjectFile((DiskImage*)m_pDiskImage, &file);
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,InMemory.sav,0,*,1" LINE_ENDING));
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    validateBlocksAreZeroes(pImage, 0, 0);
+    validateBlocksAreOnes(pImage, 1, 1);
+    validateBlocksAreZeroes(pImage, 2, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+    STRCMP_EQUAL("", printfSpy_GetLastErrorOutput());
+    LONGS_EQUAL(0, DiskImage_GetScriptErrorCount((DiskImage*)m_pDiskImage));
+}
+
+TEST(BlockDiskImage, InMemoryObjectFileTakesPrecedenceOverFileOnDisk)
+{
+    unsigned char    blockData[DISK_IMAGE_BLOCK_SIZE / 2];
+    BinaryBufferFile file = { g_savFilenameAllOnes, blockData, sizeof(blockData), NULL, NULL };
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    memset(blockData, 0x55, sizeof(blockData));
+
+    DiskImage_AddInMemoryObjectFile((DiskImage*)m_pDiskImage, &file);
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,*,0" LINE_ENDING));
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    CHECK_TRUE(0 == memcmp(pImage, blockData, sizeof(blockData)));
+    validateAllZeroes(pImage + sizeof(blockData), BlockDiskImage_GetImageSize(m_pDiskImage) - sizeof(blockData));
+}
+
+TEST(BlockDiskImage, ProcessRW18TextScriptUsingHeaderFieldsOfInMemoryObjectFile)
+{
+    unsigned char     sectorData[DISK_IMAGE_BYTES_PER_SECTOR];
+    RW18SavFileHeader header = { {'U', 'S', 'R', 0x1a}, DISK_IMAGE_RW18_SIDE_2, DISK_IMAGE_TRACKS_PER_SIDE - 1, 
+                                 17 * DISK_IMAGE_BYTES_PER_SECTOR, DISK_IMAGE_BYTES_PER_SECTOR };
+    BinaryBufferFile  file = { "InMemory.usr", sectorData, sizeof(sectorData), NULL, &header };
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    memset(sectorData, 0xff, sizeof(sectorData));
+
+    DiskImage_AddInMemoryObjectFile((DiskImage*)m_pDiskImage, &file);
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("RW18,InMemory.usr,0,*,*,*,*" LINE_ENDING));
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    validateRW18SectorsAreZeroes(pImage, DISK_IMAGE_RW18_SIDE_0, 0, 0, 
+                                         DISK_IMAGE_RW18_SIDE_2, DISK_IMAGE_TRACKS_PER_SIDE - 1, 16);
+    validateRW18SectorsAreOnes(pImage, DISK_IMAGE_RW18_SIDE_2, DISK_IMAGE_TRACKS_PER_SIDE - 1, 17, 
+                                       DISK_IMAGE_RW18_SIDE_2, DISK_IMAGE_TRACKS_PER_SIDE - 1, 17);
+}
+
+TEST(BlockDiskImage, ProcessTextScriptWithManyInMemoryObjectFiles)
+{
+    static const char* filenames[] = { "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", 
+                                       "10", "11", "12", "13", "14", "15", "16", "17", "18", "19" };
+    unsigned char      data[ARRAYSIZE(filenames)];
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+
+    for (size_t i = 0 ; i < ARRAYSIZE(filenames) ; i++)
+    {
+        BinaryBufferFile file = { filenames[i], &data[i], 1, NULL, NULL };
+        data[i] = (unsigned char)(i + 1);
+        DiskImage_AddInMemoryObjectFile((DiskImage*)m_pDiskImage, &file);
+    }
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,0,0,*,0" LINE_ENDING
+                                                    "BLOCK,17,0,*,0,1" LINE_ENDING
+                                                    "BLOCK,19,0,*,0,2" LINE_ENDING));
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    LONGS_EQUAL(1, pImage[0]);
+    LONGS_EQUAL(18, pImage[1]);
+    LONGS_EQUAL(20, pImage[2]);
+    LONGS_EQUAL(0, pImage[3]);
+}
+
+TEST(BlockDiskImage, FailAllocationInAddInMemoryObjectFile)
+{
+    unsigned char    data = 0xff;
+    BinaryBufferFile file = { "InMemory.sav", &data, 1, NULL, NULL };
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( DiskImage_AddInMemoryObjectFile((DiskImage*)m_pDiskImage, &file) );
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    clearExceptionCode();
+}
+
 TEST(BlockDiskImage, ProcessOneRW18LineTextScriptWithAsteriskForAllFieldsSoThatFileHeaderFieldsAreUsed)
 {
     m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
@@ -1058,7 +1304,7 @@ TEST(BlockDiskImage, PassTooFewBlockTokensToProcessScript)
     createOnesBlockObjectFile();
 
     BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,512" LINE_ENDING));
-    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: BLOCK,objectFilename,objectStartOffset,insertionLength,block[,intraBlockOffset]" LINE_ENDING,
+    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: BLOCK,objectFilename,objectStartOffset,insertionLength,block[,intraBlockOffset][,LZ]" LINE_ENDING,
                  printfSpy_GetLastErrorOutput());
 }
 
@@ -1068,7 +1314,7 @@ TEST(BlockDiskImage, PassTooManyTokensToProcessScript)
     createOnesBlockObjectFile();
 
     BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,512,0,0,0" LINE_ENDING));
-    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: BLOCK,objectFilename,objectStartOffset,insertionLength,block[,intraBlockOffset]" LINE_ENDING,
+    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: BLOCK,objectFilename,objectStartOffset,insertionLength,block[,intraBlockOffset][,LZ]" LINE_ENDING,
                  printfSpy_GetLastErrorOutput());
 }
 
@@ -1080,6 +1326,7 @@ TEST(BlockDiskImage, PassInvalidFilenameToProcessScript)
     BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,InvalidFilename.sav,0,512,0" LINE_ENDING));
     STRCMP_EQUAL("<null>:1: error: Failed to open 'InvalidFilename.sav' object file." LINE_ENDING,
                  printfSpy_GetLastErrorOutput());
+    LONGS_EQUAL(1, DiskImage_GetScriptErrorCount((DiskImage*)m_pDiskImage));
 }
 
 TEST(BlockDiskImage, PassInvalidBlockToProcessScript)
@@ -1112,6 +1359,27 @@ TEST(BlockDiskImage, PassInvalidSourceOffsetToProcessScript)
                  printfSpy_GetLastErrorOutput());
 }
 
+TEST(BlockDiskImage, PassInvalidSourceOffsetWithLZToProcessScript)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,512,512,0,0,lz" LINE_ENDING));
+    STRCMP_EQUAL("<null>:1: error: 512 specifies an invalid source data offset.  Should be less than 512." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(BlockDiskImage, PassTooManyTokensWithLZToProcessScript)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,512,0,0,0,lz" LINE_ENDING));
+    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: "
+                 "BLOCK,objectFilename,objectStartOffset,insertionLength,block[,intraBlockOffset][,LZ]" LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
 TEST(BlockDiskImage, PassInvalidLengthToProcessScript)
 {
     m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
@@ -1148,7 +1416,7 @@ TEST(BlockDiskImage, PassTooFewRW18TokensToProcessScript)
     createOnesSectorUSRObjectFile(DISK_IMAGE_RW18_SIDE_2, DISK_IMAGE_TRACKS_PER_SIDE - 1, 17, 0);
 
     BlockDiskImage_ProcessScript(m_pDiskImage, copy("RW18,BlockDiskImageTestOnes.usr,0,*,0xa9,0" LINE_ENDING));
-    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: RW18,objectFilename,objectStartOffset,insertionLength,side,track,offset[,imageTableAddress]" LINE_ENDING,
+    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: RW18,objectFilename,objectStartOffset,insertionLength,side,track,offset[,imageTableAddress][,LZ]" LINE_ENDING,
                  printfSpy_GetLastErrorOutput());
 }
 
@@ -1158,7 +1426,7 @@ TEST(BlockDiskImage, PassTooManyRW18TokensToProcessScript)
     createOnesSectorUSRObjectFile(DISK_IMAGE_RW18_SIDE_2, DISK_IMAGE_TRACKS_PER_SIDE - 1, 17, 0);
 
     BlockDiskImage_ProcessScript(m_pDiskImage, copy("RW18,BlockDiskImageTestOnes.usr,0,*,0xa9,0,0,0,0" LINE_ENDING));
-    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: RW18,objectFilename,objectStartOffset,insertionLength,side,track,offset[,imageTableAddress]" LINE_ENDING,
+    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: RW18,objectFilename,objectStartOffset,insertionLength,side,track,offset[,imageTableAddress][,LZ]" LINE_ENDING,
                  printfSpy_GetLastErrorOutput());
 }
 
@@ -1218,3 +1486,343 @@ TEST(BlockDiskImage, FailToAllocateTextFileInProcessScriptFile)
     __try_and_catch( BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename) );
     validateOutOfMemoryExceptionThrown();
 }
+
+TEST(BlockDiskImage, ReportInvalidDestinationOnLaterLineBeforeFailingToOpenObjectFileOnEarlierLine)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,InvalidFilename.sav,0,512,0" LINE_ENDING
+                                                    "BLOCK,BlockDiskImageTestOnes.sav,0,512,1600" LINE_ENDING));
+    STRCMP_EQUAL("<null>:1: error: Failed to open 'InvalidFilename.sav' object file." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(BlockDiskImage, ValidLinesAreStillInsertedWhenOtherLinesFailToCompile)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,512,1600" LINE_ENDING
+                                                    "BLOCK,BlockDiskImageTestOnes.sav,0,512,1" LINE_ENDING));
+    STRCMP_EQUAL("<null>:1: error: Write starting at block 1600 offset 0 won't fit in output image file." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    validateBlocksAreZeroes(pImage, 0, 0);
+    validateBlocksAreOnes(pImage, 1, 1);
+    validateBlocksAreZeroes(pImage, 2, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+}
+
+TEST(BlockDiskImage, ReportOverlappingBlockWritesWithBothLineNumbers)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,512,1" LINE_ENDING
+                                                    "BLOCK,BlockDiskImageTestOnes.sav,0,512,*" LINE_ENDING
+                                                    "BLOCK,BlockDiskImageTestOnes.sav,0,256,1,256" LINE_ENDING));
+    STRCMP_EQUAL("<null>:3: error: Write overlaps data already inserted by line 1." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(BlockDiskImage, ReportRW18WriteOverlappingEarlierBlockWrite)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createOnesSectorUSRObjectFile(DISK_IMAGE_RW18_SIDE_0, 0, 0, 0);
+
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,512,16" LINE_ENDING
+                                                    "RW18,BlockDiskImageTestOnes.usr,0,*,*,*,*" LINE_ENDING));
+    STRCMP_EQUAL("<null>:2: error: Write overlaps data already inserted by line 1." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(BlockDiskImage, PrintLayoutMapOfUsedAndFreeBlocks)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    BlockDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,BlockDiskImageTestOnes.sav,0,512,1" LINE_ENDING));
+
+    BlockDiskImage_PrintLayoutMap(m_pDiskImage);
+    LONGS_EQUAL(4, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  0x000200 - 0x0003ff used by line 1\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  0x000400 - 0x0c7fff free\n", printfSpy_GetLastOutput());
+}
+
+TEST(BlockDiskImage, PrintLayoutMapOfEmptyImage)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+
+    BlockDiskImage_PrintLayoutMap(m_pDiskImage);
+    LONGS_EQUAL(2, printfSpy_GetCallCount());
+    STRCMP_EQUAL("Block image bytes:\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  0x000000 - 0x0c7fff free\n", printfSpy_GetLastOutput());
+}
+
+TEST(BlockDiskImage, ProcessScriptFileWritesPlanCache)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING
+                                     "BLOCK,BlockDiskImageTestOnes.sav,0,512,1599" LINE_ENDING);
+
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+
+    m_pFile = fopen(g_planFilename, "rb");
+    CHECK_TRUE(m_pFile != NULL);
+}
+
+TEST(BlockDiskImage, ProcessScriptFileWithErrorsDoesNotWritePlanCache)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING
+                                     "BLOCK,BlockDiskImageTestOnes.sav,0,512,1600" LINE_ENDING);
+
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+
+    m_pFile = fopen(g_planFilename, "rb");
+    POINTERS_EQUAL(NULL, m_pFile);
+}
+
+TEST(BlockDiskImage, ProcessScriptFileWithPlanCacheDisabledDoesNotWritePlanCache)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    DiskImage_DisablePlanCache((DiskImage*)m_pDiskImage);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+
+    m_pFile = fopen(g_planFilename, "rb");
+    POINTERS_EQUAL(NULL, m_pFile);
+    validateBlocksAreOnes(BlockDiskImage_GetImagePointer(m_pDiskImage), 0, 0);
+}
+
+TEST(BlockDiskImage, ProcessScriptFileWithPlanCacheDisabledIgnoresCachedPlan)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+    redirectBlockInPlanFile(1599);
+    DiskImage_Free((DiskImage*)m_pDiskImage);
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    DiskImage_DisablePlanCache((DiskImage*)m_pDiskImage);
+
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    validateBlocksAreOnes(pImage, 0, 0);
+    validateBlocksAreZeroes(pImage, 1, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+}
+
+TEST(BlockDiskImage, ProcessScriptFileUsesCachedPlanWhenScriptIsUnchanged)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+    redirectBlockInPlanFile(1599);
+    DiskImage_Free((DiskImage*)m_pDiskImage);
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    validateBlocksAreZeroes(pImage, 0, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 2);
+    validateBlocksAreOnes(pImage, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+}
+
+TEST(BlockDiskImage, ProcessScriptFileIgnoresCachedPlanWhenScriptHasChanged)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+    DiskImage_Free((DiskImage*)m_pDiskImage);
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,1" LINE_ENDING);
+
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    validateBlocksAreZeroes(pImage, 0, 0);
+    validateBlocksAreOnes(pImage, 1, 1);
+}
+
+TEST(BlockDiskImage, ProcessScriptFileIgnoresTruncatedPlanCache)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,1" LINE_ENDING);
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+    DiskImage_Free((DiskImage*)m_pDiskImage);
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createTextFile(g_planFilename, "CRKP");
+
+    BlockDiskImage_ProcessScriptFile(m_pDiskImage, g_scriptFilename);
+
+    const unsigned char* pImage = BlockDiskImage_GetImagePointer(m_pDiskImage);
+    validateBlocksAreZeroes(pImage, 0, 0);
+    validateBlocksAreOnes(pImage, 1, 1);
+}
+
+TEST(BlockDiskImage, UpdateImageWithNoExistingImageDoesFullBuildAndWritesManifest)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateBlocksAreOnes(pImage, 0, 0);
+    validateBlocksAreZeroes(pImage, 1, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+    LONGS_EQUAL(1, getManifestEntryCount());
+}
+
+TEST(BlockDiskImage, UpdateImageWithUnchangedInputsDoesNotRewriteImage)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    overwriteBlockInImageFile(0, 0x00);
+
+    recreateDiskImageAndUpdate();
+
+    validateBlocksAreZeroes(readDiskImageIntoMemory(), 0, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+}
+
+TEST(BlockDiskImage, UpdateImageOnlyRewritesBlocksWhoseInputsChanged)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createFilledBlockObjectFile(g_savFilenameAllZeroes, 0xff);
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,1599" LINE_ENDING
+                                     "BLOCK,BlockDiskImageTestZeroes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    overwriteBlockInImageFile(1599, 0x00);
+    createFilledBlockObjectFile(g_savFilenameAllZeroes, 0x00);
+
+    recreateDiskImageAndUpdate();
+
+    validateBlocksAreZeroes(readDiskImageIntoMemory(), 0, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+    LONGS_EQUAL(2, getManifestEntryCount());
+}
+
+TEST(BlockDiskImage, UpdateImageWithChangedDestinationDoesFullRebuild)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    overwriteBlockInImageFile(1, 0xff);
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,2" LINE_ENDING);
+
+    recreateDiskImageAndUpdate();
+
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateBlocksAreZeroes(pImage, 0, 1);
+    validateBlocksAreOnes(pImage, 2, 2);
+    validateBlocksAreZeroes(pImage, 3, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+    LONGS_EQUAL(1, getManifestEntryCount());
+}
+
+TEST(BlockDiskImage, UpdateImageWithRemovedLineDoesFullRebuild)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING
+                                     "BLOCK,BlockDiskImageTestOnes.sav,0,512,1599" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+
+    recreateDiskImageAndUpdate();
+
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateBlocksAreOnes(pImage, 0, 0);
+    validateBlocksAreZeroes(pImage, 1, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+    LONGS_EQUAL(1, getManifestEntryCount());
+}
+
+TEST(BlockDiskImage, UpdateImageRebuiltFromCachedPlanCountsEachErrorOnce)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING
+                                     "BLOCK,BlockDiskImageTestOnes.sav,0,512,1599" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestMissing.sav,0,512,0" LINE_ENDING);
+
+    recreateDiskImageAndUpdate();
+
+    LONGS_EQUAL(1, DiskImage_GetScriptErrorCount((DiskImage*)m_pDiskImage));
+}
+
+TEST(BlockDiskImage, UpdateImageWithAppendedLineOnlyAppliesNewLine)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    overwriteBlockInImageFile(0, 0x00);
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING
+                                     "BLOCK,BlockDiskImageTestOnes.sav,0,512,1599" LINE_ENDING);
+
+    recreateDiskImageAndUpdate();
+
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateBlocksAreZeroes(pImage, 0, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 2);
+    validateBlocksAreOnes(pImage, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+    LONGS_EQUAL(2, getManifestEntryCount());
+}
+
+TEST(BlockDiskImage, UpdateImageWithCorruptManifestDoesFullRebuild)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    overwriteBlockInImageFile(1, 0xff);
+    createTextFile(g_manifestFilename, "garbage" LINE_ENDING);
+
+    recreateDiskImageAndUpdate();
+
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateBlocksAreOnes(pImage, 0, 0);
+    validateBlocksAreZeroes(pImage, 1, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+    LONGS_EQUAL(1, getManifestEntryCount());
+}
+
+TEST(BlockDiskImage, UpdateImageWithWrongSizedImageDoesFullRebuild)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createOnesBlockObjectFile();
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestOnes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    createTextFile(g_imageFilename, "too short");
+
+    recreateDiskImageAndUpdate();
+
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateBlocksAreOnes(pImage, 0, 0);
+    validateBlocksAreZeroes(pImage, 1, BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT - 1);
+}
+
+TEST(BlockDiskImage, FailWriteOfChangedBlocksInUpdateImage)
+{
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    createFilledBlockObjectFile(g_savFilenameAllZeroes, 0xff);
+    createTextFile(g_scriptFilename, "BLOCK,BlockDiskImageTestZeroes.sav,0,512,0" LINE_ENDING);
+    BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    createFilledBlockObjectFile(g_savFilenameAllZeroes, 0x00);
+    DiskImage_Free((DiskImage*)m_pDiskImage);
+    m_pDiskImage = BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+
+    fwriteFail(0);
+    __try_and_catch( BlockDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename) );
+    fwriteRestore();
+    validateFileExceptionThrown();
+}
@@ -16,6 +16,7 @@
 extern "C"
 {
 #include "CrackleCommandLine.h"
+#include "NibbleLoadSimulator.h"
 #include "CrackleCommandLineTest.h"
 #include "util.h"
 }
@@ -29,7 +30,7 @@ static const char g_usageString[] = "Usage:";
 
 TEST_GROUP(CrackleCommandLine)
 {
-    const char*        m_argv[10];
+    const char*        m_argv[40];
     CrackleCommandLine m_commandLine;
     int                m_argc;
     
@@ -150,6 +151,242 @@ TEST(CrackleCommandLine, ValidFormatOfHDV_3_5)
     LONGS_EQUAL(FORMAT_HDV_3_5, m_commandLine.imageFormat);
 }
 
+TEST(CrackleCommandLine, ValidFormatOfDSK_5_25)
+{
+    addArg("--format");
+    addArg("dsk_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.dsk");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    LONGS_EQUAL(FORMAT_DSK_5_25, m_commandLine.imageFormat);
+}
+
+TEST(CrackleCommandLine, ValidFormatOfDO_5_25)
+{
+    addArg("--format");
+    addArg("do_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.do");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(FORMAT_DSK_5_25, m_commandLine.imageFormat);
+}
+
+TEST(CrackleCommandLine, ValidFormatOfPO_5_25)
+{
+    addArg("--format");
+    addArg("po_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.po");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    LONGS_EQUAL(FORMAT_PO_5_25, m_commandLine.imageFormat);
+}
+
+TEST(CrackleCommandLine, ValidFormatOfWOZ_5_25)
+{
+    addArg("--format");
+    addArg("woz_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.woz");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    LONGS_EQUAL(FORMAT_WOZ_5_25, m_commandLine.imageFormat);
+}
+
+TEST(CrackleCommandLine, ValidInterleaveAndRevolutionsForWozImage)
+{
+    addArg("--format");
+    addArg("woz_5.25");
+    addArg("--interleave");
+    addArg("2");
+    addArg("--revolutions");
+    addArg("pop1.crackle");
+    addArg("pop1.woz");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    CHECK_TRUE(m_commandLine.hasRWTS16Interleave);
+    CHECK_TRUE(m_commandLine.printRevolutions);
+}
+
+TEST(CrackleCommandLine, ValidFormatOfHDVWithDefaultBlockCount)
+{
+    addArg("--format");
+    addArg("hdv");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    LONGS_EQUAL(FORMAT_HDV, m_commandLine.imageFormat);
+    LONGS_EQUAL(BLOCK_DISK_IMAGE_MAX_BLOCK_COUNT, m_commandLine.blockCount);
+}
+
+TEST(CrackleCommandLine, ValidFormatOfHDVWithBlockCount)
+{
+    addArg("--format");
+    addArg("hdv");
+    addArg("--blocks");
+    addArg("0x4000");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    LONGS_EQUAL(0x4000, m_commandLine.blockCount);
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfZeroBlockCount)
+{
+    addArg("--format");
+    addArg("hdv");
+    addArg("--blocks");
+    addArg("0");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfTooLargeBlockCount)
+{
+    addArg("--format");
+    addArg("hdv");
+    addArg("--blocks");
+    addArg("65536");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfBlockCountWithNoParameter)
+{
+    addArg("--format");
+    addArg("hdv");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    addArg("--blocks");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfBlockCountForFixedSizeImage)
+{
+    addArg("--format");
+    addArg("hdv_3.5");
+    addArg("--blocks");
+    addArg("1600");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, ValidExtraOutputs)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--output");
+    addArg("dsk_5.25");
+    addArg("pop1.dsk");
+    addArg("--output");
+    addArg("WOZ_5.25");
+    addArg("pop1.woz");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    LONGS_EQUAL(FORMAT_NIB_5_25, m_commandLine.imageFormat);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+    LONGS_EQUAL(2, m_commandLine.extraOutputCount);
+    LONGS_EQUAL(FORMAT_DSK_5_25, m_commandLine.extraOutputs[0].imageFormat);
+    STRCMP_EQUAL("pop1.dsk", m_commandLine.extraOutputs[0].pImageFilename);
+    LONGS_EQUAL(FORMAT_WOZ_5_25, m_commandLine.extraOutputs[1].imageFormat);
+    STRCMP_EQUAL("pop1.woz", m_commandLine.extraOutputs[1].pImageFilename);
+}
+
+TEST(CrackleCommandLine, ValidInterleaveWithNibbleImageAsExtraOutput)
+{
+    addArg("--format");
+    addArg("dsk_5.25");
+    addArg("--output");
+    addArg("nib_5.25");
+    addArg("pop1.nib");
+    addArg("--interleave");
+    addArg("2");
+    addArg("pop1.crackle");
+    addArg("pop1.dsk");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    CHECK_TRUE(m_commandLine.hasRWTS16Interleave);
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfOutputWithNoFilename)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    addArg("--output");
+    addArg("dsk_5.25");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfOutputWithUnknownFormat)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--output");
+    addArg("foo_5.25");
+    addArg("pop1.foo");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfTooManyOutputs)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    for (int i = 0 ; i <= CRACKLE_MAX_EXTRA_OUTPUTS ; i++)
+    {
+        addArg("--output");
+        addArg("dsk_5.25");
+        addArg("pop1.dsk");
+    }
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfOutputWithUpdate)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--output");
+    addArg("dsk_5.25");
+    addArg("pop1.dsk");
+    addArg("--update");
+    addArg("pop1.nib");
+    addArg("pop1.crackle");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfInterleaveForSectorImage)
+{
+    addArg("--format");
+    addArg("dsk_5.25");
+    addArg("--interleave");
+    addArg("2");
+    addArg("pop1.crackle");
+    addArg("pop1.dsk");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
 TEST(CrackleCommandLine, InvalidCaseOfTooManyFilenames)
 {
     addArg("--format");
@@ -160,3 +397,606 @@ TEST(CrackleCommandLine, InvalidCaseOfTooManyFilenames)
     __try_and_catch ( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
     validateInvalidArgumentExceptionThrown();
 }
+
+TEST(CrackleCommandLine, ValidUpdateOfExistingImage)
+{
+    addArg("--format");
+    addArg("hdv_3.5");
+    addArg("--update");
+    addArg("pop1.hdv");
+    addArg("pop1.crackle");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.hdv", m_commandLine.pOutputImageFilename);
+    LONGS_EQUAL(FORMAT_HDV_3_5, m_commandLine.imageFormat);
+    CHECK_TRUE(m_commandLine.updateExistingImage);
+}
+
+TEST(CrackleCommandLine, ValidMapOption)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--map");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+    CHECK_TRUE(m_commandLine.printLayoutMap);
+    CHECK_FALSE(m_commandLine.updateExistingImage);
+}
+
+TEST(CrackleCommandLine, ValidNoPlanCacheOption)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--no-plan-cache");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+    CHECK_TRUE(m_commandLine.disablePlanCache);
+}
+
+TEST(CrackleCommandLine, ValidLoadSimOption)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--load-sim");
+    addArg("pop1.load");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+    STRCMP_EQUAL("pop1.load", m_commandLine.pLoadSequenceFilename);
+}
+
+TEST(CrackleCommandLine, MissingLoadSimFilename)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    addArg("--load-sim");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfLoadSimForBlockImage)
+{
+    addArg("--format");
+    addArg("hdv_3.5");
+    addArg("--load-sim");
+    addArg("pop1.load");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, ValidInterleaveSkew)
+{
+    static const unsigned char expected[16] = { 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15 };
+    
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--interleave");
+    addArg("2");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    CHECK_TRUE(m_commandLine.hasRWTS16Interleave);
+    CHECK_TRUE(0 == memcmp(expected, m_commandLine.rwts16Interleave, sizeof(expected)));
+    CHECK_FALSE(m_commandLine.printRevolutions);
+    LONGS_EQUAL(NIBBLE_LOAD_SIMULATOR_DEFAULT_SECTOR_MICROSECONDS, m_commandLine.sectorProcessingTime);
+}
+
+TEST(CrackleCommandLine, ValidInterleaveList)
+{
+    static const unsigned char expected[16] = { 0, 7, 14, 6, 13, 5, 12, 4, 11, 3, 10, 2, 9, 1, 8, 15 };
+    
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--interleave");
+    addArg("0,7,14,6,13,5,12,4,11,3,10,2,9,1,8,15");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    CHECK_TRUE(m_commandLine.hasRWTS16Interleave);
+    CHECK_TRUE(0 == memcmp(expected, m_commandLine.rwts16Interleave, sizeof(expected)));
+}
+
+TEST(CrackleCommandLine, InvalidInterleaveSkew)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--interleave");
+    addArg("16");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidInterleaveListWithDuplicateSector)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--interleave");
+    addArg("0,7,14,6,13,5,12,4,11,3,10,2,9,1,8,8");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidInterleaveListWithTooFewSectors)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--interleave");
+    addArg("0,1,2");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfInterleaveForBlockImage)
+{
+    addArg("--format");
+    addArg("hdv_3.5");
+    addArg("--interleave");
+    addArg("2");
+    addArg("pop1.crackle");
+    addArg("pop1.hdv");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, ValidRevolutionsAndSectorTimeOptions)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--revolutions");
+    addArg("--sector-time");
+    addArg("2500");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    CHECK_TRUE(m_commandLine.printRevolutions);
+    CHECK_FALSE(m_commandLine.hasRWTS16Interleave);
+    LONGS_EQUAL(2500, m_commandLine.sectorProcessingTime);
+}
+
+TEST(CrackleCommandLine, InvalidSectorTime)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--sector-time");
+    addArg("fast");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, MissingUpdateImageFilename)
+{
+    addArg("--format");
+    addArg("hdv_3.5");
+    addArg("pop1.crackle");
+    addArg("--update");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfUpdateAndOutputImageFilename)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--update");
+    addArg("pop1.nib");
+    addArg("pop1.crackle");
+    addArg("pop2.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, VerifyImageWithoutScript)
+{
+    addArg("--verify");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pVerifyImageFilename);
+    POINTERS_EQUAL(NULL, m_commandLine.pScriptFilename);
+    POINTERS_EQUAL(NULL, m_commandLine.pOutputImageFilename);
+    LONGS_EQUAL(FORMAT_UNKNOWN, m_commandLine.imageFormat);
+}
+
+TEST(CrackleCommandLine, VerifyImageAgainstScript)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--verify");
+    addArg("pop1.nib");
+    addArg("pop1.crackle");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pVerifyImageFilename);
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    POINTERS_EQUAL(NULL, m_commandLine.pOutputImageFilename);
+}
+
+TEST(CrackleCommandLine, MissingVerifyImageFilename)
+{
+    addArg("--verify");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfVerifyWithOutputImageFilename)
+{
+    addArg("--verify");
+    addArg("pop1.nib");
+    addArg("pop1.crackle");
+    addArg("pop2.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfVerifyWithUpdate)
+{
+    addArg("--verify");
+    addArg("pop1.nib");
+    addArg("--update");
+    addArg("pop2.nib");
+    addArg("pop1.crackle");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfVerifyForBlockImage)
+{
+    addArg("--format");
+    addArg("hdv_3.5");
+    addArg("--verify");
+    addArg("pop1.hdv");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, ExtractTrackFiles)
+{
+    addArg("--extract");
+    addArg("pop1.nib");
+    addArg("pop1");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pExtractImageFilename);
+    STRCMP_EQUAL("pop1", m_commandLine.pOutputImageFilename);
+    POINTERS_EQUAL(NULL, m_commandLine.pScriptFilename);
+    LONGS_EQUAL(FORMAT_UNKNOWN, m_commandLine.imageFormat);
+}
+
+TEST(CrackleCommandLine, ExtractSectorImage)
+{
+    addArg("--format");
+    addArg("po_5.25");
+    addArg("--extract");
+    addArg("pop1.nib");
+    addArg("pop1.po");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pExtractImageFilename);
+    STRCMP_EQUAL("pop1.po", m_commandLine.pOutputImageFilename);
+    LONGS_EQUAL(FORMAT_PO_5_25, m_commandLine.imageFormat);
+}
+
+TEST(CrackleCommandLine, MissingExtractOutputFilename)
+{
+    addArg("--extract");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfExtractToNibbleImage)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--extract");
+    addArg("pop1.nib");
+    addArg("pop2.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfExtractAndVerify)
+{
+    addArg("--extract");
+    addArg("pop1.nib");
+    addArg("--verify");
+    addArg("pop1.nib");
+    addArg("pop1");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfExtractWithMap)
+{
+    addArg("--extract");
+    addArg("pop1.nib");
+    addArg("--map");
+    addArg("pop1");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, WriteHashesOfBuiltImage)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--hashes");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    CHECK_TRUE(m_commandLine.writeHashes);
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+}
+
+TEST(CrackleCommandLine, DiffImagesWithoutScript)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--diff");
+    addArg("pop1.nib");
+    addArg("pop2.nib.hashes");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pDiffOldFilename);
+    STRCMP_EQUAL("pop2.nib.hashes", m_commandLine.pDiffNewFilename);
+    POINTERS_EQUAL(NULL, m_commandLine.pScriptFilename);
+    POINTERS_EQUAL(NULL, m_commandLine.pOutputImageFilename);
+}
+
+TEST(CrackleCommandLine, DiffHardDiskImagesAgainstScript)
+{
+    addArg("--format");
+    addArg("hdv");
+    addArg("--blocks");
+    addArg("1024");
+    addArg("--diff");
+    addArg("pop1.hdv");
+    addArg("pop2.hdv");
+    addArg("pop1.crackle");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    LONGS_EQUAL(FORMAT_HDV, m_commandLine.imageFormat);
+    LONGS_EQUAL(1024, m_commandLine.blockCount);
+}
+
+TEST(CrackleCommandLine, MissingDiffNewImageFilename)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--diff");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfDiffWithoutFormat)
+{
+    addArg("--diff");
+    addArg("pop1.nib");
+    addArg("pop2.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfDiffForWozImage)
+{
+    addArg("--format");
+    addArg("woz_5.25");
+    addArg("--diff");
+    addArg("pop1.woz");
+    addArg("pop2.woz");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfDiffWithOutputImageFilename)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--diff");
+    addArg("pop1.nib");
+    addArg("pop2.nib");
+    addArg("pop1.crackle");
+    addArg("pop3.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfDiffWithHashes)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--hashes");
+    addArg("--diff");
+    addArg("pop1.nib");
+    addArg("pop2.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfDiffWithBlocksForNibbleImage)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--blocks");
+    addArg("1024");
+    addArg("--diff");
+    addArg("pop1.nib");
+    addArg("pop2.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfDiffAndVerify)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--verify");
+    addArg("pop1.nib");
+    addArg("--diff");
+    addArg("pop1.nib");
+    addArg("pop2.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, AssembleSourcesBeforeProcessingScript)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--assemble");
+    addArg("loader.S");
+    addArg("--putdirs");
+    addArg("src;lib");
+    addArg("--assemble");
+    addArg("game.S");
+    addArg("--outdir");
+    addArg("obj");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    LONGS_EQUAL(2, m_commandLine.assemblySourceCount);
+    STRCMP_EQUAL("loader.S", m_commandLine.assemblySources[0]);
+    STRCMP_EQUAL("game.S", m_commandLine.assemblySources[1]);
+    STRCMP_EQUAL("src;lib", m_commandLine.assemblerInitParams.pPutDirectories);
+    STRCMP_EQUAL("obj", m_commandLine.assemblerInitParams.pOutputDirectory);
+    POINTERS_EQUAL(NULL, m_commandLine.assemblerInitParams.pListFilename);
+    CHECK_TRUE(m_commandLine.assemblerInitParams.keepOutputInMemory);
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+}
+
+TEST(CrackleCommandLine, MissingAssembleSourceFilename)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    addArg("--assemble");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfTooManyAssembleSources)
+{
+    int i;
+    
+    addArg("--format");
+    addArg("nib_5.25");
+    for (i = 0 ; i < CRACKLE_MAX_ASSEMBLY_SOURCES + 1 ; i++)
+    {
+        addArg("--assemble");
+        addArg("game.S");
+    }
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfPutDirsWithoutAssemble)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--putdirs");
+    addArg("src");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfAssembleAndVerify)
+{
+    addArg("--assemble");
+    addArg("game.S");
+    addArg("--verify");
+    addArg("pop1.nib");
+    addArg("pop1.crackle");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, TraceBuild)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--trace");
+    addArg("pop1.json");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    STRCMP_EQUAL("pop1.json", m_commandLine.pTraceFilename);
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+}
+
+TEST(CrackleCommandLine, AllocStatsBuild)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--alloc-stats");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    CHECK_TRUE(m_commandLine.collectAllocStats);
+    STRCMP_EQUAL("pop1.crackle", m_commandLine.pScriptFilename);
+    STRCMP_EQUAL("pop1.nib", m_commandLine.pOutputImageFilename);
+}
+
+TEST(CrackleCommandLine, PerfCountersBuild)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--perf-counters");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    m_commandLine = CrackleCommandLine_Init(m_argc, m_argv);
+    CHECK_TRUE(m_commandLine.collectPerfCounters);
+    CHECK_FALSE(m_commandLine.collectAllocStats);
+}
+
+TEST(CrackleCommandLine, MissingTraceFilename)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    addArg("--trace");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(CrackleCommandLine, InvalidCaseOfTwoTraceFilenames)
+{
+    addArg("--format");
+    addArg("nib_5.25");
+    addArg("--trace");
+    addArg("pop1.json");
+    addArg("--trace");
+    addArg("pop2.json");
+    addArg("pop1.crackle");
+    addArg("pop1.nib");
+    __try_and_catch( m_commandLine = CrackleCommandLine_Init(m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
@@ -0,0 +1,485 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "DiskImageHashes.h"
+    #include "NibbleDiskImage.h"
+    #include "SectorDiskImage.h"
+    #include "BlockDiskImage.h"
+    #include "WozDiskImage.h"
+    #include "Hash64.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_hashesFilename = "DiskImageHashesTest.hashes";
+static const char* g_imageFilename = "DiskImageHashesTest.img";
+static const char* g_imageHashesFilename = "DiskImageHashesTest.img.hashes";
+static const char* g_objectFilename = "DiskImageHashesTest.bin";
+
+
+TEST_GROUP(DiskImageHashes)
+{
+    DiskImageHashes* m_pOld;
+    DiskImageHashes* m_pNew;
+    DiskImage*       m_pDiskImage;
+    unsigned char    m_image[4 * DISK_IMAGE_BLOCK_SIZE];
+    char             m_buffer[1024];
+
+    void setup()
+    {
+        clearExceptionCode();
+        printfSpy_Hook(512);
+        m_pOld = NULL;
+        m_pNew = NULL;
+        m_pDiskImage = NULL;
+        for (size_t i = 0 ; i < sizeof(m_image) ; i++)
+            m_image[i] = (unsigned char)(i * 7 + (i >> 8));
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        fopenRestore();
+        fwriteRestore();
+        printfSpy_Unhook();
+        DiskImageHashes_Free(m_pOld);
+        DiskImageHashes_Free(m_pNew);
+        DiskImage_Free(m_pDiskImage);
+        remove(g_hashesFilename);
+        remove(g_imageFilename);
+        remove(g_imageHashesFilename);
+        remove(g_objectFilename);
+    }
+
+    char* copy(const char* pStringToCopy)
+    {
+        CHECK(strlen(pStringToCopy) < sizeof(m_buffer) - 1);
+        strcpy(m_buffer, pStringToCopy);
+        return m_buffer;
+    }
+
+    void createFile(const char* pFilename, const void* pData, size_t dataSize)
+    {
+        FILE* pFile = fopen(pFilename, "wb");
+        fwrite(pData, 1, dataSize, pFile);
+        fclose(pFile);
+    }
+
+    void createTextFile(const char* pFilename, const char* pText)
+    {
+        createFile(pFilename, pText, strlen(pText));
+    }
+
+    void createObjectFile(size_t fileSize)
+    {
+        CHECK(fileSize <= sizeof(m_image));
+        createFile(g_objectFilename, m_image, fileSize);
+    }
+
+    void hashImage()
+    {
+        DiskImageHashes** ppHashes = m_pOld ? &m_pNew : &m_pOld;
+
+        *ppHashes = DiskImageHashes_Create(DiskImage_GetImagePointer(m_pDiskImage),
+                                           DiskImage_GetImageSize(m_pDiskImage),
+                                           DiskImage_GetHashRegionSize(m_pDiskImage));
+    }
+
+    void validateHashes(DiskImageHashes* pHashes, const unsigned char* pImage, size_t imageSize, unsigned int regionSize)
+    {
+        size_t regionCount = (imageSize + regionSize - 1) / regionSize;
+
+        LONGS_EQUAL(regionSize, DiskImageHashes_GetRegionSize(pHashes));
+        LONGS_EQUAL(regionCount, DiskImageHashes_GetRegionCount(pHashes));
+        for (size_t i = 0 ; i < regionCount ; i++)
+        {
+            size_t   size = (i == regionCount - 1) ? imageSize - i * regionSize : regionSize;
+            uint64_t expectedHash = Hash64_Buffer(pImage + i * regionSize, size, 0);
+
+            CHECK_TRUE(expectedHash == DiskImageHashes_GetHash(pHashes, i));
+        }
+    }
+
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(DiskImageHashes, CreateHashesForEachBlock)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    validateHashes(m_pOld, m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    CHECK_TRUE(DiskImageHashes_GetHash(m_pOld, 0) != DiskImageHashes_GetHash(m_pOld, 1));
+    CHECK_TRUE(0 == DiskImageHashes_GetHash(m_pOld, 4));
+}
+
+TEST(DiskImageHashes, CreateHashesWithPartialLastRegion)
+{
+    m_pOld = DiskImageHashes_Create(m_image, DISK_IMAGE_BLOCK_SIZE + 100, DISK_IMAGE_BLOCK_SIZE);
+    validateHashes(m_pOld, m_image, DISK_IMAGE_BLOCK_SIZE + 100, DISK_IMAGE_BLOCK_SIZE);
+}
+
+TEST(DiskImageHashes, FailCreateWithZeroRegionSize)
+{
+    __try_and_catch( m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), 0) );
+    validateExceptionThrown(invalidArgumentException);
+    POINTERS_EQUAL(NULL, m_pOld);
+}
+
+TEST(DiskImageHashes, FailAllocationsInCreate)
+{
+    for (unsigned int i = 1 ; i <= 2 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE) );
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pOld);
+    }
+}
+
+TEST(DiskImageHashes, CreateFromImageFile)
+{
+    createFile(g_imageFilename, m_image, sizeof(m_image));
+    m_pOld = DiskImageHashes_CreateFromImageFile(g_imageFilename, 2 * DISK_IMAGE_BLOCK_SIZE);
+    validateHashes(m_pOld, m_image, sizeof(m_image), 2 * DISK_IMAGE_BLOCK_SIZE);
+}
+
+TEST(DiskImageHashes, FailToCreateFromNonExistentImageFile)
+{
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromImageFile(g_imageFilename, DISK_IMAGE_BLOCK_SIZE) );
+    validateExceptionThrown(fileOpenException);
+    POINTERS_EQUAL(NULL, m_pOld);
+}
+
+TEST(DiskImageHashes, WriteAndReadBackHashes)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    DiskImageHashes_WriteToFile(m_pOld, g_hashesFilename);
+
+    m_pNew = DiskImageHashes_CreateFromFile(g_hashesFilename);
+    validateHashes(m_pNew, m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+}
+
+TEST(DiskImageHashes, ReadHashesWithUpperCaseHexDigits)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v1\n"
+                                     "6656\n"
+                                     "0123456789ABCDEF\n");
+    m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename);
+    LONGS_EQUAL(6656, DiskImageHashes_GetRegionSize(m_pOld));
+    LONGS_EQUAL(1, DiskImageHashes_GetRegionCount(m_pOld));
+    CHECK_TRUE(0x0123456789abcdefULL == DiskImageHashes_GetHash(m_pOld, 0));
+}
+
+TEST(DiskImageHashes, ReadEnoughHashesToGrowArray)
+{
+    unsigned char image[100];
+
+    memset(image, 0x5a, sizeof(image));
+    m_pOld = DiskImageHashes_Create(image, sizeof(image), 1);
+    DiskImageHashes_WriteToFile(m_pOld, g_hashesFilename);
+
+    m_pNew = DiskImageHashes_CreateFromFile(g_hashesFilename);
+    validateHashes(m_pNew, image, sizeof(image), 1);
+}
+
+TEST(DiskImageHashes, FailToReadNonExistentHashesFile)
+{
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileOpenException);
+    POINTERS_EQUAL(NULL, m_pOld);
+}
+
+TEST(DiskImageHashes, FailToReadHashesWithInvalidHeader)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v2\n"
+                                     "512\n"
+                                     "0123456789abcdef\n");
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, FailToReadHashesWithMissingRegionSize)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v1\n");
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, FailToReadHashesWithZeroRegionSize)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v1\n"
+                                     "0\n");
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, FailToReadHashesWithInvalidRegionSize)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v1\n"
+                                     "0x200\n");
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, FailToReadHashesWithShortHash)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v1\n"
+                                     "512\n"
+                                     "0123456789abcde\n");
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, FailToReadHashesWithInvalidHexDigit)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v1\n"
+                                     "512\n"
+                                     "0123456789abcdeg\n");
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, FailToReadHashesWithTwoFields)
+{
+    createTextFile(g_hashesFilename, "# crackle hashes v1\n"
+                                     "512\n"
+                                     "0123456789abcdef,0123456789abcdef\n");
+    __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, FailAllocationsInCreateFromFile)
+{
+    m_pNew = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    DiskImageHashes_WriteToFile(m_pNew, g_hashesFilename);
+
+    for (unsigned int i = 1 ; i <= 6 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pOld = DiskImageHashes_CreateFromFile(g_hashesFilename) );
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pOld);
+    }
+}
+
+TEST(DiskImageHashes, FailOpenInWriteToFile)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    fopenFail(NULL);
+    __try_and_catch( DiskImageHashes_WriteToFile(m_pOld, g_hashesFilename) );
+    validateExceptionThrown(fileOpenException);
+}
+
+TEST(DiskImageHashes, FailWriteInWriteToFile)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    fwriteFail(0);
+    __try_and_catch( DiskImageHashes_WriteToFile(m_pOld, g_hashesFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageHashes, HashRegionSizesForEachImageType)
+{
+    m_pDiskImage = (DiskImage*)NibbleDiskImage_Create();
+    LONGS_EQUAL(NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK, DiskImage_GetHashRegionSize(m_pDiskImage));
+    DiskImage_Free(m_pDiskImage);
+    m_pDiskImage = (DiskImage*)WozDiskImage_Create();
+    LONGS_EQUAL(NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK, DiskImage_GetHashRegionSize(m_pDiskImage));
+    DiskImage_Free(m_pDiskImage);
+    m_pDiskImage = (DiskImage*)SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    LONGS_EQUAL(4096, DiskImage_GetHashRegionSize(m_pDiskImage));
+    DiskImage_Free(m_pDiskImage);
+    m_pDiskImage = (DiskImage*)BlockDiskImage_Create(BLOCK_DISK_IMAGE_3_5_BLOCK_COUNT);
+    LONGS_EQUAL(DISK_IMAGE_BLOCK_SIZE, DiskImage_GetHashRegionSize(m_pDiskImage));
+}
+
+TEST(DiskImageHashes, WriteHashesForDiskImage)
+{
+    m_pDiskImage = (DiskImage*)BlockDiskImage_Create(4);
+    createObjectFile(DISK_IMAGE_BLOCK_SIZE);
+    DiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,DiskImageHashesTest.bin,0,512,2" LINE_ENDING));
+    DiskImage_WriteHashes(m_pDiskImage, g_imageFilename);
+
+    m_pOld = DiskImageHashes_CreateFromFile(g_imageHashesFilename);
+    validateHashes(m_pOld, DiskImage_GetImagePointer(m_pDiskImage), 4 * DISK_IMAGE_BLOCK_SIZE, DISK_IMAGE_BLOCK_SIZE);
+}
+
+TEST(DiskImageHashes, FailAllocationsInWriteHashes)
+{
+    m_pDiskImage = (DiskImage*)BlockDiskImage_Create(4);
+    for (unsigned int i = 1 ; i <= 3 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( DiskImage_WriteHashes(m_pDiskImage, g_imageFilename) );
+        validateExceptionThrown(outOfMemoryException);
+    }
+}
+
+TEST(DiskImageHashes, PrintDiffOfIdenticalHashes)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    m_pNew = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    LONGS_EQUAL(0, DiskImageHashes_PrintDiff(m_pOld, m_pNew, NULL));
+    LONGS_EQUAL(1, printfSpy_GetCallCount());
+    STRCMP_EQUAL("0 of 4 blocks changed.\n", printfSpy_GetLastOutput());
+}
+
+TEST(DiskImageHashes, PrintDiffOfOneChangedBlock)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    m_image[2 * DISK_IMAGE_BLOCK_SIZE + 17] ^= 1;
+    m_pNew = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    LONGS_EQUAL(1, DiskImageHashes_PrintDiff(m_pOld, m_pNew, NULL));
+    STRCMP_EQUAL("block 2 changed\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("1 of 4 blocks changed.\n", printfSpy_GetLastOutput());
+}
+
+TEST(DiskImageHashes, PrintDiffOfImagesWithDifferentSizes)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    m_pNew = DiskImageHashes_Create(m_image, 3 * DISK_IMAGE_BLOCK_SIZE, DISK_IMAGE_BLOCK_SIZE);
+    LONGS_EQUAL(1, DiskImageHashes_PrintDiff(m_pOld, m_pNew, NULL));
+    STRCMP_EQUAL("block 3 changed\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("1 of 4 blocks changed.\n", printfSpy_GetLastOutput());
+}
+
+TEST(DiskImageHashes, FailPrintDiffOfDifferentRegionSizes)
+{
+    m_pOld = DiskImageHashes_Create(m_image, sizeof(m_image), DISK_IMAGE_BLOCK_SIZE);
+    m_pNew = DiskImageHashes_Create(m_image, sizeof(m_image), 2 * DISK_IMAGE_BLOCK_SIZE);
+    __try_and_catch( DiskImageHashes_PrintDiff(m_pOld, m_pNew, NULL) );
+    validateExceptionThrown(invalidArgumentException);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+}
+
+TEST(DiskImageHashes, PrintDiffOfNibbleTracksWithRWTS16AndRW18ScriptLines)
+{
+    m_pDiskImage = (DiskImage*)NibbleDiskImage_Create();
+    hashImage();
+    createObjectFile(DISK_IMAGE_BYTES_PER_SECTOR);
+    DiskImage_ProcessScript(m_pDiskImage, copy("RWTS16,DiskImageHashesTest.bin,0,256,1,0" LINE_ENDING
+                                               "RW18,DiskImageHashesTest.bin,0,256,0xa9,2,0" LINE_ENDING
+                                               "RWTS16,DiskImageHashesTest.bin,0,256,1,15" LINE_ENDING));
+    hashImage();
+
+    LONGS_EQUAL(2, DiskImageHashes_PrintDiff(m_pOld, m_pNew, m_pDiskImage));
+    LONGS_EQUAL(3, printfSpy_GetCallCount());
+    STRCMP_EQUAL("track 2 changed by script lines 2\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("2 of 35 tracks changed.\n", printfSpy_GetLastOutput());
+}
+
+TEST(DiskImageHashes, PrintDiffOfSectorImageTrackWithBlockScriptLine)
+{
+    m_pDiskImage = (DiskImage*)SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    hashImage();
+    createObjectFile(DISK_IMAGE_BLOCK_SIZE);
+    DiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,DiskImageHashesTest.bin,0,512,15" LINE_ENDING
+                                               "BLOCK,DiskImageHashesTest.bin,0,512,16" LINE_ENDING));
+    hashImage();
+
+    LONGS_EQUAL(2, DiskImageHashes_PrintDiff(m_pOld, m_pNew, m_pDiskImage));
+    LONGS_EQUAL(3, printfSpy_GetCallCount());
+    STRCMP_EQUAL("track 2 changed by script lines 2\n", printfSpy_GetPreviousOutput());
+}
+
+TEST(DiskImageHashes, PrintDiffOfBlockWrittenBySeveralScriptLines)
+{
+    m_pDiskImage = (DiskImage*)BlockDiskImage_Create(4);
+    hashImage();
+    createObjectFile(DISK_IMAGE_BLOCK_SIZE);
+    DiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,DiskImageHashesTest.bin,0,16,1,32" LINE_ENDING
+                                               "BLOCK,DiskImageHashesTest.bin,0,16,3" LINE_ENDING
+                                               "BLOCK,DiskImageHashesTest.bin,0,16,1,0" LINE_ENDING));
+    hashImage();
+
+    LONGS_EQUAL(2, DiskImageHashes_PrintDiff(m_pOld, m_pNew, m_pDiskImage));
+    LONGS_EQUAL(3, printfSpy_GetCallCount());
+    STRCMP_EQUAL("block 3 changed by script lines 2\n", printfSpy_GetPreviousOutput());
+}
+
+TEST(DiskImageHashes, GetRegionLineNumbersOfNibbleTrack)
+{
+    unsigned int lineNumbers[4];
+
+    m_pDiskImage = (DiskImage*)NibbleDiskImage_Create();
+    createObjectFile(DISK_IMAGE_BYTES_PER_SECTOR);
+    DiskImage_ProcessScript(m_pDiskImage, copy("RWTS16,DiskImageHashesTest.bin,0,256,1,0" LINE_ENDING
+                                               "RW18,DiskImageHashesTest.bin,0,256,0xa9,1,4352" LINE_ENDING
+                                               "RWTS16,DiskImageHashesTest.bin,0,256,1,15" LINE_ENDING
+                                               "RWTS16,DiskImageHashesTest.bin,0,256,2,0" LINE_ENDING));
+
+    LONGS_EQUAL(3, DiskImage_GetRegionLineNumbers(m_pDiskImage, 1, lineNumbers, 4));
+    LONGS_EQUAL(1, lineNumbers[0]);
+    LONGS_EQUAL(2, lineNumbers[1]);
+    LONGS_EQUAL(3, lineNumbers[2]);
+    LONGS_EQUAL(0, DiskImage_GetRegionLineNumbers(m_pDiskImage, 0, lineNumbers, 4));
+}
+
+TEST(DiskImageHashes, GetLowestRegionLineNumbersInAscendingOrder)
+{
+    unsigned int lineNumbers[2];
+
+    m_pDiskImage = (DiskImage*)BlockDiskImage_Create(4);
+    createObjectFile(DISK_IMAGE_BLOCK_SIZE);
+    DiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,DiskImageHashesTest.bin,0,16,1,0" LINE_ENDING
+                                               "BLOCK,DiskImageHashesTest.bin,0,16,1,48" LINE_ENDING
+                                               "BLOCK,DiskImageHashesTest.bin,0,16,1,32" LINE_ENDING
+                                               "BLOCK,DiskImageHashesTest.bin,0,16,1,16" LINE_ENDING));
+
+    LONGS_EQUAL(4, DiskImage_GetRegionLineNumbers(m_pDiskImage, 1, lineNumbers, 2));
+    LONGS_EQUAL(1, lineNumbers[0]);
+    LONGS_EQUAL(2, lineNumbers[1]);
+}
+
+TEST(DiskImageHashes, GetRegionLineNumbersBeforeScriptProcessed)
+{
+    unsigned int lineNumbers[1];
+
+    m_pDiskImage = (DiskImage*)BlockDiskImage_Create(4);
+    LONGS_EQUAL(0, DiskImage_GetRegionLineNumbers(m_pDiskImage, 1, lineNumbers, 1));
+}
+
+TEST(DiskImageHashes, PrintDiffTruncatesLongListOfScriptLines)
+{
+    char script[1024] = "";
+
+    m_pDiskImage = (DiskImage*)BlockDiskImage_Create(4);
+    hashImage();
+    createObjectFile(DISK_IMAGE_BLOCK_SIZE);
+    for (int i = 0 ; i < 9 ; i++)
+    {
+        char line[64];
+
+        snprintf(line, sizeof(line), "BLOCK,DiskImageHashesTest.bin,0,16,0,%d" LINE_ENDING, i * 16);
+        strcat(script, line);
+    }
+    DiskImage_ProcessScript(m_pDiskImage, copy(script));
+    hashImage();
+
+    LONGS_EQUAL(1, DiskImageHashes_PrintDiff(m_pOld, m_pNew, m_pDiskImage));
+    STRCMP_EQUAL("block 0 changed by script lines 1, 2, 3, 4, 5, 6, 7, 8, ...\n", printfSpy_GetPreviousOutput());
+}
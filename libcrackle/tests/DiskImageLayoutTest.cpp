@@ -0,0 +1,242 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "DiskImageLayout.h"
+    #include "MallocFailureInject.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+static unsigned int g_overlapLines[16][2];
+static size_t       g_overlapCount;
+
+static void recordOverlap(void* pContext, const DiskImageExtent* pEarlier, const DiskImageExtent* pLater)
+{
+    CHECK(g_overlapCount < sizeof(g_overlapLines) / sizeof(g_overlapLines[0]));
+    g_overlapLines[g_overlapCount][0] = pEarlier->lineNumber;
+    g_overlapLines[g_overlapCount][1] = pLater->lineNumber;
+    g_overlapCount++;
+}
+
+
+TEST_GROUP(DiskImageLayout)
+{
+    DiskImageLayout* m_pLayout;
+
+    void setup()
+    {
+        clearExceptionCode();
+        m_pLayout = DiskImageLayout_Create();
+        g_overlapCount = 0;
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        DiskImageLayout_Free(m_pLayout);
+    }
+
+    void addExtent(unsigned int domain, unsigned int start, unsigned int end, unsigned int lineNumber)
+    {
+        addGroupedExtent(domain, start, end, lineNumber, 0);
+    }
+
+    void addGroupedExtent(unsigned int domain, unsigned int start, unsigned int end, unsigned int lineNumber, unsigned int group)
+    {
+        DiskImageExtent extent;
+
+        extent.domain = domain;
+        extent.start = start;
+        extent.end = end;
+        extent.lineNumber = lineNumber;
+        extent.group = group;
+        DiskImageLayout_Add(m_pLayout, &extent);
+    }
+
+    size_t findOverlaps()
+    {
+        return DiskImageLayout_FindOverlaps(m_pLayout, recordOverlap, NULL);
+    }
+
+    void validateOverlap(size_t index, unsigned int earlierLine, unsigned int laterLine)
+    {
+        CHECK(index < g_overlapCount);
+        LONGS_EQUAL(earlierLine, g_overlapLines[index][0]);
+        LONGS_EQUAL(laterLine, g_overlapLines[index][1]);
+    }
+
+    void validateExtent(size_t index, unsigned int domain, unsigned int start, unsigned int lineNumber)
+    {
+        const DiskImageExtent* pExtent = DiskImageLayout_GetExtent(m_pLayout, index);
+
+        CHECK_TRUE(pExtent != NULL);
+        LONGS_EQUAL(domain, pExtent->domain);
+        LONGS_EQUAL(start, pExtent->start);
+        LONGS_EQUAL(lineNumber, pExtent->lineNumber);
+    }
+};
+
+TEST(DiskImageLayout, CreateEmptyLayout)
+{
+    LONGS_EQUAL(0, DiskImageLayout_GetExtentCount(m_pLayout));
+    POINTERS_EQUAL(NULL, DiskImageLayout_GetExtent(m_pLayout, 0));
+    LONGS_EQUAL(0, findOverlaps());
+}
+
+TEST(DiskImageLayout, FailAllocationInCreate)
+{
+    DiskImageLayout* pLayout = NULL;
+
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( pLayout = DiskImageLayout_Create() );
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    clearExceptionCode();
+    POINTERS_EQUAL(NULL, pLayout);
+}
+
+TEST(DiskImageLayout, FailAllocationInAdd)
+{
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( addExtent(0, 0, 512, 1) );
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    clearExceptionCode();
+    LONGS_EQUAL(0, DiskImageLayout_GetExtentCount(m_pLayout));
+}
+
+TEST(DiskImageLayout, SortByDomainThenStart)
+{
+    addExtent(1, 0, 256, 1);
+    addExtent(0, 512, 1024, 2);
+    addExtent(0, 0, 512, 3);
+    DiskImageLayout_Sort(m_pLayout);
+    validateExtent(0, 0, 0, 3);
+    validateExtent(1, 0, 512, 2);
+    validateExtent(2, 1, 0, 1);
+}
+
+TEST(DiskImageLayout, BackToBackExtentsDontOverlap)
+{
+    addExtent(0, 0, 512, 1);
+    addExtent(0, 512, 1024, 2);
+    LONGS_EQUAL(0, findOverlaps());
+}
+
+TEST(DiskImageLayout, SameRangeInDifferentDomainsDontOverlap)
+{
+    addExtent(0, 0, 512, 1);
+    addExtent(1, 0, 512, 2);
+    LONGS_EQUAL(0, findOverlaps());
+}
+
+TEST(DiskImageLayout, PartialOverlapReportsBothLines)
+{
+    addExtent(0, 0, 512, 1);
+    addExtent(0, 511, 1024, 2);
+    LONGS_EQUAL(1, findOverlaps());
+    validateOverlap(0, 1, 2);
+}
+
+TEST(DiskImageLayout, LaterLineAtLowerOffsetIsStillReportedAsLater)
+{
+    addExtent(0, 256, 768, 1);
+    addExtent(0, 0, 512, 2);
+    LONGS_EQUAL(1, findOverlaps());
+    validateOverlap(0, 1, 2);
+}
+
+TEST(DiskImageLayout, ExtentContainedWithinEarlierOneAfterUnrelatedExtentIsReported)
+{
+    addExtent(0, 0, 4096, 1);
+    addExtent(0, 512, 1024, 2);
+    addExtent(0, 2048, 2560, 3);
+    LONGS_EQUAL(2, findOverlaps());
+    validateOverlap(0, 1, 2);
+    validateOverlap(1, 1, 3);
+}
+
+TEST(DiskImageLayout, NestedExtentFollowedByThirdOverlappingExtentReportsEveryPair)
+{
+    addExtent(0, 0x400, 0x800, 1);
+    addExtent(0, 0x7F4, 0x7FE, 2);
+    addExtent(0, 0x7F0, 0x900, 3);
+    LONGS_EQUAL(3, findOverlaps());
+    validateOverlap(0, 1, 3);
+    validateOverlap(1, 1, 2);
+    validateOverlap(2, 2, 3);
+}
+
+TEST(DiskImageLayout, ExtentsInLaterDomainDontOverlapOpenExtentsOfEarlierDomain)
+{
+    addExtent(0, 0, 4096, 1);
+    addExtent(1, 0, 512, 2);
+    addExtent(1, 256, 768, 3);
+    LONGS_EQUAL(1, findOverlaps());
+    validateOverlap(0, 2, 3);
+}
+
+TEST(DiskImageLayout, OverlappingExtentsInSameGroupAreNotReported)
+{
+    addGroupedExtent(0, 0, 4096, 1, 1);
+    addGroupedExtent(0, 0, 4096, 2, 1);
+    LONGS_EQUAL(0, findOverlaps());
+}
+
+TEST(DiskImageLayout, OverlappingExtentsInDifferentGroupsAreReported)
+{
+    addGroupedExtent(0, 0, 4096, 1, 1);
+    addGroupedExtent(0, 0, 4096, 2, 2);
+    addExtent(0, 512, 768, 3);
+    LONGS_EQUAL(3, findOverlaps());
+    validateOverlap(0, 1, 2);
+    validateOverlap(1, 1, 3);
+    validateOverlap(2, 2, 3);
+}
+
+TEST(DiskImageLayout, FailSecondAllocationInAdd)
+{
+    MallocFailureInject_FailAllocation(2);
+    __try_and_catch( addExtent(0, 0, 512, 1) );
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    clearExceptionCode();
+    LONGS_EQUAL(0, DiskImageLayout_GetExtentCount(m_pLayout));
+    MallocFailureInject_Restore();
+    addExtent(0, 0, 512, 1);
+    addExtent(0, 0, 512, 2);
+    LONGS_EQUAL(1, findOverlaps());
+}
+
+TEST(DiskImageLayout, ClearRemovesAllExtents)
+{
+    addExtent(0, 0, 512, 1);
+    addExtent(0, 0, 512, 2);
+    DiskImageLayout_Clear(m_pLayout);
+    LONGS_EQUAL(0, DiskImageLayout_GetExtentCount(m_pLayout));
+    LONGS_EQUAL(0, findOverlaps());
+}
+
+TEST(DiskImageLayout, AddEnoughExtentsToGrowArrayWithoutOverlaps)
+{
+    for (unsigned int i = 0 ; i < 100 ; i++)
+        addExtent(0, (99 - i) * 512, (100 - i) * 512, i + 1);
+    LONGS_EQUAL(100, DiskImageLayout_GetExtentCount(m_pLayout));
+    LONGS_EQUAL(0, findOverlaps());
+    validateExtent(0, 0, 0, 100);
+    validateExtent(99, 0, 99 * 512, 1);
+}
@@ -0,0 +1,231 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "DiskImageManifest.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_manifestFilename = "DiskImageManifestTest.manifest";
+
+
+TEST_GROUP(DiskImageManifest)
+{
+    DiskImageManifest* m_pManifest;
+    DiskImageManifest* m_pManifestFromFile;
+
+    void setup()
+    {
+        clearExceptionCode();
+        m_pManifest = NULL;
+        m_pManifestFromFile = NULL;
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        fopenRestore();
+        fwriteRestore();
+        DiskImageManifest_Free(m_pManifest);
+        DiskImageManifest_Free(m_pManifestFromFile);
+        remove(g_manifestFilename);
+    }
+
+    void appendEntry(uint64_t destinationHash, uint64_t contentHash)
+    {
+        DiskImageManifestEntry entry;
+
+        entry.destinationHash = destinationHash;
+        entry.contentHash = contentHash;
+        DiskImageManifest_Append(m_pManifest, &entry);
+    }
+
+    void validateEntry(DiskImageManifest* pManifest, size_t index, uint64_t destinationHash, uint64_t contentHash)
+    {
+        const DiskImageManifestEntry* pEntry = DiskImageManifest_GetEntry(pManifest, index);
+
+        CHECK_TRUE(pEntry != NULL);
+        CHECK_TRUE(destinationHash == pEntry->destinationHash);
+        CHECK_TRUE(contentHash == pEntry->contentHash);
+    }
+
+    void createTextFile(const char* pFilename, const char* pText)
+    {
+        FILE* pFile = fopen(pFilename, "wb");
+        fwrite(pText, 1, strlen(pText), pFile);
+        fclose(pFile);
+    }
+
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(DiskImageManifest, CreateEmptyManifest)
+{
+    m_pManifest = DiskImageManifest_Create();
+    CHECK_TRUE(m_pManifest != NULL);
+    LONGS_EQUAL(0, DiskImageManifest_GetEntryCount(m_pManifest));
+    POINTERS_EQUAL(NULL, DiskImageManifest_GetEntry(m_pManifest, 0));
+}
+
+TEST(DiskImageManifest, FailAllocationInCreate)
+{
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( m_pManifest = DiskImageManifest_Create() );
+    validateExceptionThrown(outOfMemoryException);
+    POINTERS_EQUAL(NULL, m_pManifest);
+}
+
+TEST(DiskImageManifest, AppendTwoEntries)
+{
+    m_pManifest = DiskImageManifest_Create();
+    appendEntry(0x0123456789abcdefULL, 0xfedcba9876543210ULL);
+    appendEntry(1, 2);
+    LONGS_EQUAL(2, DiskImageManifest_GetEntryCount(m_pManifest));
+    validateEntry(m_pManifest, 0, 0x0123456789abcdefULL, 0xfedcba9876543210ULL);
+    validateEntry(m_pManifest, 1, 1, 2);
+    POINTERS_EQUAL(NULL, DiskImageManifest_GetEntry(m_pManifest, 2));
+}
+
+TEST(DiskImageManifest, AppendEnoughEntriesToGrowArray)
+{
+    m_pManifest = DiskImageManifest_Create();
+    for (uint64_t i = 0 ; i < 100 ; i++)
+        appendEntry(i, i * 2);
+    LONGS_EQUAL(100, DiskImageManifest_GetEntryCount(m_pManifest));
+    validateEntry(m_pManifest, 0, 0, 0);
+    validateEntry(m_pManifest, 99, 99, 198);
+}
+
+TEST(DiskImageManifest, FailAllocationInAppend)
+{
+    m_pManifest = DiskImageManifest_Create();
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( appendEntry(1, 2) );
+    validateExceptionThrown(outOfMemoryException);
+    LONGS_EQUAL(0, DiskImageManifest_GetEntryCount(m_pManifest));
+}
+
+TEST(DiskImageManifest, WriteAndReadBackManifest)
+{
+    m_pManifest = DiskImageManifest_Create();
+    appendEntry(0x0123456789abcdefULL, 0xfedcba9876543210ULL);
+    appendEntry(0xffffffffffffffffULL, 0);
+    DiskImageManifest_WriteToFile(m_pManifest, g_manifestFilename);
+
+    m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename);
+    LONGS_EQUAL(2, DiskImageManifest_GetEntryCount(m_pManifestFromFile));
+    validateEntry(m_pManifestFromFile, 0, 0x0123456789abcdefULL, 0xfedcba9876543210ULL);
+    validateEntry(m_pManifestFromFile, 1, 0xffffffffffffffffULL, 0);
+}
+
+TEST(DiskImageManifest, WriteAndReadBackEmptyManifest)
+{
+    m_pManifest = DiskImageManifest_Create();
+    DiskImageManifest_WriteToFile(m_pManifest, g_manifestFilename);
+
+    m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename);
+    LONGS_EQUAL(0, DiskImageManifest_GetEntryCount(m_pManifestFromFile));
+}
+
+TEST(DiskImageManifest, ReadManifestWithUpperCaseHexDigits)
+{
+    createTextFile(g_manifestFilename, "# crackle manifest v1\n"
+                                       "0123456789ABCDEF,FEDCBA9876543210\n");
+    m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename);
+    LONGS_EQUAL(1, DiskImageManifest_GetEntryCount(m_pManifestFromFile));
+    validateEntry(m_pManifestFromFile, 0, 0x0123456789abcdefULL, 0xfedcba9876543210ULL);
+}
+
+TEST(DiskImageManifest, FailToReadNonExistentManifest)
+{
+    __try_and_catch( m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename) );
+    validateExceptionThrown(fileOpenException);
+    POINTERS_EQUAL(NULL, m_pManifestFromFile);
+}
+
+TEST(DiskImageManifest, FailToReadManifestWithInvalidHeader)
+{
+    createTextFile(g_manifestFilename, "# crackle manifest v2\n"
+                                       "0123456789abcdef,fedcba9876543210\n");
+    __try_and_catch( m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageManifest, FailToReadManifestWithTooFewFields)
+{
+    createTextFile(g_manifestFilename, "# crackle manifest v1\n"
+                                       "0123456789abcdef\n");
+    __try_and_catch( m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageManifest, FailToReadManifestWithShortHashField)
+{
+    createTextFile(g_manifestFilename, "# crackle manifest v1\n"
+                                       "0123456789abcde,fedcba9876543210\n");
+    __try_and_catch( m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageManifest, FailToReadManifestWithInvalidHexDigit)
+{
+    createTextFile(g_manifestFilename, "# crackle manifest v1\n"
+                                       "0123456789abcdef,fedcba987654321g\n");
+    __try_and_catch( m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImageManifest, FailAllocationInCreateFromFile)
+{
+    m_pManifest = DiskImageManifest_Create();
+    appendEntry(1, 2);
+    DiskImageManifest_WriteToFile(m_pManifest, g_manifestFilename);
+
+    for (unsigned int i = 1 ; i <= 4 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pManifestFromFile = DiskImageManifest_CreateFromFile(g_manifestFilename) );
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pManifestFromFile);
+    }
+}
+
+TEST(DiskImageManifest, FailOpenInWriteToFile)
+{
+    m_pManifest = DiskImageManifest_Create();
+    fopenFail(NULL);
+    __try_and_catch( DiskImageManifest_WriteToFile(m_pManifest, g_manifestFilename) );
+    validateExceptionThrown(fileOpenException);
+}
+
+TEST(DiskImageManifest, FailWriteInWriteToFile)
+{
+    m_pManifest = DiskImageManifest_Create();
+    appendEntry(1, 2);
+    fwriteFail(0);
+    __try_and_catch( DiskImageManifest_WriteToFile(m_pManifest, g_manifestFilename) );
+    validateExceptionThrown(fileException);
+}
@@ -0,0 +1,320 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "DiskImagePlan.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char*    g_planFilename = "DiskImagePlanTest.plan";
+static const uint64_t g_scriptHash = 0x0123456789abcdefULL;
+
+
+TEST_GROUP(DiskImagePlan)
+{
+    DiskImagePlan* m_pPlan;
+    DiskImagePlan* m_pPlanFromFile;
+
+    void setup()
+    {
+        clearExceptionCode();
+        m_pPlan = NULL;
+        m_pPlanFromFile = NULL;
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        fopenRestore();
+        fwriteRestore();
+        DiskImagePlan_Free(m_pPlan);
+        DiskImagePlan_Free(m_pPlanFromFile);
+        remove(g_planFilename);
+    }
+
+    unsigned int addObjectFilename(const char* pFilename)
+    {
+        SizedString filename = SizedString_InitFromString(pFilename);
+        return DiskImagePlan_AddObjectFilename(m_pPlan, &filename);
+    }
+
+    void appendBlockEntry(unsigned int lineNumber, const char* pFilename, unsigned int block)
+    {
+        DiskImagePlanEntry entry;
+
+        memset(&entry, 0, sizeof(entry));
+        entry.insert.type = DISK_IMAGE_INSERTION_BLOCK;
+        entry.insert.length = 512;
+        entry.insert.block = block;
+        entry.lineNumber = lineNumber;
+        entry.objectFilenameOffset = pFilename ? addObjectFilename(pFilename) : DISK_IMAGE_PLAN_NO_OBJECT;
+        DiskImagePlan_Append(m_pPlan, &entry);
+    }
+
+    void validateBlockEntry(DiskImagePlan* pPlan, size_t index, unsigned int lineNumber, 
+                            const char* pFilename, unsigned int block)
+    {
+        const DiskImagePlanEntry* pEntry = DiskImagePlan_GetEntry(pPlan, index);
+
+        CHECK_TRUE(pEntry != NULL);
+        LONGS_EQUAL(DISK_IMAGE_INSERTION_BLOCK, pEntry->insert.type);
+        LONGS_EQUAL(512, pEntry->insert.length);
+        LONGS_EQUAL(block, pEntry->insert.block);
+        LONGS_EQUAL(lineNumber, pEntry->lineNumber);
+        if (pFilename)
+        {
+            STRCMP_EQUAL(pFilename, DiskImagePlan_GetObjectFilename(pPlan, pEntry));
+        }
+        else
+        {
+            POINTERS_EQUAL(NULL, DiskImagePlan_GetObjectFilename(pPlan, pEntry));
+        }
+    }
+
+    void writeTwoEntryPlan()
+    {
+        m_pPlan = DiskImagePlan_Create();
+        appendBlockEntry(1, "object.sav", 0);
+        appendBlockEntry(3, "object.sav", 1);
+        DiskImagePlan_WriteToFile(m_pPlan, g_planFilename, g_scriptHash);
+    }
+
+    long getPlanFileSize()
+    {
+        FILE* pFile = fopen(g_planFilename, "rb");
+        fseek(pFile, 0, SEEK_END);
+        long size = ftell(pFile);
+        fclose(pFile);
+        return size;
+    }
+
+    void truncatePlanFile(long newSize)
+    {
+        char* pBuffer = (char*)malloc(newSize);
+        FILE* pFile = fopen(g_planFilename, "rb");
+        LONGS_EQUAL(newSize, fread(pBuffer, 1, newSize, pFile));
+        fclose(pFile);
+        pFile = fopen(g_planFilename, "wb");
+        fwrite(pBuffer, 1, newSize, pFile);
+        fclose(pFile);
+        free(pBuffer);
+    }
+
+    void overwritePlanFileByte(long offset, char value)
+    {
+        FILE* pFile = fopen(g_planFilename, "r+b");
+        fseek(pFile, offset, SEEK_SET);
+        fwrite(&value, 1, 1, pFile);
+        fclose(pFile);
+    }
+
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(DiskImagePlan, CreateEmptyPlan)
+{
+    m_pPlan = DiskImagePlan_Create();
+    CHECK_TRUE(m_pPlan != NULL);
+    LONGS_EQUAL(0, DiskImagePlan_GetEntryCount(m_pPlan));
+    POINTERS_EQUAL(NULL, DiskImagePlan_GetEntry(m_pPlan, 0));
+}
+
+TEST(DiskImagePlan, FailAllocationInCreate)
+{
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( m_pPlan = DiskImagePlan_Create() );
+    validateExceptionThrown(outOfMemoryException);
+    POINTERS_EQUAL(NULL, m_pPlan);
+}
+
+TEST(DiskImagePlan, AppendEntriesWithAndWithoutObjectFiles)
+{
+    m_pPlan = DiskImagePlan_Create();
+    appendBlockEntry(1, "first.sav", 0);
+    appendBlockEntry(2, NULL, 1);
+    appendBlockEntry(4, "second.sav", 2);
+    LONGS_EQUAL(3, DiskImagePlan_GetEntryCount(m_pPlan));
+    validateBlockEntry(m_pPlan, 0, 1, "first.sav", 0);
+    validateBlockEntry(m_pPlan, 1, 2, NULL, 1);
+    validateBlockEntry(m_pPlan, 2, 4, "second.sav", 2);
+    POINTERS_EQUAL(NULL, DiskImagePlan_GetEntry(m_pPlan, 3));
+}
+
+TEST(DiskImagePlan, AddSameObjectFilenameTwiceReturnsSameOffset)
+{
+    m_pPlan = DiskImagePlan_Create();
+    unsigned int first = addObjectFilename("first.sav");
+    unsigned int second = addObjectFilename("second.sav");
+    LONGS_EQUAL(first, addObjectFilename("first.sav"));
+    LONGS_EQUAL(second, addObjectFilename("second.sav"));
+    CHECK_TRUE(first != second);
+}
+
+TEST(DiskImagePlan, AppendEnoughEntriesAndFilenamesToGrowArrays)
+{
+    char filename[32];
+
+    m_pPlan = DiskImagePlan_Create();
+    for (unsigned int i = 0 ; i < 100 ; i++)
+    {
+        sprintf(filename, "object%03u.sav", i);
+        appendBlockEntry(i + 1, filename, i);
+    }
+    LONGS_EQUAL(100, DiskImagePlan_GetEntryCount(m_pPlan));
+    validateBlockEntry(m_pPlan, 0, 1, "object000.sav", 0);
+    validateBlockEntry(m_pPlan, 99, 100, "object099.sav", 99);
+}
+
+TEST(DiskImagePlan, FailAllocationInAppend)
+{
+    m_pPlan = DiskImagePlan_Create();
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( appendBlockEntry(1, NULL, 0) );
+    validateExceptionThrown(outOfMemoryException);
+    LONGS_EQUAL(0, DiskImagePlan_GetEntryCount(m_pPlan));
+}
+
+TEST(DiskImagePlan, FailAllocationInAddObjectFilename)
+{
+    m_pPlan = DiskImagePlan_Create();
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( addObjectFilename("object.sav") );
+    validateExceptionThrown(outOfMemoryException);
+}
+
+TEST(DiskImagePlan, WriteAndReadBackPlan)
+{
+    writeTwoEntryPlan();
+
+    m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash);
+    LONGS_EQUAL(2, DiskImagePlan_GetEntryCount(m_pPlanFromFile));
+    validateBlockEntry(m_pPlanFromFile, 0, 1, "object.sav", 0);
+    validateBlockEntry(m_pPlanFromFile, 1, 3, "object.sav", 1);
+}
+
+TEST(DiskImagePlan, WriteAndReadBackEmptyPlan)
+{
+    m_pPlan = DiskImagePlan_Create();
+    DiskImagePlan_WriteToFile(m_pPlan, g_planFilename, g_scriptHash);
+
+    m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash);
+    LONGS_EQUAL(0, DiskImagePlan_GetEntryCount(m_pPlanFromFile));
+}
+
+TEST(DiskImagePlan, FailToReadNonExistentPlan)
+{
+    __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileOpenException);
+    POINTERS_EQUAL(NULL, m_pPlanFromFile);
+}
+
+TEST(DiskImagePlan, FailToReadPlanWithDifferentScriptHash)
+{
+    writeTwoEntryPlan();
+    __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash + 1) );
+    validateExceptionThrown(fileException);
+    POINTERS_EQUAL(NULL, m_pPlanFromFile);
+}
+
+TEST(DiskImagePlan, FailToReadPlanWithInvalidSignature)
+{
+    writeTwoEntryPlan();
+    overwritePlanFileByte(0, 'X');
+    __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImagePlan, FailToReadTruncatedHeader)
+{
+    writeTwoEntryPlan();
+    truncatePlanFile(8);
+    __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImagePlan, FailToReadTruncatedStringTable)
+{
+    writeTwoEntryPlan();
+    truncatePlanFile(getPlanFileSize() - 1);
+    __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImagePlan, FailToReadPlanWithUnterminatedStringTable)
+{
+    writeTwoEntryPlan();
+    overwritePlanFileByte(getPlanFileSize() - 1, 'X');
+    __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImagePlan, FailToReadPlanWithOutOfRangeObjectFilenameOffset)
+{
+    static const char  objectFilename[] = "object.sav";
+    DiskImagePlanEntry entry;
+
+    writeTwoEntryPlan();
+    FILE* pFile = fopen(g_planFilename, "r+b");
+    fseek(pFile, -(long)(sizeof(entry) + sizeof(objectFilename)), SEEK_END);
+    LONGS_EQUAL(sizeof(entry), fread(&entry, 1, sizeof(entry), pFile));
+    entry.objectFilenameOffset = sizeof(objectFilename);
+    fseek(pFile, -(long)(sizeof(entry) + sizeof(objectFilename)), SEEK_END);
+    LONGS_EQUAL(sizeof(entry), fwrite(&entry, 1, sizeof(entry), pFile));
+    fclose(pFile);
+
+    __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(DiskImagePlan, FailAllocationsInCreateFromFile)
+{
+    writeTwoEntryPlan();
+
+    for (unsigned int i = 1 ; i <= 3 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pPlanFromFile = DiskImagePlan_CreateFromFile(g_planFilename, g_scriptHash) );
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pPlanFromFile);
+    }
+}
+
+TEST(DiskImagePlan, FailOpenInWriteToFile)
+{
+    m_pPlan = DiskImagePlan_Create();
+    fopenFail(NULL);
+    __try_and_catch( DiskImagePlan_WriteToFile(m_pPlan, g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileOpenException);
+}
+
+TEST(DiskImagePlan, FailWriteInWriteToFile)
+{
+    m_pPlan = DiskImagePlan_Create();
+    appendBlockEntry(1, "object.sav", 0);
+    fwriteFail(0);
+    __try_and_catch( DiskImagePlan_WriteToFile(m_pPlan, g_planFilename, g_scriptHash) );
+    validateExceptionThrown(fileException);
+}
@@ -0,0 +1,264 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "LzCompressor.h"
+    #include "MallocFailureInject.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+TEST_GROUP(LzCompressor)
+{
+    unsigned char* m_pSrc;
+    unsigned char* m_pCompressed;
+    unsigned char* m_pDecompressed;
+    size_t         m_srcSize;
+    size_t         m_compressedSize;
+
+    void setup()
+    {
+        clearExceptionCode();
+        m_pSrc = NULL;
+        m_pCompressed = NULL;
+        m_pDecompressed = NULL;
+        m_srcSize = 0;
+        m_compressedSize = 0;
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        free(m_pSrc);
+        free(m_pCompressed);
+        free(m_pDecompressed);
+    }
+
+    void allocateSource(size_t size)
+    {
+        m_srcSize = size;
+        m_pSrc = (unsigned char*)calloc(1, size + 1);
+        m_pCompressed = (unsigned char*)calloc(1, LZ_COMPRESSOR_BOUND(size));
+        m_pDecompressed = (unsigned char*)calloc(1, size + 1);
+    }
+
+    void fillWithRandomBytes(size_t start, size_t end, unsigned int seed)
+    {
+        for (size_t i = start ; i < end ; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            m_pSrc[i] = (unsigned char)(seed >> 16);
+        }
+    }
+
+    void compress()
+    {
+        m_compressedSize = LzCompressor_Compress(m_pCompressed, LZ_COMPRESSOR_BOUND(m_srcSize), m_pSrc, m_srcSize);
+        CHECK_TRUE(m_compressedSize <= LZ_COMPRESSOR_BOUND(m_srcSize));
+    }
+
+    void validateRoundTrip()
+    {
+        compress();
+        LONGS_EQUAL(m_srcSize, LzCompressor_Decompress(m_pDecompressed, m_srcSize, m_pCompressed, m_compressedSize));
+        CHECK_TRUE(0 == memcmp(m_pSrc, m_pDecompressed, m_srcSize));
+    }
+
+    void validateCompressed(const unsigned char* pExpected, size_t expectedSize)
+    {
+        LONGS_EQUAL(expectedSize, m_compressedSize);
+        CHECK_TRUE(0 == memcmp(pExpected, m_pCompressed, expectedSize));
+    }
+
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(LzCompressor, CompressEmptyInputToJustEndOfStream)
+{
+    static const unsigned char expected[] = { 0x00 };
+
+    allocateSource(0);
+    validateRoundTrip();
+    validateCompressed(expected, sizeof(expected));
+}
+
+TEST(LzCompressor, CompressShortInputToLiteralRun)
+{
+    static const unsigned char expected[] = { 0x02, 'a', 'b', 0x00 };
+
+    allocateSource(2);
+    memcpy(m_pSrc, "ab", 2);
+    validateRoundTrip();
+    validateCompressed(expected, sizeof(expected));
+}
+
+TEST(LzCompressor, CompressRunOfRepeatedByteToOverlappingMatch)
+{
+    static const unsigned char expected[] = { 0x01, 'A', 0x80 | (99 - 3), 0x01, 0x00, 0x00 };
+
+    allocateSource(100);
+    memset(m_pSrc, 'A', 100);
+    validateRoundTrip();
+    validateCompressed(expected, sizeof(expected));
+}
+
+TEST(LzCompressor, CompressRepeatedStringToMatchWithDistance)
+{
+    static const unsigned char expected[] = { 0x06, 'a', 'b', 'c', 'd', 'e', 'f', 0x80 | (6 - 3), 0x06, 0x00, 0x00 };
+
+    allocateSource(12);
+    memcpy(m_pSrc, "abcdefabcdef", 12);
+    validateRoundTrip();
+    validateCompressed(expected, sizeof(expected));
+}
+
+TEST(LzCompressor, PreferLongerMatchAtNextByte)
+{
+    static const unsigned char expected[] = { 0x09, 'a', 'b', 'c', 'x', 'b', 'c', 'd', 'e', 'a', 
+                                              0x80 | (4 - 3), 0x05, 0x00, 0x00 };
+
+    allocateSource(13);
+    memcpy(m_pSrc, "abcxbcdeabcde", 13);
+    validateRoundTrip();
+    validateCompressed(expected, sizeof(expected));
+}
+
+TEST(LzCompressor, KeepShortMatchInLiteralRunToAvoidExpansion)
+{
+    static const unsigned char expected[] = { 0x07, 'a', 'b', 'c', 'x', 'a', 'b', 'c', 0x00 };
+
+    allocateSource(7);
+    memcpy(m_pSrc, "abcxabc", 7);
+    validateRoundTrip();
+    validateCompressed(expected, sizeof(expected));
+}
+
+TEST(LzCompressor, SplitLongLiteralRuns)
+{
+    allocateSource(200);
+    for (size_t i = 0 ; i < m_srcSize ; i++)
+        m_pSrc[i] = (unsigned char)i;
+    validateRoundTrip();
+    LONGS_EQUAL(LZ_COMPRESSOR_BOUND(200), m_compressedSize);
+    LONGS_EQUAL(127, m_pCompressed[0]);
+    LONGS_EQUAL(73, m_pCompressed[128]);
+}
+
+TEST(LzCompressor, SplitLongMatches)
+{
+    static const unsigned char expected[] = { 0x01, 0x00, 
+                                              0xff, 0x01, 0x00, 
+                                              0xff, 0x01, 0x00, 
+                                              0x80 | (39 - 3), 0x01, 0x00, 
+                                              0x00 };
+
+    allocateSource(300);
+    validateRoundTrip();
+    validateCompressed(expected, sizeof(expected));
+}
+
+TEST(LzCompressor, RoundTripIncompressibleData)
+{
+    allocateSource(5000);
+    fillWithRandomBytes(0, m_srcSize, 1);
+    validateRoundTrip();
+}
+
+TEST(LzCompressor, RoundTripRepetitiveData)
+{
+    allocateSource(16384);
+    for (size_t i = 0 ; i < m_srcSize ; i++)
+        m_pSrc[i] = (unsigned char)((i % 40) < 20 ? i % 7 : (i / 40) % 13);
+    validateRoundTrip();
+    CHECK_TRUE(m_compressedSize < m_srcSize / 8);
+}
+
+TEST(LzCompressor, DontMatchFurtherBackThanMaxDistance)
+{
+    allocateSource(LZ_COMPRESSOR_MAX_DISTANCE + 2000);
+    fillWithRandomBytes(0, m_srcSize, 2);
+    memcpy(m_pSrc + LZ_COMPRESSOR_MAX_DISTANCE + 1000, m_pSrc, 1000);
+    validateRoundTrip();
+}
+
+TEST(LzCompressor, FailCompressWhenDestinationTooSmall)
+{
+    allocateSource(200);
+    for (size_t i = 0 ; i < m_srcSize ; i++)
+        m_pSrc[i] = (unsigned char)i;
+    __try_and_catch( LzCompressor_Compress(m_pCompressed, 100, m_pSrc, m_srcSize) );
+    validateExceptionThrown(bufferOverrunException);
+    __try_and_catch( LzCompressor_Compress(m_pCompressed, LZ_COMPRESSOR_BOUND(200) - 1, m_pSrc, m_srcSize) );
+    validateExceptionThrown(bufferOverrunException);
+}
+
+TEST(LzCompressor, FailAllocationsInCompress)
+{
+    allocateSource(100);
+    for (unsigned int i = 1 ; i <= 2 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( compress() );
+        validateExceptionThrown(outOfMemoryException);
+    }
+}
+
+TEST(LzCompressor, FailDecompressOfTruncatedStream)
+{
+    static const unsigned char compressed[] = { 0x02, 'a', 'b' };
+    unsigned char              dest[4];
+
+    __try_and_catch( LzCompressor_Decompress(dest, sizeof(dest), compressed, sizeof(compressed)) );
+    validateExceptionThrown(invalidArgumentException);
+}
+
+TEST(LzCompressor, FailDecompressOfTruncatedLiteralRun)
+{
+    static const unsigned char compressed[] = { 0x03, 'a', 'b' };
+    unsigned char              dest[4];
+
+    __try_and_catch( LzCompressor_Decompress(dest, sizeof(dest), compressed, sizeof(compressed)) );
+    validateExceptionThrown(invalidArgumentException);
+}
+
+TEST(LzCompressor, FailDecompressOfMatchBeforeStartOfOutput)
+{
+    static const unsigned char compressed[] = { 0x01, 'a', 0x80, 0x02, 0x00, 0x00 };
+    unsigned char              dest[8];
+
+    __try_and_catch( LzCompressor_Decompress(dest, sizeof(dest), compressed, sizeof(compressed)) );
+    validateExceptionThrown(invalidArgumentException);
+}
+
+TEST(LzCompressor, FailDecompressWhenDestinationTooSmall)
+{
+    static const unsigned char literals[] = { 0x02, 'a', 'b', 0x00 };
+    static const unsigned char match[] = { 0x01, 'a', 0x80, 0x01, 0x00, 0x00 };
+    unsigned char              dest[3];
+
+    __try_and_catch( LzCompressor_Decompress(dest, 1, literals, sizeof(literals)) );
+    validateExceptionThrown(bufferOverrunException);
+    __try_and_catch( LzCompressor_Decompress(dest, 3, match, sizeof(match)) );
+    validateExceptionThrown(bufferOverrunException);
+}
@@ -20,6 +20,7 @@ extern "C"
     #include "MallocFailureInject.h"
     #include "FileFailureInject.h"
     #include "printfSpy.h"
+    #include "TraceLog.h"
     #include "util.h"
 }
 
@@ -30,6 +31,8 @@ static const char* g_imageFilename = "NibbleDiskImageTest.nib";
 static const char* g_savFilenameAllZeroes = "NibbleDiskImageTestAllZeroes.sav";
 static const char* g_savFilenameAllOnes = "NibbleDiskImageAllOnes.sav";
 static const char* g_scriptFilename = "NibbleDiskImageTest.script";
+static const char* g_planFilename = "NibbleDiskImageTest.script.plan";
+static const char* g_manifestFilename = "NibbleDiskImageTest.nib.manifest";
 
 
 TEST_GROUP(NibbleDiskImage)
@@ -64,6 +67,8 @@ TEST_GROUP(NibbleDiskImage)
         remove(g_savFilenameAllZeroes);
         remove(g_savFilenameAllOnes);
         remove(g_scriptFilename);
+        remove(g_planFilename);
+        remove(g_manifestFilename);
     }
     
     char* copy(const char* pStringToCopy)
@@ -113,14 +118,33 @@ TEST_GROUP(NibbleDiskImage)
                                              const unsigned char* pExpectedContent, 
                                              unsigned int         track, 
                                              unsigned int         sector)
+    {
+        validateRWTS16PhysicalSectorContainsNibbles(pImage, pExpectedContent, track, sector, sector);
+    }
+    
+    void validateRWTS16PhysicalSectorContainsZeroData(const unsigned char* pImage, 
+                                                      unsigned int         track, 
+                                                      unsigned int         sector,
+                                                      unsigned int         physicalSector)
+    {
+        unsigned char expectedEncodedData[343];
+        memset(expectedEncodedData, 0x96, sizeof(expectedEncodedData));
+        validateRWTS16PhysicalSectorContainsNibbles(pImage, expectedEncodedData, track, sector, physicalSector);
+    }
+    
+    void validateRWTS16PhysicalSectorContainsNibbles(const unsigned char* pImage,
+                                                     const unsigned char* pExpectedContent, 
+                                                     unsigned int         track, 
+                                                     unsigned int         sector,
+                                                     unsigned int         physicalSector)
     {
         static const unsigned char volume = 0;
         unsigned int               sourceOffset = NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * track +
                                                   NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES +
-                                                  NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR * sector;
+                                                  NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR * physicalSector;
         unsigned int               leadInSyncCount = NIBBLE_DISK_IMAGE_RWTS16_GAP3_SYNC_BYTES;
         
-        if (sector == 0)
+        if (physicalSector == 0)
             leadInSyncCount = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES;
         
         m_pCurr = pImage + sourceOffset - leadInSyncCount;
@@ -428,6 +452,48 @@ TEST(NibbleDiskImage, FailToInsertSecondSectorAsRWTS16)
     validateExceptionThrown(invalidTrackException);
 }
 
+TEST(NibbleDiskImage, TraceSpanForEachRWTS16TrackEncoded)
+{
+    static const char  traceFilename[] = "NibbleDiskImageTest.json";
+    static const char* expectedNames[] =
+    {
+        "\"RWTS16 track 0\"",
+        "\"RWTS16 track 1\"",
+        "\"RWTS16 track 34\"",
+        "\"RWTS16 track 35\"",
+        "\"marker\""
+    };
+    char        trace[2048];
+    const char* pCurr = trace;
+    size_t      i;
+    
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    TraceLog_Start();
+    writeZeroRWTS16Sectors(0, 15, 2);
+    writeZeroRWTS16Sectors(34, 15, 2);
+    validateExceptionThrown(invalidTrackException);
+    /* The span of the track which failed to encode should be closed before this one starts. */
+    TraceLog_Begin("test", "marker");
+    TraceLog_End();
+    TraceLog_WriteToFile(traceFilename);
+    TraceLog_Free();
+    m_pFile = fopen(traceFilename, "rb");
+    CHECK(m_pFile != NULL);
+    trace[fread(trace, 1, sizeof(trace) - 1, m_pFile)] = '\0';
+    fclose(m_pFile);
+    m_pFile = NULL;
+    remove(traceFilename);
+    
+    for (i = 0 ; i < ARRAYSIZE(expectedNames) ; i++)
+    {
+        pCurr = strstr(pCurr, expectedNames[i]);
+        CHECK_TRUE(pCurr != NULL);
+    }
+    pCurr = strstr(pCurr, "{\"ph\":\"E\"");
+    CHECK_TRUE(pCurr != NULL);
+    CHECK_TRUE(NULL == strstr(pCurr + 1, "{"));
+}
+
 TEST(NibbleDiskImage, FailToInsertTooSmallSectorAsRWTS16)
 {
     m_pNibbleDiskImage = NibbleDiskImage_Create();
@@ -643,6 +709,138 @@ TEST(NibbleDiskImage, FailOnEncodedTrackByteForReadRW18Track)
     validateExceptionThrown(badTrackException);
 }
 
+TEST(NibbleDiskImage, ReadBackRWTS16SectorsWithEveryByteValue)
+{
+    unsigned char sectorData[2 * DISK_IMAGE_BYTES_PER_SECTOR];
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+    DiskImageInsert insert;
+
+    for (size_t i = 0 ; i < sizeof(sectorData) ; i++)
+        sectorData[i] = (unsigned char)(i * 7 + (i >> 8));
+    insert.type = DISK_IMAGE_INSERTION_RWTS16;
+    insert.sourceOffset = 0;
+    insert.length = sizeof(sectorData);
+    insert.track = 34;
+    insert.sector = 14;
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    NibbleDiskImage_InsertData(m_pNibbleDiskImage, sectorData, &insert);
+
+    LONGS_EQUAL(0, NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 34, 14, readBuffer, sizeof(readBuffer)));
+    CHECK(0 == memcmp(sectorData, readBuffer, sizeof(readBuffer)));
+    LONGS_EQUAL(0, NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 34, 15, readBuffer, sizeof(readBuffer)));
+    CHECK(0 == memcmp(sectorData + DISK_IMAGE_BYTES_PER_SECTOR, readBuffer, sizeof(readBuffer)));
+}
+
+TEST(NibbleDiskImage, ReadBackRWTS16SectorWrittenWithSkew)
+{
+    unsigned char physicalSectors[NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK];
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 2);
+    NibbleDiskImage_SetRWTS16Interleave(m_pNibbleDiskImage, physicalSectors);
+    writeZeroRWTS16Sectors(1, 3, 1);
+    LONGS_EQUAL(0, NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 1, 3, readBuffer, sizeof(readBuffer)));
+    validateAllZeroes(readBuffer, sizeof(readBuffer));
+}
+
+TEST(NibbleDiskImage, ReadRWTS16CPSector)
+{
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+    DiskImageInsert insert;
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    insert.type = DISK_IMAGE_INSERTION_RWTS16CP;
+    insert.sourceOffset = 0;
+    insert.length = 0;
+    insert.track = 2;
+    insert.sector = 5;
+    NibbleDiskImage_InsertData(m_pNibbleDiskImage, NULL, &insert);
+
+    memset(readBuffer, 0xA5, sizeof(readBuffer));
+    LONGS_EQUAL(1, NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 2, 5, readBuffer, sizeof(readBuffer)));
+    validateAllZeroes(readBuffer, sizeof(readBuffer));
+}
+
+TEST(NibbleDiskImage, FailOnMissingSectorForReadRWTS16Sector)
+{
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    writeZeroRWTS16Sectors(0, 0, 1);
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 0, 1, readBuffer, sizeof(readBuffer)) );
+    validateExceptionThrown(sectorNotFoundException);
+}
+
+TEST(NibbleDiskImage, FailOnInvalidArgumentsForReadRWTS16Sector)
+{
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR + 1];
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 35, 0, readBuffer, DISK_IMAGE_BYTES_PER_SECTOR) );
+    validateExceptionThrown(invalidTrackException);
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 0, 16, readBuffer, DISK_IMAGE_BYTES_PER_SECTOR) );
+    validateExceptionThrown(invalidSectorException);
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 0, 0, readBuffer, sizeof(readBuffer)) );
+    validateExceptionThrown(invalidArgumentException);
+}
+
+TEST(NibbleDiskImage, FailOnBadAddressChecksumForReadRWTS16Sector)
+{
+    static const unsigned int addressChecksum = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 3 + 6;
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    writeZeroRWTS16Sectors(0, 0, 1);
+    unsigned char* pImage = DiskImage_GetImagePointer((DiskImage*)m_pNibbleDiskImage);
+    pImage[addressChecksum + 1] ^= 0x01;
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 0, 0, readBuffer, sizeof(readBuffer)) );
+    validateExceptionThrown(badTrackException);
+}
+
+TEST(NibbleDiskImage, FailOnBadDataChecksumForReadRWTS16Sector)
+{
+    static const unsigned int dataNibbles = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 14 + 
+                                            NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES + 3;
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    writeZeroRWTS16Sectors(0, 0, 1);
+    unsigned char* pImage = DiskImage_GetImagePointer((DiskImage*)m_pNibbleDiskImage);
+    // Swap in the encoding of 0x01 for one of the 0x00 data nibbles.
+    pImage[dataNibbles + 200] = 0x97;
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 0, 0, readBuffer, sizeof(readBuffer)) );
+    validateExceptionThrown(badTrackException);
+}
+
+TEST(NibbleDiskImage, FailOnInvalidDataNibbleForReadRWTS16Sector)
+{
+    static const unsigned int dataNibbles = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 14 + 
+                                            NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES + 3;
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    writeZeroRWTS16Sectors(0, 0, 1);
+    unsigned char* pImage = DiskImage_GetImagePointer((DiskImage*)m_pNibbleDiskImage);
+    pImage[dataNibbles + 10] = 0xAA;
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 0, 0, readBuffer, sizeof(readBuffer)) );
+    validateExceptionThrown(badTrackException);
+}
+
+TEST(NibbleDiskImage, FailOnBadDataEpilogForReadRWTS16Sector)
+{
+    static const unsigned int dataEpilog = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 14 + 
+                                           NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES + 3 + 343;
+    unsigned char readBuffer[DISK_IMAGE_BYTES_PER_SECTOR];
+
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    writeZeroRWTS16Sectors(0, 0, 1);
+    unsigned char* pImage = DiskImage_GetImagePointer((DiskImage*)m_pNibbleDiskImage);
+    pImage[dataEpilog + 2] = 0xFF;
+    __try_and_catch( NibbleDiskImage_ReadRWTS16Sector(m_pNibbleDiskImage, 0, 0, readBuffer, sizeof(readBuffer)) );
+    validateExceptionThrown(badTrackException);
+}
+
 TEST(NibbleDiskImage, WriteImage)
 {
     m_pNibbleDiskImage = NibbleDiskImage_Create();
@@ -911,7 +1109,7 @@ TEST(NibbleDiskImage, PassTooFewParametersToProcessScript)
     createZeroSectorObjectFile();
 
     NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,0"));
-    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: RWTS16,objectFilename,objectStartOffset,insertionLength,track,sector" LINE_ENDING,
+    STRCMP_EQUAL("<null>:1: error: Line doesn't contain correct fields: RWTS16,objectFilename,objectStartOffset,insertionLength,track,sector[,LZ]" LINE_ENDING,
                  printfSpy_GetLastErrorOutput());
 }
 
@@ -945,6 +1143,224 @@ TEST(NibbleDiskImage, PassInvalidTrackToProcessScript)
                  printfSpy_GetLastErrorOutput());
 }
 
+TEST(NibbleDiskImage, PassRWTS16LengthWhichRunsOffEndOfDiskToProcessScriptAndNothingIsWritten)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RWTS16,NibbleDiskImageTestAllZeroes.sav,0,512,34,15" LINE_ENDING));
+    STRCMP_EQUAL("<null>:1: error: Write starting at track/sector 34/15 won't fit in output image file." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+    validateAllZeroes(NibbleDiskImage_GetImagePointer(m_pNibbleDiskImage), NIBBLE_DISK_IMAGE_SIZE);
+}
+
+TEST(NibbleDiskImage, ReportOverlappingRWTS16Writes)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,1,0" LINE_ENDING
+                                                           "RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,0,15" LINE_ENDING
+                                                           "RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,1,0" LINE_ENDING));
+    STRCMP_EQUAL("<null>:3: error: Write overlaps data already inserted by line 1." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleDiskImage, ReportRW18WriteToTrackWithEarlierRWTS16Sector)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,5,0" LINE_ENDING
+                                                           "RW18,NibbleDiskImageTestAllZeroes.sav,0,100,0xa9,5,0" LINE_ENDING));
+    STRCMP_EQUAL("<null>:2: error: Write overlaps data already inserted by line 1." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleDiskImage, ReportRW18WritesToSameTrackFromDifferentSides)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RW18,NibbleDiskImageTestAllZeroes.sav,0,100,0xa9,5,0" LINE_ENDING
+                                                           "RW18,NibbleDiskImageTestAllZeroes.sav,0,100,0xad,5,4000" LINE_ENDING));
+    STRCMP_EQUAL("<null>:2: error: Write overlaps data already inserted by line 1." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleDiskImage, ReportRWTS16SectorWrittenToTrackSpannedByEarlierRW18Write)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RW18,NibbleDiskImageTestAllZeroes.sav,0,256,0xa9,5,4500" LINE_ENDING
+                                                           "RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,6,15" LINE_ENDING));
+    STRCMP_EQUAL("<null>:2: error: Write overlaps data already inserted by line 1." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleDiskImage, AllowDisjointRW18WritesToSameTrackAndSide)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RW18,NibbleDiskImageTestAllZeroes.sav,0,100,0xa9,5,0" LINE_ENDING
+                                                           "RW18,NibbleDiskImageTestAllZeroes.sav,0,100,0xa9,5,4000" LINE_ENDING
+                                                           "RW18,NibbleDiskImageTestAllZeroes.sav,0,100,0xad,6,0" LINE_ENDING));
+    STRCMP_EQUAL("", printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleDiskImage, PrintLayoutMapOfRW18WriteClaimsWholeTrack)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RW18,NibbleDiskImageTestAllZeroes.sav,0,100,0xa9,34,0" LINE_ENDING));
+
+    NibbleDiskImage_PrintLayoutMap(m_pNibbleDiskImage);
+    LONGS_EQUAL(7, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  0x026400 - 0x026463 used by line 1\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  0x026464 - 0x0275ff free\n", printfSpy_GetLastOutput());
+}
+
+TEST(NibbleDiskImage, MarkGapNibblesOfRWTS16SectorAsSync)
+{
+    static const unsigned int addressField = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES;
+    static const unsigned int gap2 = addressField + 14;
+    static const unsigned int dataField = gap2 + NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES;
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    writeZeroRWTS16Sectors(0, 0, 1);
+
+    CHECK_TRUE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, 0));
+    CHECK_TRUE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, addressField - 1));
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, addressField));
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, gap2 - 1));
+    CHECK_TRUE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, gap2));
+    CHECK_TRUE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, dataField - 1));
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, dataField));
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK - 1));
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, NIBBLE_DISK_IMAGE_SIZE));
+}
+
+TEST(NibbleDiskImage, DontMarkEncodedFFNibblesInRWTS16CPSectorAsSync)
+{
+    static const unsigned int dataField = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 14 + 
+                                          NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES;
+    DiskImageInsert insert;
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    insert.type = DISK_IMAGE_INSERTION_RWTS16CP;
+    insert.sourceOffset = 0;
+    insert.length = 0;
+    insert.track = 0;
+    insert.sector = 0;
+    NibbleDiskImage_InsertData(m_pNibbleDiskImage, NULL, &insert);
+
+    const unsigned char* pImage = NibbleDiskImage_GetImagePointer(m_pNibbleDiskImage);
+    LONGS_EQUAL(0xFF, pImage[dataField + 3 + 100]);
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, dataField + 3 + 100));
+}
+
+TEST(NibbleDiskImage, RW18TrackReplacesSyncMarksOfEarlierRWTS16Sector)
+{
+    static const unsigned int rwts16Gap2 = NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 14;
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    writeZeroRWTS16Sectors(0, 0, 1);
+    writeZeroRW18Sectors(0, 0, 18);
+
+    CHECK_TRUE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, 402));
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, 403));
+    CHECK_FALSE(NibbleDiskImage_IsSyncNibble(m_pNibbleDiskImage, rwts16Gap2));
+}
+
+TEST(NibbleDiskImage, CalculateRWTS16SkewOf2)
+{
+    static const unsigned char expected[16] = { 0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15 };
+    unsigned char              physicalSectors[16];
+    
+    NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 2);
+    CHECK_TRUE(0 == memcmp(expected, physicalSectors, sizeof(expected)));
+}
+
+TEST(NibbleDiskImage, CalculateRWTS16SkewOf4)
+{
+    static const unsigned char expected[16] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+    unsigned char              physicalSectors[16];
+    
+    NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 4);
+    CHECK_TRUE(0 == memcmp(expected, physicalSectors, sizeof(expected)));
+}
+
+TEST(NibbleDiskImage, FailToCalculateInvalidRWTS16Skews)
+{
+    unsigned char physicalSectors[16];
+    
+    __try_and_catch( NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 0) );
+    validateExceptionThrown(invalidArgumentException);
+    __try_and_catch( NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 16) );
+    validateExceptionThrown(invalidArgumentException);
+}
+
+TEST(NibbleDiskImage, FailToSetInvalidRWTS16Interleaves)
+{
+    unsigned char duplicate[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 14 };
+    unsigned char outOfRange[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 16 };
+    
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    __try_and_catch( NibbleDiskImage_SetRWTS16Interleave(m_pNibbleDiskImage, duplicate) );
+    validateExceptionThrown(invalidArgumentException);
+    __try_and_catch( NibbleDiskImage_SetRWTS16Interleave(m_pNibbleDiskImage, outOfRange) );
+    validateExceptionThrown(invalidArgumentException);
+}
+
+TEST(NibbleDiskImage, InsertZeroSectorsAsRWTS16WithSkewOf2)
+{
+    unsigned char physicalSectors[16];
+    
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 2);
+    NibbleDiskImage_SetRWTS16Interleave(m_pNibbleDiskImage, physicalSectors);
+    writeZeroRWTS16Sectors(0, 7, 2);
+
+    const unsigned char* pImage = NibbleDiskImage_GetImagePointer(m_pNibbleDiskImage);
+    validateRWTS16SectorsAreClear(pImage, 0, 0, 0, 0);
+    validateRWTS16SectorsAreClear(pImage, 0, 2, 0, 13);
+    validateRWTS16SectorsAreClear(pImage, 0, 15, 34, 15);
+    validateRWTS16PhysicalSectorContainsZeroData(pImage, 0, 7, 14);
+    validateRWTS16PhysicalSectorContainsZeroData(pImage, 0, 8, 1);
+}
+
+TEST(NibbleDiskImage, UpdateImageRebuildsWhenRWTS16InterleaveChanges)
+{
+    unsigned char physicalSectors[16];
+    
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+    createTextFile(g_scriptFilename, "RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,0,1" LINE_ENDING);
+    NibbleDiskImage_UpdateImage(m_pNibbleDiskImage, g_scriptFilename, g_imageFilename);
+    DiskImage_Free((DiskImage*)m_pNibbleDiskImage);
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 2);
+    NibbleDiskImage_SetRWTS16Interleave(m_pNibbleDiskImage, physicalSectors);
+
+    NibbleDiskImage_UpdateImage(m_pNibbleDiskImage, g_scriptFilename, g_imageFilename);
+
+    const unsigned char* pImage = NibbleDiskImage_GetImagePointer(m_pNibbleDiskImage);
+    validateRWTS16SectorsAreClear(pImage, 0, 0, 0, 1);
+    validateRWTS16SectorsAreClear(pImage, 0, 3, 34, 15);
+    validateRWTS16PhysicalSectorContainsZeroData(pImage, 0, 1, 2);
+}
+
+TEST(NibbleDiskImage, PrintLayoutMapOfRWTS16Sectors)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+    NibbleDiskImage_ProcessScript(m_pNibbleDiskImage, copy("RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,34,15" LINE_ENDING));
+
+    NibbleDiskImage_PrintLayoutMap(m_pNibbleDiskImage);
+    LONGS_EQUAL(3, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  0x000000 - 0x022eff free\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  0x022f00 - 0x022fff used by line 1\n", printfSpy_GetLastOutput());
+}
+
 TEST(NibbleDiskImage, ProcessTwoLineScriptFile)
 {
     m_pNibbleDiskImage = NibbleDiskImage_Create();
@@ -972,3 +1388,60 @@ TEST(NibbleDiskImage, FailToAllocateTextFileInProcessScriptFile)
     validateOutOfMemoryExceptionThrown();
 }
 
+TEST(NibbleDiskImage, CloseCompileTraceSpanWhenCompileFails)
+{
+    static const char traceFilename[] = "NibbleDiskImageTest.json";
+    char              trace[2048];
+    const char*       pCurr;
+    
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+    createTextFile(g_scriptFilename, "RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,0,0" LINE_ENDING);
+    TraceLog_Start();
+    /* Gives the trace room for its events up front so that the injected failure hits the compile instead. */
+    TraceLog_Begin("test", "warm up");
+    TraceLog_End();
+    
+    /* The first four allocations open the script and name its plan file so the fifth is made while compiling. */
+    MallocFailureInject_FailAllocation(5);
+    __try_and_catch( NibbleDiskImage_ProcessScriptFile(m_pNibbleDiskImage, g_scriptFilename) );
+    validateOutOfMemoryExceptionThrown();
+    TraceLog_Begin("test", "marker");
+    TraceLog_End();
+    TraceLog_WriteToFile(traceFilename);
+    TraceLog_Free();
+    m_pFile = fopen(traceFilename, "rb");
+    CHECK(m_pFile != NULL);
+    trace[fread(trace, 1, sizeof(trace) - 1, m_pFile)] = '\0';
+    fclose(m_pFile);
+    m_pFile = NULL;
+    remove(traceFilename);
+    
+    CHECK_TRUE(NULL == strstr(trace, "\"execute "));
+    pCurr = strstr(trace, "\"compile NibbleDiskImageTest.script\"");
+    CHECK_TRUE(pCurr != NULL);
+    pCurr = strstr(pCurr, "\"marker\"");
+    CHECK_TRUE(pCurr != NULL);
+    pCurr = strstr(pCurr, "{\"ph\":\"E\"");
+    CHECK_TRUE(pCurr != NULL);
+    CHECK_TRUE(NULL == strstr(pCurr + 1, "{"));
+}
+
+
+TEST(NibbleDiskImage, UpdateImageWithUnchangedInputsReusesExistingImage)
+{
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+    createZeroSectorObjectFile();
+    createTextFile(g_scriptFilename, "RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,0,0" LINE_ENDING
+                                     "RWTS16,NibbleDiskImageTestAllZeroes.sav,0,256,34,15" LINE_ENDING);
+    NibbleDiskImage_UpdateImage(m_pNibbleDiskImage, g_scriptFilename, g_imageFilename);
+    DiskImage_Free((DiskImage*)m_pNibbleDiskImage);
+    m_pNibbleDiskImage = NibbleDiskImage_Create();
+
+    NibbleDiskImage_UpdateImage(m_pNibbleDiskImage, g_scriptFilename, g_imageFilename);
+
+    const unsigned char* pImage = NibbleDiskImage_GetImagePointer(m_pNibbleDiskImage);
+    validateRWTS16SectorsAreClear(pImage, 0, 1, 34, 14);
+    validateRWTS16SectorContainsZeroData(pImage, 0, 0);
+    validateRWTS16SectorContainsZeroData(pImage, 34, 15);
+}
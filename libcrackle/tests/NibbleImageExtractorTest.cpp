@@ -0,0 +1,304 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "NibbleImageExtractor.h"
+    #include "NibbleDiskImage.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_imageFilename = "NibbleImageExtractorTest.nib";
+static const char* g_outputFilename = "NibbleImageExtractorTest.dsk";
+static const char* g_prefix = "NibbleImageExtractorTest";
+static const char* g_rwts16TrackFilename = "NibbleImageExtractorTest.t01.rwts16";
+static const char* g_rw18TrackFilename = "NibbleImageExtractorTest.t03.a9.rw18";
+
+/* Nibble offset of the first data nibble in the sector 0 data field written by NibbleDiskImage. */
+#define RWTS16_SECTOR0_DATA_OFFSET  (NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 14 + \
+                                     NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES + 3)
+
+
+TEST_GROUP(NibbleImageExtractor)
+{
+    NibbleDiskImage*      m_pNibbleDiskImage;
+    SectorDiskImage*      m_pExpectedImage;
+    NibbleImageExtractor* m_pExtractor;
+    unsigned char*        m_pFileData;
+    unsigned char         m_data[DISK_IMAGE_RW18_BYTES_PER_TRACK];
+
+    void setup()
+    {
+        clearExceptionCode();
+        printfSpy_Hook(512);
+        m_pNibbleDiskImage = NibbleDiskImage_Create();
+        m_pExpectedImage = NULL;
+        m_pExtractor = NULL;
+        m_pFileData = NULL;
+        for (size_t i = 0 ; i < sizeof(m_data) ; i++)
+            m_data[i] = (unsigned char)(i * 11 + (i >> 8));
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        fopenRestore();
+        fwriteRestore();
+        printfSpy_Unhook();
+        NibbleImageExtractor_Free(m_pExtractor);
+        DiskImage_Free((DiskImage*)m_pNibbleDiskImage);
+        DiskImage_Free((DiskImage*)m_pExpectedImage);
+        free(m_pFileData);
+        remove(g_imageFilename);
+        remove(g_outputFilename);
+        remove(g_rwts16TrackFilename);
+        remove(g_rw18TrackFilename);
+    }
+
+    void writeRWTS16Sectors(unsigned int track, unsigned int sector, unsigned int sectorCount)
+    {
+        DiskImageInsert insert;
+
+        insert.type = DISK_IMAGE_INSERTION_RWTS16;
+        insert.sourceOffset = 0;
+        insert.length = sectorCount * DISK_IMAGE_BYTES_PER_SECTOR;
+        insert.track = track;
+        insert.sector = sector;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, m_data, &insert);
+        if (m_pExpectedImage)
+            SectorDiskImage_InsertData(m_pExpectedImage, m_data, &insert);
+    }
+
+    void writeRWTS16CPSector(unsigned int track, unsigned int sector)
+    {
+        DiskImageInsert insert;
+
+        insert.type = DISK_IMAGE_INSERTION_RWTS16CP;
+        insert.sourceOffset = 0;
+        insert.length = 0;
+        insert.track = track;
+        insert.sector = sector;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, NULL, &insert);
+    }
+
+    void writeRW18Track(unsigned int side, unsigned int track)
+    {
+        DiskImageInsert insert;
+
+        insert.type = DISK_IMAGE_INSERTION_RW18;
+        insert.sourceOffset = 0;
+        insert.length = DISK_IMAGE_RW18_BYTES_PER_TRACK;
+        insert.side = side;
+        insert.track = track;
+        insert.intraTrackOffset = 0;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, m_data, &insert);
+    }
+
+    unsigned char* imagePointer()
+    {
+        return DiskImage_GetImagePointer((DiskImage*)m_pNibbleDiskImage);
+    }
+
+    void writeImageAndCreateExtractor()
+    {
+        NibbleDiskImage_WriteImage(m_pNibbleDiskImage, g_imageFilename);
+        m_pExtractor = NibbleImageExtractor_Create(g_imageFilename);
+    }
+
+    void readFileIntoMemory(const char* pFilename, size_t expectedSize)
+    {
+        FILE* pFile = fopen(pFilename, "rb");
+        CHECK_TRUE(pFile != NULL);
+        fseek(pFile, 0, SEEK_END);
+        LONGS_EQUAL(expectedSize, ftell(pFile));
+        fseek(pFile, 0, SEEK_SET);
+        free(m_pFileData);
+        m_pFileData = (unsigned char*)malloc(expectedSize);
+        CHECK_TRUE(m_pFileData != NULL);
+        LONGS_EQUAL(expectedSize, fread(m_pFileData, 1, expectedSize, pFile));
+        fclose(pFile);
+    }
+
+    void validateSectorImageMatchesExpected()
+    {
+        readFileIntoMemory(g_outputFilename, SECTOR_DISK_IMAGE_SIZE);
+        CHECK(0 == memcmp(SectorDiskImage_GetImagePointer(m_pExpectedImage), m_pFileData, SECTOR_DISK_IMAGE_SIZE));
+    }
+
+    void validateAllZeroes(const unsigned char* pBuffer, size_t bufferSize)
+    {
+        for (size_t i = 0 ; i < bufferSize ; i++)
+            LONGS_EQUAL(0, *pBuffer++);
+    }
+
+    void validateFileDoesntExist(const char* pFilename)
+    {
+        FILE* pFile = fopen(pFilename, "rb");
+        POINTERS_EQUAL(NULL, pFile);
+    }
+
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(NibbleImageExtractor, FailToCreateForMissingImage)
+{
+    __try_and_catch( m_pExtractor = NibbleImageExtractor_Create(g_imageFilename) );
+    validateExceptionThrown(fileOpenException);
+    POINTERS_EQUAL(NULL, m_pExtractor);
+}
+
+TEST(NibbleImageExtractor, FailAllAllocationsInCreate)
+{
+    NibbleDiskImage_WriteImage(m_pNibbleDiskImage, g_imageFilename);
+    for (int i = 1 ; i <= 4 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pExtractor = NibbleImageExtractor_Create(g_imageFilename) );
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pExtractor);
+    }
+}
+
+TEST(NibbleImageExtractor, WriteDosOrderSectorImage)
+{
+    m_pExpectedImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    writeRWTS16Sectors(0, 0, 16);
+    writeRWTS16Sectors(34, 14, 2);
+    writeImageAndCreateExtractor();
+    LONGS_EQUAL(0, NibbleImageExtractor_WriteSectorImage(m_pExtractor, SECTOR_DISK_IMAGE_DOS_ORDER, g_outputFilename));
+    LONGS_EQUAL(18, NibbleImageExtractor_GetRWTS16SectorCount(m_pExtractor));
+    LONGS_EQUAL(0, NibbleImageExtractor_GetRW18TrackCount(m_pExtractor));
+    validateSectorImageMatchesExpected();
+    STRCMP_EQUAL("NibbleImageExtractorTest.nib: 18 RWTS16 sectors and 0 RW18 tracks extracted to "
+                 "NibbleImageExtractorTest.dsk with 0 errors.\n",
+                 printfSpy_GetLastOutput());
+}
+
+TEST(NibbleImageExtractor, WriteProDosOrderSectorImage)
+{
+    m_pExpectedImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    writeRWTS16Sectors(2, 3, 5);
+    writeImageAndCreateExtractor();
+    LONGS_EQUAL(0, NibbleImageExtractor_WriteSectorImage(m_pExtractor, SECTOR_DISK_IMAGE_PRODOS_ORDER, g_outputFilename));
+    LONGS_EQUAL(5, NibbleImageExtractor_GetRWTS16SectorCount(m_pExtractor));
+    validateSectorImageMatchesExpected();
+}
+
+TEST(NibbleImageExtractor, SkipRW18TrackAndCopyProtectionSectorInSectorImage)
+{
+    m_pExpectedImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    writeRWTS16Sectors(1, 0, 1);
+    writeRWTS16CPSector(1, 1);
+    writeRW18Track(0xa9, 3);
+    writeImageAndCreateExtractor();
+    LONGS_EQUAL(0, NibbleImageExtractor_WriteSectorImage(m_pExtractor, SECTOR_DISK_IMAGE_DOS_ORDER, g_outputFilename));
+    LONGS_EQUAL(1, NibbleImageExtractor_GetRWTS16SectorCount(m_pExtractor));
+    LONGS_EQUAL(0, NibbleImageExtractor_GetRW18TrackCount(m_pExtractor));
+    validateSectorImageMatchesExpected();
+}
+
+TEST(NibbleImageExtractor, ReportAndLeaveOutCorruptSector)
+{
+    writeRWTS16Sectors(0, 0, 1);
+    imagePointer()[RWTS16_SECTOR0_DATA_OFFSET + 20] ^= 0x01;
+    writeImageAndCreateExtractor();
+    m_pExpectedImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    LONGS_EQUAL(1, NibbleImageExtractor_WriteSectorImage(m_pExtractor, SECTOR_DISK_IMAGE_DOS_ORDER, g_outputFilename));
+    LONGS_EQUAL(0, NibbleImageExtractor_GetRWTS16SectorCount(m_pExtractor));
+    validateSectorImageMatchesExpected();
+    STRCMP_EQUAL("NibbleImageExtractorTest.nib: error: Track 0 sector 0 has a corrupt address or data field." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageExtractor, FailOpenInWriteSectorImage)
+{
+    writeImageAndCreateExtractor();
+    fopenFail(NULL);
+    __try_and_catch( NibbleImageExtractor_WriteSectorImage(m_pExtractor, SECTOR_DISK_IMAGE_DOS_ORDER, g_outputFilename) );
+    validateExceptionThrown(fileOpenException);
+}
+
+TEST(NibbleImageExtractor, WriteTrackFiles)
+{
+    writeRWTS16Sectors(1, 2, 3);
+    writeRW18Track(0xa9, 3);
+    writeImageAndCreateExtractor();
+    LONGS_EQUAL(0, NibbleImageExtractor_WriteTrackFiles(m_pExtractor, g_prefix));
+    LONGS_EQUAL(3, NibbleImageExtractor_GetRWTS16SectorCount(m_pExtractor));
+    LONGS_EQUAL(1, NibbleImageExtractor_GetRW18TrackCount(m_pExtractor));
+    STRCMP_EQUAL("NibbleImageExtractorTest.nib: 3 RWTS16 sectors and 1 RW18 tracks extracted to "
+                 "NibbleImageExtractorTest with 0 errors.\n",
+                 printfSpy_GetLastOutput());
+
+    readFileIntoMemory(g_rwts16TrackFilename, 16 * DISK_IMAGE_BYTES_PER_SECTOR);
+    validateAllZeroes(m_pFileData, 2 * DISK_IMAGE_BYTES_PER_SECTOR);
+    CHECK(0 == memcmp(m_data, m_pFileData + 2 * DISK_IMAGE_BYTES_PER_SECTOR, 3 * DISK_IMAGE_BYTES_PER_SECTOR));
+    validateAllZeroes(m_pFileData + 5 * DISK_IMAGE_BYTES_PER_SECTOR, 11 * DISK_IMAGE_BYTES_PER_SECTOR);
+
+    readFileIntoMemory(g_rw18TrackFilename, DISK_IMAGE_RW18_BYTES_PER_TRACK);
+    CHECK(0 == memcmp(m_data, m_pFileData, DISK_IMAGE_RW18_BYTES_PER_TRACK));
+    validateFileDoesntExist("NibbleImageExtractorTest.t00.rwts16");
+}
+
+TEST(NibbleImageExtractor, ReportCorruptRW18TrackAndDontWriteItsFile)
+{
+    writeRW18Track(0xa9, 3);
+    imagePointer()[NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * 3 + 2000] = 0xAA;
+    writeImageAndCreateExtractor();
+    LONGS_EQUAL(1, NibbleImageExtractor_WriteTrackFiles(m_pExtractor, g_prefix));
+    LONGS_EQUAL(0, NibbleImageExtractor_GetRW18TrackCount(m_pExtractor));
+    validateFileDoesntExist(g_rw18TrackFilename);
+    STRCMP_EQUAL("NibbleImageExtractorTest.nib: error: Track 3 doesn't contain valid RW18 sectors for side 0xa9." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageExtractor, FailOpenInWriteTrackFiles)
+{
+    writeRWTS16Sectors(1, 0, 1);
+    writeImageAndCreateExtractor();
+    fopenFail(NULL);
+    __try_and_catch( NibbleImageExtractor_WriteTrackFiles(m_pExtractor, g_prefix) );
+    validateExceptionThrown(fileOpenException);
+}
+
+TEST(NibbleImageExtractor, FailWriteInWriteTrackFiles)
+{
+    writeRWTS16Sectors(1, 0, 1);
+    writeImageAndCreateExtractor();
+    fwriteFail(0);
+    __try_and_catch( NibbleImageExtractor_WriteTrackFiles(m_pExtractor, g_prefix) );
+    validateExceptionThrown(fileException);
+}
+
+TEST(NibbleImageExtractor, FailAllocationInWriteTrackFiles)
+{
+    writeRWTS16Sectors(1, 0, 1);
+    writeImageAndCreateExtractor();
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( NibbleImageExtractor_WriteTrackFiles(m_pExtractor, g_prefix) );
+    validateExceptionThrown(outOfMemoryException);
+}
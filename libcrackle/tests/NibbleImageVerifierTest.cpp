@@ -0,0 +1,320 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "NibbleImageVerifier.h"
+    #include "NibbleDiskImage.h"
+    #include "BinaryBuffer.h"
+    #include "MallocFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_imageFilename = "NibbleImageVerifierTest.nib";
+static const char* g_savFilename = "NibbleImageVerifierTest.sav";
+static const char* g_scriptFilename = "NibbleImageVerifierTest.script";
+static const char* g_planFilename = "NibbleImageVerifierTest.script.plan";
+
+/* Nibble offset of the first data nibble in the sector 0 data field written by NibbleDiskImage. */
+#define RWTS16_SECTOR0_DATA_OFFSET  (NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES + 14 + \
+                                     NIBBLE_DISK_IMAGE_RWTS16_GAP2_SYNC_BYTES + 3)
+
+
+TEST_GROUP(NibbleImageVerifier)
+{
+    NibbleDiskImage*     m_pNibbleDiskImage;
+    NibbleImageVerifier* m_pVerifier;
+    unsigned char        m_sectorData[2 * DISK_IMAGE_BYTES_PER_SECTOR];
+
+    void setup()
+    {
+        clearExceptionCode();
+        printfSpy_Hook(512);
+        m_pNibbleDiskImage = NibbleDiskImage_Create();
+        m_pVerifier = NULL;
+        for (size_t i = 0 ; i < sizeof(m_sectorData) ; i++)
+            m_sectorData[i] = (unsigned char)(i * 3);
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        printfSpy_Unhook();
+        NibbleImageVerifier_Free(m_pVerifier);
+        DiskImage_Free((DiskImage*)m_pNibbleDiskImage);
+        remove(g_imageFilename);
+        remove(g_savFilename);
+        remove(g_scriptFilename);
+        remove(g_planFilename);
+    }
+
+    void writeRWTS16Sectors(unsigned int track, unsigned int sector, unsigned int sectorCount)
+    {
+        DiskImageInsert insert;
+
+        insert.type = DISK_IMAGE_INSERTION_RWTS16;
+        insert.sourceOffset = 0;
+        insert.length = sectorCount * DISK_IMAGE_BYTES_PER_SECTOR;
+        insert.track = track;
+        insert.sector = sector;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, m_sectorData, &insert);
+    }
+
+    void writeRWTS16CPSector(unsigned int track, unsigned int sector)
+    {
+        DiskImageInsert insert;
+
+        insert.type = DISK_IMAGE_INSERTION_RWTS16CP;
+        insert.sourceOffset = 0;
+        insert.length = 0;
+        insert.track = track;
+        insert.sector = sector;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, NULL, &insert);
+    }
+
+    void writeRW18Track(unsigned int side, unsigned int track)
+    {
+        unsigned char*  pData = (unsigned char*)calloc(1, DISK_IMAGE_RW18_BYTES_PER_TRACK);
+        DiskImageInsert insert;
+
+        CHECK_TRUE(pData != NULL);
+        insert.type = DISK_IMAGE_INSERTION_RW18;
+        insert.sourceOffset = 0;
+        insert.length = DISK_IMAGE_RW18_BYTES_PER_TRACK;
+        insert.side = side;
+        insert.track = track;
+        insert.intraTrackOffset = 0;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, pData, &insert);
+        free(pData);
+    }
+
+    unsigned char* imagePointer()
+    {
+        return DiskImage_GetImagePointer((DiskImage*)m_pNibbleDiskImage);
+    }
+
+    void writeImageAndCreateVerifier()
+    {
+        NibbleDiskImage_WriteImage(m_pNibbleDiskImage, g_imageFilename);
+        m_pVerifier = NibbleImageVerifier_Create(g_imageFilename);
+    }
+
+    void createObjectFileAndScript(const char* pScript)
+    {
+        SavFileHeader header;
+
+        memcpy(header.signature, BINARY_BUFFER_SAV_SIGNATURE, sizeof(header.signature));
+        header.address = 0;
+        header.length = sizeof(m_sectorData);
+        FILE* pFile = fopen(g_savFilename, "wb");
+        fwrite(&header, 1, sizeof(header), pFile);
+        fwrite(m_sectorData, 1, sizeof(m_sectorData), pFile);
+        fclose(pFile);
+
+        createTextFile(g_scriptFilename, pScript);
+    }
+
+    void createTextFile(const char* pFilename, const char* pText)
+    {
+        FILE* pFile = fopen(pFilename, "wb");
+        fwrite(pText, 1, strlen(pText), pFile);
+        fclose(pFile);
+    }
+
+    void validateCounts(unsigned int rwts16SectorCount, unsigned int rw18TrackCount)
+    {
+        LONGS_EQUAL(rwts16SectorCount, NibbleImageVerifier_GetRWTS16SectorCount(m_pVerifier));
+        LONGS_EQUAL(rw18TrackCount, NibbleImageVerifier_GetRW18TrackCount(m_pVerifier));
+    }
+
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(NibbleImageVerifier, FailToCreateForMissingImage)
+{
+    __try_and_catch( m_pVerifier = NibbleImageVerifier_Create(g_imageFilename) );
+    validateExceptionThrown(fileOpenException);
+    POINTERS_EQUAL(NULL, m_pVerifier);
+}
+
+TEST(NibbleImageVerifier, FailToCreateForImageOfWrongSize)
+{
+    createTextFile(g_imageFilename, "Not a nibble image.");
+    __try_and_catch( m_pVerifier = NibbleImageVerifier_Create(g_imageFilename) );
+    validateExceptionThrown(fileException);
+    POINTERS_EQUAL(NULL, m_pVerifier);
+}
+
+TEST(NibbleImageVerifier, FailAllAllocationsInCreate)
+{
+    NibbleDiskImage_WriteImage(m_pNibbleDiskImage, g_imageFilename);
+    for (int i = 1 ; i <= 4 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pVerifier = NibbleImageVerifier_Create(g_imageFilename) );
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pVerifier);
+    }
+    MallocFailureInject_Restore();
+}
+
+TEST(NibbleImageVerifier, VerifyBlankImage)
+{
+    writeImageAndCreateVerifier();
+    LONGS_EQUAL(0, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(0, 0);
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: 0 RWTS16 sectors and 0 RW18 tracks verified with 0 errors.\n",
+                 printfSpy_GetLastOutput());
+    STRCMP_EQUAL("", printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageVerifier, VerifyRWTS16AndRW18Sectors)
+{
+    writeRWTS16Sectors(0, 15, 2);
+    writeRWTS16CPSector(2, 3);
+    writeRW18Track(0xa9, 3);
+    writeRW18Track(0xae, 4);
+    writeImageAndCreateVerifier();
+    LONGS_EQUAL(0, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(3, 2);
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: 3 RWTS16 sectors and 2 RW18 tracks verified with 0 errors.\n",
+                 printfSpy_GetLastOutput());
+}
+
+TEST(NibbleImageVerifier, ReportCorruptRWTS16DataField)
+{
+    writeRWTS16Sectors(0, 0, 1);
+    imagePointer()[RWTS16_SECTOR0_DATA_OFFSET + 100] ^= 0x01;
+    writeImageAndCreateVerifier();
+    LONGS_EQUAL(1, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(0, 0);
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: error: Track 0 sector 0 has a corrupt address or data field." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: 0 RWTS16 sectors and 0 RW18 tracks verified with 1 error.\n",
+                 printfSpy_GetLastOutput());
+}
+
+TEST(NibbleImageVerifier, ReportCorruptRW18Track)
+{
+    writeRW18Track(0xa9, 5);
+    imagePointer()[NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK * 5 + 1000] = 0xAA;
+    writeImageAndCreateVerifier();
+    LONGS_EQUAL(1, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(0, 0);
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: error: Track 5 doesn't contain valid RW18 sectors for side 0xa9." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageVerifier, CompareAgainstMatchingScript)
+{
+    writeRWTS16Sectors(1, 0, 2);
+    writeImageAndCreateVerifier();
+    createObjectFileAndScript("RWTS16,NibbleImageVerifierTest.sav,0,512,1,0\n");
+    NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename);
+    LONGS_EQUAL(0, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(2, 0);
+}
+
+TEST(NibbleImageVerifier, CompareAgainstScriptWithPlanCacheDisabled)
+{
+    writeRWTS16Sectors(1, 0, 2);
+    writeImageAndCreateVerifier();
+    createObjectFileAndScript("RWTS16,NibbleImageVerifierTest.sav,0,512,1,0\n");
+    NibbleImageVerifier_DisablePlanCache(m_pVerifier);
+    NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename);
+    LONGS_EQUAL(0, NibbleImageVerifier_Verify(m_pVerifier));
+    FILE* pPlanFile = fopen(g_planFilename, "rb");
+    if (pPlanFile)
+        fclose(pPlanFile);
+    POINTERS_EQUAL(NULL, pPlanFile);
+}
+
+TEST(NibbleImageVerifier, CompareRWTS16SectorsWrittenWithDifferentInterleave)
+{
+    unsigned char physicalSectors[NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK];
+
+    NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 4);
+    NibbleDiskImage_SetRWTS16Interleave(m_pNibbleDiskImage, physicalSectors);
+    writeRWTS16Sectors(1, 0, 2);
+    writeImageAndCreateVerifier();
+    createObjectFileAndScript("RWTS16,NibbleImageVerifierTest.sav,0,512,1,0\n");
+    NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename);
+    LONGS_EQUAL(0, NibbleImageVerifier_Verify(m_pVerifier));
+}
+
+TEST(NibbleImageVerifier, ReportRWTS16SectorWhichDoesntMatchScript)
+{
+    writeRWTS16Sectors(1, 0, 2);
+    writeImageAndCreateVerifier();
+    m_sectorData[DISK_IMAGE_BYTES_PER_SECTOR + 7] ^= 0x80;
+    createObjectFileAndScript("RWTS16,NibbleImageVerifierTest.sav,0,512,1,0\n");
+    NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename);
+    LONGS_EQUAL(1, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(2, 0);
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: error: Track 1 sector 1 doesn't match the script." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageVerifier, ReportRWTS16SectorWhichIsMissingFromImage)
+{
+    writeRWTS16Sectors(1, 0, 1);
+    writeImageAndCreateVerifier();
+    createObjectFileAndScript("RWTS16,NibbleImageVerifierTest.sav,0,512,1,0\n");
+    NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename);
+    LONGS_EQUAL(1, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(1, 0);
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: error: Track 1 sector 1 is missing." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageVerifier, ReportRW18TrackWhichIsMissingFromImage)
+{
+    writeImageAndCreateVerifier();
+    createObjectFileAndScript("RW18,NibbleImageVerifierTest.sav,0,512,0xa9,6,0\n");
+    NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename);
+    LONGS_EQUAL(1, NibbleImageVerifier_Verify(m_pVerifier));
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: error: Track 6 doesn't contain valid RW18 sectors for side 0xa9." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageVerifier, ReportRW18TrackWhichDoesntMatchScript)
+{
+    writeRW18Track(0xa9, 6);
+    writeImageAndCreateVerifier();
+    createObjectFileAndScript("RW18,NibbleImageVerifierTest.sav,0,512,0xa9,6,0\n");
+    NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename);
+    LONGS_EQUAL(1, NibbleImageVerifier_Verify(m_pVerifier));
+    validateCounts(0, 1);
+    STRCMP_EQUAL("NibbleImageVerifierTest.nib: error: Track 6 RW18 data doesn't match the script." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleImageVerifier, FailToProcessMissingScriptFile)
+{
+    writeImageAndCreateVerifier();
+    __try_and_catch( NibbleImageVerifier_ProcessScriptFile(m_pVerifier, g_scriptFilename) );
+    validateExceptionThrown(fileOpenException);
+    LONGS_EQUAL(0, NibbleImageVerifier_Verify(m_pVerifier));
+}
@@ -0,0 +1,410 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "NibbleLoadSimulator.h"
+    #include "NibbleDiskImage.h"
+    #include "MallocFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_sequenceFilename = "NibbleLoadSimulatorTest.seq";
+
+/* Nibble offsets of fields within the tracks written by NibbleDiskImage. */
+#define RWTS16_SECTOR0_ADDRESS_OFFSET   NIBBLE_DISK_IMAGE_RWTS16_GAP1_SYNC_BYTES
+#define RWTS16_SECTOR_READ_NIBBLES      368
+#define RW18_SECTOR5_ADDRESS_OFFSET     415
+#define RW18_SECTOR_SPACING             1041
+#define RW18_SECTOR_READ_NIBBLES        1035
+
+
+TEST_GROUP(NibbleLoadSimulator)
+{
+    NibbleDiskImage*     m_pNibbleDiskImage;
+    NibbleLoadSimulator* m_pSimulator;
+    NibbleLoadTiming     m_timing;
+
+    void setup()
+    {
+        clearExceptionCode();
+        printfSpy_Hook(512);
+        m_pNibbleDiskImage = NibbleDiskImage_Create();
+        m_pSimulator = NULL;
+        m_timing.stepMicroseconds = 0;
+        m_timing.settleMicroseconds = 0;
+        m_timing.sectorProcessingMicroseconds = 0;
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        printfSpy_Unhook();
+        NibbleLoadSimulator_Free(m_pSimulator);
+        DiskImage_Free((DiskImage*)m_pNibbleDiskImage);
+        remove(g_sequenceFilename);
+    }
+
+    void createSimulator()
+    {
+        m_pSimulator = NibbleLoadSimulator_Create(NibbleDiskImage_GetImagePointer(m_pNibbleDiskImage), &m_timing);
+    }
+
+    void writeRWTS16Sectors(unsigned int track, unsigned int sector, unsigned int sectorCount)
+    {
+        unsigned int    length = sectorCount * DISK_IMAGE_BYTES_PER_SECTOR;
+        unsigned char*  pData = (unsigned char*)calloc(1, length);
+        DiskImageInsert insert;
+
+        CHECK_TRUE(pData != NULL);
+        insert.type = DISK_IMAGE_INSERTION_RWTS16;
+        insert.sourceOffset = 0;
+        insert.length = length;
+        insert.track = track;
+        insert.sector = sector;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, pData, &insert);
+        free(pData);
+    }
+
+    void writeRW18Track(unsigned int side, unsigned int track)
+    {
+        unsigned char*  pData = (unsigned char*)calloc(1, DISK_IMAGE_RW18_BYTES_PER_TRACK);
+        DiskImageInsert insert;
+
+        CHECK_TRUE(pData != NULL);
+        insert.type = DISK_IMAGE_INSERTION_RW18;
+        insert.sourceOffset = 0;
+        insert.length = DISK_IMAGE_RW18_BYTES_PER_TRACK;
+        insert.side = side;
+        insert.track = track;
+        insert.intraTrackOffset = 0;
+        NibbleDiskImage_InsertData(m_pNibbleDiskImage, pData, &insert);
+        free(pData);
+    }
+
+    void createTextFile(const char* pFilename, const char* pText)
+    {
+        FILE* pFile = fopen(pFilename, "wb");
+        fwrite(pText, 1, strlen(pText), pFile);
+        fclose(pFile);
+    }
+
+    void validateTrackTime(unsigned int track,
+                           unsigned int stepping,
+                           unsigned int latency,
+                           unsigned int reading,
+                           unsigned int processing)
+    {
+        const NibbleLoadTrackTime* pTrackTime = NibbleLoadSimulator_GetTrackTime(m_pSimulator, track);
+
+        CHECK_TRUE(pTrackTime != NULL);
+        LONGS_EQUAL(stepping, pTrackTime->stepping);
+        LONGS_EQUAL(latency, pTrackTime->latency);
+        LONGS_EQUAL(reading, pTrackTime->reading);
+        LONGS_EQUAL(processing, pTrackTime->processing);
+    }
+
+    unsigned int nibbles(unsigned int nibbleCount)
+    {
+        return nibbleCount * NIBBLE_LOAD_SIMULATOR_MICROSECONDS_PER_NIBBLE;
+    }
+
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(NibbleLoadSimulator, CreateWithDefaultTiming)
+{
+    m_pSimulator = NibbleLoadSimulator_Create(NibbleDiskImage_GetImagePointer(m_pNibbleDiskImage), NULL);
+    CHECK_TRUE(m_pSimulator != NULL);
+    LONGS_EQUAL(0, NibbleLoadSimulator_GetElapsedTime(m_pSimulator));
+    validateTrackTime(0, 0, 0, 0, 0);
+    POINTERS_EQUAL(NULL, NibbleLoadSimulator_GetTrackTime(m_pSimulator, DISK_IMAGE_TRACKS_PER_SIDE));
+}
+
+TEST(NibbleLoadSimulator, FailAllocationsInCreate)
+{
+    for (unsigned int i = 1 ; i <= 2 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( createSimulator() );
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pSimulator);
+    }
+}
+
+TEST(NibbleLoadSimulator, ReadFirstRWTS16SectorFromIndex)
+{
+    writeRWTS16Sectors(0, 0, 1);
+    createSimulator();
+    LONGS_EQUAL(nibbles(RWTS16_SECTOR0_ADDRESS_OFFSET + RWTS16_SECTOR_READ_NIBBLES),
+                NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 0));
+    validateTrackTime(0, 0, nibbles(RWTS16_SECTOR0_ADDRESS_OFFSET), nibbles(RWTS16_SECTOR_READ_NIBBLES), 0);
+}
+
+TEST(NibbleLoadSimulator, ReadAdjacentRWTS16SectorsWithoutProcessingTime)
+{
+    writeRWTS16Sectors(0, 0, 2);
+    createSimulator();
+    NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 0);
+    LONGS_EQUAL(nibbles(NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR - RWTS16_SECTOR_READ_NIBBLES + 
+                        RWTS16_SECTOR_READ_NIBBLES),
+                NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 1));
+}
+
+TEST(NibbleLoadSimulator, ProcessingTimeCausesAdjacentRWTS16SectorToBeMissed)
+{
+    unsigned int processing = 6016;
+    unsigned int headOffset = RWTS16_SECTOR0_ADDRESS_OFFSET + RWTS16_SECTOR_READ_NIBBLES + processing / 32;
+    unsigned int sector1Offset = RWTS16_SECTOR0_ADDRESS_OFFSET + NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR;
+
+    m_timing.sectorProcessingMicroseconds = processing;
+    writeRWTS16Sectors(0, 0, 2);
+    createSimulator();
+    NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 0);
+    LONGS_EQUAL(nibbles(sector1Offset + NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK - headOffset + RWTS16_SECTOR_READ_NIBBLES) + 
+                processing,
+                NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 1));
+    validateTrackTime(0, 0, 
+                      nibbles(RWTS16_SECTOR0_ADDRESS_OFFSET + sector1Offset + 
+                              NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK - headOffset),
+                      nibbles(2 * RWTS16_SECTOR_READ_NIBBLES), 
+                      2 * processing);
+}
+
+TEST(NibbleLoadSimulator, SeekChargesStepAndSettleTimeToDestinationTrack)
+{
+    m_timing.stepMicroseconds = 1000;
+    m_timing.settleMicroseconds = 500;
+    writeRWTS16Sectors(2, 0, 1);
+    createSimulator();
+    NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 2, 0);
+    validateTrackTime(0, 0, 0, 0, 0);
+    validateTrackTime(2, 2500, nibbles(RWTS16_SECTOR0_ADDRESS_OFFSET) - 2496, nibbles(RWTS16_SECTOR_READ_NIBBLES), 0);
+}
+
+TEST(NibbleLoadSimulator, FailToReadRWTS16SectorNotInImage)
+{
+    writeRWTS16Sectors(0, 0, 1);
+    createSimulator();
+    __try_and_catch( NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 1) );
+    validateExceptionThrown(invalidSectorException);
+    LONGS_EQUAL(0, NibbleLoadSimulator_GetElapsedTime(m_pSimulator));
+}
+
+TEST(NibbleLoadSimulator, FailToReadInvalidRWTS16TrackAndSector)
+{
+    createSimulator();
+    __try_and_catch( NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, DISK_IMAGE_TRACKS_PER_SIDE, 0) );
+    validateExceptionThrown(invalidTrackException);
+    __try_and_catch( NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 16) );
+    validateExceptionThrown(invalidSectorException);
+}
+
+TEST(NibbleLoadSimulator, ReadRW18TrackFromIndex)
+{
+    unsigned int lastSectorOffset = RW18_SECTOR5_ADDRESS_OFFSET + 5 * RW18_SECTOR_SPACING;
+
+    writeRW18Track(DISK_IMAGE_RW18_SIDE_0, 0);
+    createSimulator();
+    LONGS_EQUAL(nibbles(lastSectorOffset + RW18_SECTOR_READ_NIBBLES),
+                NibbleLoadSimulator_ReadRW18Track(m_pSimulator, DISK_IMAGE_RW18_SIDE_0, 0));
+    validateTrackTime(0, 0, 
+                      nibbles(RW18_SECTOR5_ADDRESS_OFFSET), 
+                      nibbles(lastSectorOffset + RW18_SECTOR_READ_NIBBLES - RW18_SECTOR5_ADDRESS_OFFSET), 
+                      0);
+}
+
+TEST(NibbleLoadSimulator, ReadRW18TrackStartingMidTrackTakesLessThanTwoRevolutions)
+{
+    writeRWTS16Sectors(0, 0, 1);
+    writeRW18Track(DISK_IMAGE_RW18_SIDE_0, 1);
+    createSimulator();
+    NibbleLoadSimulator_ReadRWTS16Sector(m_pSimulator, 0, 0);
+    
+    /* Head is at nibble 896 so sector 4 at 1456 is the first to arrive and sector 5 at 415 is the last. */
+    LONGS_EQUAL(nibbles(RW18_SECTOR5_ADDRESS_OFFSET + NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK - 896 + 
+                        RW18_SECTOR_READ_NIBBLES),
+                NibbleLoadSimulator_ReadRW18Track(m_pSimulator, DISK_IMAGE_RW18_SIDE_0, 1));
+    validateTrackTime(1, 0, nibbles(RW18_SECTOR5_ADDRESS_OFFSET + RW18_SECTOR_SPACING - 896), 
+                      nibbles(NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK - RW18_SECTOR_SPACING + RW18_SECTOR_READ_NIBBLES), 0);
+}
+
+TEST(NibbleLoadSimulator, FailToReadRW18TrackForWrongSide)
+{
+    writeRW18Track(DISK_IMAGE_RW18_SIDE_0, 0);
+    createSimulator();
+    __try_and_catch( NibbleLoadSimulator_ReadRW18Track(m_pSimulator, DISK_IMAGE_RW18_SIDE_1, 0) );
+    validateExceptionThrown(invalidSideException);
+}
+
+TEST(NibbleLoadSimulator, FailToReadRW18TrackFromRWTS16Track)
+{
+    writeRWTS16Sectors(0, 0, 16);
+    createSimulator();
+    __try_and_catch( NibbleLoadSimulator_ReadRW18Track(m_pSimulator, DISK_IMAGE_RW18_SIDE_0, 0) );
+    validateExceptionThrown(invalidTrackException);
+    __try_and_catch( NibbleLoadSimulator_ReadRW18Track(m_pSimulator, DISK_IMAGE_RW18_SIDE_0, DISK_IMAGE_TRACKS_PER_SIDE) );
+    validateExceptionThrown(invalidTrackException);
+}
+
+TEST(NibbleLoadSimulator, CalculateTimeToReadRWTS16TrackInPhysicalOrder)
+{
+    unsigned int sectorCount = 0;
+
+    writeRWTS16Sectors(0, 0, 16);
+    createSimulator();
+    LONGS_EQUAL(nibbles(RWTS16_SECTOR_READ_NIBBLES + 15 * NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR),
+                NibbleLoadSimulator_CalculateRWTS16TrackTime(m_pSimulator, 0, &sectorCount));
+    LONGS_EQUAL(16, sectorCount);
+    LONGS_EQUAL(0, NibbleLoadSimulator_GetElapsedTime(m_pSimulator));
+}
+
+TEST(NibbleLoadSimulator, CalculateTimeToReadSkewedRWTS16TrackWithProcessingTime)
+{
+    unsigned char physicalSectors[NIBBLE_DISK_IMAGE_RWTS16_SECTORS_PER_TRACK];
+    unsigned int  sectorCount = 0;
+
+    m_timing.sectorProcessingMicroseconds = nibbles(188);
+    NibbleDiskImage_CalculateRWTS16Skew(physicalSectors, 2);
+    NibbleDiskImage_SetRWTS16Interleave(m_pNibbleDiskImage, physicalSectors);
+    writeRWTS16Sectors(0, 0, 16);
+    createSimulator();
+
+    /* Sectors 1 - 7 and 9 - 15 each follow their predecessor 2 physical sectors later.  Sector 8 has to wait for
+       physical sector 1 after the track wraps around from physical sector 14. */
+    LONGS_EQUAL(nibbles(RWTS16_SECTOR_READ_NIBBLES + 14 * 2 * NIBBLE_DISK_IMAGE_RWTS16_NIBBLES_PER_SECTOR + 
+                        188 + 1108 + RWTS16_SECTOR_READ_NIBBLES),
+                NibbleLoadSimulator_CalculateRWTS16TrackTime(m_pSimulator, 0, &sectorCount));
+    LONGS_EQUAL(16, sectorCount);
+}
+
+TEST(NibbleLoadSimulator, PrintRWTS16Revolutions)
+{
+    writeRWTS16Sectors(0, 0, 16);
+    writeRWTS16Sectors(2, 0, 1);
+    createSimulator();
+    NibbleLoadSimulator_PrintRWTS16Revolutions(m_pSimulator);
+    LONGS_EQUAL(3, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  track  0: 16 sectors read in 0.92 revolutions\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  track  2: 1 sectors read in 0.06 revolutions\n", printfSpy_GetLastOutput());
+}
+
+TEST(NibbleLoadSimulator, ProcessSequenceFile)
+{
+    m_timing.stepMicroseconds = 1000;
+    writeRWTS16Sectors(0, 0, 2);
+    writeRW18Track(DISK_IMAGE_RW18_SIDE_0, 1);
+    createTextFile(g_sequenceFilename, "# Load sequence\n"
+                                       "RWTS16,BOOT,0,0,2\n"
+                                       "RW18,GAME,0xa9,1\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    LONGS_EQUAL(259400, NibbleLoadSimulator_GetElapsedTime(m_pSimulator));
+    LONGS_EQUAL(0, NibbleLoadSimulator_GetErrorCount(m_pSimulator));
+    LONGS_EQUAL(7, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  track  0: stepping 0.000 ms, rotation 17.408 ms, reading 23.552 ms, processing 0.000 ms\n",
+                 printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  track  1: stepping 1.000 ms, rotation 4.640 ms, reading 212.800 ms, processing 0.000 ms\n",
+                 printfSpy_GetLastOutput());
+}
+
+TEST(NibbleLoadSimulator, ProcessSequenceFileReportsTotal)
+{
+    writeRWTS16Sectors(0, 0, 2);
+    createTextFile(g_sequenceFilename, "RWTS16,BOOT,0,0,2\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    LONGS_EQUAL(5, printfSpy_GetCallCount());
+    STRCMP_EQUAL("Per track breakdown:\n", printfSpy_GetPreviousOutput());
+    LONGS_EQUAL(40960, NibbleLoadSimulator_GetElapsedTime(m_pSimulator));
+}
+
+TEST(NibbleLoadSimulator, FailToOpenSequenceFile)
+{
+    createSimulator();
+    __try_and_catch( NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename) );
+    validateExceptionThrown(fileOpenException);
+    STRCMP_EQUAL("NibbleLoadSimulatorTest.seq:0: error: Failed to open NibbleLoadSimulatorTest.seq for parsing." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleLoadSimulator, SequenceLineWithBlankType)
+{
+    createTextFile(g_sequenceFilename, "\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    STRCMP_EQUAL("NibbleLoadSimulatorTest.seq:1: error: Load sequence line cannot be blank." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleLoadSimulator, SequenceLineWithInvalidType)
+{
+    createTextFile(g_sequenceFilename, "BLOCK,BOOT,0\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    STRCMP_EQUAL("NibbleLoadSimulatorTest.seq:1: error: BLOCK isn't a recognized read type of RWTS16 or RW18." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleLoadSimulator, SequenceLinesWithInvalidFieldCounts)
+{
+    createTextFile(g_sequenceFilename, "RWTS16,BOOT,0\n"
+                                       "RW18,GAME,0xa9,1,1,1\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    STRCMP_EQUAL("NibbleLoadSimulatorTest.seq:2: error: 6 is incorrect field count for RW18 read.  Expected 4 or 5." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleLoadSimulator, SequenceLineWithMissingRWTS16Sector)
+{
+    writeRWTS16Sectors(0, 0, 1);
+    createTextFile(g_sequenceFilename, "RWTS16,BOOT,0,0,2\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    STRCMP_EQUAL("NibbleLoadSimulatorTest.seq:1: error: Track 0 sector 1 wasn't found in the image." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+    LONGS_EQUAL(1, NibbleLoadSimulator_GetErrorCount(m_pSimulator));
+}
+
+TEST(NibbleLoadSimulator, SequenceLineWithInvalidTrack)
+{
+    createTextFile(g_sequenceFilename, "RW18,GAME,0xa9,35\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    STRCMP_EQUAL("NibbleLoadSimulatorTest.seq:1: error: 35 specifies an invalid track.  Must be 0 - 34." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(NibbleLoadSimulator, SequenceLinesWithMissingRW18Data)
+{
+    writeRW18Track(DISK_IMAGE_RW18_SIDE_0, 1);
+    createTextFile(g_sequenceFilename, "RW18,GAME,0xa9,0\n"
+                                       "RW18,GAME,0xad,1\n");
+    createSimulator();
+    NibbleLoadSimulator_ProcessSequenceFile(m_pSimulator, g_sequenceFilename);
+    STRCMP_EQUAL("NibbleLoadSimulatorTest.seq:2: error: Track 1 doesn't contain RW18 data for side 0xad." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
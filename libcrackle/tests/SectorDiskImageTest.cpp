@@ -0,0 +1,463 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "SectorDiskImage.h"
+    #include "NibbleDiskImage.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_imageFilename = "SectorDiskImageTest.dsk";
+static const char* g_rawFilename = "SectorDiskImageTest.bin";
+static const char* g_planFilename = "SectorDiskImageTest.dsk.plan";
+
+
+TEST_GROUP(SectorDiskImage)
+{
+    SectorDiskImage* m_pDiskImage;
+    DiskImage*       m_pMirror;
+    FILE*            m_pFile;
+    unsigned char*   m_pImageOnDisk;
+    char             m_buffer[256];
+    
+    void setup()
+    {
+        clearExceptionCode();
+        printfSpy_Hook(512);
+        m_pDiskImage = NULL;
+        m_pMirror = NULL;
+        m_pFile = NULL;
+        m_pImageOnDisk = NULL;
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        printfSpy_Unhook();
+        DiskImage_Free((DiskImage*)m_pDiskImage);
+        DiskImage_Free(m_pMirror);
+        if (m_pFile)
+            fclose(m_pFile);
+        free(m_pImageOnDisk);
+        remove(g_imageFilename);
+        remove(g_rawFilename);
+        remove(g_planFilename);
+    }
+    
+    char* copy(const char* pStringToCopy)
+    {
+        CHECK(strlen(pStringToCopy) < sizeof(m_buffer) - 1);
+        strcpy(m_buffer, pStringToCopy);
+        return m_buffer;
+    }
+    
+    void validateAllZeroes(const unsigned char* pBuffer, size_t bufferSize)
+    {
+        for (size_t i = 0 ; i < bufferSize ; i++)
+            LONGS_EQUAL(0, *pBuffer++);
+    }
+    
+    void validateFill(const unsigned char* pBuffer, size_t bufferSize, unsigned char fillByte)
+    {
+        for (size_t i = 0 ; i < bufferSize ; i++)
+            LONGS_EQUAL(fillByte, *pBuffer++);
+    }
+    
+    void validateFileSector(unsigned int track, unsigned int fileSector, unsigned char fillByte)
+    {
+        const unsigned char* pImage = SectorDiskImage_GetImagePointer(m_pDiskImage);
+        
+        validateFill(pImage + (track * SECTOR_DISK_IMAGE_SECTORS_PER_TRACK + fileSector) * DISK_IMAGE_BYTES_PER_SECTOR,
+                     DISK_IMAGE_BYTES_PER_SECTOR,
+                     fillByte);
+    }
+    
+    /* Each 256 byte page of the inserted data is filled with its page index + 1 so that placement can be checked. */
+    void insertPages(DiskImageInsert* pInsert, unsigned int pageCount)
+    {
+        unsigned int   totalSize = pageCount * DISK_IMAGE_PAGE_SIZE;
+        unsigned char* pData = (unsigned char*)malloc(totalSize);
+        CHECK_TRUE(pData != NULL);
+        for (unsigned int i = 0 ; i < pageCount ; i++)
+            memset(pData + i * DISK_IMAGE_PAGE_SIZE, i + 1, DISK_IMAGE_PAGE_SIZE);
+        
+        pInsert->sourceOffset = 0;
+        if (pInsert->length == 0)
+            pInsert->length = totalSize;
+        __try_and_catch( SectorDiskImage_InsertData(m_pDiskImage, pData, pInsert) );
+        free(pData);
+    }
+    
+    void insertRWTS16Sectors(unsigned int track, unsigned int sector, unsigned int sectorCount)
+    {
+        DiskImageInsert insert;
+        
+        insert.type = DISK_IMAGE_INSERTION_RWTS16;
+        insert.length = 0;
+        insert.track = track;
+        insert.sector = sector;
+        insertPages(&insert, sectorCount);
+    }
+    
+    void insertBlocks(unsigned int block, unsigned int intraBlockOffset, unsigned int length)
+    {
+        DiskImageInsert insert;
+        
+        insert.type = DISK_IMAGE_INSERTION_BLOCK;
+        insert.length = length;
+        insert.block = block;
+        insert.intraBlockOffset = intraBlockOffset;
+        insertPages(&insert, (length + DISK_IMAGE_PAGE_SIZE - 1) / DISK_IMAGE_PAGE_SIZE);
+    }
+    
+    void createRawObjectFile(size_t fileSize, unsigned char fillByte)
+    {
+        unsigned char* pData = (unsigned char*)malloc(fileSize);
+        memset(pData, fillByte, fileSize);
+        FILE* pFile = fopen(g_rawFilename, "wb");
+        fwrite(pData, 1, fileSize, pFile);
+        fclose(pFile);
+        free(pData);
+    }
+    
+    const unsigned char* readDiskImageIntoMemory(void)
+    {
+        m_pFile = fopen(g_imageFilename, "rb");
+        CHECK(m_pFile != NULL);
+        fseek(m_pFile, 0, SEEK_END);
+        LONGS_EQUAL(SECTOR_DISK_IMAGE_SIZE, ftell(m_pFile));
+        fseek(m_pFile, 0, SEEK_SET);
+        
+        m_pImageOnDisk = (unsigned char*)malloc(SECTOR_DISK_IMAGE_SIZE);
+        CHECK(m_pImageOnDisk != NULL);
+        LONGS_EQUAL(SECTOR_DISK_IMAGE_SIZE, fread(m_pImageOnDisk, 1, SECTOR_DISK_IMAGE_SIZE, m_pFile));
+
+        fclose(m_pFile);
+        m_pFile = NULL;
+        
+        return m_pImageOnDisk;
+    }
+    
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+};
+
+
+TEST(SectorDiskImage, FailAllAllocationInCreate)
+{
+    static const int allocationsToFail = 3;
+    for (int i = 1 ; i <= allocationsToFail ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER) );
+        validateExceptionThrown(outOfMemoryException);
+    }
+
+    MallocFailureInject_FailAllocation(allocationsToFail + 1);
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    CHECK_TRUE(m_pDiskImage != NULL);
+}
+
+TEST(SectorDiskImage, VerifyCreateStartsWithZeroesInImage)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    LONGS_EQUAL(143360, SectorDiskImage_GetImageSize(m_pDiskImage));
+    validateAllZeroes(SectorDiskImage_GetImagePointer(m_pDiskImage), SECTOR_DISK_IMAGE_SIZE);
+}
+
+TEST(SectorDiskImage, GetImageOffsetForDOSOrder)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    LONGS_EQUAL(0x0000, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 0));
+    LONGS_EQUAL(0x0700, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 1));
+    LONGS_EQUAL(0x0e00, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 2));
+    LONGS_EQUAL(0x0d00, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 4));
+    LONGS_EQUAL(0x0f00, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 15));
+    LONGS_EQUAL(0x22f00, SectorDiskImage_GetImageOffset(m_pDiskImage, 34, 15));
+}
+
+TEST(SectorDiskImage, GetImageOffsetForProDOSOrder)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    LONGS_EQUAL(0x0000, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 0));
+    LONGS_EQUAL(0x0800, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 1));
+    LONGS_EQUAL(0x0100, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 2));
+    LONGS_EQUAL(0x0e00, SectorDiskImage_GetImageOffset(m_pDiskImage, 0, 13));
+    LONGS_EQUAL(0x1f00, SectorDiskImage_GetImageOffset(m_pDiskImage, 1, 15));
+}
+
+TEST(SectorDiskImage, InsertWholeRWTS16TrackInDOSOrder)
+{
+    static const unsigned char fileSectorForPhysical[16] = { 0, 7, 14, 6, 13, 5, 12, 4, 11, 3, 10, 2, 9, 1, 8, 15 };
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertRWTS16Sectors(1, 0, 16);
+    
+    for (unsigned int physical = 0 ; physical < 16 ; physical++)
+        validateFileSector(1, fileSectorForPhysical[physical], physical + 1);
+    validateAllZeroes(SectorDiskImage_GetImagePointer(m_pDiskImage), 16 * DISK_IMAGE_BYTES_PER_SECTOR);
+}
+
+TEST(SectorDiskImage, InsertWholeRWTS16TrackInProDOSOrder)
+{
+    static const unsigned char fileSectorForPhysical[16] = { 0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15 };
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    insertRWTS16Sectors(0, 0, 16);
+    
+    for (unsigned int physical = 0 ; physical < 16 ; physical++)
+        validateFileSector(0, fileSectorForPhysical[physical], physical + 1);
+}
+
+TEST(SectorDiskImage, InsertRWTS16SectorsWhichWrapToNextTrack)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertRWTS16Sectors(2, 15, 2);
+    validateFileSector(2, 15, 1);
+    validateFileSector(3, 0, 2);
+}
+
+TEST(SectorDiskImage, InsertRWTS16SectorInLastSectorOfImage)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertRWTS16Sectors(34, 15, 1);
+    validateFileSector(34, 15, 1);
+}
+
+TEST(SectorDiskImage, FailToInsertRWTS16SectorsWhichExtendPastLastTrack)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertRWTS16Sectors(34, 15, 2);
+    validateExceptionThrown(invalidTrackException);
+    validateAllZeroes(SectorDiskImage_GetImagePointer(m_pDiskImage), SECTOR_DISK_IMAGE_SIZE);
+}
+
+TEST(SectorDiskImage, FailToInsertRWTS16SectorWithInvalidSector)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertRWTS16Sectors(0, 16, 1);
+    validateExceptionThrown(invalidSectorException);
+}
+
+TEST(SectorDiskImage, FailToInsertPartialRWTS16Sector)
+{
+    DiskImageInsert insert;
+    
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insert.type = DISK_IMAGE_INSERTION_RWTS16;
+    insert.length = DISK_IMAGE_BYTES_PER_SECTOR + 1;
+    insert.track = 0;
+    insert.sector = 0;
+    insertPages(&insert, 2);
+    validateExceptionThrown(invalidLengthException);
+}
+
+TEST(SectorDiskImage, InsertBlockInProDOSOrderIsLinear)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    insertBlocks(9, 0, DISK_IMAGE_BLOCK_SIZE);
+    validateFileSector(1, 2, 1);
+    validateFileSector(1, 3, 2);
+}
+
+TEST(SectorDiskImage, InsertBlockInDOSOrderIsSplitAcrossInterleavedSectors)
+{
+    /* ProDOS block 9 is in track 1 logical sectors 2 and 3 which are physical sectors 4 and 6 and DOS sectors 13 and 12. */
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertBlocks(9, 0, DISK_IMAGE_BLOCK_SIZE);
+    validateFileSector(1, 13, 1);
+    validateFileSector(1, 12, 2);
+}
+
+TEST(SectorDiskImage, InsertPartialBlockDataWhichStraddlesPagesInDOSOrder)
+{
+    const unsigned char* pImage;
+    
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertBlocks(0, 255, 2);
+    pImage = SectorDiskImage_GetImagePointer(m_pDiskImage);
+    LONGS_EQUAL(0, pImage[0x00fe]);
+    LONGS_EQUAL(1, pImage[0x00ff]);
+    LONGS_EQUAL(1, pImage[0x0e00]);
+    LONGS_EQUAL(0, pImage[0x0e01]);
+}
+
+TEST(SectorDiskImage, InsertLastBlockOfImage)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    insertBlocks(SECTOR_DISK_IMAGE_BLOCK_COUNT - 1, 0, DISK_IMAGE_BLOCK_SIZE);
+    validateFileSector(34, 14, 1);
+    validateFileSector(34, 15, 2);
+}
+
+TEST(SectorDiskImage, FailToInsertBlockJustPastEndOfImage)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    insertBlocks(SECTOR_DISK_IMAGE_BLOCK_COUNT, 0, DISK_IMAGE_BLOCK_SIZE);
+    validateExceptionThrown(blockExceedsImageBoundsException);
+}
+
+TEST(SectorDiskImage, FailToInsertBlockWithInvalidIntraBlockOffset)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    insertBlocks(0, DISK_IMAGE_BLOCK_SIZE, 1);
+    validateExceptionThrown(invalidIntraBlockOffsetException);
+}
+
+TEST(SectorDiskImage, FailToInsertRW18Data)
+{
+    DiskImageInsert insert;
+    
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insert.type = DISK_IMAGE_INSERTION_RW18;
+    insert.length = 0;
+    insert.side = DISK_IMAGE_RW18_SIDE_0;
+    insert.track = 0;
+    insert.intraTrackOffset = 0;
+    insertPages(&insert, 1);
+    validateExceptionThrown(invalidInsertionTypeException);
+}
+
+TEST(SectorDiskImage, ProcessRWTS16AndBlockScriptLines)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    createRawObjectFile(DISK_IMAGE_BLOCK_SIZE, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("RWTS16,SectorDiskImageTest.bin,0,256,0,1" LINE_ENDING
+                                                     "BLOCK,SectorDiskImageTest.bin,0,512,9" LINE_ENDING));
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    validateFileSector(0, 7, 0xff);
+    validateFileSector(1, 13, 0xff);
+    validateFileSector(1, 12, 0xff);
+}
+
+TEST(SectorDiskImage, ReportRW18ScriptLineAsUnsupported)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    createRawObjectFile(DISK_IMAGE_BYTES_PER_SECTOR, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("RW18,SectorDiskImageTest.bin,0,256,0xa9,0,0" LINE_ENDING));
+    STRCMP_EQUAL("<null>:1: error: RW18 insertion type isn't supported for this output image type." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+    validateAllZeroes(SectorDiskImage_GetImagePointer(m_pDiskImage), SECTOR_DISK_IMAGE_SIZE);
+}
+
+TEST(SectorDiskImage, ReportOverlappingRWTS16Writes)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    createRawObjectFile(DISK_IMAGE_BLOCK_SIZE, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("RWTS16,SectorDiskImageTest.bin,0,512,0,1" LINE_ENDING
+                                                     "RWTS16,SectorDiskImageTest.bin,0,256,0,2" LINE_ENDING));
+    STRCMP_EQUAL("<null>:2: error: Write overlaps data already inserted by line 1." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(SectorDiskImage, ProcessScriptIntoProDOSOrderMirror)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    m_pMirror = (DiskImage*)SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    DiskImage_AddMirror((DiskImage*)m_pDiskImage, m_pMirror);
+    createRawObjectFile(DISK_IMAGE_BYTES_PER_SECTOR, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("RWTS16,SectorDiskImageTest.bin,0,256,0,1" LINE_ENDING));
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    validateFileSector(0, 7, 0xff);
+    
+    const unsigned char* pMirrorImage = DiskImage_GetImagePointer(m_pMirror);
+    validateAllZeroes(pMirrorImage, 8 * DISK_IMAGE_BYTES_PER_SECTOR);
+    validateFill(pMirrorImage + 8 * DISK_IMAGE_BYTES_PER_SECTOR, DISK_IMAGE_BYTES_PER_SECTOR, 0xff);
+}
+
+TEST(SectorDiskImage, ProcessScriptIntoTwoMirrors)
+{
+    DiskImage* pNibbleMirror = NULL;
+    
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    m_pMirror = (DiskImage*)SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    pNibbleMirror = (DiskImage*)NibbleDiskImage_Create();
+    DiskImage_AddMirror((DiskImage*)m_pDiskImage, m_pMirror);
+    DiskImage_AddMirror((DiskImage*)m_pDiskImage, pNibbleMirror);
+    createRawObjectFile(DISK_IMAGE_BYTES_PER_SECTOR, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("RWTS16,SectorDiskImageTest.bin,0,256,0,1" LINE_ENDING));
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    CHECK_TRUE(0 == memcmp(SectorDiskImage_GetImagePointer(m_pDiskImage), DiskImage_GetImagePointer(m_pMirror), 
+                           SECTOR_DISK_IMAGE_SIZE));
+    const unsigned char* pNibbles = DiskImage_GetImagePointer(pNibbleMirror);
+    CHECK_TRUE(0 == memcmp(pNibbles + 528 + 384, "\xD5\xAA\x96", 3));
+    DiskImage_Free(pNibbleMirror);
+}
+
+TEST(SectorDiskImage, ReportBlockScriptLineUnsupportedByNibbleMirror)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    m_pMirror = (DiskImage*)NibbleDiskImage_Create();
+    DiskImage_AddMirror((DiskImage*)m_pDiskImage, m_pMirror);
+    createRawObjectFile(DISK_IMAGE_BLOCK_SIZE, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,SectorDiskImageTest.bin,0,512,1" LINE_ENDING));
+    STRCMP_EQUAL("<null>:1: error: BLOCK insertion type isn't supported for this output image type." LINE_ENDING,
+                 printfSpy_GetLastErrorOutput());
+    validateFileSector(0, 2, 0xff);
+    validateAllZeroes(DiskImage_GetImagePointer(m_pMirror), NIBBLE_DISK_IMAGE_SIZE);
+}
+
+TEST(SectorDiskImage, DontPassScriptLineWhichFailedOnPrimaryImageToMirror)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    m_pMirror = (DiskImage*)NibbleDiskImage_Create();
+    DiskImage_AddMirror((DiskImage*)m_pDiskImage, m_pMirror);
+    createRawObjectFile(DISK_IMAGE_RW18_BYTES_PER_TRACK, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("RW18,SectorDiskImageTest.bin,0,4608,0xa9,0,0" LINE_ENDING));
+    LONGS_EQUAL(1, printfSpy_GetCallCount());
+    validateAllZeroes(DiskImage_GetImagePointer(m_pMirror), NIBBLE_DISK_IMAGE_SIZE);
+}
+
+TEST(SectorDiskImage, PrintLayoutMapWithRWTS16AndBlockDomains)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_PRODOS_ORDER);
+    createRawObjectFile(DISK_IMAGE_BLOCK_SIZE, 0xff);
+    SectorDiskImage_ProcessScript(m_pDiskImage, copy("BLOCK,SectorDiskImageTest.bin,0,512,1" LINE_ENDING));
+
+    SectorDiskImage_PrintLayoutMap(m_pDiskImage);
+    LONGS_EQUAL(6, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  0x000200 - 0x0003ff used by line 1\n", printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  0x000400 - 0x022fff free\n", printfSpy_GetLastOutput());
+}
+
+TEST(SectorDiskImage, WriteImage)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    insertRWTS16Sectors(0, 1, 1);
+    SectorDiskImage_WriteImage(m_pDiskImage, g_imageFilename);
+    
+    const unsigned char* pImage = readDiskImageIntoMemory();
+    validateAllZeroes(pImage, 7 * DISK_IMAGE_BYTES_PER_SECTOR);
+    validateFill(pImage + 7 * DISK_IMAGE_BYTES_PER_SECTOR, DISK_IMAGE_BYTES_PER_SECTOR, 1);
+    validateAllZeroes(pImage + 8 * DISK_IMAGE_BYTES_PER_SECTOR, SECTOR_DISK_IMAGE_SIZE - 8 * DISK_IMAGE_BYTES_PER_SECTOR);
+}
+
+TEST(SectorDiskImage, FailFOpenInWriteImage)
+{
+    m_pDiskImage = SectorDiskImage_Create(SECTOR_DISK_IMAGE_DOS_ORDER);
+    fopenFail(NULL);
+        __try_and_catch( SectorDiskImage_WriteImage(m_pDiskImage, g_imageFilename) );
+    fopenRestore();
+    validateExceptionThrown(fileOpenException);
+}
@@ -0,0 +1,335 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "WozDiskImage.h"
+    #include "NibbleDiskImage.h"
+    #include "Crc32.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_imageFilename = "WozDiskImageTest.woz";
+static const char* g_rawFilename = "WozDiskImageTest.bin";
+static const char* g_scriptFilename = "WozDiskImageTest.script";
+static const char* g_planFilename = "WozDiskImageTest.script.plan";
+static const char* g_manifestFilename = "WozDiskImageTest.woz.manifest";
+
+/* Sync bytes followed by 2 zero bits form this repeating 5 byte pattern in the bitstream. */
+static const unsigned char g_syncPattern[] = { 0xFF, 0x3F, 0xCF, 0xF3, 0xFC };
+
+
+TEST_GROUP(WozDiskImage)
+{
+    WozDiskImage*  m_pDiskImage;
+    unsigned char* m_pWoz;
+    long           m_wozSize;
+    char           m_buffer[256];
+    
+    void setup()
+    {
+        clearExceptionCode();
+        printfSpy_Hook(512);
+        m_pDiskImage = NULL;
+        m_pWoz = NULL;
+        m_wozSize = 0;
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        printfSpy_Unhook();
+        DiskImage_Free((DiskImage*)m_pDiskImage);
+        free(m_pWoz);
+        remove(g_imageFilename);
+        remove(g_rawFilename);
+        remove(g_scriptFilename);
+        remove(g_planFilename);
+        remove(g_manifestFilename);
+    }
+    
+    char* copy(const char* pStringToCopy)
+    {
+        CHECK(strlen(pStringToCopy) < sizeof(m_buffer) - 1);
+        strcpy(m_buffer, pStringToCopy);
+        return m_buffer;
+    }
+    
+    void insertZeroSectors(DiskImageInsertionType type, unsigned int track, unsigned int sectorOrOffset, unsigned int length)
+    {
+        unsigned char* pData = (unsigned char*)calloc(1, length ? length : 1);
+        DiskImageInsert insert;
+        
+        insert.type = type;
+        insert.sourceOffset = 0;
+        insert.length = length;
+        insert.side = DISK_IMAGE_RW18_SIDE_0;
+        insert.track = track;
+        insert.sector = sectorOrOffset;
+        WozDiskImage_InsertData(m_pDiskImage, pData, &insert);
+        free(pData);
+    }
+    
+    void writeAndReadBackImage()
+    {
+        WozDiskImage_WriteImage(m_pDiskImage, g_imageFilename);
+        readBackImage();
+    }
+    
+    void readBackImage()
+    {
+        FILE* pFile = fopen(g_imageFilename, "rb");
+        CHECK(pFile != NULL);
+        fseek(pFile, 0, SEEK_END);
+        m_wozSize = ftell(pFile);
+        fseek(pFile, 0, SEEK_SET);
+        free(m_pWoz);
+        m_pWoz = (unsigned char*)malloc(m_wozSize);
+        LONGS_EQUAL(m_wozSize, fread(m_pWoz, 1, m_wozSize, pFile));
+        fclose(pFile);
+    }
+    
+    unsigned int read16(unsigned int offset)
+    {
+        return m_pWoz[offset] | (m_pWoz[offset + 1] << 8);
+    }
+    
+    unsigned int read32(unsigned int offset)
+    {
+        return read16(offset) | (read16(offset + 2) << 16);
+    }
+    
+    unsigned int trackEntryOffset(unsigned int track)
+    {
+        return WOZ_DISK_IMAGE_TRKS_OFFSET + WOZ_DISK_IMAGE_CHUNK_HEADER + track * WOZ_DISK_IMAGE_TRK_ENTRY_SIZE;
+    }
+    
+    unsigned char trackMap(unsigned int quarterTrack)
+    {
+        return m_pWoz[WOZ_DISK_IMAGE_TMAP_OFFSET + WOZ_DISK_IMAGE_CHUNK_HEADER + quarterTrack];
+    }
+    
+    void validateHeaderAndChunks()
+    {
+        CHECK_TRUE(m_wozSize >= WOZ_DISK_IMAGE_BITS_OFFSET);
+        LONGS_EQUAL(0, m_wozSize % WOZ_DISK_IMAGE_BLOCK_SIZE);
+        CHECK_TRUE(0 == memcmp(m_pWoz, "WOZ2\xFF\x0A\x0D\x0A", 8));
+        LONGS_EQUAL(Crc32_Buffer(m_pWoz + WOZ_DISK_IMAGE_HEADER_SIZE, m_wozSize - WOZ_DISK_IMAGE_HEADER_SIZE, 0), 
+                    read32(8));
+        CHECK_TRUE(0 == memcmp(m_pWoz + WOZ_DISK_IMAGE_INFO_OFFSET, "INFO", 4));
+        LONGS_EQUAL(60, read32(WOZ_DISK_IMAGE_INFO_OFFSET + 4));
+        CHECK_TRUE(0 == memcmp(m_pWoz + WOZ_DISK_IMAGE_TMAP_OFFSET, "TMAP", 4));
+        LONGS_EQUAL(WOZ_DISK_IMAGE_QUARTER_TRACKS, read32(WOZ_DISK_IMAGE_TMAP_OFFSET + 4));
+        CHECK_TRUE(0 == memcmp(m_pWoz + WOZ_DISK_IMAGE_TRKS_OFFSET, "TRKS", 4));
+        LONGS_EQUAL(m_wozSize - WOZ_DISK_IMAGE_TRKS_OFFSET - WOZ_DISK_IMAGE_CHUNK_HEADER, 
+                    read32(WOZ_DISK_IMAGE_TRKS_OFFSET + 4));
+    }
+    
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+    
+    void createSectorObjectFile()
+    {
+        unsigned char sector[DISK_IMAGE_BYTES_PER_SECTOR];
+        FILE*         pFile = fopen(g_rawFilename, "wb");
+        memset(sector, 0xA5, sizeof(sector));
+        fwrite(sector, 1, sizeof(sector), pFile);
+        fclose(pFile);
+    }
+    
+    void createTextFile(const char* pFilename, const char* pText)
+    {
+        FILE* pFile = fopen(pFilename, "wb");
+        fwrite(pText, 1, strlen(pText), pFile);
+        fclose(pFile);
+    }
+};
+
+
+TEST(WozDiskImage, FailAllAllocationInCreate)
+{
+    static const int allocationsToFail = 4;
+    for (int i = 1 ; i <= allocationsToFail ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pDiskImage = WozDiskImage_Create() );
+        validateExceptionThrown(outOfMemoryException);
+    }
+
+    MallocFailureInject_FailAllocation(allocationsToFail + 1);
+    m_pDiskImage = WozDiskImage_Create();
+    CHECK_TRUE(m_pDiskImage != NULL);
+}
+
+TEST(WozDiskImage, WriteEmptyImageWithNoTracks)
+{
+    m_pDiskImage = WozDiskImage_Create();
+    LONGS_EQUAL(NIBBLE_DISK_IMAGE_SIZE, WozDiskImage_GetNibbleSize(m_pDiskImage));
+    writeAndReadBackImage();
+    
+    LONGS_EQUAL(WOZ_DISK_IMAGE_BITS_OFFSET, m_wozSize);
+    validateHeaderAndChunks();
+    for (unsigned int i = 0 ; i < WOZ_DISK_IMAGE_QUARTER_TRACKS ; i++)
+        LONGS_EQUAL(WOZ_DISK_IMAGE_NO_TRACK, trackMap(i));
+    for (unsigned int i = 0 ; i < WOZ_DISK_IMAGE_QUARTER_TRACKS ; i++)
+        LONGS_EQUAL(0, read32(trackEntryOffset(i)) | read32(trackEntryOffset(i) + 4));
+}
+
+TEST(WozDiskImage, WriteInfoChunk)
+{
+    static const unsigned int info = WOZ_DISK_IMAGE_INFO_OFFSET + WOZ_DISK_IMAGE_CHUNK_HEADER;
+    m_pDiskImage = WozDiskImage_Create();
+    insertZeroSectors(DISK_IMAGE_INSERTION_RWTS16, 0, 0, DISK_IMAGE_BYTES_PER_SECTOR);
+    writeAndReadBackImage();
+    
+    LONGS_EQUAL(2, m_pWoz[info + 0]);
+    LONGS_EQUAL(1, m_pWoz[info + 1]);
+    LONGS_EQUAL(0, m_pWoz[info + 2]);
+    CHECK_TRUE(0 == memcmp(m_pWoz + info + 5, "crackle ", 8));
+    LONGS_EQUAL(' ', m_pWoz[info + 5 + 31]);
+    LONGS_EQUAL(1, m_pWoz[info + 37]);
+    LONGS_EQUAL(32, m_pWoz[info + 39]);
+    LONGS_EQUAL(14, read16(info + 44));
+}
+
+TEST(WozDiskImage, WriteOneRWTS16SectorWithTenBitSyncBytes)
+{
+    /* 528 gap 1 and 5 gap 2 sync bytes each add 2 bits to the 6656 nibbles of the track. */
+    static const unsigned int expectedBitCount = 6656 * 8 + (528 + 5) * 2;
+    static const unsigned int addressField = WOZ_DISK_IMAGE_BITS_OFFSET + 528 * 10 / 8;
+    m_pDiskImage = WozDiskImage_Create();
+    insertZeroSectors(DISK_IMAGE_INSERTION_RWTS16, 0, 0, DISK_IMAGE_BYTES_PER_SECTOR);
+    writeAndReadBackImage();
+    
+    validateHeaderAndChunks();
+    LONGS_EQUAL(WOZ_DISK_IMAGE_BITS_OFFSET / WOZ_DISK_IMAGE_BLOCK_SIZE, read16(trackEntryOffset(0)));
+    LONGS_EQUAL(14, read16(trackEntryOffset(0) + 2));
+    LONGS_EQUAL(expectedBitCount, read32(trackEntryOffset(0) + 4));
+    LONGS_EQUAL(WOZ_DISK_IMAGE_BITS_OFFSET + 14 * WOZ_DISK_IMAGE_BLOCK_SIZE, m_wozSize);
+    for (unsigned int i = WOZ_DISK_IMAGE_BITS_OFFSET ; i < addressField ; i += sizeof(g_syncPattern))
+        CHECK_TRUE(0 == memcmp(m_pWoz + i, g_syncPattern, sizeof(g_syncPattern)));
+    CHECK_TRUE(0 == memcmp(m_pWoz + addressField, "\xD5\xAA\x96", 3));
+}
+
+TEST(WozDiskImage, MapTrackToAdjacentQuarterTracks)
+{
+    m_pDiskImage = WozDiskImage_Create();
+    insertZeroSectors(DISK_IMAGE_INSERTION_RWTS16, 0, 0, DISK_IMAGE_BYTES_PER_SECTOR);
+    insertZeroSectors(DISK_IMAGE_INSERTION_RWTS16, 1, 0, DISK_IMAGE_BYTES_PER_SECTOR);
+    insertZeroSectors(DISK_IMAGE_INSERTION_RWTS16, 34, 0, DISK_IMAGE_BYTES_PER_SECTOR);
+    writeAndReadBackImage();
+    
+    LONGS_EQUAL(0, trackMap(0));
+    LONGS_EQUAL(0, trackMap(1));
+    LONGS_EQUAL(WOZ_DISK_IMAGE_NO_TRACK, trackMap(2));
+    LONGS_EQUAL(1, trackMap(3));
+    LONGS_EQUAL(1, trackMap(4));
+    LONGS_EQUAL(1, trackMap(5));
+    LONGS_EQUAL(WOZ_DISK_IMAGE_NO_TRACK, trackMap(6));
+    LONGS_EQUAL(WOZ_DISK_IMAGE_NO_TRACK, trackMap(134));
+    LONGS_EQUAL(34, trackMap(135));
+    LONGS_EQUAL(34, trackMap(136));
+    LONGS_EQUAL(34, trackMap(137));
+    LONGS_EQUAL(WOZ_DISK_IMAGE_NO_TRACK, trackMap(138));
+    LONGS_EQUAL(3, read16(trackEntryOffset(0)));
+    LONGS_EQUAL(3 + 14, read16(trackEntryOffset(1)));
+    LONGS_EQUAL(3 + 14 * 2, read16(trackEntryOffset(34)));
+    LONGS_EQUAL(0, read16(trackEntryOffset(2)));
+}
+
+TEST(WozDiskImage, WriteRW18TrackBitCount)
+{
+    /* RW18 tracks have 403 leading sync bytes plus 2 after each address field and 1 after each data field. */
+    static const unsigned int expectedBitCount = 6656 * 8 + (403 + 6 * 3 + 5 * 5) * 2;
+    m_pDiskImage = WozDiskImage_Create();
+    insertZeroSectors(DISK_IMAGE_INSERTION_RW18, 2, 0, DISK_IMAGE_RW18_BYTES_PER_TRACK);
+    writeAndReadBackImage();
+    
+    validateHeaderAndChunks();
+    LONGS_EQUAL(expectedBitCount, read32(trackEntryOffset(2) + 4));
+    LONGS_EQUAL(WOZ_DISK_IMAGE_NO_TRACK, trackMap(0));
+    LONGS_EQUAL(2, trackMap(8));
+}
+
+TEST(WozDiskImage, BitstreamMatchesNibblesOfSameImage)
+{
+    /* Stripping the 2 zero bits from each sync byte should give back the exact nibbles of the track. */
+    m_pDiskImage = WozDiskImage_Create();
+    insertZeroSectors(DISK_IMAGE_INSERTION_RWTS16, 5, 3, 2 * DISK_IMAGE_BYTES_PER_SECTOR);
+    writeAndReadBackImage();
+    
+    const unsigned char* pNibbles = WozDiskImage_GetNibblePointer(m_pDiskImage) + 5 * NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK;
+    unsigned int         bitCount = read32(trackEntryOffset(5) + 4);
+    unsigned int         bitOffset = 0;
+    const unsigned char* pBits = m_pWoz + read16(trackEntryOffset(5)) * WOZ_DISK_IMAGE_BLOCK_SIZE;
+    for (unsigned int i = 0 ; i < NIBBLE_DISK_IMAGE_NIBBLES_PER_TRACK ; i++)
+    {
+        unsigned int nibble = 0;
+        for (unsigned int bit = 0 ; bit < 8 ; bit++, bitOffset++)
+            nibble = (nibble << 1) | ((pBits[bitOffset / 8] >> (7 - bitOffset % 8)) & 1);
+        LONGS_EQUAL(pNibbles[i], nibble);
+        if (nibble == 0xFF && (pBits[bitOffset / 8] & (0x80 >> (bitOffset % 8))) == 0)
+            bitOffset += 2;
+    }
+    LONGS_EQUAL(bitCount, bitOffset);
+}
+
+TEST(WozDiskImage, ProcessScriptAndPrintLayoutMap)
+{
+    m_pDiskImage = WozDiskImage_Create();
+    createSectorObjectFile();
+    WozDiskImage_ProcessScript(m_pDiskImage, copy("RWTS16,WozDiskImageTest.bin,0,*,0,0" LINE_ENDING));
+    STRCMP_EQUAL("", printfSpy_GetLastErrorOutput());
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    
+    WozDiskImage_PrintLayoutMap(m_pDiskImage);
+    STRCMP_EQUAL("  0x000000 - 0x0000ff used by line 1\n", printfSpy_GetPreviousOutput());
+}
+
+TEST(WozDiskImage, UpdateImageAlwaysWritesCompleteWozImage)
+{
+    m_pDiskImage = WozDiskImage_Create();
+    createSectorObjectFile();
+    createTextFile(g_scriptFilename, "RWTS16,WozDiskImageTest.bin,0,*,0,0" LINE_ENDING);
+    WozDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    readBackImage();
+    validateHeaderAndChunks();
+    
+    DiskImage_Free((DiskImage*)m_pDiskImage);
+    m_pDiskImage = WozDiskImage_Create();
+    WozDiskImage_UpdateImage(m_pDiskImage, g_scriptFilename, g_imageFilename);
+    readBackImage();
+    validateHeaderAndChunks();
+    LONGS_EQUAL(0, trackMap(0));
+}
+
+TEST(WozDiskImage, FailFWriteInWriteImage)
+{
+    m_pDiskImage = WozDiskImage_Create();
+    fwriteFail(0);
+        __try_and_catch( WozDiskImage_WriteImage(m_pDiskImage, g_imageFilename) );
+    fwriteRestore();
+    validateExceptionThrown(fileException);
+}
@@ -81,9 +81,33 @@ TEST(MallocFailureInject, FailSecondReallocOutOfThree)
     reallocShouldPass();
 }
 
+TEST(MallocFailureInject, FailSecondAllocationWhenMixingMallocAndCalloc)
+{
+    MallocFailureInject_FailAllocation(2);
+    
+    void* pMalloc = hook_malloc(10);
+    CHECK(NULL != pMalloc);
+    
+    void* pCalloc = hook_calloc(2, 10);
+    POINTERS_EQUAL(NULL, pCalloc);
+    
+    free(pMalloc);
+}
+
+TEST(MallocFailureInject, CallocReturnsZeroedMemory)
+{
+    unsigned char* pAlloc = (unsigned char*)hook_calloc(4, 8);
+    CHECK(pAlloc != NULL);
+    for (int i = 0 ; i < 4 * 8 ; i++)
+        LONGS_EQUAL(0, pAlloc[i]);
+    hook_free(pAlloc);
+}
+
 TEST(MallocFailureInject, VerifyDefaultsSucceed)
 {
     void* pAlloc = hook_malloc(1);
     pAlloc = hook_realloc(pAlloc, 2);
     hook_free(pAlloc);
+    pAlloc = hook_calloc(1, 2);
+    hook_free(pAlloc);
 }
@@ -16,18 +16,25 @@
 #include <strings.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
 #include "AssemblerPriv.h"
 #include "ExpressionEval.h"
 #include "AddressingMode.h"
 #include "InstructionSets.h"
+#include "DebugMap.h"
 #include "TextFileSource.h"
 #include "LupSource.h"
 #include "MacroExpansionSource.h"
+#include "TraceLog.h"
+#include "AllocStats.h"
+#include "PerfCounters.h"
 
 static void commonObjectInit(Assembler* pThis, const AssemblerInitParams* pParams, TextFile* pTextFile);
 static FILE* createListFileOrRedirectToStdOut(Assembler* pThis, const AssemblerInitParams* pParams);
 static void createParseObjectForPutSearchPath(Assembler* ptThis, const AssemblerInitParams* pParams);
 static void createFullInstructionSetTables(Assembler* pThis); 
+static void createProfileCounters(Assembler* pThis, const AssemblerInitParams* pParams);
 static void create6502InstructionSetTable(Assembler* pThis);
 static int compareInstructionSetEntries(const void* pv1, const void* pv2);
 static void create65c02InstructionSetTable(Assembler* pThis);
@@ -82,6 +89,9 @@ static void commonObjectInit(Assembler* pThis, const AssemblerInitParams* pParam
         pThis->pDummyBuffer = BinaryBuffer_Create(SIZE_OF_OBJECT_AND_DUMMY_BUFFERS);
         createParseObjectForPutSearchPath(pThis, pParams);
         createFullInstructionSetTables(pThis);
+        createProfileCounters(pThis, pParams);
+        if (pParams && pParams->pDebugMapFilename)
+            pThis->pDebugMap = DebugMap_Create();
         pThis->pInitParams = pParams;
         pThis->pLineInfo = &pThis->linesHead;
         pThis->pCurrentBuffer = pThis->pObjectBuffer;
@@ -97,12 +107,14 @@ static void commonObjectInit(Assembler* pThis, const AssemblerInitParams* pParam
 
 static FILE* createListFileOrRedirectToStdOut(Assembler* pThis, const AssemblerInitParams* pParams)
 {
-    if (!pParams || !pParams->pListFilename)
+    if (!pParams || !pParams->pListFilename || pParams->skipListing)
         return stdout;
         
     pThis->pFileForListing = fopen(pParams->pListFilename, "wb");
     if (!pThis->pFileForListing)
         __throw(fileOpenException);
+    /* A listing has a line for every line of source so it is written out in large blocks. */
+    setvbuf(pThis->pFileForListing, NULL, _IOFBF, SIZE_OF_LIST_FILE_BUFFER);
     return pThis->pFileForListing;
 }
 
@@ -253,6 +265,16 @@ static void updateInstructionEntry(OpCodeEntry* pEntryToUpdate, const OpCodeEntr
     pEntryToUpdate->longImmediateIfLongXY = pAdditionalEntry->longImmediateIfLongXY;
 }
 
+static void createProfileCounters(Assembler* pThis, const AssemblerInitParams* pParams)
+{
+    size_t i;
+    
+    if (!pParams || !pParams->collectProfile)
+        return;
+    for (i = 0 ; i < ARRAYSIZE(pThis->opcodeProfiles) ; i++)
+        pThis->opcodeProfiles[i] = allocateAndZero(pThis->instructionSetSizes[i] * sizeof(*pThis->opcodeProfiles[i]));
+}
+
 static void initParameterVariablesTo0(Assembler* pThis)
 {
     initParameterVariableTo0(pThis, "]0");
@@ -300,6 +322,7 @@ __throws Assembler* Assembler_CreateFromFile(const char* pSourceFilename, const
         pThis = allocateAndZero(sizeof(*pThis));
         pTextFile = TextFile_CreateFromFile(NULL, &sourceFilename, NULL);
         commonObjectInit(pThis, pParams, pTextFile);
+        pThis->stats.filesOpened = 1;
     }
     __catch
     {
@@ -313,7 +336,10 @@ __throws Assembler* Assembler_CreateFromFile(const char* pSourceFilename, const
 
 static void freeLines(Assembler* pThis);
 static void freeConditionals(Assembler* pThis);
+static void freeMacroDefinitions(Assembler* pThis);
 static void freeInstructionSets(Assembler* pThis);
+static void freeProfile(Assembler* pThis);
+static void freeImportedSymbolFiles(Assembler* pThis);
 void Assembler_Free(Assembler* pThis)
 {
     if (!pThis)
@@ -321,12 +347,16 @@ void Assembler_Free(Assembler* pThis)
     
     freeLines(pThis);
     freeConditionals(pThis);
+    freeMacroDefinitions(pThis);
     freeInstructionSets(pThis);
+    freeProfile(pThis);
     ParseCSV_Free(pThis->pPutSearchPath);
     ListFile_Free(pThis->pListFile);
+    DebugMap_Free(pThis->pDebugMap);
     BinaryBuffer_Free(pThis->pDummyBuffer);
     BinaryBuffer_Free(pThis->pObjectBuffer);
     SymbolTable_Free(pThis->pSymbols);
+    freeImportedSymbolFiles(pThis);
     TextSource_FreeAll();
     if (pThis->pFileForListing)
         fclose(pThis->pFileForListing);
@@ -357,6 +387,19 @@ static void freeConditionals(Assembler* pThis)
     }
 }
 
+static void freeMacroDefinitions(Assembler* pThis)
+{
+    MacroDefinition* pCurr = pThis->pMacroDefinitionsList;
+    
+    while (pCurr)
+    {
+        MacroDefinition* pNext = pCurr->pNext;
+        free(pCurr->macroExpansionLines);
+        free(pCurr);
+        pCurr = pNext;
+    }
+}
+
 static void freeInstructionSets(Assembler* pThis)
 {
     size_t i;
@@ -367,13 +410,34 @@ static void freeInstructionSets(Assembler* pThis)
     }
 }
 
+static void freeProfile(Assembler* pThis)
+{
+    size_t i;
+    
+    for (i = 0 ; i < ARRAYSIZE(pThis->opcodeProfiles) ; i++)
+        free(pThis->opcodeProfiles[i]);
+    free(pThis->pOpcodeProfileEntries);
+}
 
+static void freeImportedSymbolFiles(Assembler* pThis)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pThis->importedSymbolFileCount ; i++)
+        SymbolFile_Free(pThis->ppImportedSymbolFiles[i]);
+    free(pThis->ppImportedSymbolFiles);
+}
+
+
+static void importSymbolFiles(Assembler* pThis);
 static void firstPass(Assembler* pThis);
 static int getNextSourceLine(Assembler* pThis, SizedString* pLine);
 static int attemptToPopTextFileAndGetNextLine(Assembler* pThis, SizedString* pLine);
 static void parseLine(Assembler* pThis, const SizedString* pLine);
 static int shouldSkipSourceLines(Assembler* pThis);
 static void prepareLineInfoForThisLine(Assembler* pThis, const SizedString* pLine);
+static int isStreamingListing(Assembler* pThis);
+static void releaseFinalLines(Assembler* pThis);
 static void rememberLabelIfGlobal(Assembler* pThis);
 static int doesLineContainALabel(Assembler* pThis);
 static int isGlobalLabelName(SizedString* pLabelName);
@@ -493,20 +557,161 @@ static void checkForUndefinedSymbols(Assembler* pThis);
 static void checkSymbolForOutstandingForwardReferences(Assembler* pThis, Symbol* pSymbol);
 static void checkForOpenConditionals(Assembler* pThis);
 static void secondPass(Assembler* pThis);
-static void outputListFile(Assembler* pThis);
+static int isKeepingOutputInMemory(Assembler* pThis);
+static int shouldOutputListFile(Assembler* pThis);
+static void outputRemainingLines(Assembler* pThis);
+static void startPhaseClock(Assembler* pThis, struct timeval* pStartTime);
+static void runPhase(Assembler* pThis, const char* pPhaseName, void (*phase)(Assembler*), 
+                     struct timeval* pStartTime, unsigned int* pMicroseconds);
+static void stopPhaseClock(Assembler* pThis, struct timeval* pStartTime, unsigned int* pMicroseconds);
 void Assembler_Run(Assembler* pThis)
 {
-    firstPass(pThis);
-    checkForUndefinedSymbols(pThis);
-    checkForOpenConditionals(pThis);
-    secondPass(pThis);
+    struct timeval phaseStartTime;
+    
+    TraceLog_Begin("snap", "assemble %s", TextSource_GetFilename(pThis->pTextSourceStack));
+    startPhaseClock(pThis, &phaseStartTime);
+    runPhase(pThis, "symbol import", importSymbolFiles, &phaseStartTime, &pThis->stats.symbolImportMicroseconds);
+    runPhase(pThis, "first pass", firstPass, &phaseStartTime, &pThis->stats.firstPassMicroseconds);
+    runPhase(pThis, "undefined symbol check", checkForUndefinedSymbols, 
+             &phaseStartTime, &pThis->stats.undefinedSymbolCheckMicroseconds);
+    runPhase(pThis, "open conditional check", checkForOpenConditionals, 
+             &phaseStartTime, &pThis->stats.openConditionalCheckMicroseconds);
+    runPhase(pThis, "second pass", secondPass, &phaseStartTime, &pThis->stats.secondPassMicroseconds);
+    TraceLog_End();
+}
+
+static int isCollectingStats(Assembler* pThis);
+static void startPhaseClock(Assembler* pThis, struct timeval* pStartTime)
+{
+    if (isCollectingStats(pThis))
+        gettimeofday(pStartTime, NULL);
+}
+
+static int isCollectingStats(Assembler* pThis)
+{
+    return pThis->pInitParams && pThis->pInitParams->collectStats;
+}
+
+static void runPhase(Assembler* pThis, const char* pPhaseName, void (*phase)(Assembler*), 
+                     struct timeval* pStartTime, unsigned int* pMicroseconds)
+{
+    TraceLog_Begin("snap", "%s", pPhaseName);
+    PerfCounters_Begin(pPhaseName);
+    phase(pThis);
+    PerfCounters_End();
+    TraceLog_End();
+    stopPhaseClock(pThis, pStartTime, pMicroseconds);
+}
+
+static void stopPhaseClock(Assembler* pThis, struct timeval* pStartTime, unsigned int* pMicroseconds)
+{
+    struct timeval endTime;
+    
+    if (!isCollectingStats(pThis))
+        return;
+    gettimeofday(&endTime, NULL);
+    *pMicroseconds = (unsigned int)((endTime.tv_sec - pStartTime->tv_sec) * 1000000 + 
+                                    (endTime.tv_usec - pStartTime->tv_usec));
+    /* The next phase starts where this one ended. */
+    *pStartTime = endTime;
+}
+
+static void importSymbolFile(Assembler* pThis, const SizedString* pFilename);
+static void importSymbolFiles(Assembler* pThis)
+{
+    ParseCSV* pParser = NULL;
+    
+    if (!pThis->pInitParams || !pThis->pInitParams->pImportSymbolFilenames)
+        return;
+    
+    __try
+    {
+        SizedString        filenames = SizedString_InitFromString(pThis->pInitParams->pImportSymbolFilenames);
+        const SizedString* pFields;
+        size_t             fieldCount;
+        size_t             i;
+        
+        pParser = ParseCSV_CreateWithCustomSeparator(';');
+        ParseCSV_Parse(pParser, &filenames);
+        fieldCount = ParseCSV_FieldCount(pParser);
+        pFields = ParseCSV_FieldPointers(pParser);
+        pThis->ppImportedSymbolFiles = allocateAndZero(fieldCount * sizeof(*pThis->ppImportedSymbolFiles));
+        for (i = 0 ; i < fieldCount ; i++)
+            importSymbolFile(pThis, &pFields[i]);
+    }
+    __catch
+    {
+        LOG_ERROR(pThis, "Failed to import symbols from %s.", pThis->pInitParams->pImportSymbolFilenames);
+        clearExceptionCode();
+    }
+    ParseCSV_Free(pParser);
+}
+
+static void addImportedSymbols(Assembler* pThis, SymbolFile* pSymbolFile, const SizedString* pFilename);
+static void importSymbolFile(Assembler* pThis, const SizedString* pFilename)
+{
+    char*       pFilenameString = NULL;
+    SymbolFile* pSymbolFile = NULL;
+    
+    __try
+    {
+        pFilenameString = SizedString_strdup(pFilename);
+        pSymbolFile = SymbolFile_CreateFromFile(pFilenameString);
+        pThis->ppImportedSymbolFiles[pThis->importedSymbolFileCount++] = pSymbolFile;
+        addImportedSymbols(pThis, pSymbolFile, pFilename);
+    }
+    __catch
+    {
+        LOG_ERROR(pThis, "Failed to import symbols from %.*s.", pFilename->stringLength, pFilename->pString);
+        clearExceptionCode();
+    }
+    free(pFilenameString);
 }
 
+static void addImportedSymbols(Assembler* pThis, SymbolFile* pSymbolFile, const SizedString* pFilename)
+{
+    SizedString nullLocalName = SizedString_InitFromString(NULL);
+    size_t      symbolCount = SymbolFile_GetSymbolCount(pSymbolFile);
+    size_t      i;
+    
+    /* The imported symbols are defined by the head of the line list, as the ]variables are, so that they are never
+       treated as forward references. */
+    for (i = 0 ; i < symbolCount ; i++)
+    {
+        SizedString name = SymbolFile_GetSymbolName(pSymbolFile, i);
+        Symbol*     pSymbol = SymbolTable_Find(pThis->pSymbols, &name, &nullLocalName);
+        
+        if (pSymbol)
+        {
+            LOG_ERROR(pThis, "'%.*s' symbol imported from %.*s has already been defined.", 
+                      name.stringLength, name.pString, pFilename->stringLength, pFilename->pString);
+            continue;
+        }
+        pSymbol = SymbolTable_Add(pThis->pSymbols, &name, &nullLocalName);
+        pSymbol->pDefinedLine = &pThis->linesHead;
+        pSymbol->expression = SymbolFile_GetSymbolExpression(pSymbolFile, i);
+        pSymbol->flags |= SYMBOL_FLAG_IMPORTED;
+        pThis->stats.symbolsImported++;
+    }
+}
+
+static void endTraceSpansOfUnpoppedSources(Assembler* pThis);
 static void firstPass(Assembler* pThis)
 {
     SizedString line;
     while (getNextSourceLine(pThis, &line))
         parseLine(pThis, &line);
+    endTraceSpansOfUnpoppedSources(pThis);
+}
+
+static void endTraceSpansOfUnpoppedSources(Assembler* pThis)
+{
+    /* Each source pushed on top of the main source file started a trace span.  Sources which end on the last line of
+       the source under them are left on the stack when the first pass completes. */
+    unsigned int depth;
+    
+    for (depth = TextSource_StackDepth(pThis->pTextSourceStack) ; depth > 1 ; depth--)
+        TraceLog_End();
 }
 
 static int getNextSourceLine(Assembler* pThis, SizedString* pLine)
@@ -520,6 +725,8 @@ static int getNextSourceLine(Assembler* pThis, SizedString* pLine)
 
 static int attemptToPopTextFileAndGetNextLine(Assembler* pThis, SizedString* pLine)
 {
+    if (TextSource_StackDepth(pThis->pTextSourceStack) > 1)
+        TraceLog_End();
     TextSource_StackPop(&pThis->pTextSourceStack);
     if (!pThis->pTextSourceStack)
         return 0;
@@ -556,7 +763,12 @@ static void parseLine(Assembler* pThis, const SizedString* pLine)
     firstPassAssembleLine(pThis);
     if (!shouldSkipSourceLines(pThis))
         addUnhandledLabel(pThis, originalProgramCounter);
+    else
+        pThis->stats.linesSkipped++;
+    pThis->stats.linesParsed++;
     pThis->programCounter += pThis->pLineInfo->machineCodeSize;
+    if (isStreamingListing(pThis))
+        releaseFinalLines(pThis);
 }
 
 static int shouldSkipSourceLines(Assembler* pThis)
@@ -566,7 +778,10 @@ static int shouldSkipSourceLines(Assembler* pThis)
 
 static void prepareLineInfoForThisLine(Assembler* pThis, const SizedString* pLine)
 {
-    LineInfo* pLineInfo = allocateAndZero(sizeof(*pLineInfo));
+    LineInfo* pLineInfo;
+    
+    AllocStats_SetTag(ALLOC_STATS_TAG_LINE_INFO);
+    pLineInfo = allocateAndZero(sizeof(*pLineInfo));
     pLineInfo->pTextSource = pThis->pTextSourceStack;
     pLineInfo->lineNumber = TextSource_GetLineNumber(pThis->pTextSourceStack);
     pLineInfo->lineText = *pLine;
@@ -578,6 +793,56 @@ static void prepareLineInfoForThisLine(Assembler* pThis, const SizedString* pLin
     pThis->pLineInfo = pLineInfo;
 }
 
+static int isStreamingListing(Assembler* pThis)
+{
+    return pThis->pInitParams && pThis->pInitParams->streamListing;
+}
+
+static LineInfo* findLineOfOutermostConditional(Assembler* pThis);
+static int isLineFinal(LineInfo* pLineInfo);
+static void outputLine(Assembler* pThis, LineInfo* pLineInfo);
+static void freeLine(Assembler* pThis, LineInfo* pLineInfo);
+static void releaseFinalLines(Assembler* pThis)
+{
+    /* Lines are listed and freed in order from the head of the list, stopping at the first one which can still be
+       updated by a forward reference or which an open DO/IF needs for its missing FIN warning.  The line just parsed 
+       is always kept since the next line is linked onto it. */
+    LineInfo* pConditionalLine = findLineOfOutermostConditional(pThis);
+    LineInfo* pCurr;
+    
+    while ((pCurr = pThis->linesHead.pNext) != pThis->pLineInfo && pCurr != pConditionalLine && isLineFinal(pCurr))
+    {
+        outputLine(pThis, pCurr);
+        pThis->linesHead.pNext = pCurr->pNext;
+        freeLine(pThis, pCurr);
+    }
+}
+
+static LineInfo* findLineOfOutermostConditional(Assembler* pThis)
+{
+    Conditional* pConditional = pThis->pConditionals;
+    
+    if (!pConditional)
+        return NULL;
+    while (pConditional->pPrev)
+        pConditional = pConditional->pPrev;
+    return pConditional->pLineInfo;
+}
+
+static int isLineFinal(LineInfo* pLineInfo)
+{
+    return pLineInfo->forwardReferenceCount == 0;
+}
+
+static void freeLine(Assembler* pThis, LineInfo* pLineInfo)
+{
+    /* The symbol defined on this line is left pointing at linesHead, like the parameter variables, so that it is
+       still seen as defined and a later line allocated at the same address can't be mistaken for this one. */
+    if (pLineInfo->pSymbol && pLineInfo->pSymbol->pDefinedLine == pLineInfo)
+        pLineInfo->pSymbol->pDefinedLine = &pThis->linesHead;
+    free(pLineInfo);
+}
+
 static void rememberLabelIfGlobal(Assembler* pThis)
 {
     if (!doesLineContainALabel(pThis) || shouldSkipSourceLines(pThis) || !isGlobalLabelName(&pThis->parsedLine.label))
@@ -763,23 +1028,80 @@ static int compareInstructionSetEntryToOperatorSizedString(const void* pvKey, co
     return SizedString_strcasecmp(pKey, pEntry->pOperator);
 }
 
+static ProfileCounter* findOpcodeProfileCounter(Assembler* pThis, const OpCodeEntry* pOpcodeEntry);
+static void startProfileClock(Assembler* pThis, struct timespec* pStartTime);
+static AddressingModes handleInstruction(Assembler* pThis, const OpCodeEntry* pOpcodeEntry);
+static void stopProfileClock(Assembler* pThis, struct timespec* pStartTime, 
+                             ProfileCounter* pOpcodeCounter, ProfileCounter* pAddressingModeCounter);
 static void handleOpcode(Assembler* pThis, const OpCodeEntry* pOpcodeEntry)
 {
-    AddressingMode addressingMode;
+    /* The counter is found up front since directives like XC change the instruction set. */
+    ProfileCounter* pOpcodeCounter = findOpcodeProfileCounter(pThis, pOpcodeEntry);
+    struct timespec startTime;
+    AddressingModes mode;
 
     if (shouldSkipSourceLines(pThis) && isOpcodeSkippable(pOpcodeEntry))
         return;
         
+    startProfileClock(pThis, &startTime);
     if (pOpcodeEntry->directiveHandler)
     {
         pOpcodeEntry->directiveHandler(pThis);
+        stopProfileClock(pThis, &startTime, pOpcodeCounter, NULL);
         return;
     }
+    mode = handleInstruction(pThis, pOpcodeEntry);
+    stopProfileClock(pThis, &startTime, pOpcodeCounter, &pThis->addressingModeProfiles[mode]);
+}
+
+static int isProfiling(Assembler* pThis);
+static ProfileCounter* findOpcodeProfileCounter(Assembler* pThis, const OpCodeEntry* pOpcodeEntry)
+{
+    InstructionSetSupported instructionSet = pThis->pLineInfo->instructionSet;
+    
+    if (!isProfiling(pThis))
+        return NULL;
+    return &pThis->opcodeProfiles[instructionSet][pOpcodeEntry - pThis->instructionSets[instructionSet]];
+}
+
+static int isProfiling(Assembler* pThis)
+{
+    return pThis->opcodeProfiles[INSTRUCTION_SET_6502] != NULL;
+}
+
+static void startProfileClock(Assembler* pThis, struct timespec* pStartTime)
+{
+    if (isProfiling(pThis))
+        clock_gettime(CLOCK_MONOTONIC, pStartTime);
+}
+
+static void stopProfileClock(Assembler* pThis, struct timespec* pStartTime, 
+                             ProfileCounter* pOpcodeCounter, ProfileCounter* pAddressingModeCounter)
+{
+    struct timespec    endTime;
+    unsigned long long nanoseconds;
     
+    if (!isProfiling(pThis))
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    nanoseconds = (unsigned long long)(endTime.tv_sec - pStartTime->tv_sec) * 1000000000ULL + 
+                  (unsigned long long)(endTime.tv_nsec - pStartTime->tv_nsec);
+    pOpcodeCounter->calls++;
+    pOpcodeCounter->nanoseconds += nanoseconds;
+    if (!pAddressingModeCounter)
+        return;
+    pAddressingModeCounter->calls++;
+    pAddressingModeCounter->nanoseconds += nanoseconds;
+}
+
+static AddressingModes handleInstruction(Assembler* pThis, const OpCodeEntry* pOpcodeEntry)
+{
+    AddressingMode addressingMode;
+
     __try
         addressingMode = AddressingMode_Eval(pThis, &pThis->parsedLine.operands);
     __catch
-        __nothrow;
+        __nothrow_and_return(ADDRESSING_MODE_INVALID);
         
     switch (addressingMode.mode)
     {
@@ -816,6 +1138,7 @@ static void handleOpcode(Assembler* pThis, const OpCodeEntry* pOpcodeEntry)
         handleZeroPageOrAbsoluteIndirectAddressingMode(pThis, &addressingMode, pOpcodeEntry);
         break;
     }
+    return addressingMode.mode;
 }
 
 static int isOpcodeSkippable(const OpCodeEntry* pOpcodeEntry)
@@ -1135,6 +1458,7 @@ static void updateLineWithForwardReference(Assembler* pThis, Symbol* pSymbol, Li
     pThis->pLineInfo = pLineInfo;
 
     Symbol_LineReferenceRemove(pSymbol, pLineInfo);
+    pThis->stats.forwardReferenceFixups++;
     flagLineInfoAsProcessingForwardReference(pLineInfo);
     ParseLine(&pThis->parsedLine, &pLineInfo->lineText);
     firstPassAssembleLine(pThis);
@@ -1732,12 +2056,14 @@ static void handlePUT(Assembler* pThis)
         TextSource* pTextSource = NULL;
 
         pIncludedFile = openPutFileUsingSearchPath(pThis, &filename);
+        pThis->stats.filesOpened++;
         pTextSource = TextFileSource_Create(pIncludedFile);
         while (numberOfInitialLinesToSkip != 0) {
             TextSource_GetNextLine(pTextSource);
             --numberOfInitialLinesToSkip;
         }
         TextSource_StackPush(&pThis->pTextSourceStack, pTextSource);
+        TraceLog_Begin("put", "PUT %s", TextSource_GetFilename(pTextSource));
         pIncludedFile = NULL;
     }
     __catch
@@ -2071,6 +2397,8 @@ static void handleLUP(Assembler* pThis)
         pTextSource = LupSource_Create(pLoopTextFile, expression.value);
         pLoopTextFile = NULL;
         TextSource_StackPush(&pThis->pTextSourceStack, pTextSource);
+        TraceLog_Begin("lup", "LUP %u", (unsigned int)expression.value);
+        pThis->stats.lupIterations += expression.value;
     }
     __catch
     {
@@ -2161,6 +2489,7 @@ static void handleMAC(Assembler* pThis)
                       macroName.stringLength, macroName.pString);
             __throw(invalidArgumentException);
         }
+        AllocStats_SetTag(ALLOC_STATS_TAG_MACRO_ARRAYS);
         macroExpansionLines = (SizedString*)malloc(sizeof(SizedString));
         if (!macroExpansionLines)
             __throw(outOfMemoryException);
@@ -2186,6 +2515,7 @@ static void handleMAC(Assembler* pThis)
                     LOG_ERROR(pThis, "too many lines in %s macro definition", "MAC");
                     __throw(bufferOverrunException);
                 }
+                AllocStats_SetTag(ALLOC_STATS_TAG_MACRO_ARRAYS);
                 macroExpansionLines = (SizedString*)realloc(macroExpansionLines, arrayCapacity * sizeof(SizedString));
                 if (!macroExpansionLines)
                     __throw(outOfMemoryException);
@@ -2252,6 +2582,8 @@ static void handleMacroExpansion(Assembler* pThis, const MacroDefinition* pMacro
                                               pMacroDefinition->macroExpansionLines,
                                               pMacroDefinition->numberOfLines);
     TextSource_StackPush(&pThis->pTextSourceStack, pTextSource);
+    TraceLog_Begin("macro", "%.*s", (int)pMacroDefinition->macroName.stringLength, pMacroDefinition->macroName.pString);
+    pThis->stats.macroExpansions++;
 }
 
 static void checkForUndefinedSymbols(Assembler* pThis)
@@ -2286,11 +2618,20 @@ static void checkForOpenConditionals(Assembler* pThis)
         LOG_LINE_WARNING(pThis, pThis->pConditionals->pLineInfo, "%s directive is missing matching FIN directive.", "DO/IF");
 }
 
+static void writeDebugMap(Assembler* pThis);
+static int isExportingSymbols(Assembler* pThis);
+static void writeSymbolFile(Assembler* pThis);
 static void secondPass(Assembler* pThis)
 {
-    outputListFile(pThis);
+    outputRemainingLines(pThis);
     if (pThis->errorCount > 0)
         return;
+    if (pThis->pDebugMap)
+        writeDebugMap(pThis);
+    if (isExportingSymbols(pThis))
+        writeSymbolFile(pThis);
+    if (isKeepingOutputInMemory(pThis))
+        return;
     __try
     {
         BinaryBuffer_ProcessWriteFileQueue(pThis->pObjectBuffer);
@@ -2302,15 +2643,84 @@ static void secondPass(Assembler* pThis)
     }
 }
 
-static void outputListFile(Assembler* pThis)
+static int shouldOutputListFile(Assembler* pThis)
+{
+    if (pThis->pInitParams && pThis->pInitParams->skipListing)
+        return 0;
+    return !isKeepingOutputInMemory(pThis) || pThis->pFileForListing;
+}
+
+static int isKeepingOutputInMemory(Assembler* pThis)
+{
+    return pThis->pInitParams && pThis->pInitParams->keepOutputInMemory;
+}
+
+static void outputRemainingLines(Assembler* pThis)
 {
     LineInfo* pCurr = pThis->linesHead.pNext;
     
     while(pCurr)
     {
-        ListFile_OutputLine(pThis->pListFile, pCurr);
+        outputLine(pThis, pCurr);
         pCurr = pCurr->pNext;
     }
+    if (shouldOutputListFile(pThis))
+        ListFile_Flush(pThis->pListFile);
+}
+
+static void outputLine(Assembler* pThis, LineInfo* pLineInfo)
+{
+    if (shouldOutputListFile(pThis))
+        ListFile_OutputLine(pThis->pListFile, pLineInfo);
+    if (pThis->pDebugMap)
+        DebugMap_AddLine(pThis->pDebugMap, pLineInfo->address, pLineInfo->machineCodeSize,
+                         TextSource_GetFilename(pLineInfo->pTextSource), pLineInfo->lineNumber, pLineInfo->pSymbol);
+}
+
+static int isSymbolForDebugMap(Symbol* pSymbol);
+static void writeDebugMap(Assembler* pThis)
+{
+    __try
+    {
+        Symbol* pSymbol;
+        
+        SymbolTable_EnumStart(pThis->pSymbols);
+        while (NULL != (pSymbol = SymbolTable_EnumNext(pThis->pSymbols)))
+        {
+            if (isSymbolForDebugMap(pSymbol))
+                DebugMap_AddSymbol(pThis->pDebugMap, pSymbol);
+        }
+        DebugMap_WriteToFile(pThis->pDebugMap, pThis->pInitParams->pDebugMapFilename);
+    }
+    __catch
+    {
+        LOG_ERROR(pThis, "Failed to save %s.", "debug map");
+        __rethrow;
+    }
+}
+
+static int isSymbolForDebugMap(Symbol* pSymbol)
+{
+    /* ]variables are left out since they take on a different value each time that they are set. */
+    return pSymbol->pDefinedLine != NULL && pSymbol->globalKey.pString && pSymbol->globalKey.pString[0] != ']';
+}
+
+static int isExportingSymbols(Assembler* pThis)
+{
+    return pThis->pInitParams && pThis->pInitParams->pExportSymbolFilename;
+}
+
+static void writeSymbolFile(Assembler* pThis)
+{
+    __try
+    {
+        SymbolFile_Write(pThis->pSymbols, pThis->pInitParams->pExportSymbolFilename);
+    }
+    __catch
+    {
+        LOG_ERROR(pThis, "Failed to save %s.", "symbol file");
+        __rethrow;
+    }
 }
 
 
@@ -2326,6 +2736,137 @@ unsigned int Assembler_GetWarningCount(Assembler* pThis)
 }
 
 
+void Assembler_GetStats(Assembler* pThis, AssemblerStats* pStats)
+{
+    /* The sizes are only gathered when asked for so that they cost nothing during assembly. */
+    *pStats = pThis->stats;
+    pStats->symbolCount = (unsigned int)SymbolTable_GetSymbolCount(pThis->pSymbols);
+    pStats->maxSymbolChainLength = (unsigned int)SymbolTable_GetMaxChainLength(pThis->pSymbols);
+    pStats->bytesEmitted = (unsigned int)BinaryBuffer_GetAllocatedSize(pThis->pObjectBuffer);
+}
+
+
+static void mergeOpcodeProfiles(Assembler* pThis, InstructionSetSupported instructionSet);
+static size_t removeUncalledAndSortProfileEntries(AssemblerProfileEntry* pEntries, size_t entryCount);
+static int compareProfileEntries(const void* pv1, const void* pv2);
+__throws const AssemblerProfileEntry* Assembler_GetOpcodeProfile(Assembler* pThis, size_t* pEntryCount)
+{
+    const OpCodeEntry* pAllEntries = pThis->instructionSets[INSTRUCTION_SET_65816];
+    size_t             allEntryCount = pThis->instructionSetSizes[INSTRUCTION_SET_65816];
+    size_t             i;
+    
+    *pEntryCount = 0;
+    if (!isProfiling(pThis))
+        return NULL;
+    
+    free(pThis->pOpcodeProfileEntries);
+    pThis->pOpcodeProfileEntries = NULL;
+    pThis->pOpcodeProfileEntries = allocateAndZero(allEntryCount * sizeof(*pThis->pOpcodeProfileEntries));
+    for (i = 0 ; i < allEntryCount ; i++)
+        pThis->pOpcodeProfileEntries[i].pName = pAllEntries[i].pOperator;
+    for (i = 0 ; i < INSTRUCTION_SET_INVALID ; i++)
+        mergeOpcodeProfiles(pThis, (InstructionSetSupported)i);
+    *pEntryCount = removeUncalledAndSortProfileEntries(pThis->pOpcodeProfileEntries, allEntryCount);
+    
+    return pThis->pOpcodeProfileEntries;
+}
+
+static void mergeOpcodeProfiles(Assembler* pThis, InstructionSetSupported instructionSet)
+{
+    /* Every mnemonic is in the 65816 instruction set so the counts from each set are merged into its entries. */
+    const OpCodeEntry* pAllEntries = pThis->instructionSets[INSTRUCTION_SET_65816];
+    size_t             allEntryCount = pThis->instructionSetSizes[INSTRUCTION_SET_65816];
+    size_t             i;
+    
+    for (i = 0 ; i < pThis->instructionSetSizes[instructionSet] ; i++)
+    {
+        const ProfileCounter*  pCounter = &pThis->opcodeProfiles[instructionSet][i];
+        SizedString            name;
+        const OpCodeEntry*     pFoundEntry;
+        AssemblerProfileEntry* pProfileEntry;
+        
+        if (pCounter->calls == 0)
+            continue;
+        name = SizedString_InitFromString(pThis->instructionSets[instructionSet][i].pOperator);
+        pFoundEntry = bsearch(&name, pAllEntries, allEntryCount, sizeof(*pAllEntries), 
+                              compareInstructionSetEntryToOperatorSizedString);
+        assert ( pFoundEntry );
+        pProfileEntry = &pThis->pOpcodeProfileEntries[pFoundEntry - pAllEntries];
+        pProfileEntry->calls += pCounter->calls;
+        pProfileEntry->nanoseconds += pCounter->nanoseconds;
+    }
+}
+
+static size_t removeUncalledAndSortProfileEntries(AssemblerProfileEntry* pEntries, size_t entryCount)
+{
+    size_t calledCount = 0;
+    size_t i;
+    
+    for (i = 0 ; i < entryCount ; i++)
+    {
+        if (pEntries[i].calls)
+            pEntries[calledCount++] = pEntries[i];
+    }
+    qsort(pEntries, calledCount, sizeof(*pEntries), compareProfileEntries);
+    
+    return calledCount;
+}
+
+static int compareProfileEntries(const void* pv1, const void* pv2)
+{
+    const AssemblerProfileEntry* p1 = (const AssemblerProfileEntry*)pv1;
+    const AssemblerProfileEntry* p2 = (const AssemblerProfileEntry*)pv2;
+    
+    if (p1->nanoseconds != p2->nanoseconds)
+        return p1->nanoseconds > p2->nanoseconds ? -1 : 1;
+    if (p1->calls != p2->calls)
+        return p1->calls > p2->calls ? -1 : 1;
+    return strcmp(p1->pName, p2->pName);
+}
+
+const AssemblerProfileEntry* Assembler_GetAddressingModeProfile(Assembler* pThis, size_t* pEntryCount)
+{
+    static const char* const addressingModeNames[NUMBER_OF_ADDRESSING_MODES] =
+    {
+        "absolute",
+        "immediate",
+        "implied",
+        "absolute,X",
+        "absolute,Y",
+        "(indirect,X)",
+        "(indirect),Y",
+        "(indirect)",
+        "invalid"
+    };
+    size_t i;
+    
+    *pEntryCount = 0;
+    if (!isProfiling(pThis))
+        return NULL;
+    
+    for (i = 0 ; i < NUMBER_OF_ADDRESSING_MODES ; i++)
+    {
+        pThis->addressingModeProfileEntries[i].pName = addressingModeNames[i];
+        pThis->addressingModeProfileEntries[i].calls = pThis->addressingModeProfiles[i].calls;
+        pThis->addressingModeProfileEntries[i].nanoseconds = pThis->addressingModeProfiles[i].nanoseconds;
+    }
+    *pEntryCount = removeUncalledAndSortProfileEntries(pThis->addressingModeProfileEntries, NUMBER_OF_ADDRESSING_MODES);
+    
+    return pThis->addressingModeProfileEntries;
+}
+
+
+void Assembler_OutputFileEnumStart(Assembler* pThis)
+{
+    BinaryBuffer_WriteFileQueueEnumStart(pThis->pObjectBuffer);
+}
+
+int Assembler_OutputFileEnumNext(Assembler* pThis, BinaryBufferFile* pFile)
+{
+    return BinaryBuffer_WriteFileQueueEnumNext(pThis->pObjectBuffer, pFile);
+}
+
+
 static void throwIfForwardReferencesAreDisallowed(Assembler* pThis);
 static int areForwardReferencesDisallowed(Assembler* pThis);
 __throws Symbol* Assembler_FindLabel(Assembler* pThis, SizedString* pLabelName)
@@ -24,12 +24,17 @@
 #include "ListFile.h"
 #include "SizedString.h"
 #include "BinaryBuffer.h"
+#include "DebugMap.h"
+#include "SymbolFile.h"
 #include "ParseCSV.h"
+#include "AddressingMode.h"
 #include "util.h"
 
 
 #define NUMBER_OF_SYMBOL_TABLE_HASH_BUCKETS 511
 #define SIZE_OF_OBJECT_AND_DUMMY_BUFFERS    (64 * 1024)
+#define SIZE_OF_LIST_FILE_BUFFER            (64 * 1024)
+#define NUMBER_OF_ADDRESSING_MODES          (ADDRESSING_MODE_INVALID + 1)
 
 /* Bits in the Conditional::flags field. */
 #define CONDITIONAL_SKIP_SOURCE           1
@@ -60,6 +65,12 @@ typedef struct OpCodeEntry
 } OpCodeEntry;
 
 
+typedef struct ProfileCounter
+{
+    unsigned int       calls;
+    unsigned long long nanoseconds;
+} ProfileCounter;
+
 typedef struct Conditional
 {
     struct Conditional* pPrev;
@@ -82,6 +93,10 @@ struct Assembler
     SymbolTable*               pSymbols;
     const AssemblerInitParams* pInitParams;
     ListFile*                  pListFile;
+    DebugMap*                  pDebugMap;
+    /* Kept until the assembler is freed since the names of the imported symbols point into them. */
+    SymbolFile**               ppImportedSymbolFiles;
+    size_t                     importedSymbolFileCount;
     FILE*                      pFileForListing;
     ParseCSV*                  pPutSearchPath;
     LineInfo*                  pLineInfo;
@@ -92,9 +107,14 @@ struct Assembler
     BinaryBuffer*              pCurrentBuffer;
     OpCodeEntry*               instructionSets[INSTRUCTION_SET_INVALID];
     size_t                     instructionSetSizes[INSTRUCTION_SET_INVALID];
+    ProfileCounter*            opcodeProfiles[INSTRUCTION_SET_INVALID];
+    AssemblerProfileEntry*     pOpcodeProfileEntries;
+    ProfileCounter             addressingModeProfiles[NUMBER_OF_ADDRESSING_MODES];
+    AssemblerProfileEntry      addressingModeProfileEntries[NUMBER_OF_ADDRESSING_MODES];
     MacroDefinition*           pMacroDefinitionsList;
     ParsedLine                 parsedLine;
     LineInfo                   linesHead;
+    AssemblerStats             stats;
     InstructionSetSupported    instructionSet;
     unsigned int               seenLUP : 1,
                                longA : 1,
@@ -41,6 +41,7 @@ struct BinaryBuffer
     unsigned char*  pBase;
     FileWriteEntry* pFileWriteHead;
     FileWriteEntry* pFileWriteTail;
+    FileWriteEntry* pFileWriteEnum;
     size_t          allocationToFail;
     unsigned short  baseAddress;
 };
@@ -133,6 +134,12 @@ void BinaryBuffer_FailAllocation(BinaryBuffer* pThis, size_t allocationToFail)
 }
 
 
+size_t BinaryBuffer_GetAllocatedSize(BinaryBuffer* pThis)
+{
+    return pThis->pCurrent - pThis->pBuffer;
+}
+
+
 void BinaryBuffer_SetOrigin(BinaryBuffer* pThis, unsigned short origin)
 {
     pThis->baseAddress = origin;
@@ -296,3 +303,28 @@ static void writeEntryToDisk(FileWriteEntry* pEntry)
     if (bytesWritten != pEntry->contentLength + pEntry->headerLength)
         __throw(fileException);
 }
+
+
+void BinaryBuffer_WriteFileQueueEnumStart(BinaryBuffer* pThis)
+{
+    pThis->pFileWriteEnum = pThis->pFileWriteHead;
+}
+
+int BinaryBuffer_WriteFileQueueEnumNext(BinaryBuffer* pThis, BinaryBufferFile* pFile)
+{
+    FileWriteEntry* pEntry = pThis->pFileWriteEnum;
+    int             isRW18;
+    
+    if (!pEntry)
+        return 0;
+    pThis->pFileWriteEnum = pEntry->pNext;
+    
+    isRW18 = pEntry->headerLength == sizeof(pEntry->rw18FileHeader);
+    pFile->pFilename = pEntry->filename;
+    pFile->pContent = pEntry->pBase;
+    pFile->contentLength = pEntry->contentLength;
+    pFile->pSavHeader = isRW18 ? NULL : &pEntry->savFileHeader;
+    pFile->pRW18Header = isRW18 ? &pEntry->rw18FileHeader : NULL;
+    
+    return 1;
+}
@@ -0,0 +1,610 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "DebugMap.h"
+#include "DebugMapTest.h"
+#include "util.h"
+
+
+#define INITIAL_LINE_COUNT          1024
+#define INITIAL_SYMBOL_COUNT        256
+#define INITIAL_FILE_COUNT          8
+#define INITIAL_STRING_TABLE_SIZE   4096
+#define MAX_FILE_COUNT              0xFFFF
+#define MAX_LINE_SIZE               0xFFFF
+
+
+typedef struct LineRecord
+{
+    DebugMapLine  line;
+    const Symbol* pSymbol;
+    /* Order in which the line was added so that lines at the same address stay in source order. */
+    size_t        order;
+} LineRecord;
+
+typedef struct SymbolRecord
+{
+    const Symbol* pSymbol;
+    const char*   pName;
+    uint32_t      nameOffset;
+    uint32_t      value;
+    uint32_t      sortedIndex;
+} SymbolRecord;
+
+struct DebugMap
+{
+    LineRecord*   pLines;
+    SymbolRecord* pSymbols;
+    uint32_t*     pFileTable;
+    char*         pStrings;
+    const char*   pLastFilename;
+    size_t        lineCount;
+    size_t        allocatedLineCount;
+    size_t        symbolCount;
+    size_t        allocatedSymbolCount;
+    size_t        fileCount;
+    size_t        allocatedFileCount;
+    size_t        stringTableSize;
+    size_t        allocatedStringTableSize;
+    uint16_t      lastFileIndex;
+};
+
+
+__throws DebugMap* DebugMap_Create(void)
+{
+    return allocateAndZero(sizeof(DebugMap));
+}
+
+
+void DebugMap_Free(DebugMap* pThis)
+{
+    if (!pThis)
+        return;
+    free(pThis->pLines);
+    free(pThis->pSymbols);
+    free(pThis->pFileTable);
+    free(pThis->pStrings);
+    free(pThis);
+}
+
+
+static void growArrayIfNecessary(void** ppArray, size_t* pAllocatedCount, size_t usedCount, size_t neededCount,
+                                 size_t elementSize, size_t initialCount);
+static uint16_t findOrAddFilename(DebugMap* pThis, const char* pFilename);
+__throws void DebugMap_AddLine(DebugMap* pThis, unsigned short address, size_t size,
+                               const char* pFilename, unsigned int lineNumber, const Symbol* pSymbol)
+{
+    LineRecord* pRecord;
+    
+    /* Lines which don't emit any bytes can't be found by address. */
+    if (size == 0)
+        return;
+    
+    growArrayIfNecessary((void**)&pThis->pLines, &pThis->allocatedLineCount, pThis->lineCount, 1, 
+                         sizeof(*pThis->pLines), INITIAL_LINE_COUNT);
+    pRecord = &pThis->pLines[pThis->lineCount];
+    memset(pRecord, 0, sizeof(*pRecord));
+    pRecord->line.address = address;
+    pRecord->line.size = size > MAX_LINE_SIZE ? MAX_LINE_SIZE : (uint16_t)size;
+    pRecord->line.fileIndex = findOrAddFilename(pThis, pFilename);
+    pRecord->line.lineNumber = lineNumber;
+    pRecord->pSymbol = pSymbol;
+    pRecord->order = pThis->lineCount++;
+}
+
+static void growArrayIfNecessary(void** ppArray, size_t* pAllocatedCount, size_t usedCount, size_t neededCount,
+                                 size_t elementSize, size_t initialCount)
+{
+    size_t newCount = *pAllocatedCount ? *pAllocatedCount * 2 : initialCount;
+    void*  pRealloc;
+    
+    if (usedCount + neededCount <= *pAllocatedCount)
+        return;
+    while (usedCount + neededCount > newCount)
+        newCount *= 2;
+    pRealloc = realloc(*ppArray, newCount * elementSize);
+    if (!pRealloc)
+        __throw(outOfMemoryException);
+    *ppArray = pRealloc;
+    *pAllocatedCount = newCount;
+}
+
+static uint32_t addString(DebugMap* pThis, const char* pString1, size_t length1, const char* pString2, size_t length2);
+static uint16_t findOrAddFilename(DebugMap* pThis, const char* pFilename)
+{
+    size_t i;
+    
+    /* Consecutive lines nearly always come from the same source so the filename is only searched for when it
+       changes. */
+    if (pFilename == pThis->pLastFilename)
+        return pThis->lastFileIndex;
+    
+    for (i = 0 ; i < pThis->fileCount ; i++)
+    {
+        if (0 == strcmp(pFilename, pThis->pStrings + pThis->pFileTable[i]))
+            break;
+    }
+    if (i == pThis->fileCount)
+    {
+        uint32_t offset;
+        
+        if (pThis->fileCount >= MAX_FILE_COUNT)
+            __throw(invalidArgumentException);
+        growArrayIfNecessary((void**)&pThis->pFileTable, &pThis->allocatedFileCount, pThis->fileCount, 1,
+                             sizeof(*pThis->pFileTable), INITIAL_FILE_COUNT);
+        offset = addString(pThis, pFilename, strlen(pFilename), NULL, 0);
+        pThis->pFileTable[pThis->fileCount++] = offset;
+    }
+    
+    pThis->pLastFilename = pFilename;
+    pThis->lastFileIndex = (uint16_t)i;
+    return pThis->lastFileIndex;
+}
+
+static uint32_t addString(DebugMap* pThis, const char* pString1, size_t length1, const char* pString2, size_t length2)
+{
+    uint32_t offset = (uint32_t)pThis->stringTableSize;
+    char*    pDest;
+    
+    growArrayIfNecessary((void**)&pThis->pStrings, &pThis->allocatedStringTableSize, pThis->stringTableSize,
+                         length1 + length2 + 1, 1, INITIAL_STRING_TABLE_SIZE);
+    pDest = pThis->pStrings + offset;
+    memcpy(pDest, pString1, length1);
+    if (length2)
+        memcpy(pDest + length1, pString2, length2);
+    pDest[length1 + length2] = '\0';
+    pThis->stringTableSize += length1 + length2 + 1;
+    
+    return offset;
+}
+
+
+__throws void DebugMap_AddSymbol(DebugMap* pThis, const Symbol* pSymbol)
+{
+    SymbolRecord* pRecord;
+    
+    growArrayIfNecessary((void**)&pThis->pSymbols, &pThis->allocatedSymbolCount, pThis->symbolCount, 1,
+                         sizeof(*pThis->pSymbols), INITIAL_SYMBOL_COUNT);
+    pRecord = &pThis->pSymbols[pThis->symbolCount];
+    memset(pRecord, 0, sizeof(*pRecord));
+    pRecord->pSymbol = pSymbol;
+    pRecord->value = pSymbol->expression.value;
+    /* Local labels are named after the global label which they follow, as in "main:loop". */
+    pRecord->nameOffset = addString(pThis, pSymbol->globalKey.pString, pSymbol->globalKey.stringLength,
+                                    pSymbol->localKey.pString, pSymbol->localKey.stringLength);
+    pThis->symbolCount++;
+}
+
+
+static void* allocateArray(size_t count, size_t elementSize);
+static void sortSymbolsByName(DebugMap* pThis);
+static void sortSymbolsByAddressOfSymbol(DebugMap* pThis);
+static void sortLinesByAddress(DebugMap* pThis);
+static void fillSymbolTable(DebugMap* pThis, DebugMapSymbol* pSymbols);
+static void fillLineTable(DebugMap* pThis, DebugMapLine* pLines);
+static void initHeader(DebugMap* pThis, DebugMapHeader* pHeader, const DebugMapLine* pLines);
+static FILE* openFile(const char* pFilename, const char* pMode);
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile);
+__throws void DebugMap_WriteToFile(DebugMap* pThis, const char* pFilename)
+{
+    DebugMapHeader  header;
+    DebugMapLine*   pLines = NULL;
+    DebugMapSymbol* pSymbols = NULL;
+    FILE*           pFile = NULL;
+    
+    __try
+    {
+        pLines = allocateArray(pThis->lineCount, sizeof(*pLines));
+        pSymbols = allocateArray(pThis->symbolCount, sizeof(*pSymbols));
+        sortSymbolsByName(pThis);
+        fillSymbolTable(pThis, pSymbols);
+        sortSymbolsByAddressOfSymbol(pThis);
+        sortLinesByAddress(pThis);
+        fillLineTable(pThis, pLines);
+        initHeader(pThis, &header, pLines);
+        
+        pFile = openFile(pFilename, "wb");
+        writeExactly(&header, sizeof(header), pFile);
+        writeExactly(pLines, pThis->lineCount * sizeof(*pLines), pFile);
+        writeExactly(pSymbols, pThis->symbolCount * sizeof(*pSymbols), pFile);
+        writeExactly(pThis->pFileTable, pThis->fileCount * sizeof(*pThis->pFileTable), pFile);
+        writeExactly(pThis->pStrings, pThis->stringTableSize, pFile);
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        free(pSymbols);
+        free(pLines);
+        __rethrow;
+    }
+    
+    fclose(pFile);
+    free(pSymbols);
+    free(pLines);
+}
+
+static void* allocateArray(size_t count, size_t elementSize)
+{
+    if (count == 0)
+        return NULL;
+    return allocateAndZero(count * elementSize);
+}
+
+static int compareSymbolNames(const void* pv1, const void* pv2);
+static void sortSymbolsByName(DebugMap* pThis)
+{
+    size_t i;
+    
+    /* The string table no longer moves so the names can be pointed at directly while sorting. */
+    for (i = 0 ; i < pThis->symbolCount ; i++)
+        pThis->pSymbols[i].pName = pThis->pStrings + pThis->pSymbols[i].nameOffset;
+    qsort(pThis->pSymbols, pThis->symbolCount, sizeof(*pThis->pSymbols), compareSymbolNames);
+    for (i = 0 ; i < pThis->symbolCount ; i++)
+        pThis->pSymbols[i].sortedIndex = (uint32_t)i;
+}
+
+static int compareSymbolNames(const void* pv1, const void* pv2)
+{
+    const SymbolRecord* p1 = (const SymbolRecord*)pv1;
+    const SymbolRecord* p2 = (const SymbolRecord*)pv2;
+    
+    return strcmp(p1->pName, p2->pName);
+}
+
+static void fillSymbolTable(DebugMap* pThis, DebugMapSymbol* pSymbols)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pThis->symbolCount ; i++)
+    {
+        pSymbols[i].nameOffset = pThis->pSymbols[i].nameOffset;
+        pSymbols[i].value = pThis->pSymbols[i].value;
+    }
+}
+
+static int compareAddressOfSymbols(const void* pv1, const void* pv2);
+static void sortSymbolsByAddressOfSymbol(DebugMap* pThis)
+{
+    /* Lets the label of each line be found with bsearch() to get its index in the name sorted table. */
+    qsort(pThis->pSymbols, pThis->symbolCount, sizeof(*pThis->pSymbols), compareAddressOfSymbols);
+}
+
+static int compareAddressOfSymbols(const void* pv1, const void* pv2)
+{
+    const SymbolRecord* p1 = (const SymbolRecord*)pv1;
+    const SymbolRecord* p2 = (const SymbolRecord*)pv2;
+    
+    if (p1->pSymbol < p2->pSymbol)
+        return -1;
+    return p1->pSymbol > p2->pSymbol;
+}
+
+static int compareLineAddresses(const void* pv1, const void* pv2);
+static void sortLinesByAddress(DebugMap* pThis)
+{
+    qsort(pThis->pLines, pThis->lineCount, sizeof(*pThis->pLines), compareLineAddresses);
+}
+
+static int compareLineAddresses(const void* pv1, const void* pv2)
+{
+    const LineRecord* p1 = (const LineRecord*)pv1;
+    const LineRecord* p2 = (const LineRecord*)pv2;
+    
+    if (p1->line.address != p2->line.address)
+        return (int)p1->line.address - (int)p2->line.address;
+    if (p1->order < p2->order)
+        return -1;
+    return p1->order > p2->order;
+}
+
+static uint32_t findSymbolIndex(DebugMap* pThis, const Symbol* pSymbol);
+static void fillLineTable(DebugMap* pThis, DebugMapLine* pLines)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pThis->lineCount ; i++)
+    {
+        pLines[i] = pThis->pLines[i].line;
+        pLines[i].symbolIndex = findSymbolIndex(pThis, pThis->pLines[i].pSymbol);
+    }
+}
+
+static uint32_t findSymbolIndex(DebugMap* pThis, const Symbol* pSymbol)
+{
+    SymbolRecord  key;
+    SymbolRecord* pFound;
+    
+    if (!pSymbol)
+        return DEBUG_MAP_NO_SYMBOL;
+    key.pSymbol = pSymbol;
+    pFound = bsearch(&key, pThis->pSymbols, pThis->symbolCount, sizeof(*pThis->pSymbols), compareAddressOfSymbols);
+    return pFound ? pFound->sortedIndex : DEBUG_MAP_NO_SYMBOL;
+}
+
+static void initHeader(DebugMap* pThis, DebugMapHeader* pHeader, const DebugMapLine* pLines)
+{
+    size_t   line = 0;
+    unsigned page;
+    
+    memset(pHeader, 0, sizeof(*pHeader));
+    memcpy(pHeader->signature, DEBUG_MAP_SIGNATURE, sizeof(pHeader->signature));
+    pHeader->version = DEBUG_MAP_VERSION;
+    pHeader->lineCount = (uint32_t)pThis->lineCount;
+    pHeader->lineTableOffset = sizeof(*pHeader);
+    pHeader->symbolCount = (uint32_t)pThis->symbolCount;
+    pHeader->symbolTableOffset = pHeader->lineTableOffset + pHeader->lineCount * sizeof(DebugMapLine);
+    pHeader->fileCount = (uint32_t)pThis->fileCount;
+    pHeader->fileTableOffset = pHeader->symbolTableOffset + pHeader->symbolCount * sizeof(DebugMapSymbol);
+    pHeader->stringTableSize = (uint32_t)pThis->stringTableSize;
+    pHeader->stringTableOffset = pHeader->fileTableOffset + pHeader->fileCount * sizeof(uint32_t);
+    for (page = 0 ; page <= DEBUG_MAP_PAGE_COUNT ; page++)
+    {
+        while (line < pThis->lineCount && pLines[line].address < page * 256)
+            line++;
+        pHeader->pageIndex[page] = (uint32_t)line;
+    }
+}
+
+static FILE* openFile(const char* pFilename, const char* pMode)
+{
+    FILE* pFile = fopen(pFilename, pMode);
+    if (!pFile)
+        __throw(fileOpenException);
+    return pFile;
+}
+
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile)
+{
+    if (bufferSize != fwrite(pBuffer, 1, bufferSize, pFile))
+        __throw(fileException);
+}
+
+
+static int isTableInBounds(uint32_t offset, uint32_t count, size_t elementSize, size_t dataSize);
+static int isPageIndexValid(const DebugMapHeader* pHeader);
+__throws void DebugMapView_Init(DebugMapView* pThis, const void* pData, size_t dataSize)
+{
+    const DebugMapHeader* pHeader = (const DebugMapHeader*)pData;
+    const char*           pBase = (const char*)pData;
+    
+    memset(pThis, 0, sizeof(*pThis));
+    if (dataSize < sizeof(*pHeader) ||
+        0 != memcmp(pHeader->signature, DEBUG_MAP_SIGNATURE, sizeof(pHeader->signature)) ||
+        pHeader->version != DEBUG_MAP_VERSION ||
+        !isTableInBounds(pHeader->lineTableOffset, pHeader->lineCount, sizeof(DebugMapLine), dataSize) ||
+        !isTableInBounds(pHeader->symbolTableOffset, pHeader->symbolCount, sizeof(DebugMapSymbol), dataSize) ||
+        !isTableInBounds(pHeader->fileTableOffset, pHeader->fileCount, sizeof(uint32_t), dataSize) ||
+        !isTableInBounds(pHeader->stringTableOffset, pHeader->stringTableSize, 1, dataSize) ||
+        (pHeader->stringTableSize > 0 && pBase[pHeader->stringTableOffset + pHeader->stringTableSize - 1] != '\0') ||
+        !isPageIndexValid(pHeader))
+    {
+        __throw(fileException);
+    }
+    
+    pThis->pHeader = pHeader;
+    pThis->pLines = (const DebugMapLine*)(pBase + pHeader->lineTableOffset);
+    pThis->pSymbols = (const DebugMapSymbol*)(pBase + pHeader->symbolTableOffset);
+    pThis->pFileTable = (const uint32_t*)(pBase + pHeader->fileTableOffset);
+    pThis->pStrings = pBase + pHeader->stringTableOffset;
+}
+
+static int isTableInBounds(uint32_t offset, uint32_t count, size_t elementSize, size_t dataSize)
+{
+    /* The tables are used in place so they must also be aligned for their fields. */
+    if (elementSize > 1 && (offset % sizeof(uint32_t)) != 0)
+        return 0;
+    return (uint64_t)offset + (uint64_t)count * elementSize <= dataSize;
+}
+
+static int isPageIndexValid(const DebugMapHeader* pHeader)
+{
+    size_t page;
+    
+    if (pHeader->pageIndex[DEBUG_MAP_PAGE_COUNT] != pHeader->lineCount)
+        return 0;
+    for (page = 0 ; page < DEBUG_MAP_PAGE_COUNT ; page++)
+    {
+        if (pHeader->pageIndex[page] > pHeader->pageIndex[page + 1])
+            return 0;
+    }
+    return 1;
+}
+
+
+const DebugMapLine* DebugMapView_FindAddress(const DebugMapView* pThis, unsigned short address)
+{
+    const uint32_t*     pPageIndex = pThis->pHeader->pageIndex;
+    unsigned int        page = address >> 8;
+    uint32_t            low = pPageIndex[page];
+    uint32_t            high = pPageIndex[page + 1];
+    const DebugMapLine* pLine;
+    
+    /* The line containing address starts in the same page or is the last line to start in an earlier page. */
+    if (low > 0)
+        low--;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        
+        if (pThis->pLines[middle].address <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == 0 || pThis->pLines[low - 1].address > address)
+        return NULL;
+    
+    pLine = &pThis->pLines[low - 1];
+    if ((unsigned int)(address - pLine->address) >= pLine->size)
+        return NULL;
+    return pLine;
+}
+
+
+const DebugMapSymbol* DebugMapView_FindSymbol(const DebugMapView* pThis, const char* pName)
+{
+    uint32_t low = 0;
+    uint32_t high = pThis->pHeader->symbolCount;
+    
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        int      result = strcmp(pName, DebugMapView_GetSymbolName(pThis, &pThis->pSymbols[middle]));
+        
+        if (result == 0)
+            return &pThis->pSymbols[middle];
+        if (result < 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return NULL;
+}
+
+
+static const char* getString(const DebugMapView* pThis, uint32_t offset);
+const char* DebugMapView_GetFilename(const DebugMapView* pThis, const DebugMapLine* pLine)
+{
+    if (pLine->fileIndex >= pThis->pHeader->fileCount)
+        return "";
+    return getString(pThis, pThis->pFileTable[pLine->fileIndex]);
+}
+
+static const char* getString(const DebugMapView* pThis, uint32_t offset)
+{
+    /* The string table was checked to end with a terminator so any offset within it is a valid string. */
+    if (offset >= pThis->pHeader->stringTableSize)
+        return "";
+    return pThis->pStrings + offset;
+}
+
+
+const DebugMapSymbol* DebugMapView_GetLineSymbol(const DebugMapView* pThis, const DebugMapLine* pLine)
+{
+    if (pLine->symbolIndex >= pThis->pHeader->symbolCount)
+        return NULL;
+    return &pThis->pSymbols[pLine->symbolIndex];
+}
+
+
+const char* DebugMapView_GetSymbolName(const DebugMapView* pThis, const DebugMapSymbol* pSymbol)
+{
+    return getString(pThis, pSymbol->nameOffset);
+}
+
+
+static int printQuery(const DebugMapView* pThis, const char* pQuery);
+unsigned int DebugMapView_PrintQueries(const DebugMapView* pThis, const char** ppQueries, size_t queryCount)
+{
+    unsigned int missCount = 0;
+    size_t       i;
+    
+    for (i = 0 ; i < queryCount ; i++)
+    {
+        if (!printQuery(pThis, ppQueries[i]))
+            missCount++;
+    }
+    return missCount;
+}
+
+static int parseAddress(const char* pQuery, unsigned short* pAddress);
+static int printAddressQuery(const DebugMapView* pThis, unsigned short address);
+static int printSymbolQuery(const DebugMapView* pThis, const char* pQuery);
+static int printQuery(const DebugMapView* pThis, const char* pQuery)
+{
+    unsigned short address;
+    
+    if (parseAddress(pQuery, &address))
+        return printAddressQuery(pThis, address);
+    return printSymbolQuery(pThis, pQuery);
+}
+
+static int parseAddress(const char* pQuery, unsigned short* pAddress)
+{
+    const char*   pDigits;
+    char*         pEnd;
+    unsigned long value;
+    
+    /* Symbols can look like hexadecimal numbers so addresses must carry a prefix. */
+    if (pQuery[0] == '$')
+        pDigits = pQuery + 1;
+    else if (pQuery[0] == '0' && (pQuery[1] == 'x' || pQuery[1] == 'X'))
+        pDigits = pQuery + 2;
+    else
+        return 0;
+    
+    value = strtoul(pDigits, &pEnd, 16);
+    if (pEnd == pDigits || *pEnd != '\0' || value > 0xFFFF)
+        return 0;
+    *pAddress = (unsigned short)value;
+    return 1;
+}
+
+static unsigned int getLastAddress(const DebugMapLine* pLine);
+static const char* getLabel(const DebugMapView* pThis, const DebugMapLine* pLine);
+static int printAddressQuery(const DebugMapView* pThis, unsigned short address)
+{
+    const DebugMapLine* pLine = DebugMapView_FindAddress(pThis, address);
+    const char*         pLabel;
+    
+    if (!pLine)
+    {
+        printf("$%04X: not found" LINE_ENDING, address);
+        return 0;
+    }
+    pLabel = getLabel(pThis, pLine);
+    printf("$%04X: %s:%u ($%04X-$%04X%s%s)" LINE_ENDING, 
+           address, DebugMapView_GetFilename(pThis, pLine), pLine->lineNumber, 
+           pLine->address, getLastAddress(pLine), *pLabel ? " " : "", pLabel);
+    return 1;
+}
+
+static unsigned int getLastAddress(const DebugMapLine* pLine)
+{
+    return (pLine->address + pLine->size - 1) & 0xFFFF;
+}
+
+static const char* getLabel(const DebugMapView* pThis, const DebugMapLine* pLine)
+{
+    const DebugMapSymbol* pSymbol = DebugMapView_GetLineSymbol(pThis, pLine);
+    
+    return pSymbol ? DebugMapView_GetSymbolName(pThis, pSymbol) : "";
+}
+
+static int printSymbolQuery(const DebugMapView* pThis, const char* pQuery)
+{
+    const DebugMapSymbol* pSymbol = DebugMapView_FindSymbol(pThis, pQuery);
+    const DebugMapLine*   pLine = NULL;
+    const char*           pLabel;
+    
+    if (!pSymbol)
+    {
+        printf("%s: not found" LINE_ENDING, pQuery);
+        return 0;
+    }
+    if (pSymbol->value <= 0xFFFF)
+        pLine = DebugMapView_FindAddress(pThis, (unsigned short)pSymbol->value);
+    if (!pLine)
+    {
+        printf("%s: $%04X" LINE_ENDING, pQuery, pSymbol->value);
+        return 1;
+    }
+    pLabel = getLabel(pThis, pLine);
+    printf("%s: $%04X %s:%u ($%04X-$%04X%s%s)" LINE_ENDING, 
+           pQuery, pSymbol->value, DebugMapView_GetFilename(pThis, pLine), pLine->lineNumber, 
+           pLine->address, getLastAddress(pLine), *pLabel ? " " : "", pLabel);
+    return 1;
+}
@@ -45,24 +45,35 @@ void ListFile_Free(ListFile* pThis)
 }
 
 
-static void initMachineCodeFields(ListFile* pThis, LineInfo* pLineInfo);
-static void fillAddressBuffer(LineInfo* pLineInfo, char* pOutputBuffer);
-static void fillMachineCodeOrSymbolBuffer(ListFile* pThis, LineInfo* pLineInfo, char* pOutputBuffer);
-static void fillMachineCodeBuffer(ListFile* pThis, char* pOutputBuffer);
-static void listOverflowMachineCodeLine(ListFile* pThis);
+/* The columns are formatted by hand rather than with sprintf() since the listing is written for every line of source
+   and the format string parsing was a noticeable part of the assembly time. */
+static const char g_hexDigits[] = "0123456789ABCDEF";
+
+
+static void  initMachineCodeFields(ListFile* pThis, LineInfo* pLineInfo);
+static char* fillAddressBuffer(LineInfo* pLineInfo, char* pOutputBuffer);
+static char* fillMachineCodeOrSymbolBuffer(ListFile* pThis, LineInfo* pLineInfo, char* pOutputBuffer);
+static char* fillMachineCodeBuffer(ListFile* pThis, char* pOutputBuffer);
+static void  fillLineNumberBuffer(int lineNumber, char* pOutputBuffer);
+static void  listOverflowMachineCodeLine(ListFile* pThis);
 void ListFile_OutputLine(ListFile* pThis, LineInfo* pLineInfo)
 {
-    char           addressString[4+1] = "    ";
-    char           machineCodeOrSymbol[2+1+2+1+2+1] = "        ";
+    char  addressAndMachineCode[4+2+2+1+2+1+2+1+1] = "";
+    char  lineNumber[11+1];
+    char* pCurr = addressAndMachineCode;
     
     initMachineCodeFields(pThis, pLineInfo);
-    fillAddressBuffer(pLineInfo, addressString);
-    fillMachineCodeOrSymbolBuffer(pThis, pLineInfo, machineCodeOrSymbol);
-    fprintf(pThis->pFile, "%4s: %8s %*s% 5d %.*s" LINE_ENDING, 
-            addressString,
-            machineCodeOrSymbol,
+    pCurr = fillAddressBuffer(pLineInfo, pCurr);
+    *pCurr++ = ':';
+    *pCurr++ = ' ';
+    pCurr = fillMachineCodeOrSymbolBuffer(pThis, pLineInfo, pCurr);
+    *pCurr++ = ' ';
+    *pCurr = '\0';
+    fillLineNumberBuffer((int)pLineInfo->lineNumber, lineNumber);
+    fprintf(pThis->pFile, "%s%*s%s %.*s" LINE_ENDING, 
+            addressAndMachineCode,
             pLineInfo->indentation, "",
-            pLineInfo->lineNumber, 
+            lineNumber,
             pLineInfo->lineText.stringLength, pLineInfo->lineText.pString);
             
     while (pThis->machineCodeSize > 0)
@@ -77,59 +88,111 @@ static void initMachineCodeFields(ListFile* pThis, LineInfo* pLineInfo)
     pThis->flags = pLineInfo->flags;
 }
 
-static void fillAddressBuffer(LineInfo* pLineInfo, char* pOutputBuffer)
+static char* fillHex(char* pOutputBuffer, unsigned long value, int digitCount);
+static char* fillSpaces(char* pOutputBuffer, size_t spaceCount);
+static char* fillAddressBuffer(LineInfo* pLineInfo, char* pOutputBuffer)
 {
     if (pLineInfo->machineCodeSize > 0)
-        sprintf(pOutputBuffer, "%04X", pLineInfo->address);
+        return fillHex(pOutputBuffer, pLineInfo->address, 4);
+    return fillSpaces(pOutputBuffer, 4);
+}
+
+static char* fillHex(char* pOutputBuffer, unsigned long value, int digitCount)
+{
+    int i;
+    
+    for (i = digitCount - 1 ; i >= 0 ; i--)
+    {
+        pOutputBuffer[i] = g_hexDigits[value & 0xF];
+        value >>= 4;
+    }
+    return pOutputBuffer + digitCount;
+}
+
+static char* fillSpaces(char* pOutputBuffer, size_t spaceCount)
+{
+    memset(pOutputBuffer, ' ', spaceCount);
+    return pOutputBuffer + spaceCount;
 }
 
-static void fillMachineCodeOrSymbolBuffer(ListFile* pThis, LineInfo* pLineInfo, char* pOutputBuffer)
+static char* fillMachineCodeOrSymbolBuffer(ListFile* pThis, LineInfo* pLineInfo, char* pOutputBuffer)
 {
     if (pLineInfo->flags & LINEINFO_FLAG_WAS_EQU)
     {
         unsigned long value = (unsigned long)pLineInfo->equValue;
         if (value <= 0xfffful)
-            sprintf(pOutputBuffer, "   =%04lX", value);
+        {
+            memcpy(pOutputBuffer, "   =", 4);
+            return fillHex(pOutputBuffer + 4, value, 4);
+        }
         else if (value <= 0xffffffful)
-            sprintf(pOutputBuffer, "=%07lX", value);
-        else
-            sprintf(pOutputBuffer, "=...%04lX", value & 0xfffful);
+        {
+            *pOutputBuffer = '=';
+            return fillHex(pOutputBuffer + 1, value, 7);
+        }
+        memcpy(pOutputBuffer, "=...", 4);
+        return fillHex(pOutputBuffer + 4, value & 0xfffful, 4);
     }
     else if (pLineInfo->machineCodeSize > 0)
-        fillMachineCodeBuffer(pThis, pOutputBuffer);
+        return fillMachineCodeBuffer(pThis, pOutputBuffer);
+    return fillSpaces(pOutputBuffer, 8);
 }
 
-static void fillMachineCodeBuffer(ListFile* pThis, char* pOutputBuffer)
+static char* fillMachineCodeBuffer(ListFile* pThis, char* pOutputBuffer)
 {
-    size_t bytesUsed = 0;
+    /* Always fills 8 characters: up to 3 bytes of hex separated by spaces and padded on the right. */
+    size_t bytesUsed = pThis->machineCodeSize < 3 ? pThis->machineCodeSize : 3;
+    size_t i;
     
-    switch(pThis->machineCodeSize)
-    {
-    case 1:
-        sprintf(pOutputBuffer, "%02X      ", pThis->pMachineCode[0]);
-        bytesUsed = 1;
-        break;
-    case 2:
-        sprintf(pOutputBuffer, "%02X %02X   ", pThis->pMachineCode[0], pThis->pMachineCode[1]);
-        bytesUsed = 2;
-        break;
-    default:
-        sprintf(pOutputBuffer, "%02X %02X %02X", pThis->pMachineCode[0], pThis->pMachineCode[1], pThis->pMachineCode[2]);
-        bytesUsed = 3;
-        break;
-    }
+    fillSpaces(pOutputBuffer, 8);
+    for (i = 0 ; i < bytesUsed ; i++)
+        fillHex(pOutputBuffer + i * 3, pThis->pMachineCode[i], 2);
 
     pThis->pMachineCode += bytesUsed;
     pThis->machineCodeSize -= bytesUsed;
+    
+    return pOutputBuffer + 8;
+}
+
+static void fillLineNumberBuffer(int lineNumber, char* pOutputBuffer)
+{
+    /* Matches the "% 5d" format: a sign, which is a space for positive numbers, right aligned in 5 columns. */
+    char          digits[10];
+    size_t        digitCount = 0;
+    size_t        length;
+    unsigned long value = lineNumber < 0 ? 0ul - (unsigned long)lineNumber : (unsigned long)lineNumber;
+    
+    do
+    {
+        digits[digitCount++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    
+    length = digitCount + 1;
+    if (length < 5)
+        pOutputBuffer = fillSpaces(pOutputBuffer, 5 - length);
+    *pOutputBuffer++ = lineNumber < 0 ? '-' : ' ';
+    while (digitCount > 0)
+        *pOutputBuffer++ = digits[--digitCount];
+    *pOutputBuffer = '\0';
 }
 
 static void listOverflowMachineCodeLine(ListFile* pThis)
 {
-    char machineCodeBuffer[2+1+2+1+2+1] = "        ";
+    char  buffer[4+2+2+1+2+1+2+sizeof(LINE_ENDING)];
+    char* pCurr = buffer;
 
     pThis->address += 3;
-    fillMachineCodeBuffer(pThis, machineCodeBuffer);
-    fprintf(pThis->pFile, "%04X: %8s" LINE_ENDING, 
-            pThis->address,
-            machineCodeBuffer);
+    pCurr = fillHex(pCurr, pThis->address, 4);
+    *pCurr++ = ':';
+    *pCurr++ = ' ';
+    pCurr = fillMachineCodeBuffer(pThis, pCurr);
+    memcpy(pCurr, LINE_ENDING, sizeof(LINE_ENDING));
+    fprintf(pThis->pFile, "%s", buffer);
+}
+
+
+void ListFile_Flush(ListFile* pThis)
+{
+    fflush(pThis->pFile);
 }
@@ -12,6 +12,7 @@
 */
 #include <string.h>
 #include "MacroExpansionSource.h"
+#include "AllocStats.h"
 #include "MallocFailureInject.h"
 #include "TextSourcePriv.h"
 #include "util.h"
@@ -54,6 +55,7 @@ __throws TextSource* MacroExpansionSource_Create(TextFile* pTextFile,
         pThis = allocateAndZero(sizeof(*pThis));
         pThis->super.pVTable = &g_vtable;
         pThis->fileName = TextFile_GetFilename(pTextFile);
+        AllocStats_SetTag(ALLOC_STATS_TAG_MACRO_ARRAYS);
         pThis->macroExpansionLines =
           allocateAndZero(numberOfLines * sizeof(SizedString));
         memcpy(pThis->macroExpansionLines, macroExpansionLines,
@@ -78,6 +80,7 @@ static void freeObject(void *pvThis)
     if (!pvThis)
         return;
     MacroExpansionSource* pThis = (MacroExpansionSource*)pvThis;
+    free(pThis->macroExpansionLines);
     free(pThis);
 }
 
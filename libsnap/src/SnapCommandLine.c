@@ -26,15 +26,41 @@ static void displayCopyrightNotice(void)
 
 static void displayUsage(void)
 {
-    printf("Usage: snap [--list listFilename] [--putdirs includeDir1;includeDir2...]\n"
-           "            [--outdir outputDirectory]sourceFilename\n\n"
+    printf("Usage: snap [--list listFilename] [--stream-list]\n"
+           "            [--debug-map mapFilename]\n"
+           "            [--import-symbols symbolFilename1;symbolFilename2...]\n"
+           "            [--export-symbols symbolFilename]\n"
+           "            [--putdirs includeDir1;includeDir2...]\n"
+           "            [--outdir outputDirectory] [--stats] [--profile]\n"
+           "            [--alloc-stats] [--perf-counters] [--trace traceFilename]\n"
+           "            sourceFilename\n\n"
            "Where: --list listFilename allows the list file for the assembly\n"
            "         process to be output to the specified file.  By default it\n"
-           "         will be sent to stdout.\n"
+           "         will be sent to stdout.  A listFilename of none skips the\n"
+           "         listing altogether.\n"
+           "       --stream-list writes each line of the listing and frees it as soon\n"
+           "         as it has no forward references left to resolve so that large\n"
+           "         sources use less memory.\n"
+           "       --debug-map mapFilename writes a binary map from addresses to\n"
+           "         source lines and from symbols to values for use by snapmap.\n"
+           "       --import-symbols defines the global labels exported by other\n"
+           "         assemblies to these symbol files (semi-colon separated).\n"
+           "       --export-symbols symbolFilename writes the global labels of this\n"
+           "         assembly to a binary symbol file for other assemblies to import.\n"
            "       --putdirs sets the directories (semi-colon separated) in which\n"
            "         files will be searched when including files with PUT directive.\n"
            "       --outdir sets the directory where output files from directives\n"
            "         like USR and SAV should be stored.\n"
+           "       --stats prints the time taken by each phase of the assembly along\n"
+           "         with counts of the lines, symbols, and bytes processed.\n"
+           "       --profile prints the number of calls and time taken by each\n"
+           "         directive, opcode, and addressing mode.\n"
+           "       --alloc-stats prints the number of allocations, bytes, and peak\n"
+           "         live bytes for each kind of object allocated.\n"
+           "       --perf-counters prints the CPU cycles, instructions per cycle,\n"
+           "         cache misses, and branch misses of each assembly phase.\n"
+           "       --trace traceFilename writes a Chrome trace event file which shows\n"
+           "         the time spent in each phase, PUT file, macro expansion, and LUP.\n"
            "       sourceFilename is the required name of an input assembly\n"
            "         language file.\n");
 }
@@ -46,6 +72,7 @@ static int parseFlagArgument(SnapCommandLine* pThis, int argc, const char** ppAr
 static void parseStringParamter(const char** ppDestField, int argc, const char* pSourceArgument);
 static int parseFilenameArgument(SnapCommandLine* pThis, int argc, const char* pArgument);
 static void throwIfRequiredArgumentNotSpecified(SnapCommandLine* pThis);
+static void checkForNoListing(SnapCommandLine* pThis);
 
 
 __throws void SnapCommandLine_Init(SnapCommandLine* pThis, int argc, const char** argv)
@@ -60,6 +87,7 @@ __throws void SnapCommandLine_Init(SnapCommandLine* pThis, int argc, const char*
             argv += argumentsUsed;
         }
         throwIfRequiredArgumentNotSpecified(pThis);
+        checkForNoListing(pThis);
     }
     __catch
     {
@@ -90,12 +118,47 @@ static int parseFlagArgument(SnapCommandLine* pThis, int argc, const char** ppAr
         int         destStringOffsetInThis;
     } const flagArguments[] =
     {
-        { "--list",    offsetof(SnapCommandLine, assemblerInitParams) + offsetof(AssemblerInitParams, pListFilename) },
-        { "--putdirs", offsetof(SnapCommandLine, assemblerInitParams) + offsetof(AssemblerInitParams, pPutDirectories) },
-        { "--outdir",  offsetof(SnapCommandLine, assemblerInitParams) + offsetof(AssemblerInitParams, pOutputDirectory) }
+        { "--list",           offsetof(SnapCommandLine, assemblerInitParams) + 
+                              offsetof(AssemblerInitParams, pListFilename) },
+        { "--putdirs",        offsetof(SnapCommandLine, assemblerInitParams) + 
+                              offsetof(AssemblerInitParams, pPutDirectories) },
+        { "--outdir",         offsetof(SnapCommandLine, assemblerInitParams) + 
+                              offsetof(AssemblerInitParams, pOutputDirectory) },
+        { "--debug-map",      offsetof(SnapCommandLine, assemblerInitParams) + 
+                              offsetof(AssemblerInitParams, pDebugMapFilename) },
+        { "--import-symbols", offsetof(SnapCommandLine, assemblerInitParams) + 
+                              offsetof(AssemblerInitParams, pImportSymbolFilenames) },
+        { "--export-symbols", offsetof(SnapCommandLine, assemblerInitParams) + 
+                              offsetof(AssemblerInitParams, pExportSymbolFilename) },
+        { "--trace",          offsetof(SnapCommandLine, pTraceFilename) }
     };
     size_t i;
     
+    if (0 == strcasecmp(*ppArgs, "--stats"))
+    {
+        pThis->assemblerInitParams.collectStats = 1;
+        return 1;
+    }
+    if (0 == strcasecmp(*ppArgs, "--stream-list"))
+    {
+        pThis->assemblerInitParams.streamListing = 1;
+        return 1;
+    }
+    if (0 == strcasecmp(*ppArgs, "--profile"))
+    {
+        pThis->assemblerInitParams.collectProfile = 1;
+        return 1;
+    }
+    if (0 == strcasecmp(*ppArgs, "--alloc-stats"))
+    {
+        pThis->collectAllocStats = 1;
+        return 1;
+    }
+    if (0 == strcasecmp(*ppArgs, "--perf-counters"))
+    {
+        pThis->collectPerfCounters = 1;
+        return 1;
+    }
     for (i = 0 ; i < ARRAYSIZE(flagArguments) ; i++)
     {
         if (0 == strcasecmp(*ppArgs, flagArguments[i].pFlag))
@@ -135,3 +198,14 @@ static void throwIfRequiredArgumentNotSpecified(SnapCommandLine* pThis)
     if (!pThis->pSourceFilename)
         __throw(invalidArgumentException);
 }
+
+static void checkForNoListing(SnapCommandLine* pThis)
+{
+    AssemblerInitParams* pParams = &pThis->assemblerInitParams;
+    
+    if (pParams->pListFilename && 0 == strcmp(pParams->pListFilename, "none"))
+    {
+        pParams->pListFilename = NULL;
+        pParams->skipListing = 1;
+    }
+}
@@ -0,0 +1,279 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "SymbolFile.h"
+#include "SymbolFileTest.h"
+#include "util.h"
+
+
+#define MAX_NAME_LENGTH 0xFFFF
+
+
+struct SymbolFile
+{
+    char*                   pFileBuffer;
+    const SymbolFileHeader* pHeader;
+    const SymbolFileSymbol* pSymbols;
+    const char*             pStrings;
+};
+
+
+static int isSymbolForExport(Symbol* pSymbol);
+static void* allocateArray(size_t count, size_t elementSize);
+static void fillSymbolAndStringTables(SymbolTable* pSymbolTable, SymbolFileSymbol* pSymbols, char* pStrings);
+static void initHeader(SymbolFileHeader* pHeader, size_t symbolCount, size_t stringTableSize);
+static FILE* openFile(const char* pFilename, const char* pMode);
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile);
+__throws void SymbolFile_Write(SymbolTable* pSymbolTable, const char* pFilename)
+{
+    SymbolFileHeader  header;
+    SymbolFileSymbol* pSymbols = NULL;
+    char*             pStrings = NULL;
+    FILE*             pFile = NULL;
+    size_t            symbolCount = 0;
+    size_t            stringTableSize = 0;
+    Symbol*           pSymbol;
+    
+    /* The tables are sized in a first walk of the symbol table so that they can be filled without growing. */
+    SymbolTable_EnumStart(pSymbolTable);
+    while (NULL != (pSymbol = SymbolTable_EnumNext(pSymbolTable)))
+    {
+        if (!isSymbolForExport(pSymbol))
+            continue;
+        symbolCount++;
+        stringTableSize += pSymbol->globalKey.stringLength + 1;
+    }
+    
+    __try
+    {
+        pSymbols = allocateArray(symbolCount, sizeof(*pSymbols));
+        pStrings = allocateArray(stringTableSize, 1);
+        fillSymbolAndStringTables(pSymbolTable, pSymbols, pStrings);
+        initHeader(&header, symbolCount, stringTableSize);
+        
+        pFile = openFile(pFilename, "wb");
+        writeExactly(&header, sizeof(header), pFile);
+        writeExactly(pSymbols, symbolCount * sizeof(*pSymbols), pFile);
+        writeExactly(pStrings, stringTableSize, pFile);
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        free(pStrings);
+        free(pSymbols);
+        __rethrow;
+    }
+    
+    fclose(pFile);
+    free(pStrings);
+    free(pSymbols);
+}
+
+static int isSymbolForExport(Symbol* pSymbol)
+{
+    return pSymbol->pDefinedLine != NULL &&
+           !(pSymbol->flags & SYMBOL_FLAG_IMPORTED) &&
+           pSymbol->localKey.stringLength == 0 &&
+           pSymbol->globalKey.stringLength > 0 &&
+           pSymbol->globalKey.stringLength <= MAX_NAME_LENGTH &&
+           pSymbol->globalKey.pString[0] != ']';
+}
+
+static void* allocateArray(size_t count, size_t elementSize)
+{
+    if (count == 0)
+        return NULL;
+    return allocateAndZero(count * elementSize);
+}
+
+static void fillSymbolAndStringTables(SymbolTable* pSymbolTable, SymbolFileSymbol* pSymbols, char* pStrings)
+{
+    uint32_t stringOffset = 0;
+    Symbol*  pSymbol;
+    
+    SymbolTable_EnumStart(pSymbolTable);
+    while (NULL != (pSymbol = SymbolTable_EnumNext(pSymbolTable)))
+    {
+        size_t nameLength = pSymbol->globalKey.stringLength;
+        
+        if (!isSymbolForExport(pSymbol))
+            continue;
+        pSymbols->nameOffset = stringOffset;
+        pSymbols->value = pSymbol->expression.value;
+        pSymbols->nameLength = (uint16_t)nameLength;
+        pSymbols->type = (uint8_t)pSymbol->expression.type;
+        pSymbols++;
+        memcpy(pStrings + stringOffset, pSymbol->globalKey.pString, nameLength);
+        pStrings[stringOffset + nameLength] = '\0';
+        stringOffset += (uint32_t)nameLength + 1;
+    }
+}
+
+static void initHeader(SymbolFileHeader* pHeader, size_t symbolCount, size_t stringTableSize)
+{
+    memset(pHeader, 0, sizeof(*pHeader));
+    memcpy(pHeader->signature, SYMBOL_FILE_SIGNATURE, sizeof(pHeader->signature));
+    pHeader->version = SYMBOL_FILE_VERSION;
+    pHeader->symbolCount = (uint32_t)symbolCount;
+    pHeader->symbolTableOffset = sizeof(*pHeader);
+    pHeader->stringTableSize = (uint32_t)stringTableSize;
+    pHeader->stringTableOffset = pHeader->symbolTableOffset + pHeader->symbolCount * sizeof(SymbolFileSymbol);
+}
+
+static FILE* openFile(const char* pFilename, const char* pMode)
+{
+    FILE* pFile = fopen(pFilename, pMode);
+    if (!pFile)
+        __throw(fileOpenException);
+    return pFile;
+}
+
+static void writeExactly(const void* pBuffer, size_t bufferSize, FILE* pFile)
+{
+    if (bufferSize != fwrite(pBuffer, 1, bufferSize, pFile))
+        __throw(fileException);
+}
+
+
+static long getFileSize(FILE* pFile);
+static void readExactly(void* pBuffer, size_t bufferSize, FILE* pFile);
+static void validateAndInitTables(SymbolFile* pThis, size_t fileSize);
+__throws SymbolFile* SymbolFile_CreateFromFile(const char* pFilename)
+{
+    SymbolFile* pThis = NULL;
+    FILE*       pFile = NULL;
+    
+    __try
+    {
+        long fileSize;
+        
+        pThis = allocateAndZero(sizeof(*pThis));
+        pFile = openFile(pFilename, "rb");
+        fileSize = getFileSize(pFile);
+        pThis->pFileBuffer = allocateArray(fileSize, 1);
+        readExactly(pThis->pFileBuffer, fileSize, pFile);
+        validateAndInitTables(pThis, fileSize);
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        SymbolFile_Free(pThis);
+        __rethrow;
+    }
+    
+    fclose(pFile);
+    return pThis;
+}
+
+static long getFileSize(FILE* pFile)
+{
+    long fileSize;
+    
+    if (0 != fseek(pFile, 0, SEEK_END))
+        __throw(fileException);
+    fileSize = ftell(pFile);
+    if (fileSize == -1)
+        __throw(fileException);
+    if (0 != fseek(pFile, 0, SEEK_SET))
+        __throw(fileException);
+    
+    return fileSize;
+}
+
+static void readExactly(void* pBuffer, size_t bufferSize, FILE* pFile)
+{
+    if (bufferSize != fread(pBuffer, 1, bufferSize, pFile))
+        __throw(fileException);
+}
+
+static int isTableInBounds(uint32_t offset, uint32_t count, size_t elementSize, size_t dataSize);
+static int isSymbolValid(const SymbolFileSymbol* pSymbol, const SymbolFileHeader* pHeader, const char* pStrings);
+static void validateAndInitTables(SymbolFile* pThis, size_t fileSize)
+{
+    const SymbolFileHeader* pHeader = (const SymbolFileHeader*)pThis->pFileBuffer;
+    size_t                  i;
+    
+    if (fileSize < sizeof(*pHeader) ||
+        0 != memcmp(pHeader->signature, SYMBOL_FILE_SIGNATURE, sizeof(pHeader->signature)) ||
+        pHeader->version != SYMBOL_FILE_VERSION ||
+        !isTableInBounds(pHeader->symbolTableOffset, pHeader->symbolCount, sizeof(SymbolFileSymbol), fileSize) ||
+        !isTableInBounds(pHeader->stringTableOffset, pHeader->stringTableSize, 1, fileSize))
+    {
+        __throw(fileException);
+    }
+    pThis->pHeader = pHeader;
+    pThis->pSymbols = (const SymbolFileSymbol*)(pThis->pFileBuffer + pHeader->symbolTableOffset);
+    pThis->pStrings = pThis->pFileBuffer + pHeader->stringTableOffset;
+    
+    for (i = 0 ; i < pHeader->symbolCount ; i++)
+    {
+        if (!isSymbolValid(&pThis->pSymbols[i], pHeader, pThis->pStrings))
+            __throw(fileException);
+    }
+}
+
+static int isTableInBounds(uint32_t offset, uint32_t count, size_t elementSize, size_t dataSize)
+{
+    /* The symbols are used in place so they must also be aligned for their fields. */
+    if (elementSize > 1 && (offset % sizeof(uint32_t)) != 0)
+        return 0;
+    return (uint64_t)offset + (uint64_t)count * elementSize <= dataSize;
+}
+
+static int isSymbolValid(const SymbolFileSymbol* pSymbol, const SymbolFileHeader* pHeader, const char* pStrings)
+{
+    if (pSymbol->nameLength == 0 || pSymbol->type > TYPE_IMMEDIATE)
+        return 0;
+    if ((uint64_t)pSymbol->nameOffset + pSymbol->nameLength >= pHeader->stringTableSize)
+        return 0;
+    return pStrings[pSymbol->nameOffset + pSymbol->nameLength] == '\0';
+}
+
+
+void SymbolFile_Free(SymbolFile* pThis)
+{
+    if (!pThis)
+        return;
+    free(pThis->pFileBuffer);
+    free(pThis);
+}
+
+
+size_t SymbolFile_GetSymbolCount(SymbolFile* pThis)
+{
+    return pThis->pHeader->symbolCount;
+}
+
+
+SizedString SymbolFile_GetSymbolName(SymbolFile* pThis, size_t index)
+{
+    const SymbolFileSymbol* pSymbol = &pThis->pSymbols[index];
+    
+    return SizedString_Init(pThis->pStrings + pSymbol->nameOffset, pSymbol->nameLength);
+}
+
+
+Expression SymbolFile_GetSymbolExpression(SymbolFile* pThis, size_t index)
+{
+    const SymbolFileSymbol* pSymbol = &pThis->pSymbols[index];
+    Expression              expression;
+    
+    memset(&expression, 0, sizeof(expression));
+    expression.type = (ExpressionType)pSymbol->type;
+    expression.value = pSymbol->value;
+    
+    return expression;
+}
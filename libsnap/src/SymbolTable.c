@@ -12,6 +12,7 @@
 */
 #include <string.h>
 #include "SymbolTable.h"
+#include "AllocStats.h"
 #include "SymbolTableTest.h"
 #include "util.h"
 
@@ -124,6 +125,25 @@ size_t SymbolTable_GetSymbolCount(SymbolTable* pThis)
 }
 
 
+size_t SymbolTable_GetMaxChainLength(SymbolTable* pThis)
+{
+    size_t maxLength = 0;
+    size_t i;
+    
+    for (i = 0 ; i < pThis->bucketCount ; i++)
+    {
+        Symbol* pCurr = pThis->ppBuckets[i];
+        size_t  length = 0;
+        
+        for ( ; pCurr ; pCurr = pCurr->pNext)
+            length++;
+        if (length > maxLength)
+            maxLength = length;
+    }
+    return maxLength;
+}
+
+
 static Symbol* allocateSymbol(SizedString* pGlobalKey, SizedString* pLocalKey);
 static size_t hashString(SizedString* pGlobalKey, SizedString* pLocalKey);
 __throws Symbol* SymbolTable_Add(SymbolTable* pThis, SizedString* pGlobalKey, SizedString* pLocalKey)
@@ -144,6 +164,7 @@ static Symbol* allocateSymbol(SizedString* pGlobalKey, SizedString* pLocalKey)
 {
     Symbol* pSymbol = NULL;
     
+    AllocStats_SetTag(ALLOC_STATS_TAG_SYMBOL);
     pSymbol = allocateAndZero(sizeof(*pSymbol));
     pSymbol->globalKey = *pGlobalKey;
     pSymbol->localKey = *pLocalKey;
@@ -256,10 +277,12 @@ __throws void Symbol_LineReferenceAdd(Symbol* pSymbol, LineInfo* pLineInfo)
     if (Symbol_LineReferenceExist(pSymbol, pLineInfo))
         return;
         
+    AllocStats_SetTag(ALLOC_STATS_TAG_SYMBOL_LINE_REFERENCE);
     pLineReference = allocateAndZero(sizeof(*pLineReference));
     pLineReference->pLineInfo = pLineInfo;
     pLineReference->pNext = pSymbol->pLineReferences;
     pSymbol->pLineReferences = pLineReference;
+    pLineInfo->forwardReferenceCount++;
 }
 
 
@@ -310,6 +333,7 @@ void Symbol_LineReferenceRemove(Symbol* pSymbol, LineInfo* pLineInfo)
         else
             find.pPrev->pNext = find.pFound->pNext;
         free(find.pFound);
+        pLineInfo->forwardReferenceCount--;
     }
 }
 
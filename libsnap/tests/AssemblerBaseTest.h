@@ -36,6 +36,9 @@ extern "C"
 static const char* g_sourceFilename = "AssemblerTest.S";
 static const char* g_objectFilename = "AssemblerTest.sav";
 static const char* g_listFilename = "AssemblerTest.lst";
+static const char* g_debugMapFilename = "AssemblerTest.map";
+static const char* g_symbolFilename = "AssemblerTest.sym";
+static const char* g_exportSymbolFilename = "AssemblerTestExport.sym";
 
 TEST_BASE(AssemblerBase)
 {
@@ -70,6 +73,9 @@ TEST_BASE(AssemblerBase)
         remove(g_sourceFilename);
         remove(g_objectFilename);
         remove(g_listFilename);
+        remove(g_debugMapFilename);
+        remove(g_symbolFilename);
+        remove(g_exportSymbolFilename);
         LONGS_EQUAL(noException, getExceptionCode());
     }
     
@@ -15,9 +15,62 @@
 */
 #include "AssemblerBaseTest.h"
 
+extern "C"
+{
+    #include "TraceLog.h"
+    #include "DebugMap.h"
+}
+
 
 TEST_GROUP_BASE(AssemblerCore, AssemblerBase)
 {
+    DebugMapView m_debugMap;
+    
+    long readDebugMap()
+    {
+        m_pFile = fopen(g_debugMapFilename, "rb");
+        CHECK(m_pFile != NULL);
+        long size = getFileSize(m_pFile);
+        free(m_pReadBuffer);
+        m_pReadBuffer = (char*)malloc(size);
+        LONGS_EQUAL(size, fread(m_pReadBuffer, 1, size, m_pFile));
+        fclose(m_pFile);
+        m_pFile = NULL;
+        return size;
+    }
+    
+    void validateDebugMapLine(unsigned short address, unsigned int lineNumber, const char* pSymbolName)
+    {
+        const DebugMapLine*   pLine = DebugMapView_FindAddress(&m_debugMap, address);
+        const DebugMapSymbol* pSymbol;
+        
+        CHECK_TRUE(pLine != NULL);
+        STRCMP_EQUAL("filename", DebugMapView_GetFilename(&m_debugMap, pLine));
+        LONGS_EQUAL(lineNumber, pLine->lineNumber);
+        pSymbol = DebugMapView_GetLineSymbol(&m_debugMap, pLine);
+        if (pSymbolName)
+        {
+            STRCMP_EQUAL(pSymbolName, DebugMapView_GetSymbolName(&m_debugMap, pSymbol));
+        }
+        else
+        {
+            POINTERS_EQUAL(NULL, pSymbol);
+        }
+    }
+    
+    void exportSymbols(const char* pSource)
+    {
+        AssemblerInitParams exportParams;
+        Assembler*          pAssembler;
+        
+        memset(&exportParams, 0, sizeof(exportParams));
+        exportParams.keepOutputInMemory = 1;
+        exportParams.pExportSymbolFilename = g_symbolFilename;
+        pAssembler = Assembler_CreateFromString(dupe(pSource), &exportParams);
+        Assembler_Run(pAssembler);
+        LONGS_EQUAL(0, Assembler_GetErrorCount(pAssembler));
+        Assembler_Free(pAssembler);
+    }
 };
 
 
@@ -104,6 +157,266 @@ TEST(AssemblerCore, InitAndCreateActualListFileNotSentToStdOut)
     validateListFileContains(expectedListOutput, sizeof(expectedListOutput)-1);
 }
 
+TEST(AssemblerCore, SkipListingIgnoresListFilename)
+{
+    createSourceFile("SYM1 EQU $1" LINE_ENDING);
+    m_initParams.pListFilename = g_listFilename;
+    m_initParams.skipListing = 1;
+
+    m_pAssembler = Assembler_CreateFromFile(g_sourceFilename, &m_initParams);
+    Assembler_Run(m_pAssembler);
+    LONGS_EQUAL(0, Assembler_GetErrorCount(m_pAssembler));
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    m_pFile = fopen(g_listFilename, "rb");
+    POINTERS_EQUAL(NULL, m_pFile);
+}
+
+TEST(AssemblerCore, StreamListingFreesAllButLastLineDuringFirstPass)
+{
+    m_initParams.streamListing = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" org $800" LINE_ENDING
+                                                   " sta label" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   "label nop" LINE_ENDING
+                                                   " nop" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateLastTwoLinesOfOutputAre("0804: EA           4 label nop" LINE_ENDING,
+                                                   "0805: EA           5  nop" LINE_ENDING, 5);
+    LONGS_EQUAL(5, m_pAssembler->linesHead.pNext->lineNumber);
+    POINTERS_EQUAL(NULL, m_pAssembler->linesHead.pNext->pNext);
+}
+
+TEST(AssemblerCore, StreamListingKeepsLinesFromUnresolvedForwardReference)
+{
+    m_initParams.streamListing = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" nop" LINE_ENDING
+                                                   " sta badLabel" LINE_ENDING
+                                                   " nop" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateFailure("filename:2: error: The 'badLabel' label is undefined." LINE_ENDING,
+                                   "8004: EA           3  nop" LINE_ENDING, 4);
+    LONGS_EQUAL(2, m_pAssembler->linesHead.pNext->lineNumber);
+}
+
+TEST(AssemblerCore, StreamListingStillCatchesRedefinitionOfFreedLabel)
+{
+    m_initParams.streamListing = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" org $800" LINE_ENDING
+                                                   "label sta $2b" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   "label sta $2c" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateFailure("filename:5: error: 'label' symbol has already been defined." LINE_ENDING,
+                                   "0804: 85 2C        5 label sta $2c" LINE_ENDING, 6);
+}
+
+TEST(AssemblerCore, StreamListingKeepsLinesFromOpenConditional)
+{
+    m_initParams.streamListing = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" nop" LINE_ENDING
+                                                   " do 1" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   " nop" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateWarning("filename:2: warning: DO/IF directive is missing matching FIN directive." LINE_ENDING, 
+                                   "8002: EA           4  nop" LINE_ENDING, 5);
+    LONGS_EQUAL(2, m_pAssembler->linesHead.pNext->lineNumber);
+}
+
+TEST(AssemblerCore, StreamListingToFileMatchesListingFromSecondPass)
+{
+    static const char expectedListOutput[] = "    :              1  org $800" LINE_ENDING
+                                             "0800: 8D 05 08     2  sta label" LINE_ENDING
+                                             "0803: EA           3  nop" LINE_ENDING
+                                             "    :              4  do 0" LINE_ENDING
+                                             "    :              5  nop" LINE_ENDING
+                                             "    :              6  fin" LINE_ENDING
+                                             "0804: EA           7  nop" LINE_ENDING
+                                             "0805: EA           8 label nop" LINE_ENDING;
+    createSourceFile(" org $800" LINE_ENDING
+                     " sta label" LINE_ENDING
+                     " nop" LINE_ENDING
+                     " do 0" LINE_ENDING
+                     " nop" LINE_ENDING
+                     " fin" LINE_ENDING
+                     " nop" LINE_ENDING
+                     "label nop" LINE_ENDING);
+    m_initParams.pListFilename = g_listFilename;
+    m_initParams.streamListing = 1;
+
+    printfSpy_Unhook();
+    m_pAssembler = Assembler_CreateFromFile(g_sourceFilename, &m_initParams);
+    Assembler_Run(m_pAssembler);
+    Assembler_Free(m_pAssembler);
+    m_pAssembler = NULL;
+
+    validateListFileContains(expectedListOutput, sizeof(expectedListOutput)-1);
+}
+
+TEST(AssemblerCore, DebugMapOfLinesAndSymbols)
+{
+    m_initParams.pDebugMapFilename = g_debugMapFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe(" org $800" LINE_ENDING
+                                                   "main lda #1" LINE_ENDING
+                                                   ":loop dex" LINE_ENDING
+                                                   " bne :loop" LINE_ENDING
+                                                   "]var equ 5" LINE_ENDING
+                                                   "CONST equ $1234" LINE_ENDING
+                                                   " jmp later" LINE_ENDING
+                                                   "later rts" LINE_ENDING), &m_initParams);
+    Assembler_Run(m_pAssembler);
+    LONGS_EQUAL(0, Assembler_GetErrorCount(m_pAssembler));
+    
+    long size = readDebugMap();
+    DebugMapView_Init(&m_debugMap, m_pReadBuffer, size);
+    LONGS_EQUAL(5, m_debugMap.pHeader->lineCount);
+    LONGS_EQUAL(4, m_debugMap.pHeader->symbolCount);
+    POINTERS_EQUAL(NULL, DebugMapView_FindAddress(&m_debugMap, 0x07FF));
+    validateDebugMapLine(0x0801, 2, "main");
+    validateDebugMapLine(0x0802, 3, "main:loop");
+    validateDebugMapLine(0x0804, 4, NULL);
+    validateDebugMapLine(0x0807, 7, NULL);
+    validateDebugMapLine(0x0808, 8, "later");
+    POINTERS_EQUAL(NULL, DebugMapView_FindAddress(&m_debugMap, 0x0809));
+    LONGS_EQUAL(0x1234, DebugMapView_FindSymbol(&m_debugMap, "CONST")->value);
+    LONGS_EQUAL(0x0808, DebugMapView_FindSymbol(&m_debugMap, "later")->value);
+    POINTERS_EQUAL(NULL, DebugMapView_FindSymbol(&m_debugMap, "]var"));
+}
+
+TEST(AssemblerCore, StreamListingWritesSameDebugMap)
+{
+    createSourceFile(" org $800" LINE_ENDING
+                     "main jsr later" LINE_ENDING
+                     ":loop dex" LINE_ENDING
+                     " bne :loop" LINE_ENDING
+                     " do 0" LINE_ENDING
+                     " nop" LINE_ENDING
+                     " fin" LINE_ENDING
+                     "later rts" LINE_ENDING);
+    m_initParams.pDebugMapFilename = g_debugMapFilename;
+    m_pAssembler = Assembler_CreateFromFile(g_sourceFilename, &m_initParams);
+    Assembler_Run(m_pAssembler);
+    Assembler_Free(m_pAssembler);
+    long  size = readDebugMap();
+    char* pExpected = m_pReadBuffer;
+    m_pReadBuffer = NULL;
+    
+    m_initParams.streamListing = 1;
+    m_pAssembler = Assembler_CreateFromFile(g_sourceFilename, &m_initParams);
+    Assembler_Run(m_pAssembler);
+    LONGS_EQUAL(size, readDebugMap());
+    CHECK(0 == memcmp(pExpected, m_pReadBuffer, size));
+    free(pExpected);
+}
+
+TEST(AssemblerCore, DebugMapNotWrittenWhenAssemblyFails)
+{
+    m_initParams.pDebugMapFilename = g_debugMapFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe(" sta badLabel" LINE_ENDING), &m_initParams);
+    Assembler_Run(m_pAssembler);
+    LONGS_EQUAL(1, Assembler_GetErrorCount(m_pAssembler));
+    m_pFile = fopen(g_debugMapFilename, "rb");
+    POINTERS_EQUAL(NULL, m_pFile);
+}
+
+TEST(AssemblerCore, FailToWriteDebugMap)
+{
+    m_initParams.pDebugMapFilename = g_debugMapFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe(" nop" LINE_ENDING), &m_initParams);
+    fopenFail(NULL);
+        __try_and_catch( Assembler_Run(m_pAssembler) );
+    fopenRestore();
+    validateFileOpenExceptionThrown();
+    STRCMP_EQUAL("filename:1: error: Failed to save debug map." LINE_ENDING, printfSpy_GetLastErrorOutput());
+    LONGS_EQUAL(1, Assembler_GetErrorCount(m_pAssembler));
+}
+
+TEST(AssemblerCore, ImportExportedSymbols)
+{
+    AssemblerStats stats;
+    
+    exportSymbols(" org $800" LINE_ENDING
+                  "main lda #1" LINE_ENDING
+                  ":loop dex" LINE_ENDING
+                  "]var equ 5" LINE_ENDING
+                  "zpage equ $fe" LINE_ENDING
+                  "COUT equ $fded" LINE_ENDING);
+    m_initParams.pImportSymbolFilenames = g_symbolFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe(" jsr COUT" LINE_ENDING
+                                                   " jmp main" LINE_ENDING
+                                                   " lda zpage" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateLastLineIs("8006: A5 FE        3  lda zpage" LINE_ENDING, 3);
+    Assembler_GetStats(m_pAssembler, &stats);
+    LONGS_EQUAL(3, stats.symbolsImported);
+}
+
+TEST(AssemblerCore, ImportSymbolsFromSeveralFilesButOnlyExportOwnLabels)
+{
+    exportSymbols("COUT equ $fded" LINE_ENDING);
+    rename(g_symbolFilename, g_exportSymbolFilename);
+    exportSymbols(" org $800" LINE_ENDING
+                  "main rts" LINE_ENDING);
+    m_initParams.pImportSymbolFilenames = "AssemblerTestExport.sym;AssemblerTest.sym";
+    m_initParams.pExportSymbolFilename = g_exportSymbolFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe(" jsr COUT" LINE_ENDING
+                                                   "entry jmp main" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateLastLineIs("8003: 4C 00 08     2 entry jmp main" LINE_ENDING, 2);
+    
+    SymbolFile* pSymbolFile = SymbolFile_CreateFromFile(g_exportSymbolFilename);
+    SizedString name = SymbolFile_GetSymbolName(pSymbolFile, 0);
+    LONGS_EQUAL(1, SymbolFile_GetSymbolCount(pSymbolFile));
+    STRCMP_EQUAL("entry", name.pString);
+    LONGS_EQUAL(0x8003, SymbolFile_GetSymbolExpression(pSymbolFile, 0).value);
+    SymbolFile_Free(pSymbolFile);
+}
+
+TEST(AssemblerCore, FailToRedefineImportedSymbol)
+{
+    exportSymbols("COUT equ $fded" LINE_ENDING);
+    m_initParams.pImportSymbolFilenames = g_symbolFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe("COUT equ $fdf0" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateFailure("filename:1: error: 'COUT' symbol has already been defined." LINE_ENDING,
+                                   "    :    =FDF0     1 COUT equ $fdf0" LINE_ENDING);
+}
+
+TEST(AssemblerCore, FailToImportSameSymbolTwice)
+{
+    exportSymbols("COUT equ $fded" LINE_ENDING);
+    m_initParams.pImportSymbolFilenames = "AssemblerTest.sym;AssemblerTest.sym";
+    m_pAssembler = Assembler_CreateFromString(dupe(" jsr COUT" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateFailure("filename:0: error: 'COUT' symbol imported from AssemblerTest.sym has already "
+                                   "been defined." LINE_ENDING,
+                                   "8000: 20 ED FD     1  jsr COUT" LINE_ENDING);
+}
+
+TEST(AssemblerCore, FailToImportMissingSymbolFile)
+{
+    m_initParams.pImportSymbolFilenames = "AssemblerTestMissing.sym";
+    m_pAssembler = Assembler_CreateFromString(dupe(" nop" LINE_ENDING), &m_initParams);
+    runAssemblerAndValidateFailure("filename:0: error: Failed to import symbols from AssemblerTestMissing.sym." 
+                                   LINE_ENDING,
+                                   "8000: EA           1  nop" LINE_ENDING);
+}
+
+TEST(AssemblerCore, SymbolFileNotWrittenWhenAssemblyFails)
+{
+    m_initParams.pExportSymbolFilename = g_symbolFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe(" sta badLabel" LINE_ENDING), &m_initParams);
+    Assembler_Run(m_pAssembler);
+    LONGS_EQUAL(1, Assembler_GetErrorCount(m_pAssembler));
+    m_pFile = fopen(g_symbolFilename, "rb");
+    POINTERS_EQUAL(NULL, m_pFile);
+}
+
+TEST(AssemblerCore, FailToWriteSymbolFile)
+{
+    m_initParams.pExportSymbolFilename = g_symbolFilename;
+    m_pAssembler = Assembler_CreateFromString(dupe(" nop" LINE_ENDING), &m_initParams);
+    fopenFail(NULL);
+        __try_and_catch( Assembler_Run(m_pAssembler) );
+    fopenRestore();
+    validateFileOpenExceptionThrown();
+    STRCMP_EQUAL("filename:1: error: Failed to save symbol file." LINE_ENDING, printfSpy_GetLastErrorOutput());
+    LONGS_EQUAL(1, Assembler_GetErrorCount(m_pAssembler));
+}
+
 TEST(AssemblerCore, FailAttemptToOpenListFile)
 {
     m_initParams.pListFilename = g_listFilename;
@@ -210,3 +523,189 @@ TEST(AssemblerCore, FailBinaryBufferAllocationOnEmitThreeByteInstruction)
     runAssemblerAndValidateFailure("filename:1: error: Exceeded the 65536 allowed bytes in the object file." LINE_ENDING,
                                    "    :              1  lda $800" LINE_ENDING);
 }
+
+TEST(AssemblerCore, StatsCountLinesMacrosLupsAndFixups)
+{
+    AssemblerStats stats;
+    
+    m_pAssembler = Assembler_CreateFromString(dupe(" jsr Sub" LINE_ENDING
+                                                   " do 0" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   " fin" LINE_ENDING
+                                                   " lup 3" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   " --^" LINE_ENDING
+                                                   "Bump mac" LINE_ENDING
+                                                   " inc ]1" LINE_ENDING
+                                                   " <<<" LINE_ENDING
+                                                   " Bump $ff" LINE_ENDING
+                                                   "Sub rts" LINE_ENDING), NULL);
+    Assembler_Run(m_pAssembler);
+    Assembler_GetStats(m_pAssembler, &stats);
+    /* The FIN line is skipped along with the NOP since it is parsed before it ends the conditional.  The
+       parameter variables ]0 - ]9 are always in the symbol table. */
+    LONGS_EQUAL(13, stats.linesParsed);
+    LONGS_EQUAL(2, stats.linesSkipped);
+    LONGS_EQUAL(1, stats.macroExpansions);
+    LONGS_EQUAL(3, stats.lupIterations);
+    LONGS_EQUAL(1, stats.forwardReferenceFixups);
+    LONGS_EQUAL(12, stats.symbolCount);
+    LONGS_EQUAL(1, stats.maxSymbolChainLength);
+    LONGS_EQUAL(9, stats.bytesEmitted);
+    LONGS_EQUAL(0, stats.filesOpened);
+    LONGS_EQUAL(0, stats.firstPassMicroseconds);
+    LONGS_EQUAL(0, stats.secondPassMicroseconds);
+}
+
+TEST(AssemblerCore, StatsCountSourceAndPutFilesOpened)
+{
+    static const char putFilename[] = "AssemblerTestStatsPut.S";
+    AssemblerStats    stats;
+    
+    createSourceFile(" put AssemblerTestStatsPut" LINE_ENDING
+                     " put AssemblerTestStatsPut" LINE_ENDING
+                     " put AssemblerTestStatsMissing" LINE_ENDING);
+    createThisSourceFile(putFilename, " nop" LINE_ENDING);
+    m_initParams.collectStats = 1;
+    m_pAssembler = Assembler_CreateFromFile(g_sourceFilename, &m_initParams);
+    Assembler_Run(m_pAssembler);
+    Assembler_GetStats(m_pAssembler, &stats);
+    remove(putFilename);
+    
+    LONGS_EQUAL(3, stats.filesOpened);
+    LONGS_EQUAL(2, stats.bytesEmitted);
+    LONGS_EQUAL(1, Assembler_GetErrorCount(m_pAssembler));
+}
+
+static unsigned int findProfileCalls(const AssemblerProfileEntry* pEntries, size_t entryCount, const char* pName)
+{
+    size_t i;
+    
+    for (i = 0 ; i < entryCount ; i++)
+    {
+        if (0 == strcmp(pEntries[i].pName, pName))
+            return pEntries[i].calls;
+    }
+    return 0;
+}
+
+TEST(AssemblerCore, ProfileCountsDirectivesOpcodesAndAddressingModes)
+{
+    const AssemblerProfileEntry* pEntries;
+    size_t                       entryCount;
+    size_t                       i;
+    
+    m_initParams.collectProfile = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" hex 00" LINE_ENDING
+                                                   " db 1" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   " lda #1" LINE_ENDING
+                                                   " xc" LINE_ENDING
+                                                   " xc" LINE_ENDING
+                                                   " nop" LINE_ENDING
+                                                   " lda #2" LINE_ENDING
+                                                   " lda $800" LINE_ENDING), &m_initParams);
+    Assembler_Run(m_pAssembler);
+    
+    /* NOP and LDA are merged across the 6502 and 65816 instruction sets. */
+    pEntries = Assembler_GetOpcodeProfile(m_pAssembler, &entryCount);
+    LONGS_EQUAL(5, entryCount);
+    LONGS_EQUAL(1, findProfileCalls(pEntries, entryCount, "HEX"));
+    LONGS_EQUAL(1, findProfileCalls(pEntries, entryCount, "DB"));
+    LONGS_EQUAL(2, findProfileCalls(pEntries, entryCount, "XC"));
+    LONGS_EQUAL(2, findProfileCalls(pEntries, entryCount, "NOP"));
+    LONGS_EQUAL(3, findProfileCalls(pEntries, entryCount, "LDA"));
+    for (i = 1 ; i < entryCount ; i++)
+        CHECK_TRUE(pEntries[i - 1].nanoseconds >= pEntries[i].nanoseconds);
+    
+    pEntries = Assembler_GetAddressingModeProfile(m_pAssembler, &entryCount);
+    LONGS_EQUAL(3, entryCount);
+    LONGS_EQUAL(2, findProfileCalls(pEntries, entryCount, "implied"));
+    LONGS_EQUAL(2, findProfileCalls(pEntries, entryCount, "immediate"));
+    LONGS_EQUAL(1, findProfileCalls(pEntries, entryCount, "absolute"));
+}
+
+TEST(AssemblerCore, ProfileNotCollectedByDefault)
+{
+    size_t entryCount = 1;
+    
+    m_pAssembler = Assembler_CreateFromString(dupe(" nop" LINE_ENDING), NULL);
+    Assembler_Run(m_pAssembler);
+    POINTERS_EQUAL(NULL, Assembler_GetOpcodeProfile(m_pAssembler, &entryCount));
+    LONGS_EQUAL(0, entryCount);
+    entryCount = 1;
+    POINTERS_EQUAL(NULL, Assembler_GetAddressingModeProfile(m_pAssembler, &entryCount));
+    LONGS_EQUAL(0, entryCount);
+}
+
+TEST(AssemblerCore, FailAllocationOfOpcodeProfileEntries)
+{
+    size_t entryCount = 1;
+    
+    m_initParams.collectProfile = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" nop" LINE_ENDING), &m_initParams);
+    Assembler_Run(m_pAssembler);
+    MallocFailureInject_FailAllocation(1);
+    __try_and_catch( Assembler_GetOpcodeProfile(m_pAssembler, &entryCount) );
+    MallocFailureInject_Restore();
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    LONGS_EQUAL(0, entryCount);
+    clearExceptionCode();
+}
+
+TEST(AssemblerCore, TraceSpansForPhasesPutsLupsAndMacros)
+{
+    static const char  putFilename[] = "AssemblerTestTracePut.S";
+    static const char  traceFilename[] = "AssemblerTestTrace.json";
+    static const char* expectedNames[] =
+    {
+        "\"assemble AssemblerTest.S\"",
+        "\"first pass\"",
+        "\"PUT AssemblerTestTracePut.S\"",
+        "\"LUP 2\"",
+        "\"Bump\"",
+        "\"undefined symbol check\"",
+        "\"open conditional check\"",
+        "\"second pass\"",
+        "\"marker\""
+    };
+    char        trace[4096];
+    const char* pCurr = trace;
+    size_t      i;
+    
+    /* The macro expansion on the last line is still on the source stack when the first pass ends. */
+    createSourceFile(" put AssemblerTestTracePut" LINE_ENDING
+                     " lup 2" LINE_ENDING
+                     " nop" LINE_ENDING
+                     " --^" LINE_ENDING
+                     "Bump mac" LINE_ENDING
+                     " nop" LINE_ENDING
+                     " <<<" LINE_ENDING
+                     " Bump" LINE_ENDING);
+    createThisSourceFile(putFilename, " nop" LINE_ENDING);
+    TraceLog_Start();
+    m_pAssembler = Assembler_CreateFromFile(g_sourceFilename, &m_initParams);
+    Assembler_Run(m_pAssembler);
+    /* Any spans left open by the assembler would be closed after this one when the trace is written. */
+    TraceLog_Begin("test", "marker");
+    TraceLog_End();
+    TraceLog_WriteToFile(traceFilename);
+    TraceLog_Free();
+    m_pFile = fopen(traceFilename, "rb");
+    CHECK(m_pFile != NULL);
+    trace[fread(trace, 1, sizeof(trace) - 1, m_pFile)] = '\0';
+    fclose(m_pFile);
+    m_pFile = NULL;
+    remove(putFilename);
+    remove(traceFilename);
+    
+    for (i = 0 ; i < ARRAYSIZE(expectedNames) ; i++)
+    {
+        pCurr = strstr(pCurr, expectedNames[i]);
+        CHECK_TRUE(pCurr != NULL);
+    }
+    pCurr = strstr(pCurr, "{\"ph\":\"E\"");
+    CHECK_TRUE(pCurr != NULL);
+    CHECK_TRUE(NULL == strstr(pCurr + 1, "{"));
+    LONGS_EQUAL(0, Assembler_GetErrorCount(m_pAssembler));
+}
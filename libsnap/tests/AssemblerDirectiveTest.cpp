@@ -503,6 +503,51 @@ TEST(AssemblerDirectives, SAV_DirectiveShouldBeIgnoredOnErrors)
     POINTERS_EQUAL(NULL, m_pFile);
 }
 
+TEST(AssemblerDirectives, SAV_DirectiveKeptInMemoryWithoutListing)
+{
+    BinaryBufferFile file;
+    
+    m_initParams.keepOutputInMemory = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" org $800" LINE_ENDING
+                                                   " hex 00,ff" LINE_ENDING
+                                                   " sav AssemblerTest.sav" LINE_ENDING), &m_initParams);
+    Assembler_Run(m_pAssembler);
+    LONGS_EQUAL(0, Assembler_GetErrorCount(m_pAssembler));
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+    m_pFile = fopen(g_objectFilename, "rb");
+    POINTERS_EQUAL(NULL, m_pFile);
+    
+    Assembler_OutputFileEnumStart(m_pAssembler);
+    CHECK_TRUE(Assembler_OutputFileEnumNext(m_pAssembler, &file));
+    STRCMP_EQUAL("AssemblerTest.sav", file.pFilename);
+    LONGS_EQUAL(2, file.contentLength);
+    CHECK_TRUE(0 == memcmp("\x00\xff", file.pContent, 2));
+    LONGS_EQUAL(0x800, file.pSavHeader->address);
+    CHECK_FALSE(Assembler_OutputFileEnumNext(m_pAssembler, &file));
+}
+
+TEST(AssemblerDirectives, USR_DirectiveKeptInMemory)
+{
+    BinaryBufferFile file;
+    
+    m_initParams.keepOutputInMemory = 1;
+    m_pAssembler = Assembler_CreateFromString(dupe(" org $800" LINE_ENDING
+                                                   " hex 00,ff" LINE_ENDING
+                                                   " usr $a9,1,$a00,*-$800" LINE_ENDING), &m_initParams);
+    Assembler_Run(m_pAssembler);
+    LONGS_EQUAL(0, Assembler_GetErrorCount(m_pAssembler));
+    
+    Assembler_OutputFileEnumStart(m_pAssembler);
+    CHECK_TRUE(Assembler_OutputFileEnumNext(m_pAssembler, &file));
+    STRCMP_EQUAL("filename", file.pFilename);
+    LONGS_EQUAL(2, file.contentLength);
+    CHECK_TRUE(file.pSavHeader == NULL);
+    LONGS_EQUAL(0xa9, file.pRW18Header->side);
+    LONGS_EQUAL(1, file.pRW18Header->track);
+    LONGS_EQUAL(0xa00, file.pRW18Header->offset);
+    CHECK_FALSE(Assembler_OutputFileEnumNext(m_pAssembler, &file));
+}
+
 TEST(AssemblerDirectives, SAV_DirectiveMissingOperand)
 {
     m_pAssembler = Assembler_CreateFromString(dupe(" sav" LINE_ENDING), NULL);
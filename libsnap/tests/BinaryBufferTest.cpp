@@ -182,6 +182,15 @@ TEST(BinaryBuffer, Allocate2Items)
     CHECK_TRUE(pAlloc2 == pAlloc1+1);
 }
 
+TEST(BinaryBuffer, AllocatedSizeIncludesReallocatedGrowth)
+{
+    m_pBinaryBuffer = BinaryBuffer_Create(64);
+    LONGS_EQUAL(0, BinaryBuffer_GetAllocatedSize(m_pBinaryBuffer));
+    unsigned char* pAlloc = BinaryBuffer_Alloc(m_pBinaryBuffer, 1);
+    BinaryBuffer_Realloc(m_pBinaryBuffer, pAlloc, 3);
+    LONGS_EQUAL(3, BinaryBuffer_GetAllocatedSize(m_pBinaryBuffer));
+}
+
 TEST(BinaryBuffer, FailToAllocateItem)
 {
     m_pBinaryBuffer = BinaryBuffer_Create(1);
@@ -358,3 +367,51 @@ TEST(BinaryBuffer, QueueUPTwoWritesFromBuffer)
     validateObjectFileContains(g_filename, 0x800, testData1, sizeof(testData1));
     validateObjectFileContains(g_filename2, 0x900, testData2, sizeof(testData2));
 }
+
+TEST(BinaryBuffer, EnumerateEmptyWriteQueue)
+{
+    BinaryBufferFile file;
+    
+    m_pBinaryBuffer = BinaryBuffer_Create(4);
+    BinaryBuffer_WriteFileQueueEnumStart(m_pBinaryBuffer);
+    CHECK_FALSE(BinaryBuffer_WriteFileQueueEnumNext(m_pBinaryBuffer, &file));
+}
+
+TEST(BinaryBuffer, EnumerateQueuedWritesWithoutWritingToDisk)
+{
+    static const unsigned char testData1[2] = { 1, 2 };
+    static const unsigned char testData2[2] = { 3, 4 };
+    BinaryBufferFile           file;
+    
+    m_pBinaryBuffer = BinaryBuffer_Create(4);
+    BinaryBuffer_SetOrigin(m_pBinaryBuffer, 0x800);
+    placeDataInBuffer(testData1, sizeof(testData1));
+    BinaryBuffer_QueueWriteToFile(m_pBinaryBuffer, "dir", toSizedString(g_filename), NULL);
+    BinaryBuffer_SetOrigin(m_pBinaryBuffer, 0x900);
+    placeDataInBuffer(testData2, sizeof(testData2));
+    BinaryBuffer_QueueRW18WriteToFile(m_pBinaryBuffer, NULL, toSizedString(g_filename2), NULL,
+                                      RW18_SIDE_0, RW18_TRACK_1, RW18_OFFSET_0);
+
+    BinaryBuffer_WriteFileQueueEnumStart(m_pBinaryBuffer);
+    CHECK_TRUE(BinaryBuffer_WriteFileQueueEnumNext(m_pBinaryBuffer, &file));
+    STRCMP_EQUAL("dir" SLASH_STR "BinaryBufferTest.test", file.pFilename);
+    LONGS_EQUAL(sizeof(testData1), file.contentLength);
+    CHECK_TRUE(0 == memcmp(testData1, file.pContent, sizeof(testData1)));
+    CHECK_TRUE(file.pRW18Header == NULL);
+    CHECK_TRUE(0 == memcmp(file.pSavHeader->signature, BINARY_BUFFER_SAV_SIGNATURE, 4));
+    LONGS_EQUAL(0x800, file.pSavHeader->address);
+    LONGS_EQUAL(sizeof(testData1), file.pSavHeader->length);
+    
+    CHECK_TRUE(BinaryBuffer_WriteFileQueueEnumNext(m_pBinaryBuffer, &file));
+    STRCMP_EQUAL(g_filename2, file.pFilename);
+    LONGS_EQUAL(sizeof(testData2), file.contentLength);
+    CHECK_TRUE(0 == memcmp(testData2, file.pContent, sizeof(testData2)));
+    CHECK_TRUE(file.pSavHeader == NULL);
+    LONGS_EQUAL(RW18_SIDE_0, file.pRW18Header->side);
+    LONGS_EQUAL(RW18_TRACK_1, file.pRW18Header->track);
+    LONGS_EQUAL(RW18_OFFSET_0, file.pRW18Header->offset);
+    LONGS_EQUAL(sizeof(testData2), file.pRW18Header->length);
+    
+    CHECK_FALSE(BinaryBuffer_WriteFileQueueEnumNext(m_pBinaryBuffer, &file));
+    POINTERS_EQUAL(NULL, fopen(g_filename2, "rb"));
+}
@@ -0,0 +1,428 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "DebugMap.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+    #include "printfSpy.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_mapFilename = "DebugMapTest.map";
+
+
+TEST_GROUP(DebugMap)
+{
+    DebugMap*    m_pDebugMap;
+    char*        m_pMapData;
+    long         m_mapSize;
+    DebugMapView m_view;
+    Symbol       m_symbols[4];
+
+    void setup()
+    {
+        clearExceptionCode();
+        m_pDebugMap = DebugMap_Create();
+        m_pMapData = NULL;
+        m_mapSize = 0;
+        memset(&m_view, 0, sizeof(m_view));
+        memset(m_symbols, 0, sizeof(m_symbols));
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        printfSpy_Unhook();
+        MallocFailureInject_Restore();
+        fopenRestore();
+        fwriteRestore();
+        DebugMap_Free(m_pDebugMap);
+        free(m_pMapData);
+        remove(g_mapFilename);
+    }
+
+    Symbol* initSymbol(int index, const char* pGlobal, const char* pLocal, uint32_t value)
+    {
+        Symbol* pSymbol = &m_symbols[index];
+        
+        pSymbol->globalKey = SizedString_InitFromString(pGlobal);
+        pSymbol->localKey = SizedString_InitFromString(pLocal);
+        pSymbol->expression.value = value;
+        return pSymbol;
+    }
+
+    void writeAndOpenMap()
+    {
+        DebugMap_WriteToFile(m_pDebugMap, g_mapFilename);
+        readMapFile();
+        DebugMapView_Init(&m_view, m_pMapData, m_mapSize);
+    }
+    
+    void readMapFile()
+    {
+        FILE* pFile = fopen(g_mapFilename, "rb");
+        CHECK_TRUE(pFile != NULL);
+        fseek(pFile, 0, SEEK_END);
+        m_mapSize = ftell(pFile);
+        fseek(pFile, 0, SEEK_SET);
+        free(m_pMapData);
+        m_pMapData = (char*)malloc(m_mapSize);
+        LONGS_EQUAL(m_mapSize, fread(m_pMapData, 1, m_mapSize, pFile));
+        fclose(pFile);
+    }
+    
+    void validateAddress(unsigned short address, const char* pFilename, unsigned int lineNumber)
+    {
+        const DebugMapLine* pLine = DebugMapView_FindAddress(&m_view, address);
+        
+        CHECK_TRUE(pLine != NULL);
+        STRCMP_EQUAL(pFilename, DebugMapView_GetFilename(&m_view, pLine));
+        LONGS_EQUAL(lineNumber, pLine->lineNumber);
+    }
+    
+    void validateSymbol(const char* pName, uint32_t expectedValue)
+    {
+        const DebugMapSymbol* pSymbol = DebugMapView_FindSymbol(&m_view, pName);
+        
+        CHECK_TRUE(pSymbol != NULL);
+        STRCMP_EQUAL(pName, DebugMapView_GetSymbolName(&m_view, pSymbol));
+        LONGS_EQUAL(expectedValue, pSymbol->value);
+    }
+    
+    void validateQuery(const char* pQuery, const char* pExpectedOutput, unsigned int expectedMissCount)
+    {
+        printfSpy_Hook(256);
+        LONGS_EQUAL(expectedMissCount, DebugMapView_PrintQueries(&m_view, &pQuery, 1));
+        LONGS_EQUAL(1, printfSpy_GetCallCount());
+        STRCMP_EQUAL(pExpectedOutput, printfSpy_GetLastOutput());
+    }
+    
+    void addLinesAndSymbolsForQueries()
+    {
+        Symbol* pMain = initSymbol(0, "main", NULL, 0x0800);
+        
+        DebugMap_AddLine(m_pDebugMap, 0x0800, 3, "a.s", 1, pMain);
+        DebugMap_AddLine(m_pDebugMap, 0x0803, 1, "a.s", 2, NULL);
+        DebugMap_AddSymbol(m_pDebugMap, pMain);
+        DebugMap_AddSymbol(m_pDebugMap, initSymbol(1, "COUT", NULL, 0xFDED));
+        writeAndOpenMap();
+    }
+    
+    void validateOpenFails()
+    {
+        __try_and_catch( DebugMapView_Init(&m_view, m_pMapData, m_mapSize) );
+        LONGS_EQUAL(fileException, getExceptionCode());
+        clearExceptionCode();
+    }
+    
+    DebugMapHeader* getHeader()
+    {
+        return (DebugMapHeader*)m_pMapData;
+    }
+};
+
+
+TEST(DebugMap, FailAllocationDuringCreate)
+{
+    DebugMap_Free(m_pDebugMap);
+    m_pDebugMap = NULL;
+    
+    MallocFailureInject_FailAllocation(1);
+        __try_and_catch( m_pDebugMap = DebugMap_Create() );
+    POINTERS_EQUAL(NULL, m_pDebugMap);
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(DebugMap, EmptyMap)
+{
+    writeAndOpenMap();
+    LONGS_EQUAL(sizeof(DebugMapHeader), m_mapSize);
+    LONGS_EQUAL(0, m_view.pHeader->lineCount);
+    LONGS_EQUAL(0, m_view.pHeader->symbolCount);
+    POINTERS_EQUAL(NULL, DebugMapView_FindAddress(&m_view, 0x0000));
+    POINTERS_EQUAL(NULL, DebugMapView_FindAddress(&m_view, 0xFFFF));
+    POINTERS_EQUAL(NULL, DebugMapView_FindSymbol(&m_view, "main"));
+}
+
+TEST(DebugMap, FindLinesAddedOutOfAddressOrder)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x1000, 1, "b.s", 5, NULL);
+    DebugMap_AddLine(m_pDebugMap, 0x0803, 3, "a.s", 2, NULL);
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 3, "a.s", 1, NULL);
+    writeAndOpenMap();
+    
+    LONGS_EQUAL(3, m_view.pHeader->lineCount);
+    LONGS_EQUAL(2, m_view.pHeader->fileCount);
+    POINTERS_EQUAL(NULL, DebugMapView_FindAddress(&m_view, 0x07FF));
+    validateAddress(0x0800, "a.s", 1);
+    validateAddress(0x0802, "a.s", 1);
+    validateAddress(0x0803, "a.s", 2);
+    validateAddress(0x0805, "a.s", 2);
+    POINTERS_EQUAL(NULL, DebugMapView_FindAddress(&m_view, 0x0806));
+    validateAddress(0x1000, "b.s", 5);
+    POINTERS_EQUAL(NULL, DebugMapView_FindAddress(&m_view, 0x1001));
+}
+
+TEST(DebugMap, SkipLinesWithoutBytes)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 0, "a.s", 1, NULL);
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 2, NULL);
+    writeAndOpenMap();
+    
+    LONGS_EQUAL(1, m_view.pHeader->lineCount);
+    validateAddress(0x0800, "a.s", 2);
+}
+
+TEST(DebugMap, FindLineWhichStartsInEarlierPage)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x08F0, 0x120, "a.s", 1, NULL);
+    DebugMap_AddLine(m_pDebugMap, 0x0A10, 1, "a.s", 2, NULL);
+    writeAndOpenMap();
+    
+    validateAddress(0x0900, "a.s", 1);
+    validateAddress(0x0A0F, "a.s", 1);
+    validateAddress(0x0A10, "a.s", 2);
+    LONGS_EQUAL(1, m_view.pHeader->pageIndex[0x09]);
+    LONGS_EQUAL(1, m_view.pHeader->pageIndex[0x0A]);
+    LONGS_EQUAL(2, m_view.pHeader->pageIndex[0x0B]);
+}
+
+TEST(DebugMap, LinesAtSameAddressKeepSourceOrder)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 2, "a.s", 1, NULL);
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 2, "a.s", 9, NULL);
+    writeAndOpenMap();
+    
+    LONGS_EQUAL(1, m_view.pLines[0].lineNumber);
+    LONGS_EQUAL(9, m_view.pLines[1].lineNumber);
+    validateAddress(0x0801, "a.s", 9);
+}
+
+TEST(DebugMap, FindSymbolsByName)
+{
+    DebugMap_AddSymbol(m_pDebugMap, initSymbol(0, "main", NULL, 0x0800));
+    DebugMap_AddSymbol(m_pDebugMap, initSymbol(1, "main", ":loop", 0x0803));
+    DebugMap_AddSymbol(m_pDebugMap, initSymbol(2, "COUT", NULL, 0xFDED));
+    DebugMap_AddSymbol(m_pDebugMap, initSymbol(3, "BIG", NULL, 0x12345678));
+    writeAndOpenMap();
+    
+    LONGS_EQUAL(4, m_view.pHeader->symbolCount);
+    STRCMP_EQUAL("BIG", DebugMapView_GetSymbolName(&m_view, &m_view.pSymbols[0]));
+    STRCMP_EQUAL("COUT", DebugMapView_GetSymbolName(&m_view, &m_view.pSymbols[1]));
+    STRCMP_EQUAL("main", DebugMapView_GetSymbolName(&m_view, &m_view.pSymbols[2]));
+    STRCMP_EQUAL("main:loop", DebugMapView_GetSymbolName(&m_view, &m_view.pSymbols[3]));
+    validateSymbol("main", 0x0800);
+    validateSymbol("main:loop", 0x0803);
+    validateSymbol("COUT", 0xFDED);
+    validateSymbol("BIG", 0x12345678);
+    POINTERS_EQUAL(NULL, DebugMapView_FindSymbol(&m_view, "cout"));
+    POINTERS_EQUAL(NULL, DebugMapView_FindSymbol(&m_view, "main:"));
+}
+
+TEST(DebugMap, LineRefersToItsLabelInSymbolTable)
+{
+    Symbol* pMain = initSymbol(0, "main", NULL, 0x0800);
+    Symbol* pLoop = initSymbol(1, "main", ":loop", 0x0803);
+    Symbol* pNotAdded = initSymbol(2, "]var", NULL, 0x0806);
+    
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 3, "a.s", 1, pMain);
+    DebugMap_AddLine(m_pDebugMap, 0x0803, 3, "a.s", 2, pLoop);
+    DebugMap_AddLine(m_pDebugMap, 0x0806, 1, "a.s", 3, pNotAdded);
+    DebugMap_AddLine(m_pDebugMap, 0x0807, 1, "a.s", 4, NULL);
+    DebugMap_AddSymbol(m_pDebugMap, pLoop);
+    DebugMap_AddSymbol(m_pDebugMap, pMain);
+    writeAndOpenMap();
+    
+    STRCMP_EQUAL("main", DebugMapView_GetSymbolName(&m_view, 
+                                                    DebugMapView_GetLineSymbol(&m_view, &m_view.pLines[0])));
+    STRCMP_EQUAL("main:loop", DebugMapView_GetSymbolName(&m_view, 
+                                                         DebugMapView_GetLineSymbol(&m_view, &m_view.pLines[1])));
+    LONGS_EQUAL(DEBUG_MAP_NO_SYMBOL, m_view.pLines[2].symbolIndex);
+    POINTERS_EQUAL(NULL, DebugMapView_GetLineSymbol(&m_view, &m_view.pLines[2]));
+    POINTERS_EQUAL(NULL, DebugMapView_GetLineSymbol(&m_view, &m_view.pLines[3]));
+}
+
+TEST(DebugMap, ManyLinesAndFilesGrowTables)
+{
+    static const char* filenames[] = { "a.s", "b.s", "c.s", "d.s", "e.s", "f.s", "g.s", "h.s", "i.s", "j.s" };
+    unsigned int       i;
+    
+    for (i = 0 ; i < 5000 ; i++)
+        DebugMap_AddLine(m_pDebugMap, (unsigned short)(i * 3), 3, filenames[i % ARRAYSIZE(filenames)], i + 1, NULL);
+    writeAndOpenMap();
+    
+    LONGS_EQUAL(5000, m_view.pHeader->lineCount);
+    LONGS_EQUAL(ARRAYSIZE(filenames), m_view.pHeader->fileCount);
+    for (i = 0 ; i < 5000 ; i++)
+        validateAddress((unsigned short)(i * 3 + 2), filenames[i % ARRAYSIZE(filenames)], i + 1);
+}
+
+TEST(DebugMap, FailAllocationsWhenAddingLine)
+{
+    static const int allocationsToFail = 3;
+    for (int i = 1 ; i <= allocationsToFail ; i++)
+    {
+        DebugMap_Free(m_pDebugMap);
+        m_pDebugMap = DebugMap_Create();
+        MallocFailureInject_FailAllocation(i);
+            __try_and_catch( DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 1, NULL) );
+        MallocFailureInject_Restore();
+        LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+        clearExceptionCode();
+    }
+    
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 1, NULL);
+    writeAndOpenMap();
+    LONGS_EQUAL(1, m_view.pHeader->lineCount);
+    validateAddress(0x0800, "a.s", 1);
+}
+
+TEST(DebugMap, FailAllocationWhenAddingSymbol)
+{
+    MallocFailureInject_FailAllocation(1);
+        __try_and_catch( DebugMap_AddSymbol(m_pDebugMap, initSymbol(0, "main", NULL, 0x0800)) );
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(DebugMap, FailAllocationOfTablesDuringWrite)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 1, NULL);
+    MallocFailureInject_FailAllocation(1);
+        __try_and_catch( DebugMap_WriteToFile(m_pDebugMap, g_mapFilename) );
+    LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(DebugMap, FailToOpenFileForWrite)
+{
+    fopenFail(NULL);
+        __try_and_catch( DebugMap_WriteToFile(m_pDebugMap, g_mapFilename) );
+    LONGS_EQUAL(fileOpenException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(DebugMap, FailWrite)
+{
+    fwriteFail(0);
+        __try_and_catch( DebugMap_WriteToFile(m_pDebugMap, g_mapFilename) );
+    LONGS_EQUAL(fileException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(DebugMap, FailToOpenTruncatedMap)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 1, NULL);
+    writeAndOpenMap();
+    
+    m_mapSize--;
+    validateOpenFails();
+    m_mapSize = sizeof(DebugMapHeader) - 1;
+    validateOpenFails();
+}
+
+TEST(DebugMap, FailToOpenMapWithBadSignatureOrVersion)
+{
+    writeAndOpenMap();
+    
+    getHeader()->signature[0] = 'X';
+    validateOpenFails();
+    getHeader()->signature[0] = 'S';
+    getHeader()->version++;
+    validateOpenFails();
+}
+
+TEST(DebugMap, FailToOpenMapWithMisalignedTable)
+{
+    writeAndOpenMap();
+    
+    getHeader()->symbolTableOffset++;
+    validateOpenFails();
+}
+
+TEST(DebugMap, FailToOpenMapWithUnterminatedStringTable)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 1, NULL);
+    writeAndOpenMap();
+    
+    m_pMapData[m_mapSize - 1] = 'x';
+    validateOpenFails();
+}
+
+TEST(DebugMap, FailToOpenMapWithBadPageIndex)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 1, NULL);
+    writeAndOpenMap();
+    
+    getHeader()->pageIndex[DEBUG_MAP_PAGE_COUNT] = 2;
+    validateOpenFails();
+    getHeader()->pageIndex[DEBUG_MAP_PAGE_COUNT] = 1;
+    getHeader()->pageIndex[0] = 1;
+    validateOpenFails();
+}
+
+TEST(DebugMap, OutOfRangeIndicesReturnEmptyStrings)
+{
+    DebugMap_AddLine(m_pDebugMap, 0x0800, 1, "a.s", 1, NULL);
+    writeAndOpenMap();
+    
+    DebugMapLine   line = m_view.pLines[0];
+    DebugMapSymbol symbol = { 0xFFFF, 0 };
+    line.fileIndex = 1;
+    STRCMP_EQUAL("", DebugMapView_GetFilename(&m_view, &line));
+    STRCMP_EQUAL("", DebugMapView_GetSymbolName(&m_view, &symbol));
+}
+
+TEST(DebugMap, PrintQueriesByAddress)
+{
+    addLinesAndSymbolsForQueries();
+    validateQuery("$0802", "$0802: a.s:1 ($0800-$0802 main)" LINE_ENDING, 0);
+    validateQuery("0x803", "$0803: a.s:2 ($0803-$0803)" LINE_ENDING, 0);
+    validateQuery("$0804", "$0804: not found" LINE_ENDING, 1);
+}
+
+TEST(DebugMap, PrintQueriesBySymbol)
+{
+    addLinesAndSymbolsForQueries();
+    validateQuery("main", "main: $0800 a.s:1 ($0800-$0802 main)" LINE_ENDING, 0);
+    validateQuery("COUT", "COUT: $FDED" LINE_ENDING, 0);
+    validateQuery("nosuch", "nosuch: not found" LINE_ENDING, 1);
+}
+
+TEST(DebugMap, PrintQueriesTreatsUnprefixedOrOutOfRangeAddressesAsSymbols)
+{
+    addLinesAndSymbolsForQueries();
+    validateQuery("0803", "0803: not found" LINE_ENDING, 1);
+    validateQuery("$10000", "$10000: not found" LINE_ENDING, 1);
+    validateQuery("$", "$: not found" LINE_ENDING, 1);
+}
+
+TEST(DebugMap, PrintQueriesReturnsCountOfQueriesNotFound)
+{
+    const char* queries[] = { "main", "$0900", "$0800", "nosuch" };
+    
+    addLinesAndSymbolsForQueries();
+    printfSpy_Hook(256);
+    LONGS_EQUAL(2, DebugMapView_PrintQueries(&m_view, queries, sizeof(queries)/sizeof(queries[0])));
+    LONGS_EQUAL(4, printfSpy_GetCallCount());
+    STRCMP_EQUAL("nosuch: not found" LINE_ENDING, printfSpy_GetLastOutput());
+    LONGS_EQUAL(0, DebugMapView_PrintQueries(&m_view, queries, 1));
+}
@@ -165,3 +165,45 @@ TEST(ListFile, OutputLineWithIndentation)
 
     STRCMP_EQUAL("0800: CA               3  DEX" LINE_ENDING, printfSpy_GetLastOutput());
 }
+
+TEST(ListFile, OutputLineWithHexLettersAndFiveDigitLineNumber)
+{
+    m_lineInfo.lineText = SizedString_InitFromString(" LDA $ABCD");
+    m_lineInfo.lineNumber = 65536;
+    m_lineInfo.address = 0xBEEF;
+    m_lineInfo.machineCodeSize = 3;
+    m_lineInfo.pMachineCode[0] = 0xAD;
+    m_lineInfo.pMachineCode[1] = 0xCD;
+    m_lineInfo.pMachineCode[2] = 0xAB;
+    ListFile_OutputLine(m_pListFile, &m_lineInfo);
+
+    STRCMP_EQUAL("BEEF: AD CD AB  65536  LDA $ABCD" LINE_ENDING, printfSpy_GetLastOutput());
+}
+
+TEST(ListFile, OutputLineWithSevenAndEightDigitEquValues)
+{
+    m_lineInfo.lineText = SizedString_InitFromString("LABEL EQU $ABCDEF0");
+    m_lineInfo.lineNumber = 1;
+    m_lineInfo.flags = LINEINFO_FLAG_WAS_EQU;
+    m_lineInfo.equValue = 0xABCDEF0;
+    ListFile_OutputLine(m_pListFile, &m_lineInfo);
+    STRCMP_EQUAL("    : =ABCDEF0     1 LABEL EQU $ABCDEF0" LINE_ENDING, printfSpy_GetLastOutput());
+
+    m_lineInfo.lineText = SizedString_InitFromString("LABEL EQU $12345678");
+    m_lineInfo.equValue = 0x12345678;
+    ListFile_OutputLine(m_pListFile, &m_lineInfo);
+    STRCMP_EQUAL("    : =...5678     1 LABEL EQU $12345678" LINE_ENDING, printfSpy_GetLastOutput());
+}
+
+TEST(ListFile, OverflowLineAddressWrapsAround)
+{
+    m_lineInfo.lineText = SizedString_InitFromString(" HEX 01020304");
+    m_lineInfo.lineNumber = 2;
+    m_lineInfo.address = 0xFFFE;
+    m_lineInfo.machineCodeSize = 4;
+    memcpy(m_lineInfo.pMachineCode, "\x01\x02\x03\x04", 4);
+    ListFile_OutputLine(m_pListFile, &m_lineInfo);
+
+    STRCMP_EQUAL("FFFE: 01 02 03     2  HEX 01020304" LINE_ENDING, printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("0001: 04      " LINE_ENDING, printfSpy_GetLastOutput());
+}
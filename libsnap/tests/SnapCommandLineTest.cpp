@@ -111,6 +111,76 @@ TEST(SnapCommandLine, OneSourceFilename)
     
     SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
     validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    LONGS_EQUAL(0, m_commandLine.assemblerInitParams.collectStats);
+    LONGS_EQUAL(0, m_commandLine.assemblerInitParams.collectProfile);
+    LONGS_EQUAL(0, m_commandLine.assemblerInitParams.streamListing);
+    POINTERS_EQUAL(NULL, m_commandLine.assemblerInitParams.pDebugMapFilename);
+    POINTERS_EQUAL(NULL, m_commandLine.assemblerInitParams.pImportSymbolFilenames);
+    POINTERS_EQUAL(NULL, m_commandLine.assemblerInitParams.pExportSymbolFilename);
+    LONGS_EQUAL(0, m_commandLine.collectAllocStats);
+    LONGS_EQUAL(0, m_commandLine.collectPerfCounters);
+    POINTERS_EQUAL(NULL, m_commandLine.pTraceFilename);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndStats)
+{
+    addArg("--stats");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    LONGS_EQUAL(1, m_commandLine.assemblerInitParams.collectStats);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndProfile)
+{
+    addArg("--profile");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    LONGS_EQUAL(1, m_commandLine.assemblerInitParams.collectProfile);
+    LONGS_EQUAL(0, m_commandLine.assemblerInitParams.collectStats);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndAllocStats)
+{
+    addArg("--alloc-stats");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    LONGS_EQUAL(1, m_commandLine.collectAllocStats);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndPerfCounters)
+{
+    addArg("--perf-counters");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    LONGS_EQUAL(1, m_commandLine.collectPerfCounters);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndTraceFilename)
+{
+    addArg("--trace");
+    addArg("SOURCE1.json");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    STRCMP_EQUAL("SOURCE1.json", m_commandLine.pTraceFilename);
+}
+
+TEST(SnapCommandLine, FailOnTraceWithoutFilename)
+{
+    addArg("SOURCE1.S");
+    addArg("--trace");
+    
+    __try_and_catch( SnapCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrownAndUsageStringDisplayed();
 }
 
 TEST(SnapCommandLine, OneSourceFilenameAndListFilename)
@@ -121,6 +191,71 @@ TEST(SnapCommandLine, OneSourceFilenameAndListFilename)
     
     SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
     validateParamsAndNoErrorMessage("SOURCE1.S", "SOURCE1.LST");
+    LONGS_EQUAL(0, m_commandLine.assemblerInitParams.skipListing);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndNoListing)
+{
+    addArg("--list");
+    addArg("none");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    LONGS_EQUAL(1, m_commandLine.assemblerInitParams.skipListing);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndStreamListing)
+{
+    addArg("--stream-list");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    LONGS_EQUAL(1, m_commandLine.assemblerInitParams.streamListing);
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndDebugMapFilename)
+{
+    addArg("--debug-map");
+    addArg("SOURCE1.map");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    STRCMP_EQUAL("SOURCE1.map", m_commandLine.assemblerInitParams.pDebugMapFilename);
+}
+
+TEST(SnapCommandLine, FailOnDebugMapWithoutFilename)
+{
+    addArg("SOURCE1.S");
+    addArg("--debug-map");
+    
+    __try_and_catch( SnapCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrownAndUsageStringDisplayed();
+}
+
+TEST(SnapCommandLine, OneSourceFilenameAndImportAndExportSymbolFilenames)
+{
+    addArg("--import-symbols");
+    addArg("EQ.sym;GAMEEQ.sym");
+    addArg("--export-symbols");
+    addArg("SOURCE1.sym");
+    addArg("SOURCE1.S");
+    
+    SnapCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    validateParamsAndNoErrorMessage("SOURCE1.S", NULL);
+    STRCMP_EQUAL("EQ.sym;GAMEEQ.sym", m_commandLine.assemblerInitParams.pImportSymbolFilenames);
+    STRCMP_EQUAL("SOURCE1.sym", m_commandLine.assemblerInitParams.pExportSymbolFilename);
+}
+
+TEST(SnapCommandLine, FailOnExportSymbolsWithoutFilename)
+{
+    addArg("SOURCE1.S");
+    addArg("--export-symbols");
+    
+    __try_and_catch( SnapCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrownAndUsageStringDisplayed();
 }
 
 TEST(SnapCommandLine, OneSourceFilenameAndPutDirectories)
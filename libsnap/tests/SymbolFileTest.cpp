@@ -0,0 +1,304 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+    #include "SymbolFile.h"
+    #include "MallocFailureInject.h"
+    #include "FileFailureInject.h"
+    #include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+static const char* g_symbolFilename = "SymbolFileTest.sym";
+
+
+TEST_GROUP(SymbolFile)
+{
+    SymbolTable* m_pSymbolTable;
+    SymbolFile*  m_pSymbolFile;
+    char*        m_pFileData;
+    long         m_fileSize;
+    LineInfo     m_lineInfo;
+
+    void setup()
+    {
+        clearExceptionCode();
+        m_pSymbolTable = SymbolTable_Create(11);
+        m_pSymbolFile = NULL;
+        m_pFileData = NULL;
+        m_fileSize = 0;
+        memset(&m_lineInfo, 0, sizeof(m_lineInfo));
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        fopenRestore();
+        fseekRestore();
+        ftellRestore();
+        fwriteRestore();
+        freadRestore();
+        SymbolFile_Free(m_pSymbolFile);
+        SymbolTable_Free(m_pSymbolTable);
+        free(m_pFileData);
+        remove(g_symbolFilename);
+    }
+
+    Symbol* addSymbol(const char* pGlobal, const char* pLocal, uint32_t value, ExpressionType type = TYPE_ABSOLUTE)
+    {
+        SizedString globalKey = SizedString_InitFromString(pGlobal);
+        SizedString localKey = SizedString_InitFromString(pLocal);
+        Symbol*     pSymbol = SymbolTable_Add(m_pSymbolTable, &globalKey, &localKey);
+        
+        pSymbol->pDefinedLine = &m_lineInfo;
+        pSymbol->expression.type = type;
+        pSymbol->expression.value = value;
+        return pSymbol;
+    }
+
+    void writeAndReadSymbolFile()
+    {
+        SymbolFile_Write(m_pSymbolTable, g_symbolFilename);
+        m_pSymbolFile = SymbolFile_CreateFromFile(g_symbolFilename);
+    }
+    
+    void validateSymbol(const char* pName, uint32_t expectedValue, ExpressionType expectedType = TYPE_ABSOLUTE)
+    {
+        size_t i;
+        
+        for (i = 0 ; i < SymbolFile_GetSymbolCount(m_pSymbolFile) ; i++)
+        {
+            SizedString name = SymbolFile_GetSymbolName(m_pSymbolFile, i);
+            Expression  expression;
+            
+            if (0 != SizedString_strcmp(&name, pName))
+                continue;
+            expression = SymbolFile_GetSymbolExpression(m_pSymbolFile, i);
+            LONGS_EQUAL(expectedValue, expression.value);
+            LONGS_EQUAL(expectedType, expression.type);
+            LONGS_EQUAL(0, expression.flags);
+            LONGS_EQUAL('\0', name.pString[name.stringLength]);
+            return;
+        }
+        FAIL("Symbol wasn't found in the symbol file.");
+    }
+    
+    void readFileData()
+    {
+        FILE* pFile = fopen(g_symbolFilename, "rb");
+        CHECK_TRUE(pFile != NULL);
+        fseek(pFile, 0, SEEK_END);
+        m_fileSize = ftell(pFile);
+        fseek(pFile, 0, SEEK_SET);
+        m_pFileData = (char*)malloc(m_fileSize);
+        LONGS_EQUAL(m_fileSize, fread(m_pFileData, 1, m_fileSize, pFile));
+        fclose(pFile);
+    }
+    
+    void validateReadFailsAfterChange()
+    {
+        FILE* pFile = fopen(g_symbolFilename, "wb");
+        CHECK_TRUE(pFile != NULL);
+        LONGS_EQUAL(m_fileSize, fwrite(m_pFileData, 1, m_fileSize, pFile));
+        fclose(pFile);
+        
+        __try_and_catch( m_pSymbolFile = SymbolFile_CreateFromFile(g_symbolFilename) );
+        POINTERS_EQUAL(NULL, m_pSymbolFile);
+        LONGS_EQUAL(fileException, getExceptionCode());
+        clearExceptionCode();
+    }
+    
+    SymbolFileHeader* getHeader()
+    {
+        return (SymbolFileHeader*)m_pFileData;
+    }
+    
+    SymbolFileSymbol* getSymbol(size_t index)
+    {
+        return (SymbolFileSymbol*)(m_pFileData + getHeader()->symbolTableOffset) + index;
+    }
+};
+
+
+TEST(SymbolFile, EmptySymbolTable)
+{
+    writeAndReadSymbolFile();
+    LONGS_EQUAL(0, SymbolFile_GetSymbolCount(m_pSymbolFile));
+}
+
+TEST(SymbolFile, RoundTripGlobalLabelsWithTheirValuesAndTypes)
+{
+    addSymbol("main", NULL, 0x0800);
+    addSymbol("zpage", NULL, 0x00FE, TYPE_ZEROPAGE);
+    addSymbol("LongAddress", NULL, 0x123456);
+    writeAndReadSymbolFile();
+    
+    LONGS_EQUAL(3, SymbolFile_GetSymbolCount(m_pSymbolFile));
+    validateSymbol("main", 0x0800);
+    validateSymbol("zpage", 0x00FE, TYPE_ZEROPAGE);
+    validateSymbol("LongAddress", 0x123456);
+}
+
+TEST(SymbolFile, LeaveOutLocalLabelsVariablesUndefinedAndImportedSymbols)
+{
+    addSymbol("main", NULL, 0x0800);
+    addSymbol("main", ":loop", 0x0803);
+    addSymbol("]var", NULL, 0x0001);
+    addSymbol("undefined", NULL, 0)->pDefinedLine = NULL;
+    addSymbol("imported", NULL, 0xFDED)->flags |= SYMBOL_FLAG_IMPORTED;
+    writeAndReadSymbolFile();
+    
+    LONGS_EQUAL(1, SymbolFile_GetSymbolCount(m_pSymbolFile));
+    validateSymbol("main", 0x0800);
+}
+
+TEST(SymbolFile, FailAllocationsDuringWrite)
+{
+    addSymbol("main", NULL, 0x0800);
+    for (int i = 1 ; i <= 2 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+            __try_and_catch( SymbolFile_Write(m_pSymbolTable, g_symbolFilename) );
+        MallocFailureInject_Restore();
+        LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+        clearExceptionCode();
+    }
+}
+
+TEST(SymbolFile, FailToOpenFileForWrite)
+{
+    fopenFail(NULL);
+        __try_and_catch( SymbolFile_Write(m_pSymbolTable, g_symbolFilename) );
+    LONGS_EQUAL(fileOpenException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(SymbolFile, FailWrite)
+{
+    fwriteFail(0);
+        __try_and_catch( SymbolFile_Write(m_pSymbolTable, g_symbolFilename) );
+    LONGS_EQUAL(fileException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(SymbolFile, FailToOpenMissingFile)
+{
+    __try_and_catch( m_pSymbolFile = SymbolFile_CreateFromFile("SymbolFileTestMissing.sym") );
+    POINTERS_EQUAL(NULL, m_pSymbolFile);
+    LONGS_EQUAL(fileOpenException, getExceptionCode());
+    clearExceptionCode();
+}
+
+TEST(SymbolFile, FailAllocationsDuringRead)
+{
+    addSymbol("main", NULL, 0x0800);
+    SymbolFile_Write(m_pSymbolTable, g_symbolFilename);
+    for (int i = 1 ; i <= 2 ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+            __try_and_catch( m_pSymbolFile = SymbolFile_CreateFromFile(g_symbolFilename) );
+        MallocFailureInject_Restore();
+        POINTERS_EQUAL(NULL, m_pSymbolFile);
+        LONGS_EQUAL(outOfMemoryException, getExceptionCode());
+        clearExceptionCode();
+    }
+}
+
+TEST(SymbolFile, FailSeeksTellAndReadDuringRead)
+{
+    SymbolFile_Write(m_pSymbolTable, g_symbolFilename);
+    for (int i = 0 ; i < 2 ; i++)
+    {
+        fseekSetFailureCode(-1);
+        fseekSetCallsBeforeFailure(i);
+            __try_and_catch( m_pSymbolFile = SymbolFile_CreateFromFile(g_symbolFilename) );
+        fseekRestore();
+        LONGS_EQUAL(fileException, getExceptionCode());
+        clearExceptionCode();
+    }
+    
+    ftellFail(-1);
+        __try_and_catch( m_pSymbolFile = SymbolFile_CreateFromFile(g_symbolFilename) );
+    ftellRestore();
+    LONGS_EQUAL(fileException, getExceptionCode());
+    clearExceptionCode();
+    
+    freadFail(0);
+        __try_and_catch( m_pSymbolFile = SymbolFile_CreateFromFile(g_symbolFilename) );
+    freadRestore();
+    LONGS_EQUAL(fileException, getExceptionCode());
+    clearExceptionCode();
+    POINTERS_EQUAL(NULL, m_pSymbolFile);
+}
+
+TEST(SymbolFile, FailToReadTruncatedFile)
+{
+    addSymbol("main", NULL, 0x0800);
+    SymbolFile_Write(m_pSymbolTable, g_symbolFilename);
+    readFileData();
+    
+    m_fileSize--;
+    validateReadFailsAfterChange();
+    m_fileSize = sizeof(SymbolFileHeader) - 1;
+    validateReadFailsAfterChange();
+}
+
+TEST(SymbolFile, FailToReadBadSignatureOrVersion)
+{
+    SymbolFile_Write(m_pSymbolTable, g_symbolFilename);
+    readFileData();
+    
+    getHeader()->signature[0] = 'X';
+    validateReadFailsAfterChange();
+    getHeader()->signature[0] = 'S';
+    getHeader()->version++;
+    validateReadFailsAfterChange();
+}
+
+TEST(SymbolFile, FailToReadMisalignedSymbolTable)
+{
+    addSymbol("main", NULL, 0x0800);
+    SymbolFile_Write(m_pSymbolTable, g_symbolFilename);
+    readFileData();
+    
+    getHeader()->symbolTableOffset++;
+    validateReadFailsAfterChange();
+}
+
+TEST(SymbolFile, FailToReadSymbolsWithBadNamesOrType)
+{
+    addSymbol("main", NULL, 0x0800);
+    SymbolFile_Write(m_pSymbolTable, g_symbolFilename);
+    readFileData();
+    
+    getSymbol(0)->nameLength++;
+    validateReadFailsAfterChange();
+    getSymbol(0)->nameLength--;
+    getSymbol(0)->nameOffset = getHeader()->stringTableSize;
+    validateReadFailsAfterChange();
+    getSymbol(0)->nameOffset = 0;
+    getSymbol(0)->nameLength = 0;
+    validateReadFailsAfterChange();
+    getSymbol(0)->nameLength = 4;
+    getSymbol(0)->type = TYPE_IMMEDIATE + 1;
+    validateReadFailsAfterChange();
+    getSymbol(0)->type = TYPE_ABSOLUTE;
+    getHeader()->stringTableSize++;
+    validateReadFailsAfterChange();
+}
@@ -43,6 +43,7 @@ TEST_GROUP(SymbolTable)
     {
         clearExceptionCode();
         memset(&m_lineInfo1, 0, sizeof(m_lineInfo1));
+        memset(&m_lineInfo2, 0, sizeof(m_lineInfo2));
         m_pSymbolTable = NULL;
         m_pSymbol1 = NULL;
         m_pSymbol2 = NULL;
@@ -129,6 +130,7 @@ TEST(SymbolTable, EmptySymbolTable)
 {
     m_pSymbolTable = SymbolTable_Create(1);
     LONGS_EQUAL(0, SymbolTable_GetSymbolCount(m_pSymbolTable));
+    LONGS_EQUAL(0, SymbolTable_GetMaxChainLength(m_pSymbolTable));
 }
 
 TEST(SymbolTable, FailSymbolTableEntry)
@@ -228,6 +230,20 @@ TEST(SymbolTable, FindSecondItemInBucket)
     validateSymbolKeys(pSymbol, &m_Key2, &m_Empty);
 }
 
+TEST(SymbolTable, MaxChainLengthWithBothItemsInOneBucket)
+{
+    m_pSymbolTable = SymbolTable_Create(1);
+    createTwoSymbols();
+    LONGS_EQUAL(2, SymbolTable_GetMaxChainLength(m_pSymbolTable));
+}
+
+TEST(SymbolTable, MaxChainLengthWithOneItem)
+{
+    m_pSymbolTable = SymbolTable_Create(5);
+    SymbolTable_Add(m_pSymbolTable, &m_Key1, &m_Empty);
+    LONGS_EQUAL(1, SymbolTable_GetMaxChainLength(m_pSymbolTable));
+}
+
 TEST(SymbolTable, FindBothItemsInBucketWithFind)
 {
     const Symbol* pSymbol = NULL;
@@ -361,6 +377,23 @@ TEST(SymbolTable, AddTwoLineInfoToSymbolAndVerifyEnumerateInReverseOrder)
     nextLineEnumAttemptShouldFail(m_pSymbol1);
 }
 
+TEST(SymbolTable, CountLineReferencesInLineInfo)
+{
+    m_pSymbolTable = SymbolTable_Create(2);
+    createTwoSymbols();
+    Symbol_LineReferenceAdd(m_pSymbol1, &m_lineInfo1);
+    Symbol_LineReferenceAdd(m_pSymbol1, &m_lineInfo1);
+    Symbol_LineReferenceAdd(m_pSymbol2, &m_lineInfo1);
+    LONGS_EQUAL(2, m_lineInfo1.forwardReferenceCount);
+    
+    Symbol_LineReferenceRemove(m_pSymbol1, &m_lineInfo1);
+    Symbol_LineReferenceRemove(m_pSymbol1, &m_lineInfo1);
+    LONGS_EQUAL(1, m_lineInfo1.forwardReferenceCount);
+    Symbol_LineReferenceRemove(m_pSymbol2, &m_lineInfo1);
+    LONGS_EQUAL(0, m_lineInfo1.forwardReferenceCount);
+    LONGS_EQUAL(0, m_lineInfo2.forwardReferenceCount);
+}
+
 TEST(SymbolTable, EnumerateEmptyLineReferenceList)
 {
     m_pSymbolTable = SymbolTable_Create(1);
@@ -0,0 +1,978 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include "BuildProject.h"
+#include "BuildProjectTest.h"
+#include "TextFile.h"
+#include "ParseCSV.h"
+#include "Hash64.h"
+#include "util.h"
+
+
+#define STATE_HEADER    "# snapbuild state v1"
+#define NO_NODE         ((size_t)~0)
+
+
+typedef struct BuildProjectNode
+{
+    BuildNode    node;
+    size_t*      pDependencies;
+    size_t       dependencyCount;
+    size_t       allocatedInputCount;
+    size_t       allocatedOutputCount;
+    unsigned int lineNumber;
+    int          visitState;
+    uint64_t     inputHash;
+    uint64_t     outputHash;
+    size_t       criticalPredecessor;
+    unsigned int criticalMilliseconds;
+    int          criticalPathCalculated;
+} BuildProjectNode;
+
+typedef struct BuildStateEntry
+{
+    char*    pName;
+    uint64_t inputHash;
+    uint64_t outputHash;
+} BuildStateEntry;
+
+struct BuildProject
+{
+    BuildProjectNode* pNodes;
+    size_t            nodeCount;
+    size_t            allocatedNodeCount;
+    BuildStateEntry*  pStateEntries;
+    size_t            stateEntryCount;
+    size_t            allocatedStateEntryCount;
+    const char*       pProjectFilename;
+    unsigned int      lineNumber;
+    unsigned int      errorCount;
+    unsigned int      runningCount;
+    unsigned int      failedCount;
+};
+
+
+#define LOG_ERROR(pTHIS, FORMAT, ...) (pTHIS->errorCount++, \
+                                       fprintf(stderr, \
+                                       "%s:%u: error: " FORMAT LINE_ENDING, \
+                                       pTHIS->pProjectFilename, \
+                                       pTHIS->lineNumber, \
+                                       __VA_ARGS__))
+
+
+static BuildProject* allocateProject(const char* pProjectFilename);
+static void parseProjectText(BuildProject* pThis, TextFile* pTextFile);
+__throws BuildProject* BuildProject_CreateFromFile(const char* pProjectFilename)
+{
+    SizedString   filename = SizedString_InitFromString(pProjectFilename);
+    BuildProject* pThis = NULL;
+    TextFile*     pTextFile = NULL;
+    
+    __try
+    {
+        pThis = allocateProject(pProjectFilename);
+        pTextFile = TextFile_CreateFromFile(NULL, &filename, NULL);
+        parseProjectText(pThis, pTextFile);
+    }
+    __catch
+    {
+        TextFile_Free(pTextFile);
+        BuildProject_Free(pThis);
+        __rethrow;
+    }
+    TextFile_Free(pTextFile);
+    
+    return pThis;
+}
+
+static BuildProject* allocateProject(const char* pProjectFilename)
+{
+    BuildProject* pThis = allocateAndZero(sizeof(*pThis));
+    pThis->pProjectFilename = pProjectFilename;
+    return pThis;
+}
+
+static int isLineBlankOrComment(const SizedString* pLine);
+static void parseProjectLine(BuildProject* pThis, ParseCSV* pParser, ParseCSV* pListParser, const SizedString* pLine);
+static void linkDependencies(BuildProject* pThis);
+static void parseProjectText(BuildProject* pThis, TextFile* pTextFile)
+{
+    ParseCSV* pParser = NULL;
+    ParseCSV* pListParser = NULL;
+    
+    __try
+    {
+        pParser = ParseCSV_Create();
+        pListParser = ParseCSV_CreateWithCustomSeparator(' ');
+        pThis->lineNumber = 1;
+        while (!TextFile_IsEndOfFile(pTextFile))
+        {
+            SizedString line = TextFile_GetNextLine(pTextFile);
+            if (!isLineBlankOrComment(&line))
+                parseProjectLine(pThis, pParser, pListParser, &line);
+            pThis->lineNumber++;
+        }
+        if (pThis->errorCount == 0)
+            linkDependencies(pThis);
+    }
+    __catch
+    {
+        ParseCSV_Free(pListParser);
+        ParseCSV_Free(pParser);
+        __rethrow;
+    }
+    ParseCSV_Free(pListParser);
+    ParseCSV_Free(pParser);
+    
+    if (pThis->errorCount > 0)
+        __throw(invalidArgumentException);
+}
+
+static int isLineBlankOrComment(const SizedString* pLine)
+{
+    return pLine->stringLength == 0 || pLine->pString[0] == '#';
+}
+
+static void parseAssembleLine(BuildProject*      pThis, 
+                              ParseCSV*          pListParser, 
+                              size_t             fieldCount, 
+                              const SizedString* pFields);
+static void parseImageLine(BuildProject* pThis, ParseCSV* pParser, size_t fieldCount, const SizedString* pFields);
+static void parseProjectLine(BuildProject* pThis, ParseCSV* pParser, ParseCSV* pListParser, const SizedString* pLine)
+{
+    size_t             fieldCount;
+    const SizedString* pFields;
+    
+    ParseCSV_Parse(pParser, pLine);
+    fieldCount = ParseCSV_FieldCount(pParser);
+    pFields = ParseCSV_FieldPointers(pParser);
+    if (0 == SizedString_strcasecmp(&pFields[0], "assemble"))
+        parseAssembleLine(pThis, pListParser, fieldCount, pFields);
+    else if (0 == SizedString_strcasecmp(&pFields[0], "image"))
+        parseImageLine(pThis, pParser, fieldCount, pFields);
+    else
+        LOG_ERROR(pThis, "%.*s is not a recognized project line type.", 
+                  (int)pFields[0].stringLength, pFields[0].pString);
+}
+
+static BuildProjectNode* allocateNode(BuildProject* pThis, BuildNodeType type);
+static void addInput(BuildProjectNode* pNode, const SizedString* pFilename);
+static void addOutput(BuildProjectNode* pNode, const SizedString* pFilename);
+static void addFilenameList(BuildProjectNode* pNode, 
+                            ParseCSV*          pListParser, 
+                            const SizedString* pList, 
+                            void (*addFilename)(BuildProjectNode*, const SizedString*));
+static void parseAssembleLine(BuildProject*      pThis, 
+                              ParseCSV*          pListParser, 
+                              size_t             fieldCount, 
+                              const SizedString* pFields)
+{
+    BuildProjectNode* pNode;
+    
+    if (fieldCount < 3 || fieldCount > 4)
+    {
+        LOG_ERROR(pThis, "%s lines need 3 or 4 fields.", "ASSEMBLE");
+        return;
+    }
+    
+    pNode = allocateNode(pThis, BUILD_NODE_ASSEMBLE);
+    addInput(pNode, &pFields[1]);
+    pNode->node.pName = pNode->node.ppInputs[0];
+    addFilenameList(pNode, pListParser, &pFields[2], addOutput);
+    if (fieldCount > 3)
+        addFilenameList(pNode, pListParser, &pFields[3], addInput);
+    if (pNode->node.outputCount == 0)
+        LOG_ERROR(pThis, "%s doesn't list any outputs.", pNode->node.pName);
+}
+
+static BuildProjectNode* allocateNode(BuildProject* pThis, BuildNodeType type)
+{
+    BuildProjectNode* pNode;
+    
+    if (pThis->nodeCount >= pThis->allocatedNodeCount)
+    {
+        size_t            newCount = pThis->allocatedNodeCount ? pThis->allocatedNodeCount * 2 : 16;
+        BuildProjectNode* pRealloc = realloc(pThis->pNodes, newCount * sizeof(*pRealloc));
+        
+        if (!pRealloc)
+            __throw(outOfMemoryException);
+        pThis->pNodes = pRealloc;
+        pThis->allocatedNodeCount = newCount;
+    }
+    
+    pNode = &pThis->pNodes[pThis->nodeCount++];
+    memset(pNode, 0, sizeof(*pNode));
+    pNode->node.type = type;
+    pNode->lineNumber = pThis->lineNumber;
+    
+    return pNode;
+}
+
+static void appendUniqueString(const char*** pppStrings, 
+                               size_t*       pCount, 
+                               size_t*       pAllocatedCount, 
+                               const SizedString* pString);
+static void addInput(BuildProjectNode* pNode, const SizedString* pFilename)
+{
+    appendUniqueString(&pNode->node.ppInputs, &pNode->node.inputCount, &pNode->allocatedInputCount, pFilename);
+}
+
+static void addOutput(BuildProjectNode* pNode, const SizedString* pFilename)
+{
+    appendUniqueString(&pNode->node.ppOutputs, &pNode->node.outputCount, &pNode->allocatedOutputCount, pFilename);
+}
+
+static void appendUniqueString(const char*** pppStrings, 
+                               size_t*       pCount, 
+                               size_t*       pAllocatedCount, 
+                               const SizedString* pString)
+{
+    size_t i;
+    
+    for (i = 0 ; i < *pCount ; i++)
+    {
+        if (0 == SizedString_strcmp(pString, (*pppStrings)[i]))
+            return;
+    }
+    if (*pCount >= *pAllocatedCount)
+    {
+        size_t       newCount = *pAllocatedCount ? *pAllocatedCount * 2 : 4;
+        const char** ppRealloc = realloc(*pppStrings, newCount * sizeof(*ppRealloc));
+        
+        if (!ppRealloc)
+            __throw(outOfMemoryException);
+        *pppStrings = ppRealloc;
+        *pAllocatedCount = newCount;
+    }
+    (*pppStrings)[*pCount] = SizedString_strdup(pString);
+    (*pCount)++;
+}
+
+static void addFilenameList(BuildProjectNode* pNode, 
+                            ParseCSV*          pListParser, 
+                            const SizedString* pList, 
+                            void (*addFilename)(BuildProjectNode*, const SizedString*))
+{
+    const SizedString* pFilenames;
+    size_t             count;
+    size_t             i;
+    
+    ParseCSV_Parse(pListParser, pList);
+    count = ParseCSV_FieldCount(pListParser);
+    pFilenames = ParseCSV_FieldPointers(pListParser);
+    for (i = 0 ; i < count ; i++)
+    {
+        if (pFilenames[i].stringLength > 0)
+            addFilename(pNode, &pFilenames[i]);
+    }
+}
+
+static void addScriptObjectFilesAsInputs(BuildProject* pThis, BuildProjectNode* pNode, ParseCSV* pParser);
+static void parseImageLine(BuildProject* pThis, ParseCSV* pParser, size_t fieldCount, const SizedString* pFields)
+{
+    BuildProjectNode* pNode;
+    
+    if (fieldCount != 4)
+    {
+        LOG_ERROR(pThis, "%s lines need 4 fields.", "IMAGE");
+        return;
+    }
+    
+    pNode = allocateNode(pThis, BUILD_NODE_IMAGE);
+    pNode->node.pImageFormat = SizedString_strdup(&pFields[1]);
+    addInput(pNode, &pFields[2]);
+    pNode->node.pScriptFilename = pNode->node.ppInputs[0];
+    addOutput(pNode, &pFields[3]);
+    pNode->node.pName = pNode->node.ppOutputs[0];
+    addScriptObjectFilesAsInputs(pThis, pNode, pParser);
+}
+
+static void addScriptObjectFilesAsInputs(BuildProject* pThis, BuildProjectNode* pNode, ParseCSV* pParser)
+{
+    SizedString scriptFilename = SizedString_InitFromString(pNode->node.pScriptFilename);
+    TextFile*   pTextFile = NULL;
+    
+    /* The parser is shared with the project file whose fields have already been used by this point. */
+    __try
+    {
+        pTextFile = TextFile_CreateFromFile(NULL, &scriptFilename, NULL);
+    }
+    __catch
+    {
+        if (getExceptionCode() != fileOpenException)
+            __rethrow;
+        LOG_ERROR(pThis, "Failed to open %s for parsing.", pNode->node.pScriptFilename);
+        __nothrow;
+    }
+    
+    __try
+    {
+        while (!TextFile_IsEndOfFile(pTextFile))
+        {
+            SizedString        line = TextFile_GetNextLine(pTextFile);
+            const SizedString* pFields;
+            
+            if (isLineBlankOrComment(&line))
+                continue;
+            ParseCSV_Parse(pParser, &line);
+            pFields = ParseCSV_FieldPointers(pParser);
+            if (ParseCSV_FieldCount(pParser) >= 2 && 0 != SizedString_strcasecmp(&pFields[0], "rwts16cp"))
+                addInput(pNode, &pFields[1]);
+        }
+    }
+    __catch
+    {
+        TextFile_Free(pTextFile);
+        __rethrow;
+    }
+    TextFile_Free(pTextFile);
+}
+
+static void checkForDuplicateOutputs(BuildProject* pThis, size_t nodeIndex);
+static size_t findNodeWithOutput(BuildProject* pThis, const char* pFilename);
+static void addDependency(BuildProjectNode* pNode, size_t dependency);
+static void checkForCycle(BuildProject* pThis, size_t nodeIndex);
+static void linkDependencies(BuildProject* pThis)
+{
+    size_t i;
+    size_t j;
+    
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+        checkForDuplicateOutputs(pThis, i);
+    if (pThis->errorCount > 0)
+        return;
+    
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+    {
+        BuildProjectNode* pNode = &pThis->pNodes[i];
+        
+        for (j = 0 ; j < pNode->node.inputCount ; j++)
+        {
+            size_t producer = findNodeWithOutput(pThis, pNode->node.ppInputs[j]);
+            if (producer != NO_NODE)
+                addDependency(pNode, producer);
+        }
+    }
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+        checkForCycle(pThis, i);
+}
+
+static void checkForDuplicateOutputs(BuildProject* pThis, size_t nodeIndex)
+{
+    BuildProjectNode* pNode = &pThis->pNodes[nodeIndex];
+    size_t            i;
+    
+    for (i = 0 ; i < pNode->node.outputCount ; i++)
+    {
+        size_t producer = findNodeWithOutput(pThis, pNode->node.ppOutputs[i]);
+        if (producer != nodeIndex)
+        {
+            pThis->lineNumber = pNode->lineNumber;
+            LOG_ERROR(pThis, "%s is also an output of line %u.", pNode->node.ppOutputs[i], 
+                      pThis->pNodes[producer].lineNumber);
+        }
+    }
+}
+
+static size_t findNodeWithOutput(BuildProject* pThis, const char* pFilename)
+{
+    size_t i;
+    size_t j;
+    
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+    {
+        BuildNode* pNode = &pThis->pNodes[i].node;
+        
+        for (j = 0 ; j < pNode->outputCount ; j++)
+        {
+            if (0 == strcmp(pNode->ppOutputs[j], pFilename))
+                return i;
+        }
+    }
+    return NO_NODE;
+}
+
+static void addDependency(BuildProjectNode* pNode, size_t dependency)
+{
+    size_t* pRealloc;
+    size_t  i;
+    
+    for (i = 0 ; i < pNode->dependencyCount ; i++)
+    {
+        if (pNode->pDependencies[i] == dependency)
+            return;
+    }
+    pRealloc = realloc(pNode->pDependencies, (pNode->dependencyCount + 1) * sizeof(*pRealloc));
+    if (!pRealloc)
+        __throw(outOfMemoryException);
+    pNode->pDependencies = pRealloc;
+    pNode->pDependencies[pNode->dependencyCount++] = dependency;
+}
+
+enum { NOT_VISITED = 0, VISITING, VISITED };
+
+static int visitDependencies(BuildProject* pThis, size_t nodeIndex);
+static void checkForCycle(BuildProject* pThis, size_t nodeIndex)
+{
+    BuildProjectNode* pNode = &pThis->pNodes[nodeIndex];
+    
+    if (pNode->visitState != NOT_VISITED)
+        return;
+    if (!visitDependencies(pThis, nodeIndex))
+    {
+        pThis->lineNumber = pNode->lineNumber;
+        LOG_ERROR(pThis, "%s depends on its own outputs.", pNode->node.pName);
+    }
+}
+
+static int visitDependencies(BuildProject* pThis, size_t nodeIndex)
+{
+    BuildProjectNode* pNode = &pThis->pNodes[nodeIndex];
+    size_t            i;
+    
+    if (pNode->visitState == VISITING)
+        return 0;
+    if (pNode->visitState == VISITED)
+        return 1;
+    
+    pNode->visitState = VISITING;
+    for (i = 0 ; i < pNode->dependencyCount ; i++)
+    {
+        if (!visitDependencies(pThis, pNode->pDependencies[i]))
+            return 0;
+    }
+    pNode->visitState = VISITED;
+    
+    return 1;
+}
+
+
+__throws BuildProject* BuildProject_CreateFromString(const char* pProjectText)
+{
+    BuildProject* pThis = NULL;
+    TextFile*     pTextFile = NULL;
+    
+    __try
+    {
+        pThis = allocateProject("project");
+        pTextFile = TextFile_CreateFromString(pProjectText);
+        parseProjectText(pThis, pTextFile);
+    }
+    __catch
+    {
+        TextFile_Free(pTextFile);
+        BuildProject_Free(pThis);
+        __rethrow;
+    }
+    TextFile_Free(pTextFile);
+    
+    return pThis;
+}
+
+
+static void freeNode(BuildProjectNode* pNode);
+static void freeStateEntries(BuildProject* pThis);
+void BuildProject_Free(BuildProject* pThis)
+{
+    size_t i;
+    
+    if (!pThis)
+        return;
+    
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+        freeNode(&pThis->pNodes[i]);
+    free(pThis->pNodes);
+    freeStateEntries(pThis);
+    free(pThis);
+}
+
+static void freeNode(BuildProjectNode* pNode)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pNode->node.inputCount ; i++)
+        free((char*)pNode->node.ppInputs[i]);
+    for (i = 0 ; i < pNode->node.outputCount ; i++)
+        free((char*)pNode->node.ppOutputs[i]);
+    free(pNode->node.ppInputs);
+    free(pNode->node.ppOutputs);
+    free((char*)pNode->node.pImageFormat);
+    free(pNode->pDependencies);
+}
+
+static void freeStateEntries(BuildProject* pThis)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pThis->stateEntryCount ; i++)
+        free(pThis->pStateEntries[i].pName);
+    free(pThis->pStateEntries);
+    pThis->pStateEntries = NULL;
+    pThis->stateEntryCount = 0;
+    pThis->allocatedStateEntryCount = 0;
+}
+
+
+size_t BuildProject_GetNodeCount(BuildProject* pThis)
+{
+    return pThis->nodeCount;
+}
+
+
+BuildNode* BuildProject_GetNode(BuildProject* pThis, size_t index)
+{
+    if (index >= pThis->nodeCount)
+        return NULL;
+    return &pThis->pNodes[index].node;
+}
+
+
+static void resetNodes(BuildProject* pThis);
+static void loadState(BuildProject* pThis, const char* pStateFilename);
+static void startReadyNodes(BuildProject* pThis, BuildRunner* pRunner, unsigned int maxJobs);
+static void waitForNextNode(BuildProject* pThis, BuildRunner* pRunner);
+static void saveState(BuildProject* pThis, const char* pStateFilename);
+__throws unsigned int BuildProject_Run(BuildProject* pThis, 
+                                       BuildRunner*  pRunner, 
+                                       unsigned int  maxJobs, 
+                                       const char*   pStateFilename)
+{
+    if (maxJobs == 0)
+        maxJobs = 1;
+    resetNodes(pThis);
+    if (pStateFilename)
+        loadState(pThis, pStateFilename);
+    
+    for (;;)
+    {
+        startReadyNodes(pThis, pRunner, maxJobs);
+        if (pThis->runningCount == 0)
+            break;
+        waitForNextNode(pThis, pRunner);
+    }
+    
+    if (pStateFilename)
+        saveState(pThis, pStateFilename);
+    return pThis->failedCount;
+}
+
+static void resetNodes(BuildProject* pThis)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+    {
+        BuildProjectNode* pNode = &pThis->pNodes[i];
+        
+        pNode->node.status = BUILD_NODE_PENDING;
+        pNode->node.milliseconds = 0;
+        pNode->criticalPathCalculated = 0;
+    }
+    pThis->runningCount = 0;
+    pThis->failedCount = 0;
+}
+
+static void parseStateText(BuildProject* pThis, TextFile* pTextFile, ParseCSV* pParser);
+static void loadState(BuildProject* pThis, const char* pStateFilename)
+{
+    SizedString filename = SizedString_InitFromString(pStateFilename);
+    TextFile*   pTextFile = NULL;
+    ParseCSV*   pParser = NULL;
+    
+    /* The state is only a cache so a missing or corrupt file just means that every node is run. */
+    freeStateEntries(pThis);
+    __try
+    {
+        pTextFile = TextFile_CreateFromFile(NULL, &filename, NULL);
+        pParser = ParseCSV_Create();
+        parseStateText(pThis, pTextFile, pParser);
+    }
+    __catch
+    {
+        freeStateEntries(pThis);
+        clearExceptionCode();
+    }
+    ParseCSV_Free(pParser);
+    TextFile_Free(pTextFile);
+}
+
+static uint64_t parseHex64(const SizedString* pField);
+static void appendStateEntry(BuildProject* pThis, char* pName, uint64_t inputHash, uint64_t outputHash);
+static void parseStateText(BuildProject* pThis, TextFile* pTextFile, ParseCSV* pParser)
+{
+    SizedString header = TextFile_GetNextLine(pTextFile);
+    
+    if (0 != SizedString_strcmp(&header, STATE_HEADER))
+        __throw(fileException);
+    while (!TextFile_IsEndOfFile(pTextFile))
+    {
+        SizedString        line = TextFile_GetNextLine(pTextFile);
+        const SizedString* pFields;
+        char*              pName;
+        
+        ParseCSV_Parse(pParser, &line);
+        if (ParseCSV_FieldCount(pParser) != 3)
+            __throw(fileException);
+        pFields = ParseCSV_FieldPointers(pParser);
+        pName = SizedString_strdup(&pFields[0]);
+        __try
+        {
+            appendStateEntry(pThis, pName, parseHex64(&pFields[1]), parseHex64(&pFields[2]));
+        }
+        __catch
+        {
+            free(pName);
+            __rethrow;
+        }
+    }
+}
+
+static uint64_t parseHex64(const SizedString* pField)
+{
+    const char* pCurr;
+    uint64_t    value = 0;
+    
+    if (SizedString_strlen(pField) != 16)
+        __throw(fileException);
+    
+    SizedString_EnumStart(pField, &pCurr);
+    while (SizedString_EnumRemaining(pField, pCurr))
+    {
+        char digit = SizedString_EnumNext(pField, &pCurr);
+        
+        value <<= 4;
+        if (digit >= '0' && digit <= '9')
+            value |= digit - '0';
+        else if (digit >= 'a' && digit <= 'f')
+            value |= digit - 'a' + 10;
+        else if (digit >= 'A' && digit <= 'F')
+            value |= digit - 'A' + 10;
+        else
+            __throw(fileException);
+    }
+    
+    return value;
+}
+
+static void appendStateEntry(BuildProject* pThis, char* pName, uint64_t inputHash, uint64_t outputHash)
+{
+    BuildStateEntry* pEntry;
+    
+    if (pThis->stateEntryCount >= pThis->allocatedStateEntryCount)
+    {
+        size_t           newCount = pThis->allocatedStateEntryCount ? pThis->allocatedStateEntryCount * 2 : 16;
+        BuildStateEntry* pRealloc = realloc(pThis->pStateEntries, newCount * sizeof(*pRealloc));
+        
+        if (!pRealloc)
+            __throw(outOfMemoryException);
+        pThis->pStateEntries = pRealloc;
+        pThis->allocatedStateEntryCount = newCount;
+    }
+    pEntry = &pThis->pStateEntries[pThis->stateEntryCount++];
+    pEntry->pName = pName;
+    pEntry->inputHash = inputHash;
+    pEntry->outputHash = outputHash;
+}
+
+static int runNodeIfReady(BuildProject* pThis, BuildRunner* pRunner, BuildProjectNode* pNode);
+static void startReadyNodes(BuildProject* pThis, BuildRunner* pRunner, unsigned int maxJobs)
+{
+    size_t i = 0;
+    
+    while (i < pThis->nodeCount && pThis->runningCount < maxJobs)
+    {
+        BuildProjectNode* pNode = &pThis->pNodes[i];
+        
+        /* A node which finishes without being run can make nodes earlier in the project ready as well. */
+        if (pNode->node.status == BUILD_NODE_PENDING && runNodeIfReady(pThis, pRunner, pNode))
+            i = 0;
+        else
+            i++;
+    }
+}
+
+static int isFinished(const BuildProjectNode* pNode);
+static uint64_t hashInputs(const BuildNode* pNode);
+static int isUpToDate(BuildProject* pThis, BuildProjectNode* pNode);
+static int runNodeIfReady(BuildProject* pThis, BuildRunner* pRunner, BuildProjectNode* pNode)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pNode->dependencyCount ; i++)
+    {
+        BuildProjectNode* pDependency = &pThis->pNodes[pNode->pDependencies[i]];
+        
+        if (pDependency->node.status == BUILD_NODE_FAILED || pDependency->node.status == BUILD_NODE_BLOCKED)
+        {
+            pNode->node.status = BUILD_NODE_BLOCKED;
+            printf("Skipped %s because %s wasn't built." LINE_ENDING, pNode->node.pName, pDependency->node.pName);
+            return 1;
+        }
+        if (!isFinished(pDependency))
+            return 0;
+    }
+    
+    pNode->inputHash = hashInputs(&pNode->node);
+    if (isUpToDate(pThis, pNode))
+    {
+        pNode->node.status = BUILD_NODE_UP_TO_DATE;
+        printf("%s is up to date." LINE_ENDING, pNode->node.pName);
+        return 1;
+    }
+    
+    pNode->node.status = BUILD_NODE_RUNNING;
+    pThis->runningCount++;
+    pRunner->startNode(pRunner->pContext, &pNode->node);
+    return 0;
+}
+
+static int isFinished(const BuildProjectNode* pNode)
+{
+    return pNode->node.status == BUILD_NODE_BUILT || pNode->node.status == BUILD_NODE_UP_TO_DATE;
+}
+
+static uint64_t hashFile(const char* pFilename, uint64_t hash, int* pExists);
+static uint64_t hashInputs(const BuildNode* pNode)
+{
+    /* The declared outputs and image format are part of the command being run so they are hashed as well. */
+    uint64_t hash = pNode->type;
+    size_t   i;
+    int      exists;
+    
+    if (pNode->pImageFormat)
+        hash = Hash64_Buffer(pNode->pImageFormat, strlen(pNode->pImageFormat), hash);
+    for (i = 0 ; i < pNode->outputCount ; i++)
+        hash = Hash64_Buffer(pNode->ppOutputs[i], strlen(pNode->ppOutputs[i]), hash);
+    for (i = 0 ; i < pNode->inputCount ; i++)
+        hash = hashFile(pNode->ppInputs[i], hash, &exists);
+    
+    return hash;
+}
+
+static uint64_t hashFile(const char* pFilename, uint64_t hash, int* pExists)
+{
+    unsigned char buffer[4096];
+    FILE*         pFile;
+    size_t        bytesRead;
+    
+    hash = Hash64_Buffer(pFilename, strlen(pFilename), hash);
+    pFile = fopen(pFilename, "rb");
+    *pExists = pFile != NULL;
+    if (!pFile)
+        return ~hash;
+    while ((bytesRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+        hash = Hash64_Buffer(buffer, bytesRead, hash);
+    fclose(pFile);
+    
+    return hash;
+}
+
+static const BuildStateEntry* findStateEntry(BuildProject* pThis, const char* pName);
+static const char* hashOutputs(BuildProjectNode* pNode);
+static int isUpToDate(BuildProject* pThis, BuildProjectNode* pNode)
+{
+    const BuildStateEntry* pEntry = findStateEntry(pThis, pNode->node.pName);
+    
+    if (!pEntry || pEntry->inputHash != pNode->inputHash)
+        return 0;
+    if (hashOutputs(pNode) != NULL)
+        return 0;
+    return pEntry->outputHash == pNode->outputHash;
+}
+
+static const BuildStateEntry* findStateEntry(BuildProject* pThis, const char* pName)
+{
+    size_t i;
+    
+    for (i = 0 ; i < pThis->stateEntryCount ; i++)
+    {
+        if (0 == strcmp(pThis->pStateEntries[i].pName, pName))
+            return &pThis->pStateEntries[i];
+    }
+    return NULL;
+}
+
+static const char* hashOutputs(BuildProjectNode* pNode)
+{
+    uint64_t hash = 0;
+    size_t   i;
+    int      exists;
+    
+    for (i = 0 ; i < pNode->node.outputCount ; i++)
+    {
+        hash = hashFile(pNode->node.ppOutputs[i], hash, &exists);
+        if (!exists)
+            return pNode->node.ppOutputs[i];
+    }
+    pNode->outputHash = hash;
+    
+    return NULL;
+}
+
+static void waitForNextNode(BuildProject* pThis, BuildRunner* pRunner)
+{
+    BuildProjectNode* pNode;
+    const char*       pMissingOutput = NULL;
+    unsigned int      milliseconds = 0;
+    int               succeeded = 0;
+    
+    pNode = (BuildProjectNode*)pRunner->waitForNode(pRunner->pContext, &succeeded, &milliseconds);
+    pThis->runningCount--;
+    pNode->node.milliseconds = milliseconds;
+    if (succeeded)
+        pMissingOutput = hashOutputs(pNode);
+    
+    if (!succeeded || pMissingOutput)
+    {
+        pNode->node.status = BUILD_NODE_FAILED;
+        pThis->failedCount++;
+        if (pMissingOutput)
+            fprintf(stderr, "%s: error: Didn't write %s." LINE_ENDING, pNode->node.pName, pMissingOutput);
+        else
+            fprintf(stderr, "%s: error: Failed after %u ms." LINE_ENDING, pNode->node.pName, milliseconds);
+        return;
+    }
+    
+    pNode->node.status = BUILD_NODE_BUILT;
+    printf("%s %s in %u ms." LINE_ENDING, 
+           pNode->node.type == BUILD_NODE_ASSEMBLE ? "Assembled" : "Built", pNode->node.pName, milliseconds);
+}
+
+static void writeState(BuildProject* pThis, FILE* pFile);
+static void saveState(BuildProject* pThis, const char* pStateFilename)
+{
+    FILE* pFile = NULL;
+    
+    /* The state is only a cache so failing to write it shouldn't fail the build. */
+    __try
+    {
+        pFile = fopen(pStateFilename, "w");
+        if (!pFile)
+            __throw(fileOpenException);
+        writeState(pThis, pFile);
+    }
+    __catch
+    {
+        if (pFile)
+            fclose(pFile);
+        remove(pStateFilename);
+        __nothrow;
+    }
+    fclose(pFile);
+}
+
+static void writeStateLine(FILE* pFile, const char* pName, uint64_t inputHash, uint64_t outputHash);
+static void writeString(FILE* pFile, const char* pString);
+static void writeState(BuildProject* pThis, FILE* pFile)
+{
+    size_t i;
+    
+    writeString(pFile, STATE_HEADER "\n");
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+    {
+        BuildProjectNode*      pNode = &pThis->pNodes[i];
+        const BuildStateEntry* pEntry = findStateEntry(pThis, pNode->node.pName);
+        
+        /* Failed nodes are dropped so that they always run again but nodes which never got to run keep their old 
+           hashes. */
+        if (isFinished(pNode))
+            writeStateLine(pFile, pNode->node.pName, pNode->inputHash, pNode->outputHash);
+        else if (pNode->node.status != BUILD_NODE_FAILED && pEntry)
+            writeStateLine(pFile, pEntry->pName, pEntry->inputHash, pEntry->outputHash);
+    }
+}
+
+static void writeStateLine(FILE* pFile, const char* pName, uint64_t inputHash, uint64_t outputHash)
+{
+    char hashes[1 + 16 + 1 + 16 + 1 + 1];
+    
+    snprintf(hashes, sizeof(hashes), ",%016llx,%016llx\n", 
+             (unsigned long long)inputHash, (unsigned long long)outputHash);
+    writeString(pFile, pName);
+    writeString(pFile, hashes);
+}
+
+static void writeString(FILE* pFile, const char* pString)
+{
+    size_t length = strlen(pString);
+    
+    if (length != fwrite(pString, 1, length, pFile))
+        __throw(fileException);
+}
+
+
+static unsigned int calculateCriticalPath(BuildProject* pThis, size_t nodeIndex);
+static void printCriticalPathTo(BuildProject* pThis, size_t nodeIndex);
+void BuildProject_PrintCriticalPath(BuildProject* pThis)
+{
+    unsigned int longest = 0;
+    size_t       last = NO_NODE;
+    size_t       i;
+    
+    for (i = 0 ; i < pThis->nodeCount ; i++)
+    {
+        unsigned int milliseconds;
+        
+        /* The path can pass through up to date steps but it has to end at one which was run this time. */
+        if (pThis->pNodes[i].node.status != BUILD_NODE_BUILT)
+            continue;
+        milliseconds = calculateCriticalPath(pThis, i);
+        if (last == NO_NODE || milliseconds > longest)
+        {
+            longest = milliseconds;
+            last = i;
+        }
+    }
+    if (last == NO_NODE)
+        return;
+    
+    printf("Critical path of %u ms:" LINE_ENDING, longest);
+    printCriticalPathTo(pThis, last);
+}
+
+static unsigned int calculateCriticalPath(BuildProject* pThis, size_t nodeIndex)
+{
+    BuildProjectNode* pNode = &pThis->pNodes[nodeIndex];
+    unsigned int      longest = 0;
+    size_t            i;
+    
+    if (pNode->criticalPathCalculated)
+        return pNode->criticalMilliseconds;
+    
+    /* Only called for finished nodes so every dependency has finished as well. */
+    pNode->criticalPredecessor = NO_NODE;
+    for (i = 0 ; i < pNode->dependencyCount ; i++)
+    {
+        unsigned int milliseconds = calculateCriticalPath(pThis, pNode->pDependencies[i]);
+        
+        if (pNode->criticalPredecessor == NO_NODE || milliseconds > longest)
+        {
+            longest = milliseconds;
+            pNode->criticalPredecessor = pNode->pDependencies[i];
+        }
+    }
+    pNode->criticalMilliseconds = longest + pNode->node.milliseconds;
+    pNode->criticalPathCalculated = 1;
+    
+    return pNode->criticalMilliseconds;
+}
+
+static void printCriticalPathTo(BuildProject* pThis, size_t nodeIndex)
+{
+    BuildProjectNode* pNode = &pThis->pNodes[nodeIndex];
+    
+    if (pNode->criticalPredecessor != NO_NODE)
+        printCriticalPathTo(pThis, pNode->criticalPredecessor);
+    printf("  %s %u ms" LINE_ENDING, pNode->node.pName, pNode->node.milliseconds);
+}
@@ -0,0 +1,159 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "SnapBuildCommandLine.h"
+#include "SnapBuildCommandLineTest.h"
+#include "util.h"
+#include "version.h"
+
+static void displayCopyrightNotice(void)
+{
+    printf("snapbuild - Project Build Tool for snap and crackle (" VERSION_STRING ")\n\n"
+           COPYRIGHT_NOTICE
+           "\n");
+}
+
+static void displayUsage(void)
+{
+    printf("Usage: snapbuild [--jobs count] [--snap snapPath] [--crackle cracklePath]\n"
+           "                 projectFilename\n\n"
+           "Where: --jobs count sets how many assemblies and images can be built at\n"
+           "         the same time.  Defaults to the number of processors.\n"
+           "       --snap and --crackle set the path of the tools to be run.  By\n"
+           "         default they are searched for in the PATH.\n"
+           "       projectFilename is the required name of the project file.  Each\n"
+           "         line should meet one of these formats:\n"
+           "           ASSEMBLE,sourceFilename,outputFilenames[,inputFilenames]\n"
+           "           IMAGE,image_format,scriptFilename,imageFilename\n"
+           "         where the filename lists are separated by spaces.\n");
+}
+
+
+static int parseArgument(SnapBuildCommandLine* pThis, int argc, const char** ppArgs);
+static int hasDoubleDashPrefix(const char* pArgument);
+static int parseFlagArgument(SnapBuildCommandLine* pThis, int argc, const char** ppArgs);
+static void parseStringParameter(const char** ppDestField, int argc, const char* pSourceArgument);
+static void parseJobCount(SnapBuildCommandLine* pThis, int argc, const char* pJobCount);
+static int parseFilenameArgument(SnapBuildCommandLine* pThis, int argc, const char* pArgument);
+static void throwIfRequiredArgumentNotSpecified(SnapBuildCommandLine* pThis);
+
+
+__throws void SnapBuildCommandLine_Init(SnapBuildCommandLine* pThis, int argc, const char** argv)
+{
+    __try
+    {
+        memset(pThis, 0, sizeof(*pThis));
+        pThis->pSnapPath = "snap";
+        pThis->pCracklePath = "crackle";
+        while (argc)
+        {
+            int argumentsUsed = parseArgument(pThis, argc, argv);
+            argc -= argumentsUsed;
+            argv += argumentsUsed;
+        }
+        throwIfRequiredArgumentNotSpecified(pThis);
+    }
+    __catch
+    {
+        displayCopyrightNotice();
+        displayUsage();
+        __rethrow;
+    }
+}
+
+static int parseArgument(SnapBuildCommandLine* pThis, int argc, const char** ppArgs)
+{
+    if (hasDoubleDashPrefix(*ppArgs))
+        return parseFlagArgument(pThis, argc, ppArgs);
+    else
+        return parseFilenameArgument(pThis, argc, *ppArgs);
+}
+
+static int hasDoubleDashPrefix(const char* pArgument)
+{
+    return pArgument[0] == '-' && pArgument[1] == '-';
+}
+
+static int parseFlagArgument(SnapBuildCommandLine* pThis, int argc, const char** ppArgs)
+{
+    static struct
+    {
+        const char* pFlag;
+        int         destStringOffsetInThis;
+    } const flagArguments[] =
+    {
+        { "--snap",    offsetof(SnapBuildCommandLine, pSnapPath) },
+        { "--crackle", offsetof(SnapBuildCommandLine, pCracklePath) }
+    };
+    size_t i;
+    
+    if (0 == strcasecmp(*ppArgs, "--jobs"))
+    {
+        parseJobCount(pThis, argc - 1, ppArgs[1]);
+        return 2;
+    }
+    for (i = 0 ; i < ARRAYSIZE(flagArguments) ; i++)
+    {
+        if (0 == strcasecmp(*ppArgs, flagArguments[i].pFlag))
+        {
+            const char** ppDestField = (const char**)((char*)pThis + flagArguments[i].destStringOffsetInThis);
+            parseStringParameter(ppDestField, argc - 1, ppArgs[1]);
+            return 2;
+        }
+    }
+
+    __throw(invalidArgumentException);
+}
+
+static void parseStringParameter(const char** ppDestField, int argc, const char* pSourceArgument)
+{
+    if (argc < 1)
+        __throw(invalidArgumentException);
+
+    *ppDestField = pSourceArgument;
+}
+
+static void parseJobCount(SnapBuildCommandLine* pThis, int argc, const char* pJobCount)
+{
+    char*         pEnd = NULL;
+    unsigned long jobCount;
+    
+    if (argc < 1)
+        __throw(invalidArgumentException);
+    jobCount = strtoul(pJobCount, &pEnd, 0);
+    if (pEnd == pJobCount || *pEnd != '\0' || *pJobCount == '-' || jobCount == 0 || jobCount > 256)
+        __throw(invalidArgumentException);
+    pThis->maxJobs = (unsigned int)jobCount;
+}
+
+static int parseFilenameArgument(SnapBuildCommandLine* pThis, int argc, const char* pArgument)
+{
+    if (!pThis->pProjectFilename)
+    {
+        pThis->pProjectFilename = pArgument;
+        return 1;
+    }
+    else
+    {
+        __throw(invalidArgumentException);
+    }
+}
+
+static void throwIfRequiredArgumentNotSpecified(SnapBuildCommandLine* pThis)
+{
+    if (!pThis->pProjectFilename)
+        __throw(invalidArgumentException);
+}
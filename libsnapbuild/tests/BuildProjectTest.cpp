@@ -0,0 +1,456 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include <string.h>
+
+// Include headers from C modules under test.
+extern "C"
+{
+#include "BuildProject.h"
+#include "BuildProjectTest.h"
+#include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+static const char* g_stateFilename = "BuildProjectTest.state";
+static const char* g_scriptFilename = "BuildProjectTest.crackle";
+static const char* g_sourceFilenames[] = { "BuildProjectTest1.S", "BuildProjectTest2.S" };
+static const char* g_outputFilenames[] = { "BuildProjectTest1.sav", "BuildProjectTest2.sav", 
+                                           "BuildProjectTest2.usr", "BuildProjectTest.nib" };
+static const char  g_twoAssembliesAndImage[] = "# Two assemblies feeding an image.\n"
+                                               "ASSEMBLE,BuildProjectTest1.S,BuildProjectTest1.sav\n"
+                                               "\n"
+                                               "IMAGE,nib_5.25,BuildProjectTest.crackle,BuildProjectTest.nib\n"
+                                               "ASSEMBLE,BuildProjectTest2.S,"
+                                               "BuildProjectTest2.sav BuildProjectTest2.usr\n";
+static const char  g_script[] = "RWTS16,BuildProjectTest1.sav,0,*,0,0\n"
+                                "# Comment lines are skipped.\n"
+                                "RWTS16CP,1,0\n"
+                                "RW18,BuildProjectTest2.usr,0,*,0,2,0\n"
+                                "RWTS16,BuildProjectTest1.sav,0,*,3,0\n";
+
+
+struct FakeRunner
+{
+    BuildRunner  runner;
+    BuildNode*   started[16];
+    size_t       startedCount;
+    size_t       finishedCount;
+    unsigned int runningCount;
+    unsigned int maxRunningCount;
+    const char*  pNodeToFail;
+    const char*  pOutputToSkip;
+    const char*  pOutputContent;
+    int          isInstant;
+};
+
+static void writeFile(const char* pFilename, const char* pText)
+{
+    FILE* pFile = fopen(pFilename, "wb");
+    fwrite(pText, 1, strlen(pText), pFile);
+    fclose(pFile);
+}
+
+static void fakeStartNode(void* pContext, BuildNode* pNode)
+{
+    FakeRunner* pThis = (FakeRunner*)pContext;
+    
+    CHECK_TRUE(pThis->startedCount < ARRAYSIZE(pThis->started));
+    pThis->started[pThis->startedCount++] = pNode;
+    if (++pThis->runningCount > pThis->maxRunningCount)
+        pThis->maxRunningCount = pThis->runningCount;
+}
+
+static BuildNode* fakeWaitForNode(void* pContext, int* pSucceeded, unsigned int* pMilliseconds)
+{
+    FakeRunner* pThis = (FakeRunner*)pContext;
+    BuildNode*  pNode;
+    size_t      i;
+    
+    CHECK_TRUE(pThis->finishedCount < pThis->startedCount);
+    pNode = pThis->started[pThis->finishedCount++];
+    pThis->runningCount--;
+    
+    /* The second source is the slowest so that it is on the critical path. */
+    if (pThis->isInstant)
+        *pMilliseconds = 0;
+    else if (pNode->type == BUILD_NODE_IMAGE)
+        *pMilliseconds = 300;
+    else
+        *pMilliseconds = 0 == strcmp(pNode->pName, g_sourceFilenames[1]) ? 500 : 100;
+    
+    *pSucceeded = !pThis->pNodeToFail || 0 != strcmp(pThis->pNodeToFail, pNode->pName);
+    if (!*pSucceeded)
+        return pNode;
+    for (i = 0 ; i < pNode->outputCount ; i++)
+    {
+        if (!pThis->pOutputToSkip || 0 != strcmp(pThis->pOutputToSkip, pNode->ppOutputs[i]))
+            writeFile(pNode->ppOutputs[i], pThis->pOutputContent);
+    }
+    
+    return pNode;
+}
+
+
+TEST_GROUP(BuildProject)
+{
+    BuildProject* m_pProject;
+    FakeRunner    m_runner;
+    
+    void setup()
+    {
+        clearExceptionCode();
+        printfSpy_Hook(256);
+        m_pProject = NULL;
+        memset(&m_runner, 0, sizeof(m_runner));
+        m_runner.runner.startNode = fakeStartNode;
+        m_runner.runner.waitForNode = fakeWaitForNode;
+        m_runner.runner.pContext = &m_runner;
+        m_runner.pOutputContent = "v1";
+        writeFile(g_scriptFilename, g_script);
+        writeFile(g_sourceFilenames[0], " sav BuildProjectTest1.sav\n");
+        writeFile(g_sourceFilenames[1], " sav BuildProjectTest2.sav\n");
+    }
+
+    void teardown()
+    {
+        size_t i;
+        
+        LONGS_EQUAL(noException, getExceptionCode());
+        MallocFailureInject_Restore();
+        printfSpy_Unhook();
+        BuildProject_Free(m_pProject);
+        remove(g_stateFilename);
+        remove(g_scriptFilename);
+        for (i = 0 ; i < ARRAYSIZE(g_sourceFilenames) ; i++)
+            remove(g_sourceFilenames[i]);
+        for (i = 0 ; i < ARRAYSIZE(g_outputFilenames) ; i++)
+            remove(g_outputFilenames[i]);
+    }
+    
+    void validateExceptionThrown(int expectedExceptionCode)
+    {
+        LONGS_EQUAL(expectedExceptionCode, getExceptionCode());
+        clearExceptionCode();
+    }
+    
+    void validateParseError(const char* pProjectText, const char* pExpectedError)
+    {
+        __try_and_catch( m_pProject = BuildProject_CreateFromString(pProjectText) );
+        validateExceptionThrown(invalidArgumentException);
+        POINTERS_EQUAL(NULL, m_pProject);
+        STRCMP_EQUAL(pExpectedError, printfSpy_GetLastErrorOutput());
+    }
+    
+    unsigned int run(unsigned int maxJobs)
+    {
+        m_runner.startedCount = 0;
+        m_runner.finishedCount = 0;
+        m_runner.maxRunningCount = 0;
+        return BuildProject_Run(m_pProject, &m_runner.runner, maxJobs, g_stateFilename);
+    }
+    
+    void validateStarted(size_t index, const char* pName)
+    {
+        CHECK_TRUE(index < m_runner.startedCount);
+        STRCMP_EQUAL(pName, m_runner.started[index]->pName);
+    }
+    
+    BuildNodeStatus nodeStatus(size_t index)
+    {
+        return BuildProject_GetNode(m_pProject, index)->status;
+    }
+};
+
+
+TEST(BuildProject, ParseProjectIntoNodes)
+{
+    BuildNode* pNode;
+    
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(3, BuildProject_GetNodeCount(m_pProject));
+    POINTERS_EQUAL(NULL, BuildProject_GetNode(m_pProject, 3));
+    
+    pNode = BuildProject_GetNode(m_pProject, 0);
+    LONGS_EQUAL(BUILD_NODE_ASSEMBLE, pNode->type);
+    STRCMP_EQUAL("BuildProjectTest1.S", pNode->pName);
+    POINTERS_EQUAL(NULL, pNode->pImageFormat);
+    LONGS_EQUAL(1, pNode->inputCount);
+    STRCMP_EQUAL("BuildProjectTest1.S", pNode->ppInputs[0]);
+    LONGS_EQUAL(1, pNode->outputCount);
+    STRCMP_EQUAL("BuildProjectTest1.sav", pNode->ppOutputs[0]);
+    LONGS_EQUAL(BUILD_NODE_PENDING, pNode->status);
+    
+    pNode = BuildProject_GetNode(m_pProject, 1);
+    LONGS_EQUAL(BUILD_NODE_IMAGE, pNode->type);
+    STRCMP_EQUAL("BuildProjectTest.nib", pNode->pName);
+    STRCMP_EQUAL("nib_5.25", pNode->pImageFormat);
+    STRCMP_EQUAL("BuildProjectTest.crackle", pNode->pScriptFilename);
+    LONGS_EQUAL(3, pNode->inputCount);
+    STRCMP_EQUAL("BuildProjectTest.crackle", pNode->ppInputs[0]);
+    STRCMP_EQUAL("BuildProjectTest1.sav", pNode->ppInputs[1]);
+    STRCMP_EQUAL("BuildProjectTest2.usr", pNode->ppInputs[2]);
+    LONGS_EQUAL(1, pNode->outputCount);
+    STRCMP_EQUAL("BuildProjectTest.nib", pNode->ppOutputs[0]);
+    
+    pNode = BuildProject_GetNode(m_pProject, 2);
+    LONGS_EQUAL(2, pNode->outputCount);
+    STRCMP_EQUAL("BuildProjectTest2.sav", pNode->ppOutputs[0]);
+    STRCMP_EQUAL("BuildProjectTest2.usr", pNode->ppOutputs[1]);
+}
+
+TEST(BuildProject, ParseAssembleLineWithExtraInputs)
+{
+    BuildNode* pNode;
+    
+    m_pProject = BuildProject_CreateFromString("assemble,game.S,game  gameusr,macros.S  tables.S\n");
+    pNode = BuildProject_GetNode(m_pProject, 0);
+    LONGS_EQUAL(2, pNode->outputCount);
+    STRCMP_EQUAL("gameusr", pNode->ppOutputs[1]);
+    LONGS_EQUAL(3, pNode->inputCount);
+    STRCMP_EQUAL("game.S", pNode->ppInputs[0]);
+    STRCMP_EQUAL("macros.S", pNode->ppInputs[1]);
+    STRCMP_EQUAL("tables.S", pNode->ppInputs[2]);
+}
+
+TEST(BuildProject, FailOnUnknownLineType)
+{
+    validateParseError("ASSEMBLE,game.S,game\nLINK,game\n", 
+                       "project:2: error: LINK is not a recognized project line type." LINE_ENDING);
+}
+
+TEST(BuildProject, FailOnWrongFieldCounts)
+{
+    validateParseError("ASSEMBLE,game.S\n", "project:1: error: ASSEMBLE lines need 3 or 4 fields." LINE_ENDING);
+    validateParseError("IMAGE,nib_5.25,BuildProjectTest.crackle\n", 
+                       "project:1: error: IMAGE lines need 4 fields." LINE_ENDING);
+}
+
+TEST(BuildProject, FailOnAssembleWithoutOutputs)
+{
+    validateParseError("ASSEMBLE,game.S, \n", "project:1: error: game.S doesn't list any outputs." LINE_ENDING);
+}
+
+TEST(BuildProject, FailOnMissingScript)
+{
+    validateParseError("IMAGE,nib_5.25,BuildProjectTestMissing.crackle,pop.nib\n", 
+                       "project:1: error: Failed to open BuildProjectTestMissing.crackle for parsing." LINE_ENDING);
+}
+
+TEST(BuildProject, FailOnOutputOfTwoNodes)
+{
+    validateParseError("ASSEMBLE,game.S,game\nASSEMBLE,game2.S,game\n", 
+                       "project:2: error: game is also an output of line 1." LINE_ENDING);
+}
+
+TEST(BuildProject, FailOnDependencyCycle)
+{
+    validateParseError("ASSEMBLE,a.S,a.out,b.out\nASSEMBLE,b.S,b.out,a.out\n", 
+                       "project:1: error: a.S depends on its own outputs." LINE_ENDING);
+}
+
+TEST(BuildProject, FailAllocationsInCreate)
+{
+    unsigned int i;
+    
+    for (i = 1 ; ; i++)
+    {
+        MallocFailureInject_FailAllocation(i);
+        __try_and_catch( m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage) );
+        if (getExceptionCode() == noException)
+            break;
+        validateExceptionThrown(outOfMemoryException);
+        POINTERS_EQUAL(NULL, m_pProject);
+    }
+    MallocFailureInject_Restore();
+    CHECK_TRUE(i > 10);
+    LONGS_EQUAL(3, BuildProject_GetNodeCount(m_pProject));
+}
+
+TEST(BuildProject, RunAssembliesConcurrentlyBeforeImage)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(3, m_runner.startedCount);
+    validateStarted(0, "BuildProjectTest1.S");
+    validateStarted(1, "BuildProjectTest2.S");
+    validateStarted(2, "BuildProjectTest.nib");
+    LONGS_EQUAL(2, m_runner.maxRunningCount);
+    LONGS_EQUAL(BUILD_NODE_BUILT, nodeStatus(0));
+    LONGS_EQUAL(BUILD_NODE_BUILT, nodeStatus(1));
+    LONGS_EQUAL(BUILD_NODE_BUILT, nodeStatus(2));
+    LONGS_EQUAL(500, BuildProject_GetNode(m_pProject, 2)->milliseconds);
+    STRCMP_EQUAL("Built BuildProjectTest.nib in 300 ms." LINE_ENDING, printfSpy_GetLastOutput());
+    STRCMP_EQUAL("Assembled BuildProjectTest2.S in 500 ms." LINE_ENDING, printfSpy_GetPreviousOutput());
+}
+
+TEST(BuildProject, RunOneNodeAtATime)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(1));
+    LONGS_EQUAL(3, m_runner.startedCount);
+    LONGS_EQUAL(1, m_runner.maxRunningCount);
+}
+
+TEST(BuildProject, TreatZeroJobsAsOne)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(0));
+    LONGS_EQUAL(3, m_runner.startedCount);
+    LONGS_EQUAL(1, m_runner.maxRunningCount);
+}
+
+TEST(BuildProject, SkipUpToDateNodesOnSecondRun)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(0, m_runner.startedCount);
+    LONGS_EQUAL(BUILD_NODE_UP_TO_DATE, nodeStatus(0));
+    LONGS_EQUAL(BUILD_NODE_UP_TO_DATE, nodeStatus(1));
+    LONGS_EQUAL(BUILD_NODE_UP_TO_DATE, nodeStatus(2));
+    STRCMP_EQUAL("BuildProjectTest.nib is up to date." LINE_ENDING, printfSpy_GetLastOutput());
+}
+
+TEST(BuildProject, RunEveryNodeWithoutStateFile)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, BuildProject_Run(m_pProject, &m_runner.runner, 4, NULL));
+    m_runner.startedCount = 0;
+    m_runner.finishedCount = 0;
+    LONGS_EQUAL(0, BuildProject_Run(m_pProject, &m_runner.runner, 4, NULL));
+    LONGS_EQUAL(3, m_runner.startedCount);
+}
+
+TEST(BuildProject, RunEveryNodeWithCorruptStateFile)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    writeFile(g_stateFilename, "# snapbuild state v1\nBuildProjectTest1.S,123,456\n");
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(3, m_runner.startedCount);
+}
+
+TEST(BuildProject, ChangedSourceWithSameOutputLeavesImageUpToDate)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    writeFile(g_sourceFilenames[0], " sav BuildProjectTest1.sav ; Comment\n");
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(1, m_runner.startedCount);
+    validateStarted(0, "BuildProjectTest1.S");
+    LONGS_EQUAL(BUILD_NODE_UP_TO_DATE, nodeStatus(1));
+}
+
+TEST(BuildProject, ChangedAssemblyOutputRebuildsImage)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    writeFile(g_sourceFilenames[1], " sav BuildProjectTest2.sav\n lda #1\n");
+    m_runner.pOutputContent = "v2";
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(2, m_runner.startedCount);
+    validateStarted(0, "BuildProjectTest2.S");
+    validateStarted(1, "BuildProjectTest.nib");
+    LONGS_EQUAL(BUILD_NODE_UP_TO_DATE, nodeStatus(0));
+}
+
+TEST(BuildProject, ChangedScriptRebuildsImageOnly)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    writeFile(g_scriptFilename, "RWTS16,BuildProjectTest1.sav,0,*,0,0\nRW18,BuildProjectTest2.usr,0,*,0,2,0\n");
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(1, m_runner.startedCount);
+    validateStarted(0, "BuildProjectTest.nib");
+}
+
+TEST(BuildProject, DeletedOrModifiedOutputRebuildsNode)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    remove("BuildProjectTest.nib");
+    writeFile("BuildProjectTest2.usr", "patched");
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(2, m_runner.startedCount);
+    validateStarted(0, "BuildProjectTest2.S");
+    validateStarted(1, "BuildProjectTest.nib");
+}
+
+TEST(BuildProject, FailedAssemblySkipsImageAndRunsAgainNextTime)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    m_runner.pNodeToFail = "BuildProjectTest2.S";
+    LONGS_EQUAL(1, run(4));
+    LONGS_EQUAL(2, m_runner.startedCount);
+    LONGS_EQUAL(BUILD_NODE_BUILT, nodeStatus(0));
+    LONGS_EQUAL(BUILD_NODE_BLOCKED, nodeStatus(1));
+    LONGS_EQUAL(BUILD_NODE_FAILED, nodeStatus(2));
+    STRCMP_EQUAL("BuildProjectTest2.S: error: Failed after 500 ms." LINE_ENDING, printfSpy_GetLastErrorOutput());
+    STRCMP_EQUAL("Skipped BuildProjectTest.nib because BuildProjectTest2.S wasn't built." LINE_ENDING, 
+                 printfSpy_GetLastOutput());
+    
+    m_runner.pNodeToFail = NULL;
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(2, m_runner.startedCount);
+    validateStarted(0, "BuildProjectTest2.S");
+    validateStarted(1, "BuildProjectTest.nib");
+}
+
+TEST(BuildProject, MissingOutputFailsNode)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    m_runner.pOutputToSkip = "BuildProjectTest2.usr";
+    LONGS_EQUAL(1, run(4));
+    LONGS_EQUAL(BUILD_NODE_FAILED, nodeStatus(2));
+    STRCMP_EQUAL("BuildProjectTest2.S: error: Didn't write BuildProjectTest2.usr." LINE_ENDING, 
+                 printfSpy_GetLastErrorOutput());
+}
+
+TEST(BuildProject, PrintCriticalPath)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    printfSpy_Unhook();
+    printfSpy_Hook(256);
+    BuildProject_PrintCriticalPath(m_pProject);
+    LONGS_EQUAL(3, printfSpy_GetCallCount());
+    STRCMP_EQUAL("  BuildProjectTest2.S 500 ms" LINE_ENDING, printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  BuildProjectTest.nib 300 ms" LINE_ENDING, printfSpy_GetLastOutput());
+}
+
+TEST(BuildProject, PrintCriticalPathWhenEveryStepTakesZeroMilliseconds)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    m_runner.isInstant = 1;
+    LONGS_EQUAL(0, run(4));
+    printfSpy_Unhook();
+    printfSpy_Hook(256);
+    BuildProject_PrintCriticalPath(m_pProject);
+    LONGS_EQUAL(2, printfSpy_GetCallCount());
+    STRCMP_EQUAL("Critical path of 0 ms:" LINE_ENDING, printfSpy_GetPreviousOutput());
+    STRCMP_EQUAL("  BuildProjectTest1.S 0 ms" LINE_ENDING, printfSpy_GetLastOutput());
+}
+
+TEST(BuildProject, PrintNoCriticalPathWhenEverythingIsUpToDate)
+{
+    m_pProject = BuildProject_CreateFromString(g_twoAssembliesAndImage);
+    LONGS_EQUAL(0, run(4));
+    LONGS_EQUAL(0, run(4));
+    printfSpy_Unhook();
+    printfSpy_Hook(256);
+    BuildProject_PrintCriticalPath(m_pProject);
+    LONGS_EQUAL(0, printfSpy_GetCallCount());
+}
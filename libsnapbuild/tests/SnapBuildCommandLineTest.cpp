@@ -0,0 +1,148 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#include "string.h"
+
+// Include headers from C modules under test.
+extern "C"
+{
+#include "SnapBuildCommandLine.h"
+#include "SnapBuildCommandLineTest.h"
+#include "util.h"
+}
+
+// Include C++ headers for test harness.
+#include "CppUTest/TestHarness.h"
+
+
+static const char g_usageString[] = "Usage:";
+
+
+TEST_GROUP(SnapBuildCommandLine)
+{
+    const char*          m_argv[10];
+    SnapBuildCommandLine m_commandLine;
+    int                  m_argc;
+    
+    void setup()
+    {
+        clearExceptionCode();
+
+        memset(m_argv, 0, sizeof(m_argv));
+        memset(&m_commandLine, 0xff, sizeof(m_commandLine));
+        m_argc = 0;
+
+        printfSpy_Hook(strlen(g_usageString));
+    }
+
+    void teardown()
+    {
+        LONGS_EQUAL(noException, getExceptionCode());
+        printfSpy_Unhook();
+    }
+
+    void addArg(const char* pArg)
+    {
+        CHECK(m_argc < (int)ARRAYSIZE(m_argv));
+        m_argv[m_argc++] = pArg;
+    }
+    
+    void validateInvalidArgumentExceptionThrown()
+    {
+        LONGS_EQUAL(invalidArgumentException, getExceptionCode());
+        clearExceptionCode();
+        STRCMP_EQUAL(g_usageString, printfSpy_GetLastOutput());
+    }
+};
+
+
+TEST(SnapBuildCommandLine, NoParameters)
+{
+    __try_and_catch( SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(SnapBuildCommandLine, ProjectFilenameOnly)
+{
+    addArg("pop.snapbuild");
+    SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    STRCMP_EQUAL("", printfSpy_GetLastOutput());
+    STRCMP_EQUAL("pop.snapbuild", m_commandLine.pProjectFilename);
+    STRCMP_EQUAL("snap", m_commandLine.pSnapPath);
+    STRCMP_EQUAL("crackle", m_commandLine.pCracklePath);
+    LONGS_EQUAL(0, m_commandLine.maxJobs);
+}
+
+TEST(SnapBuildCommandLine, AllOptions)
+{
+    addArg("--jobs");
+    addArg("4");
+    addArg("--snap");
+    addArg("snap/Debug/snap");
+    addArg("--crackle");
+    addArg("crackle/Debug/crackle");
+    addArg("pop.snapbuild");
+    SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv);
+    STRCMP_EQUAL("pop.snapbuild", m_commandLine.pProjectFilename);
+    STRCMP_EQUAL("snap/Debug/snap", m_commandLine.pSnapPath);
+    STRCMP_EQUAL("crackle/Debug/crackle", m_commandLine.pCracklePath);
+    LONGS_EQUAL(4, m_commandLine.maxJobs);
+}
+
+TEST(SnapBuildCommandLine, TwoProjectFilenames)
+{
+    addArg("pop1.snapbuild");
+    addArg("pop2.snapbuild");
+    __try_and_catch( SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(SnapBuildCommandLine, MissingJobCount)
+{
+    addArg("pop.snapbuild");
+    addArg("--jobs");
+    __try_and_catch( SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(SnapBuildCommandLine, InvalidJobCounts)
+{
+    static const char* invalidCounts[] = { "0", "-1", "2x", "", "257" };
+    size_t i;
+    
+    addArg("--jobs");
+    addArg(NULL);
+    addArg("pop.snapbuild");
+    for (i = 0 ; i < ARRAYSIZE(invalidCounts) ; i++)
+    {
+        m_argv[1] = invalidCounts[i];
+        __try_and_catch( SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+        validateInvalidArgumentExceptionThrown();
+    }
+}
+
+TEST(SnapBuildCommandLine, MissingSnapPath)
+{
+    addArg("pop.snapbuild");
+    addArg("--snap");
+    __try_and_catch( SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
+
+TEST(SnapBuildCommandLine, InvalidFlag)
+{
+    addArg("--list");
+    addArg("pop.lst");
+    addArg("pop.snapbuild");
+    __try_and_catch( SnapBuildCommandLine_Init(&m_commandLine, m_argc, m_argv) );
+    validateInvalidArgumentExceptionThrown();
+}
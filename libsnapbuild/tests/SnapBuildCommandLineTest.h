@@ -0,0 +1,19 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+#ifndef _COMMAND_LINE_TEST_H_
+#define _COMMAND_LINE_TEST_H_
+
+/* Used to redirect specific calls to stubs as necessary for testing. */
+#include <printfSpy.h>
+
+#endif /* _COMMAND_LINE_TEST_H_ */
@@ -18,6 +18,7 @@
 /* Not using my test mocks in production so point hooks to Standard CRT functions. */
 void*  (*hook_malloc)(size_t size) = malloc;
 void*  (*hook_realloc)(void* ptr, size_t size) = realloc;
+void*  (*hook_calloc)(size_t count, size_t size) = calloc;
 void   (*hook_free)(void* ptr) = free;
 int    (*hook_printf)(const char* pFormat, ...) = printf;
 int    (*hook_fprintf)(FILE* pFile, const char* pFormat, ...) = fprintf;
@@ -13,9 +13,15 @@
 #include <stdio.h>
 #include "SnapCommandLine.h"
 #include "Assembler.h"
+#include "TraceLog.h"
+#include "AllocStats.h"
+#include "PerfCounters.h"
 #include "util.h"
 
 static int displayAndReturnErrorCountIfAnyWereEncountered(Assembler* pAssembler);
+static void displayStats(Assembler* pAssembler);
+static void displayProfile(Assembler* pAssembler);
+static int writeTrace(const char* pTraceFilename);
 int main(int argc, const char** argv)
 {
     int                 returnValue = 0;
@@ -25,9 +31,23 @@ int main(int argc, const char** argv)
     __try
     {
         SnapCommandLine_Init(&commandLine, argc-1, argv+1);
+        /* Nothing has been written to stdout yet so it can still be switched to large block writes for the listing. */
+        if (!commandLine.assemblerInitParams.pListFilename && !commandLine.assemblerInitParams.skipListing)
+            setvbuf(stdout, NULL, _IOFBF, 64 * 1024);
+        if (commandLine.collectAllocStats)
+            AllocStats_Start();
+        if (commandLine.pTraceFilename)
+            TraceLog_Start();
+        if (commandLine.collectPerfCounters && !PerfCounters_Start())
+            fprintf(stderr, "Hardware performance counters are not available so --perf-counters is ignored." LINE_ENDING);
         pAssembler = Assembler_CreateFromFile(commandLine.pSourceFilename, &commandLine.assemblerInitParams);
         Assembler_Run(pAssembler);
         returnValue = displayAndReturnErrorCountIfAnyWereEncountered(pAssembler);
+        if (commandLine.assemblerInitParams.collectStats)
+            displayStats(pAssembler);
+        if (commandLine.assemblerInitParams.collectProfile)
+            displayProfile(pAssembler);
+        PerfCounters_Print();
     }
     __catch
     {
@@ -36,7 +56,16 @@ int main(int argc, const char** argv)
         returnValue = 1;
     }
     
+    if (commandLine.pTraceFilename && !writeTrace(commandLine.pTraceFilename))
+        returnValue = 1;
+    TraceLog_Free();
+    PerfCounters_Free();
     Assembler_Free(pAssembler);
+    if (AllocStats_IsEnabled())
+    {
+        AllocStats_Stop();
+        AllocStats_Print();
+    }
     
     return returnValue;
 }
@@ -52,3 +81,89 @@ static int displayAndReturnErrorCountIfAnyWereEncountered(Assembler* pAssembler)
                warningCount, warningCount != 1 ? "warnings" : "warning");
     return (int)errorCount;
 }
+
+static int writeTrace(const char* pTraceFilename)
+{
+    __try
+    {
+        TraceLog_WriteToFile(pTraceFilename);
+    }
+    __catch
+    {
+        fprintf(stderr, "Failed to write trace to %s" LINE_ENDING, pTraceFilename);
+        __nothrow_and_return(0);
+    }
+    return 1;
+}
+
+static void displayStats(Assembler* pAssembler)
+{
+    AssemblerStats stats;
+    
+    Assembler_GetStats(pAssembler, &stats);
+    printf("Assembly statistics:" LINE_ENDING
+           "  symbol import:            %8.3f ms" LINE_ENDING
+           "  first pass:               %8.3f ms" LINE_ENDING
+           "  undefined symbol check:   %8.3f ms" LINE_ENDING
+           "  open conditional check:   %8.3f ms" LINE_ENDING
+           "  second pass:              %8.3f ms" LINE_ENDING
+           "  lines parsed:             %8u" LINE_ENDING
+           "  lines skipped:            %8u" LINE_ENDING
+           "  macro expansions:         %8u" LINE_ENDING
+           "  LUP iterations:           %8u" LINE_ENDING
+           "  forward reference fixups: %8u" LINE_ENDING
+           "  symbols imported:         %8u" LINE_ENDING
+           "  symbols:                  %8u" LINE_ENDING
+           "  longest symbol chain:     %8u" LINE_ENDING
+           "  bytes emitted:            %8u" LINE_ENDING
+           "  files opened:             %8u" LINE_ENDING,
+           stats.symbolImportMicroseconds / 1000.0,
+           stats.firstPassMicroseconds / 1000.0,
+           stats.undefinedSymbolCheckMicroseconds / 1000.0,
+           stats.openConditionalCheckMicroseconds / 1000.0,
+           stats.secondPassMicroseconds / 1000.0,
+           stats.linesParsed,
+           stats.linesSkipped,
+           stats.macroExpansions,
+           stats.lupIterations,
+           stats.forwardReferenceFixups,
+           stats.symbolsImported,
+           stats.symbolCount,
+           stats.maxSymbolChainLength,
+           stats.bytesEmitted,
+           stats.filesOpened);
+}
+
+static void displayProfileTable(const char* pTitle, const AssemblerProfileEntry* pEntries, size_t entryCount);
+static void displayProfile(Assembler* pAssembler)
+{
+    const AssemblerProfileEntry* pEntries;
+    size_t                       entryCount;
+    
+    pEntries = Assembler_GetOpcodeProfile(pAssembler, &entryCount);
+    displayProfileTable("Directive/opcode profile:", pEntries, entryCount);
+    pEntries = Assembler_GetAddressingModeProfile(pAssembler, &entryCount);
+    displayProfileTable("Addressing mode profile:", pEntries, entryCount);
+}
+
+static void displayProfileTable(const char* pTitle, const AssemblerProfileEntry* pEntries, size_t entryCount)
+{
+    unsigned long long totalNanoseconds = 0;
+    size_t             i;
+    
+    for (i = 0 ; i < entryCount ; i++)
+        totalNanoseconds += pEntries[i].nanoseconds;
+    
+    printf("%s" LINE_ENDING
+           "  %-14s %10s %12s %10s %6s" LINE_ENDING,
+           pTitle, "name", "calls", "total ms", "avg ns", "%");
+    for (i = 0 ; i < entryCount ; i++)
+    {
+        printf("  %-14s %10u %12.3f %10.0f %6.2f" LINE_ENDING,
+               pEntries[i].pName,
+               pEntries[i].calls,
+               pEntries[i].nanoseconds / 1000000.0,
+               (double)pEntries[i].nanoseconds / pEntries[i].calls,
+               totalNanoseconds ? 100.0 * pEntries[i].nanoseconds / totalNanoseconds : 0.0);
+    }
+}
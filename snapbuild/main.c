@@ -0,0 +1,346 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Steps are run as child processes with fork() and execvp() so that up to --jobs of them can run at the same time.
+   Windows has no fork() so its build instead runs each step to completion with system() and only one runs at a
+   time. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif /* WIN32 */
+#include "SnapBuildCommandLine.h"
+#include "BuildProject.h"
+#include "util.h"
+
+
+#define MAX_JOBS            256
+#define LOG_FILENAME_SUFFIX ".log"
+
+
+typedef struct ProcessRunnerJob
+{
+#ifdef WIN32
+    int            succeeded;
+    unsigned int   milliseconds;
+#else
+    pid_t          pid;
+    struct timeval startTime;
+#endif /* WIN32 */
+    BuildNode*     pNode;
+} ProcessRunnerJob;
+
+typedef struct ProcessRunner
+{
+    const SnapBuildCommandLine* pCommandLine;
+    ProcessRunnerJob            jobs[MAX_JOBS];
+    unsigned int                jobCount;
+} ProcessRunner;
+
+
+static unsigned int defaultJobCount(void);
+static void startNode(void* pContext, BuildNode* pNode);
+static BuildNode* waitForNode(void* pContext, int* pSucceeded, unsigned int* pMilliseconds);
+static char* allocateStateFilename(const char* pProjectFilename);
+int main(int argc, const char** argv)
+{
+    int                  returnValue = 0;
+    BuildProject*        pProject = NULL;
+    char*                pStateFilename = NULL;
+    SnapBuildCommandLine commandLine;
+    ProcessRunner        processRunner;
+    BuildRunner          runner;
+
+    memset(&commandLine, 0, sizeof(commandLine));
+    memset(&processRunner, 0, sizeof(processRunner));
+    __try
+    {
+        SnapBuildCommandLine_Init(&commandLine, argc-1, argv+1);
+        processRunner.pCommandLine = &commandLine;
+        runner.startNode = startNode;
+        runner.waitForNode = waitForNode;
+        runner.pContext = &processRunner;
+        
+        pProject = BuildProject_CreateFromFile(commandLine.pProjectFilename);
+        pStateFilename = allocateStateFilename(commandLine.pProjectFilename);
+        if (BuildProject_Run(pProject, &runner, commandLine.maxJobs ? commandLine.maxJobs : defaultJobCount(), 
+                             pStateFilename))
+        {
+            returnValue = 1;
+        }
+        BuildProject_PrintCriticalPath(pProject);
+    }
+    __catch
+    {
+        if (fileOpenException == getExceptionCode())
+            fprintf(stderr, "Failed to open %s" LINE_ENDING, commandLine.pProjectFilename);
+        returnValue = 1;
+    }
+    if (returnValue)
+        printf("%s build failed." LINE_ENDING, commandLine.pProjectFilename ? commandLine.pProjectFilename : "");
+    
+    free(pStateFilename);
+    BuildProject_Free(pProject);
+    
+    return returnValue;
+}
+
+static unsigned int defaultJobCount(void)
+{
+#ifdef WIN32
+    return 1;
+#else
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    
+    if (processorCount < 1)
+        return 1;
+    if (processorCount > MAX_JOBS)
+        return MAX_JOBS;
+    return (unsigned int)processorCount;
+#endif /* WIN32 */
+}
+
+static char* allocateFilenameWithSuffix(const char* pFilename, const char* pSuffix);
+static char* allocateStateFilename(const char* pProjectFilename)
+{
+    return allocateFilenameWithSuffix(pProjectFilename, BUILD_PROJECT_STATE_SUFFIX);
+}
+
+static char* allocateFilenameWithSuffix(const char* pFilename, const char* pSuffix)
+{
+    size_t filenameLength = strlen(pFilename);
+    size_t suffixLength = strlen(pSuffix);
+    char*  pResult = malloc(filenameLength + suffixLength + 1);
+    
+    if (!pResult)
+        __throw(outOfMemoryException);
+    memcpy(pResult, pFilename, filenameLength);
+    memcpy(pResult + filenameLength, pSuffix, suffixLength + 1);
+    
+    return pResult;
+}
+
+static unsigned int elapsedMilliseconds(const struct timeval* pStartTime);
+static void printLog(const char* pName);
+#ifdef WIN32
+static char* allocateCommand(ProcessRunner* pThis, BuildNode* pNode);
+static void startNode(void* pContext, BuildNode* pNode)
+{
+    /* The step is run right away and its result queued until BuildProject_Run() waits for it. */
+    ProcessRunner*    pThis = (ProcessRunner*)pContext;
+    ProcessRunnerJob* pJob = &pThis->jobs[pThis->jobCount];
+    char*             pCommand = allocateCommand(pThis, pNode);
+    struct timeval    startTime;
+    
+    fflush(stdout);
+    fflush(stderr);
+    gettimeofday(&startTime, NULL);
+    pJob->succeeded = system(pCommand) == 0;
+    pJob->milliseconds = elapsedMilliseconds(&startTime);
+    pJob->pNode = pNode;
+    pThis->jobCount++;
+    free(pCommand);
+}
+
+static char* allocateCommand(ProcessRunner* pThis, BuildNode* pNode)
+{
+    /* cmd.exe strips the outer quotes from a command which starts with one so the whole command is wrapped in an 
+       extra pair.  The step's output is redirected to its log just as it is for the fork() based runner. */
+    const SnapBuildCommandLine* pCommandLine = pThis->pCommandLine;
+    size_t                      size = 64 + 2 * strlen(pNode->pName);
+    char*                       pCommand;
+    
+    if (pNode->type == BUILD_NODE_ASSEMBLE)
+        size += strlen(pCommandLine->pSnapPath);
+    else
+        size += strlen(pCommandLine->pCracklePath) + strlen(pNode->pImageFormat) + strlen(pNode->pScriptFilename);
+    pCommand = malloc(size);
+    if (!pCommand)
+        __throw(outOfMemoryException);
+    
+    if (pNode->type == BUILD_NODE_ASSEMBLE)
+    {
+        sprintf(pCommand, "\"\"%s\" \"%s\" >\"%s" LOG_FILENAME_SUFFIX "\" 2>&1\"", 
+                pCommandLine->pSnapPath, pNode->pName, pNode->pName);
+    }
+    else
+    {
+        sprintf(pCommand, "\"\"%s\" --format %s \"%s\" \"%s\" >\"%s" LOG_FILENAME_SUFFIX "\" 2>&1\"", 
+                pCommandLine->pCracklePath, pNode->pImageFormat, pNode->pScriptFilename, pNode->pName, pNode->pName);
+    }
+    
+    return pCommand;
+}
+
+static BuildNode* waitForNode(void* pContext, int* pSucceeded, unsigned int* pMilliseconds)
+{
+    ProcessRunner*   pThis = (ProcessRunner*)pContext;
+    ProcessRunnerJob job = pThis->jobs[0];
+    
+    pThis->jobCount--;
+    memmove(&pThis->jobs[0], &pThis->jobs[1], pThis->jobCount * sizeof(pThis->jobs[0]));
+    *pSucceeded = job.succeeded;
+    *pMilliseconds = job.milliseconds;
+    if (!job.succeeded)
+        printLog(job.pNode->pName);
+    
+    return job.pNode;
+}
+#else
+static void runNodeInChild(ProcessRunner* pThis, BuildNode* pNode);
+static void startNode(void* pContext, BuildNode* pNode)
+{
+    ProcessRunner*    pThis = (ProcessRunner*)pContext;
+    ProcessRunnerJob* pJob = &pThis->jobs[pThis->jobCount];
+    pid_t             pid;
+    
+    /* Anything still buffered would otherwise be written again by the child. */
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (pid < 0)
+        __throw(fileException);
+    if (pid == 0)
+        runNodeInChild(pThis, pNode);
+    
+    pJob->pid = pid;
+    pJob->pNode = pNode;
+    gettimeofday(&pJob->startTime, NULL);
+    pThis->jobCount++;
+}
+
+static void runNodeInChild(ProcessRunner* pThis, BuildNode* pNode)
+{
+    const char* args[6];
+    char*       pLogFilename = NULL;
+    int         logFile;
+    
+    /* Each node writes its output to its own log so that the output of nodes running at the same time isn't mixed 
+       together. */
+    __try
+    {
+        pLogFilename = allocateFilenameWithSuffix(pNode->pName, LOG_FILENAME_SUFFIX);
+    }
+    __catch
+    {
+        _exit(1);
+    }
+    logFile = open(pLogFilename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (logFile < 0)
+    {
+        fprintf(stderr, "Failed to create %s" LINE_ENDING, pLogFilename);
+        _exit(1);
+    }
+    dup2(logFile, STDOUT_FILENO);
+    dup2(logFile, STDERR_FILENO);
+    close(logFile);
+    
+    if (pNode->type == BUILD_NODE_ASSEMBLE)
+    {
+        args[0] = pThis->pCommandLine->pSnapPath;
+        args[1] = pNode->pName;
+        args[2] = NULL;
+    }
+    else
+    {
+        args[0] = pThis->pCommandLine->pCracklePath;
+        args[1] = "--format";
+        args[2] = pNode->pImageFormat;
+        args[3] = pNode->pScriptFilename;
+        args[4] = pNode->pName;
+        args[5] = NULL;
+    }
+    execvp(args[0], (char* const*)args);
+    fprintf(stderr, "Failed to run %s" LINE_ENDING, args[0]);
+    _exit(1);
+}
+
+static ProcessRunnerJob* findJob(ProcessRunner* pThis, pid_t pid);
+static BuildNode* waitForNode(void* pContext, int* pSucceeded, unsigned int* pMilliseconds)
+{
+    ProcessRunner*    pThis = (ProcessRunner*)pContext;
+    ProcessRunnerJob* pJob = NULL;
+    BuildNode*        pNode;
+    int               status = 0;
+    
+    while (!pJob)
+    {
+        pid_t pid = waitpid(-1, &status, 0);
+        
+        if (pid < 0 && errno != EINTR)
+            __throw(fileException);
+        if (pid > 0)
+            pJob = findJob(pThis, pid);
+    }
+    
+    pNode = pJob->pNode;
+    *pMilliseconds = elapsedMilliseconds(&pJob->startTime);
+    *pSucceeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    *pJob = pThis->jobs[--pThis->jobCount];
+    if (!*pSucceeded)
+        printLog(pNode->pName);
+    
+    return pNode;
+}
+
+static ProcessRunnerJob* findJob(ProcessRunner* pThis, pid_t pid)
+{
+    unsigned int i;
+    
+    for (i = 0 ; i < pThis->jobCount ; i++)
+    {
+        if (pThis->jobs[i].pid == pid)
+            return &pThis->jobs[i];
+    }
+    return NULL;
+}
+#endif /* WIN32 */
+
+static unsigned int elapsedMilliseconds(const struct timeval* pStartTime)
+{
+    struct timeval now;
+    
+    gettimeofday(&now, NULL);
+    return (unsigned int)((now.tv_sec - pStartTime->tv_sec) * 1000 + (now.tv_usec - pStartTime->tv_usec) / 1000);
+}
+
+static void printLog(const char* pName)
+{
+    char*  pLogFilename = NULL;
+    FILE*  pFile;
+    char   buffer[256];
+    size_t bytesRead;
+    
+    __try
+    {
+        pLogFilename = allocateFilenameWithSuffix(pName, LOG_FILENAME_SUFFIX);
+    }
+    __catch
+    {
+        clearExceptionCode();
+    }
+    if (!pLogFilename)
+        return;
+    pFile = fopen(pLogFilename, "r");
+    if (pFile)
+    {
+        while ((bytesRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+            fwrite(buffer, 1, bytesRead, stdout);
+        fclose(pFile);
+    }
+    free(pLogFilename);
+}
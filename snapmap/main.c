@@ -0,0 +1,152 @@
+/*  Copyright (C) 2013  Adam Green (https://github.com/adamgreen)
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+*/
+/* Looks up addresses and symbols in a debug map written by snap --debug-map.  The map is mapped into memory and
+   searched in place so a lookup costs a couple of binary searches no matter how large the map is.  Windows has no
+   mmap() so the map is read into a heap buffer there instead. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif /* WIN32 */
+#include "DebugMap.h"
+#include "util.h"
+
+
+typedef struct MappedFile
+{
+    void*  pData;
+    size_t size;
+} MappedFile;
+
+
+static void displayUsage(void);
+static int mapFile(MappedFile* pThis, const char* pFilename);
+static void unmapFile(MappedFile* pThis);
+int main(int argc, const char** argv)
+{
+    MappedFile   mappedFile = { NULL, 0 };
+    DebugMapView view;
+    unsigned int missCount;
+
+    if (argc < 3)
+    {
+        displayUsage();
+        return 1;
+    }
+    if (!mapFile(&mappedFile, argv[1]))
+        return 1;
+    
+    __try
+    {
+        DebugMapView_Init(&view, mappedFile.pData, mappedFile.size);
+    }
+    __catch
+    {
+        fprintf(stderr, "error: %s isn't a valid debug map." LINE_ENDING, argv[1]);
+        unmapFile(&mappedFile);
+        return 1;
+    }
+    
+    missCount = DebugMapView_PrintQueries(&view, argv + 2, (size_t)(argc - 2));
+    unmapFile(&mappedFile);
+    
+    return missCount > 0 ? 1 : 0;
+}
+
+static void displayUsage(void)
+{
+    printf("Usage: snapmap mapFilename query...\n\n"
+           "Where: mapFilename is the name of a debug map written by\n"
+           "         snap --debug-map.\n"
+           "       query is either an address, such as $0803 or 0x803, to be\n"
+           "         looked up as the source line which emitted it or a symbol\n"
+           "         name, such as main or main:loop, to be looked up as its value.\n"
+           "Exits with a status of 1 if any query isn't found.\n");
+}
+
+#ifdef WIN32
+static int mapFile(MappedFile* pThis, const char* pFilename)
+{
+    FILE* pFile = fopen(pFilename, "rb");
+    long  fileSize;
+    
+    if (!pFile)
+    {
+        fprintf(stderr, "error: Failed to open %s." LINE_ENDING, pFilename);
+        return 0;
+    }
+    if (fseek(pFile, 0, SEEK_END) != 0 || (fileSize = ftell(pFile)) <= 0 || fseek(pFile, 0, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "error: %s isn't a valid debug map." LINE_ENDING, pFilename);
+        fclose(pFile);
+        return 0;
+    }
+    pThis->size = (size_t)fileSize;
+    pThis->pData = malloc(pThis->size);
+    if (!pThis->pData || fread(pThis->pData, 1, pThis->size, pFile) != pThis->size)
+    {
+        fprintf(stderr, "error: Failed to read %s into memory." LINE_ENDING, pFilename);
+        fclose(pFile);
+        free(pThis->pData);
+        pThis->pData = NULL;
+        return 0;
+    }
+    fclose(pFile);
+    
+    return 1;
+}
+
+static void unmapFile(MappedFile* pThis)
+{
+    free(pThis->pData);
+}
+#else
+static int mapFile(MappedFile* pThis, const char* pFilename)
+{
+    struct stat fileStats;
+    int         fileDescriptor = open(pFilename, O_RDONLY);
+    
+    if (fileDescriptor < 0)
+    {
+        fprintf(stderr, "error: Failed to open %s." LINE_ENDING, pFilename);
+        return 0;
+    }
+    if (fstat(fileDescriptor, &fileStats) < 0 || fileStats.st_size == 0)
+    {
+        fprintf(stderr, "error: %s isn't a valid debug map." LINE_ENDING, pFilename);
+        close(fileDescriptor);
+        return 0;
+    }
+    pThis->size = (size_t)fileStats.st_size;
+    pThis->pData = mmap(NULL, pThis->size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (pThis->pData == MAP_FAILED)
+    {
+        fprintf(stderr, "error: Failed to map %s into memory." LINE_ENDING, pFilename);
+        pThis->pData = NULL;
+        return 0;
+    }
+    
+    return 1;
+}
+
+static void unmapFile(MappedFile* pThis)
+{
+    if (pThis->pData)
+        munmap(pThis->pData, pThis->size);
+}
+#endif /* WIN32 */